@@ -0,0 +1,289 @@
+#include <metal_stdlib>
+using namespace metal;
+
+#ifndef REAL
+#define REAL float
+#endif
+
+////////////////////////////////////////////////////////////////////
+// Matrix products, in the column major layout of the ge_ kernels:
+// element (i, j) of a matrix is at offset + i + j * ld.
+////////////////////////////////////////////////////////////////////
+
+// Each threadgroup computes a GEMM_TILE x GEMM_TILE tile of c, with
+// GEMM_THREADS threads that each hold a GEMM_WORK x GEMM_WORK block of
+// the tile in registers. The tiles of a and b are staged through
+// threadgroup memory, GEMM_DEPTH columns of op(a) at a time.
+// These must match dispatch_plan.hpp.
+#define GEMM_TILE 64
+#define GEMM_DEPTH 16
+#define GEMM_THREADS 256
+#define GEMM_WORK 4
+// threads along each side of the tile
+#define GEMM_SIDE (GEMM_TILE / GEMM_WORK)
+
+// c = alpha * op(a) * op(b) + beta * c, where op(a) is m x k, op(b) is k x n, and op transposes
+// its matrix when trans_a or trans_b is non-zero. c is not read when beta is zero.
+kernel void ge_gemm (constant int& m [[buffer(0)]], constant int& n [[buffer(1)]], constant int& k [[buffer(2)]],
+                     constant int& trans_a [[buffer(3)]], constant int& trans_b [[buffer(4)]],
+                     constant REAL& alpha [[buffer(5)]],
+                     const device REAL* a [[buffer(6)]],
+                     constant int& offset_a [[buffer(7)]], constant int& ld_a [[buffer(8)]],
+                     const device REAL* b [[buffer(9)]],
+                     constant int& offset_b [[buffer(10)]], constant int& ld_b [[buffer(11)]],
+                     constant REAL& beta [[buffer(12)]],
+                     device REAL* c [[buffer(13)]],
+                     constant int& offset_c [[buffer(14)]], constant int& ld_c [[buffer(15)]],
+                     uint2 group [[threadgroup_position_in_grid]],
+                     uint tid [[thread_index_in_threadgroup]]) {
+    threadgroup REAL tileA[GEMM_DEPTH][GEMM_TILE];
+    threadgroup REAL tileB[GEMM_DEPTH][GEMM_TILE];
+
+    int row0 = group.x * GEMM_TILE;
+    int col0 = group.y * GEMM_TILE;
+    // this thread's rows and columns are GEMM_SIDE apart, so that neighbours read neighbouring words
+    int tx = tid % GEMM_SIDE;
+    int ty = tid / GEMM_SIDE;
+
+    REAL acc[GEMM_WORK][GEMM_WORK];
+    for (int i = 0; i < GEMM_WORK; i++) {
+        for (int j = 0; j < GEMM_WORK; j++) {
+            acc[i][j] = 0.0;
+        }
+    }
+
+    for (int p0 = 0; p0 < k; p0 += GEMM_DEPTH) {
+        // each thread loads GEMM_TILE * GEMM_DEPTH / GEMM_THREADS elements of each tile,
+        // with neighbouring threads reading along the leading dimension of the source
+        for (int e = tid; e < GEMM_TILE * GEMM_DEPTH; e += GEMM_THREADS) {
+            int i, p;
+            if (trans_a) {
+                p = e % GEMM_DEPTH;
+                i = e / GEMM_DEPTH;
+            } else {
+                i = e % GEMM_TILE;
+                p = e / GEMM_TILE;
+            }
+            int row = row0 + i;
+            int depth = p0 + p;
+            REAL value = 0.0;
+            if (row < m && depth < k) {
+                value = trans_a ? a[offset_a + depth + row * ld_a] : a[offset_a + row + depth * ld_a];
+            }
+            tileA[p][i] = value;
+
+            int j;
+            if (trans_b) {
+                j = e % GEMM_TILE;
+                p = e / GEMM_TILE;
+            } else {
+                p = e % GEMM_DEPTH;
+                j = e / GEMM_DEPTH;
+            }
+            int col = col0 + j;
+            depth = p0 + p;
+            value = 0.0;
+            if (col < n && depth < k) {
+                value = trans_b ? b[offset_b + col + depth * ld_b] : b[offset_b + depth + col * ld_b];
+            }
+            tileB[p][j] = value;
+        }
+        threadgroup_barrier(mem_flags::mem_threadgroup);
+
+        for (int p = 0; p < GEMM_DEPTH; p++) {
+            REAL av[GEMM_WORK];
+            REAL bv[GEMM_WORK];
+            for (int i = 0; i < GEMM_WORK; i++) {
+                av[i] = tileA[p][tx + i * GEMM_SIDE];
+                bv[i] = tileB[p][ty + i * GEMM_SIDE];
+            }
+            for (int i = 0; i < GEMM_WORK; i++) {
+                for (int j = 0; j < GEMM_WORK; j++) {
+                    acc[i][j] = fma(av[i], bv[j], acc[i][j]);
+                }
+            }
+        }
+        threadgroup_barrier(mem_flags::mem_threadgroup);
+    }
+
+    for (int j = 0; j < GEMM_WORK; j++) {
+        int col = col0 + ty + j * GEMM_SIDE;
+        for (int i = 0; i < GEMM_WORK; i++) {
+            int row = row0 + tx + i * GEMM_SIDE;
+            if (row < m && col < n) {
+                int index = offset_c + row + col * ld_c;
+                REAL value = alpha * acc[i][j];
+                c[index] = (beta == 0.0) ? value : value + beta * c[index];
+            }
+        }
+    }
+}
+
+// Matrix-vector products, in threadgroups of GEMV_THREADS threads.
+// This must match dispatch_plan.hpp.
+#define GEMV_THREADS 256
+
+// y = alpha * op(a) * x + beta * y, where a is m x n, and op transposes it when trans is non-zero.
+// Without a transpose, each thread sums a row of a, so that neighbouring threads read neighbouring
+// words. Transposed, each SIMD group sums a column. y is not read when beta is zero.
+kernel void ge_mv (constant int& trans [[buffer(0)]], constant int& m [[buffer(1)]], constant int& n [[buffer(2)]],
+                   constant REAL& alpha [[buffer(3)]],
+                   const device REAL* a [[buffer(4)]],
+                   constant int& offset_a [[buffer(5)]], constant int& ld_a [[buffer(6)]],
+                   const device REAL* x [[buffer(7)]],
+                   constant int& offset_x [[buffer(8)]], constant int& stride_x [[buffer(9)]],
+                   constant REAL& beta [[buffer(10)]],
+                   device REAL* y [[buffer(11)]],
+                   constant int& offset_y [[buffer(12)]], constant int& stride_y [[buffer(13)]],
+                   uint group [[threadgroup_position_in_grid]],
+                   uint tid [[thread_index_in_threadgroup]],
+                   uint simd [[simdgroup_index_in_threadgroup]],
+                   uint lane [[thread_index_in_simdgroup]],
+                   uint simdWidth [[threads_per_simdgroup]],
+                   uint simdCount [[simdgroups_per_threadgroup]]) {
+    REAL sum = 0.0;
+    int element;
+    if (trans) {
+        element = group * simdCount + simd;
+        if (element >= n) {
+            return;
+        }
+        const device REAL* column = a + offset_a + element * ld_a;
+        for (int i = lane; i < m; i += simdWidth) {
+            sum = fma(column[i], x[offset_x + i * stride_x], sum);
+        }
+        sum = simd_sum(sum);
+        if (lane != 0) {
+            return;
+        }
+    } else {
+        element = group * GEMV_THREADS + tid;
+        if (element >= m) {
+            return;
+        }
+        for (int j = 0; j < n; j++) {
+            sum = fma(a[offset_a + element + j * ld_a], x[offset_x + j * stride_x], sum);
+        }
+    }
+    int index = offset_y + element * stride_y;
+    REAL value = alpha * sum;
+    y[index] = (beta == 0.0) ? value : value + beta * y[index];
+}
+
+// a = alpha * x * y^T + a, where a is m x n, with a thread for each element of a
+kernel void ge_rk (constant int& m [[buffer(0)]], constant int& n [[buffer(1)]],
+                   constant REAL& alpha [[buffer(2)]],
+                   const device REAL* x [[buffer(3)]],
+                   constant int& offset_x [[buffer(4)]], constant int& stride_x [[buffer(5)]],
+                   const device REAL* y [[buffer(6)]],
+                   constant int& offset_y [[buffer(7)]], constant int& stride_y [[buffer(8)]],
+                   device REAL* a [[buffer(9)]],
+                   constant int& offset_a [[buffer(10)]], constant int& ld_a [[buffer(11)]],
+                   uint2 id [[thread_position_in_grid]]) {
+    int i = id.x;
+    int j = id.y;
+    if (i < m && j < n) {
+        int index = offset_a + i + j * ld_a;
+        a[index] = fma(x[offset_x + i * stride_x], alpha * y[offset_y + j * stride_y], a[index]);
+    }
+}
+
+////////////////////////////////////////////////////////////////////
+// Triangular functions. The engine works along the diagonal of the
+// triangle a block of TRIANGULAR_BLOCK rows at a time: these kernels
+// multiply or solve with one block of the diagonal, and ge_gemm or
+// ge_mv applies the rest of the triangle to the rows that are left.
+// Element (i, j) of a block is at offset + i * row + j * col, so a
+// kernel reads a matrix or its transpose in the same way.
+////////////////////////////////////////////////////////////////////
+
+// b = alpha * t * b for column j of b, where t is a size x size triangle. Each row uses rows of b
+// that are still to be written, so a lower triangle is worked from the bottom up.
+inline void multiply_block(int size, int lower, int unit, REAL alpha,
+                           const device REAL* a, int row_a, int col_a,
+                           device REAL* b, int row_b) {
+    for (int s = 0; s < size; s++) {
+        int i = lower ? size - 1 - s : s;
+        REAL sum = unit ? b[i * row_b] : a[i * row_a + i * col_a] * b[i * row_b];
+        int first = lower ? 0 : i + 1;
+        int last = lower ? i : size;
+        for (int p = first; p < last; p++) {
+            sum = fma(a[i * row_a + p * col_a], b[p * row_b], sum);
+        }
+        b[i * row_b] = alpha * sum;
+    }
+}
+
+// Solves t * x = alpha * b for column j of b, by substitution down a lower triangle or up an
+// upper one
+inline void solve_block(int size, int lower, int unit, REAL alpha,
+                        const device REAL* a, int row_a, int col_a,
+                        device REAL* b, int row_b) {
+    for (int s = 0; s < size; s++) {
+        int i = lower ? s : size - 1 - s;
+        REAL sum = alpha * b[i * row_b];
+        int first = lower ? 0 : i + 1;
+        int last = lower ? i : size;
+        for (int p = first; p < last; p++) {
+            sum = fma(-a[i * row_a + p * col_a], b[p * row_b], sum);
+        }
+        b[i * row_b] = unit ? sum : sum / a[i * row_a + i * col_a];
+    }
+}
+
+// The block of the diagonal of uplo_trmm: a thread for each of the n columns of b.
+// unit is non-zero when the diagonal is all ones, which is then not read.
+kernel void uplo_trmm (constant int& size [[buffer(0)]], constant int& n [[buffer(1)]],
+                       constant int& lower [[buffer(2)]], constant int& unit [[buffer(3)]],
+                       constant REAL& alpha [[buffer(4)]],
+                       const device REAL* a [[buffer(5)]],
+                       constant int& offset_a [[buffer(6)]], constant int& row_a [[buffer(7)]], constant int& col_a [[buffer(8)]],
+                       device REAL* b [[buffer(9)]],
+                       constant int& offset_b [[buffer(10)]], constant int& row_b [[buffer(11)]], constant int& col_b [[buffer(12)]],
+                       uint j [[thread_position_in_grid]]) {
+    if ((int)j < n) {
+        multiply_block(size, lower, unit, alpha, a + offset_a, row_a, col_a, b + offset_b + j * col_b, row_b);
+    }
+}
+
+// The block of the diagonal of uplo_trsm, with the arguments of uplo_trmm
+kernel void uplo_trsm (constant int& size [[buffer(0)]], constant int& n [[buffer(1)]],
+                       constant int& lower [[buffer(2)]], constant int& unit [[buffer(3)]],
+                       constant REAL& alpha [[buffer(4)]],
+                       const device REAL* a [[buffer(5)]],
+                       constant int& offset_a [[buffer(6)]], constant int& row_a [[buffer(7)]], constant int& col_a [[buffer(8)]],
+                       device REAL* b [[buffer(9)]],
+                       constant int& offset_b [[buffer(10)]], constant int& row_b [[buffer(11)]], constant int& col_b [[buffer(12)]],
+                       uint j [[thread_position_in_grid]]) {
+    if ((int)j < n) {
+        solve_block(size, lower, unit, alpha, a + offset_a, row_a, col_a, b + offset_b + j * col_b, row_b);
+    }
+}
+
+// The blocks of the diagonal of uplo_trmv and uplo_trsv, with the arguments of uplo_trmm.
+// The vector is a matrix with one column, and row_b is its stride.
+kernel void uplo_trmv (constant int& size [[buffer(0)]], constant int& n [[buffer(1)]],
+                       constant int& lower [[buffer(2)]], constant int& unit [[buffer(3)]],
+                       constant REAL& alpha [[buffer(4)]],
+                       const device REAL* a [[buffer(5)]],
+                       constant int& offset_a [[buffer(6)]], constant int& row_a [[buffer(7)]], constant int& col_a [[buffer(8)]],
+                       device REAL* x [[buffer(9)]],
+                       constant int& offset_x [[buffer(10)]], constant int& stride_x [[buffer(11)]], constant int& col_x [[buffer(12)]],
+                       uint j [[thread_position_in_grid]]) {
+    if (j == 0) {
+        multiply_block(size, lower, unit, alpha, a + offset_a, row_a, col_a, x + offset_x, stride_x);
+    }
+}
+
+kernel void uplo_trsv (constant int& size [[buffer(0)]], constant int& n [[buffer(1)]],
+                       constant int& lower [[buffer(2)]], constant int& unit [[buffer(3)]],
+                       constant REAL& alpha [[buffer(4)]],
+                       const device REAL* a [[buffer(5)]],
+                       constant int& offset_a [[buffer(6)]], constant int& row_a [[buffer(7)]], constant int& col_a [[buffer(8)]],
+                       device REAL* x [[buffer(9)]],
+                       constant int& offset_x [[buffer(10)]], constant int& stride_x [[buffer(11)]], constant int& col_x [[buffer(12)]],
+                       uint j [[thread_position_in_grid]]) {
+    if (j == 0) {
+        solve_block(size, lower, unit, alpha, a + offset_a, row_a, col_a, x + offset_x, stride_x);
+    }
+}
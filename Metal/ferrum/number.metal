@@ -5,16 +5,6 @@ using namespace metal;
 #define REAL float
 #endif
 
-kernel void vector_equals (const device REAL* x, constant uint& offset_x, constant uint& stride_x,
-                           const device REAL* y, constant uint& offset_y, constant uint& stride_y,
-                           device int& eq_flag,
-                           uint id [[thread_position_in_grid]]) {
-
-    if (x[offset_x + id * stride_x] != y[offset_y + id * stride_y]) {
-        eq_flag++;
-    }
-}
-
 kernel void vector_copy (const device REAL* x, constant uint& offset_x, constant uint& stride_x,
                          device REAL* y, constant uint& offset_y, constant uint& stride_y,
                          uint id [[thread_position_in_grid]]) {
@@ -33,9 +23,11 @@ kernel void vector_swap (device REAL* x, constant uint& offset_x, constant int&
     x[ix] = val;
 }
 
+// x is not read, but is in the arguments so that set takes the same arguments as the other fbB functions
 kernel void vector_set (constant REAL& val,
-                        device REAL* x, constant uint& offset_x, constant uint& stride_x,
+                        const device REAL* x, constant uint& offset_x, constant uint& stride_x,
+                        device REAL* y, constant uint& offset_y, constant uint& stride_y,
                         uint id [[thread_position_in_grid]]) {
-    x[offset_x + id * stride_x] = val;
+    y[offset_y + id * stride_y] = val;
 }
 
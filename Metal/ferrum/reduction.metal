@@ -0,0 +1,249 @@
+#include <metal_stdlib>
+using namespace metal;
+
+#ifndef REAL
+#define REAL float
+#endif
+
+////////////////////////////////////////////////////////////////////
+// Reductions of vectors to a single value, written to the first
+// element of the result.
+//
+// These run in two passes over the same kernel. In pass 0, each
+// threadgroup reduces a slice of the vector to a partial result.
+// In pass 1, a single threadgroup reduces the partial results.
+// After the usual arguments, the host binds the partial results, the
+// number of elements (or of partial results, in pass 1), and the pass.
+// Threadgroups are a power of two in size, with a Partial for each
+// thread in threadgroup memory 0.
+// Elements are always combined in the same order for a given count,
+// so results are repeatable.
+//
+// With PASS_FIXED, pass 0 uses the fixed blocking of reproducible sums
+// from dispatch_plan.hpp: one threadgroup of REPRODUCIBLE_LANES threads
+// for each block of REPRODUCIBLE_ROWS rows. The result then does not
+// depend on the device either. The CPU engine repeats this arithmetic.
+//
+// Sums are compensated, so this file is compiled without fast math.
+////////////////////////////////////////////////////////////////////
+
+// bits of the pass argument
+#define PASS_SECOND 1
+#define PASS_FIXED 2
+
+// must match dispatch_plan.hpp
+#define REPRODUCIBLE_ROWS 8
+
+struct Partial {
+    REAL value;
+    // nrm2: the largest magnitude, where value is the sum of squares divided by scale^2
+    // sums: the rounding errors of the additions to value
+    REAL scale;
+    // amax and iamax: the first element holding value, or UINT_MAX if there is none
+    uint index;
+};
+
+// the error of each addition is found exactly (Knuth's two-sum), and added back at the end
+struct Sum {
+    static Partial identity() { return {(REAL)0.0, (REAL)0.0, 0}; }
+    static Partial element(REAL x, uint) { return {x, (REAL)0.0, 0}; }
+    static Partial combine(Partial a, Partial b) {
+        REAL s = a.value + b.value;
+        REAL bv = s - a.value;
+        REAL error = (a.value - (s - bv)) + (b.value - bv);
+        return {s, a.scale + b.scale + error, 0};
+    }
+    static REAL finish(Partial p) { return p.value + p.scale; }
+};
+
+struct Asum {
+    static Partial identity() { return Sum::identity(); }
+    static Partial element(REAL x, uint) { return {abs(x), (REAL)0.0, 0}; }
+    static Partial combine(Partial a, Partial b) { return Sum::combine(a, b); }
+    static REAL finish(Partial p) { return Sum::finish(p); }
+};
+
+struct Dot {
+    static Partial identity() { return Sum::identity(); }
+    static Partial pair(REAL x, REAL y, uint) { return {x * y, (REAL)0.0, 0}; }
+    static Partial combine(Partial a, Partial b) { return Sum::combine(a, b); }
+    static REAL finish(Partial p) { return Sum::finish(p); }
+};
+
+// the number of elements that differ
+struct Equals {
+    static Partial identity() { return Sum::identity(); }
+    static Partial pair(REAL x, REAL y, uint) { return {(x != y) ? (REAL)1.0 : (REAL)0.0, (REAL)0.0, 0}; }
+    static Partial combine(Partial a, Partial b) { return Sum::combine(a, b); }
+    static REAL finish(Partial p) { return Sum::finish(p); }
+};
+
+// scaled by the largest magnitude, so that the squares cannot overflow or underflow
+struct Nrm2 {
+    static Partial identity() { return {(REAL)0.0, (REAL)0.0, 0}; }
+    static Partial element(REAL x, uint) { return {(REAL)1.0, abs(x), 0}; }
+    static Partial combine(Partial a, Partial b) {
+        Partial big = (a.scale < b.scale) ? b : a;
+        Partial small = (a.scale < b.scale) ? a : b;
+        if (big.scale == (REAL)0.0 || isinf(big.scale)) {
+            return big;
+        }
+        REAL ratio = small.scale / big.scale;
+        return {big.value + small.value * ratio * ratio, big.scale, 0};
+    }
+    static REAL finish(Partial p) { return p.scale * sqrt(p.value); }
+};
+
+// the largest magnitude, and the first element that holds it
+struct Amax {
+    static Partial identity() { return {(REAL)-1.0, (REAL)0.0, UINT_MAX}; }
+    static Partial element(REAL x, uint i) { return {abs(x), (REAL)0.0, i}; }
+    static Partial combine(Partial a, Partial b) {
+        return (b.value > a.value || (b.value == a.value && b.index < a.index)) ? b : a;
+    }
+    static REAL finish(Partial p) { return max(p.value, (REAL)0.0); }
+};
+
+// the index is exact for vectors of up to 2^24 elements
+struct Iamax {
+    static Partial identity() { return Amax::identity(); }
+    static Partial element(REAL x, uint i) { return Amax::element(x, i); }
+    static Partial combine(Partial a, Partial b) { return Amax::combine(a, b); }
+    static REAL finish(Partial p) { return (p.index == UINT_MAX) ? (REAL)-1.0 : (REAL)p.index; }
+};
+
+// fmin and fmax ignore NaN, so an empty vector gives NaN
+struct Min {
+    static Partial identity() { return {(REAL)NAN, (REAL)0.0, 0}; }
+    static Partial element(REAL x, uint) { return {x, (REAL)0.0, 0}; }
+    static Partial combine(Partial a, Partial b) { return {fmin(a.value, b.value), (REAL)0.0, 0}; }
+    static REAL finish(Partial p) { return p.value; }
+};
+
+struct Max {
+    static Partial identity() { return {(REAL)NAN, (REAL)0.0, 0}; }
+    static Partial element(REAL x, uint) { return {x, (REAL)0.0, 0}; }
+    static Partial combine(Partial a, Partial b) { return {fmax(a.value, b.value), (REAL)0.0, 0}; }
+    static REAL finish(Partial p) { return p.value; }
+};
+
+// Combines the partial results of a threadgroup, in a fixed tree
+template <typename Op>
+Partial reduce_group(Partial p, threadgroup Partial* shared, uint tid, uint threads) {
+    shared[tid] = p;
+    threadgroup_barrier(mem_flags::mem_threadgroup);
+    for (uint s = threads / 2; s > 0; s /= 2) {
+        if (tid < s) {
+            shared[tid] = Op::combine(shared[tid], shared[tid + s]);
+        }
+        threadgroup_barrier(mem_flags::mem_threadgroup);
+    }
+    return shared[0];
+}
+
+// Reduces this thread's share of the partial results in pass 1, then the threadgroup's,
+// and writes either the threadgroup's partial result or the final value
+template <typename Op>
+void reduce_finish(Partial p, device REAL* r, uint offset_r, device Partial* partials, uint n, uint pass,
+                   threadgroup Partial* shared, uint tid, uint group, uint threads) {
+    if (pass & PASS_SECOND) {
+        for (uint i = tid; i < n; i += threads) {
+            p = Op::combine(p, partials[i]);
+        }
+    }
+    p = reduce_group<Op>(p, shared, tid, threads);
+    if (tid == 0) {
+        if ((pass & PASS_SECOND) == 0) {
+            partials[group] = p;
+        } else {
+            r[offset_r] = Op::finish(p);
+        }
+    }
+}
+
+// The elements read by this thread in pass 0, from first to end in steps of step
+struct Slice {
+    uint first;
+    uint end;
+    uint step;
+};
+
+Slice pass_slice(uint n, uint pass, uint tid, uint group, uint threads, uint groups) {
+    if (pass & PASS_FIXED) {
+        uint block = threads * REPRODUCIBLE_ROWS;
+        return {group * block + tid, min(n, (group + 1) * block), threads};
+    }
+    return {group * threads + tid, n, groups * threads};
+}
+
+template <typename Op>
+kernel void reduce_b (const device REAL* x, constant uint& offset_x, constant uint& stride_x,
+                      device REAL* r, constant uint& offset_r, constant uint& stride_r,
+                      device Partial* partials, constant uint& n, constant uint& pass,
+                      threadgroup Partial* shared [[threadgroup(0)]],
+                      uint tid [[thread_index_in_threadgroup]],
+                      uint group [[threadgroup_position_in_grid]],
+                      uint threads [[threads_per_threadgroup]],
+                      uint groups [[threadgroups_per_grid]]) {
+    Partial p = Op::identity();
+    if ((pass & PASS_SECOND) == 0) {
+        Slice slice = pass_slice(n, pass, tid, group, threads, groups);
+        for (uint i = slice.first; i < slice.end; i += slice.step) {
+            p = Op::combine(p, Op::element(x[offset_x + i * stride_x], i));
+        }
+    }
+    reduce_finish<Op>(p, r, offset_r, partials, n, pass, shared, tid, group, threads);
+}
+
+template <typename Op>
+kernel void reduce_bb (const device REAL* x, constant uint& offset_x, constant uint& stride_x,
+                       const device REAL* y, constant uint& offset_y, constant uint& stride_y,
+                       device REAL* r, constant uint& offset_r, constant uint& stride_r,
+                       device Partial* partials, constant uint& n, constant uint& pass,
+                       threadgroup Partial* shared [[threadgroup(0)]],
+                       uint tid [[thread_index_in_threadgroup]],
+                       uint group [[threadgroup_position_in_grid]],
+                       uint threads [[threads_per_threadgroup]],
+                       uint groups [[threadgroups_per_grid]]) {
+    Partial p = Op::identity();
+    if ((pass & PASS_SECOND) == 0) {
+        Slice slice = pass_slice(n, pass, tid, group, threads, groups);
+        for (uint i = slice.first; i < slice.end; i += slice.step) {
+            p = Op::combine(p, Op::pair(x[offset_x + i * stride_x], y[offset_y + i * stride_y], i));
+        }
+    }
+    reduce_finish<Op>(p, r, offset_r, partials, n, pass, shared, tid, group, threads);
+}
+
+#define REDUCE_B(name, Op)                                                                                   \
+template [[host_name(name)]] kernel void reduce_b<Op> (                                                      \
+    const device REAL* x, constant uint& offset_x, constant uint& stride_x,                                  \
+    device REAL* r, constant uint& offset_r, constant uint& stride_r,                                        \
+    device Partial* partials, constant uint& n, constant uint& pass,                                         \
+    threadgroup Partial* shared [[threadgroup(0)]],                                                          \
+    uint tid [[thread_index_in_threadgroup]],                                                                \
+    uint group [[threadgroup_position_in_grid]],                                                             \
+    uint threads [[threads_per_threadgroup]],                                                                \
+    uint groups [[threadgroups_per_grid]]);
+
+#define REDUCE_BB(name, Op)                                                                                  \
+template [[host_name(name)]] kernel void reduce_bb<Op> (                                                     \
+    const device REAL* x, constant uint& offset_x, constant uint& stride_x,                                  \
+    const device REAL* y, constant uint& offset_y, constant uint& stride_y,                                  \
+    device REAL* r, constant uint& offset_r, constant uint& stride_r,                                        \
+    device Partial* partials, constant uint& n, constant uint& pass,                                         \
+    threadgroup Partial* shared [[threadgroup(0)]],                                                          \
+    uint tid [[thread_index_in_threadgroup]],                                                                \
+    uint group [[threadgroup_position_in_grid]],                                                             \
+    uint threads [[threads_per_threadgroup]],                                                                \
+    uint groups [[threadgroups_per_grid]]);
+
+REDUCE_B("vector_sum", Sum)
+REDUCE_B("vector_asum", Asum)
+REDUCE_B("vector_nrm2", Nrm2)
+REDUCE_B("vector_amax", Amax)
+REDUCE_B("vector_iamax", Iamax)
+REDUCE_B("vector_min", Min)
+REDUCE_B("vector_max", Max)
+REDUCE_BB("vector_dot", Dot)
+REDUCE_BB("vector_equals", Equals)
@@ -0,0 +1,246 @@
+#ifndef FERRUM_VECT_MATH_H
+#define FERRUM_VECT_MATH_H
+
+// Helper functions for the vector kernels. These are also compiled in with fused kernels
+// that are generated at runtime, so this must only depend on metal_stdlib.
+
+#include <metal_stdlib>
+using namespace metal;
+
+#ifndef REAL
+#define REAL float
+#endif
+
+#ifndef REAL1o3
+#define REAL1o3 (REAL)0.3333333333333333
+#endif
+
+#ifndef REAL2o3
+#define REAL2o3 (REAL)0.6666666666666667
+#endif
+
+#ifndef REAL3o2
+#define REAL3o2 (REAL)1.5
+#endif
+
+#ifndef REAL1o2
+#define REAL1o2 (REAL)0.5
+#endif
+
+constant REAL M_PI = (REAL)3.1415926535897932384626;
+
+// Approximation of the error function: W. J. Cody, et al.,
+// Mathematics of Computation, v23, Oct 1969 pp. 631-638
+
+constant REAL ERF_A1 = (REAL)0.254829592;
+constant REAL ERF_A2 = (REAL)-0.284496736;
+constant REAL ERF_A3 = (REAL)1.421413741;
+constant REAL ERF_A4 = (REAL)-1.453152027;
+constant REAL ERF_A5 = (REAL)1.061405429;
+constant REAL ERF_P  = (REAL)0.3275911;
+
+inline REAL erf(REAL x) {
+    REAL sgn = (x < 0.0) ? (REAL)-1.0 : (REAL)1.0;
+    x = fabs(x);
+
+    // A&S formula 7.1.26 approximation
+    REAL t = (REAL)1.0 / ((REAL)1.0 + ERF_P * x);
+    REAL y = (((((ERF_A5 * t + ERF_A4) * t) + ERF_A3) * t + ERF_A2) * t + ERF_A1) * t;
+    return sgn * (1.0 - exp(-x * x - y));
+}
+
+inline REAL erfc(REAL x) {
+    return (REAL)1.0 - erf(x);
+}
+
+// Approximation of the inverse error function: J. M. Blair, et al.,
+// Mathematics of Computation, v30, Oct 1976 pp. 827-830
+// https://doi.org/10.2307/2005402
+
+constant REAL EI_A1 = (REAL)-0.0705230784;
+constant REAL EI_A2 = (REAL)0.0422820123;
+constant REAL EI_A3 = (REAL)-0.0092705272;
+constant REAL EI_A4 = (REAL)0.0001520143;
+constant REAL EI_A5 = (REAL)-0.0002765672;
+constant REAL EI_A6 = (REAL)0.0000430638;
+
+inline REAL erfinv(REAL x) {
+    REAL w = log((REAL)1.0 - x * x);
+    REAL p = sqrt(w * (EI_A1 + w * (EI_A2 + w * (EI_A3 + w * (EI_A4 + w * (EI_A5 + w * EI_A6))))));
+    return (x < (REAL)0.0) ? -p : p;
+}
+
+
+constant REAL ECI_A1 = (REAL)-0.140543331;
+constant REAL ECI_A2 = (REAL)0.914624893;
+constant REAL ECI_A3 = (REAL)-1.645349621;
+constant REAL ECI_A4 = (REAL)0.886226899;
+constant REAL ECI_B1 = (REAL)-0.012200287;
+constant REAL ECI_B2 = (REAL)-0.174030709;
+constant REAL ECI_B3 = (REAL)0.325598322;
+constant REAL ECI_B4 = (REAL)0.892459516;
+constant REAL ECI_C0 = (REAL)0.0;
+constant REAL ECI_C1 = (REAL)0.564189583;
+constant REAL ECI_C2 = (REAL)1.211056027;
+constant REAL ECI_C3 = (REAL)1.050750072;
+constant REAL ECI_C4 = (REAL)0.285070173;
+constant REAL ECI_D1 = (REAL)1.011728051;
+constant REAL ECI_D2 = (REAL)1.732339080;
+constant REAL ECI_D3 = (REAL)0.753168411;
+constant REAL ECI_D4 = (REAL)0.081188386;
+
+inline REAL erfcinv(REAL x) {
+    REAL z;
+    if (x <= 0.0) {
+        return INFINITY;
+    } else if (x >= 2.0) {
+        return -INFINITY;
+    } else if (x > 1.0) {
+        z = sqrt(-log((2.0 - x) / 2.0));
+        return (((((ECI_C4 * z + ECI_C3) * z + ECI_C2) * z + ECI_C1) * z + ECI_C0) /
+                ((((ECI_D4 * z + ECI_D3) * z + ECI_D2) * z + ECI_D1) * z + 1.0));
+    } else {
+        z = sqrt(-log(x / 2.0));
+        return -(((((ECI_A4 * z + ECI_A3) * z + ECI_A2) * z + ECI_A1) * z + 0.0) /
+                 ((((ECI_B4 * z + ECI_B3) * z + ECI_B2) * z + ECI_B1) * z + 1.0));
+    }
+}
+
+
+constant REAL CN_A1 = (REAL)0.254829592;
+constant REAL CN_A2 = (REAL)-0.284496736;
+constant REAL CN_A3 = (REAL)1.421413741;
+constant REAL CN_A4 = (REAL)-1.453152027;
+constant REAL CN_A5 = (REAL)1.061405429;
+constant REAL CN_P  = (REAL)0.3275911;
+
+inline REAL normcdf(REAL x) {
+    REAL sgn = (x < 0.0) ? (REAL)-1.0 : (REAL)1.0;
+    x = abs(x) / sqrt((REAL)2.0);
+
+    // A&S formula 7.1.26 approximation
+    REAL t = (REAL)1.0 / ((REAL)1.0 + CN_P * x);
+    REAL y = (((((CN_A5 * t + CN_A4) * t) + CN_A3) * t + CN_A2) * t + CN_A1) * t;
+    return REAL1o2 * ((REAL)1.0 + sgn * ((REAL)1.0 - exp(-x * x - y)));
+}
+
+
+// Approximation of the inverse normal CDF: Peter John Acklam, 2002
+// https://web.archive.org/web/20151030215612/http://home.online.no/~pjacklam/notes/invnorm/
+
+constant REAL CNI_A1 = (REAL)-3.969683028665376e+01;
+constant REAL CNI_A2 = (REAL)2.209460984245205e+02;
+constant REAL CNI_A3 = (REAL)-2.759285104469687e+02;
+constant REAL CNI_A4 = (REAL)1.383577518672690e+02;
+constant REAL CNI_A5 = (REAL)-3.066479806614716e+01;
+constant REAL CNI_A6 = (REAL)2.506628277459239e+00;
+
+constant REAL CNI_B1 = (REAL)-5.447609879822406e+01;
+constant REAL CNI_B2 = (REAL)1.615858368580409e+02;
+constant REAL CNI_B3 = (REAL)-1.556989798598866e+02;
+constant REAL CNI_B4 = (REAL)6.680131188771972e+01;
+constant REAL CNI_B5 = (REAL)-1.328068155288572e+01;
+
+constant REAL CNI_C1 = (REAL)-7.784894002430293e-03;
+constant REAL CNI_C2 = (REAL)-3.223964580411365e-01;
+constant REAL CNI_C3 = (REAL)-2.400758277161838e+00;
+constant REAL CNI_C4 = (REAL)-2.549732539343734e+00;
+constant REAL CNI_C5 = (REAL)4.374664141464968e+00;
+constant REAL CNI_C6 = (REAL)2.938163982698783e+00;
+
+constant REAL CNI_D1 = (REAL)7.784695709041462e-03;
+constant REAL CNI_D2 = (REAL)3.224671290700398e-01;
+constant REAL CNI_D3 = (REAL)2.445134137142996e+00;
+constant REAL CNI_D4 = (REAL)3.754408661907416e+00;
+
+constant REAL X_LOW = (REAL)0.02425;
+constant REAL X_HIGH = (REAL)1.0 - X_LOW;
+
+// A&S formula 26.2.23 approximation
+inline REAL normcdfinv(REAL x) {
+    REAL q, r;
+    if (x < X_LOW) {
+      q = sqrt(-2.0 * log(x));
+      return (((((CNI_C1 * q + CNI_C2) * q + CNI_C3) * q + CNI_C4) * q + CNI_C5) * q + CNI_C6) /
+             ((((CNI_D1 * q + CNI_D2) * q + CNI_D3) * q + CNI_D4) * q + 1.0);
+    } else if (x <= X_HIGH) {
+      q = x - 0.5;
+      r = q * q;
+      return (((((CNI_A1 * r + CNI_A2) * r + CNI_A3) * r + CNI_A4) * r + CNI_A5) * r + CNI_A6) * q /
+             (((((CNI_B1 * r + CNI_B2) * r + CNI_B3) * r + CNI_B4) * r + CNI_B5) * r + 1.0);
+    } else {
+      q = sqrt(-2.0 * log(1.0 - x));
+      return -(((((CNI_C1 * q + CNI_C2) * q + CNI_C3) * q + CNI_C4) * q + CNI_C5) * q + CNI_C6) /
+             ((((CNI_D1 * q + CNI_D2) * q + CNI_D3) * q + CNI_D4) * q + 1.0);
+    }
+}
+
+
+constant REAL g = 7.0;
+constant REAL coefficients[] = {
+    (REAL)0.99999999999980993,  (REAL)676.5203681218851,     (REAL)-1259.1392167224028,
+    (REAL)771.32342877765313,   (REAL)-176.61502916214059,   (REAL)12.507343278686905,
+    (REAL)-0.13857109526572012, (REAL)9.9843695780195716e-6, (REAL)1.5056327351493116e-7
+};
+
+inline REAL tgamma(REAL x) {
+    if (x < 0.5) {
+        return M_PI / (sin(M_PI * x) * tgamma((REAL)1.0 - x));
+    } else {
+        x -= (REAL)1.0;
+        REAL y = coefficients[0];
+        for (int i = 1; i < 9; i++) {
+            y += coefficients[i] / (x + i);
+        }
+        REAL t = x + g + 0.5;
+        return sqrt((REAL)2.0 * M_PI) * pow(t, x + REAL1o2) * exp(-t) * y;
+    }
+}
+
+
+inline REAL lgamma(REAL x) {
+    return log(fabs(tgamma(x)));
+}
+
+
+inline REAL remainder(REAL x, REAL y) {
+    return x - y * round(x / y);
+}
+
+inline REAL hypot(REAL x, REAL y) {
+    return sqrt(x * x + y * y);
+}
+
+inline REAL expm1(REAL x) {
+    if (fabs(x) < (REAL)1e-5) {
+      REAL x2 = x * x;
+      REAL x3 = x2 * x;
+      REAL x4 = x2 * x2;
+      return x + x2 / (REAL)2.0 + x3 / (REAL)6.0 + x4 / (REAL)24.0;
+    } else {
+      return exp(x) - (REAL)1.0;
+    }
+}
+
+inline REAL log1p(REAL x) {
+    if (fabs(x) < (REAL)1e-5) {
+        float x2 = x * x;
+        float x3 = x2 * x;
+        float x4 = x3 * x;
+        return x - x2 / (REAL)2.0 + x3 / (REAL)3.0 - x4 / (REAL)4.0;
+    } else {
+        return log((REAL)1.0 + x);
+    }
+}
+
+// The position of element (i, j) of the triangle of an uplo matrix. A leading dimension of zero
+// means that the triangle is packed column by column, with no room for the other triangle.
+// This must match uploIndex in backend.hpp.
+inline int uplo_index(int i, int j, int ld, int sd, int bottom) {
+    if (ld != 0) {
+        return i + j * ld;
+    }
+    return (bottom > 0) ? i + j * (2 * sd - j - 1) / 2 : i + j * (j + 1) / 2;
+}
+
+#endif // FERRUM_VECT_MATH_H
@@ -1,231 +1,4 @@
-#include <metal_stdlib>
-using namespace metal;
-
-#ifndef REAL
-#define REAL float
-#endif
-
-#ifndef REAL1o3
-#define REAL1o3 (REAL)0.3333333333333333
-#endif
-
-#ifndef REAL2o3
-#define REAL2o3 (REAL)0.6666666666666667
-#endif
-
-#ifndef REAL3o2
-#define REAL3o2 (REAL)1.5
-#endif
-
-#ifndef REAL1o2
-#define REAL1o2 (REAL)0.5
-#endif
-
-constant REAL M_PI = (REAL)3.1415926535897932384626;
-
-// Approximation of the error function: W. J. Cody, et al.,
-// Mathematics of Computation, v23, Oct 1969 pp. 631-638
-
-constant REAL ERF_A1 = (REAL)0.254829592;
-constant REAL ERF_A2 = (REAL)-0.284496736;
-constant REAL ERF_A3 = (REAL)1.421413741;
-constant REAL ERF_A4 = (REAL)-1.453152027;
-constant REAL ERF_A5 = (REAL)1.061405429;
-constant REAL ERF_P  = (REAL)0.3275911;
-
-inline REAL erf(REAL x) {
-    REAL sgn = (x < 0.0) ? (REAL)-1.0 : (REAL)1.0;
-    x = fabs(x);
-
-    // A&S formula 7.1.26 approximation
-    REAL t = (REAL)1.0 / ((REAL)1.0 + ERF_P * x);
-    REAL y = (((((ERF_A5 * t + ERF_A4) * t) + ERF_A3) * t + ERF_A2) * t + ERF_A1) * t;
-    return sgn * (1.0 - exp(-x * x - y));
-}
-
-inline REAL erfc(REAL x) {
-    return (REAL)1.0 - erf(x);
-}
-
-// Approximation of the inverse error function: J. M. Blair, et al.,
-// Mathematics of Computation, v30, Oct 1976 pp. 827-830
-// https://doi.org/10.2307/2005402
-
-constant REAL EI_A1 = (REAL)-0.0705230784;
-constant REAL EI_A2 = (REAL)0.0422820123;
-constant REAL EI_A3 = (REAL)-0.0092705272;
-constant REAL EI_A4 = (REAL)0.0001520143;
-constant REAL EI_A5 = (REAL)-0.0002765672;
-constant REAL EI_A6 = (REAL)0.0000430638;
-
-inline REAL erfinv(REAL x) {
-    REAL w = log((REAL)1.0 - x * x);
-    REAL p = sqrt(w * (EI_A1 + w * (EI_A2 + w * (EI_A3 + w * (EI_A4 + w * (EI_A5 + w * EI_A6))))));
-    return (x < (REAL)0.0) ? -p : p;
-}
-
-
-constant REAL ECI_A1 = (REAL)-0.140543331;
-constant REAL ECI_A2 = (REAL)0.914624893;
-constant REAL ECI_A3 = (REAL)-1.645349621;
-constant REAL ECI_A4 = (REAL)0.886226899;
-constant REAL ECI_B1 = (REAL)-0.012200287;
-constant REAL ECI_B2 = (REAL)-0.174030709;
-constant REAL ECI_B3 = (REAL)0.325598322;
-constant REAL ECI_B4 = (REAL)0.892459516;
-constant REAL ECI_C0 = (REAL)0.0;
-constant REAL ECI_C1 = (REAL)0.564189583;
-constant REAL ECI_C2 = (REAL)1.211056027;
-constant REAL ECI_C3 = (REAL)1.050750072;
-constant REAL ECI_C4 = (REAL)0.285070173;
-constant REAL ECI_D1 = (REAL)1.011728051;
-constant REAL ECI_D2 = (REAL)1.732339080;
-constant REAL ECI_D3 = (REAL)0.753168411;
-constant REAL ECI_D4 = (REAL)0.081188386;
-
-inline REAL erfcinv(REAL x) {
-    REAL z;
-    if (x <= 0.0) {
-        return INFINITY;
-    } else if (x >= 2.0) {
-        return -INFINITY;
-    } else if (x > 1.0) {
-        z = sqrt(-log((2.0 - x) / 2.0));
-        return (((((ECI_C4 * z + ECI_C3) * z + ECI_C2) * z + ECI_C1) * z + ECI_C0) /
-                ((((ECI_D4 * z + ECI_D3) * z + ECI_D2) * z + ECI_D1) * z + 1.0));
-    } else {
-        z = sqrt(-log(x / 2.0));
-        return -(((((ECI_A4 * z + ECI_A3) * z + ECI_A2) * z + ECI_A1) * z + 0.0) /
-                 ((((ECI_B4 * z + ECI_B3) * z + ECI_B2) * z + ECI_B1) * z + 1.0));
-    }
-}
-
-
-constant REAL CN_A1 = (REAL)0.254829592;
-constant REAL CN_A2 = (REAL)-0.284496736;
-constant REAL CN_A3 = (REAL)1.421413741;
-constant REAL CN_A4 = (REAL)-1.453152027;
-constant REAL CN_A5 = (REAL)1.061405429;
-constant REAL CN_P  = (REAL)0.3275911;
-
-inline REAL normcdf(REAL x) {
-    REAL sgn = (x < 0.0) ? (REAL)-1.0 : (REAL)1.0;
-    x = abs(x) / sqrt((REAL)2.0);
-
-    // A&S formula 7.1.26 approximation
-    REAL t = (REAL)1.0 / ((REAL)1.0 + CN_P * x);
-    REAL y = (((((CN_A5 * t + CN_A4) * t) + CN_A3) * t + CN_A2) * t + CN_A1) * t;
-    return REAL1o2 * ((REAL)1.0 + sgn * ((REAL)1.0 - exp(-x * x - y)));
-}
-
-
-// Approximation of the inverse normal CDF: Peter John Acklam, 2002
-// https://web.archive.org/web/20151030215612/http://home.online.no/~pjacklam/notes/invnorm/
-
-constant REAL CNI_A1 = (REAL)-3.969683028665376e+01;
-constant REAL CNI_A2 = (REAL)2.209460984245205e+02;
-constant REAL CNI_A3 = (REAL)-2.759285104469687e+02;
-constant REAL CNI_A4 = (REAL)1.383577518672690e+02;
-constant REAL CNI_A5 = (REAL)-3.066479806614716e+01;
-constant REAL CNI_A6 = (REAL)2.506628277459239e+00;
-
-constant REAL CNI_B1 = (REAL)-5.447609879822406e+01;
-constant REAL CNI_B2 = (REAL)1.615858368580409e+02;
-constant REAL CNI_B3 = (REAL)-1.556989798598866e+02;
-constant REAL CNI_B4 = (REAL)6.680131188771972e+01;
-constant REAL CNI_B5 = (REAL)-1.328068155288572e+01;
-
-constant REAL CNI_C1 = (REAL)-7.784894002430293e-03;
-constant REAL CNI_C2 = (REAL)-3.223964580411365e-01;
-constant REAL CNI_C3 = (REAL)-2.400758277161838e+00;
-constant REAL CNI_C4 = (REAL)-2.549732539343734e+00;
-constant REAL CNI_C5 = (REAL)4.374664141464968e+00;
-constant REAL CNI_C6 = (REAL)2.938163982698783e+00;
-
-constant REAL CNI_D1 = (REAL)7.784695709041462e-03;
-constant REAL CNI_D2 = (REAL)3.224671290700398e-01;
-constant REAL CNI_D3 = (REAL)2.445134137142996e+00;
-constant REAL CNI_D4 = (REAL)3.754408661907416e+00;
-
-constant REAL X_LOW = (REAL)0.02425;
-constant REAL X_HIGH = (REAL)1.0 - X_LOW;
-
-// A&S formula 26.2.23 approximation
-inline REAL normcdfinv(REAL x) {
-    REAL q, r;
-    if (x < X_LOW) {
-      q = sqrt(-2.0 * log(x));
-      return (((((CNI_C1 * q + CNI_C2) * q + CNI_C3) * q + CNI_C4) * q + CNI_C5) * q + CNI_C6) /
-             ((((CNI_D1 * q + CNI_D2) * q + CNI_D3) * q + CNI_D4) * q + 1.0);
-    } else if (x <= X_HIGH) {
-      q = x - 0.5;
-      r = q * q;
-      return (((((CNI_A1 * r + CNI_A2) * r + CNI_A3) * r + CNI_A4) * r + CNI_A5) * r + CNI_A6) * q /
-             (((((CNI_B1 * r + CNI_B2) * r + CNI_B3) * r + CNI_B4) * r + CNI_B5) * r + 1.0);
-    } else {
-      q = sqrt(-2.0 * log(1.0 - x));
-      return -(((((CNI_C1 * q + CNI_C2) * q + CNI_C3) * q + CNI_C4) * q + CNI_C5) * q + CNI_C6) /
-             ((((CNI_D1 * q + CNI_D2) * q + CNI_D3) * q + CNI_D4) * q + 1.0);
-    }
-}
-
-
-constant REAL g = 7.0;
-constant REAL coefficients[] = {
-    (REAL)0.99999999999980993,  (REAL)676.5203681218851,     (REAL)-1259.1392167224028,
-    (REAL)771.32342877765313,   (REAL)-176.61502916214059,   (REAL)12.507343278686905,
-    (REAL)-0.13857109526572012, (REAL)9.9843695780195716e-6, (REAL)1.5056327351493116e-7
-};
-
-inline REAL tgamma(REAL x) {
-    if (x < 0.5) {
-        return M_PI / (sin(M_PI * x) * tgamma((REAL)1.0 - x));
-    } else {
-        x -= (REAL)1.0;
-        REAL y = coefficients[0];
-        for (int i = 1; i < 9; i++) {
-            y += coefficients[i] / (x + i);
-        }
-        REAL t = x + g + 0.5;
-        return sqrt((REAL)2.0 * M_PI) * pow(t, x + REAL1o2) * exp(-t) * y;
-    }
-}
-
-
-inline REAL lgamma(REAL x) {
-    return log(fabs(tgamma(x)));
-}
-
-
-inline REAL remainder(REAL x, REAL y) {
-    return x - y * round(x / y);
-}
-
-inline REAL hypot(REAL x, REAL y) {
-    return sqrt(x * x + y * y);
-}
-
-inline REAL expm1(REAL x) {
-    if (fabs(x) < (REAL)1e-5) {
-      REAL x2 = x * x;
-      REAL x3 = x2 * x;
-      REAL x4 = x2 * x2;
-      return x + x2 / (REAL)2.0 + x3 / (REAL)6.0 + x4 / (REAL)24.0;
-    } else {
-      return exp(x) - (REAL)1.0;
-    }
-}
-
-inline REAL log1p(REAL x) {
-    if (fabs(x) < (REAL)1e-5) {
-        float x2 = x * x;
-        float x3 = x2 * x;
-        float x4 = x3 * x;
-        return x - x2 / (REAL)2.0 + x3 / (REAL)3.0 - x4 / (REAL)4.0;
-    } else {
-        return log((REAL)1.0 + x);
-    }
-}
+#include "vect-math.h"
 
 //////////////////////////////////////////
 // Implementations of the vector functions
@@ -1661,9 +1434,25 @@ kernel void ge_elu (constant int& sd [[buffer(0)]], constant int& fd [[buffer(1)
 ///////////////////////////////////////////////////////////////////
 // Implementations of the uplo matrix functions
 // As these get more complex, annotating parameters to ensure order
+// A leading dimension of zero is a packed triangle (see uplo_index)
 ///////////////////////////////////////////////////////////////////
 
 
+// Copies the triangle, which packs it when only b is packed and unpacks it when only a is
+kernel void uplo_copy (constant int& sd [[buffer(0)]], constant int& unit [[buffer(1)]], constant int& bottom [[buffer(2)]],
+                       const device REAL* a [[buffer(3)]], constant int& offset_a [[buffer(4)]], constant int& ld_a [[buffer(5)]],
+                       device REAL* b [[buffer(6)]], constant int& offset_b [[buffer(7)]], constant int& ld_b [[buffer(8)]],
+                       uint2 id [[thread_position_in_grid]]) {
+    int gid_0 = id.x;
+    int gid_1 = id.y;
+    if (gid_0 < sd && gid_1 < sd) {
+        if ((unit == 132) ? bottom * gid_0 > bottom * gid_1 : bottom * gid_0 >= bottom * gid_1) {
+            b[offset_b + uplo_index(gid_0, gid_1, ld_b, sd, bottom)] = a[offset_a + uplo_index(gid_0, gid_1, ld_a, sd, bottom)];
+        }
+    }
+}
+
+
 kernel void uplo_sqr (constant int& sd [[buffer(0)]], constant int& unit [[buffer(1)]], constant int& bottom [[buffer(2)]],
                       const device REAL* a [[buffer(3)]], constant int& offset_a [[buffer(4)]], constant int& ld_a [[buffer(5)]],
                       device REAL* b [[buffer(6)]], constant int& offset_b [[buffer(7)]], constant int& ld_b [[buffer(8)]],
@@ -1672,8 +1461,8 @@ kernel void uplo_sqr (constant int& sd [[buffer(0)]], constant int& unit [[buffe
     int gid_1 = id.y;
     if (gid_0 < sd && gid_1 < sd) {
         if ((unit == 132) ? bottom * gid_0 > bottom * gid_1 : bottom * gid_0 >= bottom * gid_1) {
-            REAL aval = a[offset_a + gid_0 + gid_1 * ld_a];
-            b[offset_b + gid_0 + gid_1 * ld_b] = aval * aval;
+            REAL aval = a[offset_a + uplo_index(gid_0, gid_1, ld_a, sd, bottom)];
+            b[offset_b + uplo_index(gid_0, gid_1, ld_b, sd, bottom)] = aval * aval;
         }
     }
 }
@@ -1688,7 +1477,7 @@ kernel void uplo_mul (constant int& sd [[buffer(0)]], constant int& unit [[buffe
     int gid_1 = id.y;
     if (gid_0 < sd && gid_1 < sd) {
         if ((unit == 132) ? bottom * gid_0 > bottom * gid_1 : bottom * gid_0 >= bottom * gid_1) {
-            c[offset_c + gid_0 + gid_1 * ld_c] = a[offset_a + gid_0 + gid_1 * ld_a] * b[offset_b + gid_0 + gid_1 * ld_b];
+            c[offset_c + uplo_index(gid_0, gid_1, ld_c, sd, bottom)] = a[offset_a + uplo_index(gid_0, gid_1, ld_a, sd, bottom)] * b[offset_b + uplo_index(gid_0, gid_1, ld_b, sd, bottom)];
         }
     }
 }
@@ -1703,7 +1492,7 @@ kernel void uplo_div (constant int& sd [[buffer(0)]], constant int& unit [[buffe
     int gid_1 = id.y;
     if (gid_0 < sd && gid_1 < sd) {
         if ((unit == 132) ? bottom * gid_0 > bottom * gid_1 : bottom * gid_0 >= bottom * gid_1) {
-            c[offset_c + gid_0 + gid_1 * ld_c] = a[offset_a + gid_0 + gid_1 * ld_a] / b[offset_b + gid_0 + gid_1 * ld_b];
+            c[offset_c + uplo_index(gid_0, gid_1, ld_c, sd, bottom)] = a[offset_a + uplo_index(gid_0, gid_1, ld_a, sd, bottom)] / b[offset_b + uplo_index(gid_0, gid_1, ld_b, sd, bottom)];
         }
     }
 }
@@ -1718,7 +1507,7 @@ kernel void uplo_add (constant int& sd [[buffer(0)]], constant int& unit [[buffe
     int gid_1 = id.y;
     if (gid_0 < sd && gid_1 < sd) {
         if ((unit == 132) ? bottom * gid_0 > bottom * gid_1 : bottom * gid_0 >= bottom * gid_1) {
-            c[offset_c + gid_0 + gid_1 * ld_c] = a[offset_a + gid_0 + gid_1 * ld_a] + b[offset_b + gid_0 + gid_1 * ld_b];
+            c[offset_c + uplo_index(gid_0, gid_1, ld_c, sd, bottom)] = a[offset_a + uplo_index(gid_0, gid_1, ld_a, sd, bottom)] + b[offset_b + uplo_index(gid_0, gid_1, ld_b, sd, bottom)];
         }
     }
 }
@@ -1733,7 +1522,7 @@ kernel void uplo_sub (constant int& sd [[buffer(0)]], constant int& unit [[buffe
     int gid_1 = id.y;
     if (gid_0 < sd && gid_1 < sd) {
         if ((unit == 132) ? bottom * gid_0 > bottom * gid_1 : bottom * gid_0 >= bottom * gid_1) {
-            c[offset_c + gid_0 + gid_1 * ld_c] = a[offset_a + gid_0 + gid_1 * ld_a] - b[offset_b + gid_0 + gid_1 * ld_b];
+            c[offset_c + uplo_index(gid_0, gid_1, ld_c, sd, bottom)] = a[offset_a + uplo_index(gid_0, gid_1, ld_a, sd, bottom)] - b[offset_b + uplo_index(gid_0, gid_1, ld_b, sd, bottom)];
         }
     }
 }
@@ -1747,7 +1536,7 @@ kernel void uplo_inv (constant int& sd [[buffer(0)]], constant int& unit [[buffe
     int gid_1 = id.y;
     if (gid_0 < sd && gid_1 < sd) {
         if ((unit == 132) ? bottom * gid_0 > bottom * gid_1 : bottom * gid_0 >= bottom * gid_1) {
-            b[offset_b + gid_0 + gid_1 * ld_b] = (REAL)1.0 / a[offset_a + gid_0 + gid_1 * ld_a];
+            b[offset_b + uplo_index(gid_0, gid_1, ld_b, sd, bottom)] = (REAL)1.0 / a[offset_a + uplo_index(gid_0, gid_1, ld_a, sd, bottom)];
         }
     }
 }
@@ -1761,7 +1550,7 @@ kernel void uplo_abs (constant int& sd [[buffer(0)]], constant int& unit [[buffe
     int gid_1 = id.y;
     if (gid_0 < sd && gid_1 < sd) {
         if ((unit == 132) ? bottom * gid_0 > bottom * gid_1 : bottom * gid_0 >= bottom * gid_1) {
-            b[offset_b + gid_0 + gid_1 * ld_b] = fabs(a[offset_a + gid_0 + gid_1 * ld_a]);
+            b[offset_b + uplo_index(gid_0, gid_1, ld_b, sd, bottom)] = fabs(a[offset_a + uplo_index(gid_0, gid_1, ld_a, sd, bottom)]);
         }
     }
 }
@@ -1778,9 +1567,9 @@ kernel void uplo_linear_frac (constant int& sd [[buffer(0)]], constant int& unit
     int gid_1 = id.y;
     if (gid_0 < sd && gid_1 < sd) {
         if ((unit == 132) ? bottom * gid_0 > bottom * gid_1 : bottom * gid_0 >= bottom * gid_1) {
-            c[offset_c + gid_0 + gid_1 * ld_c] =
-                (scalea * a[offset_a + gid_0 + gid_1 * ld_a] + shifta) /
-                (scaleb * b[offset_b + gid_0 + gid_1 * ld_b] + shiftb);
+            c[offset_c + uplo_index(gid_0, gid_1, ld_c, sd, bottom)] =
+                (scalea * a[offset_a + uplo_index(gid_0, gid_1, ld_a, sd, bottom)] + shifta) /
+                (scaleb * b[offset_b + uplo_index(gid_0, gid_1, ld_b, sd, bottom)] + shiftb);
         }
     }
 }
@@ -1796,7 +1585,7 @@ kernel void uplo_scale_shift (constant int& sd [[buffer(0)]], constant int& unit
     int gid_1 = id.y;
     if (gid_0 < sd && gid_1 < sd) {
         if ((unit == 132) ? bottom * gid_0 > bottom * gid_1 : bottom * gid_0 >= bottom * gid_1) {
-            c[offset_c + gid_0 + gid_1 * ld_c] = scalea * a[offset_a + gid_0 + gid_1 * ld_a] + shifta;
+            c[offset_c + uplo_index(gid_0, gid_1, ld_c, sd, bottom)] = scalea * a[offset_a + uplo_index(gid_0, gid_1, ld_a, sd, bottom)] + shifta;
         }
     }
 }
@@ -1811,7 +1600,7 @@ kernel void uplo_fmod (constant int& sd [[buffer(0)]], constant int& unit [[buff
     int gid_1 = id.y;
     if (gid_0 < sd && gid_1 < sd) {
         if ((unit == 132) ? bottom * gid_0 > bottom * gid_1 : bottom * gid_0 >= bottom * gid_1) {
-            c[offset_c + gid_0 + gid_1 * ld_c] = fmod(a[offset_a + gid_0 + gid_1 * ld_a], b[offset_b + gid_0 + gid_1 * ld_b]);
+            c[offset_c + uplo_index(gid_0, gid_1, ld_c, sd, bottom)] = fmod(a[offset_a + uplo_index(gid_0, gid_1, ld_a, sd, bottom)], b[offset_b + uplo_index(gid_0, gid_1, ld_b, sd, bottom)]);
         }
     }
 }
@@ -1826,7 +1615,7 @@ kernel void uplo_frem (constant int& sd [[buffer(0)]], constant int& unit [[buff
     int gid_1 = id.y;
     if (gid_0 < sd && gid_1 < sd) {
         if ((unit == 132) ? bottom * gid_0 > bottom * gid_1 : bottom * gid_0 >= bottom * gid_1) {
-            c[offset_c + gid_0 + gid_1 * ld_c] = remainder(a[offset_a + gid_0 + gid_1 * ld_a], b[offset_b + gid_0 + gid_1 * ld_b]);
+            c[offset_c + uplo_index(gid_0, gid_1, ld_c, sd, bottom)] = remainder(a[offset_a + uplo_index(gid_0, gid_1, ld_a, sd, bottom)], b[offset_b + uplo_index(gid_0, gid_1, ld_b, sd, bottom)]);
         }
     }
 }
@@ -1840,7 +1629,7 @@ kernel void uplo_sqrt (constant int& sd [[buffer(0)]], constant int& unit [[buff
     int gid_1 = id.y;
     if (gid_0 < sd && gid_1 < sd) {
         if ((unit == 132) ? bottom * gid_0 > bottom * gid_1 : bottom * gid_0 >= bottom * gid_1) {
-            b[offset_b + gid_0 + gid_1 * ld_b] = sqrt(a[offset_a + gid_0 + gid_1 * ld_a]);
+            b[offset_b + uplo_index(gid_0, gid_1, ld_b, sd, bottom)] = sqrt(a[offset_a + uplo_index(gid_0, gid_1, ld_a, sd, bottom)]);
         }
     }
 }
@@ -1854,7 +1643,7 @@ kernel void uplo_inv_sqrt (constant int& sd [[buffer(0)]], constant int& unit [[
     int gid_1 = id.y;
     if (gid_0 < sd && gid_1 < sd) {
         if ((unit == 132) ? bottom * gid_0 > bottom * gid_1 : bottom * gid_0 >= bottom * gid_1) {
-            b[offset_b + gid_0 + gid_1 * ld_b] = rsqrt(a[offset_a + gid_0 + gid_1 * ld_a]);
+            b[offset_b + uplo_index(gid_0, gid_1, ld_b, sd, bottom)] = rsqrt(a[offset_a + uplo_index(gid_0, gid_1, ld_a, sd, bottom)]);
         }
     }
 }
@@ -1868,7 +1657,7 @@ kernel void uplo_cbrt (constant int& sd [[buffer(0)]], constant int& unit [[buff
     int gid_1 = id.y;
     if (gid_0 < sd && gid_1 < sd) {
         if ((unit == 132) ? bottom * gid_0 > bottom * gid_1 : bottom * gid_0 >= bottom * gid_1) {
-            b[offset_b + gid_0 + gid_1 * ld_b] = pow(a[offset_a + gid_0 + gid_1 * ld_a], REAL1o3);
+            b[offset_b + uplo_index(gid_0, gid_1, ld_b, sd, bottom)] = pow(a[offset_a + uplo_index(gid_0, gid_1, ld_a, sd, bottom)], REAL1o3);
         }
     }
 }
@@ -1882,7 +1671,7 @@ kernel void uplo_inv_cbrt (constant int& sd [[buffer(0)]], constant int& unit [[
     int gid_1 = id.y;
     if (gid_0 < sd && gid_1 < sd) {
         if ((unit == 132) ? bottom * gid_0 > bottom * gid_1 : bottom * gid_0 >= bottom * gid_1) {
-            b[offset_b + gid_0 + gid_1 * ld_b] = (REAL)1.0 / pow(a[offset_a + gid_0 + gid_1 * ld_a], REAL1o3);
+            b[offset_b + uplo_index(gid_0, gid_1, ld_b, sd, bottom)] = (REAL)1.0 / pow(a[offset_a + uplo_index(gid_0, gid_1, ld_a, sd, bottom)], REAL1o3);
         }
     }
 }
@@ -1896,7 +1685,7 @@ kernel void uplo_pow2o3 (constant int& sd [[buffer(0)]], constant int& unit [[bu
     int gid_1 = id.y;
     if (gid_0 < sd && gid_1 < sd) {
         if ((unit == 132) ? bottom * gid_0 > bottom * gid_1 : bottom * gid_0 >= bottom * gid_1) {
-            b[offset_b + gid_0 + gid_1 * ld_b] = pow(a[offset_a + gid_0 + gid_1 * ld_a], REAL2o3);
+            b[offset_b + uplo_index(gid_0, gid_1, ld_b, sd, bottom)] = pow(a[offset_a + uplo_index(gid_0, gid_1, ld_a, sd, bottom)], REAL2o3);
         }
     }
 }
@@ -1910,7 +1699,7 @@ kernel void uplo_pow3o2 (constant int& sd [[buffer(0)]], constant int& unit [[bu
     int gid_1 = id.y;
     if (gid_0 < sd && gid_1 < sd) {
         if ((unit == 132) ? bottom * gid_0 > bottom * gid_1 : bottom * gid_0 >= bottom * gid_1) {
-            b[offset_b + gid_0 + gid_1 * ld_b] = pow(a[offset_a + gid_0 + gid_1 * ld_a], REAL3o2);
+            b[offset_b + uplo_index(gid_0, gid_1, ld_b, sd, bottom)] = pow(a[offset_a + uplo_index(gid_0, gid_1, ld_a, sd, bottom)], REAL3o2);
         }
     }
 }
@@ -1925,7 +1714,7 @@ kernel void uplo_pow (constant int& sd [[buffer(0)]], constant int& unit [[buffe
     int gid_1 = id.y;
     if (gid_0 < sd && gid_1 < sd) {
         if ((unit == 132) ? bottom * gid_0 > bottom * gid_1 : bottom * gid_0 >= bottom * gid_1) {
-            c[offset_c + gid_0 + gid_1 * ld_c] = pow(a[offset_a + gid_0 + gid_1 * ld_a], b[offset_b + gid_0 + gid_1 * ld_b]);
+            c[offset_c + uplo_index(gid_0, gid_1, ld_c, sd, bottom)] = pow(a[offset_a + uplo_index(gid_0, gid_1, ld_a, sd, bottom)], b[offset_b + uplo_index(gid_0, gid_1, ld_b, sd, bottom)]);
         }
     }
 }
@@ -1940,7 +1729,7 @@ kernel void uplo_powx (constant int& sd [[buffer(0)]], constant int& unit [[buff
     int gid_1 = id.y;
     if (gid_0 < sd && gid_1 < sd) {
         if ((unit == 132) ? bottom * gid_0 > bottom * gid_1 : bottom * gid_0 >= bottom * gid_1) {
-            c[offset_c + gid_0 + gid_1 * ld_c] = pow(a[offset_a + gid_0 + gid_1 * ld_a], b);
+            c[offset_c + uplo_index(gid_0, gid_1, ld_c, sd, bottom)] = pow(a[offset_a + uplo_index(gid_0, gid_1, ld_a, sd, bottom)], b);
         }
     }
 }
@@ -1955,7 +1744,7 @@ kernel void uplo_hypot (constant int& sd [[buffer(0)]], constant int& unit [[buf
     int gid_1 = id.y;
     if (gid_0 < sd && gid_1 < sd) {
         if ((unit == 132) ? bottom * gid_0 > bottom * gid_1 : bottom * gid_0 >= bottom * gid_1) {
-            c[offset_c + gid_0 + gid_1 * ld_c] = hypot(a[offset_a + gid_0 + gid_1 * ld_a], b[offset_b + gid_0 + gid_1 * ld_b]);
+            c[offset_c + uplo_index(gid_0, gid_1, ld_c, sd, bottom)] = hypot(a[offset_a + uplo_index(gid_0, gid_1, ld_a, sd, bottom)], b[offset_b + uplo_index(gid_0, gid_1, ld_b, sd, bottom)]);
         }
     }
 }
@@ -1969,7 +1758,7 @@ kernel void uplo_exp (constant int& sd [[buffer(0)]], constant int& unit [[buffe
     int gid_1 = id.y;
     if (gid_0 < sd && gid_1 < sd) {
         if ((unit == 132) ? bottom * gid_0 > bottom * gid_1 : bottom * gid_0 >= bottom * gid_1) {
-            b[offset_b + gid_0 + gid_1 * ld_b] = exp(a[offset_a + gid_0 + gid_1 * ld_a]);
+            b[offset_b + uplo_index(gid_0, gid_1, ld_b, sd, bottom)] = exp(a[offset_a + uplo_index(gid_0, gid_1, ld_a, sd, bottom)]);
         }
     }
 }
@@ -1983,7 +1772,7 @@ kernel void uplo_exp2 (constant int& sd [[buffer(0)]], constant int& unit [[buff
     int gid_1 = id.y;
     if (gid_0 < sd && gid_1 < sd) {
         if ((unit == 132) ? bottom * gid_0 > bottom * gid_1 : bottom * gid_0 >= bottom * gid_1) {
-            b[offset_b + gid_0 + gid_1 * ld_b] = exp2(a[offset_a + gid_0 + gid_1 * ld_a]);
+            b[offset_b + uplo_index(gid_0, gid_1, ld_b, sd, bottom)] = exp2(a[offset_a + uplo_index(gid_0, gid_1, ld_a, sd, bottom)]);
         }
     }
 }
@@ -1997,7 +1786,7 @@ kernel void uplo_exp10 (constant int& sd [[buffer(0)]], constant int& unit [[buf
     int gid_1 = id.y;
     if (gid_0 < sd && gid_1 < sd) {
         if ((unit == 132) ? bottom * gid_0 > bottom * gid_1 : bottom * gid_0 >= bottom * gid_1) {
-            b[offset_b + gid_0 + gid_1 * ld_b] = exp10(a[offset_a + gid_0 + gid_1 * ld_a]);
+            b[offset_b + uplo_index(gid_0, gid_1, ld_b, sd, bottom)] = exp10(a[offset_a + uplo_index(gid_0, gid_1, ld_a, sd, bottom)]);
         }
     }
 }
@@ -2011,7 +1800,7 @@ kernel void uplo_expm1 (constant int& sd [[buffer(0)]], constant int& unit [[buf
     int gid_1 = id.y;
     if (gid_0 < sd && gid_1 < sd) {
         if ((unit == 132) ? bottom * gid_0 > bottom * gid_1 : bottom * gid_0 >= bottom * gid_1) {
-            b[offset_b + gid_0 + gid_1 * ld_b] = expm1(a[offset_a + gid_0 + gid_1 * ld_a]);
+            b[offset_b + uplo_index(gid_0, gid_1, ld_b, sd, bottom)] = expm1(a[offset_a + uplo_index(gid_0, gid_1, ld_a, sd, bottom)]);
         }
     }
 }
@@ -2025,7 +1814,7 @@ kernel void uplo_log (constant int& sd [[buffer(0)]], constant int& unit [[buffe
     int gid_1 = id.y;
     if (gid_0 < sd && gid_1 < sd) {
         if ((unit == 132) ? bottom * gid_0 > bottom * gid_1 : bottom * gid_0 >= bottom * gid_1) {
-            b[offset_b + gid_0 + gid_1 * ld_b] = log(a[offset_a + gid_0 + gid_1 * ld_a]);
+            b[offset_b + uplo_index(gid_0, gid_1, ld_b, sd, bottom)] = log(a[offset_a + uplo_index(gid_0, gid_1, ld_a, sd, bottom)]);
         }
     }
 }
@@ -2039,7 +1828,7 @@ kernel void uplo_log2 (constant int& sd [[buffer(0)]], constant int& unit [[buff
     int gid_1 = id.y;
     if (gid_0 < sd && gid_1 < sd) {
         if ((unit == 132) ? bottom * gid_0 > bottom * gid_1 : bottom * gid_0 >= bottom * gid_1) {
-            b[offset_b + gid_0 + gid_1 * ld_b] = log2(a[offset_a + gid_0 + gid_1 * ld_a]);
+            b[offset_b + uplo_index(gid_0, gid_1, ld_b, sd, bottom)] = log2(a[offset_a + uplo_index(gid_0, gid_1, ld_a, sd, bottom)]);
         }
     }
 }
@@ -2053,7 +1842,7 @@ kernel void uplo_log10 (constant int& sd [[buffer(0)]], constant int& unit [[buf
     int gid_1 = id.y;
     if (gid_0 < sd && gid_1 < sd) {
         if ((unit == 132) ? bottom * gid_0 > bottom * gid_1 : bottom * gid_0 >= bottom * gid_1) {
-            b[offset_b + gid_0 + gid_1 * ld_b] = log10(a[offset_a + gid_0 + gid_1 * ld_a]);
+            b[offset_b + uplo_index(gid_0, gid_1, ld_b, sd, bottom)] = log10(a[offset_a + uplo_index(gid_0, gid_1, ld_a, sd, bottom)]);
         }
     }
 }
@@ -2067,7 +1856,7 @@ kernel void uplo_log1p (constant int& sd [[buffer(0)]], constant int& unit [[buf
     int gid_1 = id.y;
     if (gid_0 < sd && gid_1 < sd) {
         if ((unit == 132) ? bottom * gid_0 > bottom * gid_1 : bottom * gid_0 >= bottom * gid_1) {
-            b[offset_b + gid_0 + gid_1 * ld_b] = log1p(a[offset_a + gid_0 + gid_1 * ld_a]);
+            b[offset_b + uplo_index(gid_0, gid_1, ld_b, sd, bottom)] = log1p(a[offset_a + uplo_index(gid_0, gid_1, ld_a, sd, bottom)]);
         }
     }
 }
@@ -2081,7 +1870,7 @@ kernel void uplo_sin (constant int& sd [[buffer(0)]], constant int& unit [[buffe
     int gid_1 = id.y;
     if (gid_0 < sd && gid_1 < sd) {
         if ((unit == 132) ? bottom * gid_0 > bottom * gid_1 : bottom * gid_0 >= bottom * gid_1) {
-            b[offset_b + gid_0 + gid_1 * ld_b] = sin(a[offset_a + gid_0 + gid_1 * ld_a]);
+            b[offset_b + uplo_index(gid_0, gid_1, ld_b, sd, bottom)] = sin(a[offset_a + uplo_index(gid_0, gid_1, ld_a, sd, bottom)]);
         }
     }
 }
@@ -2095,7 +1884,7 @@ kernel void uplo_cos (constant int& sd [[buffer(0)]], constant int& unit [[buffe
     int gid_1 = id.y;
     if (gid_0 < sd && gid_1 < sd) {
         if ((unit == 132) ? bottom * gid_0 > bottom * gid_1 : bottom * gid_0 >= bottom * gid_1) {
-            b[offset_b + gid_0 + gid_1 * ld_b] = cos(a[offset_a + gid_0 + gid_1 * ld_a]);
+            b[offset_b + uplo_index(gid_0, gid_1, ld_b, sd, bottom)] = cos(a[offset_a + uplo_index(gid_0, gid_1, ld_a, sd, bottom)]);
         }
     }
 }
@@ -2109,7 +1898,7 @@ kernel void uplo_tan (constant int& sd [[buffer(0)]], constant int& unit [[buffe
     int gid_1 = id.y;
     if (gid_0 < sd && gid_1 < sd) {
         if ((unit == 132) ? bottom * gid_0 > bottom * gid_1 : bottom * gid_0 >= bottom * gid_1) {
-            b[offset_b + gid_0 + gid_1 * ld_b] = tan(a[offset_a + gid_0 + gid_1 * ld_a]);
+            b[offset_b + uplo_index(gid_0, gid_1, ld_b, sd, bottom)] = tan(a[offset_a + uplo_index(gid_0, gid_1, ld_a, sd, bottom)]);
         }
     }
 }
@@ -2124,9 +1913,9 @@ kernel void uplo_sincos (constant int& sd [[buffer(0)]], constant int& unit [[bu
     int gid_1 = id.y;
     if (gid_0 < sd && gid_1 < sd) {
         if ((unit == 132) ? bottom * gid_0 > bottom * gid_1 : bottom * gid_0 >= bottom * gid_1) {
-            REAL aval = a[offset_a + gid_0 + gid_1 * ld_a];
-            b[offset_b + gid_0 + gid_1 * ld_b] = sin(aval);
-            c[offset_c + gid_0 + gid_1 * ld_c] = cos(aval);
+            REAL aval = a[offset_a + uplo_index(gid_0, gid_1, ld_a, sd, bottom)];
+            b[offset_b + uplo_index(gid_0, gid_1, ld_b, sd, bottom)] = sin(aval);
+            c[offset_c + uplo_index(gid_0, gid_1, ld_c, sd, bottom)] = cos(aval);
         }
     }
 }
@@ -2140,7 +1929,7 @@ kernel void uplo_asin (constant int& sd [[buffer(0)]], constant int& unit [[buff
     int gid_1 = id.y;
     if (gid_0 < sd && gid_1 < sd) {
         if ((unit == 132) ? bottom * gid_0 > bottom * gid_1 : bottom * gid_0 >= bottom * gid_1) {
-            b[offset_b + gid_0 + gid_1 * ld_b] = asin(a[offset_a + gid_0 + gid_1 * ld_a]);
+            b[offset_b + uplo_index(gid_0, gid_1, ld_b, sd, bottom)] = asin(a[offset_a + uplo_index(gid_0, gid_1, ld_a, sd, bottom)]);
         }
     }
 }
@@ -2154,7 +1943,7 @@ kernel void uplo_acos (constant int& sd [[buffer(0)]], constant int& unit [[buff
     int gid_1 = id.y;
     if (gid_0 < sd && gid_1 < sd) {
         if ((unit == 132) ? bottom * gid_0 > bottom * gid_1 : bottom * gid_0 >= bottom * gid_1) {
-            b[offset_b + gid_0 + gid_1 * ld_b] = acos(a[offset_a + gid_0 + gid_1 * ld_a]);
+            b[offset_b + uplo_index(gid_0, gid_1, ld_b, sd, bottom)] = acos(a[offset_a + uplo_index(gid_0, gid_1, ld_a, sd, bottom)]);
         }
     }
 }
@@ -2168,7 +1957,7 @@ kernel void uplo_atan (constant int& sd [[buffer(0)]], constant int& unit [[buff
     int gid_1 = id.y;
     if (gid_0 < sd && gid_1 < sd) {
         if ((unit == 132) ? bottom * gid_0 > bottom * gid_1 : bottom * gid_0 >= bottom * gid_1) {
-            b[offset_b + gid_0 + gid_1 * ld_b] = atan(a[offset_a + gid_0 + gid_1 * ld_a]);
+            b[offset_b + uplo_index(gid_0, gid_1, ld_b, sd, bottom)] = atan(a[offset_a + uplo_index(gid_0, gid_1, ld_a, sd, bottom)]);
         }
     }
 }
@@ -2183,7 +1972,7 @@ kernel void uplo_atan2 (constant int& sd [[buffer(0)]], constant int& unit [[buf
     int gid_1 = id.y;
     if (gid_0 < sd && gid_1 < sd) {
         if ((unit == 132) ? bottom * gid_0 > bottom * gid_1 : bottom * gid_0 >= bottom * gid_1) {
-            c[offset_c + gid_0 + gid_1 * ld_c] = atan2(a[offset_a + gid_0 + gid_1 * ld_a], b[offset_b + gid_0 + gid_1 * ld_b]);
+            c[offset_c + uplo_index(gid_0, gid_1, ld_c, sd, bottom)] = atan2(a[offset_a + uplo_index(gid_0, gid_1, ld_a, sd, bottom)], b[offset_b + uplo_index(gid_0, gid_1, ld_b, sd, bottom)]);
         }
     }
 }
@@ -2197,7 +1986,7 @@ kernel void uplo_sinh (constant int& sd [[buffer(0)]], constant int& unit [[buff
     int gid_1 = id.y;
     if (gid_0 < sd && gid_1 < sd) {
         if ((unit == 132) ? bottom * gid_0 > bottom * gid_1 : bottom * gid_0 >= bottom * gid_1) {
-            b[offset_b + gid_0 + gid_1 * ld_b] = sinh(a[offset_a + gid_0 + gid_1 * ld_a]);
+            b[offset_b + uplo_index(gid_0, gid_1, ld_b, sd, bottom)] = sinh(a[offset_a + uplo_index(gid_0, gid_1, ld_a, sd, bottom)]);
         }
     }
 }
@@ -2211,7 +2000,7 @@ kernel void uplo_cosh (constant int& sd [[buffer(0)]], constant int& unit [[buff
     int gid_1 = id.y;
     if (gid_0 < sd && gid_1 < sd) {
         if ((unit == 132) ? bottom * gid_0 > bottom * gid_1 : bottom * gid_0 >= bottom * gid_1) {
-            b[offset_b + gid_0 + gid_1 * ld_b] = cosh(a[offset_a + gid_0 + gid_1 * ld_a]);
+            b[offset_b + uplo_index(gid_0, gid_1, ld_b, sd, bottom)] = cosh(a[offset_a + uplo_index(gid_0, gid_1, ld_a, sd, bottom)]);
         }
     }
 }
@@ -2225,7 +2014,7 @@ kernel void uplo_tanh (constant int& sd [[buffer(0)]], constant int& unit [[buff
     int gid_1 = id.y;
     if (gid_0 < sd && gid_1 < sd) {
         if ((unit == 132) ? bottom * gid_0 > bottom * gid_1 : bottom * gid_0 >= bottom * gid_1) {
-            b[offset_b + gid_0 + gid_1 * ld_b] = tanh(a[offset_a + gid_0 + gid_1 * ld_a]);
+            b[offset_b + uplo_index(gid_0, gid_1, ld_b, sd, bottom)] = tanh(a[offset_a + uplo_index(gid_0, gid_1, ld_a, sd, bottom)]);
         }
     }
 }
@@ -2239,7 +2028,7 @@ kernel void uplo_asinh (constant int& sd [[buffer(0)]], constant int& unit [[buf
     int gid_1 = id.y;
     if (gid_0 < sd && gid_1 < sd) {
         if ((unit == 132) ? bottom * gid_0 > bottom * gid_1 : bottom * gid_0 >= bottom * gid_1) {
-            b[offset_b + gid_0 + gid_1 * ld_b] = asinh(a[offset_a + gid_0 + gid_1 * ld_a]);
+            b[offset_b + uplo_index(gid_0, gid_1, ld_b, sd, bottom)] = asinh(a[offset_a + uplo_index(gid_0, gid_1, ld_a, sd, bottom)]);
         }
     }
 }
@@ -2253,7 +2042,7 @@ kernel void uplo_acosh (constant int& sd [[buffer(0)]], constant int& unit [[buf
     int gid_1 = id.y;
     if (gid_0 < sd && gid_1 < sd) {
         if ((unit == 132) ? bottom * gid_0 > bottom * gid_1 : bottom * gid_0 >= bottom * gid_1) {
-            b[offset_b + gid_0 + gid_1 * ld_b] = acosh(a[offset_a + gid_0 + gid_1 * ld_a]);
+            b[offset_b + uplo_index(gid_0, gid_1, ld_b, sd, bottom)] = acosh(a[offset_a + uplo_index(gid_0, gid_1, ld_a, sd, bottom)]);
         }
     }
 }
@@ -2267,7 +2056,7 @@ kernel void uplo_atanh (constant int& sd [[buffer(0)]], constant int& unit [[buf
     int gid_1 = id.y;
     if (gid_0 < sd && gid_1 < sd) {
         if ((unit == 132) ? bottom * gid_0 > bottom * gid_1 : bottom * gid_0 >= bottom * gid_1) {
-            b[offset_b + gid_0 + gid_1 * ld_b] = atanh(a[offset_a + gid_0 + gid_1 * ld_a]);
+            b[offset_b + uplo_index(gid_0, gid_1, ld_b, sd, bottom)] = atanh(a[offset_a + uplo_index(gid_0, gid_1, ld_a, sd, bottom)]);
         }
     }
 }
@@ -2281,7 +2070,7 @@ kernel void uplo_erf (constant int& sd [[buffer(0)]], constant int& unit [[buffe
     int gid_1 = id.y;
     if (gid_0 < sd && gid_1 < sd) {
         if ((unit == 132) ? bottom * gid_0 > bottom * gid_1 : bottom * gid_0 >= bottom * gid_1) {
-            b[offset_b + gid_0 + gid_1 * ld_b] = erf(a[offset_a + gid_0 + gid_1 * ld_a]);
+            b[offset_b + uplo_index(gid_0, gid_1, ld_b, sd, bottom)] = erf(a[offset_a + uplo_index(gid_0, gid_1, ld_a, sd, bottom)]);
         }
     }
 }
@@ -2295,7 +2084,7 @@ kernel void uplo_erf_inv (constant int& sd [[buffer(0)]], constant int& unit [[b
     int gid_1 = id.y;
     if (gid_0 < sd && gid_1 < sd) {
         if ((unit == 132) ? bottom * gid_0 > bottom * gid_1 : bottom * gid_0 >= bottom * gid_1) {
-            b[offset_b + gid_0 + gid_1 * ld_b] = erfinv(a[offset_a + gid_0 + gid_1 * ld_a]);
+            b[offset_b + uplo_index(gid_0, gid_1, ld_b, sd, bottom)] = erfinv(a[offset_a + uplo_index(gid_0, gid_1, ld_a, sd, bottom)]);
         }
     }
 }
@@ -2309,7 +2098,7 @@ kernel void uplo_erfc (constant int& sd [[buffer(0)]], constant int& unit [[buff
     int gid_1 = id.y;
     if (gid_0 < sd && gid_1 < sd) {
         if ((unit == 132) ? bottom * gid_0 > bottom * gid_1 : bottom * gid_0 >= bottom * gid_1) {
-            b[offset_b + gid_0 + gid_1 * ld_b] = erfc(a[offset_a + gid_0 + gid_1 * ld_a]);
+            b[offset_b + uplo_index(gid_0, gid_1, ld_b, sd, bottom)] = erfc(a[offset_a + uplo_index(gid_0, gid_1, ld_a, sd, bottom)]);
         }
     }
 }
@@ -2323,7 +2112,7 @@ kernel void uplo_erfc_inv (constant int& sd [[buffer(0)]], constant int& unit [[
     int gid_1 = id.y;
     if (gid_0 < sd && gid_1 < sd) {
         if ((unit == 132) ? bottom * gid_0 > bottom * gid_1 : bottom * gid_0 >= bottom * gid_1) {
-            b[offset_b + gid_0 + gid_1 * ld_b] = erfcinv(a[offset_a + gid_0 + gid_1 * ld_a]);
+            b[offset_b + uplo_index(gid_0, gid_1, ld_b, sd, bottom)] = erfcinv(a[offset_a + uplo_index(gid_0, gid_1, ld_a, sd, bottom)]);
         }
     }
 }
@@ -2337,7 +2126,7 @@ kernel void uplo_cdf_norm (constant int& sd [[buffer(0)]], constant int& unit [[
     int gid_1 = id.y;
     if (gid_0 < sd && gid_1 < sd) {
         if ((unit == 132) ? bottom * gid_0 > bottom * gid_1 : bottom * gid_0 >= bottom * gid_1) {
-            b[offset_b + gid_0 + gid_1 * ld_b] = normcdf(a[offset_a + gid_0 + gid_1 * ld_a]);
+            b[offset_b + uplo_index(gid_0, gid_1, ld_b, sd, bottom)] = normcdf(a[offset_a + uplo_index(gid_0, gid_1, ld_a, sd, bottom)]);
         }
     }
 }
@@ -2351,7 +2140,7 @@ kernel void uplo_cdf_norm_inv (constant int& sd [[buffer(0)]], constant int& uni
     int gid_1 = id.y;
     if (gid_0 < sd && gid_1 < sd) {
         if ((unit == 132) ? bottom * gid_0 > bottom * gid_1 : bottom * gid_0 >= bottom * gid_1) {
-            b[offset_b + gid_0 + gid_1 * ld_b] = normcdfinv(a[offset_a + gid_0 + gid_1 * ld_a]);
+            b[offset_b + uplo_index(gid_0, gid_1, ld_b, sd, bottom)] = normcdfinv(a[offset_a + uplo_index(gid_0, gid_1, ld_a, sd, bottom)]);
         }
     }
 }
@@ -2365,7 +2154,7 @@ kernel void uplo_gamma (constant int& sd [[buffer(0)]], constant int& unit [[buf
     int gid_1 = id.y;
     if (gid_0 < sd && gid_1 < sd) {
         if ((unit == 132) ? bottom * gid_0 > bottom * gid_1 : bottom * gid_0 >= bottom * gid_1) {
-            b[offset_b + gid_0 + gid_1 * ld_b] = tgamma(a[offset_a + gid_0 + gid_1 * ld_a]);
+            b[offset_b + uplo_index(gid_0, gid_1, ld_b, sd, bottom)] = tgamma(a[offset_a + uplo_index(gid_0, gid_1, ld_a, sd, bottom)]);
         }
     }
 }
@@ -2379,7 +2168,7 @@ kernel void uplo_lgamma (constant int& sd [[buffer(0)]], constant int& unit [[bu
     int gid_1 = id.y;
     if (gid_0 < sd && gid_1 < sd) {
         if ((unit == 132) ? bottom * gid_0 > bottom * gid_1 : bottom * gid_0 >= bottom * gid_1) {
-            b[offset_b + gid_0 + gid_1 * ld_b] = lgamma(a[offset_a + gid_0 + gid_1 * ld_a]);
+            b[offset_b + uplo_index(gid_0, gid_1, ld_b, sd, bottom)] = lgamma(a[offset_a + uplo_index(gid_0, gid_1, ld_a, sd, bottom)]);
         }
     }
 }
@@ -2393,7 +2182,7 @@ kernel void uplo_floor (constant int& sd [[buffer(0)]], constant int& unit [[buf
     int gid_1 = id.y;
     if (gid_0 < sd && gid_1 < sd) {
         if ((unit == 132) ? bottom * gid_0 > bottom * gid_1 : bottom * gid_0 >= bottom * gid_1) {
-            b[offset_b + gid_0 + gid_1 * ld_b] = floor(a[offset_a + gid_0 + gid_1 * ld_a]);
+            b[offset_b + uplo_index(gid_0, gid_1, ld_b, sd, bottom)] = floor(a[offset_a + uplo_index(gid_0, gid_1, ld_a, sd, bottom)]);
         }
     }
 }
@@ -2407,7 +2196,7 @@ kernel void uplo_ceil (constant int& sd [[buffer(0)]], constant int& unit [[buff
     int gid_1 = id.y;
     if (gid_0 < sd && gid_1 < sd) {
         if ((unit == 132) ? bottom * gid_0 > bottom * gid_1 : bottom * gid_0 >= bottom * gid_1) {
-            b[offset_b + gid_0 + gid_1 * ld_b] = ceil(a[offset_a + gid_0 + gid_1 * ld_a]);
+            b[offset_b + uplo_index(gid_0, gid_1, ld_b, sd, bottom)] = ceil(a[offset_a + uplo_index(gid_0, gid_1, ld_a, sd, bottom)]);
         }
     }
 }
@@ -2421,7 +2210,7 @@ kernel void uplo_trunc (constant int& sd [[buffer(0)]], constant int& unit [[buf
     int gid_1 = id.y;
     if (gid_0 < sd && gid_1 < sd) {
         if ((unit == 132) ? bottom * gid_0 > bottom * gid_1 : bottom * gid_0 >= bottom * gid_1) {
-            b[offset_b + gid_0 + gid_1 * ld_b] = trunc(a[offset_a + gid_0 + gid_1 * ld_a]);
+            b[offset_b + uplo_index(gid_0, gid_1, ld_b, sd, bottom)] = trunc(a[offset_a + uplo_index(gid_0, gid_1, ld_a, sd, bottom)]);
         }
     }
 }
@@ -2435,7 +2224,7 @@ kernel void uplo_round (constant int& sd [[buffer(0)]], constant int& unit [[buf
     int gid_1 = id.y;
     if (gid_0 < sd && gid_1 < sd) {
         if ((unit == 132) ? bottom * gid_0 > bottom * gid_1 : bottom * gid_0 >= bottom * gid_1) {
-            b[offset_b + gid_0 + gid_1 * ld_b] = round(a[offset_a + gid_0 + gid_1 * ld_a]);
+            b[offset_b + uplo_index(gid_0, gid_1, ld_b, sd, bottom)] = round(a[offset_a + uplo_index(gid_0, gid_1, ld_a, sd, bottom)]);
         }
     }
 }
@@ -2450,10 +2239,10 @@ kernel void uplo_modf (constant int& sd [[buffer(0)]], constant int& unit [[buff
     int gid_1 = id.y;
     if (gid_0 < sd && gid_1 < sd) {
         if ((unit == 132) ? bottom * gid_0 > bottom * gid_1 : bottom * gid_0 >= bottom * gid_1) {
-            REAL aval = a[offset_a + gid_0 + gid_1 * ld_a];
+            REAL aval = a[offset_a + uplo_index(gid_0, gid_1, ld_a, sd, bottom)];
             REAL intpart = (REAL)((long)aval);
-            c[offset_c + gid_0 + gid_1 * ld_c] = aval - intpart;
-            b[offset_b + gid_0 + gid_1 * ld_b] = intpart;
+            c[offset_c + uplo_index(gid_0, gid_1, ld_c, sd, bottom)] = aval - intpart;
+            b[offset_b + uplo_index(gid_0, gid_1, ld_b, sd, bottom)] = intpart;
         }
     }
 }
@@ -2467,8 +2256,8 @@ kernel void uplo_frac (constant int& sd [[buffer(0)]], constant int& unit [[buff
     int gid_1 = id.y;
     if (gid_0 < sd && gid_1 < sd) {
         if ((unit == 132) ? bottom * gid_0 > bottom * gid_1 : bottom * gid_0 >= bottom * gid_1) {
-            REAL aval = a[offset_a + gid_0 + gid_1 * ld_a];
-            b[offset_b + gid_0 + gid_1 * ld_b] = aval - (REAL)((long)aval);
+            REAL aval = a[offset_a + uplo_index(gid_0, gid_1, ld_a, sd, bottom)];
+            b[offset_b + uplo_index(gid_0, gid_1, ld_b, sd, bottom)] = aval - (REAL)((long)aval);
         }
     }
 }
@@ -2483,7 +2272,7 @@ kernel void uplo_fmax (constant int& sd [[buffer(0)]], constant int& unit [[buff
     int gid_1 = id.y;
     if (gid_0 < sd && gid_1 < sd) {
         if ((unit == 132) ? bottom * gid_0 > bottom * gid_1 : bottom * gid_0 >= bottom * gid_1) {
-            c[offset_c + gid_0 + gid_1 * ld_c] = fmax(a[offset_a + gid_0 + gid_1 * ld_a], b[offset_b + gid_0 + gid_1 * ld_b]);
+            c[offset_c + uplo_index(gid_0, gid_1, ld_c, sd, bottom)] = fmax(a[offset_a + uplo_index(gid_0, gid_1, ld_a, sd, bottom)], b[offset_b + uplo_index(gid_0, gid_1, ld_b, sd, bottom)]);
         }
     }
 }
@@ -2498,7 +2287,7 @@ kernel void uplo_fmin (constant int& sd [[buffer(0)]], constant int& unit [[buff
     int gid_1 = id.y;
     if (gid_0 < sd && gid_1 < sd) {
         if ((unit == 132) ? bottom * gid_0 > bottom * gid_1 : bottom * gid_0 >= bottom * gid_1) {
-            c[offset_c + gid_0 + gid_1 * ld_c] = fmin(a[offset_a + gid_0 + gid_1 * ld_a], b[offset_b + gid_0 + gid_1 * ld_b]);
+            c[offset_c + uplo_index(gid_0, gid_1, ld_c, sd, bottom)] = fmin(a[offset_a + uplo_index(gid_0, gid_1, ld_a, sd, bottom)], b[offset_b + uplo_index(gid_0, gid_1, ld_b, sd, bottom)]);
         }
     }
 }
@@ -2513,7 +2302,7 @@ kernel void uplo_copysign (constant int& sd [[buffer(0)]], constant int& unit [[
     int gid_1 = id.y;
     if (gid_0 < sd && gid_1 < sd) {
         if ((unit == 132) ? bottom * gid_0 > bottom * gid_1 : bottom * gid_0 >= bottom * gid_1) {
-            c[offset_c + gid_0 + gid_1 * ld_c] = copysign(a[offset_a + gid_0 + gid_1 * ld_a], b[offset_b + gid_0 + gid_1 * ld_b]);
+            c[offset_c + uplo_index(gid_0, gid_1, ld_c, sd, bottom)] = copysign(a[offset_a + uplo_index(gid_0, gid_1, ld_a, sd, bottom)], b[offset_b + uplo_index(gid_0, gid_1, ld_b, sd, bottom)]);
         }
     }
 }
@@ -2527,7 +2316,7 @@ kernel void uplo_sigmoid (constant int& sd [[buffer(0)]], constant int& unit [[b
     int gid_1 = id.y;
     if (gid_0 < sd && gid_1 < sd) {
         if ((unit == 132) ? bottom * gid_0 > bottom * gid_1 : bottom * gid_0 >= bottom * gid_1) {
-            b[offset_b + gid_0 + gid_1 * ld_b] = tanh(REAL1o2 * a[offset_a + gid_0 + gid_1 * ld_a]) * REAL1o2 + REAL1o2;
+            b[offset_b + uplo_index(gid_0, gid_1, ld_b, sd, bottom)] = tanh(REAL1o2 * a[offset_a + uplo_index(gid_0, gid_1, ld_a, sd, bottom)]) * REAL1o2 + REAL1o2;
         }
     }
 }
@@ -2541,7 +2330,7 @@ kernel void uplo_ramp (constant int& sd [[buffer(0)]], constant int& unit [[buff
     int gid_1 = id.y;
     if (gid_0 < sd && gid_1 < sd) {
         if ((unit == 132) ? bottom * gid_0 > bottom * gid_1 : bottom * gid_0 >= bottom * gid_1) {
-            b[offset_b + gid_0 + gid_1 * ld_b] = fmax(a[offset_a + gid_0 + gid_1 * ld_a], (REAL)0.0);
+            b[offset_b + uplo_index(gid_0, gid_1, ld_b, sd, bottom)] = fmax(a[offset_a + uplo_index(gid_0, gid_1, ld_a, sd, bottom)], (REAL)0.0);
         }
     }
 }
@@ -2556,8 +2345,8 @@ kernel void uplo_relu (constant int& sd [[buffer(0)]], constant int& unit [[buff
     int gid_1 = id.y;
     if (gid_0 < sd && gid_1 < sd) {
         if ((unit == 132) ? bottom * gid_0 > bottom * gid_1 : bottom * gid_0 >= bottom * gid_1) {
-            REAL val = a[offset_a + gid_0 + gid_1 * ld_a];
-            b[offset_b + gid_0 + gid_1 * ld_b] = fmax(val, alpha * val);
+            REAL val = a[offset_a + uplo_index(gid_0, gid_1, ld_a, sd, bottom)];
+            b[offset_b + uplo_index(gid_0, gid_1, ld_b, sd, bottom)] = fmax(val, alpha * val);
         }
     }
 }
@@ -2572,8 +2361,8 @@ kernel void uplo_elu (constant int& sd [[buffer(0)]], constant int& unit [[buffe
     int gid_1 = id.y;
     if (gid_0 < sd && gid_1 < sd) {
         if ((unit == 132) ? bottom * gid_0 > bottom * gid_1 : bottom * gid_0 >= bottom * gid_1) {
-            REAL val = a[offset_a + gid_0 + gid_1 * ld_a];
-            b[offset_b + gid_0 + gid_1 * ld_b] = fmax(val, alpha * expm1(val));
+            REAL val = a[offset_a + uplo_index(gid_0, gid_1, ld_a, sd, bottom)];
+            b[offset_b + uplo_index(gid_0, gid_1, ld_b, sd, bottom)] = fmax(val, alpha * expm1(val));
         }
     }
 }
@@ -1,5 +1,9 @@
 package ferrum;
 
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+import java.nio.FloatBuffer;
+
 public class ComputeTest {
 
     static {
@@ -17,9 +21,33 @@ public class ComputeTest {
       return s + "]";
     }
 
+    // Squares x through an array, a buffer from newFloatBuffer, which the engine may use in place,
+    // and another direct buffer, which the engine must copy
+    public static boolean checkEngine(float[] x) {
+        boolean ok = true;
+        try (FerrumEngine engine = new FerrumEngine()) {
+            float[] squares = engine.vect_bfB("vector_powx", x, 2.0f);
+            FloatBuffer direct = FerrumEngine.newFloatBuffer(x.length);
+            direct.put(x);
+            FloatBuffer result = FerrumEngine.newFloatBuffer(x.length);
+            engine.vect_bfB("vector_powx", direct, 0, 1, 2.0f, result);
+            FloatBuffer other = ByteBuffer.allocateDirect(x.length * Float.BYTES).order(ByteOrder.nativeOrder()).asFloatBuffer();
+            engine.vect_bfB("vector_powx", direct, 0, 1, 2.0f, other);
+            for (int i = 0; i < x.length; i++) {
+                float expected = x[i] * x[i];
+                ok &= squares[i] == expected && result.get(i) == expected && other.get(i) == expected;
+            }
+            System.out.println(engine.backendName() + " squares of arrays and buffers: " + (ok ? "OK" : "wrong"));
+        }
+        return ok;
+    }
+
     public static void main(String[] args) {
         float[] a = new float[] {1.0f, 2.0f, 3.0f, 4.0f};
         float[] b = new float[] {5.0f, 6.0f, 7.0f, 8.0f};
+        if (!checkEngine(a)) {
+            System.exit(1);
+        }
         ComputeTest op = new ComputeTest();
         float[] c = op.add(a, b);
         System.out.println("Sum of a and b is: " + toString(c));
@@ -0,0 +1,73 @@
+#include <cmath>
+#include <future>
+#include <iostream>
+#include <vector>
+
+#include "cpu_engine.hpp"
+#include "recording_engine.hpp"
+
+// Submits functions to run on the engine's submission thread, and waits on the results
+
+int main(void) {
+  bool success = true;
+  const int length = 20000;
+
+  // chained calls complete in the order they were submitted
+  {
+    Ferrum::CpuEngine cpu(2);
+    Ferrum::Engine* engine = &cpu;
+    std::vector<float> x(length), t(length), r(length);
+    for (int i = 0; i < length; i++) {
+      x[i] = (i % 100) * 0.01f;
+    }
+    std::future<float*> first = engine->async<&Ferrum::Engine::vect_bB>(
+        Ferrum::FunctionID::vector_exp, x.data(), length, 0, 1, t.data(), length, 0, 1);
+    std::future<float*> second = engine->async<&Ferrum::Engine::vect_bbB>(
+        Ferrum::FunctionID::vector_add, t.data(), length, 0, 1, x.data(), length, 0, 1, r.data(), length, 0, 1);
+    success &= second.get() == r.data();
+    success &= first.get() == t.data();
+    for (int i = 0; i < length; i++) {
+      float expected = std::exp(x[i]) + x[i];
+      if (std::fabs(r[i] - expected) > 1e-5f * expected) {
+        std::cout << "Element " << i << " is " << r[i] << ", expected " << expected << std::endl;
+        success = false;
+        break;
+      }
+    }
+    std::cout << "exp(x) + x: " << r[0] << ", " << r[1] << ", " << r[2] << " ..." << std::endl;
+  }
+
+  // jobs see the engine that they were submitted to, and failures come back as nullptr
+  {
+    Ferrum::RecordingEngine recorder(new Ferrum::CpuEngine(1));
+    std::vector<float> x(8, 0.5f), r(8);
+    std::future<float*> done = recorder.submit([&](Ferrum::Engine& engine) {
+      return engine.vect_bfB(Ferrum::FunctionID::vector_powx, x.data(), 8, 0, 1, 2.0f, r.data(), 8, 0, 1);
+    });
+    std::future<float*> failed = recorder.submit([](Ferrum::Engine&) -> float* {
+      return nullptr;
+    });
+    success &= done.get() == r.data();
+    success &= failed.get() == nullptr;
+    success &= recorder.calls().size() == 1;
+    std::cout << "Recorded " << recorder.calls().size() << " call from a submitted job" << std::endl;
+  }
+
+  // the completion is called with the result before the future is ready, through a recorder as well
+  for (int recording = 0; recording < 2; recording++) {
+    Ferrum::Engine* engine = recording ? static_cast<Ferrum::Engine*>(new Ferrum::RecordingEngine(new Ferrum::CpuEngine(1)))
+                                       : new Ferrum::CpuEngine(1);
+    std::vector<float> x(8, 3.0f), r(8);
+    float* completed = nullptr;
+    std::future<float*> done = engine->submit(
+        [&](Ferrum::Engine& e) { return e.vect_bB(Ferrum::FunctionID::vector_sqr, x.data(), 8, 0, 1, r.data(), 8, 0, 1); },
+        [&](float* result) { completed = result; });
+    bool called = done.get() == r.data() && completed == r.data() && r[7] == 9.0f;
+    std::cout << "Completion " << (recording ? "through a recorder" : "on the CPU") << ": " << (called ? "OK" : "missed") << std::endl;
+    success &= called;
+    delete engine;
+  }
+
+  std::cout << (success ? "Success!" : "Failed!") << std::endl;
+  return success ? 0 : 1;
+}
@@ -0,0 +1,102 @@
+#include <cstring>
+#include <iostream>
+
+#include "cpu_engine.hpp"
+#include "fusion.hpp"
+#include "recording_engine.hpp"
+
+// Runs the same calls through a mock backend, and a recording backend wrapped around the CPU engine
+
+bool runCalls(Ferrum::Engine* engine, const float* a, const float* b, float* result, int length) {
+  bool ok = true;
+  ok &= engine->vect_bbB(Ferrum::FunctionID::vector_add, a, length, 0, 1, b, length, 0, 1, result, length, 0, 1) != nullptr;
+  ok &= engine->vect_bfB(Ferrum::FunctionID::vector_powx, a, length, 0, 1, 2.0f, result, length, 0, 1) != nullptr;
+  ok &= engine->ge_bB(Ferrum::FunctionID::ge_sqr, 2, 3, a, length, 0, 2, result, length, 0, 2) != nullptr;
+  ok &= engine->uplo_fbB(Ferrum::FunctionID::uplo_relu, 3, 131, -1, a, length, 0, 3, 0.5f, result, length, 0, 3) != nullptr;
+  return ok;
+}
+
+bool checkCalls(Ferrum::RecordingEngine& engine) {
+  std::vector<Ferrum::RecordedCall> calls = engine.calls();
+  const char* expected[] = {"vect_bbB", "vect_bfB", "ge_bB", "uplo_fbB"};
+  if (calls.size() != 4) {
+    std::cout << "Expected 4 calls, saw " << calls.size() << std::endl;
+    return false;
+  }
+  for (int i = 0; i < 4; i++) {
+    std::cout << "  " << calls[i].dispatch << " " << calls[i].id << std::endl;
+    if (strcmp(calls[i].dispatch, expected[i]) != 0) {
+      return false;
+    }
+  }
+  return calls[0].buffers.size() == 9 && calls[1].scalars.size() == 1 && calls[1].scalars[0] == 2.0f &&
+         calls[2].dims.size() == 2 && calls[2].dims[1] == 3 && calls[3].dims.size() == 3 && calls[3].dims[2] == -1;
+}
+
+int main(void) {
+  const int length = 9;
+  float a[length] = {1, 2, 3, 4, 5, 6, 7, 8, 9};
+  float b[length] = {9, 8, 7, 6, 5, 4, 3, 2, 1};
+  float result[length] = {0};
+  bool success = true;
+
+  std::cout << "Mock backend:" << std::endl;
+  Ferrum::RecordingEngine mock;
+  success &= runCalls(&mock, a, b, result, length);
+  success &= checkCalls(mock);
+  for (int i = 0; i < length; i++) {
+    success &= (result[i] == 0.0f);
+  }
+  mock.clear();
+  success &= mock.calls().empty();
+
+  std::cout << "Recording CPU backend:" << std::endl;
+  Ferrum::RecordingEngine recorder(new Ferrum::CpuEngine(1));
+  Ferrum::Engine* engine = &recorder;
+  std::cout << "  backend: " << engine->name() << std::endl;
+  success &= runCalls(engine, a, b, result, length);
+  success &= checkCalls(recorder);
+  // squares, with the upper triangle (including the diagonal) copied back by relu
+  float expected[length] = {1, 4, 9, 4, 5, 36, 7, 8, 9};
+  for (int i = 0; i < length; i++) {
+    if (result[i] != expected[i]) {
+      std::cout << "Element " << i << " is " << result[i] << ", expected " << expected[i] << std::endl;
+      success = false;
+    }
+  }
+
+  // the IDs that Java passes are the indexes of the sorted names
+  static_assert(Ferrum::getFunctionID("vector_exp") == Ferrum::FunctionID::vector_exp);
+  bool named = Ferrum::getFunctionID("vector_") == Ferrum::FunctionID::UNKNOWN &&
+               Ferrum::getFunctionID("") == Ferrum::FunctionID::UNKNOWN;
+  for (int i = 0; i < Ferrum::functionCount; i++) {
+    named &= Ferrum::getFunctionID(Ferrum::functionNames[i]) == i;
+    named &= i == 0 || strcmp(Ferrum::functionNames[i - 1], Ferrum::functionNames[i]) < 0;
+  }
+  std::cout << "Function names: " << (named ? "OK" : "out of order") << std::endl;
+
+  // the shapes parsed from the Metal source, for kernels from each file and a host_name
+  static_assert(Ferrum::kernelAccepts(Ferrum::FunctionID::vector_linear_frac, Ferrum::Family::vector, Ferrum::Signature::bbffffB));
+  static_assert(Ferrum::kernelAccepts(Ferrum::FunctionID::ge_linear_frac, Ferrum::Family::ge, Ferrum::Signature::bbffffB));
+  static_assert(Ferrum::kernelAccepts(Ferrum::FunctionID::uplo_copy, Ferrum::Family::uplo, Ferrum::Signature::bB));
+  static_assert(Ferrum::kernelAccepts(Ferrum::FunctionID::vector_set, Ferrum::Family::vector, Ferrum::Signature::fbB));
+  static_assert(Ferrum::kernelAccepts(Ferrum::FunctionID::vector_dot, Ferrum::Family::vector, Ferrum::Signature::bbB));
+  static_assert(Ferrum::functionShapes[Ferrum::FunctionID::ge_gemm].family == Ferrum::Family::other);
+  static_assert(!Ferrum::kernelAccepts(Ferrum::FunctionID::vector_add, Ferrum::Family::vector, Ferrum::Signature::bB));
+  // and they agree with the functions that can be fused
+  bool shaped = true;
+  for (int i = 0; i < Ferrum::functionCount; i++) {
+    Ferrum::FunctionID id = static_cast<Ferrum::FunctionID>(i);
+    Ferrum::Signature signature;
+    if (Ferrum::fusedSignature(id, signature) && !Ferrum::kernelAccepts(id, Ferrum::Family::vector, signature)) {
+      std::cout << "Fused signature of " << Ferrum::functionNames[i] << " does not match its kernel" << std::endl;
+      shaped = false;
+    }
+  }
+  std::cout << "Kernel shapes: " << (shaped ? "OK" : "different") << std::endl;
+  success &= shaped;
+  success &= named;
+
+  std::cout << (success ? "Success!" : "Failed!") << std::endl;
+  return success ? 0 : 1;
+}
@@ -0,0 +1,138 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+#include "cpu_engine.hpp"
+#include "recording_engine.hpp"
+
+// Queues a chain of tensor functions in a batch, and runs them with a single submission
+
+// Times count small copies, with or without a batch, returning microseconds per call. The copy is
+// cheap, so this is mostly the cost of making each call. In a batch the calls only queue their
+// steps, and committed is set to the time per call that commitBatch takes to run them.
+double timeCalls(Ferrum::Engine* engine, Ferrum::Tensor* x, Ferrum::Tensor* t, int count, bool batched,
+                 double& committed) {
+  if (batched) {
+    engine->beginBatch();
+  }
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < count; i++) {
+    engine->vect_bB(Ferrum::FunctionID::vector_copy, x->data, x->length, 0, 1, t->data, t->length, 0, 1);
+  }
+  auto end = std::chrono::steady_clock::now();
+  if (batched) {
+    engine->commitBatch();
+  }
+  std::chrono::duration<double, std::micro> elapsed = end - start;
+  std::chrono::duration<double, std::micro> running = std::chrono::steady_clock::now() - end;
+  committed = running.count() / count;
+  return elapsed.count() / count;
+}
+
+int main(void) {
+  Ferrum::CpuEngine cpu(2);
+  Ferrum::Engine* engine = &cpu;
+  bool success = true;
+
+  const int length = 50000;
+  Ferrum::Tensor* x = engine->newTensor(length);
+  Ferrum::Tensor* y = engine->newTensor(length);
+  Ferrum::Tensor* t = engine->newTensor(length);
+  for (int i = 0; i < length; i++) {
+    x->data[i] = (i % 100) * 0.01f;
+    y->data[i] = 2.0f;
+    t->data[i] = 0.0f;
+  }
+
+  // t = exp(x) * y + x, with nothing run until the commit
+  success &= engine->beginBatch();
+  success &= engine->inBatch();
+  success &= !engine->beginBatch();
+  success &= engine->vect_bB(Ferrum::FunctionID::vector_exp, x->data, x->length, 0, 1, t->data, t->length, 0, 1) == t->data;
+  success &= engine->vect_bbB(Ferrum::FunctionID::vector_mul, t->data, t->length, 0, 1, y->data, y->length, 0, 1,
+                              t->data, t->length, 0, 1) == t->data;
+  success &= engine->vect_bbB(Ferrum::FunctionID::vector_add, t->data, t->length, 0, 1, x->data, x->length, 0, 1,
+                              t->data, t->length, 0, 1) == t->data;
+  // bad arguments are reported when the call is queued
+  success &= engine->vect_bB(Ferrum::FunctionID::vector_add, x->data, x->length, 0, 1, t->data, t->length, 0, 1) == nullptr;
+  success &= t->data[50] == 0.0f;
+  success &= engine->commitBatch();
+  success &= !engine->inBatch();
+  success &= !engine->commitBatch();
+  for (int i = 0; i < length; i++) {
+    float expected = std::exp(x->data[i]) * 2.0f + x->data[i];
+    if (std::fabs(t->data[i] - expected) > 1e-5f * expected) {
+      std::cout << "Element " << i << " is " << t->data[i] << ", expected " << expected << std::endl;
+      success = false;
+      break;
+    }
+  }
+  std::cout << "exp(x) * y + x: " << t->data[0] << ", " << t->data[1] << ", " << t->data[2] << " ..." << std::endl;
+
+  // a tensor released inside a batch is still there for the calls queued before it
+  {
+    Ferrum::Tensor* a = engine->newTensor(length);
+    for (int i = 0; i < length; i++) {
+      a->data[i] = 1.0f;
+    }
+    success &= engine->beginBatch();
+    engine->vect_bB(Ferrum::FunctionID::vector_exp, a->data, a->length, 0, 1, t->data, t->length, 0, 1);
+    engine->releaseTensor(a);
+    // this may be given the memory of a if it was freed straight away
+    Ferrum::Tensor* b = engine->newTensor(length);
+    for (int i = 0; i < length; i++) {
+      b->data[i] = 0.0f;
+    }
+    success &= engine->commitBatch();
+    bool kept = std::fabs(t->data[0] - std::exp(1.0f)) < 1e-6f && std::fabs(t->data[length - 1] - std::exp(1.0f)) < 1e-6f;
+    std::cout << "Released in a batch: " << (kept ? "OK" : "overwritten") << std::endl;
+    success &= kept;
+    engine->releaseTensor(b);
+  }
+
+  // the batch boundaries are recorded, and passed through
+  {
+    Ferrum::RecordingEngine recorder(new Ferrum::CpuEngine(1));
+    Ferrum::Tensor* a = recorder.newTensor(4);
+    success &= recorder.beginBatch();
+    recorder.vect_bB(Ferrum::FunctionID::vector_copy, a->data, 4, 0, 1, a->data, 4, 0, 1);
+    success &= recorder.commitBatch();
+    recorder.releaseTensor(a);
+    auto calls = recorder.calls();
+    success &= calls.size() == 5 && std::string(calls[1].dispatch) == "beginBatch" &&
+               std::string(calls[3].dispatch) == "commitBatch";
+    std::cout << "Recorded " << calls.size() << " calls around a batch" << std::endl;
+  }
+
+  Ferrum::Tensor* small = engine->newTensor(64);
+  Ferrum::Tensor* smallResult = engine->newTensor(64);
+  for (int i = 0; i < 64; i++) {
+    small->data[i] = i;
+  }
+  // the first batch on a thread sizes its list of steps, which later batches reuse, so the best of a few runs is compared
+  const int count = 10000;
+  double single = 1e9;
+  double queued = 1e9;
+  double committed = 1e9;
+  for (int run = 0; run < 20; run++) {
+    double unused, running;
+    single = std::min(single, timeCalls(engine, small, smallResult, count, false, unused));
+    queued = std::min(queued, timeCalls(engine, small, smallResult, count, true, running));
+    committed = std::min(committed, running);
+  }
+  success &= smallResult->data[3] == 3.0f;
+  std::cout << "Per call: " << single << "us separately, " << queued << "us batched and " << committed
+            << "us to commit" << std::endl;
+  // a call in a batch only checks its arguments and queues a step, which must cost less than a separate call
+  success &= queued < single;
+  engine->releaseTensor(smallResult);
+  engine->releaseTensor(small);
+
+  engine->releaseTensor(t);
+  engine->releaseTensor(y);
+  engine->releaseTensor(x);
+
+  std::cout << (success ? "Success!" : "Failed!") << std::endl;
+  return success ? 0 : 1;
+}
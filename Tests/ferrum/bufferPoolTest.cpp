@@ -0,0 +1,134 @@
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "buffer_pool.hpp"
+
+// Stress test for the buffer pool, using host memory
+
+// Counts the blocks that are live, so that leaks and double releases can be seen
+class CountingAllocator : public Ferrum::HostAllocator {
+  public:
+    std::atomic<long> live{0};
+    std::atomic<long> allocations{0};
+
+    Ferrum::Block allocate(size_t size) override {
+      live++;
+      allocations++;
+      return HostAllocator::allocate(size);
+    }
+
+    void release(const Ferrum::Block& block) override {
+      live--;
+      HostAllocator::release(block);
+    }
+};
+
+int main(void) {
+  bool success = true;
+  const size_t limit = 4 * 1024 * 1024;
+
+  // size classes
+  success &= Ferrum::BufferPool::blockSize(1) == Ferrum::BufferPool::MIN_BLOCK;
+  success &= Ferrum::BufferPool::blockSize(256) == 256;
+  success &= Ferrum::BufferPool::blockSize(257) == 512;
+  success &= Ferrum::BufferPool::blockSize(1000000) == 1048576;
+
+  CountingAllocator allocator;
+  {
+    Ferrum::BufferPool pool(&allocator, limit);
+
+    // a freed block is reused for a request in the same size class
+    Ferrum::Block first = pool.acquire(3000);
+    void* firstHandle = first.handle;
+    pool.recycle(first);
+    Ferrum::Block second = pool.acquire(4000);
+    success &= second.handle == firstHandle && second.size == 4096;
+    pool.recycle(second);
+    success &= allocator.allocations == 1;
+
+    // many threads, with a mix of sizes, writing to every block they hold
+    const int threads = 8;
+    const int iterations = 20000;
+    std::vector<std::thread> workers;
+    std::atomic<bool> corrupt(false);
+    for (int t = 0; t < threads; t++) {
+      workers.emplace_back([&pool, &corrupt, t]() {
+        std::mt19937 random(t);
+        std::vector<Ferrum::Block> held;
+        for (int i = 0; i < iterations; i++) {
+          if (held.size() < 8 && (held.empty() || random() % 2 == 0)) {
+            size_t size = 1 + random() % (256 * 1024);
+            Ferrum::Block block = pool.acquire(size);
+            if (block.handle == nullptr || block.size < size) {
+              corrupt = true;
+              continue;
+            }
+            memset(block.contents, t, size);
+            held.push_back(block);
+          } else {
+            size_t index = random() % held.size();
+            Ferrum::Block block = held[index];
+            if (static_cast<unsigned char*>(block.contents)[0] != t) {
+              corrupt = true;
+            }
+            pool.recycle(block);
+            held.erase(held.begin() + index);
+          }
+        }
+        for (auto& block : held) {
+          pool.recycle(block);
+        }
+      });
+    }
+    for (auto& worker : workers) {
+      worker.join();
+    }
+    std::cout << "Allocations: " << allocator.allocations << " for " << threads * iterations << " operations" << std::endl;
+    std::cout << "High water mark: " << pool.highWaterMark() << " bytes" << std::endl;
+    success &= !corrupt;
+    success &= pool.usedBytes() == 0;
+    success &= pool.freeBytes() <= limit;
+    success &= allocator.allocations < threads * iterations / 10;
+
+    pool.trim();
+    success &= pool.freeBytes() == 0 && allocator.live == 0;
+  }
+  success &= allocator.live == 0;
+
+  // free blocks are released when the pool is left idle
+  {
+    Ferrum::BufferPool pool(&allocator, limit, std::chrono::milliseconds(50));
+    pool.recycle(pool.acquire(1000));
+    success &= pool.freeBytes() == 1024;
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    std::cout << "Free after idle: " << pool.freeBytes() << std::endl;
+    success &= pool.freeBytes() == 0 && allocator.live == 0;
+  }
+
+  // Host memory covers whole pages, so the Metal engine can wrap all of it. Nothing else is used in
+  // place, so other memory must not pass for host memory, even when it is page aligned.
+  {
+    float* host = Ferrum::newHostMemory(5000);
+    bool hosted = host != nullptr && reinterpret_cast<uintptr_t>(host) % Ferrum::HOST_PAGE == 0 &&
+                  Ferrum::hostMemorySize(host) == 2 * Ferrum::HOST_PAGE;
+    hosted &= Ferrum::hostMemorySize(host + Ferrum::HOST_PAGE / sizeof(float)) == 0;
+    Ferrum::Block aligned = allocator.allocate(Ferrum::HOST_PAGE);
+    hosted &= Ferrum::hostMemorySize(static_cast<float*>(aligned.contents)) == 0;
+    allocator.release(aligned);
+    Ferrum::releaseHostMemory(host);
+    hosted &= Ferrum::hostMemorySize(host) == 0;
+    float* empty = Ferrum::newHostMemory(0);
+    hosted &= Ferrum::hostMemorySize(empty) == Ferrum::HOST_PAGE;
+    Ferrum::releaseHostMemory(empty);
+    std::cout << "Host memory: " << (hosted ? "OK" : "wrong") << std::endl;
+    success &= hosted;
+  }
+
+  std::cout << (success ? "Success!" : "Failed!") << std::endl;
+  return success ? 0 : 1;
+}
@@ -0,0 +1,109 @@
+#include <atomic>
+#include <cmath>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "cpu_engine.hpp"
+#include "recording_engine.hpp"
+
+// Calls one engine from many threads at once, with batches open on some of them
+
+// Runs a batch of t = exp(x) * y + x on the calling thread, and checks the result
+bool batchedChain(Ferrum::Engine* engine, int length, int seed) {
+  Ferrum::Tensor* x = engine->newTensor(length);
+  Ferrum::Tensor* y = engine->newTensor(length);
+  Ferrum::Tensor* t = engine->newTensor(length);
+  for (int i = 0; i < length; i++) {
+    x->data[i] = ((i + seed) % 100) * 0.01f;
+    y->data[i] = seed;
+    t->data[i] = 0.0f;
+  }
+  bool ok = engine->beginBatch() && engine->inBatch();
+  engine->vect_bB(Ferrum::FunctionID::vector_exp, x->data, length, 0, 1, t->data, length, 0, 1);
+  engine->vect_bbB(Ferrum::FunctionID::vector_mul, t->data, length, 0, 1, y->data, length, 0, 1, t->data, length, 0, 1);
+  engine->vect_bbB(Ferrum::FunctionID::vector_add, t->data, length, 0, 1, x->data, length, 0, 1, t->data, length, 0, 1);
+  // nothing has run yet, whatever the other threads have committed
+  ok &= t->data[1] == 0.0f;
+  ok &= engine->commitBatch() && !engine->inBatch();
+  for (int i = 0; i < length && ok; i++) {
+    float expected = std::exp(x->data[i]) * seed + x->data[i];
+    ok &= std::fabs(t->data[i] - expected) <= 1e-5f * expected;
+  }
+  engine->releaseTensor(t);
+  engine->releaseTensor(y);
+  engine->releaseTensor(x);
+  return ok;
+}
+
+// Calls functions immediately on the calling thread, which must not be caught up in any batch
+bool immediateCalls(Ferrum::Engine* engine, int length, int seed) {
+  std::vector<float> x(length), r(length);
+  for (int i = 0; i < length; i++) {
+    x[i] = (i + seed) % 10;
+  }
+  bool ok = !engine->inBatch();
+  ok &= engine->vect_bfB(Ferrum::FunctionID::vector_powx, x.data(), length, 0, 1, 2.0f, r.data(), length, 0, 1) == r.data();
+  for (int i = 0; i < length && ok; i++) {
+    ok &= std::fabs(r[i] - x[i] * x[i]) <= 1e-5f * x[i] * x[i];
+  }
+  return ok;
+}
+
+bool hammer(Ferrum::Engine* engine, const char* label) {
+  const int threads = 8;
+  const int rounds = 20;
+  std::atomic<int> failures(0);
+  std::vector<std::thread> workers;
+  for (int w = 0; w < threads; w++) {
+    workers.emplace_back([&, w]() {
+      for (int round = 0; round < rounds; round++) {
+        // half of the threads batch, and the others call straight through while those batches are open
+        bool ok = (w % 2 == 0) ? batchedChain(engine, 4000 + w, w + 1) : immediateCalls(engine, 3000 + w, w + round);
+        if (!ok) {
+          failures++;
+        }
+      }
+    });
+  }
+  for (std::thread& t : workers) {
+    t.join();
+  }
+  std::cout << label << ": " << threads << " threads, " << failures << " failures" << std::endl;
+  return failures == 0;
+}
+
+int main(void) {
+  bool success = true;
+
+  {
+    Ferrum::CpuEngine cpu(3);
+    success &= hammer(&cpu, "cpu");
+
+    // a batch on one thread leaves the others untouched
+    success &= cpu.beginBatch();
+    bool elsewhere = true;
+    std::thread other([&]() {
+      elsewhere &= !cpu.inBatch();
+      elsewhere &= !cpu.commitBatch();
+      elsewhere &= cpu.beginBatch() && cpu.commitBatch();
+    });
+    other.join();
+    success &= elsewhere && cpu.inBatch();
+    success &= cpu.commitBatch();
+    std::cout << "Batch per thread: " << (elsewhere ? "OK" : "shared") << std::endl;
+
+    // the setting is shared by every thread
+    std::thread setter([&]() { cpu.setReproducible(true); });
+    setter.join();
+    success &= cpu.reproducible();
+  }
+
+  {
+    Ferrum::RecordingEngine recorder(new Ferrum::CpuEngine(2));
+    success &= hammer(&recorder, "recording");
+  }
+
+  std::cout << (success ? "Success!" : "Failed!") << std::endl;
+  return success ? 0 : 1;
+}
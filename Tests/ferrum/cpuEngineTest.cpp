@@ -0,0 +1,175 @@
+#include <cmath>
+#include <iostream>
+
+#include "cpu_engine.hpp"
+
+// Compares the results of the CPU engine against values calculated directly
+
+bool check(const char* name, const float* actual, const float* expected, int length) {
+  for (int i = 0; i < length; i++) {
+    if (std::fabs(actual[i] - expected[i]) > 1e-5f * std::fmax(1.0f, std::fabs(expected[i]))) {
+      std::cout << name << ": element " << i << " is " << actual[i] << ", expected " << expected[i] << std::endl;
+      return false;
+    }
+  }
+  std::cout << name << ": OK" << std::endl;
+  return true;
+}
+
+int main(void) {
+  Ferrum::CpuEngine engine(3);
+  bool success = true;
+
+  const int length = 100000;
+  float* a = new float[length];
+  float* b = new float[length];
+  float* result = new float[length];
+  float* expected = new float[length];
+  for (int i = 0; i < length; i++) {
+    a[i] = 0.5f + (i % 97) * 0.01f;
+    b[i] = 1.0f + (i % 13) * 0.1f;
+  }
+
+  // unit stride, large enough to be split across threads
+  for (int i = 0; i < length; i++) {
+    result[i] = 0.0f;
+    expected[i] = a[i] + b[i];
+  }
+  engine.vect_bbB(Ferrum::FunctionID::vector_add, a, length, 0, 1, b, length, 0, 1, result, length, 0, 1);
+  success &= check("vector_add", result, expected, length);
+
+  // strided with offsets
+  const int n = 1000;
+  for (int i = 0; i < length; i++) {
+    result[i] = expected[i] = -1.0f;
+  }
+  for (int i = 0; i < n; i++) {
+    expected[3 + i * 2] = std::sqrt(a[1 + i * 5]);
+  }
+  engine.vect_bB(Ferrum::FunctionID::vector_sqrt, a, 1 + n * 5, 1, 5, result, 3 + n * 2, 3, 2);
+  success &= check("vector_sqrt", result, expected, length);
+
+  // scalar arguments
+  for (int i = 0; i < n; i++) {
+    expected[i] = 2.0f * a[i] + 3.0f;
+  }
+  engine.vect_bffffB(Ferrum::FunctionID::vector_scale_shift, a, n, 0, 1, 2.0f, 3.0f, 0.0f, 0.0f, result, n, 0, 1);
+  success &= check("vector_scale_shift", result, expected, n);
+
+  // two results
+  float* sines = new float[n];
+  float* expectedSines = new float[n];
+  for (int i = 0; i < n; i++) {
+    expectedSines[i] = std::sin(a[i]);
+    expected[i] = std::cos(a[i]);
+  }
+  engine.vect_bBB(Ferrum::FunctionID::vector_sincos, a, n, 0, 1, sines, n, 0, 1, result, n, 0, 1);
+  success &= check("vector_sincos (sin)", sines, expectedSines, n);
+  success &= check("vector_sincos (cos)", result, expected, n);
+
+  // general matrix: 30x20 inside a buffer with a leading dimension of 40
+  const int sd = 30, fd = 20, ld = 40;
+  for (int i = 0; i < ld * fd; i++) {
+    result[i] = expected[i] = -1.0f;
+  }
+  for (int j = 0; j < fd; j++) {
+    for (int i = 0; i < sd; i++) {
+      expected[i + j * ld] = a[i + j * ld] * b[i + j * ld];
+    }
+  }
+  engine.ge_bbB(Ferrum::FunctionID::ge_mul, sd, fd, a, ld * fd, 0, ld, b, ld * fd, 0, ld, result, ld * fd, 0, ld);
+  success &= check("ge_mul", result, expected, ld * fd);
+
+  // lower triangle, excluding the diagonal
+  for (int i = 0; i < ld * sd; i++) {
+    result[i] = expected[i] = -1.0f;
+  }
+  for (int j = 0; j < sd; j++) {
+    for (int i = j + 1; i < sd; i++) {
+      expected[i + j * ld] = std::fabs(a[i + j * ld] - 1.0f);
+    }
+  }
+  engine.uplo_bfB(Ferrum::FunctionID::uplo_powx, sd, 132, 1, a, ld * sd, 0, ld, 1.0f, result, ld * sd, 0, ld);
+  for (int j = 0; j < sd; j++) {
+    for (int i = j + 1; i < sd; i++) {
+      result[i + j * ld] = std::fabs(result[i + j * ld] - 1.0f);
+    }
+  }
+  success &= check("uplo_powx", result, expected, ld * sd);
+
+  // packed triangles: pack a and b, multiply them packed, and unpack the product into a full matrix
+  for (int bottom : {1, -1}) {
+    const int packed = sd * (sd + 1) / 2;
+    float* pa = new float[packed];
+    float* pb = new float[packed];
+    float* pr = new float[packed];
+    engine.uplo_bB(Ferrum::FunctionID::uplo_copy, sd, 131, bottom, a, ld * sd, 0, ld, pa, packed, 0, Ferrum::PACKED);
+    engine.uplo_bB(Ferrum::FunctionID::uplo_copy, sd, 131, bottom, b, ld * sd, 0, ld, pb, packed, 0, Ferrum::PACKED);
+    engine.uplo_bbB(Ferrum::FunctionID::uplo_mul, sd, 131, bottom, pa, packed, 0, Ferrum::PACKED,
+                    pb, packed, 0, Ferrum::PACKED, pr, packed, 0, Ferrum::PACKED);
+    for (int i = 0; i < ld * sd; i++) {
+      result[i] = expected[i] = -1.0f;
+    }
+    int e = 0;
+    for (int j = 0; j < sd; j++) {
+      for (int i = (bottom > 0) ? j : 0; i < ((bottom > 0) ? sd : j + 1); i++, e++) {
+        expected[i + j * ld] = a[i + j * ld] * b[i + j * ld];
+        success &= pa[e] == a[i + j * ld] && Ferrum::uploIndex(i, j, Ferrum::PACKED, sd, bottom) == e;
+      }
+    }
+    engine.uplo_bB(Ferrum::FunctionID::uplo_copy, sd, 131, bottom, pr, packed, 0, Ferrum::PACKED, result, ld * sd, 0, ld);
+    success &= check(bottom > 0 ? "uplo_mul (packed lower)" : "uplo_mul (packed upper)", result, expected, ld * sd);
+
+    // a unit diagonal is skipped, leaving its place in the packed result untouched
+    for (int i = 0; i < packed; i++) {
+      pr[i] = -1.0f;
+    }
+    engine.uplo_bB(Ferrum::FunctionID::uplo_sqr, sd, 132, bottom, a, ld * sd, 0, ld, pr, packed, 0, Ferrum::PACKED);
+    for (int i = 0; i < ld * sd; i++) {
+      result[i] = expected[i] = -1.0f;
+    }
+    for (int j = 0; j < sd; j++) {
+      for (int i = (bottom > 0) ? j + 1 : 0; i < ((bottom > 0) ? sd : j); i++) {
+        expected[i + j * ld] = a[i + j * ld] * a[i + j * ld];
+      }
+    }
+    engine.uplo_bB(Ferrum::FunctionID::uplo_copy, sd, 131, bottom, pr, packed, 0, Ferrum::PACKED, result, ld * sd, 0, ld);
+    success &= check(bottom > 0 ? "uplo_sqr (unit, packed lower)" : "uplo_sqr (unit, packed upper)",
+                     result, expected, ld * sd);
+
+    delete[] pr;
+    delete[] pb;
+    delete[] pa;
+  }
+  // a packed matrix needs a triangle, and room for all of it
+  if (engine.uplo_bB(Ferrum::FunctionID::uplo_sqr, 4, 131, 0, a, 10, 0, Ferrum::PACKED, result, 16, 0, 4) != nullptr ||
+      engine.uplo_bB(Ferrum::FunctionID::uplo_sqr, 4, 131, 1, a, 9, 0, Ferrum::PACKED, result, 16, 0, 4) != nullptr) {
+    std::cout << "uplo_sqr accepted a packed matrix that it cannot read" << std::endl;
+    success = false;
+  }
+
+  // a count of the differences between two vectors
+  result[0] = 0.0f;
+  engine.vect_bbB(Ferrum::FunctionID::vector_equals, a, length, 0, 1, a, length, 0, 1, result, 1, 0, 1);
+  success &= (result[0] == 0.0f);
+  std::cout << "vector_equals (same): " << result[0] << std::endl;
+  engine.vect_bbB(Ferrum::FunctionID::vector_equals, a, length, 0, 1, b, length, 0, 1, result, 1, 0, 1);
+  success &= (result[0] != 0.0f);
+  std::cout << "vector_equals (different): " << result[0] << std::endl;
+
+  // the wrong dispatch function is rejected
+  if (engine.vect_bB(Ferrum::FunctionID::vector_add, a, n, 0, 1, result, n, 0, 1) != nullptr) {
+    std::cout << "vector_add accepted a single argument" << std::endl;
+    success = false;
+  }
+
+  delete[] expectedSines;
+  delete[] sines;
+  delete[] expected;
+  delete[] result;
+  delete[] b;
+  delete[] a;
+
+  std::cout << (success ? "Success!" : "Failed!") << std::endl;
+  return success ? 0 : 1;
+}
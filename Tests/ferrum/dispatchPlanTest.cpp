@@ -0,0 +1,131 @@
+#include <climits>
+#include <iostream>
+#include <vector>
+
+#include "dispatch_plan.hpp"
+
+// Checks the dispatch and chunking plans over a range of job sizes and pipeline limits.
+// This has no Metal dependency, so it runs on any platform.
+
+bool checkDispatch(Ferrum::Grid grid, size_t width, size_t maxThreads) {
+  Ferrum::DispatchPlan plan = Ferrum::planDispatch(grid, width, maxThreads);
+  Ferrum::Grid group = plan.threadsPerGroup;
+  bool ok = plan.threads.width == grid.width && plan.threads.height == grid.height;
+  ok &= group.width >= 1 && group.height >= 1;
+  ok &= group.width * group.height <= maxThreads;
+  if (grid.height == 1) {
+    // whole SIMD groups, and never more than one group beyond the end of the job
+    ok &= group.width % width == 0;
+    ok &= group.width < grid.width + width;
+  } else {
+    ok &= group.width <= width && group.width <= grid.width && group.height <= grid.height;
+  }
+  if (!ok) {
+    std::cout << "Bad plan for " << grid.width << "x" << grid.height << " (width " << width << ", max " << maxThreads
+              << "): groups of " << group.width << "x" << group.height << std::endl;
+  }
+  return ok;
+}
+
+bool checkReduction(size_t count, size_t maxThreads) {
+  Ferrum::ReductionPlan plan = Ferrum::planReduction(count, maxThreads);
+  size_t threads = plan.threadsPerGroup;
+  // whole powers of two, and no more partial results than the second pass can hold
+  bool ok = threads >= 1 && (threads & (threads - 1)) == 0;
+  ok &= threads <= maxThreads && threads <= Ferrum::MAX_REDUCTION_THREADS;
+  ok &= plan.groups >= 1 && plan.groups <= threads;
+  ok &= count <= threads || plan.groups * threads >= std::min(count, threads * threads);
+  if (!ok) {
+    std::cout << "Bad reduction for " << count << " (max " << maxThreads << "): " << plan.groups
+              << " groups of " << threads << std::endl;
+  }
+  return ok;
+}
+
+bool checkChunks(size_t count, size_t grain, size_t threads) {
+  Ferrum::ChunkPlan plan = Ferrum::planChunks(count, grain, threads);
+  bool ok = true;
+  if (count == 0) {
+    ok = plan.chunks == 0;
+  } else {
+    // the chunks cover the range exactly, with none empty
+    ok &= plan.chunks >= 1 && plan.chunks <= threads;
+    ok &= plan.chunkSize * (plan.chunks - 1) < count && plan.chunkSize * plan.chunks >= count;
+    ok &= plan.chunks == 1 || plan.chunkSize >= grain;
+  }
+  if (!ok) {
+    std::cout << "Bad chunks for " << count << " (grain " << grain << ", threads " << threads << "): "
+              << plan.chunks << " of " << plan.chunkSize << std::endl;
+  }
+  return ok;
+}
+
+int main(void) {
+  bool success = true;
+  std::vector<size_t> sizes = {1, 2, 3, 31, 32, 33, 100, 1000, 1024, 1025, 65537, 10000000};
+
+  for (size_t width : {1, 16, 32, 64}) {
+    for (size_t maxThreads : {32, 256, 1024}) {
+      if (maxThreads < width) {
+        continue;
+      }
+      for (size_t n : sizes) {
+        success &= checkDispatch({n, 1}, width, maxThreads);
+        for (size_t m : {2, 7, 1000}) {
+          success &= checkDispatch({n, m}, width, maxThreads);
+        }
+      }
+    }
+  }
+  Ferrum::DispatchPlan empty = Ferrum::planDispatch({0, 1}, 32, 1024);
+  success &= empty.threads.width == 0;
+
+  // large vectors use full threadgroups
+  Ferrum::DispatchPlan large = Ferrum::planDispatch({1000000, 1}, 32, 1024);
+  std::cout << "1000000 elements: groups of " << large.threadsPerGroup.width << std::endl;
+  success &= large.threadsPerGroup.width == 1024;
+
+  for (size_t maxThreads : {1, 32, 100, 256, 1024}) {
+    success &= checkReduction(0, maxThreads);
+    for (size_t n : sizes) {
+      success &= checkReduction(n, maxThreads);
+    }
+  }
+  Ferrum::ReductionPlan reduction = Ferrum::planReduction(10000000, 1024);
+  std::cout << "10000000 element reduction: " << reduction.groups << " groups of " << reduction.threadsPerGroup << std::endl;
+  success &= reduction.groups == 256 && reduction.threadsPerGroup == 256;
+
+  // reproducible reductions have a threadgroup for each block, whatever the device allows
+  success &= Ferrum::planReproducibleReduction(0).groups == 1;
+  success &= Ferrum::planReproducibleReduction(Ferrum::REPRODUCIBLE_BLOCK).groups == 1;
+  success &= Ferrum::planReproducibleReduction(Ferrum::REPRODUCIBLE_BLOCK + 1).groups == 2;
+  success &= Ferrum::planReproducibleReduction(10000000).threadsPerGroup == Ferrum::REPRODUCIBLE_LANES;
+
+  // matrix products have a threadgroup for each tile of c, including partial tiles
+  success &= Ferrum::gemmGroups(1, 1).width == 1 && Ferrum::gemmGroups(1, 1).height == 1;
+  success &= Ferrum::gemmGroups(Ferrum::GEMM_TILE, Ferrum::GEMM_TILE + 1).width == 1;
+  success &= Ferrum::gemmGroups(Ferrum::GEMM_TILE, Ferrum::GEMM_TILE + 1).height == 2;
+
+  for (size_t threads : {1, 2, 3, 8, 13}) {
+    for (size_t grain : {1, 100, 16384}) {
+      success &= checkChunks(0, grain, threads);
+      for (size_t n : sizes) {
+        success &= checkChunks(n, grain, threads);
+      }
+    }
+  }
+  success &= Ferrum::columnGrain(100, 16384) == 163;
+  success &= Ferrum::columnGrain(100000, 16384) == 1;
+
+  // the vector count used to size a grid
+  success &= Ferrum::vectorCount(10, 0, 1) == 10;
+  success &= Ferrum::vectorCount(10, 1, 3) == 3;
+  success &= Ferrum::vectorCount(10, 10, 1) == 0;
+  success &= Ferrum::vectorCount(10, 0, 0) == 0;
+  // strides near INT_MAX, where len - offset + stride - 1 would overflow an int
+  success &= Ferrum::vectorCount(INT_MAX, 0, INT_MAX) == 1;
+  success &= Ferrum::vectorCount(INT_MAX, 1, INT_MAX - 1) == 1;
+
+  std::cout << (success ? "Success!" : "Failed!") << std::endl;
+  return success ? 0 : 1;
+}
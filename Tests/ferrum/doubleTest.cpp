@@ -0,0 +1,229 @@
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "cpu_engine.hpp"
+#include "recording_engine.hpp"
+
+// Checks the double precision functions of the CPU engine against values calculated directly,
+// to a tolerance that float results could not meet
+
+bool check(const char* name, const std::vector<double>& actual, const std::vector<double>& expected,
+           double tolerance = 1e-13) {
+  for (size_t i = 0; i < expected.size(); i++) {
+    if (!(std::fabs(actual[i] - expected[i]) <= tolerance * std::fmax(1.0, std::fabs(expected[i])))) {
+      std::cout << name << ": element " << i << " is " << actual[i] << ", expected " << expected[i] << std::endl;
+      return false;
+    }
+  }
+  std::cout << name << ": OK" << std::endl;
+  return true;
+}
+
+std::vector<double> fill(size_t size, double seed) {
+  std::vector<double> data(size);
+  for (size_t i = 0; i < size; i++) {
+    data[i] = 0.5 + 0.4 * std::sin(seed + i * 0.37);
+  }
+  return data;
+}
+
+// Equal, or both NaN
+bool same(double x, double y) {
+  return (std::isnan(x) && std::isnan(y)) || x == y;
+}
+
+bool truncation(Ferrum::CpuEngine& engine) {
+  const double values[] = {1e20, -1e20, 5e9, -3.75, 0.5, NAN, INFINITY, -INFINITY};
+  // a few vectors long, so the SIMD kernels see every value
+  const int length = 64;
+  std::vector<double> x(length), frac(length), whole(length), part(length);
+  std::vector<float> xf(length), fracf(length), wholef(length), partf(length);
+  for (int i = 0; i < length; i++) {
+    x[i] = values[i % 8];
+    xf[i] = (float)x[i];
+  }
+  bool ok = true;
+  for (int pass = 0; pass < 4 && ok; pass++) {
+    bool matrix = pass % 2 == 1;
+    bool single = pass >= 2;
+    if (!single && !matrix) {
+      engine.dvect_bB(Ferrum::FunctionID::vector_frac, x.data(), length, 0, 1, frac.data(), length, 0, 1);
+      engine.dvect_bBB(Ferrum::FunctionID::vector_modf, x.data(), length, 0, 1, whole.data(), length, 0, 1,
+                       part.data(), length, 0, 1);
+    } else if (!single) {
+      engine.dge_bB(Ferrum::FunctionID::ge_frac, 8, 8, x.data(), length, 0, 8, frac.data(), length, 0, 8);
+      engine.dge_bBB(Ferrum::FunctionID::ge_modf, 8, 8, x.data(), length, 0, 8, whole.data(), length, 0, 8,
+                     part.data(), length, 0, 8);
+    } else if (!matrix) {
+      engine.vect_bB(Ferrum::FunctionID::vector_frac, xf.data(), length, 0, 1, fracf.data(), length, 0, 1);
+      engine.vect_bBB(Ferrum::FunctionID::vector_modf, xf.data(), length, 0, 1, wholef.data(), length, 0, 1,
+                      partf.data(), length, 0, 1);
+    } else {
+      engine.ge_bB(Ferrum::FunctionID::ge_frac, 8, 8, xf.data(), length, 0, 8, fracf.data(), length, 0, 8);
+      engine.ge_bBB(Ferrum::FunctionID::ge_modf, 8, 8, xf.data(), length, 0, 8, wholef.data(), length, 0, 8,
+                    partf.data(), length, 0, 8);
+    }
+    for (int i = 0; i < length && ok; i++) {
+      double input = single ? xf[i] : x[i];
+      double expected = input - std::trunc(input);
+      double actual[3] = {single ? fracf[i] : frac[i], single ? wholef[i] : whole[i], single ? partf[i] : part[i]};
+      ok = same(actual[0], expected) && same(actual[1], std::trunc(input)) && same(actual[2], expected);
+      if (!ok) {
+        std::cout << (single ? "float " : "double ") << (matrix ? "ge" : "vector") << " frac and modf of " << input
+                  << " are " << actual[0] << " and " << actual[1] << " + " << actual[2] << std::endl;
+      }
+    }
+  }
+  std::cout << "frac and modf of huge, NaN and Inf: " << (ok ? "OK" : "wrong") << std::endl;
+  return ok;
+}
+
+int main(void) {
+  Ferrum::CpuEngine engine(3);
+  bool success = engine.doublePrecision();
+
+  // large enough to be split across threads
+  const int length = 100000;
+  std::vector<double> a = fill(length, 0.1);
+  std::vector<double> b = fill(length, 0.7);
+  std::vector<double> result(length), expected(length);
+
+  for (int i = 0; i < length; i++) {
+    expected[i] = a[i] + b[i];
+  }
+  engine.dvect_bbB(Ferrum::FunctionID::vector_add, a.data(), length, 0, 1, b.data(), length, 0, 1,
+                   result.data(), length, 0, 1);
+  success &= check("vector_add", result, expected);
+
+  for (int i = 0; i < length; i++) {
+    expected[i] = std::exp(a[i]);
+  }
+  engine.dvect_bB(Ferrum::FunctionID::vector_exp, a.data(), length, 0, 1, result.data(), length, 0, 1);
+  success &= check("vector_exp", result, expected);
+
+  // the functions that float approximates use libm in double
+  for (int i = 0; i < length; i++) {
+    expected[i] = std::erf(a[i]);
+  }
+  engine.dvect_bB(Ferrum::FunctionID::vector_erf, a.data(), length, 0, 1, result.data(), length, 0, 1);
+  success &= check("vector_erf", result, expected);
+
+  for (int i = 0; i < length; i++) {
+    expected[i] = std::tgamma(a[i]);
+  }
+  engine.dvect_bB(Ferrum::FunctionID::vector_gamma, a.data(), length, 0, 1, result.data(), length, 0, 1);
+  success &= check("vector_gamma", result, expected);
+
+  // strided with offsets, and scalar arguments
+  const int n = 1000;
+  std::vector<double> strided(3 + n * 2, -1.0);
+  std::vector<double> expectedStrided = strided;
+  for (int i = 0; i < n; i++) {
+    expectedStrided[3 + i * 2] = (0.1 * a[1 + i * 5] + 3.0) / (2.0 * b[i] + 0.25);
+  }
+  engine.dvect_bbffffB(Ferrum::FunctionID::vector_linear_frac, a.data(), 1 + n * 5, 1, 5, b.data(), n, 0, 1,
+                       0.1, 3.0, 2.0, 0.25, strided.data(), strided.size(), 3, 2);
+  success &= check("vector_linear_frac", strided, expectedStrided);
+
+  // two results
+  std::vector<double> sines(n), cosines(n), expectedSines(n), expectedCosines(n);
+  for (int i = 0; i < n; i++) {
+    expectedSines[i] = std::sin(a[i]);
+    expectedCosines[i] = std::cos(a[i]);
+  }
+  engine.dvect_bBB(Ferrum::FunctionID::vector_sincos, a.data(), n, 0, 1, sines.data(), n, 0, 1, cosines.data(), n, 0, 1);
+  success &= check("vector_sincos (sin)", sines, expectedSines);
+  success &= check("vector_sincos (cos)", cosines, expectedCosines);
+
+  // reductions keep the precision that float loses
+  std::vector<double> value(1);
+  std::vector<double> cancel = {1e9, 1e-3, -1e9};
+  engine.dvect_bB(Ferrum::FunctionID::vector_sum, cancel.data(), 3, 0, 1, value.data(), 1, 0, 1);
+  success &= check("vector_sum (cancelling)", value, {1e-3}, 1e-6);
+
+  double dot = 0.0;
+  for (int i = 0; i < length; i++) {
+    dot += a[i] * b[i];
+  }
+  engine.dvect_bbB(Ferrum::FunctionID::vector_dot, a.data(), length, 0, 1, b.data(), length, 0, 1, value.data(), 1, 0, 1);
+  success &= check("vector_dot", value, {dot}, 1e-12);
+
+  std::vector<double> peak = fill(length, 0.4);
+  peak[77777] = 2.0;
+  engine.dvect_bB(Ferrum::FunctionID::vector_iamax, peak.data(), length, 0, 1, value.data(), 1, 0, 1);
+  success &= check("vector_iamax", value, {77777.0});
+
+  // the sum is the same for any number of threads, with reproducible sums on or off
+  engine.dvect_bB(Ferrum::FunctionID::vector_sum, a.data(), length, 0, 1, value.data(), 1, 0, 1);
+  double sum = value[0];
+  for (int threads : {0, 1, 7}) {
+    Ferrum::CpuEngine other(threads);
+    other.setReproducible(threads == 7);
+    other.dvect_bB(Ferrum::FunctionID::vector_sum, a.data(), length, 0, 1, value.data(), 1, 0, 1);
+    std::cout << "vector_sum (" << threads << " threads): " << (value[0] == sum ? "OK" : "different") << std::endl;
+    success &= value[0] == sum;
+  }
+
+  // general matrix: 30x20 inside a buffer with a leading dimension of 40
+  const int sd = 30, fd = 20, ld = 40;
+  std::vector<double> matrix(ld * fd, -1.0);
+  std::vector<double> expectedMatrix = matrix;
+  for (int j = 0; j < fd; j++) {
+    for (int i = 0; i < sd; i++) {
+      expectedMatrix[i + j * ld] = a[i + j * ld] * b[i + j * ld];
+    }
+  }
+  engine.dge_bbB(Ferrum::FunctionID::ge_mul, sd, fd, a.data(), ld * fd, 0, ld, b.data(), ld * fd, 0, ld,
+                 matrix.data(), ld * fd, 0, ld);
+  success &= check("ge_mul", matrix, expectedMatrix);
+
+  // uplo: the lower triangle of a 30x30 matrix, squared into packed storage
+  std::vector<double> packed(Ferrum::packedLength(sd), -1.0);
+  std::vector<double> expectedPacked(packed.size());
+  for (int j = 0; j < sd; j++) {
+    for (int i = j; i < sd; i++) {
+      expectedPacked[Ferrum::uploIndex(i, j, Ferrum::PACKED, sd, 1)] = a[i + j * ld] * a[i + j * ld];
+    }
+  }
+  engine.duplo_bB(Ferrum::FunctionID::uplo_sqr, sd, 0, 1, a.data(), ld * sd, 0, ld,
+                  packed.data(), packed.size(), 0, Ferrum::PACKED);
+  success &= check("uplo_sqr (packed)", packed, expectedPacked);
+
+  // bad arguments and batches are rejected
+  if (engine.dvect_bB(Ferrum::FunctionID::vector_add, a.data(), n, 0, 1, result.data(), n, 0, 1) != nullptr) {
+    std::cout << "dvect_bB accepted the wrong arguments" << std::endl;
+    success = false;
+  }
+  if (engine.dge_bB(Ferrum::FunctionID::ge_sqr, 50, 50, a.data(), 100, 0, 50, result.data(), length, 0, 50) != nullptr) {
+    std::cout << "dge_bB accepted a matrix past the end of its buffer" << std::endl;
+    success = false;
+  }
+  success &= engine.beginBatch();
+  if (engine.dvect_bB(Ferrum::FunctionID::vector_sqr, a.data(), n, 0, 1, result.data(), n, 0, 1) != nullptr) {
+    std::cout << "dvect_bB ran in a batch" << std::endl;
+    success = false;
+  }
+  success &= engine.commitBatch();
+
+  // frac and modf of values that no integer type can hold agree between the double kernels, the
+  // float SIMD kernels of vectors and the scalar float kernels of matrices
+  success &= truncation(engine);
+
+  // the recording engine passes the functions through, with their scalars
+  Ferrum::RecordingEngine recording(new Ferrum::CpuEngine(2));
+  std::vector<double> shifted(n), expectedShifted(n);
+  for (int i = 0; i < n; i++) {
+    expectedShifted[i] = 0.1 * a[i] + 0.2;
+  }
+  recording.dvect_bffffB(Ferrum::FunctionID::vector_scale_shift, a.data(), n, 0, 1, 0.1, 0.2, 0.0, 0.0,
+                         shifted.data(), n, 0, 1);
+  success &= check("vector_scale_shift (recording)", shifted, expectedShifted);
+  std::vector<Ferrum::RecordedCall> calls = recording.calls();
+  success &= recording.doublePrecision() && calls.size() == 1 && std::string(calls[0].dispatch) == "dvect_bffffB" &&
+             calls[0].scalars[0] == 0.1;
+
+  std::cout << (success ? "Success!" : "Failed!") << std::endl;
+  return success ? 0 : 1;
+}
@@ -0,0 +1,113 @@
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "cpu_engine.hpp"
+#include "fusion.hpp"
+#include "recording_engine.hpp"
+
+// Fuses relu(exp(0.5 * x + 1) * y) into one pass, and checks it against the separate calls
+
+using Ferrum::FunctionID;
+
+// Runs the chain as separate calls, with a temporary for each step
+void unfused(Ferrum::Engine* engine, std::vector<float>& x, std::vector<float>& y, std::vector<float>& result) {
+  int n = x.size();
+  std::vector<float> t1(n), t2(n), t3(n);
+  engine->vect_bffffB(FunctionID::vector_scale_shift, x.data(), n, 0, 1, 0.5f, 1.0f, 0.0f, 0.0f, t1.data(), n, 0, 1);
+  engine->vect_bB(FunctionID::vector_exp, t1.data(), n, 0, 1, t2.data(), n, 0, 1);
+  engine->vect_bbB(FunctionID::vector_mul, t2.data(), n, 0, 1, y.data(), n, 0, 1, t3.data(), n, 0, 1);
+  engine->vect_fbB(FunctionID::vector_relu, 0.1f, t3.data(), n, 0, 1, result.data(), n, 0, 1);
+}
+
+Ferrum::FusedExpr chain(float alpha) {
+  Ferrum::FusedExpr e;
+  int x = e.input();
+  int y = e.input();
+  int s = e.apply(FunctionID::vector_scale_shift, {x}, {0.5f, 1.0f, 0.0f, 0.0f});
+  int m = e.apply(FunctionID::vector_mul, {e.apply(FunctionID::vector_exp, {s}), y});
+  e.apply(FunctionID::vector_relu, {m}, {alpha});
+  return e;
+}
+
+double millis(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(void) {
+  Ferrum::CpuEngine cpu(2);
+  Ferrum::Engine* engine = &cpu;
+  bool success = true;
+
+  const int length = 1 << 21;
+  std::vector<float> x(length), y(length), expected(length), result(length);
+  for (int i = 0; i < length; i++) {
+    x[i] = ((i % 200) - 100) * 0.02f;
+    y[i] = ((i % 7) - 3) * 0.5f;
+  }
+
+  Ferrum::FusedExpr e = chain(0.1f);
+  success &= e.valid() && e.inputCount() == 2 && e.nodes().size() == 6;
+  std::vector<Ferrum::FusedInput> inputs = {{x.data(), length, 0, 1}, {y.data(), length, 0, 1}};
+
+  auto start = std::chrono::steady_clock::now();
+  unfused(engine, x, y, expected);
+  double separate = millis(start);
+  start = std::chrono::steady_clock::now();
+  success &= engine->vect_fused(e, inputs, result.data(), length, 0, 1) == result.data();
+  double fused = millis(start);
+  for (int i = 0; i < length; i++) {
+    if (result[i] != expected[i]) {
+      std::cout << "Element " << i << " is " << result[i] << ", expected " << expected[i] << std::endl;
+      success = false;
+      break;
+    }
+  }
+  std::cout << "relu(exp(0.5x + 1) * y): " << result[0] << ", " << result[150] << ", " << result[199] << " ..." << std::endl;
+  std::cout << "Separate calls: " << separate << "ms, fused: " << fused << "ms" << std::endl;
+
+  // strided input and output
+  std::vector<float> half(length / 2);
+  std::vector<Ferrum::FusedInput> strided = {{x.data(), length, 1, 2}, {y.data(), length, 1, 2}};
+  success &= engine->vect_fused(e, strided, half.data(), length / 2, 0, 1) != nullptr;
+  success &= half[10] == expected[21] && half[length / 2 - 1] == expected[length - 1];
+
+  // nodes that the result does not use are never evaluated
+  Ferrum::FusedExpr dead;
+  int a = dead.input();
+  int unused = dead.apply(FunctionID::vector_log, {a});
+  int sq = dead.apply(FunctionID::vector_sqr, {a});
+  success &= !dead.live()[unused] && dead.live()[sq];
+  std::vector<Ferrum::FusedInput> one = {{x.data(), length, 0, 1}};
+  success &= engine->vect_fused(dead, one, result.data(), length, 0, 1) != nullptr;
+  success &= result[3] == x[3] * x[3];
+
+  // only elementwise functions with one result can be fused
+  Ferrum::FusedExpr bad;
+  int b = bad.input();
+  success &= bad.apply(FunctionID::vector_sincos, {b, b}) == -1;
+  success &= bad.apply(FunctionID::vector_exp, {b, b}) == -1;
+  success &= !bad.valid();
+  success &= engine->vect_fused(bad, one, result.data(), length, 0, 1) == nullptr;
+
+  // kernels are shared by expressions that only differ in their scalars
+  success &= chain(0.1f).shape() == chain(0.2f).shape() && chain(0.1f).shape() != dead.shape();
+  std::string source = Ferrum::fusedMetalSource(e, "fused");
+  success &= source.find("kernel void fused") != std::string::npos;
+  success &= source.find("const REAL t3 = exp(t2);") != std::string::npos;
+  success &= source.find("fmax(t4, s[20] * t4)") != std::string::npos;
+  success &= source.find("result[offsets[2] + id * strides[2]] = t5;") != std::string::npos;
+  std::cout << source << std::endl;
+
+  // fused calls are recorded with each node's function
+  Ferrum::RecordingEngine recorder;
+  recorder.vect_fused(e, inputs, result.data(), length, 0, 1);
+  auto calls = recorder.calls();
+  success &= calls.size() == 1 && std::string(calls[0].dispatch) == "vect_fused" &&
+             calls[0].dims.size() == 6 && calls[0].dims[3] == FunctionID::vector_exp && calls[0].buffers.size() == 9;
+
+  std::cout << (success ? "Success!" : "Failed!") << std::endl;
+  return success ? 0 : 1;
+}
@@ -0,0 +1,177 @@
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "cpu_engine.hpp"
+#include "recording_engine.hpp"
+
+// Checks ge_gemm against products calculated directly, for each transpose, for sizes that do not
+// fill the register tiles or cache blocks, and for matrices inside larger buffers
+
+// A column major matrix of rows x cols, with ld >= rows, starting at offset in its buffer
+struct Matrix {
+  int rows;
+  int cols;
+  int offset;
+  int ld;
+  std::vector<float> data;
+
+  Matrix(int rows, int cols, int offset, int ld, float seed) :
+      rows(rows), cols(cols), offset(offset), ld(ld), data(offset + (size_t)ld * cols + 3) {
+    for (size_t i = 0; i < data.size(); i++) {
+      data[i] = std::sin(seed + i * 0.37f);
+    }
+  }
+
+  float at(int i, int j) const { return data[offset + i + (size_t)j * ld]; }
+};
+
+// Runs alpha * op(a) * op(b) + beta * c and compares every element of c, and that the rest of
+// its buffer is untouched
+bool check(Ferrum::Engine& engine, bool transA, bool transB, int m, int n, int k,
+           float alpha, float beta, bool nanC = false) {
+  Matrix a(transA ? k : m, transA ? m : k, 3, (transA ? k : m) + 2, 0.1f);
+  Matrix b(transB ? n : k, transB ? k : n, 1, (transB ? n : k) + 1, 0.7f);
+  Matrix c(m, n, 2, m + 5, 1.3f);
+  if (nanC) {
+    for (int j = 0; j < n; j++) {
+      for (int i = 0; i < m; i++) {
+        c.data[c.offset + i + (size_t)j * c.ld] = NAN;
+      }
+    }
+  }
+  std::vector<float> before = c.data;
+
+  float* r = engine.ge_gemm(transA, transB, m, n, k, alpha,
+                            a.data.data(), a.data.size(), a.offset, a.ld,
+                            b.data.data(), b.data.size(), b.offset, b.ld,
+                            beta, c.data.data(), c.data.size(), c.offset, c.ld);
+  std::cout << "ge_gemm " << (transA ? "T" : "N") << (transB ? "T" : "N") << " " << m << "x" << n << "x" << k
+            << " alpha " << alpha << " beta " << beta << (nanC ? " (NaN c)" : "") << ": ";
+  if (r != c.data.data()) {
+    std::cout << "failed to run" << std::endl;
+    return false;
+  }
+
+  int errors = 0;
+  for (size_t e = 0; e < c.data.size(); e++) {
+    ptrdiff_t index = (ptrdiff_t)e - c.offset;
+    int i = index >= 0 ? index % c.ld : -1;
+    int j = index >= 0 ? index / c.ld : -1;
+    if (index < 0 || i >= m || j >= n) {
+      if (std::memcmp(&c.data[e], &before[e], sizeof(float)) != 0) {
+        errors++;
+      }
+      continue;
+    }
+    double expected = 0.0;
+    double magnitude = 0.0;
+    for (int p = 0; p < k; p++) {
+      double product = (double)(transA ? a.at(p, i) : a.at(i, p)) * (transB ? b.at(j, p) : b.at(p, j));
+      expected += product;
+      magnitude += std::fabs(product);
+    }
+    expected *= alpha;
+    if (beta != 0.0f) {
+      expected += (double)beta * before[e];
+    }
+    double tolerance = 1e-5 * (std::fabs(alpha) * magnitude + std::fabs(beta) + 1.0);
+    if (!(std::fabs(c.data[e] - expected) <= tolerance)) {
+      if (errors == 0) {
+        std::cout << "(" << i << ", " << j << ") is " << c.data[e] << ", expected " << expected << "; ";
+      }
+      errors++;
+    }
+  }
+  std::cout << (errors == 0 ? "ok" : std::to_string(errors) + " errors") << std::endl;
+  return errors == 0;
+}
+
+int main(void) {
+  bool success = true;
+  Ferrum::CpuEngine engine(3);
+  std::cout << "Instruction set: " << Ferrum::isaName(engine.instructionSet()) << std::endl;
+
+  // sizes around the register tiles, and larger than the cache blocks in each dimension
+  int sizes[][3] = {{1, 1, 1}, {5, 3, 2}, {37, 53, 29}, {64, 64, 64}, {130, 70, 300}, {17, 4200, 9}};
+  for (auto& size : sizes) {
+    for (int t = 0; t < 4; t++) {
+      success &= check(engine, t & 1, t & 2, size[0], size[1], size[2], 1.0f, 0.0f);
+    }
+  }
+  success &= check(engine, false, false, 37, 53, 29, 0.5f, -2.0f);
+  success &= check(engine, true, true, 130, 70, 300, -1.5f, 0.25f);
+  success &= check(engine, false, true, 37, 53, 29, 1.0f, 1.0f);
+  // a zero beta does not read c, so NaN there does not carry into the result
+  success &= check(engine, false, false, 37, 53, 29, 2.0f, 0.0f, true);
+  success &= check(engine, true, false, 37, 53, 0, 1.0f, 0.0f, true);
+  // with no inner dimension or a zero alpha, c is only scaled
+  success &= check(engine, false, false, 20, 10, 0, 1.0f, 3.0f);
+  success &= check(engine, false, false, 20, 10, 15, 0.0f, 3.0f);
+  // empty products
+  success &= check(engine, false, false, 0, 10, 15, 1.0f, 1.0f);
+  success &= check(engine, false, false, 10, 0, 15, 1.0f, 1.0f);
+
+  // any number of threads
+  for (int threads : {0, 1, 7}) {
+    Ferrum::CpuEngine other(threads);
+    success &= check(other, true, false, 130, 70, 300, 1.0f, 0.5f);
+  }
+
+  // matrices that do not fit are rejected
+  std::vector<float> small(16);
+  if (engine.ge_gemm(0, 0, 4, 4, 4, 1.0f, small.data(), 16, 1, 4, small.data(), 16, 0, 4,
+                     0.0f, small.data(), 16, 0, 4) != nullptr) {
+    std::cout << "ge_gemm accepted a matrix past the end of its buffer" << std::endl;
+    success = false;
+  }
+  if (engine.ge_gemm(0, 0, -1, 4, 4, 1.0f, small.data(), 16, 0, 4, small.data(), 16, 0, 4,
+                     0.0f, small.data(), 16, 0, 4) != nullptr) {
+    std::cout << "ge_gemm accepted a negative size" << std::endl;
+    success = false;
+  }
+
+  // in a batch, a product can use the result of the function before it
+  Ferrum::Tensor* a = engine.newTensor(4);
+  Ferrum::Tensor* c = engine.newTensor(4);
+  success &= engine.beginBatch();
+  engine.vect_fbB(Ferrum::FunctionID::vector_set, 1.0f, a->data, 4, 0, 1, a->data, 4, 0, 1);
+  engine.ge_gemm(0, 0, 2, 2, 2, 1.0f, a->data, 4, 0, 2, a->data, 4, 0, 2, 0.0f, c->data, 4, 0, 2);
+  success &= engine.commitBatch();
+  std::cout << "ge_gemm (batch): " << c->data[0] << " " << c->data[3] << std::endl;
+  success &= c->data[0] == 2.0f && c->data[3] == 2.0f;
+  engine.releaseTensor(a);
+  engine.releaseTensor(c);
+
+  // the recording engine passes products through
+  Ferrum::RecordingEngine recording(new Ferrum::CpuEngine(2));
+  success &= check(recording, false, true, 5, 3, 2, 1.0f, 0.0f);
+  std::vector<Ferrum::RecordedCall> calls = recording.calls();
+  success &= calls.size() == 1 && calls[0].id == Ferrum::FunctionID::ge_gemm &&
+             calls[0].dims == std::vector<int>({0, 1, 5, 3, 2});
+
+  // a large product
+  const int size = 1024;
+  const int repeats = 3;
+  std::vector<float> x((size_t)size * size), y((size_t)size * size), z((size_t)size * size);
+  for (size_t i = 0; i < x.size(); i++) {
+    x[i] = std::sin(i * 0.01f);
+    y[i] = std::cos(i * 0.01f);
+  }
+  for (bool transA : {false, true}) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < repeats; i++) {
+      engine.ge_gemm(transA, 0, size, size, size, 1.0f, x.data(), x.size(), 0, size,
+                     y.data(), y.size(), 0, size, 0.0f, z.data(), z.size(), 0, size);
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    double seconds = elapsed.count() / repeats;
+    std::cout << "ge_gemm " << (transA ? "T" : "N") << "N of " << size << "x" << size << ": "
+              << seconds * 1000.0 << "ms, " << 2.0 * size * size * size / seconds / 1e9 << " GFLOPS" << std::endl;
+  }
+
+  std::cout << (success ? "Success!" : "Failed!") << std::endl;
+  return success ? 0 : 1;
+}
@@ -0,0 +1,203 @@
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "cpu_engine.hpp"
+#include "recording_engine.hpp"
+
+// Checks ge_mv and ge_rk against results calculated directly, with and without a transpose, for
+// strided vectors and for matrices inside larger buffers
+
+std::vector<float> fill(size_t size, float seed) {
+  std::vector<float> data(size);
+  for (size_t i = 0; i < size; i++) {
+    data[i] = std::sin(seed + i * 0.37f);
+  }
+  return data;
+}
+
+// Checks count elements of a strided vector, or of a matrix when ld is not zero, against the
+// expected values, and that nothing else in the buffer has changed
+int compare(const std::vector<float>& actual, const std::vector<float>& before, const std::vector<double>& expected,
+            const std::vector<double>& magnitude, int offset, int stride, int rows, int ld) {
+  std::vector<bool> checked(actual.size(), false);
+  int errors = 0;
+  for (size_t e = 0; e < expected.size(); e++) {
+    size_t index = (ld == 0) ? offset + e * stride : offset + (e % rows) + (e / rows) * ld;
+    checked[index] = true;
+    if (!(std::fabs(actual[index] - expected[e]) <= 1e-5 * (magnitude[e] + 1.0))) {
+      if (errors == 0) {
+        std::cout << "element " << e << " is " << actual[index] << ", expected " << expected[e] << "; ";
+      }
+      errors++;
+    }
+  }
+  for (size_t i = 0; i < actual.size(); i++) {
+    if (!checked[i] && std::memcmp(&actual[i], &before[i], sizeof(float)) != 0) {
+      errors++;
+    }
+  }
+  return errors;
+}
+
+bool checkMv(Ferrum::Engine& engine, bool trans, int m, int n, float alpha, float beta,
+             int strideX, int strideY, bool nanY = false) {
+  int ld = m + 3;
+  int lengthX = trans ? m : n;
+  int lengthY = trans ? n : m;
+  std::vector<float> a = fill(2 + (size_t)ld * n, 0.1f);
+  std::vector<float> x = fill(1 + (size_t)lengthX * strideX, 0.5f);
+  std::vector<float> y = fill(2 + (size_t)lengthY * strideY, 0.9f);
+  if (nanY) {
+    for (int i = 0; i < lengthY; i++) {
+      y[2 + i * strideY] = NAN;
+    }
+  }
+  std::vector<float> before = y;
+
+  std::vector<double> expected(lengthY), magnitude(lengthY);
+  for (int e = 0; e < lengthY; e++) {
+    double sum = 0.0, size = 0.0;
+    for (int p = 0; p < lengthX; p++) {
+      double product = (double)(trans ? a[2 + p + e * ld] : a[2 + e + p * ld]) * x[1 + p * strideX];
+      sum += product;
+      size += std::fabs(product);
+    }
+    expected[e] = alpha * sum + (beta == 0.0f ? 0.0 : (double)beta * before[2 + e * strideY]);
+    magnitude[e] = std::fabs(alpha) * size + std::fabs(beta);
+  }
+
+  float* r = engine.ge_mv(trans, m, n, alpha, a.data(), a.size(), 2, ld, x.data(), x.size(), 1, strideX,
+                          beta, y.data(), y.size(), 2, strideY);
+  std::cout << "ge_mv " << (trans ? "T " : "N ") << m << "x" << n << " alpha " << alpha << " beta " << beta
+            << " strides " << strideX << ", " << strideY << (nanY ? " (NaN y)" : "") << ": ";
+  if (r != y.data()) {
+    std::cout << "failed to run" << std::endl;
+    return false;
+  }
+  int errors = compare(y, before, expected, magnitude, 2, strideY, 0, 0);
+  std::cout << (errors == 0 ? "ok" : std::to_string(errors) + " errors") << std::endl;
+  return errors == 0;
+}
+
+bool checkRk(Ferrum::Engine& engine, int m, int n, float alpha, int strideX, int strideY) {
+  int ld = m + 2;
+  std::vector<float> x = fill(3 + (size_t)m * strideX, 0.3f);
+  std::vector<float> y = fill(1 + (size_t)n * strideY, 0.6f);
+  std::vector<float> a = fill(4 + (size_t)ld * n, 1.1f);
+  std::vector<float> before = a;
+
+  std::vector<double> expected((size_t)m * n), magnitude((size_t)m * n);
+  for (int j = 0; j < n; j++) {
+    for (int i = 0; i < m; i++) {
+      double product = (double)alpha * x[3 + i * strideX] * y[1 + j * strideY];
+      expected[i + (size_t)j * m] = before[4 + i + (size_t)j * ld] + product;
+      magnitude[i + (size_t)j * m] = std::fabs(product) + std::fabs(before[4 + i + (size_t)j * ld]);
+    }
+  }
+
+  float* r = engine.ge_rk(m, n, alpha, x.data(), x.size(), 3, strideX, y.data(), y.size(), 1, strideY,
+                          a.data(), a.size(), 4, ld);
+  std::cout << "ge_rk " << m << "x" << n << " alpha " << alpha << " strides " << strideX << ", " << strideY << ": ";
+  if (r != a.data()) {
+    std::cout << "failed to run" << std::endl;
+    return false;
+  }
+  int errors = compare(a, before, expected, magnitude, 4, 1, m, ld);
+  std::cout << (errors == 0 ? "ok" : std::to_string(errors) + " errors") << std::endl;
+  return errors == 0;
+}
+
+int main(void) {
+  bool success = true;
+  Ferrum::CpuEngine engine(3);
+  std::cout << "Instruction set: " << Ferrum::isaName(engine.instructionSet()) << std::endl;
+
+  // sizes around the vector width, and with more rows than are summed at once
+  int sizes[][2] = {{1, 1}, {5, 3}, {37, 53}, {1500, 70}, {70, 1500}, {3000, 2}};
+  for (auto& size : sizes) {
+    for (bool trans : {false, true}) {
+      success &= checkMv(engine, trans, size[0], size[1], 1.0f, 0.0f, 1, 1);
+    }
+    success &= checkRk(engine, size[0], size[1], 1.0f, 1, 1);
+  }
+  success &= checkMv(engine, false, 37, 53, 0.5f, -2.0f, 2, 3);
+  success &= checkMv(engine, true, 1500, 70, -1.5f, 0.25f, 3, 2);
+  success &= checkRk(engine, 37, 53, -0.75f, 2, 3);
+  // a zero beta does not read y
+  success &= checkMv(engine, false, 37, 53, 2.0f, 0.0f, 1, 1, true);
+  success &= checkMv(engine, true, 37, 53, 2.0f, 0.0f, 1, 2, true);
+  // with no columns or a zero alpha, y is only scaled
+  success &= checkMv(engine, false, 20, 0, 1.0f, 3.0f, 1, 1);
+  success &= checkMv(engine, true, 20, 10, 0.0f, 3.0f, 1, 1);
+  // empty results
+  success &= checkMv(engine, false, 0, 10, 1.0f, 1.0f, 1, 1);
+  success &= checkRk(engine, 0, 10, 1.0f, 1, 1);
+
+  for (int threads : {0, 1, 7}) {
+    Ferrum::CpuEngine other(threads);
+    success &= checkMv(other, false, 1500, 70, 1.0f, 0.5f, 1, 1);
+    success &= checkMv(other, true, 70, 1500, 1.0f, 0.5f, 1, 1);
+    success &= checkRk(other, 70, 1500, 1.0f, 1, 1);
+  }
+
+  // vectors that do not fit are rejected
+  std::vector<float> small(16);
+  if (engine.ge_mv(0, 4, 4, 1.0f, small.data(), 16, 0, 4, small.data(), 16, 0, 6,
+                   0.0f, small.data(), 16, 0, 1) != nullptr) {
+    std::cout << "ge_mv accepted a vector past the end of its buffer" << std::endl;
+    success = false;
+  }
+  if (engine.ge_rk(4, 4, 1.0f, small.data(), 16, 13, 1, small.data(), 16, 0, 1,
+                   small.data(), 16, 0, 4) != nullptr) {
+    std::cout << "ge_rk accepted a vector past the end of its buffer" << std::endl;
+    success = false;
+  }
+
+  // in a batch, each function sees the results of the one before it
+  Ferrum::Tensor* a = engine.newTensor(4);
+  Ferrum::Tensor* v = engine.newTensor(2);
+  Ferrum::Tensor* r = engine.newTensor(2);
+  std::memset(a->data, 0, 4 * sizeof(float));
+  success &= engine.beginBatch();
+  engine.vect_fbB(Ferrum::FunctionID::vector_set, 1.0f, v->data, 2, 0, 1, v->data, 2, 0, 1);
+  engine.ge_rk(2, 2, 3.0f, v->data, 2, 0, 1, v->data, 2, 0, 1, a->data, 4, 0, 2);
+  engine.ge_mv(0, 2, 2, 1.0f, a->data, 4, 0, 2, v->data, 2, 0, 1, 0.0f, r->data, 2, 0, 1);
+  success &= engine.commitBatch();
+  std::cout << "ge_rk then ge_mv (batch): " << r->data[0] << " " << r->data[1] << std::endl;
+  success &= r->data[0] == 6.0f && r->data[1] == 6.0f;
+  engine.releaseTensor(a);
+  engine.releaseTensor(v);
+  engine.releaseTensor(r);
+
+  // the recording engine passes the functions through
+  Ferrum::RecordingEngine recording(new Ferrum::CpuEngine(2));
+  success &= checkMv(recording, true, 5, 3, 1.0f, 0.0f, 1, 1);
+  success &= checkRk(recording, 5, 3, 1.0f, 1, 1);
+  std::vector<Ferrum::RecordedCall> calls = recording.calls();
+  success &= calls.size() == 2 && calls[0].id == Ferrum::FunctionID::ge_mv && calls[1].id == Ferrum::FunctionID::ge_rk &&
+             calls[0].dims == std::vector<int>({1, 5, 3});
+
+  // the rate at which a large matrix is read
+  const int size = 4096;
+  const int repeats = 10;
+  std::vector<float> big = fill((size_t)size * size, 0.2f);
+  std::vector<float> x = fill(size, 0.4f);
+  std::vector<float> y(size);
+  for (bool trans : {false, true}) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < repeats; i++) {
+      engine.ge_mv(trans, size, size, 1.0f, big.data(), big.size(), 0, size, x.data(), size, 0, 1,
+                   0.0f, y.data(), size, 0, 1);
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    double seconds = elapsed.count() / repeats;
+    std::cout << "ge_mv " << (trans ? "T" : "N") << " of " << size << "x" << size << ": " << seconds * 1000.0 << "ms, "
+              << sizeof(float) * big.size() / seconds / 1e9 << " GB/s" << std::endl;
+  }
+
+  std::cout << (success ? "Success!" : "Failed!") << std::endl;
+  return success ? 0 : 1;
+}
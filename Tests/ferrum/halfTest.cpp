@@ -0,0 +1,350 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "cpu_engine.hpp"
+#include "cpu_features.hpp"
+#include "recording_engine.hpp"
+
+// Checks the half precision conversions of every instruction set that the processor supports
+// against conversions worked out from the definitions of the formats, then checks the half
+// precision functions of the CPU engine against the float functions, rounded.
+// Finally, times an elementwise function over a large vector in each format.
+
+const Ferrum::HalfFormat formats[] = {Ferrum::HalfFormat::fp16, Ferrum::HalfFormat::bf16};
+
+const char* formatName(Ferrum::HalfFormat format) {
+  return format == Ferrum::HalfFormat::fp16 ? "fp16" : "bf16";
+}
+
+float fromBits(uint32_t bits) {
+  float f;
+  std::memcpy(&f, &bits, sizeof(f));
+  return f;
+}
+
+// The value of an encoding, from its sign, exponent and mantissa fields
+double halfValue(Ferrum::HalfFormat format, uint16_t h) {
+  if (format == Ferrum::HalfFormat::bf16) {
+    return fromBits((uint32_t)h << 16);
+  }
+  int exponent = (h >> 10) & 0x1f;
+  int mantissa = h & 0x3ff;
+  double value;
+  if (exponent == 0x1f) {
+    value = mantissa ? NAN : INFINITY;
+  } else if (exponent == 0) {
+    value = std::ldexp((double)mantissa, -24);
+  } else {
+    value = std::ldexp((double)(mantissa | 0x400), exponent - 25);
+  }
+  return (h & 0x8000) ? -value : value;
+}
+
+uint16_t infinity(Ferrum::HalfFormat format) {
+  return format == Ferrum::HalfFormat::fp16 ? 0x7c00 : 0x7f80;
+}
+
+// The magnitude of a positive encoding for rounding, where infinity takes the place of the
+// next power of two after the largest finite value
+double magnitude(Ferrum::HalfFormat format, uint16_t h) {
+  if (h == infinity(format)) {
+    return format == Ferrum::HalfFormat::fp16 ? 65536.0 : std::ldexp(1.0, 128);
+  }
+  return halfValue(format, h);
+}
+
+bool isNan(Ferrum::HalfFormat format, uint16_t h) {
+  return (h & 0x7fff) > infinity(format);
+}
+
+// The nearest encoding to x, with ties to the even encoding. Positive encodings increase with
+// their values, so this searches for the pair either side of x.
+uint16_t nearest(Ferrum::HalfFormat format, float x) {
+  uint16_t sign = std::signbit(x) ? 0x8000 : 0;
+  double a = std::fabs((double)x);
+  uint16_t lo = 0, hi = infinity(format);
+  if (a >= magnitude(format, hi)) {
+    return sign | hi;
+  }
+  while (hi - lo > 1) {
+    uint16_t mid = (lo + hi) / 2;
+    if (magnitude(format, mid) <= a) {
+      lo = mid;
+    } else {
+      hi = mid;
+    }
+  }
+  double below = a - magnitude(format, lo);
+  double above = magnitude(format, hi) - a;
+  return sign | ((below < above || (below == above && (lo & 1) == 0)) ? lo : hi);
+}
+
+bool checkConversions(Ferrum::CpuIsa isa, Ferrum::HalfFormat format) {
+  const Ferrum::CpuHalfKernel* convert = Ferrum::simdHalf(isa, format);
+  std::string name = std::string(formatName(format)) + " conversions (" + Ferrum::isaName(isa) + ")";
+
+  // every encoding, both contiguous and strided
+  std::vector<uint16_t> all(65536);
+  for (int i = 0; i < 65536; i++) {
+    all[i] = i;
+  }
+  std::vector<float> loaded(65536), strided(65536 / 3 + 1);
+  convert->load(all.data(), 1, 65536, loaded.data());
+  convert->load(all.data(), 3, strided.size(), strided.data());
+  for (int i = 0; i < 65536; i++) {
+    double expected = halfValue(format, i);
+    bool same = std::isnan(expected) ? std::isnan(loaded[i]) : loaded[i] == expected;
+    if (i % 3 == 0) {
+      same &= std::isnan(expected) ? std::isnan(strided[i / 3]) : strided[i / 3] == expected;
+    }
+    if (!same) {
+      std::cout << name << ": " << std::hex << i << std::dec << " loaded as " << loaded[i]
+                << ", expected " << expected << std::endl;
+      return false;
+    }
+  }
+
+  // every value of the format, the halfway points between them, and a spread of other floats
+  std::vector<float> values;
+  for (int i = 0; i < 65536; i++) {
+    if (!isNan(format, i)) {
+      values.push_back(loaded[i]);
+      if ((i & 0x7fff) < infinity(format) - 1) {
+        values.push_back((loaded[i] + loaded[i + 1]) / 2);
+      }
+    }
+  }
+  std::mt19937 random(42);
+  for (int i = 0; i < 200000; i++) {
+    values.push_back(fromBits(random()));
+  }
+  values.push_back(NAN);
+  std::vector<uint16_t> stored(values.size()), storedStrided(values.size() * 2, 0x1234);
+  convert->store(values.data(), values.size(), stored.data(), 1);
+  convert->store(values.data(), values.size(), storedStrided.data(), 2);
+  for (size_t i = 0; i < values.size(); i++) {
+    bool same;
+    if (std::isnan(values[i])) {
+      same = isNan(format, stored[i]);
+    } else {
+      same = stored[i] == nearest(format, values[i]);
+    }
+    same &= storedStrided[i * 2] == stored[i] && storedStrided[i * 2 + 1] == 0x1234;
+    if (!same) {
+      std::cout << name << ": " << values[i] << " stored as " << std::hex << stored[i] << ", expected "
+                << nearest(format, values[i]) << std::dec << std::endl;
+      return false;
+    }
+  }
+  std::cout << name << ": OK" << std::endl;
+  return true;
+}
+
+std::vector<uint16_t> encode(Ferrum::HalfFormat format, const std::vector<float>& values) {
+  std::vector<uint16_t> h(values.size());
+  for (size_t i = 0; i < values.size(); i++) {
+    h[i] = nearest(format, values[i]);
+  }
+  return h;
+}
+
+std::vector<float> decode(Ferrum::HalfFormat format, const std::vector<uint16_t>& h) {
+  std::vector<float> values(h.size());
+  for (size_t i = 0; i < h.size(); i++) {
+    values[i] = halfValue(format, h[i]);
+  }
+  return values;
+}
+
+bool check(const std::string& name, const std::vector<uint16_t>& actual, const std::vector<uint16_t>& expected) {
+  for (size_t i = 0; i < expected.size(); i++) {
+    if (actual[i] != expected[i]) {
+      std::cout << name << ": element " << i << " is " << std::hex << actual[i] << ", expected "
+                << expected[i] << std::dec << std::endl;
+      return false;
+    }
+  }
+  std::cout << name << ": OK" << std::endl;
+  return true;
+}
+
+// The half precision functions give the float results on the converted arguments, rounded
+bool checkFunctions(Ferrum::CpuEngine& engine, Ferrum::HalfFormat format) {
+  std::string prefix = std::string(formatName(format)) + " ";
+  bool success = true;
+  const int length = 100000;
+  std::vector<float> x(length), y(length);
+  for (int i = 0; i < length; i++) {
+    x[i] = 4.0f * std::sin(i * 0.37f);
+    y[i] = 1.5f + std::cos(i * 0.11f);
+  }
+  std::vector<uint16_t> a = encode(format, x), b = encode(format, y);
+  x = decode(format, a);
+  y = decode(format, b);
+  std::vector<uint16_t> result(length);
+  std::vector<float> expected(length);
+
+  engine.vect_bB(Ferrum::FunctionID::vector_sigmoid, x.data(), length, 0, 1, expected.data(), length, 0, 1);
+  engine.hvect_bB(Ferrum::FunctionID::vector_sigmoid, format, a.data(), length, 0, 1, result.data(), length, 0, 1);
+  success &= check(prefix + "vector_sigmoid", result, encode(format, expected));
+
+  engine.vect_fbB(Ferrum::FunctionID::vector_relu, 0.1f, x.data(), length, 0, 1, expected.data(), length, 0, 1);
+  engine.hvect_fbB(Ferrum::FunctionID::vector_relu, format, 0.1f, a.data(), length, 0, 1,
+                   result.data(), length, 0, 1);
+  success &= check(prefix + "vector_relu", result, encode(format, expected));
+
+  // strided, with offsets, leaving the elements in between
+  const int n = 1000;
+  std::vector<uint16_t> strided(3 + n * 2, 0x1234);
+  std::vector<float> stridedFloat(strided.size());
+  engine.vect_bbB(Ferrum::FunctionID::vector_add, x.data(), 1 + n * 5, 1, 5, y.data(), n, 0, 1,
+                  stridedFloat.data(), strided.size(), 3, 2);
+  std::vector<uint16_t> expectedStrided = strided;
+  for (int i = 0; i < n; i++) {
+    expectedStrided[3 + i * 2] = nearest(format, stridedFloat[3 + i * 2]);
+  }
+  engine.hvect_bbB(Ferrum::FunctionID::vector_add, format, a.data(), 1 + n * 5, 1, 5, b.data(), n, 0, 1,
+                   strided.data(), strided.size(), 3, 2);
+  success &= check(prefix + "vector_add (strided)", strided, expectedStrided);
+
+  engine.vect_bbffffB(Ferrum::FunctionID::vector_linear_frac, x.data(), n, 0, 1, y.data(), n, 0, 1,
+                      0.5f, 1.0f, 2.0f, 0.25f, expected.data(), n, 0, 1);
+  engine.hvect_bbffffB(Ferrum::FunctionID::vector_linear_frac, format, a.data(), n, 0, 1, b.data(), n, 0, 1,
+                       0.5f, 1.0f, 2.0f, 0.25f, result.data(), n, 0, 1);
+  expected.resize(n);
+  result.resize(n);
+  success &= check(prefix + "vector_linear_frac", result, encode(format, expected));
+
+  // two results, and swap, which reads its in/out buffer
+  std::vector<float> sines(n), cosines(n);
+  std::vector<uint16_t> halfSines(n), halfCosines(n);
+  engine.vect_bBB(Ferrum::FunctionID::vector_sincos, x.data(), n, 0, 1, sines.data(), n, 0, 1, cosines.data(), n, 0, 1);
+  engine.hvect_bBB(Ferrum::FunctionID::vector_sincos, format, a.data(), n, 0, 1, halfSines.data(), n, 0, 1,
+                   halfCosines.data(), n, 0, 1);
+  success &= check(prefix + "vector_sincos (sin)", halfSines, encode(format, sines));
+  success &= check(prefix + "vector_sincos (cos)", halfCosines, encode(format, cosines));
+
+  std::vector<uint16_t> first(a.begin(), a.begin() + n), second(b.begin(), b.begin() + n), old(n);
+  engine.hvect_bBB(Ferrum::FunctionID::vector_swap, format, first.data(), n, 0, 1, second.data(), n, 0, 1,
+                   old.data(), n, 0, 1);
+  success &= check(prefix + "vector_swap (b)", second, first);
+  success &= check(prefix + "vector_swap (result)", old, std::vector<uint16_t>(b.begin(), b.begin() + n));
+
+  // a 30x20 matrix inside a buffer with a leading dimension of 40
+  const int sd = 30, fd = 20, ld = 40;
+  std::vector<float> matrixFloat(ld * fd);
+  engine.ge_bbB(Ferrum::FunctionID::ge_mul, sd, fd, x.data(), ld * fd, 0, ld, y.data(), ld * fd, 0, ld,
+                matrixFloat.data(), ld * fd, 0, ld);
+  std::vector<uint16_t> matrix(ld * fd, 0x1234);
+  std::vector<uint16_t> expectedMatrix = matrix;
+  for (int j = 0; j < fd; j++) {
+    for (int i = 0; i < sd; i++) {
+      expectedMatrix[i + j * ld] = nearest(format, matrixFloat[i + j * ld]);
+    }
+  }
+  engine.hge_bbB(Ferrum::FunctionID::ge_mul, format, sd, fd, a.data(), ld * fd, 0, ld, b.data(), ld * fd, 0, ld,
+                 matrix.data(), ld * fd, 0, ld);
+  success &= check(prefix + "ge_mul", matrix, expectedMatrix);
+  return success;
+}
+
+// The best of several runs of relu over a large vector, in microseconds
+template <typename Run>
+double timeRuns(Run run) {
+  double best = 1e30;
+  for (int i = 0; i < 5; i++) {
+    auto start = std::chrono::steady_clock::now();
+    run();
+    auto end = std::chrono::steady_clock::now();
+    best = std::min(best, std::chrono::duration<double, std::micro>(end - start).count());
+  }
+  return best;
+}
+
+int main(void) {
+  bool success = true;
+
+  Ferrum::CpuIsa highest = Ferrum::detectIsa();
+  for (Ferrum::CpuIsa isa : {Ferrum::CpuIsa::baseline, Ferrum::CpuIsa::sse42, Ferrum::CpuIsa::avx2, Ferrum::CpuIsa::avx512}) {
+#if !defined(__x86_64__)
+    if (isa != Ferrum::CpuIsa::baseline) {
+      continue;
+    }
+#endif
+    if (isa > highest) {
+      continue;
+    }
+    for (Ferrum::HalfFormat format : formats) {
+      success &= checkConversions(isa, format);
+    }
+  }
+
+  Ferrum::CpuEngine engine(3);
+  success &= engine.halfStorage();
+  for (Ferrum::HalfFormat format : formats) {
+    success &= checkFunctions(engine, format);
+  }
+
+  // reductions, batches and unknown formats are rejected
+  std::vector<uint16_t> a(100, 0x3c00), result(100);
+  if (engine.hvect_bB(Ferrum::FunctionID::vector_sum, Ferrum::HalfFormat::fp16, a.data(), 100, 0, 1,
+                      result.data(), 100, 0, 1) != nullptr) {
+    std::cout << "hvect_bB accepted a reduction" << std::endl;
+    success = false;
+  }
+  if (engine.hvect_bB(Ferrum::FunctionID::vector_sqr, (Ferrum::HalfFormat)7, a.data(), 100, 0, 1,
+                      result.data(), 100, 0, 1) != nullptr) {
+    std::cout << "hvect_bB accepted an unknown format" << std::endl;
+    success = false;
+  }
+  if (engine.hge_bB(Ferrum::FunctionID::ge_sqr, Ferrum::HalfFormat::fp16, 20, 20, a.data(), 100, 0, 20,
+                    result.data(), 100, 0, 20) != nullptr) {
+    std::cout << "hge_bB accepted a matrix past the end of its buffer" << std::endl;
+    success = false;
+  }
+  success &= engine.beginBatch();
+  if (engine.hvect_bB(Ferrum::FunctionID::vector_sqr, Ferrum::HalfFormat::fp16, a.data(), 100, 0, 1,
+                      result.data(), 100, 0, 1) != nullptr) {
+    std::cout << "hvect_bB ran in a batch" << std::endl;
+    success = false;
+  }
+  success &= engine.commitBatch();
+
+  // the recording engine passes the functions through, with their format
+  Ferrum::RecordingEngine recording(new Ferrum::CpuEngine(2));
+  std::vector<uint16_t> negative(100, 0xc000), relu(100);
+  recording.hvect_fbB(Ferrum::FunctionID::vector_relu, Ferrum::HalfFormat::fp16, 0.5f, negative.data(), 100, 0, 1,
+                      relu.data(), 100, 0, 1);
+  std::vector<Ferrum::RecordedCall> calls = recording.calls();
+  bool recorded = recording.halfStorage() && calls.size() == 1 && std::string(calls[0].dispatch) == "hvect_fbB" &&
+                  calls[0].dims == std::vector<int>{0} && calls[0].scalars[0] == 0.5 && relu[0] == 0xbc00;
+  std::cout << "recording: " << (recorded ? "OK" : "failed") << std::endl;
+  success &= recorded;
+
+  // half precision reads and writes half of the bytes of float
+  const int large = 1 << 24;
+  std::vector<float> data(large, -1.0f), out(large);
+  std::vector<uint16_t> halfData(large, 0xbc00), halfOut(large);
+  double floatTime = timeRuns([&]() {
+    engine.vect_fbB(Ferrum::FunctionID::vector_relu, 0.1f, data.data(), large, 0, 1, out.data(), large, 0, 1);
+  });
+  std::cout << "vector_relu of " << large << " elements: float " << floatTime / 1000 << "ms";
+  for (Ferrum::HalfFormat format : formats) {
+    double halfTime = timeRuns([&]() {
+      engine.hvect_fbB(Ferrum::FunctionID::vector_relu, format, 0.1f, halfData.data(), large, 0, 1,
+                       halfOut.data(), large, 0, 1);
+    });
+    std::cout << ", " << formatName(format) << " " << halfTime / 1000 << "ms";
+  }
+  std::cout << std::endl;
+
+  std::cout << (success ? "Success!" : "Failed!") << std::endl;
+  return success ? 0 : 1;
+}
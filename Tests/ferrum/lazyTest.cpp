@@ -0,0 +1,120 @@
+#include <cmath>
+#include <iostream>
+#include <string>
+
+#include "cpu_engine.hpp"
+#include "lazy_graph.hpp"
+#include "recording_engine.hpp"
+
+// Builds expressions on tensors without running them, then evaluates only what the outputs need
+
+using Ferrum::FunctionID;
+
+int countCalls(const std::vector<Ferrum::RecordedCall>& calls, const char* dispatch) {
+  int count = 0;
+  for (const Ferrum::RecordedCall& call : calls) {
+    count += (std::string(call.dispatch) == dispatch) ? 1 : 0;
+  }
+  return count;
+}
+
+int main(void) {
+  Ferrum::RecordingEngine recorder(new Ferrum::CpuEngine(2));
+  Ferrum::Engine* engine = &recorder;
+  bool success = true;
+
+  const int length = 10000;
+  Ferrum::Tensor* x = engine->newTensor(length);
+  Ferrum::Tensor* y = engine->newTensor(length);
+  Ferrum::Tensor* t = engine->newTensor(length);
+  Ferrum::Tensor* u = engine->newTensor(length);
+  for (int i = 0; i < length; i++) {
+    x->data[i] = (i % 100) * 0.01f;
+    y->data[i] = 2.0f;
+  }
+  recorder.clear();
+
+  // t = exp(x) * y + x, and u = sin(x) * y, with an unused log(x)
+  Ferrum::LazyGraph graph(engine);
+  int gx = graph.input(x);
+  int gy = graph.input(y);
+  int e = graph.apply(FunctionID::vector_exp, {gx});
+  int sum = graph.apply(FunctionID::vector_add, {graph.apply(FunctionID::vector_mul, {e, gy}), gx});
+  graph.apply(FunctionID::vector_log, {gx});
+  int sc = graph.apply(FunctionID::vector_sincos, {gx});
+  int sine = graph.second(sc);
+  int prod = graph.apply(FunctionID::vector_mul, {sine, gy});
+  success &= sum >= 0 && sine == sc + 1 && graph.second(sum) == -1;
+  success &= graph.output(sum, t) && graph.output(prod, u);
+
+  // nothing runs until the graph is evaluated
+  success &= recorder.calls().empty();
+  success &= graph.evaluate();
+  for (int i = 0; i < length; i++) {
+    float expected = std::exp(x->data[i]) * 2.0f + x->data[i];
+    if (std::fabs(t->data[i] - expected) > 1e-5f * expected || std::fabs(u->data[i] - std::sin(x->data[i]) * 2.0f) > 1e-5f) {
+      std::cout << "Element " << i << " is " << t->data[i] << ", " << u->data[i] << std::endl;
+      success = false;
+      break;
+    }
+  }
+  std::cout << "exp(x) * y + x: " << t->data[0] << ", " << t->data[1] << ", " << t->data[2] << " ..." << std::endl;
+
+  // the chain is fused, log is never run, and the two results of sincos are the only temporaries
+  auto calls = recorder.calls();
+  std::cout << "Evaluated with " << graph.dispatches() << " dispatches and " << graph.temporaries() << " temporaries" << std::endl;
+  success &= graph.dispatches() == 3 && countCalls(calls, "vect_fused") == 1 && countCalls(calls, "vect_bBB") == 1 &&
+             countCalls(calls, "vect_bbB") == 1;
+  success &= countCalls(calls, "beginBatch") == 1 && countCalls(calls, "commitBatch") == 1;
+  success &= countCalls(calls, "newTensor") == 2 && graph.temporaries() == 2;
+  for (const Ferrum::RecordedCall& call : calls) {
+    success &= call.id != FunctionID::vector_log;
+  }
+
+  // evaluating again, after updating an input, reuses the temporaries
+  x->data[0] = 1.0f;
+  recorder.clear();
+  success &= graph.evaluate();
+  success &= std::fabs(t->data[0] - (std::exp(1.0f) * 2.0f + 1.0f)) < 1e-5f;
+  success &= countCalls(recorder.calls(), "newTensor") == 0;
+
+  // intermediates that are read twice are stored, and d is fused into the division
+  graph.clear();
+  gx = graph.input(x);
+  int a = graph.apply(FunctionID::vector_sqr, {gx});
+  int b = graph.apply(FunctionID::vector_add, {a, a});
+  int c = graph.apply(FunctionID::vector_mul, {b, a});
+  int d = graph.apply(FunctionID::vector_sub, {c, b});
+  int f = graph.apply(FunctionID::vector_div, {d, c});
+  graph.output(f, t);
+  recorder.clear();
+  success &= graph.evaluate();
+  float x3 = x->data[3], sq = x3 * x3;
+  float expected = ((sq + sq) * sq - (sq + sq)) / ((sq + sq) * sq);
+  success &= std::fabs(t->data[3] - expected) < 1e-5f * std::fabs(expected);
+  std::cout << "Shared intermediates: " << graph.dispatches() << " dispatches, " << graph.temporaries() << " temporaries" << std::endl;
+  success &= graph.dispatches() == 4 && graph.temporaries() == 3;
+
+  // an output can overwrite an input, once nothing else reads it
+  graph.clear();
+  gx = graph.input(x);
+  graph.output(graph.apply(FunctionID::vector_scale_shift, {gx}, {2.0f, 1.0f, 0.0f, 0.0f}), x);
+  float x5 = x->data[5];
+  success &= graph.evaluate() && x->data[5] == 2.0f * x5 + 1.0f;
+
+  // invalid functions are rejected
+  success &= graph.apply(FunctionID::vector_equals, {gx, gx}) == -1;
+  success &= graph.apply(FunctionID::vector_exp, {gx, gx}) == -1;
+  success &= graph.apply(FunctionID::vector_exp, {42}) == -1;
+  engine->beginBatch();
+  success &= !graph.evaluate();
+  engine->commitBatch();
+
+  engine->releaseTensor(u);
+  engine->releaseTensor(t);
+  engine->releaseTensor(y);
+  engine->releaseTensor(x);
+
+  std::cout << (success ? "Success!" : "Failed!") << std::endl;
+  return success ? 0 : 1;
+}
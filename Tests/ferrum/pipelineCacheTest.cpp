@@ -0,0 +1,126 @@
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "pipeline_cache.hpp"
+
+// Tests the lazy creation of pipelines with a stub compiler, which counts the compiles
+// of each function and takes long enough for other threads to wait on it
+
+class StubCompiler : public Ferrum::PipelineCompiler {
+  public:
+    std::vector<std::atomic<int>> compiles;
+    std::atomic<int> released;
+    // functions that the on-disk cache already has
+    std::vector<Ferrum::FunctionID> archived;
+
+    StubCompiler() : compiles(Ferrum::functionCount), released(0) {}
+
+    void* compile(Ferrum::FunctionID id, bool& cached) override {
+      compiles[id]++;
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+      if (id == Ferrum::FunctionID::vector_abs) {
+        return nullptr;
+      }
+      for (Ferrum::FunctionID a : archived) {
+        cached |= a == id;
+      }
+      // any pointer will do, as long as it is different for each function
+      return &compiles[id];
+    }
+
+    void release(void* pipeline) override {
+      released++;
+    }
+};
+
+int main(void) {
+  bool success = true;
+
+  {
+    StubCompiler compiler;
+    compiler.archived = {Ferrum::FunctionID::vector_exp};
+    Ferrum::PipelineCache cache(&compiler);
+
+    // nothing is compiled until it is used
+    success &= cache.compiledCount() == 0;
+
+    // many threads asking for the same function at once get the same pipeline, compiled once
+    std::vector<std::thread> threads;
+    std::vector<void*> results(8, nullptr);
+    for (int i = 0; i < 8; i++) {
+      threads.emplace_back([&, i]() { results[i] = cache.get(Ferrum::FunctionID::vector_add); });
+    }
+    for (std::thread& t : threads) {
+      t.join();
+    }
+    bool once = compiler.compiles[Ferrum::FunctionID::vector_add] == 1 && results[0] != nullptr;
+    for (void* result : results) {
+      once &= result == results[0];
+    }
+    once &= cache.get(Ferrum::FunctionID::vector_add) == results[0] && compiler.compiles[Ferrum::FunctionID::vector_add] == 1;
+    std::cout << "Compiled once for 8 threads: " << (once ? "OK" : "no") << std::endl;
+    success &= once;
+
+    // a failure is remembered rather than compiled again
+    bool failed = cache.get(Ferrum::FunctionID::vector_abs) == nullptr && cache.get(Ferrum::FunctionID::vector_abs) == nullptr &&
+                  compiler.compiles[Ferrum::FunctionID::vector_abs] == 1 && cache.compiled(Ferrum::FunctionID::vector_abs);
+    std::cout << "Failed compile: " << (failed ? "OK" : "retried") << std::endl;
+    success &= failed;
+
+    // the warm list, with an unknown name skipped
+    std::vector<Ferrum::FunctionID> warm = Ferrum::warmList("vector_exp, ge_mul,vector_nothing  uplo_sqr");
+    bool listed = warm.size() == 3 && warm[0] == Ferrum::FunctionID::vector_exp &&
+                  warm[1] == Ferrum::FunctionID::ge_mul && warm[2] == Ferrum::FunctionID::uplo_sqr;
+    listed &= Ferrum::warmList(nullptr).empty() && Ferrum::warmList("").empty();
+    cache.warm(warm);
+    listed &= cache.compiled(Ferrum::FunctionID::ge_mul) && !cache.compiled(Ferrum::FunctionID::ge_add) &&
+              cache.compiledCount() == 5;
+    std::cout << "Warm list: " << (listed ? "OK" : "wrong") << std::endl;
+    success &= listed;
+
+    // pipelines from the on-disk cache do not need to be saved again
+    bool unsaved = cache.unsaved() == 3;
+    cache.markSaved();
+    cache.get(Ferrum::FunctionID::ge_sqr);
+    unsaved &= cache.unsaved() == 1;
+    std::cout << "Unsaved pipelines: " << (unsaved ? "OK" : "wrong") << std::endl;
+    success &= unsaved;
+
+    success &= cache.get(Ferrum::FunctionID::UNKNOWN) == nullptr && cache.get(static_cast<Ferrum::FunctionID>(Ferrum::functionCount)) == nullptr;
+  }
+
+  // the pipelines are released with the cache, except for the failure
+  {
+    StubCompiler compiler;
+    {
+      Ferrum::PipelineCache cache(&compiler);
+      cache.warm({Ferrum::FunctionID::vector_add, Ferrum::FunctionID::vector_abs, Ferrum::FunctionID::vector_sqr});
+    }
+    std::cout << "Released: " << compiler.released << std::endl;
+    success &= compiler.released == 2;
+  }
+
+  // the cache file is named by the hash of the library
+  const char library[] = "a compiled library";
+  const char changed[] = "a compiled librarz";
+  uint64_t hash = Ferrum::libraryHash(library, sizeof(library));
+  bool keyed = hash == Ferrum::libraryHash(library, sizeof(library)) && hash != Ferrum::libraryHash(changed, sizeof(changed));
+  std::string path = Ferrum::pipelineCachePath(hash, "/tmp/ferrum");
+  keyed &= path.compare(0, 19, "/tmp/ferrum/ferrum-") == 0 && path.size() == 19 + 16 + 4;
+  keyed &= path != Ferrum::pipelineCachePath(Ferrum::libraryHash(changed, sizeof(changed)), "/tmp/ferrum");
+  setenv("FERRUM_CACHE", "/var/cache/test", 1);
+  keyed &= Ferrum::pipelineCachePath(hash).compare(0, 16, "/var/cache/test/") == 0;
+  // an empty FERRUM_CACHE turns the cache off
+  setenv("FERRUM_CACHE", "", 1);
+  keyed &= Ferrum::pipelineCachePath(hash).empty();
+  std::cout << "Cache path: " << path << (keyed ? " OK" : " wrong") << std::endl;
+  success &= keyed;
+
+  std::cout << (success ? "Success!" : "Failed!") << std::endl;
+  return success ? 0 : 1;
+}
@@ -0,0 +1,231 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "cpu_engine.hpp"
+#include "dispatch_plan.hpp"
+
+// Checks the reductions against sums calculated directly, and that their results are the same
+// for any number of threads, both normally and with reproducible sums
+
+using Ferrum::FunctionID;
+
+bool near(const char* name, float actual, double expected, double tolerance) {
+  bool ok = std::fabs(actual - expected) <= tolerance * std::fmax(1.0, std::fabs(expected));
+  std::cout << name << ": " << actual;
+  if (!ok) {
+    std::cout << ", expected " << expected;
+  }
+  std::cout << std::endl;
+  return ok;
+}
+
+// Runs a single argument reduction, returning the value
+float reduce1(Ferrum::Engine& engine, FunctionID id, const float* x, int len, int offset, int stride) {
+  float result[2] = {-99.0f, -99.0f};
+  engine.vect_bB(id, x, len, offset, stride, result, 2, 1, 1);
+  return result[1];
+}
+
+float reduce2(Ferrum::Engine& engine, FunctionID id, const float* x, const float* y, int len, int stride) {
+  float result = -99.0f;
+  engine.vect_bbB(id, x, len, 0, stride, y, len, 0, stride, &result, 1, 0, 1);
+  return result;
+}
+
+// The reproducible sum, one element at a time, following the description in dispatch_plan.hpp
+struct Compensated {
+  float value;
+  float error;
+
+  void add(Compensated b) {
+    float s = value + b.value;
+    float bv = s - value;
+    float e = (value - (s - bv)) + (b.value - bv);
+    value = s;
+    error = error + b.error + e;
+  }
+};
+
+Compensated reduceLanes(const Compensated* items, size_t count) {
+  const size_t lanes = Ferrum::REPRODUCIBLE_LANES;
+  std::vector<Compensated> lane(lanes, Compensated{0.0f, 0.0f});
+  for (size_t i = 0; i < count; i++) {
+    lane[i % lanes].add(items[i]);
+  }
+  for (size_t s = lanes / 2; s > 0; s /= 2) {
+    for (size_t i = 0; i < s; i++) {
+      lane[i].add(lane[i + s]);
+    }
+  }
+  return lane[0];
+}
+
+float reproducibleSum(const float* x, size_t n) {
+  std::vector<Compensated> blocks;
+  for (size_t start = 0; start < n; start += Ferrum::REPRODUCIBLE_BLOCK) {
+    std::vector<Compensated> items;
+    for (size_t i = start; i < std::min(n, start + Ferrum::REPRODUCIBLE_BLOCK); i++) {
+      items.push_back({x[i], 0.0f});
+    }
+    blocks.push_back(reduceLanes(items.data(), items.size()));
+  }
+  Compensated total = reduceLanes(blocks.data(), blocks.size());
+  return total.value + total.error;
+}
+
+bool sameBits(const char* name, float a, float b) {
+  if (std::memcmp(&a, &b, sizeof(float)) != 0) {
+    std::cout << name << " differs: " << a << " and " << b << std::endl;
+    return false;
+  }
+  return true;
+}
+
+int main(void) {
+  bool success = true;
+  Ferrum::CpuEngine engine(3);
+
+  // long enough to be split into many blocks
+  const int length = 1000003;
+  float* x = new float[length];
+  float* y = new float[length];
+  for (int i = 0; i < length; i++) {
+    x[i] = std::sin(i * 0.001f) * (1.0f + (i % 7));
+    y[i] = 0.5f + (i % 11) * 0.25f;
+  }
+  // a single largest magnitude, so that iamax has one answer
+  x[777777] = -50.0f;
+  double sum = 0.0, asum = 0.0, sumsq = 0.0, dot = 0.0, strided = 0.0;
+  float high = -INFINITY;
+  for (int i = 0; i < length; i++) {
+    sum += x[i];
+    asum += std::fabs(x[i]);
+    sumsq += (double)x[i] * x[i];
+    dot += (double)x[i] * y[i];
+    high = std::fmax(high, x[i]);
+    if (i % 3 == 0) {
+      strided += x[i];
+    }
+  }
+
+  success &= near("vector_sum", reduce1(engine, FunctionID::vector_sum, x, length, 0, 1), sum, 1e-6);
+  success &= near("vector_asum", reduce1(engine, FunctionID::vector_asum, x, length, 0, 1), asum, 1e-6);
+  success &= near("vector_dot", reduce2(engine, FunctionID::vector_dot, x, y, length, 1), dot, 1e-6);
+  success &= near("vector_nrm2", reduce1(engine, FunctionID::vector_nrm2, x, length, 0, 1), std::sqrt(sumsq), 1e-6);
+  success &= near("vector_amax", reduce1(engine, FunctionID::vector_amax, x, length, 0, 1), 50.0, 0.0);
+  success &= near("vector_iamax", reduce1(engine, FunctionID::vector_iamax, x, length, 0, 1), 777777.0, 0.0);
+  success &= near("vector_min", reduce1(engine, FunctionID::vector_min, x, length, 0, 1), -50.0, 0.0);
+  success &= near("vector_max", reduce1(engine, FunctionID::vector_max, x, length, 0, 1), high, 0.0);
+  success &= near("vector_equals", reduce2(engine, FunctionID::vector_equals, x, x, length, 1), 0.0, 0.0);
+
+  // strided, with the first element of the result left alone
+  float result[2] = {-99.0f, -99.0f};
+  engine.vect_bB(FunctionID::vector_sum, x, length, 0, 3, result, 2, 1, 1);
+  success &= near("vector_sum (stride 3)", result[1], strided, 1e-6);
+  success &= result[0] == -99.0f;
+
+  // nrm2 does not overflow, even though the squares do not fit in a float
+  float big[4] = {3e30f, 4e30f, 0.0f, 0.0f};
+  success &= near("vector_nrm2 (large)", reduce1(engine, FunctionID::vector_nrm2, big, 4, 0, 1), 5e30, 1e-6);
+  float tiny[2] = {3e-30f, 4e-30f};
+  success &= near("vector_nrm2 (small)", reduce1(engine, FunctionID::vector_nrm2, tiny, 2, 0, 1), 5e-30, 1e-6);
+
+  // the first of several equal magnitudes
+  float ties[6] = {1.0f, -3.0f, 2.0f, 3.0f, -3.0f, 0.0f};
+  success &= near("vector_iamax (ties)", reduce1(engine, FunctionID::vector_iamax, ties, 6, 0, 1), 1.0, 0.0);
+
+  // empty vectors
+  success &= near("vector_sum (empty)", reduce1(engine, FunctionID::vector_sum, x, 0, 0, 1), 0.0, 0.0);
+  success &= near("vector_iamax (empty)", reduce1(engine, FunctionID::vector_iamax, x, 0, 0, 1), -1.0, 0.0);
+  float emptyMin = reduce1(engine, FunctionID::vector_min, x, 0, 0, 1);
+  std::cout << "vector_min (empty): " << emptyMin << std::endl;
+  success &= std::isnan(emptyMin);
+
+  // a reduction still needs room for its result
+  if (engine.vect_bB(FunctionID::vector_sum, x, length, 0, 1, result, 1, 1, 1) != nullptr) {
+    std::cout << "vector_sum accepted a result with no room" << std::endl;
+    success = false;
+  }
+
+  // the same bits for any number of threads
+  FunctionID ids[] = {FunctionID::vector_sum, FunctionID::vector_asum, FunctionID::vector_nrm2};
+  for (int threads : {0, 1, 7}) {
+    Ferrum::CpuEngine other(threads);
+    for (FunctionID id : ids) {
+      float a = reduce1(engine, id, x, length, 0, 1);
+      float b = reduce1(other, id, x, length, 0, 1);
+      if (std::memcmp(&a, &b, sizeof(float)) != 0) {
+        std::cout << id << " differs with " << threads << " threads: " << a << " and " << b << std::endl;
+        success = false;
+      }
+    }
+    float a = reduce2(engine, FunctionID::vector_dot, x, y, length, 1);
+    float b = reduce2(other, FunctionID::vector_dot, x, y, length, 1);
+    success &= std::memcmp(&a, &b, sizeof(float)) == 0;
+  }
+
+  // reproducible sums are accurate, and have the same bits for any number of threads
+  engine.setReproducible(true);
+  float fixedSum = reduce1(engine, FunctionID::vector_sum, x, length, 0, 1);
+  success &= near("vector_sum (reproducible)", fixedSum, sum, 1e-6);
+  success &= sameBits("vector_sum (reproducible) and the reference", fixedSum, reproducibleSum(x, length));
+  success &= near("vector_asum (reproducible)", reduce1(engine, FunctionID::vector_asum, x, length, 0, 1), asum, 1e-6);
+  success &= near("vector_dot (reproducible)", reduce2(engine, FunctionID::vector_dot, x, y, length, 1), dot, 1e-6);
+  success &= near("vector_nrm2 (reproducible)", reduce1(engine, FunctionID::vector_nrm2, x, length, 0, 1),
+                  std::sqrt(sumsq), 1e-6);
+  success &= near("vector_nrm2 (reproducible, large)", reduce1(engine, FunctionID::vector_nrm2, big, 4, 0, 1),
+                  5e30, 1e-6);
+  success &= near("vector_sum (reproducible, empty)", reduce1(engine, FunctionID::vector_sum, x, 0, 0, 1), 0.0, 0.0);
+  // a sum that loses everything without compensation
+  float cancel[4] = {1e8f, 1.0f, -1e8f, 1.0f};
+  success &= near("vector_sum (reproducible, cancelling)", reduce1(engine, FunctionID::vector_sum, cancel, 4, 0, 1),
+                  2.0, 0.0);
+  for (int threads : {0, 1, 7}) {
+    Ferrum::CpuEngine other(threads);
+    other.setReproducible(true);
+    for (FunctionID id : ids) {
+      success &= sameBits("reproducible", reduce1(engine, id, x, length, 0, 1), reduce1(other, id, x, length, 0, 1));
+    }
+    success &= sameBits("reproducible vector_dot", reduce2(engine, FunctionID::vector_dot, x, y, length, 1),
+                        reduce2(other, FunctionID::vector_dot, x, y, length, 1));
+  }
+  engine.setReproducible(false);
+
+  // in a batch, the result stays in a tensor for the functions after it
+  Ferrum::Tensor* t = engine.newTensor(length);
+  Ferrum::Tensor* r = engine.newTensor(2);
+  std::memcpy(t->data, x, sizeof(float) * length);
+  success &= engine.beginBatch();
+  engine.vect_bB(FunctionID::vector_nrm2, t->data, t->length, 0, 1, r->data, r->length, 0, 1);
+  engine.vect_bB(FunctionID::vector_sqr, r->data, r->length, 0, 1, r->data, r->length, 1, 1);
+  success &= engine.commitBatch();
+  success &= near("vector_nrm2 squared (batch)", r->data[1], sumsq, 1e-5);
+  engine.releaseTensor(t);
+  engine.releaseTensor(r);
+
+  // the cost of reproducible sums
+  const int repeats = 20;
+  for (bool reproducible : {false, true}) {
+    engine.setReproducible(reproducible);
+    for (const char* name : {"vector_sum", "vector_nrm2"}) {
+      FunctionID id = Ferrum::getFunctionID(name);
+      auto start = std::chrono::steady_clock::now();
+      for (int i = 0; i < repeats; i++) {
+        reduce1(engine, id, x, length, 0, 1);
+      }
+      std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+      std::cout << name << (reproducible ? " (reproducible)" : "") << " of " << length << " elements: "
+                << elapsed.count() / repeats << "ms" << std::endl;
+    }
+  }
+
+  delete[] x;
+  delete[] y;
+
+  std::cout << (success ? "Success!" : "Failed!") << std::endl;
+  return success ? 0 : 1;
+}
@@ -0,0 +1,135 @@
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <vector>
+
+#include "cpu_engine.hpp"
+#include "cpu_features.hpp"
+#include "cpu_math.hpp"
+#include "cpu_simd.hpp"
+
+// Compares the vectorized element functions with the scalar ones, over a range of inputs,
+// and the kernels built for each instruction set that this processor supports
+
+using Ferrum::Simd::VecF;
+using Ferrum::Simd::WIDTH;
+namespace Simd = Ferrum::Simd;
+namespace CpuMath = Ferrum::CpuMath;
+
+// The largest error over n points from low to high, relative to the expected value where it is above 1
+bool check(const char* name, VecF (*f)(VecF), std::function<float(float)> expected,
+           float low, float high, float tolerance = 2e-6f) {
+  const int n = 100000;
+  float worst = 0.0f, at = 0.0f;
+  for (int i = 0; i < n; i += WIDTH) {
+    VecF x;
+    for (int j = 0; j < WIDTH; j++) {
+      x[j] = low + (high - low) * (float)(i + j) / (float)(n - 1);
+    }
+    VecF y = f(x);
+    for (int j = 0; j < WIDTH; j++) {
+      float e = expected(x[j]);
+      float error = (std::isinf(e) && y[j] == e) ? 0.0f : std::fabs(y[j] - e) / std::fmax(1.0f, std::fabs(e));
+      if (!(error <= worst)) {
+        worst = error;
+        at = x[j];
+      }
+    }
+  }
+  bool ok = worst <= tolerance;
+  std::cout << name << ": " << (ok ? "OK" : "FAILED") << ", error " << worst << " at " << at << std::endl;
+  return ok;
+}
+
+double millis(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(void) {
+  bool success = true;
+  std::cout << WIDTH << " floats per vector" << std::endl;
+
+  success &= check("exp", Simd::exp, [](float x) { return std::exp(x); }, -110.0f, 90.0f);
+  success &= check("exp2", Simd::exp2, [](float x) { return std::exp2(x); }, -150.0f, 129.0f);
+  success &= check("exp10", Simd::exp10, [](float x) { return std::pow(10.0f, x); }, -10.0f, 10.0f, 5e-6f);
+  success &= check("expm1", Simd::expm1, [](float x) { return CpuMath::expm1(x); }, -5.0f, 5.0f);
+  success &= check("log", Simd::log, [](float x) { return std::log(x); }, 1e-30f, 1e5f);
+  success &= check("log (small)", Simd::log, [](float x) { return std::log(x); }, 0.0f, 1e-36f);
+  success &= check("log2", Simd::log2, [](float x) { return std::log2(x); }, 1e-3f, 1e5f);
+  success &= check("log10", Simd::log10, [](float x) { return std::log10(x); }, 1e-3f, 1e5f);
+  success &= check("log1p", Simd::log1p, [](float x) { return CpuMath::log1p(x); }, -0.99f, 100.0f);
+  success &= check("sin", Simd::sin, [](float x) { return std::sin(x); }, -100.0f, 100.0f);
+  success &= check("cos", Simd::cos, [](float x) { return std::cos(x); }, -100.0f, 100.0f);
+  success &= check("tan", Simd::tan, [](float x) { return std::tan(x); }, -1.5f, 1.5f, 1e-5f);
+  success &= check("asin", Simd::asin, [](float x) { return std::asin(x); }, -1.0f, 1.0f);
+  success &= check("acos", Simd::acos, [](float x) { return std::acos(x); }, -1.0f, 1.0f);
+  success &= check("atan", Simd::atan, [](float x) { return std::atan(x); }, -100.0f, 100.0f);
+  success &= check("sinh", Simd::sinh, [](float x) { return std::sinh(x); }, -10.0f, 10.0f);
+  success &= check("cosh", Simd::cosh, [](float x) { return std::cosh(x); }, -10.0f, 10.0f);
+  success &= check("tanh", Simd::tanh, [](float x) { return std::tanh(x); }, -10.0f, 10.0f);
+  success &= check("asinh", Simd::asinh, [](float x) { return std::asinh(x); }, -100.0f, 100.0f);
+  success &= check("acosh", Simd::acosh, [](float x) { return std::acosh(x); }, 1.0f, 100.0f);
+  success &= check("atanh", Simd::atanh, [](float x) { return std::atanh(x); }, -0.99f, 0.99f);
+  success &= check("erf", Simd::erf, [](float x) { return CpuMath::erf(x); }, -5.0f, 5.0f);
+  success &= check("erfc", Simd::erfc, [](float x) { return CpuMath::erfc(x); }, -5.0f, 5.0f);
+  success &= check("erfinv", Simd::erfinv, [](float x) { return CpuMath::erfinv(x); }, -0.99f, 0.99f);
+  success &= check("erfcinv", Simd::erfcinv, [](float x) { return CpuMath::erfcinv(x); }, 0.01f, 1.99f);
+  success &= check("normcdf", Simd::normcdf, [](float x) { return CpuMath::normcdf(x); }, -5.0f, 5.0f);
+  success &= check("normcdfinv", Simd::normcdfinv, [](float x) { return CpuMath::normcdfinv(x); }, 0.001f, 0.999f);
+  success &= check("tgamma", Simd::tgamma, [](float x) { return CpuMath::tgamma(x); }, -4.5f, 20.0f, 1e-5f);
+  success &= check("floor", Simd::floor, [](float x) { return std::floor(x); }, -1e8f, 1e8f, 0.0f);
+  success &= check("round", Simd::round, [](float x) { return std::round(x); }, -100.0f, 100.0f, 0.0f);
+  success &= check("cbrt", [](VecF x) { return Simd::pow(x, Simd::splat(CpuMath::REAL1o3<float>)); },
+                   [](float x) { return std::pow(x, CpuMath::REAL1o3<float>); }, 0.0f, 1000.0f);
+  success &= check("pow(x, 3)", [](VecF x) { return Simd::pow(x, Simd::splat(3.0f)); },
+                   [](float x) { return std::pow(x, 3.0f); }, -20.0f, 20.0f);
+
+  // the engine uses these kernels for strided runs too
+  Ferrum::CpuEngine engine(2);
+  const int length = 1 << 22;
+  std::vector<float> a(length), result(length);
+  for (int i = 0; i < length; i++) {
+    a[i] = (i % 2000) * 0.01f - 10.0f;
+  }
+  engine.vect_bB(Ferrum::FunctionID::vector_tanh, a.data(), length, 3, 7, result.data(), length, 1, 3);
+  for (int i = 0; i < (length - 3) / 7 && success; i++) {
+    if (std::fabs(result[1 + 3 * i] - std::tanh(a[3 + 7 * i])) > 2e-6f) {
+      std::cout << "Strided tanh: element " << i << " is " << result[1 + 3 * i] << std::endl;
+      success = false;
+    }
+  }
+
+  // scalar libm on one thread, against the vector kernels for each instruction set on one thread
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < length; i++) {
+    result[i] = std::exp(a[i]);
+  }
+  std::cout << "exp of " << length << " elements: " << millis(start) << "ms scalar" << std::endl;
+  std::vector<float> isaResult(length);
+  Ferrum::CpuIsa best = Ferrum::detectIsa();
+  for (Ferrum::CpuIsa isa : {Ferrum::CpuIsa::baseline, Ferrum::CpuIsa::sse42, Ferrum::CpuIsa::avx2, Ferrum::CpuIsa::avx512}) {
+    if (isa > best) {
+      break;
+    }
+    setenv("FERRUM_CPU_ISA", Ferrum::isaName(isa), 1);
+    Ferrum::CpuEngine single(1);
+    success &= single.instructionSet() == isa;
+    start = std::chrono::steady_clock::now();
+    single.vect_bB(Ferrum::FunctionID::vector_exp, a.data(), length, 0, 1, isaResult.data(), length, 0, 1);
+    double vector = millis(start);
+    for (int i = 0; i < length; i++) {
+      if (std::fabs(isaResult[i] - result[i]) > 2e-6f * std::fmax(1.0f, result[i])) {
+        std::cout << Ferrum::isaName(isa) << ": element " << i << " is " << isaResult[i] << std::endl;
+        success = false;
+        break;
+      }
+    }
+    std::cout << "exp of " << length << " elements: " << vector << "ms " << Ferrum::isaName(isa) << std::endl;
+  }
+  unsetenv("FERRUM_CPU_ISA");
+
+  std::cout << (success ? "Success!" : "Failed!") << std::endl;
+  return success ? 0 : 1;
+}
@@ -0,0 +1,50 @@
+#include <cmath>
+#include <iostream>
+
+#include "cpu_engine.hpp"
+
+// Chains functions on engine-resident tensors, only copying data in at the start and out at the end
+
+int main(void) {
+  Ferrum::CpuEngine cpu(2);
+  Ferrum::Engine* engine = &cpu;
+  bool success = true;
+
+  const int length = 50000;
+  Ferrum::Tensor* x = engine->newTensor(length);
+  Ferrum::Tensor* y = engine->newTensor(length);
+  Ferrum::Tensor* t = engine->newTensor(length);
+  for (int i = 0; i < length; i++) {
+    x->data[i] = (i % 100) * 0.01f;
+    y->data[i] = 2.0f;
+  }
+
+  // t = exp(x) * y + x
+  success &= engine->vect_bB(Ferrum::FunctionID::vector_exp, x->data, x->length, 0, 1, t->data, t->length, 0, 1) != nullptr;
+  success &= engine->vect_bbB(Ferrum::FunctionID::vector_mul, t->data, t->length, 0, 1, y->data, y->length, 0, 1,
+                              t->data, t->length, 0, 1) != nullptr;
+  success &= engine->vect_bbB(Ferrum::FunctionID::vector_add, t->data, t->length, 0, 1, x->data, x->length, 0, 1,
+                              t->data, t->length, 0, 1) != nullptr;
+  for (int i = 0; i < length; i++) {
+    float expected = std::exp(x->data[i]) * 2.0f + x->data[i];
+    if (std::fabs(t->data[i] - expected) > 1e-5f * expected) {
+      std::cout << "Element " << i << " is " << t->data[i] << ", expected " << expected << std::endl;
+      success = false;
+      break;
+    }
+  }
+  std::cout << "exp(x) * y + x: " << t->data[0] << ", " << t->data[1] << ", " << t->data[2] << " ..." << std::endl;
+
+  // functions with two results update both tensors
+  success &= engine->vect_bBB(Ferrum::FunctionID::vector_sincos, x->data, x->length, 0, 1, y->data, y->length, 0, 1,
+                              t->data, t->length, 0, 1) != nullptr;
+  success &= std::fabs(y->data[50] - std::sin(0.5f)) < 1e-6f && std::fabs(t->data[50] - std::cos(0.5f)) < 1e-6f;
+  std::cout << "sincos(0.5): " << y->data[50] << ", " << t->data[50] << std::endl;
+
+  engine->releaseTensor(t);
+  engine->releaseTensor(y);
+  engine->releaseTensor(x);
+
+  std::cout << (success ? "Success!" : "Failed!") << std::endl;
+  return success ? 0 : 1;
+}
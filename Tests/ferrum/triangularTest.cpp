@@ -0,0 +1,314 @@
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "cpu_engine.hpp"
+#include "recording_engine.hpp"
+
+// Checks the triangular functions against results calculated directly, for every side, transpose,
+// triangle and diagonal, with sizes that span several blocks of the diagonal. The parts of a outside
+// the triangle, and a unit diagonal, hold NaN, so reading them fails the test.
+
+const int UNIT = 132;
+const int NON_UNIT = 131;
+
+// An sd x sd triangle in a buffer with ld = sd + 3, offset by 2. The diagonal is large enough
+// that solving is well conditioned.
+struct Triangle {
+  int sd;
+  int unit;
+  int bottom;
+  int ld;
+  std::vector<float> data;
+
+  Triangle(int sd, int unit, int bottom) : sd(sd), unit(unit), bottom(bottom), ld(sd + 3),
+      data(2 + (size_t)(sd + 3) * sd + 1, NAN) {
+    for (int j = 0; j < sd; j++) {
+      for (int i = 0; i < sd; i++) {
+        bool inside = (bottom > 0) ? i > j : i < j;
+        if (inside) {
+          data[2 + i + (size_t)j * ld] = std::sin(i * 0.7f + j * 1.3f) / std::sqrt((float)sd);
+        } else if (i == j && unit != UNIT) {
+          data[2 + i + (size_t)j * ld] = 2.0f + std::cos(i * 0.3f);
+        }
+      }
+    }
+  }
+
+  // element (i, j) of op(a)
+  double at(int i, int j, bool trans) const {
+    if (trans) {
+      std::swap(i, j);
+    }
+    if (i == j) {
+      return (unit == UNIT) ? 1.0 : data[2 + i + (size_t)j * ld];
+    }
+    bool inside = (bottom > 0) ? i > j : i < j;
+    return inside ? data[2 + i + (size_t)j * ld] : 0.0;
+  }
+};
+
+std::vector<float> fill(size_t size, float seed) {
+  std::vector<float> data(size);
+  for (size_t i = 0; i < size; i++) {
+    data[i] = std::sin(seed + i * 0.37f);
+  }
+  return data;
+}
+
+// Solves op(t) * x = b in place, in double precision, for a column with the given stride
+void solveColumn(const Triangle& t, bool trans, double* b, int stride) {
+  int sd = t.sd;
+  bool lower = (t.bottom > 0) != trans;
+  for (int s = 0; s < sd; s++) {
+    int i = lower ? s : sd - 1 - s;
+    double sum = b[i * stride];
+    for (int p = 0; p < sd; p++) {
+      if (p != i && t.at(i, p, trans) != 0.0) {
+        sum -= t.at(i, p, trans) * b[p * stride];
+      }
+    }
+    b[i * stride] = sum / t.at(i, i, trans);
+  }
+}
+
+std::string describe(const char* name, int left, int trans, int unit, int bottom, int m, int n) {
+  return std::string(name) + (left ? " left" : " right") + (trans ? " T" : " N") + (bottom > 0 ? " lower" : " upper") +
+         (unit == UNIT ? " unit " : " ") + std::to_string(m) + "x" + std::to_string(n);
+}
+
+// Compares the m x n matrix of b, at offset 1 with ld m + 1, and checks that the rest of it is unchanged
+bool compare(const std::string& name, const std::vector<float>& b, const std::vector<float>& before,
+             const std::vector<double>& expected, int m, int n, double tolerance) {
+  int ld = m + 1;
+  int errors = 0;
+  for (size_t e = 0; e < b.size(); e++) {
+    ptrdiff_t index = (ptrdiff_t)e - 1;
+    int i = index >= 0 ? index % ld : -1;
+    int j = index >= 0 ? index / ld : -1;
+    if (index < 0 || i >= m || j >= n) {
+      errors += std::memcmp(&b[e], &before[e], sizeof(float)) != 0;
+      continue;
+    }
+    double want = expected[i + (size_t)j * m];
+    if (!(std::fabs(b[e] - want) <= tolerance * (1.0 + std::fabs(want)))) {
+      if (errors == 0) {
+        std::cout << "(" << i << ", " << j << ") is " << b[e] << ", expected " << want << "; ";
+      }
+      errors++;
+    }
+  }
+  std::cout << name << ": " << (errors == 0 ? "ok" : std::to_string(errors) + " errors") << std::endl;
+  return errors == 0;
+}
+
+bool checkMatrix(Ferrum::Engine& engine, bool solve, int left, int trans, int unit, int bottom, int m, int n,
+                 float alpha) {
+  int sd = left ? m : n;
+  Triangle t(sd, unit, bottom);
+  int ld = m + 1;
+  std::vector<float> b = fill(1 + (size_t)ld * n, 0.4f);
+  std::vector<float> before = b;
+
+  // the expected result, from alpha * b
+  std::vector<double> expected((size_t)m * n);
+  for (int j = 0; j < n; j++) {
+    for (int i = 0; i < m; i++) {
+      expected[i + (size_t)j * m] = (double)alpha * before[1 + i + (size_t)j * ld];
+    }
+  }
+  if (solve) {
+    if (left) {
+      for (int j = 0; j < n; j++) {
+        solveColumn(t, trans, &expected[(size_t)j * m], 1);
+      }
+    } else {
+      // x * op(t) = b is op(t)^T * x^T = b^T, where the rows of x are the columns of x^T
+      for (int i = 0; i < m; i++) {
+        solveColumn(t, !trans, &expected[i], m);
+      }
+    }
+  } else {
+    std::vector<double> scaled = expected;
+    for (int j = 0; j < n; j++) {
+      for (int i = 0; i < m; i++) {
+        double sum = 0.0;
+        for (int p = 0; p < sd; p++) {
+          sum += left ? t.at(i, p, trans) * scaled[p + (size_t)j * m] : scaled[i + (size_t)p * m] * t.at(p, j, trans);
+        }
+        expected[i + (size_t)j * m] = sum;
+      }
+    }
+  }
+
+  float* r = solve ? engine.uplo_trsm(left, trans, unit, bottom, m, n, alpha, t.data.data(), t.data.size(), 2, t.ld,
+                                      b.data(), b.size(), 1, ld)
+                   : engine.uplo_trmm(left, trans, unit, bottom, m, n, alpha, t.data.data(), t.data.size(), 2, t.ld,
+                                      b.data(), b.size(), 1, ld);
+  std::string name = describe(solve ? "uplo_trsm" : "uplo_trmm", left, trans, unit, bottom, m, n) +
+                     " alpha " + std::to_string(alpha);
+  if (r != b.data()) {
+    std::cout << name << ": failed to run" << std::endl;
+    return false;
+  }
+  return compare(name, b, before, expected, m, n, 1e-4);
+}
+
+bool checkVector(Ferrum::Engine& engine, bool solve, int trans, int unit, int bottom, int sd, int stride) {
+  Triangle t(sd, unit, bottom);
+  std::vector<float> x = fill(1 + (size_t)sd * stride, 0.8f);
+  std::vector<float> before = x;
+  std::vector<double> expected(sd);
+  for (int i = 0; i < sd; i++) {
+    expected[i] = before[1 + i * stride];
+  }
+  if (solve) {
+    solveColumn(t, trans, expected.data(), 1);
+  } else {
+    for (int i = 0; i < sd; i++) {
+      double sum = 0.0;
+      for (int p = 0; p < sd; p++) {
+        sum += t.at(i, p, trans) * before[1 + p * stride];
+      }
+      expected[i] = sum;
+    }
+  }
+
+  float* r = solve ? engine.uplo_trsv(trans, sd, unit, bottom, t.data.data(), t.data.size(), 2, t.ld,
+                                      x.data(), x.size(), 1, stride)
+                   : engine.uplo_trmv(trans, sd, unit, bottom, t.data.data(), t.data.size(), 2, t.ld,
+                                      x.data(), x.size(), 1, stride);
+  std::string name = describe(solve ? "uplo_trsv" : "uplo_trmv", 1, trans, unit, bottom, sd, 1) +
+                     " stride " + std::to_string(stride);
+  if (r != x.data()) {
+    std::cout << name << ": failed to run" << std::endl;
+    return false;
+  }
+  int errors = 0;
+  for (size_t e = 0; e < x.size(); e++) {
+    if (e >= 1 && (e - 1) % stride == 0) {
+      double want = expected[(e - 1) / stride];
+      errors += !(std::fabs(x[e] - want) <= 1e-4 * (1.0 + std::fabs(want)));
+    } else {
+      errors += std::memcmp(&x[e], &before[e], sizeof(float)) != 0;
+    }
+  }
+  std::cout << name << ": " << (errors == 0 ? "ok" : std::to_string(errors) + " errors") << std::endl;
+  return errors == 0;
+}
+
+int main(void) {
+  bool success = true;
+  Ferrum::CpuEngine engine(3);
+
+  // square, and with more rows or more columns than the blocks of the diagonal
+  int sizes[][2] = {{5, 3}, {150, 70}, {70, 150}};
+  for (auto& size : sizes) {
+    for (int c = 0; c < 16; c++) {
+      int left = c & 1;
+      int trans = (c >> 1) & 1;
+      int unit = (c & 4) ? UNIT : NON_UNIT;
+      int bottom = (c & 8) ? -1 : 1;
+      success &= checkMatrix(engine, false, left, trans, unit, bottom, size[0], size[1], 1.0f);
+      success &= checkMatrix(engine, true, left, trans, unit, bottom, size[0], size[1], 1.0f);
+    }
+  }
+  for (int c = 0; c < 8; c++) {
+    int trans = c & 1;
+    int unit = (c & 2) ? UNIT : NON_UNIT;
+    int bottom = (c & 4) ? -1 : 1;
+    for (int sd : {1, 5, 150}) {
+      success &= checkVector(engine, false, trans, unit, bottom, sd, 1);
+      success &= checkVector(engine, true, trans, unit, bottom, sd, 1);
+    }
+    success &= checkVector(engine, false, trans, unit, bottom, 150, 3);
+    success &= checkVector(engine, true, trans, unit, bottom, 150, 3);
+  }
+  // alpha is applied once to each element, and zero clears b
+  success &= checkMatrix(engine, true, 1, 0, NON_UNIT, 1, 150, 70, -0.5f);
+  success &= checkMatrix(engine, true, 0, 1, NON_UNIT, -1, 70, 150, 2.0f);
+  success &= checkMatrix(engine, false, 1, 1, UNIT, -1, 150, 70, -0.5f);
+  success &= checkMatrix(engine, true, 1, 0, NON_UNIT, 1, 150, 70, 0.0f);
+  // including any NaN or Inf in b, which a product with alpha would keep
+  Triangle four(4, NON_UNIT, 1);
+  std::vector<float> cleared = fill(4 * 3, 0.2f);
+  cleared[1] = NAN;
+  cleared[6] = INFINITY;
+  engine.uplo_trmm(1, 0, NON_UNIT, 1, 4, 3, 0.0f, four.data.data(), four.data.size(), 2, four.ld,
+                   cleared.data(), cleared.size(), 0, 4);
+  bool zeros = true;
+  for (float value : cleared) {
+    zeros &= value == 0.0f;
+  }
+  std::cout << "uplo_trmm alpha 0 over NaN and Inf: " << (zeros ? "ok" : "not cleared") << std::endl;
+  success &= zeros;
+
+  for (int threads : {0, 1, 7}) {
+    Ferrum::CpuEngine other(threads);
+    success &= checkMatrix(other, true, 1, 1, NON_UNIT, 1, 150, 70, 1.0f);
+    success &= checkVector(other, true, 0, NON_UNIT, -1, 150, 1);
+  }
+
+  // the function needs a triangle
+  std::vector<float> small(16, 1.0f);
+  if (engine.uplo_trsv(0, 4, NON_UNIT, 0, small.data(), 16, 0, 4, small.data(), 16, 0, 1) != nullptr) {
+    std::cout << "uplo_trsv accepted a matrix with no triangle" << std::endl;
+    success = false;
+  }
+  if (engine.uplo_trsm(1, 0, NON_UNIT, 1, 4, 4, 1.0f, small.data(), 16, 0, 4, small.data(), 15, 0, 4) != nullptr) {
+    std::cout << "uplo_trsm accepted a matrix past the end of its buffer" << std::endl;
+    success = false;
+  }
+
+  // in a batch, a solve can follow a multiplication by the same triangle
+  Triangle t(100, NON_UNIT, 1);
+  Ferrum::Tensor* a = engine.newTensor(t.data.size());
+  Ferrum::Tensor* b = engine.newTensor(100 * 20);
+  std::memcpy(a->data, t.data.data(), t.data.size() * sizeof(float));
+  std::vector<float> original = fill(100 * 20, 0.1f);
+  std::memcpy(b->data, original.data(), original.size() * sizeof(float));
+  success &= engine.beginBatch();
+  engine.uplo_trmm(1, 0, NON_UNIT, 1, 100, 20, 1.0f, a->data, a->length, 2, t.ld, b->data, b->length, 0, 100);
+  engine.uplo_trsm(1, 0, NON_UNIT, 1, 100, 20, 1.0f, a->data, a->length, 2, t.ld, b->data, b->length, 0, 100);
+  success &= engine.commitBatch();
+  double largest = 0.0;
+  for (size_t i = 0; i < original.size(); i++) {
+    largest = std::fmax(largest, std::fabs(b->data[i] - original[i]));
+  }
+  std::cout << "uplo_trmm then uplo_trsm (batch), largest difference: " << largest << std::endl;
+  success &= largest < 1e-5;
+  engine.releaseTensor(a);
+  engine.releaseTensor(b);
+
+  // the recording engine passes the functions through
+  Ferrum::RecordingEngine recording(new Ferrum::CpuEngine(2));
+  success &= checkVector(recording, true, 1, UNIT, 1, 5, 2);
+  success &= checkMatrix(recording, false, 0, 1, NON_UNIT, -1, 5, 3, 1.0f);
+  std::vector<Ferrum::RecordedCall> calls = recording.calls();
+  success &= calls.size() == 2 && calls[0].id == Ferrum::FunctionID::uplo_trsv &&
+             calls[1].id == Ferrum::FunctionID::uplo_trmm &&
+             calls[1].dims == std::vector<int>({0, 1, NON_UNIT, -1, 5, 3});
+
+  // a large solve, which is mostly matrix products
+  const int size = 1024;
+  const int repeats = 3;
+  Triangle big(size, NON_UNIT, 1);
+  std::vector<float> rhs = fill((size_t)size * size, 0.5f);
+  for (int left : {1, 0}) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < repeats; i++) {
+      engine.uplo_trsm(left, 0, NON_UNIT, 1, size, size, 1.0f, big.data.data(), big.data.size(), 2, big.ld,
+                       rhs.data(), rhs.size(), 0, size);
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    double seconds = elapsed.count() / repeats;
+    std::cout << "uplo_trsm " << (left ? "left" : "right") << " of " << size << "x" << size << ": "
+              << seconds * 1000.0 << "ms, " << (double)size * size * size / seconds / 1e9 << " GFLOPS" << std::endl;
+  }
+
+  std::cout << (success ? "Success!" : "Failed!") << std::endl;
+  return success ? 0 : 1;
+}
@@ -0,0 +1,575 @@
+#pragma once
+
+#ifndef FERRUM_BACKEND_HPP
+#define FERRUM_BACKEND_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "functions.hpp"
+
+namespace Ferrum {
+
+  // true if the kernel of a function takes the arguments of a dispatch function.
+  // This is a constant expression, so a fixed FunctionID can be checked with static_assert.
+  constexpr bool kernelAccepts(FunctionID id, Family family, Signature signature) {
+    return id >= 0 && id < functionCount &&
+           functionShapes[id].family == family && functionShapes[id].signature == signature;
+  }
+
+  // The name of a function, for messages. "unknown" if the ID is out of range.
+  constexpr const char* functionName(FunctionID id) {
+    return (id >= 0 && id < functionCount) ? functionNames[id] : "unknown";
+  }
+
+  // The 16 bit storage formats of the half precision functions, as raw bits: IEEE binary16 for fp16,
+  // and the upper half of a float for bf16
+  enum class HalfFormat { fp16, bf16 };
+
+  class FusedExpr;
+  struct FusedInput;
+
+  // A vector or matrix that stays in engine memory between calls.
+  // data is host visible, and can be passed as a buffer to any of the dispatch functions,
+  // in which case the engine works on it in place rather than copying it in and out.
+  struct Tensor {
+    float* data;
+    int length;
+  };
+
+  // The operations that every compute backend provides. The JNI layer only talks to this
+  // interface, so the Metal, CPU and recording engines are interchangeable.
+  // Engines can be called from any number of threads at once.
+  class Engine {
+
+    public:
+      virtual ~Engine() {}
+
+      // A short name for the backend, as accepted by createEngine
+      virtual const char* name() const = 0;
+
+      // A dispatch call bound to its arguments, to be run on an engine later
+      using Job = std::function<float*(Engine& engine)>;
+      // Called with the result of a job once its work is complete, which may be on another thread
+      using Completion = std::function<void(float* result)>;
+
+      // Queues a job behind any earlier submissions, and returns without waiting for it.
+      // Jobs run in the order that they are submitted, and the future holds the job's result.
+      // The future is ready once the work that the job started is complete, which on Metal can be
+      // after the job has returned. done, if given, is called with the result just before that.
+      virtual std::future<float*> submit(Job job, Completion done = nullptr) = 0;
+
+      // The asynchronous form of any dispatch function. For example:
+      //   engine->async<&Engine::vect_bB>(id, a, lena, 0, 1, result, len, 0, 1);
+      // Buffers must stay valid until the future is ready.
+      template <auto Dispatch, typename... Args>
+      std::future<float*> async(Args... args) {
+        return submit([=](Engine& engine) { return (engine.*Dispatch)(args...); });
+      }
+
+      // Allocates an uninitialized tensor of length floats, or returns nullptr on failure
+      virtual Tensor* newTensor(int length) = 0;
+      // A tensor released while this thread has a batch open keeps its memory until the batch has run
+      virtual void releaseTensor(Tensor* tensor) = 0;
+
+      // Batches run many dispatches with a single submission. Between beginBatch and commitBatch,
+      // dispatch functions check their arguments and queue the call rather than running it.
+      // Every buffer must be a tensor, and results are not written until commitBatch returns.
+      // A batch belongs to the thread that began it, so calls from other threads, and jobs passed
+      // to submit, run as usual while it is open. Returns false if this thread already has a batch open.
+      virtual bool beginBatch() = 0;
+      // Runs the calls queued since beginBatch, in order, and waits for them to finish.
+      // Returns false if this thread has no batch open, or if the batch failed to run.
+      virtual bool commitBatch() = 0;
+      // true between beginBatch and commitBatch on this thread
+      virtual bool inBatch() const = 0;
+
+      // Reproducible sums. While this is on, the reproducibleFunction reductions use compensated
+      // sums with a fixed blocking (see dispatch_plan.hpp), so their results are bitwise identical
+      // for any number of threads, and on any device. This is slower, so it is off by default.
+      // Each call uses the setting at the time that it is made, including calls in a batch.
+      virtual void setReproducible(bool on) = 0;
+      virtual bool reproducible() const = 0;
+
+      // Dispatch functions
+      // f: float, b: buffer, B: in/out buffer. The final buffer is always an out-only buffer (shown as B)
+      // Buffers are *always* followed by: length, offset, stride
+
+      // general vector functions
+      virtual float* vect_bB(FunctionID id, const float* a, int lena, int offset_a, int stride_a,
+                                            float* result, int len, int offset, int stride) = 0;
+      virtual float* vect_bfB(FunctionID id, const float* a, int lena, int offset_a, int stride_a,
+                                             float sa,
+                                             float* result, int len, int offset, int stride) = 0;
+      virtual float* vect_fbB(FunctionID id, float sa,
+                                             const float* a, int lena, int offset_a, int stride_a,
+                                             float* result, int len, int offset, int stride) = 0;
+      virtual float* vect_bbB(FunctionID id, const float* a, int lena, int offset_a, int stride_a,
+                                             const float* b, int lenb, int offset_b, int stride_b,
+                                             float* result, int len, int offset, int stride) = 0;
+      virtual float* vect_bBB(FunctionID id, const float* a, int lena, int offset_a, int stride_a,
+                                             float* b, int lenb, int offset_b, int stride_b,
+                                             float* result, int len, int offset, int stride) = 0;
+      virtual float* vect_bffffB(FunctionID id, const float* a, int lena, int offset_a, int stride_a,
+                                                float sa, float sha,
+                                                float sb, float shb,
+                                                float* result, int len, int offset, int stride) = 0;
+      virtual float* vect_bbffffB(FunctionID id, const float* a, int lena, int offset_a, int stride_a,
+                                                 const float* b, int lenb, int offset_b, int stride_b,
+                                                 float sa, float sha,
+                                                 float sb, float shb,
+                                                 float* result, int len, int offset, int stride) = 0;
+      // an expression of elementwise vector functions, evaluated in one pass (see fusion.hpp)
+      virtual float* vect_fused(const FusedExpr& expr, const std::vector<FusedInput>& inputs,
+                                float* result, int len, int offset, int stride) = 0;
+      // general matrix functions
+      virtual float* ge_bB(FunctionID id, int sd, int fd,
+                                          const float* a, int lena, int offset_a, int stride_a,
+                                          float* result, int len, int offset, int stride) = 0;
+      virtual float* ge_bfB(FunctionID id, int sd, int fd,
+                                           const float* a, int lena, int offset_a, int stride_a,
+                                           float sa,
+                                           float* result, int len, int offset, int stride) = 0;
+      virtual float* ge_fbB(FunctionID id, int sd, int fd, float sa,
+                                           const float* a, int lena, int offset_a, int stride_a,
+                                           float* result, int len, int offset, int stride) = 0;
+      virtual float* ge_bbB(FunctionID id, int sd, int fd,
+                                           const float* a, int lena, int offset_a, int stride_a,
+                                           const float* b, int lenb, int offset_b, int stride_b,
+                                           float* result, int len, int offset, int stride) = 0;
+      virtual float* ge_bBB(FunctionID id, int sd, int fd,
+                                           const float* a, int lena, int offset_a, int stride_a,
+                                           float* b, int lenb, int offset_b, int stride_b,
+                                           float* result, int len, int offset, int stride) = 0;
+      virtual float* ge_bffffB(FunctionID id, int sd, int fd,
+                                              const float* a, int lena, int offset_a, int stride_a,
+                                              float sa, float sha,
+                                              float sb, float shb,
+                                              float* result, int len, int offset, int stride) = 0;
+      virtual float* ge_bbffffB(FunctionID id, int sd, int fd,
+                                               const float* a, int lena, int offset_a, int stride_a,
+                                               const float* b, int lenb, int offset_b, int stride_b,
+                                               float sa, float sha,
+                                               float sb, float shb,
+                                               float* result, int len, int offset, int stride) = 0;
+      // general uplo functions, on the triangle of sd x sd matrices given by unit and bottom. Each
+      // matrix is either in full storage, with its leading dimension in place of the stride, or is
+      // PACKED. Copying with uplo_copy converts between the two.
+      virtual float* uplo_bB(FunctionID id, int sd, int unit, int bottom,
+                                            const float* a, int lena, int offset_a, int stride_a,
+                                            float* result, int len, int offset, int stride) = 0;
+      virtual float* uplo_bfB(FunctionID id, int sd, int unit, int bottom,
+                                             const float* a, int lena, int offset_a, int stride_a,
+                                             float sa,
+                                             float* result, int len, int offset, int stride) = 0;
+      virtual float* uplo_fbB(FunctionID id, int sd, int unit, int bottom,
+                                             const float* a, int lena, int offset_a, int stride_a,
+                                             float sa,
+                                             float* result, int len, int offset, int stride) = 0;
+      virtual float* uplo_bbB(FunctionID id, int sd, int unit, int bottom,
+                                             const float* a, int lena, int offset_a, int stride_a,
+                                             const float* b, int lenb, int offset_b, int stride_b,
+                                             float* result, int len, int offset, int stride) = 0;
+      virtual float* uplo_bBB(FunctionID id, int sd, int unit, int bottom,
+                                             const float* a, int lena, int offset_a, int stride_a,
+                                             float* b, int lenb, int offset_b, int stride_b,
+                                             float* result, int len, int offset, int stride) = 0;
+      virtual float* uplo_bffffB(FunctionID id, int sd, int unit, int bottom,
+                                                const float* a, int lena, int offset_a, int stride_a,
+                                                float sa, float sha,
+                                                float sb, float shb,
+                                                float* result, int len, int offset, int stride) = 0;
+      virtual float* uplo_bbffffB(FunctionID id, int sd, int unit, int bottom,
+                                                 const float* a, int lena, int offset_a, int stride_a,
+                                                 const float* b, int lenb, int offset_b, int stride_b,
+                                                 float sa, float sha,
+                                                 float sb, float shb,
+                                                 float* result, int len, int offset, int stride) = 0;
+      // matrix products, which have a dispatch function each (see blasFunction)
+      // c = alpha * op(a) * op(b) + beta * c, where op(a) is m x k, op(b) is k x n, and op transposes its
+      // matrix when trans_a or trans_b is non-zero. Matrices are column major, with the leading dimension
+      // in place of the stride, as for the ge_ functions. c is not read when beta is zero.
+      virtual float* ge_gemm(int trans_a, int trans_b, int m, int n, int k, float alpha,
+                             const float* a, int lena, int offset_a, int ld_a,
+                             const float* b, int lenb, int offset_b, int ld_b,
+                             float beta,
+                             float* c, int lenc, int offset_c, int ld_c) = 0;
+      // y = alpha * op(a) * x + beta * y, where a is m x n, and op transposes it when trans is non-zero.
+      // The vectors have a stride in place of the leading dimension. y is not read when beta is zero.
+      virtual float* ge_mv(int trans, int m, int n, float alpha,
+                           const float* a, int lena, int offset_a, int ld_a,
+                           const float* x, int lenx, int offset_x, int stride_x,
+                           float beta,
+                           float* y, int leny, int offset_y, int stride_y) = 0;
+      // a = alpha * x * y^T + a, where a is m x n
+      virtual float* ge_rk(int m, int n, float alpha,
+                           const float* x, int lenx, int offset_x, int stride_x,
+                           const float* y, int leny, int offset_y, int stride_y,
+                           float* a, int lena, int offset_a, int ld_a) = 0;
+      // triangular functions, on the triangle of the sd x sd matrix a given by unit and bottom, as for the
+      // uplo_ functions: the lower triangle when bottom is positive, the upper one when it is negative,
+      // and with a diagonal of ones that is not read when unit is 132. op transposes the triangle when
+      // trans is non-zero.
+      // x = op(a) * x
+      virtual float* uplo_trmv(int trans, int sd, int unit, int bottom,
+                               const float* a, int lena, int offset_a, int ld_a,
+                               float* x, int lenx, int offset_x, int stride_x) = 0;
+      // solves op(a) * y = x for y, which replaces x
+      virtual float* uplo_trsv(int trans, int sd, int unit, int bottom,
+                               const float* a, int lena, int offset_a, int ld_a,
+                               float* x, int lenx, int offset_x, int stride_x) = 0;
+      // b = alpha * op(a) * b when left is non-zero, or b = alpha * b * op(a), where b is m x n
+      // and a is m x m or n x n
+      virtual float* uplo_trmm(int left, int trans, int unit, int bottom, int m, int n, float alpha,
+                               const float* a, int lena, int offset_a, int ld_a,
+                               float* b, int lenb, int offset_b, int ld_b) = 0;
+      // solves op(a) * x = alpha * b when left is non-zero, or x * op(a) = alpha * b, for x, which replaces b
+      virtual float* uplo_trsm(int left, int trans, int unit, int bottom, int m, int n, float alpha,
+                               const float* a, int lena, int offset_a, int ld_a,
+                               float* b, int lenb, int offset_b, int ld_b) = 0;
+
+      // Double precision. These are the general vect_, ge_ and uplo_ functions with double buffers and
+      // scalars, and the same FunctionIDs. Metal has no double precision, so only the CPU engine runs
+      // them, and other engines report an error and return nullptr. They cannot be used in a batch.
+      virtual bool doublePrecision() const { return false; }
+
+      // general vector functions
+      virtual double* dvect_bB(FunctionID id, const double* /*a*/, int /*lena*/, int /*offset_a*/, int /*stride_a*/,
+                                              double* /*result*/, int /*len*/, int /*offset*/, int /*stride*/) {
+        return noDoublePrecision(id);
+      }
+      virtual double* dvect_bfB(FunctionID id, const double* /*a*/, int /*lena*/, int /*offset_a*/, int /*stride_a*/,
+                                               double /*sa*/,
+                                               double* /*result*/, int /*len*/, int /*offset*/, int /*stride*/) {
+        return noDoublePrecision(id);
+      }
+      virtual double* dvect_fbB(FunctionID id, double /*sa*/,
+                                               const double* /*a*/, int /*lena*/, int /*offset_a*/, int /*stride_a*/,
+                                               double* /*result*/, int /*len*/, int /*offset*/, int /*stride*/) {
+        return noDoublePrecision(id);
+      }
+      virtual double* dvect_bbB(FunctionID id, const double* /*a*/, int /*lena*/, int /*offset_a*/, int /*stride_a*/,
+                                               const double* /*b*/, int /*lenb*/, int /*offset_b*/, int /*stride_b*/,
+                                               double* /*result*/, int /*len*/, int /*offset*/, int /*stride*/) {
+        return noDoublePrecision(id);
+      }
+      virtual double* dvect_bBB(FunctionID id, const double* /*a*/, int /*lena*/, int /*offset_a*/, int /*stride_a*/,
+                                               double* /*b*/, int /*lenb*/, int /*offset_b*/, int /*stride_b*/,
+                                               double* /*result*/, int /*len*/, int /*offset*/, int /*stride*/) {
+        return noDoublePrecision(id);
+      }
+      virtual double* dvect_bffffB(FunctionID id, const double* /*a*/, int /*lena*/, int /*offset_a*/, int /*stride_a*/,
+                                                  double /*sa*/, double /*sha*/,
+                                                  double /*sb*/, double /*shb*/,
+                                                  double* /*result*/, int /*len*/, int /*offset*/, int /*stride*/) {
+        return noDoublePrecision(id);
+      }
+      virtual double* dvect_bbffffB(FunctionID id, const double* /*a*/, int /*lena*/, int /*offset_a*/, int /*stride_a*/,
+                                                   const double* /*b*/, int /*lenb*/, int /*offset_b*/, int /*stride_b*/,
+                                                   double /*sa*/, double /*sha*/,
+                                                   double /*sb*/, double /*shb*/,
+                                                   double* /*result*/, int /*len*/, int /*offset*/, int /*stride*/) {
+        return noDoublePrecision(id);
+      }
+      // general matrix functions
+      virtual double* dge_bB(FunctionID id, int /*sd*/, int /*fd*/,
+                                            const double* /*a*/, int /*lena*/, int /*offset_a*/, int /*stride_a*/,
+                                            double* /*result*/, int /*len*/, int /*offset*/, int /*stride*/) {
+        return noDoublePrecision(id);
+      }
+      virtual double* dge_bfB(FunctionID id, int /*sd*/, int /*fd*/,
+                                             const double* /*a*/, int /*lena*/, int /*offset_a*/, int /*stride_a*/,
+                                             double /*sa*/,
+                                             double* /*result*/, int /*len*/, int /*offset*/, int /*stride*/) {
+        return noDoublePrecision(id);
+      }
+      virtual double* dge_fbB(FunctionID id, int /*sd*/, int /*fd*/, double /*sa*/,
+                                             const double* /*a*/, int /*lena*/, int /*offset_a*/, int /*stride_a*/,
+                                             double* /*result*/, int /*len*/, int /*offset*/, int /*stride*/) {
+        return noDoublePrecision(id);
+      }
+      virtual double* dge_bbB(FunctionID id, int /*sd*/, int /*fd*/,
+                                             const double* /*a*/, int /*lena*/, int /*offset_a*/, int /*stride_a*/,
+                                             const double* /*b*/, int /*lenb*/, int /*offset_b*/, int /*stride_b*/,
+                                             double* /*result*/, int /*len*/, int /*offset*/, int /*stride*/) {
+        return noDoublePrecision(id);
+      }
+      virtual double* dge_bBB(FunctionID id, int /*sd*/, int /*fd*/,
+                                             const double* /*a*/, int /*lena*/, int /*offset_a*/, int /*stride_a*/,
+                                             double* /*b*/, int /*lenb*/, int /*offset_b*/, int /*stride_b*/,
+                                             double* /*result*/, int /*len*/, int /*offset*/, int /*stride*/) {
+        return noDoublePrecision(id);
+      }
+      virtual double* dge_bffffB(FunctionID id, int /*sd*/, int /*fd*/,
+                                                const double* /*a*/, int /*lena*/, int /*offset_a*/, int /*stride_a*/,
+                                                double /*sa*/, double /*sha*/,
+                                                double /*sb*/, double /*shb*/,
+                                                double* /*result*/, int /*len*/, int /*offset*/, int /*stride*/) {
+        return noDoublePrecision(id);
+      }
+      virtual double* dge_bbffffB(FunctionID id, int /*sd*/, int /*fd*/,
+                                                 const double* /*a*/, int /*lena*/, int /*offset_a*/, int /*stride_a*/,
+                                                 const double* /*b*/, int /*lenb*/, int /*offset_b*/, int /*stride_b*/,
+                                                 double /*sa*/, double /*sha*/,
+                                                 double /*sb*/, double /*shb*/,
+                                                 double* /*result*/, int /*len*/, int /*offset*/, int /*stride*/) {
+        return noDoublePrecision(id);
+      }
+      // general uplo functions
+      virtual double* duplo_bB(FunctionID id, int /*sd*/, int /*unit*/, int /*bottom*/,
+                                              const double* /*a*/, int /*lena*/, int /*offset_a*/, int /*stride_a*/,
+                                              double* /*result*/, int /*len*/, int /*offset*/, int /*stride*/) {
+        return noDoublePrecision(id);
+      }
+      virtual double* duplo_bfB(FunctionID id, int /*sd*/, int /*unit*/, int /*bottom*/,
+                                               const double* /*a*/, int /*lena*/, int /*offset_a*/, int /*stride_a*/,
+                                               double /*sa*/,
+                                               double* /*result*/, int /*len*/, int /*offset*/, int /*stride*/) {
+        return noDoublePrecision(id);
+      }
+      virtual double* duplo_fbB(FunctionID id, int /*sd*/, int /*unit*/, int /*bottom*/,
+                                               const double* /*a*/, int /*lena*/, int /*offset_a*/, int /*stride_a*/,
+                                               double /*sa*/,
+                                               double* /*result*/, int /*len*/, int /*offset*/, int /*stride*/) {
+        return noDoublePrecision(id);
+      }
+      virtual double* duplo_bbB(FunctionID id, int /*sd*/, int /*unit*/, int /*bottom*/,
+                                               const double* /*a*/, int /*lena*/, int /*offset_a*/, int /*stride_a*/,
+                                               const double* /*b*/, int /*lenb*/, int /*offset_b*/, int /*stride_b*/,
+                                               double* /*result*/, int /*len*/, int /*offset*/, int /*stride*/) {
+        return noDoublePrecision(id);
+      }
+      virtual double* duplo_bBB(FunctionID id, int /*sd*/, int /*unit*/, int /*bottom*/,
+                                               const double* /*a*/, int /*lena*/, int /*offset_a*/, int /*stride_a*/,
+                                               double* /*b*/, int /*lenb*/, int /*offset_b*/, int /*stride_b*/,
+                                               double* /*result*/, int /*len*/, int /*offset*/, int /*stride*/) {
+        return noDoublePrecision(id);
+      }
+      virtual double* duplo_bffffB(FunctionID id, int /*sd*/, int /*unit*/, int /*bottom*/,
+                                                  const double* /*a*/, int /*lena*/, int /*offset_a*/, int /*stride_a*/,
+                                                  double /*sa*/, double /*sha*/,
+                                                  double /*sb*/, double /*shb*/,
+                                                  double* /*result*/, int /*len*/, int /*offset*/, int /*stride*/) {
+        return noDoublePrecision(id);
+      }
+      virtual double* duplo_bbffffB(FunctionID id, int /*sd*/, int /*unit*/, int /*bottom*/,
+                                                   const double* /*a*/, int /*lena*/, int /*offset_a*/, int /*stride_a*/,
+                                                   const double* /*b*/, int /*lenb*/, int /*offset_b*/, int /*stride_b*/,
+                                                   double /*sa*/, double /*sha*/,
+                                                   double /*sb*/, double /*shb*/,
+                                                   double* /*result*/, int /*len*/, int /*offset*/, int /*stride*/) {
+        return noDoublePrecision(id);
+      }
+
+      // Half precision storage. These are the general vect_ and ge_ functions with buffers of 16 bit
+      // elements in a HalfFormat, which are converted to float as they are read and rounded to nearest
+      // even as they are written. The scalars and the arithmetic are float, so the results are those
+      // of the float functions, rounded, with half of the memory traffic. Reductions are not included,
+      // as their sums and indexes could not be stored exactly. Only the CPU engine runs these, and not
+      // in a batch; other engines report an error and return nullptr.
+      virtual bool halfStorage() const { return false; }
+
+      // general vector functions
+      virtual uint16_t* hvect_bB(FunctionID id, HalfFormat /*format*/, const uint16_t* /*a*/, int /*lena*/, int /*offset_a*/, int /*stride_a*/,
+                                                                   uint16_t* /*result*/, int /*len*/, int /*offset*/, int /*stride*/) {
+        return noHalfStorage(id);
+      }
+      virtual uint16_t* hvect_bfB(FunctionID id, HalfFormat /*format*/, const uint16_t* /*a*/, int /*lena*/, int /*offset_a*/, int /*stride_a*/,
+                                                                    float /*sa*/,
+                                                                    uint16_t* /*result*/, int /*len*/, int /*offset*/, int /*stride*/) {
+        return noHalfStorage(id);
+      }
+      virtual uint16_t* hvect_fbB(FunctionID id, HalfFormat /*format*/, float /*sa*/,
+                                                                    const uint16_t* /*a*/, int /*lena*/, int /*offset_a*/, int /*stride_a*/,
+                                                                    uint16_t* /*result*/, int /*len*/, int /*offset*/, int /*stride*/) {
+        return noHalfStorage(id);
+      }
+      virtual uint16_t* hvect_bbB(FunctionID id, HalfFormat /*format*/, const uint16_t* /*a*/, int /*lena*/, int /*offset_a*/, int /*stride_a*/,
+                                                                    const uint16_t* /*b*/, int /*lenb*/, int /*offset_b*/, int /*stride_b*/,
+                                                                    uint16_t* /*result*/, int /*len*/, int /*offset*/, int /*stride*/) {
+        return noHalfStorage(id);
+      }
+      virtual uint16_t* hvect_bBB(FunctionID id, HalfFormat /*format*/, const uint16_t* /*a*/, int /*lena*/, int /*offset_a*/, int /*stride_a*/,
+                                                                    uint16_t* /*b*/, int /*lenb*/, int /*offset_b*/, int /*stride_b*/,
+                                                                    uint16_t* /*result*/, int /*len*/, int /*offset*/, int /*stride*/) {
+        return noHalfStorage(id);
+      }
+      virtual uint16_t* hvect_bffffB(FunctionID id, HalfFormat /*format*/, const uint16_t* /*a*/, int /*lena*/, int /*offset_a*/, int /*stride_a*/,
+                                                                       float /*sa*/, float /*sha*/,
+                                                                       float /*sb*/, float /*shb*/,
+                                                                       uint16_t* /*result*/, int /*len*/, int /*offset*/, int /*stride*/) {
+        return noHalfStorage(id);
+      }
+      virtual uint16_t* hvect_bbffffB(FunctionID id, HalfFormat /*format*/, const uint16_t* /*a*/, int /*lena*/, int /*offset_a*/, int /*stride_a*/,
+                                                                        const uint16_t* /*b*/, int /*lenb*/, int /*offset_b*/, int /*stride_b*/,
+                                                                        float /*sa*/, float /*sha*/,
+                                                                        float /*sb*/, float /*shb*/,
+                                                                        uint16_t* /*result*/, int /*len*/, int /*offset*/, int /*stride*/) {
+        return noHalfStorage(id);
+      }
+      // general matrix functions
+      virtual uint16_t* hge_bB(FunctionID id, HalfFormat /*format*/, int /*sd*/, int /*fd*/,
+                                                                 const uint16_t* /*a*/, int /*lena*/, int /*offset_a*/, int /*stride_a*/,
+                                                                 uint16_t* /*result*/, int /*len*/, int /*offset*/, int /*stride*/) {
+        return noHalfStorage(id);
+      }
+      virtual uint16_t* hge_bfB(FunctionID id, HalfFormat /*format*/, int /*sd*/, int /*fd*/,
+                                                                  const uint16_t* /*a*/, int /*lena*/, int /*offset_a*/, int /*stride_a*/,
+                                                                  float /*sa*/,
+                                                                  uint16_t* /*result*/, int /*len*/, int /*offset*/, int /*stride*/) {
+        return noHalfStorage(id);
+      }
+      virtual uint16_t* hge_fbB(FunctionID id, HalfFormat /*format*/, int /*sd*/, int /*fd*/, float /*sa*/,
+                                                                  const uint16_t* /*a*/, int /*lena*/, int /*offset_a*/, int /*stride_a*/,
+                                                                  uint16_t* /*result*/, int /*len*/, int /*offset*/, int /*stride*/) {
+        return noHalfStorage(id);
+      }
+      virtual uint16_t* hge_bbB(FunctionID id, HalfFormat /*format*/, int /*sd*/, int /*fd*/,
+                                                                  const uint16_t* /*a*/, int /*lena*/, int /*offset_a*/, int /*stride_a*/,
+                                                                  const uint16_t* /*b*/, int /*lenb*/, int /*offset_b*/, int /*stride_b*/,
+                                                                  uint16_t* /*result*/, int /*len*/, int /*offset*/, int /*stride*/) {
+        return noHalfStorage(id);
+      }
+      virtual uint16_t* hge_bBB(FunctionID id, HalfFormat /*format*/, int /*sd*/, int /*fd*/,
+                                                                  const uint16_t* /*a*/, int /*lena*/, int /*offset_a*/, int /*stride_a*/,
+                                                                  uint16_t* /*b*/, int /*lenb*/, int /*offset_b*/, int /*stride_b*/,
+                                                                  uint16_t* /*result*/, int /*len*/, int /*offset*/, int /*stride*/) {
+        return noHalfStorage(id);
+      }
+      virtual uint16_t* hge_bffffB(FunctionID id, HalfFormat /*format*/, int /*sd*/, int /*fd*/,
+                                                                     const uint16_t* /*a*/, int /*lena*/, int /*offset_a*/, int /*stride_a*/,
+                                                                     float /*sa*/, float /*sha*/,
+                                                                     float /*sb*/, float /*shb*/,
+                                                                     uint16_t* /*result*/, int /*len*/, int /*offset*/, int /*stride*/) {
+        return noHalfStorage(id);
+      }
+      virtual uint16_t* hge_bbffffB(FunctionID id, HalfFormat /*format*/, int /*sd*/, int /*fd*/,
+                                                                      const uint16_t* /*a*/, int /*lena*/, int /*offset_a*/, int /*stride_a*/,
+                                                                      const uint16_t* /*b*/, int /*lenb*/, int /*offset_b*/, int /*stride_b*/,
+                                                                      float /*sa*/, float /*sha*/,
+                                                                      float /*sb*/, float /*shb*/,
+                                                                      uint16_t* /*result*/, int /*len*/, int /*offset*/, int /*stride*/) {
+        return noHalfStorage(id);
+      }
+
+    protected:
+      // The result of a double precision function on an engine without them
+      double* noDoublePrecision(FunctionID id) const {
+        std::cerr << "Error: The " << name() << " engine has no double precision for '" << functionName(id) << "'" << std::endl;
+        return nullptr;
+      }
+
+      // The result of a half precision function on an engine without them
+      uint16_t* noHalfStorage(FunctionID id) const {
+        std::cerr << "Error: The " << name() << " engine has no half precision storage for '" << functionName(id) << "'" << std::endl;
+        return nullptr;
+      }
+  };
+
+  // Environment variable that selects the backend when the init path does not
+  const char* const FERRUM_BACKEND = "FERRUM_BACKEND";
+
+  // Creates an engine from a backend specification of the form: [backend:]argument
+  //   metal[:path]     - the Metal engine, loading the library from path (the default backend)
+  //   cpu[:threads]    - the CPU engine, with an optional number of worker threads
+  //   recording[:spec] - records every call, and forwards to the engine for spec if it is given
+  // A spec without a known backend prefix is a Metal library path, with the backend taken from
+  // the FERRUM_BACKEND environment variable if it is set.
+  // If the Metal engine is not explicitly requested, and cannot be started, then the CPU engine is used.
+  // Returns nullptr if the backend is unknown or cannot be started.
+  Engine* createEngine(const char* spec);
+
+  // true for the vector functions that reduce their arguments to a single value. The value is
+  // written to the first element of the result, so the result only needs room for one element.
+  inline bool reductionFunction(FunctionID id) {
+    switch (id) {
+      case FunctionID::vector_sum:
+      case FunctionID::vector_asum:
+      case FunctionID::vector_nrm2:
+      case FunctionID::vector_dot:
+      case FunctionID::vector_amax:
+      case FunctionID::vector_iamax:
+      case FunctionID::vector_min:
+      case FunctionID::vector_max:
+      case FunctionID::vector_equals:
+        return true;
+      default:
+        return false;
+    }
+  }
+
+  // true for the reductions that change in reproducible mode. The others find a single element,
+  // so their results never depend on the order of the elements.
+  inline bool reproducibleFunction(FunctionID id) {
+    switch (id) {
+      case FunctionID::vector_sum:
+      case FunctionID::vector_asum:
+      case FunctionID::vector_nrm2:
+      case FunctionID::vector_dot:
+        return true;
+      default:
+        return false;
+    }
+  }
+
+  // true for the functions that are only run through a dispatch function of their own, such as
+  // ge_gemm, rather than through the general vect_, ge_ and uplo_ functions
+  inline bool blasFunction(FunctionID id) {
+    switch (id) {
+      case FunctionID::ge_gemm:
+      case FunctionID::ge_mv:
+      case FunctionID::ge_rk:
+      case FunctionID::uplo_trmm:
+      case FunctionID::uplo_trmv:
+      case FunctionID::uplo_trsm:
+      case FunctionID::uplo_trsv:
+        return true;
+      default:
+        return false;
+    }
+  }
+
+  // A leading dimension of PACKED for a matrix of a general uplo function means that only its
+  // triangle is stored, column by column with no gaps, as in the TP and SP layouts of BLAS. The
+  // diagonal has its place even when it is not read. A packed matrix needs a triangle, so bottom
+  // cannot be zero.
+  const int PACKED = 0;
+
+  // The elements of a packed sd x sd triangle
+  inline ptrdiff_t packedLength(ptrdiff_t sd) {
+    return sd * (sd + 1) / 2;
+  }
+
+  // The position of element (i, j) of the triangle of an uplo matrix with leading dimension ld.
+  // This must match uplo_index in vect-math.h.
+  inline ptrdiff_t uploIndex(ptrdiff_t i, ptrdiff_t j, int ld, ptrdiff_t sd, int bottom) {
+    if (ld != PACKED) {
+      return i + j * ld;
+    }
+    // lower columns hold sd - j elements from the diagonal down, and upper ones j + 1 elements
+    return (bottom > 0) ? i + j * (2 * sd - j - 1) / 2 : i + j * (j + 1) / 2;
+  }
+
+  // Tests if a column-major sd x fd matrix fits in a buffer
+  inline bool geFits(int len, int offset, int ld, int sd, int fd) {
+    if (sd <= 0 || fd <= 0) {
+      return true;
+    }
+    return offset >= 0 && ld >= 1 && (ptrdiff_t)offset + (sd - 1) + (ptrdiff_t)(fd - 1) * ld < len;
+  }
+
+  // Tests if the triangle of an sd x sd uplo matrix fits in a buffer, where it may be packed
+  inline bool uploFits(int len, int offset, int ld, int sd) {
+    if (ld != PACKED || sd <= 0) {
+      return geFits(len, offset, ld, sd, sd);
+    }
+    return offset >= 0 && (ptrdiff_t)offset + packedLength(sd) <= len;
+  }
+
+} // namespace Ferrum
+
+#endif // FERRUM_BACKEND_HPP
@@ -0,0 +1,107 @@
+#pragma once
+
+#ifndef FERRUM_BUFFER_POOL_HPP
+#define FERRUM_BUFFER_POOL_HPP
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Ferrum {
+
+  // A block of memory from an allocator.
+  // handle: the allocator's own object for the block, such as an MTL::Buffer
+  // contents: host-visible memory for the block
+  struct Block {
+    void* handle;
+    void* contents;
+    size_t size;
+  };
+
+  // Source of the memory held by a BufferPool
+  class BlockAllocator {
+    public:
+      virtual ~BlockAllocator() {}
+      // Returns a block of exactly size bytes, or a block with a null handle on failure
+      virtual Block allocate(size_t size) = 0;
+      virtual void release(const Block& block) = 0;
+  };
+
+  // Allocates blocks from the heap. Used for testing the pool, and for host-side buffers.
+  class HostAllocator : public BlockAllocator {
+    public:
+      Block allocate(size_t size) override;
+      void release(const Block& block) override;
+  };
+
+  // Host memory that engines may use in place, such as the direct buffers from
+  // FerrumEngine.newFloatBuffer. Each allocation starts on a page and covers whole pages, for pages
+  // of up to HOST_PAGE bytes, so a device can map all of it. Other memory, such as a Java array, is
+  // only known to hold the elements that it was passed with, so the Metal engine copies it.
+  const size_t HOST_PAGE = 16384;
+  // Returns nullptr if the memory cannot be allocated
+  float* newHostMemory(int length);
+  // Frees memory from newHostMemory, which no call may still be using
+  void releaseHostMemory(float* data);
+  // The bytes allocated by newHostMemory at data, or 0 if data is not the start of host memory
+  size_t hostMemorySize(const float* data);
+
+  // Reuses blocks between calls, rather than allocating for every call.
+  // Requests are rounded up to a power of two, and freed blocks are kept on a list for their size.
+  class BufferPool {
+
+    public:
+      static const size_t MIN_BLOCK = 256;
+
+      // allocator: the source of memory. This is not owned by the pool.
+      // limit: the most memory to keep in free blocks. Blocks freed beyond this are released.
+      // idleTime: free blocks are released after the pool is unused for this long. Zero disables this.
+      BufferPool(BlockAllocator* allocator, size_t limit,
+                 std::chrono::milliseconds idleTime = std::chrono::milliseconds(0));
+      ~BufferPool();
+
+      // Returns a block of at least size bytes, or a block with a null handle on failure
+      Block acquire(size_t size);
+      // Returns a block from acquire to the pool
+      void recycle(const Block& block);
+      // Releases all free blocks
+      void trim();
+
+      // The memory currently held in free blocks
+      size_t freeBytes();
+      // The memory currently handed out by acquire
+      size_t usedBytes();
+      // The most memory that has been held at once, used and free
+      size_t highWaterMark();
+
+      // The size that a request is rounded up to
+      static size_t blockSize(size_t size);
+
+    private:
+      BlockAllocator* allocator;
+      size_t limit;
+      std::chrono::milliseconds idleTime;
+
+      std::mutex lock;
+      // free blocks, indexed by the log2 of their size
+      std::vector<std::vector<Block>> freeBlocks;
+      size_t freeTotal;
+      size_t usedTotal;
+      size_t peak;
+      std::chrono::steady_clock::time_point lastUsed;
+
+      std::thread reaper;
+      std::condition_variable reaperWake;
+      bool stopping;
+
+      void reaperLoop();
+      // releases free blocks, largest first, until no more than target bytes are free
+      void trimTo(size_t target);
+  };
+
+} // namespace Ferrum
+
+#endif // FERRUM_BUFFER_POOL_HPP
@@ -0,0 +1,100 @@
+#pragma once
+
+#ifndef FERRUM_CPU_BLAS_HPP
+#define FERRUM_CPU_BLAS_HPP
+
+#include <cstddef>
+
+// Matrix-vector and triangular functions on the CPU. The matrix-vector functions read each element
+// of the matrix once, so they are limited by memory bandwidth, and the vectorized loops of
+// cpu_simd.cpp stream through it.
+
+namespace Ferrum {
+
+  class ThreadPool;
+  struct CpuGemmKernel;
+
+  // The arguments of y = alpha * op(a) * x + beta * y (see Engine::ge_mv), where a is m x n.
+  // Each buffer points at the first element of its matrix or vector, and a is column major.
+  struct CpuGemv {
+    ptrdiff_t m;
+    ptrdiff_t n;
+    bool trans;
+    float alpha;
+    float beta;
+    const float* a;
+    ptrdiff_t lda;
+    const float* x;
+    ptrdiff_t incx;
+    float* y;
+    ptrdiff_t incy;
+  };
+
+  // The arguments of a = alpha * x * y^T + a (see Engine::ge_rk), where a is m x n
+  struct CpuRank1 {
+    ptrdiff_t m;
+    ptrdiff_t n;
+    float alpha;
+    const float* x;
+    ptrdiff_t incx;
+    const float* y;
+    ptrdiff_t incy;
+    float* a;
+    ptrdiff_t lda;
+  };
+
+  // The vectorized loops of a build of cpu_simd.cpp, each over a rows x cols block of a
+  struct CpuLevel2Kernel {
+    // y[0, rows) += a * x
+    void (*columns)(ptrdiff_t rows, ptrdiff_t cols, const float* a, ptrdiff_t lda,
+                    const float* x, ptrdiff_t incx, float* y);
+    // out[j] = the dot product of column j with x, where x is contiguous
+    void (*dots)(ptrdiff_t rows, ptrdiff_t cols, const float* a, ptrdiff_t lda, const float* x, float* out);
+    // column j += (alpha * y[j * incy]) * x, where x is contiguous
+    void (*rank1)(ptrdiff_t rows, ptrdiff_t cols, float alpha, const float* x, const float* y, ptrdiff_t incy,
+                  float* a, ptrdiff_t lda);
+  };
+
+  // Runs a matrix-vector product on the pool. Without a transpose, the rows are split between
+  // threads, and each thread sums a block of y across every column.
+  void runGemv(ThreadPool& pool, const CpuLevel2Kernel& kernel, const CpuGemv& gemv);
+
+  // Runs a rank 1 update on the pool, with the columns split between threads
+  void runRank1(ThreadPool& pool, const CpuLevel2Kernel& kernel, const CpuRank1& rank1);
+
+  // A matrix with element (i, j) at data[i + j * ld], or at data[j + i * ld] when it is transposed.
+  // A vector with a stride is a transposed matrix of one column, with the stride as ld.
+  struct CpuView {
+    float* data;
+    ptrdiff_t ld;
+    bool trans;
+
+    float& at(ptrdiff_t i, ptrdiff_t j) const { return trans ? data[j + i * ld] : data[i + j * ld]; }
+    // the part of the matrix from element (i, j)
+    CpuView from(ptrdiff_t i, ptrdiff_t j) const { return {&at(i, j), ld, trans}; }
+  };
+
+  // The arguments of b = alpha * t * b, or of solving t * x = alpha * b for x, which replaces b.
+  // t is the lower or upper triangle of the sd x sd matrix a, and b is sd x n. a is only read.
+  // A triangle on the right of b is turned into this form by transposing both matrices.
+  struct CpuTriangular {
+    bool solve;
+    bool lower;
+    // the diagonal of t is all ones, and is not read
+    bool unit;
+    ptrdiff_t sd;
+    ptrdiff_t n;
+    float alpha;
+    CpuView a;
+    CpuView b;
+  };
+
+  // Runs a triangular function a block of TRIANGULAR_BLOCK rows at a time. Each diagonal block is
+  // solved or multiplied by one thread for each part of the columns of b, and the rest of the
+  // triangle is applied with a matrix product on the pool (a matrix-vector product when n is 1).
+  void runTriangular(ThreadPool& pool, const CpuGemmKernel& gemm, const CpuLevel2Kernel& level2,
+                     const CpuTriangular& triangular);
+
+} // namespace Ferrum
+
+#endif // FERRUM_CPU_BLAS_HPP
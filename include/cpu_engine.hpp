@@ -0,0 +1,501 @@
+#pragma once
+
+#ifndef FERRUM_CPU_ENGINE_HPP
+#define FERRUM_CPU_ENGINE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "backend.hpp"
+#include "cpu_blas.hpp"
+#include "cpu_features.hpp"
+#include "cpu_gemm.hpp"
+#include "debug.hpp"
+
+namespace Ferrum {
+
+  class SerialQueue;
+  class ThreadPool;
+
+  // A run of n elements to be processed by a CPU kernel.
+  // Each buffer is addressed as ptr[i * inc]. x and y are inputs, r is the result buffer,
+  // and r2 is the in/out buffer of the bBB functions.
+  // Scalars appear in the order that they are passed to the dispatch function.
+  // T is the element type: float, or double for the double precision dispatch functions.
+  template <typename T>
+  struct CpuRunOf {
+    ptrdiff_t n;
+    const T* x;
+    ptrdiff_t incx;
+    const T* y;
+    ptrdiff_t incy;
+    T* r;
+    ptrdiff_t incr;
+    T* r2;
+    ptrdiff_t incr2;
+    T s[4];
+  };
+
+  using CpuRun = CpuRunOf<float>;
+
+  // The reduction of part of a run
+  struct CpuPartial {
+    // the sum, or the extreme value. Sums are kept in double precision.
+    double value;
+    // for iamax, the position of value in the whole run, or -1 if the part was empty
+    ptrdiff_t index;
+    // for reproducible sums, the rounding errors of the additions to value, and for reproducible
+    // nrm2, the largest magnitude. The reproducible reductions only hold floats here.
+    double scale;
+  };
+
+  // A reduction of a run to a single value, which is written to the first element of the result.
+  // Runs are split into blocks of a fixed size, and the partial results of the blocks are combined
+  // in a fixed order, so the result does not depend on the number of threads.
+  template <typename T>
+  struct CpuReducerOf {
+    // reduces a run, where start is the position of its first element in the whole run
+    CpuPartial (*reduce)(const CpuRunOf<T>& run, ptrdiff_t start);
+    void (*combine)(CpuPartial& total, const CpuPartial& next);
+    T (*finish)(const CpuPartial& total);
+    // the elements in each block
+    ptrdiff_t block;
+    // true if the partial results are combined in lanes and then a tree, in the same way as the
+    // reproducible sums of reduction.metal, rather than one after another
+    bool tree;
+  };
+
+  using CpuReducer = CpuReducerOf<float>;
+
+  // CPU implementation of a single Metal kernel
+  template <typename T>
+  struct CpuKernelOf {
+    Signature signature;
+    void (*run)(const CpuRunOf<T>& run);
+    // the reduction, in place of run, or nullptr for elementwise kernels
+    const CpuReducerOf<T>* reduction;
+    // the reduction to use for reproducible sums, or nullptr to use the usual one
+    const CpuReducerOf<T>* reproducible;
+  };
+
+  // Metal has no double precision, so the double kernels only exist on the CPU, and have no
+  // vectorized versions in cpu_simd.cpp
+  using CpuDoubleKernel = CpuKernelOf<double>;
+
+  // Conversions between float and a half precision storage format, for the half precision functions.
+  // load reads n elements that are inc apart into contiguous floats, and store writes them back.
+  struct CpuHalfKernel {
+    void (*load)(const uint16_t* src, ptrdiff_t inc, ptrdiff_t n, float* dst);
+    void (*store)(const float* src, ptrdiff_t n, uint16_t* dst, ptrdiff_t inc);
+  };
+
+  struct CpuFusion;
+
+  // A call to a kernel, with its arguments checked. Batches are lists of these.
+  struct CpuStep {
+    enum Shape { vect, ge, uplo, fused, gemm, gemv, rank1, triangular };
+    Shape shape;
+    const CpuKernel* kernel;
+    // sd x fd for ge functions; sd, bottom and the first row offset (diagonal) for uplo functions
+    int sd;
+    int fd;
+    int bottom;
+    int diagonal;
+    // the kernels of a fused expression, in place of kernel. run.n is the element count.
+    std::shared_ptr<const CpuFusion> fusion;
+    // for reductions, the reducer chosen when the call was made
+    const CpuReducer* reduction;
+    // The arguments, which depend on the shape. Only one is used, which keeps batches compact.
+    union {
+      // vect, ge, uplo and fused steps
+      CpuRun run;
+      CpuGemm product;
+      CpuGemv mv;
+      CpuRank1 rk;
+      CpuTriangular tr;
+    };
+  };
+
+  // Runs the functions in the Metal library on the host, using the same FunctionIDs and
+  // argument conventions as MetalEngine. Work is split across a pool of threads.
+  class CpuEngine : public Engine {
+
+    public:
+      // threads: the number of worker threads to start. Negative uses all available cores.
+      CpuEngine(int threads = -1);
+      ~CpuEngine();
+
+      const char* name() const override { return "cpu"; }
+
+      // The instruction set of the vectorized kernels, chosen when the engine is constructed
+      CpuIsa instructionSet() const { return isa; }
+
+      Tensor* newTensor(int length) override;
+      void releaseTensor(Tensor* tensor) override;
+
+      // A batch is a list of kernel runs, which commitBatch runs back to back.
+      // Each thread has its own batch, so calls from other threads run outside of it.
+      bool beginBatch() override;
+      bool commitBatch() override;
+      bool inBatch() const override;
+
+      // Reproducible sums repeat the arithmetic of the Metal kernels, in float
+      void setReproducible(bool on) override { reproducibleSums = on; }
+      bool reproducible() const override { return reproducibleSums; }
+
+      // Jobs run in order on a submission thread, and each one uses the thread pool
+      std::future<float*> submit(Job job, Completion done = nullptr) override;
+
+      // Dispatch functions
+      // f: float, b: buffer, B: in/out buffer. The final buffer is always an out-only buffer (shown as B)
+      // Buffers are *always* followed by: length, offset, stride
+
+      // general vector functions
+      float* vect_bB(FunctionID id, const float* a, int lena, int offset_a, int stride_a,
+                                    float* result, int len, int offset, int stride) override;
+      float* vect_bfB(FunctionID id, const float* a, int lena, int offset_a, int stride_a,
+                                     float sa,
+                                     float* result, int len, int offset, int stride) override;
+      float* vect_fbB(FunctionID id, float sa,
+                                     const float* a, int lena, int offset_a, int stride_a,
+                                     float* result, int len, int offset, int stride) override;
+      float* vect_bbB(FunctionID id, const float* a, int lena, int offset_a, int stride_a,
+                                     const float* b, int lenb, int offset_b, int stride_b,
+                                     float* result, int len, int offset, int stride) override;
+      float* vect_bBB(FunctionID id, const float* a, int lena, int offset_a, int stride_a,
+                                     float* b, int lenb, int offset_b, int stride_b,
+                                     float* result, int len, int offset, int stride) override;
+      float* vect_bffffB(FunctionID id, const float* a, int lena, int offset_a, int stride_a,
+                                        float sa, float sha,
+                                        float sb, float shb,
+                                        float* result, int len, int offset, int stride) override;
+      float* vect_bbffffB(FunctionID id, const float* a, int lena, int offset_a, int stride_a,
+                                         const float* b, int lenb, int offset_b, int stride_b,
+                                         float sa, float sha,
+                                         float sb, float shb,
+                                         float* result, int len, int offset, int stride) override;
+      // evaluated a block of elements at a time, with the intermediate values kept in cache
+      float* vect_fused(const FusedExpr& expr, const std::vector<FusedInput>& inputs,
+                        float* result, int len, int offset, int stride) override;
+      // general matrix functions
+      float* ge_bB(FunctionID id, int sd, int fd,
+                                  const float* a, int lena, int offset_a, int stride_a,
+                                  float* result, int len, int offset, int stride) override;
+      float* ge_bfB(FunctionID id, int sd, int fd,
+                                   const float* a, int lena, int offset_a, int stride_a,
+                                   float sa,
+                                   float* result, int len, int offset, int stride) override;
+      float* ge_fbB(FunctionID id, int sd, int fd, float sa,
+                                   const float* a, int lena, int offset_a, int stride_a,
+                                   float* result, int len, int offset, int stride) override;
+      float* ge_bbB(FunctionID id, int sd, int fd,
+                                   const float* a, int lena, int offset_a, int stride_a,
+                                   const float* b, int lenb, int offset_b, int stride_b,
+                                   float* result, int len, int offset, int stride) override;
+      float* ge_bBB(FunctionID id, int sd, int fd,
+                                   const float* a, int lena, int offset_a, int stride_a,
+                                   float* b, int lenb, int offset_b, int stride_b,
+                                   float* result, int len, int offset, int stride) override;
+      float* ge_bffffB(FunctionID id, int sd, int fd,
+                                      const float* a, int lena, int offset_a, int stride_a,
+                                      float sa, float sha,
+                                      float sb, float shb,
+                                      float* result, int len, int offset, int stride) override;
+      float* ge_bbffffB(FunctionID id, int sd, int fd,
+                                       const float* a, int lena, int offset_a, int stride_a,
+                                       const float* b, int lenb, int offset_b, int stride_b,
+                                       float sa, float sha,
+                                       float sb, float shb,
+                                       float* result, int len, int offset, int stride) override;
+      // general uplo functions
+      float* uplo_bB(FunctionID id, int sd, int unit, int bottom,
+                                    const float* a, int lena, int offset_a, int stride_a,
+                                    float* result, int len, int offset, int stride) override;
+      float* uplo_bfB(FunctionID id, int sd, int unit, int bottom,
+                                     const float* a, int lena, int offset_a, int stride_a,
+                                     float sa,
+                                     float* result, int len, int offset, int stride) override;
+      float* uplo_fbB(FunctionID id, int sd, int unit, int bottom,
+                                     const float* a, int lena, int offset_a, int stride_a,
+                                     float sa,
+                                     float* result, int len, int offset, int stride) override;
+      float* uplo_bbB(FunctionID id, int sd, int unit, int bottom,
+                                     const float* a, int lena, int offset_a, int stride_a,
+                                     const float* b, int lenb, int offset_b, int stride_b,
+                                     float* result, int len, int offset, int stride) override;
+      float* uplo_bBB(FunctionID id, int sd, int unit, int bottom,
+                                     const float* a, int lena, int offset_a, int stride_a,
+                                     float* b, int lenb, int offset_b, int stride_b,
+                                     float* result, int len, int offset, int stride) override;
+      float* uplo_bffffB(FunctionID id, int sd, int unit, int bottom,
+                                        const float* a, int lena, int offset_a, int stride_a,
+                                        float sa, float sha,
+                                        float sb, float shb,
+                                        float* result, int len, int offset, int stride) override;
+      float* uplo_bbffffB(FunctionID id, int sd, int unit, int bottom,
+                                         const float* a, int lena, int offset_a, int stride_a,
+                                         const float* b, int lenb, int offset_b, int stride_b,
+                                         float sa, float sha,
+                                         float sb, float shb,
+                                         float* result, int len, int offset, int stride) override;
+      // matrix products, blocked for the caches (see cpu_gemm.hpp)
+      float* ge_gemm(int trans_a, int trans_b, int m, int n, int k,
+                     float alpha,
+                     const float* a, int lena, int offset_a, int ld_a,
+                     const float* b, int lenb, int offset_b, int ld_b,
+                     float beta,
+                     float* c, int lenc, int offset_c, int ld_c) override;
+      // matrix-vector functions, which stream through the matrix once (see cpu_blas.hpp)
+      float* ge_mv(int trans, int m, int n, float alpha,
+                   const float* a, int lena, int offset_a, int ld_a,
+                   const float* x, int lenx, int offset_x, int stride_x,
+                   float beta,
+                   float* y, int leny, int offset_y, int stride_y) override;
+      float* ge_rk(int m, int n, float alpha,
+                   const float* x, int lenx, int offset_x, int stride_x,
+                   const float* y, int leny, int offset_y, int stride_y,
+                   float* a, int lena, int offset_a, int ld_a) override;
+      // triangular functions, in blocks (see cpu_blas.hpp)
+      float* uplo_trmv(int trans, int sd, int unit, int bottom,
+                       const float* a, int lena, int offset_a, int ld_a,
+                       float* x, int lenx, int offset_x, int stride_x) override;
+      float* uplo_trsv(int trans, int sd, int unit, int bottom,
+                       const float* a, int lena, int offset_a, int ld_a,
+                       float* x, int lenx, int offset_x, int stride_x) override;
+      float* uplo_trmm(int left, int trans, int unit, int bottom, int m, int n, float alpha,
+                       const float* a, int lena, int offset_a, int ld_a,
+                       float* b, int lenb, int offset_b, int ld_b) override;
+      float* uplo_trsm(int left, int trans, int unit, int bottom, int m, int n, float alpha,
+                       const float* a, int lena, int offset_a, int ld_a,
+                       float* b, int lenb, int offset_b, int ld_b) override;
+
+      // double precision, with the scalar kernels of the reference versions, and only outside of a batch
+      bool doublePrecision() const override { return true; }
+      // general vector functions
+      double* dvect_bB(FunctionID id, const double* a, int lena, int offset_a, int stride_a,
+                                      double* result, int len, int offset, int stride) override;
+      double* dvect_bfB(FunctionID id, const double* a, int lena, int offset_a, int stride_a,
+                                       double sa,
+                                       double* result, int len, int offset, int stride) override;
+      double* dvect_fbB(FunctionID id, double sa,
+                                       const double* a, int lena, int offset_a, int stride_a,
+                                       double* result, int len, int offset, int stride) override;
+      double* dvect_bbB(FunctionID id, const double* a, int lena, int offset_a, int stride_a,
+                                       const double* b, int lenb, int offset_b, int stride_b,
+                                       double* result, int len, int offset, int stride) override;
+      double* dvect_bBB(FunctionID id, const double* a, int lena, int offset_a, int stride_a,
+                                       double* b, int lenb, int offset_b, int stride_b,
+                                       double* result, int len, int offset, int stride) override;
+      double* dvect_bffffB(FunctionID id, const double* a, int lena, int offset_a, int stride_a,
+                                          double sa, double sha,
+                                          double sb, double shb,
+                                          double* result, int len, int offset, int stride) override;
+      double* dvect_bbffffB(FunctionID id, const double* a, int lena, int offset_a, int stride_a,
+                                           const double* b, int lenb, int offset_b, int stride_b,
+                                           double sa, double sha,
+                                           double sb, double shb,
+                                           double* result, int len, int offset, int stride) override;
+      // general matrix functions
+      double* dge_bB(FunctionID id, int sd, int fd,
+                                    const double* a, int lena, int offset_a, int stride_a,
+                                    double* result, int len, int offset, int stride) override;
+      double* dge_bfB(FunctionID id, int sd, int fd,
+                                     const double* a, int lena, int offset_a, int stride_a,
+                                     double sa,
+                                     double* result, int len, int offset, int stride) override;
+      double* dge_fbB(FunctionID id, int sd, int fd, double sa,
+                                     const double* a, int lena, int offset_a, int stride_a,
+                                     double* result, int len, int offset, int stride) override;
+      double* dge_bbB(FunctionID id, int sd, int fd,
+                                     const double* a, int lena, int offset_a, int stride_a,
+                                     const double* b, int lenb, int offset_b, int stride_b,
+                                     double* result, int len, int offset, int stride) override;
+      double* dge_bBB(FunctionID id, int sd, int fd,
+                                     const double* a, int lena, int offset_a, int stride_a,
+                                     double* b, int lenb, int offset_b, int stride_b,
+                                     double* result, int len, int offset, int stride) override;
+      double* dge_bffffB(FunctionID id, int sd, int fd,
+                                        const double* a, int lena, int offset_a, int stride_a,
+                                        double sa, double sha,
+                                        double sb, double shb,
+                                        double* result, int len, int offset, int stride) override;
+      double* dge_bbffffB(FunctionID id, int sd, int fd,
+                                         const double* a, int lena, int offset_a, int stride_a,
+                                         const double* b, int lenb, int offset_b, int stride_b,
+                                         double sa, double sha,
+                                         double sb, double shb,
+                                         double* result, int len, int offset, int stride) override;
+      // general uplo functions
+      double* duplo_bB(FunctionID id, int sd, int unit, int bottom,
+                                      const double* a, int lena, int offset_a, int stride_a,
+                                      double* result, int len, int offset, int stride) override;
+      double* duplo_bfB(FunctionID id, int sd, int unit, int bottom,
+                                       const double* a, int lena, int offset_a, int stride_a,
+                                       double sa,
+                                       double* result, int len, int offset, int stride) override;
+      double* duplo_fbB(FunctionID id, int sd, int unit, int bottom,
+                                       const double* a, int lena, int offset_a, int stride_a,
+                                       double sa,
+                                       double* result, int len, int offset, int stride) override;
+      double* duplo_bbB(FunctionID id, int sd, int unit, int bottom,
+                                       const double* a, int lena, int offset_a, int stride_a,
+                                       const double* b, int lenb, int offset_b, int stride_b,
+                                       double* result, int len, int offset, int stride) override;
+      double* duplo_bBB(FunctionID id, int sd, int unit, int bottom,
+                                       const double* a, int lena, int offset_a, int stride_a,
+                                       double* b, int lenb, int offset_b, int stride_b,
+                                       double* result, int len, int offset, int stride) override;
+      double* duplo_bffffB(FunctionID id, int sd, int unit, int bottom,
+                                          const double* a, int lena, int offset_a, int stride_a,
+                                          double sa, double sha,
+                                          double sb, double shb,
+                                          double* result, int len, int offset, int stride) override;
+      double* duplo_bbffffB(FunctionID id, int sd, int unit, int bottom,
+                                           const double* a, int lena, int offset_a, int stride_a,
+                                           const double* b, int lenb, int offset_b, int stride_b,
+                                           double sa, double sha,
+                                           double sb, double shb,
+                                           double* result, int len, int offset, int stride) override;
+
+      // half precision storage, converted a block at a time around the float kernels, and only outside of a batch
+      bool halfStorage() const override { return true; }
+      // general vector functions
+      uint16_t* hvect_bB(FunctionID id, HalfFormat format, const uint16_t* a, int lena, int offset_a, int stride_a,
+                                                           uint16_t* result, int len, int offset, int stride) override;
+      uint16_t* hvect_bfB(FunctionID id, HalfFormat format, const uint16_t* a, int lena, int offset_a, int stride_a,
+                                                            float sa,
+                                                            uint16_t* result, int len, int offset, int stride) override;
+      uint16_t* hvect_fbB(FunctionID id, HalfFormat format, float sa,
+                                                            const uint16_t* a, int lena, int offset_a, int stride_a,
+                                                            uint16_t* result, int len, int offset, int stride) override;
+      uint16_t* hvect_bbB(FunctionID id, HalfFormat format, const uint16_t* a, int lena, int offset_a, int stride_a,
+                                                            const uint16_t* b, int lenb, int offset_b, int stride_b,
+                                                            uint16_t* result, int len, int offset, int stride) override;
+      uint16_t* hvect_bBB(FunctionID id, HalfFormat format, const uint16_t* a, int lena, int offset_a, int stride_a,
+                                                            uint16_t* b, int lenb, int offset_b, int stride_b,
+                                                            uint16_t* result, int len, int offset, int stride) override;
+      uint16_t* hvect_bffffB(FunctionID id, HalfFormat format, const uint16_t* a, int lena, int offset_a, int stride_a,
+                                                               float sa, float sha,
+                                                               float sb, float shb,
+                                                               uint16_t* result, int len, int offset, int stride) override;
+      uint16_t* hvect_bbffffB(FunctionID id, HalfFormat format, const uint16_t* a, int lena, int offset_a, int stride_a,
+                                                                const uint16_t* b, int lenb, int offset_b, int stride_b,
+                                                                float sa, float sha,
+                                                                float sb, float shb,
+                                                                uint16_t* result, int len, int offset, int stride) override;
+      // general matrix functions
+      uint16_t* hge_bB(FunctionID id, HalfFormat format, int sd, int fd,
+                                                         const uint16_t* a, int lena, int offset_a, int stride_a,
+                                                         uint16_t* result, int len, int offset, int stride) override;
+      uint16_t* hge_bfB(FunctionID id, HalfFormat format, int sd, int fd,
+                                                          const uint16_t* a, int lena, int offset_a, int stride_a,
+                                                          float sa,
+                                                          uint16_t* result, int len, int offset, int stride) override;
+      uint16_t* hge_fbB(FunctionID id, HalfFormat format, int sd, int fd, float sa,
+                                                          const uint16_t* a, int lena, int offset_a, int stride_a,
+                                                          uint16_t* result, int len, int offset, int stride) override;
+      uint16_t* hge_bbB(FunctionID id, HalfFormat format, int sd, int fd,
+                                                          const uint16_t* a, int lena, int offset_a, int stride_a,
+                                                          const uint16_t* b, int lenb, int offset_b, int stride_b,
+                                                          uint16_t* result, int len, int offset, int stride) override;
+      uint16_t* hge_bBB(FunctionID id, HalfFormat format, int sd, int fd,
+                                                          const uint16_t* a, int lena, int offset_a, int stride_a,
+                                                          uint16_t* b, int lenb, int offset_b, int stride_b,
+                                                          uint16_t* result, int len, int offset, int stride) override;
+      uint16_t* hge_bffffB(FunctionID id, HalfFormat format, int sd, int fd,
+                                                             const uint16_t* a, int lena, int offset_a, int stride_a,
+                                                             float sa, float sha,
+                                                             float sb, float shb,
+                                                             uint16_t* result, int len, int offset, int stride) override;
+      uint16_t* hge_bbffffB(FunctionID id, HalfFormat format, int sd, int fd,
+                                                              const uint16_t* a, int lena, int offset_a, int stride_a,
+                                                              const uint16_t* b, int lenb, int offset_b, int stride_b,
+                                                              float sa, float sha,
+                                                              float sb, float shb,
+                                                              uint16_t* result, int len, int offset, int stride) override;
+
+    private:
+      ThreadPool* pool;
+      SerialQueue* submissions;
+      int fnCount;
+      // the vectorized kernels are for isa, so calls do not check the processor again
+      CpuIsa isa;
+      // indexed by FunctionID, in the same way as the pipeline states of MetalEngine
+      const CpuKernel** kernels;
+      const CpuDoubleKernel** doubleKernels;
+      // the conversions of each HalfFormat for isa
+      const CpuHalfKernel* halfKernels[2];
+      // the register tile of matrix products for isa
+      const CpuGemmKernel* gemmKernel;
+      const CpuLevel2Kernel* level2Kernel;
+      // the work queued in a thread's open batch
+      struct CpuBatch {
+        std::vector<CpuStep> steps;
+        // the data of tensors released while the batch was open, which is freed once the batch has run
+        std::vector<float*> released;
+      };
+      // the open batches, by thread. The lock is only held to begin or commit a batch, and by threads
+      // with batches open on more than one engine.
+      std::unordered_map<std::thread::id, CpuBatch> batches;
+      mutable std::mutex batchLock;
+      // The batch that the calling thread began most recently, so calls find it without a lock
+      struct ThreadBatch {
+        const CpuEngine* engine;
+        CpuBatch* batch;
+        // the batches open on this thread, on any engine
+        int open;
+      };
+      static thread_local ThreadBatch current;
+      // the steps of this thread's last batch, cleared, so that the next one reuses their memory
+      static thread_local std::vector<CpuStep> spareSteps;
+      std::atomic<bool> reproducibleSums;
+
+      // the open batch of the calling thread, or nullptr when its calls run immediately
+      CpuBatch* threadBatch();
+
+      // T is float or double
+      template <typename T>
+      const CpuKernelOf<T>* kernel(FunctionID id, Signature signature);
+
+      // The step for a call, which is added to the end of this thread's batch if one is open, or is local.
+      // This is only called once the arguments have been checked.
+      CpuStep& stepFor(CpuStep::Shape shape, CpuStep& local);
+      // Runs a step from stepFor now, unless it is in a batch
+      float* schedule(const CpuStep& step, const CpuStep& local, float* result);
+      // Schedules a kernel run of the given shape. Double precision runs are rejected in a batch.
+      template <typename T>
+      T* schedule(CpuStep::Shape shape, const CpuKernelOf<T>* k, const CpuReducerOf<T>* reduction,
+                  const CpuRunOf<T>& run, int sd, int fd, int bottom, int diagonal, T* result);
+      void runStep(const CpuStep& step);
+
+      // The strides of the run are the vector strides, and count is the length of the result vector
+      template <typename T>
+      T* call_vect(FunctionID id, Signature signature, const CpuRunOf<T>& run, ptrdiff_t count, T* result);
+      // The strides of the run are the leading dimensions of each matrix
+      template <typename T>
+      T* call_ge(FunctionID id, Signature signature, int sd, int fd, const CpuRunOf<T>& run, T* result);
+      template <typename T>
+      T* call_uplo(FunctionID id, Signature signature, int sd, int unit, int bottom,
+                   const CpuRunOf<T>& run, T* result);
+      // Runs a float kernel over the elements of a half precision run, which are converted as they are
+      // read and written. count is the length of the result vector, for vect functions.
+      uint16_t* call_half(FunctionID id, HalfFormat format, Signature signature, CpuStep::Shape shape,
+                          int sd, int fd, const CpuRunOf<uint16_t>& run, ptrdiff_t count,
+                          std::initializer_list<float> scalars, uint16_t* result);
+      // Checks and runs a triangular function. For b on the right, the problem is transposed
+      // so that the triangle is on the left.
+      float* call_triangular(const char* name, bool solve, int left, int trans, int unit, int bottom,
+                             int m, int n, float alpha,
+                             const float* a, int lena, int offset_a, int ld_a,
+                             float* b, int lenb, int offset_b, int ld_b);
+  };
+
+} // namespace Ferrum
+
+#endif // FERRUM_CPU_ENGINE_HPP
@@ -0,0 +1,78 @@
+#pragma once
+
+#ifndef FERRUM_CPU_FEATURES_HPP
+#define FERRUM_CPU_FEATURES_HPP
+
+#include <string>
+
+// Selection of the vectorized CPU kernels for the processor that the library is running on.
+// cpu_simd.cpp is compiled once for each instruction set (see the Makefile), and the CPU
+// engine picks one of them when it is constructed.
+
+namespace Ferrum {
+
+  template <typename T> struct CpuKernelOf;
+  using CpuKernel = CpuKernelOf<float>;
+  struct CpuGemmKernel;
+  struct CpuLevel2Kernel;
+  struct CpuHalfKernel;
+  enum class HalfFormat;
+
+  // The instruction sets that the kernels are compiled for, from lowest to highest.
+  // baseline is SSE2 on x86-64, and NEON on ARM64. The others are only built for x86.
+  enum class CpuIsa { baseline, sse42, avx2, avx512 };
+
+  // The highest instruction set that the processor and this build both support.
+  // The FERRUM_CPU_ISA environment variable can choose a lower one, such as "avx2".
+  CpuIsa detectIsa();
+
+  const char* isaName(CpuIsa isa);
+
+  // Returns false if the name is not an instruction set
+  bool parseIsa(const std::string& name, CpuIsa& isa);
+
+  // The vectorized kernel for an instruction set, by its name without the vector_, ge_ or uplo_
+  // prefix, or nullptr if it only has a scalar version
+  const CpuKernel* simdKernel(CpuIsa isa, const std::string& name);
+
+  // The kernel tables of each build of cpu_simd.cpp
+  const CpuKernel* simdKernel_baseline(const char* name);
+#if defined(__x86_64__)
+  const CpuKernel* simdKernel_sse42(const char* name);
+  const CpuKernel* simdKernel_avx2(const char* name);
+  const CpuKernel* simdKernel_avx512(const char* name);
+#endif
+
+  // The register tile for matrix products of an instruction set
+  const CpuGemmKernel* simdGemm(CpuIsa isa);
+
+  const CpuGemmKernel* simdGemm_baseline();
+#if defined(__x86_64__)
+  const CpuGemmKernel* simdGemm_sse42();
+  const CpuGemmKernel* simdGemm_avx2();
+  const CpuGemmKernel* simdGemm_avx512();
+#endif
+
+  // The loops of matrix-vector functions for an instruction set
+  const CpuLevel2Kernel* simdLevel2(CpuIsa isa);
+
+  const CpuLevel2Kernel* simdLevel2_baseline();
+#if defined(__x86_64__)
+  const CpuLevel2Kernel* simdLevel2_sse42();
+  const CpuLevel2Kernel* simdLevel2_avx2();
+  const CpuLevel2Kernel* simdLevel2_avx512();
+#endif
+
+  // The conversions of a half precision storage format for an instruction set
+  const CpuHalfKernel* simdHalf(CpuIsa isa, HalfFormat format);
+
+  const CpuHalfKernel* simdHalf_baseline(HalfFormat format);
+#if defined(__x86_64__)
+  const CpuHalfKernel* simdHalf_sse42(HalfFormat format);
+  const CpuHalfKernel* simdHalf_avx2(HalfFormat format);
+  const CpuHalfKernel* simdHalf_avx512(HalfFormat format);
+#endif
+
+} // namespace Ferrum
+
+#endif // FERRUM_CPU_FEATURES_HPP
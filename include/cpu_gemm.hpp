@@ -0,0 +1,48 @@
+#pragma once
+
+#ifndef FERRUM_CPU_GEMM_HPP
+#define FERRUM_CPU_GEMM_HPP
+
+#include <cstddef>
+
+// Matrix products on the CPU. The product is blocked for the caches, with both matrices packed
+// into panels that the register tiles of cpu_simd.cpp read in order.
+
+namespace Ferrum {
+
+  class ThreadPool;
+
+  // The arguments of c = alpha * op(a) * op(b) + beta * c (see Engine::ge_gemm).
+  // Each buffer points at the first element of its matrix, and matrices are column major.
+  struct CpuGemm {
+    ptrdiff_t m;
+    ptrdiff_t n;
+    ptrdiff_t k;
+    bool transA;
+    bool transB;
+    float alpha;
+    float beta;
+    const float* a;
+    ptrdiff_t lda;
+    const float* b;
+    ptrdiff_t ldb;
+    float* c;
+    ptrdiff_t ldc;
+  };
+
+  // The register tile of a build of cpu_simd.cpp. run multiplies a packed mr x k panel of op(a)
+  // by a packed k x nr panel of op(b), and writes alpha times the product plus beta * c to the
+  // first rows x cols elements of the tile of c. c is not read when beta is zero.
+  struct CpuGemmKernel {
+    int mr;
+    int nr;
+    void (*run)(ptrdiff_t k, const float* a, const float* b, float alpha, float beta,
+                float* c, ptrdiff_t ldc, ptrdiff_t rows, ptrdiff_t cols);
+  };
+
+  // Runs a product on the pool, with the tiles computed by kernel
+  void runGemm(ThreadPool& pool, const CpuGemmKernel& kernel, const CpuGemm& gemm);
+
+} // namespace Ferrum
+
+#endif // FERRUM_CPU_GEMM_HPP
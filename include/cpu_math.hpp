@@ -0,0 +1,182 @@
+#pragma once
+
+#ifndef FERRUM_CPU_MATH_HPP
+#define FERRUM_CPU_MATH_HPP
+
+#include <cmath>
+
+// Host implementations of the helper functions in Metal/ferrum/vect-math.metal.
+// These use the same approximations as the shaders, so that the CPU engine gives the
+// same answers as the GPU, rather than the (more accurate) results from libm.
+
+namespace Ferrum {
+namespace CpuMath {
+
+  template <typename REAL> constexpr REAL REAL1o3 = (REAL)0.3333333333333333;
+  template <typename REAL> constexpr REAL REAL2o3 = (REAL)0.6666666666666667;
+  template <typename REAL> constexpr REAL REAL3o2 = (REAL)1.5;
+  template <typename REAL> constexpr REAL REAL1o2 = (REAL)0.5;
+  template <typename REAL> constexpr REAL PI = (REAL)3.1415926535897932384626;
+
+  // Approximation of the error function: W. J. Cody, et al.,
+  // Mathematics of Computation, v23, Oct 1969 pp. 631-638
+  // The same coefficients are used for normcdf
+
+  template <typename REAL> constexpr REAL ERF_A1 = (REAL)0.254829592;
+  template <typename REAL> constexpr REAL ERF_A2 = (REAL)-0.284496736;
+  template <typename REAL> constexpr REAL ERF_A3 = (REAL)1.421413741;
+  template <typename REAL> constexpr REAL ERF_A4 = (REAL)-1.453152027;
+  template <typename REAL> constexpr REAL ERF_A5 = (REAL)1.061405429;
+  template <typename REAL> constexpr REAL ERF_P = (REAL)0.3275911;
+
+  template <typename REAL>
+  inline REAL erf(REAL x) {
+    REAL sgn = (x < 0.0) ? (REAL)-1.0 : (REAL)1.0;
+    x = std::fabs(x);
+
+    // A&S formula 7.1.26 approximation
+    REAL t = (REAL)1.0 / ((REAL)1.0 + ERF_P<REAL> * x);
+    REAL y = (((((ERF_A5<REAL> * t + ERF_A4<REAL>) * t) + ERF_A3<REAL>) * t + ERF_A2<REAL>) * t + ERF_A1<REAL>) * t;
+    return sgn * ((REAL)1.0 - std::exp(-x * x - y));
+  }
+
+  template <typename REAL>
+  inline REAL erfc(REAL x) {
+    return (REAL)1.0 - erf(x);
+  }
+
+  // Approximation of the inverse error function: J. M. Blair, et al.,
+  // Mathematics of Computation, v30, Oct 1976 pp. 827-830
+  template <typename REAL>
+  inline REAL erfinv(REAL x) {
+    REAL w = std::log((REAL)1.0 - x * x);
+    REAL p = std::sqrt(w * ((REAL)-0.0705230784 + w * ((REAL)0.0422820123 + w * ((REAL)-0.0092705272 +
+                       w * ((REAL)0.0001520143 + w * ((REAL)-0.0002765672 + w * (REAL)0.0000430638))))));
+    return (x < (REAL)0.0) ? -p : p;
+  }
+
+  template <typename REAL>
+  inline REAL erfcinv(REAL x) {
+    REAL z;
+    if (x <= (REAL)0.0) {
+      return INFINITY;
+    } else if (x >= (REAL)2.0) {
+      return -INFINITY;
+    } else if (x > (REAL)1.0) {
+      z = std::sqrt(-std::log(((REAL)2.0 - x) / (REAL)2.0));
+      return (((((REAL)0.285070173 * z + (REAL)1.050750072) * z + (REAL)1.211056027) * z + (REAL)0.564189583) * z + (REAL)0.0) /
+             (((((REAL)0.081188386 * z + (REAL)0.753168411) * z + (REAL)1.732339080) * z + (REAL)1.011728051) * z + (REAL)1.0);
+    } else {
+      z = std::sqrt(-std::log(x / (REAL)2.0));
+      return -(((((REAL)0.886226899 * z + (REAL)-1.645349621) * z + (REAL)0.914624893) * z + (REAL)-0.140543331) * z + (REAL)0.0) /
+              (((((REAL)0.892459516 * z + (REAL)0.325598322) * z + (REAL)-0.174030709) * z + (REAL)-0.012200287) * z + (REAL)1.0);
+    }
+  }
+
+  template <typename REAL>
+  inline REAL normcdf(REAL x) {
+    REAL sgn = (x < 0.0) ? (REAL)-1.0 : (REAL)1.0;
+    x = std::fabs(x) / std::sqrt((REAL)2.0);
+
+    // A&S formula 7.1.26 approximation
+    REAL t = (REAL)1.0 / ((REAL)1.0 + ERF_P<REAL> * x);
+    REAL y = (((((ERF_A5<REAL> * t + ERF_A4<REAL>) * t) + ERF_A3<REAL>) * t + ERF_A2<REAL>) * t + ERF_A1<REAL>) * t;
+    return REAL1o2<REAL> * ((REAL)1.0 + sgn * ((REAL)1.0 - std::exp(-x * x - y)));
+  }
+
+  // Approximation of the inverse normal CDF: Peter John Acklam, 2002
+  template <typename REAL>
+  inline REAL normcdfinv(REAL x) {
+    constexpr REAL A1 = -3.969683028665376e+01, A2 = 2.209460984245205e+02, A3 = -2.759285104469687e+02;
+    constexpr REAL A4 = 1.383577518672690e+02, A5 = -3.066479806614716e+01, A6 = 2.506628277459239e+00;
+    constexpr REAL B1 = -5.447609879822406e+01, B2 = 1.615858368580409e+02, B3 = -1.556989798598866e+02;
+    constexpr REAL B4 = 6.680131188771972e+01, B5 = -1.328068155288572e+01;
+    constexpr REAL C1 = -7.784894002430293e-03, C2 = -3.223964580411365e-01, C3 = -2.400758277161838e+00;
+    constexpr REAL C4 = -2.549732539343734e+00, C5 = 4.374664141464968e+00, C6 = 2.938163982698783e+00;
+    constexpr REAL D1 = 7.784695709041462e-03, D2 = 3.224671290700398e-01;
+    constexpr REAL D3 = 2.445134137142996e+00, D4 = 3.754408661907416e+00;
+    constexpr REAL X_LOW = 0.02425;
+    constexpr REAL X_HIGH = (REAL)1.0 - X_LOW;
+
+    REAL q, r;
+    if (x < X_LOW) {
+      q = std::sqrt((REAL)-2.0 * std::log(x));
+      return (((((C1 * q + C2) * q + C3) * q + C4) * q + C5) * q + C6) /
+             ((((D1 * q + D2) * q + D3) * q + D4) * q + (REAL)1.0);
+    } else if (x <= X_HIGH) {
+      q = x - (REAL)0.5;
+      r = q * q;
+      return (((((A1 * r + A2) * r + A3) * r + A4) * r + A5) * r + A6) * q /
+             (((((B1 * r + B2) * r + B3) * r + B4) * r + B5) * r + (REAL)1.0);
+    } else {
+      q = std::sqrt((REAL)-2.0 * std::log((REAL)1.0 - x));
+      return -(((((C1 * q + C2) * q + C3) * q + C4) * q + C5) * q + C6) /
+             ((((D1 * q + D2) * q + D3) * q + D4) * q + (REAL)1.0);
+    }
+  }
+
+  // Lanczos approximation, with the same coefficients as the shader
+  template <typename REAL>
+  inline REAL tgamma(REAL x) {
+    constexpr REAL g = 7.0;
+    constexpr REAL coefficients[] = {
+      (REAL)0.99999999999980993,  (REAL)676.5203681218851,     (REAL)-1259.1392167224028,
+      (REAL)771.32342877765313,   (REAL)-176.61502916214059,   (REAL)12.507343278686905,
+      (REAL)-0.13857109526572012, (REAL)9.9843695780195716e-6, (REAL)1.5056327351493116e-7
+    };
+    if (x < (REAL)0.5) {
+      return PI<REAL> / (std::sin(PI<REAL> * x) * tgamma((REAL)1.0 - x));
+    } else {
+      x -= (REAL)1.0;
+      REAL y = coefficients[0];
+      for (int i = 1; i < 9; i++) {
+        y += coefficients[i] / (x + i);
+      }
+      REAL t = x + g + (REAL)0.5;
+      return std::sqrt((REAL)2.0 * PI<REAL>) * std::pow(t, x + REAL1o2<REAL>) * std::exp(-t) * y;
+    }
+  }
+
+  template <typename REAL>
+  inline REAL lgamma(REAL x) {
+    return std::log(std::fabs(tgamma(x)));
+  }
+
+  template <typename REAL>
+  inline REAL remainder(REAL x, REAL y) {
+    return x - y * std::round(x / y);
+  }
+
+  template <typename REAL>
+  inline REAL hypot(REAL x, REAL y) {
+    return std::sqrt(x * x + y * y);
+  }
+
+  template <typename REAL>
+  inline REAL expm1(REAL x) {
+    if (std::fabs(x) < (REAL)1e-5) {
+      REAL x2 = x * x;
+      REAL x3 = x2 * x;
+      REAL x4 = x2 * x2;
+      return x + x2 / (REAL)2.0 + x3 / (REAL)6.0 + x4 / (REAL)24.0;
+    } else {
+      return std::exp(x) - (REAL)1.0;
+    }
+  }
+
+  template <typename REAL>
+  inline REAL log1p(REAL x) {
+    if (std::fabs(x) < (REAL)1e-5) {
+      REAL x2 = x * x;
+      REAL x3 = x2 * x;
+      REAL x4 = x3 * x;
+      return x - x2 / (REAL)2.0 + x3 / (REAL)3.0 - x4 / (REAL)4.0;
+    } else {
+      return std::log((REAL)1.0 + x);
+    }
+  }
+
+} // namespace CpuMath
+} // namespace Ferrum
+
+#endif // FERRUM_CPU_MATH_HPP
@@ -0,0 +1,565 @@
+#pragma once
+
+#ifndef FERRUM_CPU_SIMD_HPP
+#define FERRUM_CPU_SIMD_HPP
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+// Vectorized versions of the element functions used by the CPU kernels.
+// A vector holds as many floats as the widest registers that the file is compiled for:
+// 16 for AVX-512, 8 for AVX/AVX2 and 4 for SSE and NEON. The arithmetic uses the compiler's
+// vector extensions, so the same code is generated for each instruction set.
+// The transcendental functions are the Cephes single precision approximations, evaluated
+// on every lane at once, with branches replaced by selects. They are accurate to a few
+// units in the last place, which is the same as the fast math functions used by Metal.
+
+// The instruction set that this is being compiled for. Each build of the kernels puts these
+// functions in its own namespace, so that the linker cannot mix the builds for different
+// instruction sets.
+#ifndef FERRUM_SIMD_ISA
+#define FERRUM_SIMD_ISA baseline
+#endif
+
+#if defined(__AVX512F__)
+#define FERRUM_SIMD_BYTES 64
+#elif defined(__AVX__)
+#define FERRUM_SIMD_BYTES 32
+#else
+#define FERRUM_SIMD_BYTES 16
+#endif
+
+namespace Ferrum {
+namespace Simd {
+inline namespace FERRUM_SIMD_ISA {
+
+  typedef float VecF __attribute__((vector_size(FERRUM_SIMD_BYTES)));
+  // Comparisons of VecF give a VecI of all ones (true) or zero in each lane
+  typedef int32_t VecI __attribute__((vector_size(FERRUM_SIMD_BYTES)));
+
+  constexpr int WIDTH = FERRUM_SIMD_BYTES / sizeof(float);
+
+  inline VecF splat(float x) {
+    return VecF{} + x;
+  }
+
+  inline VecF load(const float* p) {
+    VecF v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+  }
+
+  inline void store(float* p, VecF v) {
+    std::memcpy(p, &v, sizeof(v));
+  }
+
+  // Loads n <= WIDTH elements that are stride apart. Unused lanes are zero.
+  inline VecF gather(const float* p, ptrdiff_t stride, ptrdiff_t n) {
+    VecF v = {};
+    for (ptrdiff_t i = 0; i < n; i++) {
+      v[i] = p[i * stride];
+    }
+    return v;
+  }
+
+  inline void scatter(float* p, ptrdiff_t stride, ptrdiff_t n, VecF v) {
+    for (ptrdiff_t i = 0; i < n; i++) {
+      p[i * stride] = v[i];
+    }
+  }
+
+  inline VecF select(VecI mask, VecF a, VecF b) {
+    return (VecF)((mask & (VecI)a) | (~mask & (VecI)b));
+  }
+
+  inline VecF abs(VecF x) {
+    return (VecF)((VecI)x & 0x7fffffff);
+  }
+
+  inline VecF copysign(VecF x, VecF y) {
+    return (VecF)(((VecI)x & 0x7fffffff) | ((VecI)y & (int32_t)0x80000000));
+  }
+
+  // Unlike a comparison, the result is the other argument when one of them is NaN
+  inline VecF fmax(VecF x, VecF y) {
+    return select(y != y, x, select(x >= y, x, y));
+  }
+
+  inline VecF fmin(VecF x, VecF y) {
+    return select(y != y, x, select(x <= y, x, y));
+  }
+
+  inline VecF sqrt(VecF x) {
+#if defined(__AVX512F__)
+    return (VecF)_mm512_sqrt_ps((__m512)x);
+#elif defined(__AVX__)
+    return (VecF)_mm256_sqrt_ps((__m256)x);
+#elif defined(__SSE2__)
+    return (VecF)_mm_sqrt_ps((__m128)x);
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    return (VecF)vsqrtq_f32((float32x4_t)x);
+#else
+    VecF r;
+    for (int i = 0; i < WIDTH; i++) {
+      r[i] = std::sqrt(x[i]);
+    }
+    return r;
+#endif
+  }
+
+  // a * b + c, as a single instruction where there is one
+  inline VecF fma(VecF a, VecF b, VecF c) {
+#if defined(__AVX512F__)
+    return (VecF)_mm512_fmadd_ps((__m512)a, (__m512)b, (__m512)c);
+#elif defined(__FMA__)
+    return (VecF)_mm256_fmadd_ps((__m256)a, (__m256)b, (__m256)c);
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    return (VecF)vfmaq_f32((float32x4_t)c, (float32x4_t)a, (float32x4_t)b);
+#else
+    return a * b + c;
+#endif
+  }
+
+  // Rounding. Floats of 2^23 and above are already integers, and are returned unchanged.
+
+  inline VecF trunc(VecF x) {
+    VecF t = __builtin_convertvector(__builtin_convertvector(x, VecI), VecF);
+    return select(abs(x) < 8388608.0f, copysign(t, x), x);
+  }
+
+  inline VecF floor(VecF x) {
+    VecF t = trunc(x);
+    return t - (VecF)((VecI)splat(1.0f) & (t > x));
+  }
+
+  inline VecF ceil(VecF x) {
+    VecF t = trunc(x);
+    return t + (VecF)((VecI)splat(1.0f) & (t < x));
+  }
+
+  // Halfway cases round away from zero
+  inline VecF round(VecF x) {
+    VecF t = trunc(x);
+    return t + (VecF)((VecI)copysign(splat(1.0f), x) & (abs(x - t) >= 0.5f));
+  }
+
+  // Multiplies by 2^n, for integral n in [-252, 254]
+  inline VecF ldexp(VecF x, VecF n) {
+    VecI i = __builtin_convertvector(n, VecI);
+    VecI half = i >> 1;
+    VecF a = (VecF)((half + 127) << 23);
+    VecF b = (VecF)((i - half + 127) << 23);
+    return x * a * b;
+  }
+
+  // e^r for |r| <= ln(2) / 2
+  inline VecF expReduced(VecF r) {
+    VecF z = r * r;
+    VecF y = ((((1.9875691500e-4f * r + 1.3981999507e-3f) * r + 8.3334519073e-3f) * r + 4.1665795894e-2f) * r +
+              1.6666665459e-1f) * r + 5.0000001201e-1f;
+    return y * z + r + 1.0f;
+  }
+
+  // Scales e^r by 2^n, with overflow to infinity and underflow to zero at the limits of x
+  inline VecF expScale(VecF x, VecF r, VecF n, float high, float low) {
+    VecF y = ldexp(expReduced(r), n);
+    y = select(x > high, splat(INFINITY), y);
+    y = select(x < low, splat(0.0f), y);
+    return select(x != x, x, y);
+  }
+
+  inline VecF exp(VecF x) {
+    VecF c = fmin(fmax(x, splat(-104.0f)), splat(89.0f));
+    VecF n = floor(c * 1.44269504088896341f + 0.5f);
+    VecF r = c - n * 0.693359375f + n * 2.12194440e-4f;
+    return expScale(x, r, n, 88.7228391f, -103.972084f);
+  }
+
+  inline VecF exp2(VecF x) {
+    VecF c = fmin(fmax(x, splat(-150.0f)), splat(128.5f));
+    VecF n = floor(c + 0.5f);
+    VecF r = (c - n) * 0.693147180559945309f;
+    return expScale(x, r, n, 128.0f, -150.0f);
+  }
+
+  inline VecF exp10(VecF x) {
+    VecF c = fmin(fmax(x, splat(-45.2f)), splat(38.6f));
+    VecF n = floor(c * 3.32192809488736235f + 0.5f);
+    VecF r = c * 2.30258509299404568f - n * 0.693359375f + n * 2.12194440e-4f;
+    return expScale(x, r, n, 38.5318394f, -45.1544993f);
+  }
+
+  inline VecF log(VecF x) {
+    // denormals are scaled up first
+    VecI tiny = x < 1.17549435e-38f;
+    VecF s = select(tiny, x * 8388608.0f, x);
+    VecI bits = (VecI)s;
+    VecF e = __builtin_convertvector(((bits >> 23) & 0xff) - 126, VecF) - (VecF)((VecI)splat(23.0f) & tiny);
+    // the mantissa, in [0.5, 1)
+    VecF m = (VecF)((bits & 0x007fffff) | 0x3f000000);
+    VecI low = m < 0.707106781186547524f;
+    e = e - (VecF)((VecI)splat(1.0f) & low);
+    m = select(low, m + m, m) - 1.0f;
+
+    VecF z = m * m;
+    VecF y = ((((((((7.0376836292e-2f * m - 1.1514610310e-1f) * m + 1.1676998740e-1f) * m - 1.2420140846e-1f) * m +
+                  1.4249322787e-1f) * m - 1.6668057665e-1f) * m + 2.0000714765e-1f) * m - 2.4999993993e-1f) * m +
+              3.3333331174e-1f) * m * z;
+    y = y - e * 2.12194440e-4f - 0.5f * z;
+    VecF r = m + y + e * 0.693359375f;
+
+    r = select(x == 0.0f, splat(-INFINITY), r);
+    r = select(x < 0.0f, splat(NAN), r);
+    r = select(x == INFINITY, x, r);
+    return select(x != x, x, r);
+  }
+
+  inline VecF log2(VecF x) {
+    return log(x) * 1.44269504088896341f;
+  }
+
+  inline VecF log10(VecF x) {
+    return log(x) * 0.434294481903251828f;
+  }
+
+  // The same as the helpers in vect-math.h
+  inline VecF expm1(VecF x) {
+    VecF x2 = x * x;
+    VecF series = x + x2 / 2.0f + x2 * x / 6.0f + x2 * x2 / 24.0f;
+    return select(abs(x) < 1e-5f, series, exp(x) - 1.0f);
+  }
+
+  inline VecF log1p(VecF x) {
+    VecF x2 = x * x;
+    VecF x3 = x2 * x;
+    VecF series = x - x2 / 2.0f + x3 / 3.0f - x3 * x / 4.0f;
+    return select(abs(x) < 1e-5f, series, log(x + 1.0f));
+  }
+
+  // log(1 + x) without the loss of precision from rounding 1 + x, for the inverse hyperbolic functions
+  inline VecF log1pExact(VecF x) {
+    VecF u = x + 1.0f;
+    VecF d = u - 1.0f;
+    return select(d == 0.0f, x, select(u == INFINITY, u, log(u) * (x / d)));
+  }
+
+  // sin and cos together, for the range reduction to be shared
+  inline void sincos(VecF x, VecF& s, VecF& c) {
+    VecF a = abs(x);
+    VecI j = __builtin_convertvector(a * 1.27323954473516f, VecI);
+    j = (j + 1) & ~1;
+    VecF y = __builtin_convertvector(j, VecF);
+    VecF r = ((a - y * 0.78515625f) - y * 2.4187564849853515625e-4f) - y * 3.77489497744594108e-8f;
+
+    VecF z = r * r;
+    VecF cosPoly = ((2.443315711809948e-5f * z - 1.388731625493765e-3f) * z + 4.166664568298827e-2f) * z * z -
+                   0.5f * z + 1.0f;
+    VecF sinPoly = ((-1.9515295891e-4f * z + 8.3321608736e-3f) * z - 1.6666654611e-1f) * z * r + r;
+
+    VecI swap = (j & 2) != 0;
+    VecI sinSign = ((j & 4) << 29) ^ ((VecI)x & (int32_t)0x80000000);
+    VecI cosSign = ((j + 2) & 4) << 29;
+    s = (VecF)((VecI)select(swap, cosPoly, sinPoly) ^ sinSign);
+    c = (VecF)((VecI)select(swap, sinPoly, cosPoly) ^ cosSign);
+    VecI bad = (a == INFINITY) | (x != x);
+    s = select(bad, splat(NAN), s);
+    c = select(bad, splat(NAN), c);
+  }
+
+  inline VecF sin(VecF x) {
+    VecF s, c;
+    sincos(x, s, c);
+    return s;
+  }
+
+  inline VecF cos(VecF x) {
+    VecF s, c;
+    sincos(x, s, c);
+    return c;
+  }
+
+  inline VecF tan(VecF x) {
+    VecF s, c;
+    sincos(x, s, c);
+    return s / c;
+  }
+
+  inline VecF atan(VecF x) {
+    VecF a = abs(x);
+    VecI big = a > 2.414213562373095f;
+    VecI mid = ~big & (a > 0.4142135623730950f);
+    VecF y0 = select(big, splat(1.57079632679489661923f), select(mid, splat(0.78539816339744830962f), splat(0.0f)));
+    VecF t = select(big, -1.0f / a, select(mid, (a - 1.0f) / (a + 1.0f), a));
+    VecF z = t * t;
+    VecF y = (((8.05374449538e-2f * z - 1.38776856032e-1f) * z + 1.99777106478e-1f) * z - 3.33329491539e-1f) * z * t + t;
+    return copysign(y0 + y, x);
+  }
+
+  // The angle of the point (x, y), as std::atan2(y, x)
+  inline VecF atan2(VecF y, VecF x) {
+    const VecF pi = splat(3.14159265358979323846f);
+    VecF r = atan(y / x);
+    r = select(x < 0.0f, r + copysign(pi, y), r);
+    VecF onAxis = select(y == 0.0f, select((VecI)x < 0, copysign(pi, y), copysign(splat(0.0f), y)), copysign(pi * 0.5f, y));
+    return select(x == 0.0f, onAxis, r);
+  }
+
+  // asin(x) for 0 <= x <= 0.5
+  inline VecF asinReduced(VecF x) {
+    VecF z = x * x;
+    return ((((4.2163199048e-2f * z + 2.4181311049e-2f) * z + 4.5470025998e-2f) * z + 7.4953002686e-2f) * z +
+            1.6666752422e-1f) * z * x + x;
+  }
+
+  inline VecF asin(VecF x) {
+    VecF a = abs(x);
+    VecI high = a > 0.5f;
+    VecF t = select(high, sqrt(0.5f * (1.0f - a)), a);
+    VecF y = asinReduced(t);
+    y = select(high, 1.57079632679489661923f - (y + y), y);
+    return select(a > 1.0f, splat(NAN), copysign(y, x));
+  }
+
+  inline VecF acos(VecF x) {
+    VecF a = abs(x);
+    VecF y = 2.0f * asinReduced(sqrt(0.5f * (1.0f - a)));
+    y = select(x < 0.0f, 3.14159265358979323846f - y, y);
+    VecF middle = 1.57079632679489661923f - asinReduced(x);
+    return select(a > 1.0f, splat(NAN), select(a <= 0.5f, middle, y));
+  }
+
+  inline VecF sinh(VecF x) {
+    VecF u = expm1(abs(x));
+    VecF y = select(u == INFINITY, u, 0.5f * (u + u / (u + 1.0f)));
+    return copysign(y, x);
+  }
+
+  inline VecF cosh(VecF x) {
+    VecF e = exp(abs(x));
+    return 0.5f * (e + 1.0f / e);
+  }
+
+  inline VecF tanh(VecF x) {
+    VecF a = abs(x);
+    VecF z = x * x;
+    VecF small = ((((-5.70498872745e-3f * z + 2.06390887954e-2f) * z - 5.37397155531e-2f) * z + 1.33314422036e-1f) * z -
+                  3.33332819422e-1f) * z * x + x;
+    VecF large = copysign(1.0f - 2.0f / (exp(a + a) + 1.0f), x);
+    return select(a < 0.625f, small, large);
+  }
+
+  inline VecF asinh(VecF x) {
+    VecF a = abs(x);
+    VecF a2 = a * a;
+    VecF y = log1pExact(a + a2 / (1.0f + sqrt(a2 + 1.0f)));
+    y = select(a > 1e18f, log(a) + 0.693147180559945309f, y);
+    return copysign(y, x);
+  }
+
+  inline VecF acosh(VecF x) {
+    VecF y = log(x + sqrt(x * x - 1.0f));
+    return select(x > 1e18f, log(x) + 0.693147180559945309f, y);
+  }
+
+  inline VecF atanh(VecF x) {
+    VecF a = abs(x);
+    return copysign(0.5f * log1pExact((a + a) / (1.0f - a)), x);
+  }
+
+  // Raises x to any power. Negative x needs an integral y, as for std::pow.
+  inline VecF pow(VecF x, VecF y) {
+    VecF a = abs(x);
+    VecF r = exp(y * log(a));
+    VecI integral = floor(y) == y;
+    VecI odd = integral & (abs(y) < 16777216.0f) & ((__builtin_convertvector(y, VecI) & 1) != 0);
+    VecF negative = select(integral, select(odd, -r, r), splat(NAN));
+    r = select(x < 0.0f, negative, r);
+    // a zero base keeps its sign for odd powers
+    r = select((x == 0.0f) & odd, copysign(r, x), r);
+    return select((y == 0.0f) | (x == 1.0f), splat(1.0f), r);
+  }
+
+  inline VecF hypot(VecF x, VecF y) {
+    return sqrt(x * x + y * y);
+  }
+
+  inline VecF remainder(VecF x, VecF y) {
+    return x - y * round(x / y);
+  }
+
+  // The approximations below match the helpers in vect-math.h and cpu_math.hpp
+
+  inline VecF erf(VecF x) {
+    VecF a = abs(x);
+    VecF t = 1.0f / (1.0f + 0.3275911f * a);
+    VecF y = (((((1.061405429f * t - 1.453152027f) * t) + 1.421413741f) * t - 0.284496736f) * t + 0.254829592f) * t;
+    return copysign(1.0f - exp(-a * a - y), x);
+  }
+
+  inline VecF erfc(VecF x) {
+    return 1.0f - erf(x);
+  }
+
+  inline VecF normcdf(VecF x) {
+    return 0.5f * (1.0f + erf(x * 0.707106781186547524f));
+  }
+
+  inline VecF erfinv(VecF x) {
+    VecF w = log(1.0f - x * x);
+    VecF p = sqrt(w * (-0.0705230784f + w * (0.0422820123f + w * (-0.0092705272f +
+                  w * (0.0001520143f + w * (-0.0002765672f + w * 0.0000430638f))))));
+    return copysign(p, x);
+  }
+
+  inline VecF erfcinv(VecF x) {
+    VecI upper = x > 1.0f;
+    VecF z = sqrt(-log(select(upper, 2.0f - x, x) / 2.0f));
+    VecF high = ((((0.285070173f * z + 1.050750072f) * z + 1.211056027f) * z + 0.564189583f) * z) /
+                ((((0.081188386f * z + 0.753168411f) * z + 1.732339080f) * z + 1.011728051f) * z + 1.0f);
+    VecF low = -((((0.886226899f * z - 1.645349621f) * z + 0.914624893f) * z - 0.140543331f) * z) /
+               ((((0.892459516f * z + 0.325598322f) * z - 0.174030709f) * z - 0.012200287f) * z + 1.0f);
+    VecF r = select(upper, high, low);
+    r = select(x <= 0.0f, splat(INFINITY), r);
+    return select(x >= 2.0f, splat(-INFINITY), r);
+  }
+
+  inline VecF normcdfinv(VecF x) {
+    const float A1 = -3.969683028665376e+01f, A2 = 2.209460984245205e+02f, A3 = -2.759285104469687e+02f;
+    const float A4 = 1.383577518672690e+02f, A5 = -3.066479806614716e+01f, A6 = 2.506628277459239e+00f;
+    const float B1 = -5.447609879822406e+01f, B2 = 1.615858368580409e+02f, B3 = -1.556989798598866e+02f;
+    const float B4 = 6.680131188771972e+01f, B5 = -1.328068155288572e+01f;
+    const float C1 = -7.784894002430293e-03f, C2 = -3.223964580411365e-01f, C3 = -2.400758277161838e+00f;
+    const float C4 = -2.549732539343734e+00f, C5 = 4.374664141464968e+00f, C6 = 2.938163982698783e+00f;
+    const float D1 = 7.784695709041462e-03f, D2 = 3.224671290700398e-01f;
+    const float D3 = 2.445134137142996e+00f, D4 = 3.754408661907416e+00f;
+
+    // the tails share a formula, with the sign changed for the upper one
+    VecI upper = x > 0.5f;
+    VecF q = sqrt(-2.0f * log(select(upper, 1.0f - x, x)));
+    VecF tail = (((((C1 * q + C2) * q + C3) * q + C4) * q + C5) * q + C6) /
+                ((((D1 * q + D2) * q + D3) * q + D4) * q + 1.0f);
+    tail = select(upper, -tail, tail);
+    VecF c = x - 0.5f;
+    VecF r = c * c;
+    VecF central = (((((A1 * r + A2) * r + A3) * r + A4) * r + A5) * r + A6) * c /
+                   (((((B1 * r + B2) * r + B3) * r + B4) * r + B5) * r + 1.0f);
+    return select((x >= 0.02425f) & (x <= 0.97575f), central, tail);
+  }
+
+  // Lanczos approximation, with the reflection formula below 0.5
+  inline VecF tgamma(VecF x) {
+    const float coefficients[] = {
+      676.5203681218851f, -1259.1392167224028f, 771.32342877765313f, -176.61502916214059f,
+      12.507343278686905f, -0.13857109526572012f, 9.9843695780195716e-6f, 1.5056327351493116e-7f
+    };
+    VecI reflect = x < 0.5f;
+    VecF z = select(reflect, 1.0f - x, x) - 1.0f;
+    VecF y = splat(0.99999999999980993f);
+    for (int i = 0; i < 8; i++) {
+      y += coefficients[i] / (z + (float)(i + 1));
+    }
+    VecF t = z + 7.5f;
+    // t^(z + 0.5) * e^-t, as one exponential so that it does not overflow early
+    VecF g = 2.50662827463100050f * exp((z + 0.5f) * log(t) - t) * y;
+    return select(reflect, 3.14159265358979323846f / (sin(3.14159265358979323846f * x) * g), g);
+  }
+
+  inline VecF lgamma(VecF x) {
+    return log(abs(tgamma(x)));
+  }
+
+  // Half precision storage. A VecH holds the 16 bit elements for a VecF, which are converted
+  // as they are loaded and stored, rounding to nearest even. NaNs stay NaNs, and are made quiet.
+  typedef uint16_t VecH __attribute__((vector_size(FERRUM_SIMD_BYTES / 2)));
+  typedef uint32_t VecU __attribute__((vector_size(FERRUM_SIMD_BYTES)));
+
+  inline VecH loadH(const uint16_t* p) {
+    VecH v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+  }
+
+  inline void storeH(uint16_t* p, VecH v) {
+    std::memcpy(p, &v, sizeof(v));
+  }
+
+  inline VecH gatherH(const uint16_t* p, ptrdiff_t stride, ptrdiff_t n) {
+    VecH v = {};
+    for (ptrdiff_t i = 0; i < n; i++) {
+      v[i] = p[i * stride];
+    }
+    return v;
+  }
+
+  inline void scatterH(uint16_t* p, ptrdiff_t stride, ptrdiff_t n, VecH v) {
+    for (ptrdiff_t i = 0; i < n; i++) {
+      p[i * stride] = v[i];
+    }
+  }
+
+  inline VecU selectU(VecI mask, VecU a, VecU b) {
+    return ((VecU)mask & a) | (~(VecU)mask & b);
+  }
+
+  // bf16 is the upper half of a float
+  inline VecF fromBf16(VecH h) {
+    return (VecF)(__builtin_convertvector(h, VecU) << 16);
+  }
+
+  inline VecH toBf16(VecF x) {
+    VecU bits = (VecU)x;
+    VecU rounded = (bits + 0x7fff + ((bits >> 16) & 1)) >> 16;
+    return __builtin_convertvector(selectU(x != x, (bits >> 16) | 0x40, rounded), VecH);
+  }
+
+  // fp16 is IEEE binary16. F16C, AVX-512 and NEON convert it directly, and the other builds
+  // rearrange the bits, which gives the same results.
+  inline VecF fromFp16(VecH h) {
+#if defined(__AVX512F__)
+    return (VecF)_mm512_cvtph_ps((__m256i)h);
+#elif defined(__F16C__) && FERRUM_SIMD_BYTES == 32
+    return (VecF)_mm256_cvtph_ps((__m128i)h);
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    return (VecF)vcvt_f32_f16(vreinterpret_f16_u16((uint16x4_t)h));
+#else
+    VecU u = __builtin_convertvector(h, VecU);
+    VecU em = (u & 0x7fff) << 13;
+    // moving the exponent bias from 15 to 127 also scales the subnormals
+    VecU f = (VecU)((VecF)em * 0x1p112f);
+    f = selectU((u & 0x7c00) == 0x7c00, em | 0x7f800000, f);
+    return (VecF)(f | ((u & 0x8000) << 16));
+#endif
+  }
+
+  inline VecH toFp16(VecF x) {
+#if defined(__AVX512F__)
+    return (VecH)_mm512_cvtps_ph((__m512)x, _MM_FROUND_TO_NEAREST_INT);
+#elif defined(__F16C__) && FERRUM_SIMD_BYTES == 32
+    return (VecH)_mm256_cvtps_ph((__m256)x, _MM_FROUND_TO_NEAREST_INT);
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    return (VecH)vreinterpret_u16_f16(vcvt_f16_f32((float32x4_t)x));
+#else
+    VecU bits = (VecU)x;
+    VecU f = bits & 0x7fffffff;
+    // 2^16 and above overflows to infinity
+    VecU special = selectU(f > 0x7f800000, VecU{} + 0x7e00, VecU{} + 0x7c00);
+    // below 2^-14, adding 0.5 leaves the subnormal in the low bits, rounded by the addition
+    VecU subnormal = (VecU)((VecF)f + 0.5f) - 0x3f000000;
+    VecU normal = (f - (112u << 23) + 0xfff + ((f >> 13) & 1)) >> 13;
+    VecU h = selectU(f >= (143u << 23), special, selectU(f < (113u << 23), subnormal, normal));
+    return __builtin_convertvector(h | ((bits >> 16) & 0x8000), VecH);
+#endif
+  }
+
+} // namespace FERRUM_SIMD_ISA
+} // namespace Simd
+} // namespace Ferrum
+
+#endif // FERRUM_CPU_SIMD_HPP
@@ -0,0 +1,17 @@
+#pragma once
+
+#ifndef FERRUM_DEBUG_HPP
+#define FERRUM_DEBUG_HPP
+
+#ifdef DEBUG
+#include <iostream>
+#define DBG1(arg1) std::cout << (arg1) << std::endl
+#define DBG2(arg1, arg2) std::cout << (arg1) << (arg2) << std::endl
+#define DBG3(arg1, arg2, arg3) std::cout << (arg1) << (arg2) << (arg3) << std::endl
+#define MACRO_DISPATCH(arg1, arg2, arg3, func, ...) func
+#define DBG(...) MACRO_DISPATCH(__VA_ARGS__, DBG3, DBG2, DBG1)(__VA_ARGS__)
+#else
+#define DBG(...)
+#endif
+
+#endif // FERRUM_DEBUG_HPP
@@ -0,0 +1,172 @@
+#pragma once
+
+#ifndef FERRUM_DISPATCH_PLAN_HPP
+#define FERRUM_DISPATCH_PLAN_HPP
+
+#include <algorithm>
+#include <cstddef>
+
+// Planning for how work is split up, on the GPU and on the CPU.
+// This has no dependency on Metal, so that the logic can be tested on any platform.
+
+namespace Ferrum {
+
+  // The number of threads (or elements) in each dimension of a job.
+  // Vector kernels are 1 high, and matrix kernels are sd x fd.
+  struct Grid {
+    size_t width;
+    size_t height;
+  };
+
+  // A Metal dispatch: the threads across the whole grid, and the threads in each threadgroup.
+  // Threadgroups at the edges may be partial, so the grid is exactly the size of the job.
+  struct DispatchPlan {
+    Grid threads;
+    Grid threadsPerGroup;
+  };
+
+  // A split of [0, count) into contiguous chunks, all of chunkSize except for the last one
+  struct ChunkPlan {
+    size_t chunks;
+    size_t chunkSize;
+  };
+
+  inline size_t roundUp(size_t value, size_t multiple) {
+    return (value + multiple - 1) / multiple * multiple;
+  }
+
+  // The number of vector elements that fit in a buffer, at the given offset and stride
+  inline ptrdiff_t vectorCount(int len, int offset, int stride) {
+    if (offset < 0 || stride < 1 || offset >= len) {
+      return 0;
+    }
+    // in size_t, so a large stride cannot overflow
+    return (ptrdiff_t)(((size_t)(len - offset) + (size_t)stride - 1) / (size_t)stride);
+  }
+
+  // Sizes threadgroups for a pipeline.
+  // executionWidth: the SIMD width of the pipeline (threadExecutionWidth)
+  // maxThreads: the largest threadgroup that the pipeline allows (maxTotalThreadsPerThreadgroup)
+  inline DispatchPlan planDispatch(Grid grid, size_t executionWidth, size_t maxThreads) {
+    executionWidth = std::max<size_t>(executionWidth, 1);
+    maxThreads = std::max(maxThreads, executionWidth);
+    DispatchPlan plan = {grid, {1, 1}};
+    if (grid.width == 0 || grid.height == 0) {
+      plan.threads = {0, 0};
+      return plan;
+    }
+    if (grid.height == 1) {
+      // as many whole SIMD groups as fit in a threadgroup, but no more than the job needs
+      size_t groupWidth = maxThreads / executionWidth * executionWidth;
+      plan.threadsPerGroup.width = std::min(groupWidth, roundUp(grid.width, executionWidth));
+    } else {
+      // one SIMD group down each column, so that neighboring threads read neighboring elements,
+      // and then as many columns as fit
+      size_t groupWidth = std::min(grid.width, executionWidth);
+      plan.threadsPerGroup.width = groupWidth;
+      plan.threadsPerGroup.height = std::min(maxThreads / groupWidth, grid.height);
+    }
+    return plan;
+  }
+
+  // A two pass reduction on the GPU (see reduction.metal). The first pass runs groups threadgroups,
+  // which each reduce a share of the elements to a partial result, and the second pass runs one
+  // threadgroup to reduce the partial results. Threadgroups are a power of two in size.
+  // The plan only depends on the element count and the pipeline, so results are repeatable.
+  struct ReductionPlan {
+    size_t threadsPerGroup;
+    size_t groups;
+  };
+
+  // The largest threadgroup used for a reduction, and so the most partial results
+  const size_t MAX_REDUCTION_THREADS = 256;
+
+  // The bytes of threadgroup memory, or of the partial results buffer, for each partial result.
+  // This is sizeof(Partial) in reduction.metal, rounded up to the alignment of threadgroup memory.
+  const size_t REDUCTION_PARTIAL_SIZE = 16;
+
+  // maxThreads: the largest threadgroup that the pipeline allows (maxTotalThreadsPerThreadgroup)
+  inline ReductionPlan planReduction(size_t count, size_t maxThreads) {
+    size_t threads = 1;
+    while (threads * 2 <= std::min(maxThreads, MAX_REDUCTION_THREADS)) {
+      threads *= 2;
+    }
+    // no more partial results than the second pass has threads, and at least one threadgroup
+    // so that an empty vector still writes its result
+    size_t groups = std::min(std::max<size_t>((count + threads - 1) / threads, 1), threads);
+    return {threads, groups};
+  }
+
+  // The fixed blocking of reproducible sums, used by both the GPU and the CPU. Each block of
+  // REPRODUCIBLE_BLOCK elements is reduced by REPRODUCIBLE_LANES lanes, where each lane combines
+  // every REPRODUCIBLE_LANES'th element in turn, and the lanes are then combined in a fixed tree.
+  // The partial results of the blocks are reduced in the same way, with each lane combining every
+  // REPRODUCIBLE_LANES'th block. Nothing depends on the number of threads or on the device.
+  const size_t REPRODUCIBLE_LANES = 256;
+  const size_t REPRODUCIBLE_ROWS = 8;
+  const size_t REPRODUCIBLE_BLOCK = REPRODUCIBLE_LANES * REPRODUCIBLE_ROWS;
+
+  // A reduction with one threadgroup of REPRODUCIBLE_LANES threads for each block
+  inline ReductionPlan planReproducibleReduction(size_t count) {
+    return {REPRODUCIBLE_LANES, std::max<size_t>((count + REPRODUCIBLE_BLOCK - 1) / REPRODUCIBLE_BLOCK, 1)};
+  }
+
+  // Matrix products on the GPU (see blas.metal) compute a GEMM_TILE x GEMM_TILE tile of the result
+  // in each threadgroup of GEMM_THREADS threads
+  const size_t GEMM_TILE = 64;
+  const size_t GEMM_THREADS = 256;
+
+  // The threadgroups for an m x n result
+  inline Grid gemmGroups(size_t m, size_t n) {
+    return {(m + GEMM_TILE - 1) / GEMM_TILE, (n + GEMM_TILE - 1) / GEMM_TILE};
+  }
+
+  // Cache blocking of matrix products on the CPU (see cpu_gemm.cpp). A KC deep slice of op(b),
+  // NC columns wide, is packed to stay in the last level cache, and each MC x KC block of op(a)
+  // stays in the L2 cache while it is multiplied by the packed columns.
+  const size_t GEMM_MC = 128;
+  const size_t GEMM_KC = 256;
+  const size_t GEMM_NC = 4096;
+
+  // Matrix-vector products on the GPU use threadgroups of GEMV_THREADS threads. Without a transpose,
+  // each thread computes an element of the result. Transposed, each SIMD group computes one, by
+  // reading down a column of the matrix.
+  const size_t GEMV_THREADS = 256;
+
+  // The threadgroups for y = op(a) * x, where a is m x n
+  inline size_t gemvGroups(bool trans, size_t m, size_t n, size_t simdWidth) {
+    size_t perGroup = trans ? std::max<size_t>(GEMV_THREADS / std::max<size_t>(simdWidth, 1), 1) : GEMV_THREADS;
+    size_t count = trans ? n : m;
+    return (count + perGroup - 1) / perGroup;
+  }
+
+  // Matrix-vector products on the CPU (see cpu_blas.cpp) sum GEMV_ROWS elements of the result at a
+  // time, or GEMV_COLUMNS when transposed, so that the sums stay in the L1 cache
+  const size_t GEMV_ROWS = 1024;
+  const size_t GEMV_COLUMNS = 64;
+
+  // Triangular functions solve or multiply the diagonal of the triangle in blocks of this many rows,
+  // and apply the rest of the triangle with matrix products
+  const size_t TRIANGULAR_BLOCK = 64;
+
+  // Splits count elements between threads, giving each thread at least grain elements
+  inline ChunkPlan planChunks(size_t count, size_t grain, size_t threads) {
+    if (count == 0) {
+      return {0, 0};
+    }
+    grain = std::max<size_t>(grain, 1);
+    size_t chunks = std::max<size_t>(std::min(count / grain, threads), 1);
+    size_t chunkSize = (count + chunks - 1) / chunks;
+    // rounding up the chunk size can leave the final chunk empty, so recount
+    return {(count + chunkSize - 1) / chunkSize, chunkSize};
+  }
+
+  // The grain, in columns, for splitting a matrix with the given number of rows.
+  // Columns are never split, so that each one is processed as a unit-stride run.
+  inline size_t columnGrain(size_t rows, size_t grain) {
+    return std::max<size_t>(1, grain / std::max<size_t>(rows, 1));
+  }
+
+} // namespace Ferrum
+
+#endif // FERRUM_DISPATCH_PLAN_HPP
@@ -5,24 +5,29 @@
 
 #include <Metal/Metal.hpp>
 #include <MetalKit/MetalKit.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
 #include <string>
+#include <thread>
 #include <unordered_map>
+#include <unordered_set>
 #include "FoundationEx.hpp"
-#include "functions.hpp"
-
-#ifdef DEBUG
-#define DBG1(arg1) std::cout << (arg1) << std::endl
-#define DBG2(arg1, arg2) std::cout << (arg1) << (arg2) << std::endl
-#define DBG3(arg1, arg2, arg3) std::cout << (arg1) << (arg2) << (arg3) << std::endl
-#define MACRO_DISPATCH(arg1, arg2, arg3, func, ...) func
-#define DBG(...) MACRO_DISPATCH(__VA_ARGS__, DBG3, DBG2, DBG1)(__VA_ARGS__)
-#else
-#define DBG(...)
-#endif
+#include "backend.hpp"
+#include "dispatch_plan.hpp"
+#include "debug.hpp"
 
 namespace Ferrum {
 
-  class MetalEngine {
+  class BlockAllocator;
+  class BufferPool;
+  class PipelineCache;
+  class PipelineCompiler;
+  class SerialQueue;
+
+  class MetalEngine : public Engine {
 
     using BufferAction = std::function<void(std::vector<MTL::Buffer*>&, int)>;
     BufferAction emptyAction;
@@ -31,116 +36,264 @@ namespace Ferrum {
       MetalEngine(const char* path);
       ~MetalEngine();
 
+      const char* name() const override { return "metal"; }
+
+      // Tensors are pooled shared buffers. Passing their data to a dispatch function binds
+      // the buffer directly.
+      Tensor* newTensor(int length) override;
+      void releaseTensor(Tensor* tensor) override;
+
+      // A batch is encoded into one command buffer, which is committed by commitBatch.
+      // Each thread has its own batch, so calls from other threads run outside of it.
+      bool beginBatch() override;
+      bool commitBatch() override;
+      bool inBatch() const override;
+
+      // Reproducible sums run pass 0 of the reductions with the fixed blocking
+      void setReproducible(bool on) override { reproducibleSums = on; }
+      bool reproducible() const override { return reproducibleSums; }
+
+      // Jobs are encoded by a submission thread, rather than the caller. Calls in a job that only use
+      // tensors are committed without waiting, so the next job is encoded while the GPU runs them,
+      // and the future is set from the completion of the job's last command buffer.
+      std::future<float*> submit(Job job, Completion done = nullptr) override;
+      // false if the device or library could not be loaded
+      bool ready() const { return pipelines != nullptr; }
+
       // Dispatch functions
       // f: float, b: buffer, B: in/out buffer. The final buffer is always an out-only buffer (shown as B)
       // Buffers are *always* followed by: length, offset, stride
 
       // general vector functions
       float* vect_bB(FunctionID id, const float* a, int lena, int offset_a, int stride_a,
-                                    float* result, int len, int offset, int stride);
+                                    float* result, int len, int offset, int stride) override;
       float* vect_bfB(FunctionID id, const float* a, int lena, int offset_a, int stride_a,
                                      float sa,
-                                     float* result, int len, int offset, int stride);
+                                     float* result, int len, int offset, int stride) override;
       float* vect_fbB(FunctionID id, float sa,
                                      const float* a, int lena, int offset_a, int stride_a,
-                                     float* result, int len, int offset, int stride);
+                                     float* result, int len, int offset, int stride) override;
       float* vect_bbB(FunctionID id, const float* a, int lena, int offset_a, int stride_a,
                                      const float* b, int lenb, int offset_b, int stride_b,
-                                     float* result, int len, int offset, int stride);
+                                     float* result, int len, int offset, int stride) override;
       float* vect_bBB(FunctionID id, const float* a, int lena, int offset_a, int stride_a,
                                      float* b, int lenb, int offset_b, int stride_b,
-                                     float* result, int len, int offset, int stride);
+                                     float* result, int len, int offset, int stride) override;
       float* vect_bffffB(FunctionID id, const float* a, int lena, int offset_a, int stride_a,
                                         float sa, float sha,
                                         float sb, float shb,
-                                        float* result, int len, int offset, int stride);
+                                        float* result, int len, int offset, int stride) override;
       float* vect_bbffffB(FunctionID id, const float* a, int lena, int offset_a, int stride_a,
                                          const float* b, int lenb, int offset_b, int stride_b,
                                          float sa, float sha,
                                          float sb, float shb,
-                                         float* result, int len, int offset, int stride);
+                                         float* result, int len, int offset, int stride) override;
+      // a kernel is generated and compiled once for each shape of expression
+      float* vect_fused(const FusedExpr& expr, const std::vector<FusedInput>& inputs,
+                        float* result, int len, int offset, int stride) override;
       // general matrix functions
       float* ge_bB(FunctionID id, int sd, int fd,
                                   const float* a, int lena, int offset_a, int stride_a,
-                                  float* result, int len, int offset, int stride);
+                                  float* result, int len, int offset, int stride) override;
       float* ge_bfB(FunctionID id, int sd, int fd,
                                    const float* a, int lena, int offset_a, int stride_a,
                                    float sa,
-                                   float* result, int len, int offset, int stride);
+                                   float* result, int len, int offset, int stride) override;
       float* ge_fbB(FunctionID id, int sd, int fd, float sa,
                                    const float* a, int lena, int offset_a, int stride_a,
-                                   float* result, int len, int offset, int stride);
+                                   float* result, int len, int offset, int stride) override;
       float* ge_bbB(FunctionID id, int sd, int fd,
                                    const float* a, int lena, int offset_a, int stride_a,
                                    const float* b, int lenb, int offset_b, int stride_b,
-                                   float* result, int len, int offset, int stride);
+                                   float* result, int len, int offset, int stride) override;
       float* ge_bBB(FunctionID id, int sd, int fd,
                                    const float* a, int lena, int offset_a, int stride_a,
                                    float* b, int lenb, int offset_b, int stride_b,
-                                   float* result, int len, int offset, int stride);
+                                   float* result, int len, int offset, int stride) override;
       float* ge_bffffB(FunctionID id, int sd, int fd,
                                       const float* a, int lena, int offset_a, int stride_a,
                                       float sa, float sha,
                                       float sb, float shb,
-                                      float* result, int len, int offset, int stride);
+                                      float* result, int len, int offset, int stride) override;
       float* ge_bbffffB(FunctionID id, int sd, int fd,
                                        const float* a, int lena, int offset_a, int stride_a,
                                        const float* b, int lenb, int offset_b, int stride_b,
                                        float sa, float sha,
                                        float sb, float shb,
-                                       float* result, int len, int offset, int stride);
+                                       float* result, int len, int offset, int stride) override;
       // general uplo functions
       float* uplo_bB(FunctionID id, int sd, int unit, int bottom,
                                     const float* a, int lena, int offset_a, int stride_a,
-                                    float* result, int len, int offset, int stride);
+                                    float* result, int len, int offset, int stride) override;
       float* uplo_bfB(FunctionID id, int sd, int unit, int bottom,
                                      const float* a, int lena, int offset_a, int stride_a,
                                      float sa,
-                                     float* result, int len, int offset, int stride);
+                                     float* result, int len, int offset, int stride) override;
       float* uplo_fbB(FunctionID id, int sd, int unit, int bottom,
                                      const float* a, int lena, int offset_a, int stride_a,
                                      float sa,
-                                     float* result, int len, int offset, int stride);
+                                     float* result, int len, int offset, int stride) override;
       float* uplo_bbB(FunctionID id, int sd, int unit, int bottom,
                                      const float* a, int lena, int offset_a, int stride_a,
                                      const float* b, int lenb, int offset_b, int stride_b,
-                                     float* result, int len, int offset, int stride);
+                                     float* result, int len, int offset, int stride) override;
       float* uplo_bBB(FunctionID id, int sd, int unit, int bottom,
                                      const float* a, int lena, int offset_a, int stride_a,
                                      float* b, int lenb, int offset_b, int stride_b,
-                                     float* result, int len, int offset, int stride);
+                                     float* result, int len, int offset, int stride) override;
       float* uplo_bffffB(FunctionID id, int sd, int unit, int bottom,
                                         const float* a, int lena, int offset_a, int stride_a,
                                         float sa, float sha,
                                         float sb, float shb,
-                                        float* result, int len, int offset, int stride);
+                                        float* result, int len, int offset, int stride) override;
       float* uplo_bbffffB(FunctionID id, int sd, int unit, int bottom,
                                          const float* a, int lena, int offset_a, int stride_a,
                                          const float* b, int lenb, int offset_b, int stride_b,
                                          float sa, float sha,
                                          float sb, float shb,
-                                         float* result, int len, int offset, int stride);
+                                         float* result, int len, int offset, int stride) override;
+      // matrix products, a tile of c to each threadgroup (see blas.metal)
+      float* ge_gemm(int trans_a, int trans_b, int m, int n, int k,
+                     float alpha,
+                     const float* a, int lena, int offset_a, int ld_a,
+                     const float* b, int lenb, int offset_b, int ld_b,
+                     float beta,
+                     float* c, int lenc, int offset_c, int ld_c) override;
+      // matrix-vector functions (see blas.metal)
+      float* ge_mv(int trans, int m, int n, float alpha,
+                   const float* a, int lena, int offset_a, int ld_a,
+                   const float* x, int lenx, int offset_x, int stride_x,
+                   float beta,
+                   float* y, int leny, int offset_y, int stride_y) override;
+      float* ge_rk(int m, int n, float alpha,
+                   const float* x, int lenx, int offset_x, int stride_x,
+                   const float* y, int leny, int offset_y, int stride_y,
+                   float* a, int lena, int offset_a, int ld_a) override;
+      // triangular functions, a block of the diagonal at a time with products for the rest (see blas.metal)
+      float* uplo_trmv(int trans, int sd, int unit, int bottom,
+                       const float* a, int lena, int offset_a, int ld_a,
+                       float* x, int lenx, int offset_x, int stride_x) override;
+      float* uplo_trsv(int trans, int sd, int unit, int bottom,
+                       const float* a, int lena, int offset_a, int ld_a,
+                       float* x, int lenx, int offset_x, int stride_x) override;
+      float* uplo_trmm(int left, int trans, int unit, int bottom, int m, int n, float alpha,
+                       const float* a, int lena, int offset_a, int ld_a,
+                       float* b, int lenb, int offset_b, int ld_b) override;
+      float* uplo_trsm(int left, int trans, int unit, int bottom, int m, int n, float alpha,
+                       const float* a, int lena, int offset_a, int ld_a,
+                       float* b, int lenb, int offset_b, int ld_b) override;
 
     private:
       MTL::Device* device;
       MTL::Library* library;
       MTL::CommandQueue* commandQueue;
-      MTL::Function** function;
-      // for now, keep track of the function pipeline states in a map
-      int fnCount;
-      MTL::Function** kernelFunctions;
-      MTL::ComputePipelineState** computePipelineStates;
+      // pipeline states are compiled on first use, through an archive that is saved between runs
+      PipelineCompiler* compiler;
+      PipelineCache* pipelines;
+      MTL::BinaryArchive* archive;
+      std::string archivePath;
+      // buffers are reused between calls
+      BlockAllocator* allocator;
+      BufferPool* bufferPool;
+      // the buffers for live tensors, by their contents
+      std::unordered_map<const float*, MTL::Buffer*> tensorBuffers;
+      // buffers from newBuffer that wrap the caller's memory, also guarded by tensorLock
+      std::unordered_set<MTL::Buffer*> wrappedBuffers;
+      // shared by the lookups of each call, and only held alone to add or remove a buffer
+      std::shared_mutex tensorLock;
+      SerialQueue* submissions;
+      // A batch that a thread has open. Calls outside of a batch each encode into a command buffer
+      // of their own, from the command queue, which Metal makes thread safe.
+      struct BatchContext {
+        MTL::CommandBuffer* commands;
+        MTL::ComputeCommandEncoder* encoder;
+        // buffers to recycle once the batch has run, such as the partial results of reductions,
+        // and the buffers of tensors released while the batch was open
+        std::vector<MTL::Buffer*> scratch;
+      };
+      // the open batches, by thread. The lock is only held to begin or commit a batch, and by threads
+      // with batches open on more than one engine.
+      std::unordered_map<std::thread::id, BatchContext> batches;
+      mutable std::mutex batchLock;
+      // The batch that the calling thread began most recently, so calls find it without a lock
+      struct ThreadBatch {
+        const MetalEngine* engine;
+        BatchContext* batch;
+        // the batches open on this thread, on any engine
+        int open;
+      };
+      static thread_local ThreadBatch current;
+      std::atomic<bool> reproducibleSums;
+      // A submitted job, which may have command buffers running after it returns
+      struct JobContext : std::enable_shared_from_this<JobContext> {
+        MetalEngine* engine;
+        std::promise<float*> promise;
+        Completion done;
+        float* result;
+        std::atomic<bool> failed;
+        // command buffers still running, plus one while the job is being encoded
+        std::atomic<int> outstanding;
+        // buffers to recycle once the job is complete, such as the partial results of reductions
+        std::vector<MTL::Buffer*> scratch;
+      };
+      // the job being encoded on this thread
+      static thread_local JobContext* runningJob;
+      // command buffers from jobs that have not completed, which the destructor waits for
+      int inFlight;
+      std::mutex inFlightLock;
+      std::condition_variable inFlightDone;
+      // memory aligned to this can be wrapped in a buffer without a copy
+      size_t pageSize;
+
+      // fused kernels, by the shape of their expression
+      std::unordered_map<std::string, MTL::ComputePipelineState*> fusedPipelines;
+      std::mutex fusedLock;
+
+      MTL::Buffer* tensorBuffer(const float* data);
+      // the open batch of the calling thread, or nullptr when its calls run immediately
+      BatchContext* threadBatch();
+      // the job of this engine that the calling thread is encoding, or nullptr
+      JobContext* currentJob() const { return (runningJob != nullptr && runningJob->engine == this) ? runningJob : nullptr; }
+      // called when a job returns, and when each of its command buffers completes
+      void finishJob(const std::shared_ptr<JobContext>& job);
+      // true if every buffer belongs to a tensor
+      bool allTensors(const std::vector<MTL::Buffer*>& buffers);
+      MTL::ComputePipelineState* pipeline(FunctionID id);
+      // the pipeline for a general dispatch function, or nullptr if the kernel takes other arguments
+      MTL::ComputePipelineState* pipeline(FunctionID id, Family family, Signature signature);
+      MTL::ComputePipelineState* fusedPipeline(const FusedExpr& expr);
+
+      MTL::Buffer* newBuffer(const float* data, int length);
+      void recycle(MTL::Buffer* buffer);
+
+      // Binds the buffers, and calls encode to set the arguments and dispatch the kernel.
+      // This commits and waits for the command buffer, unless a batch is open.
+      template<typename CreateBuffers, typename Encode, typename CopyResults>
+      float* encode_metal(MTL::ComputePipelineState* pipelineState,
+                          float* result, int len,
+                          CreateBuffers createBuffers, Encode encode, CopyResults copyResults);
 
       template<typename CreateBuffers, typename SetBuffers, typename CopyResults>
-      float* call_metal(FunctionID id,
-                        float* result, int len, int offset, int stride,
+      // grid: the number of threads to run over, in each dimension
+      float* call_metal(MTL::ComputePipelineState* pipelineState, Grid grid,
+                        float* result, int len,
                         CreateBuffers createBuffers, SetBuffers setBuffers, CopyResults copyResults);
-  };
 
-  inline FunctionID getFunctionID(const std::string& name) {
-    auto it = functionMap->find(name);
-    return (it == functionMap->end()) ? FunctionID::UNKNOWN : it->second;
-  }
+      // Runs a reduction of count elements in two passes (see reduction.metal).
+      // fixed: use the blocking of reproducible sums, rather than sizing threadgroups for the device.
+      // setBuffers returns the index of the first argument after those of the function.
+      template<typename CreateBuffers, typename SetBuffers>
+      float* call_reduction(MTL::ComputePipelineState* pipelineState, ptrdiff_t count, bool fixed,
+                            float* result, int len,
+                            CreateBuffers createBuffers, SetBuffers setBuffers);
+
+      // Checks and encodes a triangular function. For b on the right, the problem is transposed
+      // so that the triangle is on the left.
+      float* call_triangular(FunctionID id, bool solve, int left, int trans, int unit, int bottom,
+                             int m, int n, float alpha,
+                             const float* a, int lena, int offset_a, int ld_a,
+                             float* b, int lenb, int offset_b, int ld_b);
+  };
 
 } // namespace Ferrum
 
@@ -0,0 +1,117 @@
+#pragma once
+
+#ifndef FERRUM_FUSION_HPP
+#define FERRUM_FUSION_HPP
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "backend.hpp"
+
+// Fusion of chains of elementwise vector functions into a single kernel.
+// Each element of the inputs is read once, every function is applied to it in registers,
+// and the final value is written once. This has no dependency on Metal, so that expressions
+// and generated source can be tested on any platform.
+
+namespace Ferrum {
+
+  // A vector read by a fused expression
+  struct FusedInput {
+    const float* data;
+    int length;
+    int offset;
+    int stride;
+  };
+
+  // A node of a fused expression: either an input vector, or a vector function applied
+  // to earlier nodes.
+  struct FusedNode {
+    // UNKNOWN for inputs
+    FunctionID id;
+    Signature signature;
+    // the index of the input vector, for inputs
+    int input;
+    // the nodes read by the function, or -1
+    int args[2];
+    // in the order that the dispatch function takes them
+    float scalars[4];
+  };
+
+  // An expression DAG over the vector functions. Nodes can only refer to earlier nodes,
+  // so the order they are added in is always a valid order of evaluation.
+  // For example, relu(exp(0.5 * x + 1) * y):
+  //   FusedExpr e;
+  //   int x = e.input(), y = e.input();
+  //   int s = e.apply(FunctionID::vector_scale_shift, {x}, {0.5f, 1.0f, 0.0f, 0.0f});
+  //   int m = e.apply(FunctionID::vector_mul, {e.apply(FunctionID::vector_exp, {s}), y});
+  //   e.apply(FunctionID::vector_relu, {m}, {0.0f});
+  class FusedExpr {
+    public:
+      // Adds an input vector, and returns its node. Inputs are numbered in the order they are added.
+      int input();
+
+      // Applies a vector function to earlier nodes, and returns the new node.
+      // Returns -1 if the function is not elementwise, or if the arguments do not match it.
+      // Only functions with a single result can be fused, so vector_equals and the bBB functions cannot.
+      int apply(FunctionID id, const std::vector<int>& args, const std::vector<float>& scalars = {});
+
+      // The node written to the result. This is the last node applied, unless it is set.
+      int result() const;
+      void setResult(int node);
+
+      const std::vector<FusedNode>& nodes() const { return exprNodes; }
+      int inputCount() const { return inputs; }
+
+      // true if there is a function to evaluate, and every node was accepted
+      bool valid() const;
+
+      // Marks each node that the result depends on
+      std::vector<bool> live() const;
+
+      // Describes the functions and how they are connected, but not the scalars.
+      // Expressions with the same shape share a compiled kernel.
+      std::string shape() const;
+
+    private:
+      std::vector<FusedNode> exprNodes;
+      int inputs = 0;
+      int resultNode = -1;
+      bool rejected = false;
+  };
+
+  // The number of buffers that a signature reads, including the in/out buffer of bBB
+  inline int signatureArgs(Signature signature) {
+    return (signature == Signature::bbB || signature == Signature::bBB || signature == Signature::bbffffB) ? 2 : 1;
+  }
+
+  inline int signatureScalars(Signature signature) {
+    switch (signature) {
+      case Signature::bfB:
+      case Signature::fbB:
+        return 1;
+      case Signature::bffffB:
+      case Signature::bbffffB:
+        return 4;
+      default:
+        return 0;
+    }
+  }
+
+  // Returns the signature of a vector function that can be fused, or false if it cannot be
+  bool fusedSignature(FunctionID id, Signature& signature);
+
+  // Metal source for a kernel that evaluates the expression for one element per thread.
+  // This needs the helpers in vect-math.h before it. The buffers are bound as:
+  //   0..n-1: the inputs
+  //   n: the result
+  //   n+1: uint offsets[n+1], for the inputs then the result
+  //   n+2: uint strides[n+1]
+  //   n+3: REAL scalars[4 * nodes]
+  std::string fusedMetalSource(const FusedExpr& expr, const char* kernelName);
+
+  // The number of elements that a fused call runs over
+  ptrdiff_t fusedCount(const std::vector<FusedInput>& inputs, int len, int offset, int stride);
+
+} // namespace Ferrum
+
+#endif // FERRUM_FUSION_HPP
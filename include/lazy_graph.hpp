@@ -0,0 +1,96 @@
+#pragma once
+
+#ifndef FERRUM_LAZY_GRAPH_HPP
+#define FERRUM_LAZY_GRAPH_HPP
+
+#include <vector>
+#include "backend.hpp"
+
+// Deferred evaluation of vector functions on tensors.
+// Functions are recorded as a graph rather than run, and only the results that are asked for
+// are computed when the graph is evaluated. Chains of elementwise functions are fused, and
+// the intermediate values that still need a buffer share a small set of temporary tensors.
+
+namespace Ferrum {
+
+  // A node of a lazy graph: an input tensor, a vector function applied to earlier nodes,
+  // or the second result of a function with two results (see LazyGraph::second)
+  struct LazyNode {
+    // UNKNOWN for inputs and second results
+    FunctionID id;
+    Signature signature;
+    // the nodes read by the function, or -1
+    int args[2];
+    // in the order that the dispatch function takes them
+    float scalars[4];
+    int length;
+    // the tensor of an input node, otherwise nullptr
+    Tensor* tensor;
+    // for a second result, the node of the function that writes it, otherwise -1
+    int first;
+  };
+
+  // For example, t = relu(exp(x) * y) with exp(x) and the product never stored:
+  //   LazyGraph g(engine);
+  //   int x = g.input(tx), y = g.input(ty);
+  //   int m = g.apply(FunctionID::vector_mul, {g.apply(FunctionID::vector_exp, {x}), y});
+  //   g.output(g.apply(FunctionID::vector_relu, {m}, {0.0f}), t);
+  //   g.evaluate();
+  class LazyGraph {
+    public:
+      // The engine must outlive the graph
+      LazyGraph(Engine* engine);
+      ~LazyGraph();
+
+      // Adds an input tensor, and returns its node. Tensors are read when the graph is evaluated,
+      // so they can be updated between evaluations.
+      int input(Tensor* tensor);
+
+      // Records a vector function of earlier nodes, and returns its node, or -1 if the function
+      // or its arguments are not valid. The function can be any elementwise vector function that
+      // can be fused, or one with two results (vector_sincos, vector_modf).
+      int apply(FunctionID id, const std::vector<int>& args, const std::vector<float>& scalars = {});
+
+      // The node for the second result of a function with two results, such as the sine from
+      // vector_sincos. Returns -1 if the node does not have a second result.
+      int second(int node) const;
+
+      // Writes a node into a tensor when the graph is evaluated. Replaces any earlier tensor for the node.
+      bool output(int node, Tensor* tensor);
+
+      // Computes every output, with one submission to the engine, and waits for it.
+      // Nodes that no output depends on are not run. Independent chains are ordered so that
+      // each temporary is released as early as possible, and released temporaries are reused
+      // by later nodes, and by later evaluations of the graph.
+      // Must not be called inside a batch.
+      bool evaluate();
+
+      // Removes every node and output, keeping the temporary tensors for reuse
+      void clear();
+
+      const std::vector<LazyNode>& nodes() const { return graphNodes; }
+      // The number of dispatch calls made by the last evaluation
+      int dispatches() const { return lastDispatches; }
+      // The number of temporary tensors that the graph has allocated
+      int temporaries() const { return allocated; }
+
+    private:
+      Engine* engine;
+      std::vector<LazyNode> graphNodes;
+      // the tensor for each output node
+      std::vector<std::pair<int, Tensor*>> outputs;
+      // temporary tensors that are not in use
+      std::vector<Tensor*> spare;
+      int lastDispatches = 0;
+      int allocated = 0;
+
+      Tensor* acquire(int length);
+      void collect(int node, const std::vector<bool>& stored, std::vector<int>& inlined, std::vector<int>& sources) const;
+      float* dispatch(int node, const std::vector<Tensor*>& buffers);
+      float* dispatchFused(int root, const std::vector<int>& inlined, const std::vector<int>& sources,
+                           const std::vector<Tensor*>& buffers);
+  };
+
+} // namespace Ferrum
+
+#endif // FERRUM_LAZY_GRAPH_HPP
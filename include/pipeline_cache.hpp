@@ -0,0 +1,74 @@
+#pragma once
+
+#ifndef FERRUM_PIPELINE_CACHE_HPP
+#define FERRUM_PIPELINE_CACHE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "functions.hpp"
+
+namespace Ferrum {
+
+  // Source of the pipelines held by a PipelineCache
+  class PipelineCompiler {
+    public:
+      virtual ~PipelineCompiler() {}
+      // Returns the pipeline for a function, such as an MTL::ComputePipelineState, or nullptr on failure.
+      // cached: set to true if the pipeline was loaded from the on-disk cache, rather than compiled.
+      virtual void* compile(FunctionID id, bool& cached) = 0;
+      virtual void release(void* pipeline) = 0;
+  };
+
+  // Creates the pipeline of each function on its first use, rather than all of them up front.
+  // Each function is compiled at most once: threads that ask for a function while it is being
+  // compiled wait for it, and a function that failed is not tried again.
+  class PipelineCache {
+
+    public:
+      // compiler: the source of pipelines. This is not owned by the cache.
+      PipelineCache(PipelineCompiler* compiler);
+      // Releases the pipelines
+      ~PipelineCache();
+
+      // The pipeline of a function, compiled if this is its first use. nullptr if it cannot be compiled.
+      void* get(FunctionID id);
+      // Compiles functions now, such as those that a program is known to use
+      void warm(const std::vector<FunctionID>& ids);
+
+      // true if the function has been compiled, or has failed to compile
+      bool compiled(FunctionID id) const;
+      // The number of functions that have been compiled
+      int compiledCount() const;
+      // The number of pipelines compiled since markSaved, which the on-disk cache does not have yet
+      int unsaved() const { return unsavedCount; }
+      void markSaved() { unsavedCount = 0; }
+
+    private:
+      PipelineCompiler* compiler;
+      std::unique_ptr<std::once_flag[]> once;
+      std::unique_ptr<std::atomic<void*>[]> pipelines;
+      std::unique_ptr<std::atomic<bool>[]> done;
+      std::atomic<int> unsavedCount;
+  };
+
+  // A 64 bit FNV-1a hash of a compiled library, so that cached pipelines are only used with
+  // the library that they were compiled from
+  uint64_t libraryHash(const void* data, size_t size);
+
+  // The file for the cached pipelines of a library, named by its hash. The directory is dir if it is given,
+  // then FERRUM_CACHE, then the user's cache directory. Empty if FERRUM_CACHE is set to an empty
+  // string, which turns the cache off, or if there is no home directory.
+  std::string pipelineCachePath(uint64_t hash, const char* dir = nullptr);
+
+  // The functions to compile when an engine is created, from a list of names separated by commas
+  // or spaces, such as the FERRUM_WARM environment variable. Unknown names are reported and skipped.
+  std::vector<FunctionID> warmList(const char* names);
+
+} // namespace Ferrum
+
+#endif // FERRUM_PIPELINE_CACHE_HPP
@@ -0,0 +1,347 @@
+#pragma once
+
+#ifndef FERRUM_RECORDING_ENGINE_HPP
+#define FERRUM_RECORDING_ENGINE_HPP
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+#include "backend.hpp"
+
+namespace Ferrum {
+
+  // A single call made on an engine
+  struct RecordedCall {
+    // the dispatch function, such as "vect_bbB", or "newTensor"/"releaseTensor"/"beginBatch"/"commitBatch"
+    const char* dispatch;
+    FunctionID id;
+    // sd and fd for ge functions; sd, unit and bottom for uplo functions; the length for newTensor;
+    // trans_a, trans_b, m, n and k for ge_gemm; trans, m and n for ge_mv; m and n for ge_rk;
+    // trans, sd, unit and bottom for uplo_trmv and uplo_trsv; left, trans, unit, bottom, m and n for
+    // uplo_trmm and uplo_trsm;
+    // the FunctionID of each node for vect_fused;
+    // the HalfFormat, before any of the above, for half precision functions
+    std::vector<int> dims;
+    // in double, so that the scalars of double precision calls are kept exactly
+    std::vector<double> scalars;
+    // length, offset and stride of each buffer, in argument order
+    std::vector<int> buffers;
+  };
+
+  // Records each call before passing it to another engine. With no engine to forward to,
+  // calls are only recorded and the result buffer is returned unchanged, which makes this
+  // a mock backend for testing the layers above.
+  class RecordingEngine : public Engine {
+
+    public:
+      // delegate: the engine to forward calls to, or nullptr. This engine takes ownership of it.
+      RecordingEngine(Engine* delegate = nullptr);
+      ~RecordingEngine();
+
+      const char* name() const override { return "recording"; }
+
+      // Tensors come from the delegate, or from host memory when there is no delegate
+      Tensor* newTensor(int length) override;
+      void releaseTensor(Tensor* tensor) override;
+
+      // The start and end of a batch are recorded as calls with no function
+      bool beginBatch() override;
+      bool commitBatch() override;
+      bool inBatch() const override;
+
+      // The setting is passed to the delegate, and is not recorded as a call
+      void setReproducible(bool on) override;
+      bool reproducible() const override;
+
+      // Jobs are recorded when they run. Without a delegate, they run on the caller's thread.
+      std::future<float*> submit(Job job, Completion done = nullptr) override;
+
+      // A copy of the calls made so far, in order
+      std::vector<RecordedCall> calls();
+      void clear();
+
+      // Dispatch functions
+      // f: float, b: buffer, B: in/out buffer. The final buffer is always an out-only buffer (shown as B)
+      // Buffers are *always* followed by: length, offset, stride
+
+      // general vector functions
+      float* vect_bB(FunctionID id, const float* a, int lena, int offset_a, int stride_a,
+                                    float* result, int len, int offset, int stride) override;
+      float* vect_bfB(FunctionID id, const float* a, int lena, int offset_a, int stride_a,
+                                     float sa,
+                                     float* result, int len, int offset, int stride) override;
+      float* vect_fbB(FunctionID id, float sa,
+                                     const float* a, int lena, int offset_a, int stride_a,
+                                     float* result, int len, int offset, int stride) override;
+      float* vect_bbB(FunctionID id, const float* a, int lena, int offset_a, int stride_a,
+                                     const float* b, int lenb, int offset_b, int stride_b,
+                                     float* result, int len, int offset, int stride) override;
+      float* vect_bBB(FunctionID id, const float* a, int lena, int offset_a, int stride_a,
+                                     float* b, int lenb, int offset_b, int stride_b,
+                                     float* result, int len, int offset, int stride) override;
+      float* vect_bffffB(FunctionID id, const float* a, int lena, int offset_a, int stride_a,
+                                        float sa, float sha,
+                                        float sb, float shb,
+                                        float* result, int len, int offset, int stride) override;
+      float* vect_bbffffB(FunctionID id, const float* a, int lena, int offset_a, int stride_a,
+                                         const float* b, int lenb, int offset_b, int stride_b,
+                                         float sa, float sha,
+                                         float sb, float shb,
+                                         float* result, int len, int offset, int stride) override;
+      // recorded with the functions in dims, and the scalars of every node
+      float* vect_fused(const FusedExpr& expr, const std::vector<FusedInput>& inputs,
+                        float* result, int len, int offset, int stride) override;
+      // general matrix functions
+      float* ge_bB(FunctionID id, int sd, int fd,
+                                  const float* a, int lena, int offset_a, int stride_a,
+                                  float* result, int len, int offset, int stride) override;
+      float* ge_bfB(FunctionID id, int sd, int fd,
+                                   const float* a, int lena, int offset_a, int stride_a,
+                                   float sa,
+                                   float* result, int len, int offset, int stride) override;
+      float* ge_fbB(FunctionID id, int sd, int fd, float sa,
+                                   const float* a, int lena, int offset_a, int stride_a,
+                                   float* result, int len, int offset, int stride) override;
+      float* ge_bbB(FunctionID id, int sd, int fd,
+                                   const float* a, int lena, int offset_a, int stride_a,
+                                   const float* b, int lenb, int offset_b, int stride_b,
+                                   float* result, int len, int offset, int stride) override;
+      float* ge_bBB(FunctionID id, int sd, int fd,
+                                   const float* a, int lena, int offset_a, int stride_a,
+                                   float* b, int lenb, int offset_b, int stride_b,
+                                   float* result, int len, int offset, int stride) override;
+      float* ge_bffffB(FunctionID id, int sd, int fd,
+                                      const float* a, int lena, int offset_a, int stride_a,
+                                      float sa, float sha,
+                                      float sb, float shb,
+                                      float* result, int len, int offset, int stride) override;
+      float* ge_bbffffB(FunctionID id, int sd, int fd,
+                                       const float* a, int lena, int offset_a, int stride_a,
+                                       const float* b, int lenb, int offset_b, int stride_b,
+                                       float sa, float sha,
+                                       float sb, float shb,
+                                       float* result, int len, int offset, int stride) override;
+      // general uplo functions
+      float* uplo_bB(FunctionID id, int sd, int unit, int bottom,
+                                    const float* a, int lena, int offset_a, int stride_a,
+                                    float* result, int len, int offset, int stride) override;
+      float* uplo_bfB(FunctionID id, int sd, int unit, int bottom,
+                                     const float* a, int lena, int offset_a, int stride_a,
+                                     float sa,
+                                     float* result, int len, int offset, int stride) override;
+      float* uplo_fbB(FunctionID id, int sd, int unit, int bottom,
+                                     const float* a, int lena, int offset_a, int stride_a,
+                                     float sa,
+                                     float* result, int len, int offset, int stride) override;
+      float* uplo_bbB(FunctionID id, int sd, int unit, int bottom,
+                                     const float* a, int lena, int offset_a, int stride_a,
+                                     const float* b, int lenb, int offset_b, int stride_b,
+                                     float* result, int len, int offset, int stride) override;
+      float* uplo_bBB(FunctionID id, int sd, int unit, int bottom,
+                                     const float* a, int lena, int offset_a, int stride_a,
+                                     float* b, int lenb, int offset_b, int stride_b,
+                                     float* result, int len, int offset, int stride) override;
+      float* uplo_bffffB(FunctionID id, int sd, int unit, int bottom,
+                                        const float* a, int lena, int offset_a, int stride_a,
+                                        float sa, float sha,
+                                        float sb, float shb,
+                                        float* result, int len, int offset, int stride) override;
+      float* uplo_bbffffB(FunctionID id, int sd, int unit, int bottom,
+                                         const float* a, int lena, int offset_a, int stride_a,
+                                         const float* b, int lenb, int offset_b, int stride_b,
+                                         float sa, float sha,
+                                         float sb, float shb,
+                                         float* result, int len, int offset, int stride) override;
+      // matrix products
+      float* ge_gemm(int trans_a, int trans_b, int m, int n, int k, float alpha,
+                     const float* a, int lena, int offset_a, int ld_a,
+                     const float* b, int lenb, int offset_b, int ld_b,
+                     float beta,
+                     float* c, int lenc, int offset_c, int ld_c) override;
+      // matrix-vector functions
+      float* ge_mv(int trans, int m, int n, float alpha,
+                   const float* a, int lena, int offset_a, int ld_a,
+                   const float* x, int lenx, int offset_x, int stride_x,
+                   float beta,
+                   float* y, int leny, int offset_y, int stride_y) override;
+      float* ge_rk(int m, int n, float alpha,
+                   const float* x, int lenx, int offset_x, int stride_x,
+                   const float* y, int leny, int offset_y, int stride_y,
+                   float* a, int lena, int offset_a, int ld_a) override;
+      // triangular functions
+      float* uplo_trmv(int trans, int sd, int unit, int bottom,
+                       const float* a, int lena, int offset_a, int ld_a,
+                       float* x, int lenx, int offset_x, int stride_x) override;
+      float* uplo_trsv(int trans, int sd, int unit, int bottom,
+                       const float* a, int lena, int offset_a, int ld_a,
+                       float* x, int lenx, int offset_x, int stride_x) override;
+      float* uplo_trmm(int left, int trans, int unit, int bottom, int m, int n, float alpha,
+                       const float* a, int lena, int offset_a, int ld_a,
+                       float* b, int lenb, int offset_b, int ld_b) override;
+      float* uplo_trsm(int left, int trans, int unit, int bottom, int m, int n, float alpha,
+                       const float* a, int lena, int offset_a, int ld_a,
+                       float* b, int lenb, int offset_b, int ld_b) override;
+
+      // double precision, recorded with the name of the double dispatch function, such as "dvect_bB".
+      // Without a delegate, they are only recorded, so they are accepted.
+      bool doublePrecision() const override;
+      // general vector functions
+      double* dvect_bB(FunctionID id, const double* a, int lena, int offset_a, int stride_a,
+                                      double* result, int len, int offset, int stride) override;
+      double* dvect_bfB(FunctionID id, const double* a, int lena, int offset_a, int stride_a,
+                                       double sa,
+                                       double* result, int len, int offset, int stride) override;
+      double* dvect_fbB(FunctionID id, double sa,
+                                       const double* a, int lena, int offset_a, int stride_a,
+                                       double* result, int len, int offset, int stride) override;
+      double* dvect_bbB(FunctionID id, const double* a, int lena, int offset_a, int stride_a,
+                                       const double* b, int lenb, int offset_b, int stride_b,
+                                       double* result, int len, int offset, int stride) override;
+      double* dvect_bBB(FunctionID id, const double* a, int lena, int offset_a, int stride_a,
+                                       double* b, int lenb, int offset_b, int stride_b,
+                                       double* result, int len, int offset, int stride) override;
+      double* dvect_bffffB(FunctionID id, const double* a, int lena, int offset_a, int stride_a,
+                                          double sa, double sha,
+                                          double sb, double shb,
+                                          double* result, int len, int offset, int stride) override;
+      double* dvect_bbffffB(FunctionID id, const double* a, int lena, int offset_a, int stride_a,
+                                           const double* b, int lenb, int offset_b, int stride_b,
+                                           double sa, double sha,
+                                           double sb, double shb,
+                                           double* result, int len, int offset, int stride) override;
+      // general matrix functions
+      double* dge_bB(FunctionID id, int sd, int fd,
+                                    const double* a, int lena, int offset_a, int stride_a,
+                                    double* result, int len, int offset, int stride) override;
+      double* dge_bfB(FunctionID id, int sd, int fd,
+                                     const double* a, int lena, int offset_a, int stride_a,
+                                     double sa,
+                                     double* result, int len, int offset, int stride) override;
+      double* dge_fbB(FunctionID id, int sd, int fd, double sa,
+                                     const double* a, int lena, int offset_a, int stride_a,
+                                     double* result, int len, int offset, int stride) override;
+      double* dge_bbB(FunctionID id, int sd, int fd,
+                                     const double* a, int lena, int offset_a, int stride_a,
+                                     const double* b, int lenb, int offset_b, int stride_b,
+                                     double* result, int len, int offset, int stride) override;
+      double* dge_bBB(FunctionID id, int sd, int fd,
+                                     const double* a, int lena, int offset_a, int stride_a,
+                                     double* b, int lenb, int offset_b, int stride_b,
+                                     double* result, int len, int offset, int stride) override;
+      double* dge_bffffB(FunctionID id, int sd, int fd,
+                                        const double* a, int lena, int offset_a, int stride_a,
+                                        double sa, double sha,
+                                        double sb, double shb,
+                                        double* result, int len, int offset, int stride) override;
+      double* dge_bbffffB(FunctionID id, int sd, int fd,
+                                         const double* a, int lena, int offset_a, int stride_a,
+                                         const double* b, int lenb, int offset_b, int stride_b,
+                                         double sa, double sha,
+                                         double sb, double shb,
+                                         double* result, int len, int offset, int stride) override;
+      // general uplo functions
+      double* duplo_bB(FunctionID id, int sd, int unit, int bottom,
+                                      const double* a, int lena, int offset_a, int stride_a,
+                                      double* result, int len, int offset, int stride) override;
+      double* duplo_bfB(FunctionID id, int sd, int unit, int bottom,
+                                       const double* a, int lena, int offset_a, int stride_a,
+                                       double sa,
+                                       double* result, int len, int offset, int stride) override;
+      double* duplo_fbB(FunctionID id, int sd, int unit, int bottom,
+                                       const double* a, int lena, int offset_a, int stride_a,
+                                       double sa,
+                                       double* result, int len, int offset, int stride) override;
+      double* duplo_bbB(FunctionID id, int sd, int unit, int bottom,
+                                       const double* a, int lena, int offset_a, int stride_a,
+                                       const double* b, int lenb, int offset_b, int stride_b,
+                                       double* result, int len, int offset, int stride) override;
+      double* duplo_bBB(FunctionID id, int sd, int unit, int bottom,
+                                       const double* a, int lena, int offset_a, int stride_a,
+                                       double* b, int lenb, int offset_b, int stride_b,
+                                       double* result, int len, int offset, int stride) override;
+      double* duplo_bffffB(FunctionID id, int sd, int unit, int bottom,
+                                          const double* a, int lena, int offset_a, int stride_a,
+                                          double sa, double sha,
+                                          double sb, double shb,
+                                          double* result, int len, int offset, int stride) override;
+      double* duplo_bbffffB(FunctionID id, int sd, int unit, int bottom,
+                                           const double* a, int lena, int offset_a, int stride_a,
+                                           const double* b, int lenb, int offset_b, int stride_b,
+                                           double sa, double sha,
+                                           double sb, double shb,
+                                           double* result, int len, int offset, int stride) override;
+
+      // half precision storage, recorded as "hvect_bB" and so on, with the format as the first dimension
+      bool halfStorage() const override;
+      // general vector functions
+      uint16_t* hvect_bB(FunctionID id, HalfFormat format, const uint16_t* a, int lena, int offset_a, int stride_a,
+                                                           uint16_t* result, int len, int offset, int stride) override;
+      uint16_t* hvect_bfB(FunctionID id, HalfFormat format, const uint16_t* a, int lena, int offset_a, int stride_a,
+                                                            float sa,
+                                                            uint16_t* result, int len, int offset, int stride) override;
+      uint16_t* hvect_fbB(FunctionID id, HalfFormat format, float sa,
+                                                            const uint16_t* a, int lena, int offset_a, int stride_a,
+                                                            uint16_t* result, int len, int offset, int stride) override;
+      uint16_t* hvect_bbB(FunctionID id, HalfFormat format, const uint16_t* a, int lena, int offset_a, int stride_a,
+                                                            const uint16_t* b, int lenb, int offset_b, int stride_b,
+                                                            uint16_t* result, int len, int offset, int stride) override;
+      uint16_t* hvect_bBB(FunctionID id, HalfFormat format, const uint16_t* a, int lena, int offset_a, int stride_a,
+                                                            uint16_t* b, int lenb, int offset_b, int stride_b,
+                                                            uint16_t* result, int len, int offset, int stride) override;
+      uint16_t* hvect_bffffB(FunctionID id, HalfFormat format, const uint16_t* a, int lena, int offset_a, int stride_a,
+                                                               float sa, float sha,
+                                                               float sb, float shb,
+                                                               uint16_t* result, int len, int offset, int stride) override;
+      uint16_t* hvect_bbffffB(FunctionID id, HalfFormat format, const uint16_t* a, int lena, int offset_a, int stride_a,
+                                                                const uint16_t* b, int lenb, int offset_b, int stride_b,
+                                                                float sa, float sha,
+                                                                float sb, float shb,
+                                                                uint16_t* result, int len, int offset, int stride) override;
+      // general matrix functions
+      uint16_t* hge_bB(FunctionID id, HalfFormat format, int sd, int fd,
+                                                         const uint16_t* a, int lena, int offset_a, int stride_a,
+                                                         uint16_t* result, int len, int offset, int stride) override;
+      uint16_t* hge_bfB(FunctionID id, HalfFormat format, int sd, int fd,
+                                                          const uint16_t* a, int lena, int offset_a, int stride_a,
+                                                          float sa,
+                                                          uint16_t* result, int len, int offset, int stride) override;
+      uint16_t* hge_fbB(FunctionID id, HalfFormat format, int sd, int fd, float sa,
+                                                          const uint16_t* a, int lena, int offset_a, int stride_a,
+                                                          uint16_t* result, int len, int offset, int stride) override;
+      uint16_t* hge_bbB(FunctionID id, HalfFormat format, int sd, int fd,
+                                                          const uint16_t* a, int lena, int offset_a, int stride_a,
+                                                          const uint16_t* b, int lenb, int offset_b, int stride_b,
+                                                          uint16_t* result, int len, int offset, int stride) override;
+      uint16_t* hge_bBB(FunctionID id, HalfFormat format, int sd, int fd,
+                                                          const uint16_t* a, int lena, int offset_a, int stride_a,
+                                                          uint16_t* b, int lenb, int offset_b, int stride_b,
+                                                          uint16_t* result, int len, int offset, int stride) override;
+      uint16_t* hge_bffffB(FunctionID id, HalfFormat format, int sd, int fd,
+                                                             const uint16_t* a, int lena, int offset_a, int stride_a,
+                                                             float sa, float sha,
+                                                             float sb, float shb,
+                                                             uint16_t* result, int len, int offset, int stride) override;
+      uint16_t* hge_bbffffB(FunctionID id, HalfFormat format, int sd, int fd,
+                                                              const uint16_t* a, int lena, int offset_a, int stride_a,
+                                                              const uint16_t* b, int lenb, int offset_b, int stride_b,
+                                                              float sa, float sha,
+                                                              float sb, float shb,
+                                                              uint16_t* result, int len, int offset, int stride) override;
+
+    private:
+      Engine* delegate;
+      mutable std::mutex lock;
+      std::vector<RecordedCall> recorded;
+      // tracked here as well, for when there is no delegate. Batches belong to the thread that began them.
+      std::unordered_set<std::thread::id> batchThreads;
+      std::atomic<bool> reproducibleSums;
+
+      void record(const char* dispatch, FunctionID id, std::vector<int> dims,
+                  std::vector<double> scalars, std::vector<int> buffers);
+  };
+
+} // namespace Ferrum
+
+#endif // FERRUM_RECORDING_ENGINE_HPP
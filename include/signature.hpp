@@ -0,0 +1,27 @@
+#pragma once
+
+#ifndef FERRUM_SIGNATURE_HPP
+#define FERRUM_SIGNATURE_HPP
+
+// The shapes of kernel arguments. generateNames reads these from the Metal source of each
+// kernel, and writes a KernelShape for each function to functions.hpp.
+
+namespace Ferrum {
+
+  // The argument layout of a kernel, named after the dispatch functions that accept it.
+  // f: float, b: buffer, B: in/out buffer.
+  // none: the kernel has a layout of its own, and no general dispatch function accepts it.
+  enum class Signature { bB, bfB, fbB, bbB, bBB, bffffB, bbffffB, none };
+
+  // The arguments before the buffers of a kernel: none for vector, sd and fd for ge,
+  // and sd, unit and bottom for uplo. other kernels, such as gemm, have their own dispatch functions.
+  enum class Family { vector, ge, uplo, other };
+
+  struct KernelShape {
+    Family family;
+    Signature signature;
+  };
+
+} // namespace Ferrum
+
+#endif // FERRUM_SIGNATURE_HPP
@@ -0,0 +1,82 @@
+#pragma once
+
+#ifndef FERRUM_THREAD_POOL_HPP
+#define FERRUM_THREAD_POOL_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Ferrum {
+
+  // A fixed set of worker threads for splitting loops across cores.
+  // The calling thread always takes part in the work, so a pool of size 0 runs everything inline.
+  class ThreadPool {
+    public:
+      using Task = std::function<void()>;
+      using RangeBody = std::function<void(size_t begin, size_t end)>;
+
+      // threads: number of worker threads. Negative selects one fewer than the hardware concurrency,
+      //          leaving the calling thread as the final worker.
+      ThreadPool(int threads = -1);
+      ~ThreadPool();
+
+      // The number of threads that work on a parallel loop, including the caller
+      int concurrency() const { return static_cast<int>(workers.size()) + 1; }
+
+      // Calls body over contiguous sub-ranges of [0, count). Ranges are no smaller than grain,
+      // except for the last one. Returns once every range is complete.
+      void parallelFor(size_t count, size_t grain, const RangeBody& body);
+
+      // Calls body(i) for i in [0, count), one task per index. Returns once every task is complete.
+      void parallelTasks(size_t count, const std::function<void(size_t)>& body);
+
+    private:
+      std::vector<std::thread> workers;
+      std::deque<Task> tasks;
+      std::mutex lock;
+      std::condition_variable available;
+      bool stopping;
+
+      void workerLoop();
+      // runs a queued task on the calling thread, if there is one
+      bool runPending();
+  };
+
+  // Runs tasks one at a time on a dedicated thread, in the order that they are posted.
+  // Used for asynchronous submission, where each call may depend on the ones before it.
+  class SerialQueue {
+    public:
+      SerialQueue();
+      // Runs any tasks that are still queued before returning
+      ~SerialQueue();
+
+      void post(std::function<void()> task);
+
+      // Posts a function, and returns a future for its result
+      template <typename Result>
+      std::future<Result> submit(std::function<Result()> fn) {
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::move(fn));
+        post([task]() { (*task)(); });
+        return task->get_future();
+      }
+
+    private:
+      std::thread worker;
+      std::deque<std::function<void()>> tasks;
+      std::mutex lock;
+      std::condition_variable available;
+      bool stopping;
+
+      void workerLoop();
+  };
+
+} // namespace Ferrum
+
+#endif // FERRUM_THREAD_POOL_HPP
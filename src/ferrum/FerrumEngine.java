@@ -1,5 +1,11 @@
 package ferrum;
 
+import java.lang.ref.Cleaner;
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+import java.nio.FloatBuffer;
+import java.util.concurrent.CompletableFuture;
+
 public class FerrumEngine implements AutoCloseable {
 
     static {
@@ -24,56 +30,1043 @@ public class FerrumEngine implements AutoCloseable {
 
     private static native void close(long engineHandle);
 
+    // The backend running this engine: "metal", "cpu" or "recording".
+    // This is selected with a prefix on the path, such as "cpu:" or "metal:/path/to/lib",
+    // or else with the FERRUM_BACKEND environment variable.
+    public String backendName() {
+      return backendName(engineHandle);
+    }
+
+    private static native String backendName(long engineHandle);
+
+    // Functions are named by their IDs in Functions, such as Functions.vector_exp. The versions
+    // that take the name of a function look up its ID on each call, so a caller that makes many
+    // calls should look it up once, with Functions.id.
+    private static int function(String fn) {
+        int id = Functions.id(fn);
+        if (id == Functions.UNKNOWN) {
+            throw new IllegalArgumentException("Unknown function: " + fn);
+        }
+        return id;
+    }
+
     public float[] vect_bB(String fn, float[] a) {
+        return vect_bB(function(fn), a);
+    }
+
+    public float[] vect_bB(int fn, float[] a) {
         return vect_bB(fn, a, 0, 1);
     }
 
     public float[] vect_bfB(String fn, float[] a, float sa) {
+        return vect_bfB(function(fn), a, sa);
+    }
+
+    public float[] vect_bfB(int fn, float[] a, float sa) {
         return vect_bfB(fn, a, 0, 1, sa);
     }
 
     public float[] vect_fbB(String fn, float sa, float[] a) {
+        return vect_fbB(function(fn), sa, a);
+    }
+
+    public float[] vect_fbB(int fn, float sa, float[] a) {
         return vect_fbB(fn, sa, a, 0, 1);
     }
 
     public float[] vect_bbB(String fn, float[] a, float[] b) {
+        return vect_bbB(function(fn), a, b);
+    }
+
+    public float[] vect_bbB(int fn, float[] a, float[] b) {
         return vect_bbB(fn, a, 0, 1, b, 0, 1);
     }
 
     public float[] vect_bBB(String fn, float[] a, float[] b) {
+        return vect_bBB(function(fn), a, b);
+    }
+
+    public float[] vect_bBB(int fn, float[] a, float[] b) {
         return vect_bBB(fn, a, 0, 1, b, 0, 1);
     }
 
     public float[] vect_bffffB(String fn, float[] a, float sa, float sha, float sb, float shb) {
+        return vect_bffffB(function(fn), a, sa, sha, sb, shb);
+    }
+
+    public float[] vect_bffffB(int fn, float[] a, float sa, float sha, float sb, float shb) {
         return vect_bffffB(fn, a, 0, 1, sa, sha, sb, shb);
     }
 
     public float[] vect_bbffffB(String fn, float[] a, float[] b, float sa, float sha, float sb, float shb) {
+        return vect_bbffffB(function(fn), a, b, sa, sha, sb, shb);
+    }
+
+    public float[] vect_bbffffB(int fn, float[] a, float[] b, float sa, float sha, float sb, float shb) {
         return vect_bbffffB(fn, a, 0, 1, b, 0, 1, sa, sha, sb, shb);
     }
 
-    public native float[] vect_bB(String fn, float[] a, int offset_a, int stride_a);
+    public float[] vect_bB(String fn, float[] a, int offset_a, int stride_a) {
+        return vect_bB(function(fn), a, offset_a, stride_a);
+    }
 
-    public native float[] vect_bfB(String fn, float[] a, int offset_a, int stride_a, float sa);
+    public native float[] vect_bB(int fn, float[] a, int offset_a, int stride_a);
 
-    public native float[] vect_fbB(String fn, float sa, float[] a, int offset_a, int stride_a);
+    public float[] vect_bfB(String fn, float[] a, int offset_a, int stride_a, float sa) {
+        return vect_bfB(function(fn), a, offset_a, stride_a, sa);
+    }
+
+    public native float[] vect_bfB(int fn, float[] a, int offset_a, int stride_a, float sa);
+
+    public float[] vect_fbB(String fn, float sa, float[] a, int offset_a, int stride_a) {
+        return vect_fbB(function(fn), sa, a, offset_a, stride_a);
+    }
+
+    public native float[] vect_fbB(int fn, float sa, float[] a, int offset_a, int stride_a);
 
-    public native float[] vect_bbB(String fn,
+    public float[] vect_bbB(String fn,
+                            float[] a, int offset_a, int stride_a,
+                            float[] b, int offset_b, int stride_b) {
+        return vect_bbB(function(fn), a, offset_a, stride_a, b, offset_b, stride_b);
+    }
+
+    public native float[] vect_bbB(int fn,
                                    float[] a, int offset_a, int stride_a,
                                    float[] b, int offset_b, int stride_b);
 
-    public native float[] vect_bBB(String fn,
+    public float[] vect_bBB(String fn,
+                            float[] a, int offset_a, int stride_a,
+                            float[] b, int offset_b, int stride_b) {
+        return vect_bBB(function(fn), a, offset_a, stride_a, b, offset_b, stride_b);
+    }
+
+    public native float[] vect_bBB(int fn,
                                    float[] a, int offset_a, int stride_a,
                                    float[] b, int offset_b, int stride_b);
 
-    public native float[] vect_bffffB(String fn,
+    public float[] vect_bffffB(String fn,
+                               float[] a, int offset_a, int stride_a,
+                               float sa, float sha,
+                               float sb, float shb) {
+        return vect_bffffB(function(fn), a, offset_a, stride_a, sa, sha, sb, shb);
+    }
+
+    public native float[] vect_bffffB(int fn,
                                       float[] a, int offset_a, int stride_a,
                                       float sa, float sha,
                                       float sb, float shb);
 
-    public native float[] vect_bbffffB(String fn,
+    public float[] vect_bbffffB(String fn,
+                                float[] a, int offset_a, int stride_a,
+                                float[] b, int offset_b, int stride_b,
+                                float sa, float sha,
+                                float sb, float shb) {
+        return vect_bbffffB(function(fn), a, offset_a, stride_a, b, offset_b, stride_b, sa, sha, sb, shb);
+    }
+
+    public native float[] vect_bbffffB(int fn,
                                        float[] a, int offset_a, int stride_a,
                                        float[] b, int offset_b, int stride_b,
                                        float sa, float sha,
                                        float sb, float shb);
+
+    // Versions of the vector functions on direct FloatBuffers, which the engine works on in place,
+    // writing to result rather than to a new array. Offsets are from the start of each buffer,
+    // whatever its position. The result is laid out like the argument (the shorter one, if there
+    // are two), up to the capacity of result. Buffers must be direct and in native byte order.
+    // The Metal engine uses the buffers from newFloatBuffer without copying them at all, and copies
+    // any other buffer.
+
+    // Frees the memory of the buffers from newFloatBuffer
+    private static final Cleaner CLEANER = Cleaner.create();
+
+    // A direct buffer in native memory that covers whole pages, which the engine may use in place.
+    // The memory is freed once the buffer is no longer reachable.
+    public static FloatBuffer newFloatBuffer(int length) {
+        if (length < 0) {
+            throw new IllegalArgumentException("Negative buffer length: " + length);
+        }
+        long address = allocateHost(length);
+        ByteBuffer bytes = hostBuffer(address, length);
+        CLEANER.register(bytes, () -> releaseHost(address));
+        return bytes.order(ByteOrder.nativeOrder()).asFloatBuffer();
+    }
+
+    private static native long allocateHost(int length);
+
+    private static native ByteBuffer hostBuffer(long address, int length);
+
+    private static native void releaseHost(long address);
+
+    private static void checkDirect(FloatBuffer buffer) {
+        if (!buffer.isDirect() || buffer.order() != ByteOrder.nativeOrder()) {
+            throw new IllegalArgumentException("Expected a direct buffer in native byte order");
+        }
+    }
+
+    public FloatBuffer vect_bB(String fn, FloatBuffer a, int offset_a, int stride_a, FloatBuffer result) {
+        return vect_bB(function(fn), a, offset_a, stride_a, result);
+    }
+
+    public FloatBuffer vect_bB(int fn, FloatBuffer a, int offset_a, int stride_a, FloatBuffer result) {
+        checkDirect(a);
+        checkDirect(result);
+        return vect_bB_direct(fn, a, offset_a, stride_a, result);
+    }
+
+    public FloatBuffer vect_bfB(String fn, FloatBuffer a, int offset_a, int stride_a, float sa, FloatBuffer result) {
+        return vect_bfB(function(fn), a, offset_a, stride_a, sa, result);
+    }
+
+    public FloatBuffer vect_bfB(int fn, FloatBuffer a, int offset_a, int stride_a, float sa, FloatBuffer result) {
+        checkDirect(a);
+        checkDirect(result);
+        return vect_bfB_direct(fn, a, offset_a, stride_a, sa, result);
+    }
+
+    public FloatBuffer vect_fbB(String fn, float sa, FloatBuffer a, int offset_a, int stride_a, FloatBuffer result) {
+        return vect_fbB(function(fn), sa, a, offset_a, stride_a, result);
+    }
+
+    public FloatBuffer vect_fbB(int fn, float sa, FloatBuffer a, int offset_a, int stride_a, FloatBuffer result) {
+        checkDirect(a);
+        checkDirect(result);
+        return vect_fbB_direct(fn, sa, a, offset_a, stride_a, result);
+    }
+
+    public FloatBuffer vect_bbB(String fn,
+                                FloatBuffer a, int offset_a, int stride_a,
+                                FloatBuffer b, int offset_b, int stride_b,
+                                FloatBuffer result) {
+        return vect_bbB(function(fn), a, offset_a, stride_a, b, offset_b, stride_b, result);
+    }
+
+    public FloatBuffer vect_bbB(int fn,
+                                FloatBuffer a, int offset_a, int stride_a,
+                                FloatBuffer b, int offset_b, int stride_b,
+                                FloatBuffer result) {
+        checkDirect(a);
+        checkDirect(b);
+        checkDirect(result);
+        return vect_bbB_direct(fn, a, offset_a, stride_a, b, offset_b, stride_b, result);
+    }
+
+    public FloatBuffer vect_bBB(String fn,
+                                FloatBuffer a, int offset_a, int stride_a,
+                                FloatBuffer b, int offset_b, int stride_b,
+                                FloatBuffer result) {
+        return vect_bBB(function(fn), a, offset_a, stride_a, b, offset_b, stride_b, result);
+    }
+
+    public FloatBuffer vect_bBB(int fn,
+                                FloatBuffer a, int offset_a, int stride_a,
+                                FloatBuffer b, int offset_b, int stride_b,
+                                FloatBuffer result) {
+        checkDirect(a);
+        checkDirect(b);
+        checkDirect(result);
+        return vect_bBB_direct(fn, a, offset_a, stride_a, b, offset_b, stride_b, result);
+    }
+
+    public FloatBuffer vect_bffffB(String fn,
+                                   FloatBuffer a, int offset_a, int stride_a,
+                                   float sa, float sha,
+                                   float sb, float shb,
+                                   FloatBuffer result) {
+        return vect_bffffB(function(fn), a, offset_a, stride_a, sa, sha, sb, shb, result);
+    }
+
+    public FloatBuffer vect_bffffB(int fn,
+                                   FloatBuffer a, int offset_a, int stride_a,
+                                   float sa, float sha,
+                                   float sb, float shb,
+                                   FloatBuffer result) {
+        checkDirect(a);
+        checkDirect(result);
+        return vect_bffffB_direct(fn, a, offset_a, stride_a, sa, sha, sb, shb, result);
+    }
+
+    public FloatBuffer vect_bbffffB(String fn,
+                                    FloatBuffer a, int offset_a, int stride_a,
+                                    FloatBuffer b, int offset_b, int stride_b,
+                                    float sa, float sha,
+                                    float sb, float shb,
+                                    FloatBuffer result) {
+        return vect_bbffffB(function(fn), a, offset_a, stride_a, b, offset_b, stride_b, sa, sha, sb, shb, result);
+    }
+
+    public FloatBuffer vect_bbffffB(int fn,
+                                    FloatBuffer a, int offset_a, int stride_a,
+                                    FloatBuffer b, int offset_b, int stride_b,
+                                    float sa, float sha,
+                                    float sb, float shb,
+                                    FloatBuffer result) {
+        checkDirect(a);
+        checkDirect(b);
+        checkDirect(result);
+        return vect_bbffffB_direct(fn, a, offset_a, stride_a, b, offset_b, stride_b, sa, sha, sb, shb, result);
+    }
+
+    private native FloatBuffer vect_bB_direct(int fn, FloatBuffer a, int offset_a, int stride_a, FloatBuffer result);
+
+    private native FloatBuffer vect_bfB_direct(int fn, FloatBuffer a, int offset_a, int stride_a, float sa, FloatBuffer result);
+
+    private native FloatBuffer vect_fbB_direct(int fn, float sa, FloatBuffer a, int offset_a, int stride_a, FloatBuffer result);
+
+    private native FloatBuffer vect_bbB_direct(int fn,
+                                               FloatBuffer a, int offset_a, int stride_a,
+                                               FloatBuffer b, int offset_b, int stride_b,
+                                               FloatBuffer result);
+
+    private native FloatBuffer vect_bBB_direct(int fn,
+                                               FloatBuffer a, int offset_a, int stride_a,
+                                               FloatBuffer b, int offset_b, int stride_b,
+                                               FloatBuffer result);
+
+    private native FloatBuffer vect_bffffB_direct(int fn,
+                                                  FloatBuffer a, int offset_a, int stride_a,
+                                                  float sa, float sha,
+                                                  float sb, float shb,
+                                                  FloatBuffer result);
+
+    private native FloatBuffer vect_bbffffB_direct(int fn,
+                                                   FloatBuffer a, int offset_a, int stride_a,
+                                                   FloatBuffer b, int offset_b, int stride_b,
+                                                   float sa, float sha,
+                                                   float sb, float shb,
+                                                   FloatBuffer result);
+
+    // Double precision versions of the vector functions, with the same names as the float ones.
+    // Metal has no double precision, so these throw IllegalStateException unless hasDoublePrecision
+    // is true, as it is for the CPU backend. They cannot be called while a batch is open.
+    public native boolean hasDoublePrecision();
+
+    public double[] vect_bB(String fn, double[] a) {
+        return vect_bB(function(fn), a);
+    }
+
+    public double[] vect_bB(int fn, double[] a) {
+        return dvect_bB(fn, a, 0, 1);
+    }
+
+    public double[] vect_bfB(String fn, double[] a, double sa) {
+        return vect_bfB(function(fn), a, sa);
+    }
+
+    public double[] vect_bfB(int fn, double[] a, double sa) {
+        return dvect_bfB(fn, a, 0, 1, sa);
+    }
+
+    public double[] vect_fbB(String fn, double sa, double[] a) {
+        return vect_fbB(function(fn), sa, a);
+    }
+
+    public double[] vect_fbB(int fn, double sa, double[] a) {
+        return dvect_fbB(fn, sa, a, 0, 1);
+    }
+
+    public double[] vect_bbB(String fn, double[] a, double[] b) {
+        return vect_bbB(function(fn), a, b);
+    }
+
+    public double[] vect_bbB(int fn, double[] a, double[] b) {
+        return dvect_bbB(fn, a, 0, 1, b, 0, 1);
+    }
+
+    public double[] vect_bBB(String fn, double[] a, double[] b) {
+        return vect_bBB(function(fn), a, b);
+    }
+
+    public double[] vect_bBB(int fn, double[] a, double[] b) {
+        return dvect_bBB(fn, a, 0, 1, b, 0, 1);
+    }
+
+    public double[] vect_bffffB(String fn, double[] a, double sa, double sha, double sb, double shb) {
+        return vect_bffffB(function(fn), a, sa, sha, sb, shb);
+    }
+
+    public double[] vect_bffffB(int fn, double[] a, double sa, double sha, double sb, double shb) {
+        return dvect_bffffB(fn, a, 0, 1, sa, sha, sb, shb);
+    }
+
+    public double[] vect_bbffffB(String fn, double[] a, double[] b, double sa, double sha, double sb, double shb) {
+        return vect_bbffffB(function(fn), a, b, sa, sha, sb, shb);
+    }
+
+    public double[] vect_bbffffB(int fn, double[] a, double[] b, double sa, double sha, double sb, double shb) {
+        return dvect_bbffffB(fn, a, 0, 1, b, 0, 1, sa, sha, sb, shb);
+    }
+
+    public double[] vect_bB(String fn, double[] a, int offset_a, int stride_a) {
+        return vect_bB(function(fn), a, offset_a, stride_a);
+    }
+
+    public double[] vect_bB(int fn, double[] a, int offset_a, int stride_a) {
+        return dvect_bB(fn, a, offset_a, stride_a);
+    }
+
+    public double[] vect_bfB(String fn, double[] a, int offset_a, int stride_a, double sa) {
+        return vect_bfB(function(fn), a, offset_a, stride_a, sa);
+    }
+
+    public double[] vect_bfB(int fn, double[] a, int offset_a, int stride_a, double sa) {
+        return dvect_bfB(fn, a, offset_a, stride_a, sa);
+    }
+
+    public double[] vect_fbB(String fn, double sa, double[] a, int offset_a, int stride_a) {
+        return vect_fbB(function(fn), sa, a, offset_a, stride_a);
+    }
+
+    public double[] vect_fbB(int fn, double sa, double[] a, int offset_a, int stride_a) {
+        return dvect_fbB(fn, sa, a, offset_a, stride_a);
+    }
+
+    public double[] vect_bbB(String fn,
+                             double[] a, int offset_a, int stride_a,
+                             double[] b, int offset_b, int stride_b) {
+        return vect_bbB(function(fn), a, offset_a, stride_a, b, offset_b, stride_b);
+    }
+
+    public double[] vect_bbB(int fn,
+                             double[] a, int offset_a, int stride_a,
+                             double[] b, int offset_b, int stride_b) {
+        return dvect_bbB(fn, a, offset_a, stride_a, b, offset_b, stride_b);
+    }
+
+    public double[] vect_bBB(String fn,
+                             double[] a, int offset_a, int stride_a,
+                             double[] b, int offset_b, int stride_b) {
+        return vect_bBB(function(fn), a, offset_a, stride_a, b, offset_b, stride_b);
+    }
+
+    public double[] vect_bBB(int fn,
+                             double[] a, int offset_a, int stride_a,
+                             double[] b, int offset_b, int stride_b) {
+        return dvect_bBB(fn, a, offset_a, stride_a, b, offset_b, stride_b);
+    }
+
+    public double[] vect_bffffB(String fn,
+                                double[] a, int offset_a, int stride_a,
+                                double sa, double sha,
+                                double sb, double shb) {
+        return vect_bffffB(function(fn), a, offset_a, stride_a, sa, sha, sb, shb);
+    }
+
+    public double[] vect_bffffB(int fn,
+                                double[] a, int offset_a, int stride_a,
+                                double sa, double sha,
+                                double sb, double shb) {
+        return dvect_bffffB(fn, a, offset_a, stride_a, sa, sha, sb, shb);
+    }
+
+    public double[] vect_bbffffB(String fn,
+                                 double[] a, int offset_a, int stride_a,
+                                 double[] b, int offset_b, int stride_b,
+                                 double sa, double sha,
+                                 double sb, double shb) {
+        return vect_bbffffB(function(fn), a, offset_a, stride_a, b, offset_b, stride_b, sa, sha, sb, shb);
+    }
+
+    public double[] vect_bbffffB(int fn,
+                                 double[] a, int offset_a, int stride_a,
+                                 double[] b, int offset_b, int stride_b,
+                                 double sa, double sha,
+                                 double sb, double shb) {
+        return dvect_bbffffB(fn, a, offset_a, stride_a, b, offset_b, stride_b, sa, sha, sb, shb);
+    }
+
+    // The natives have their own names, as overloaded natives would need the long form of JNI names
+    private native double[] dvect_bB(int fn, double[] a, int offset_a, int stride_a);
+
+    private native double[] dvect_bfB(int fn, double[] a, int offset_a, int stride_a, double sa);
+
+    private native double[] dvect_fbB(int fn, double sa, double[] a, int offset_a, int stride_a);
+
+    private native double[] dvect_bbB(int fn,
+                                      double[] a, int offset_a, int stride_a,
+                                      double[] b, int offset_b, int stride_b);
+
+    private native double[] dvect_bBB(int fn,
+                                      double[] a, int offset_a, int stride_a,
+                                      double[] b, int offset_b, int stride_b);
+
+    private native double[] dvect_bffffB(int fn,
+                                         double[] a, int offset_a, int stride_a,
+                                         double sa, double sha,
+                                         double sb, double shb);
+
+    private native double[] dvect_bbffffB(int fn,
+                                          double[] a, int offset_a, int stride_a,
+                                          double[] b, int offset_b, int stride_b,
+                                          double sa, double sha,
+                                          double sb, double shb);
+
+    // Half precision versions of the vector functions, on the bits of fp16 or bf16 values in short
+    // arrays. The format is FP16 or BF16. Scalars are float, and the arithmetic is done in float with
+    // each result rounded to the nearest half precision value. There are no reductions, and like the
+    // double precision functions these throw IllegalStateException unless hasHalfStorage is true.
+    public static final int FP16 = 0;
+    public static final int BF16 = 1;
+
+    public native boolean hasHalfStorage();
+
+    public short[] vect_bB(String fn, int format, short[] a) {
+        return vect_bB(function(fn), format, a);
+    }
+
+    public short[] vect_bB(int fn, int format, short[] a) {
+        return hvect_bB(fn, format, a, 0, 1);
+    }
+
+    public short[] vect_bfB(String fn, int format, short[] a, float sa) {
+        return vect_bfB(function(fn), format, a, sa);
+    }
+
+    public short[] vect_bfB(int fn, int format, short[] a, float sa) {
+        return hvect_bfB(fn, format, a, 0, 1, sa);
+    }
+
+    public short[] vect_fbB(String fn, int format, float sa, short[] a) {
+        return vect_fbB(function(fn), format, sa, a);
+    }
+
+    public short[] vect_fbB(int fn, int format, float sa, short[] a) {
+        return hvect_fbB(fn, format, sa, a, 0, 1);
+    }
+
+    public short[] vect_bbB(String fn, int format, short[] a, short[] b) {
+        return vect_bbB(function(fn), format, a, b);
+    }
+
+    public short[] vect_bbB(int fn, int format, short[] a, short[] b) {
+        return hvect_bbB(fn, format, a, 0, 1, b, 0, 1);
+    }
+
+    public short[] vect_bBB(String fn, int format, short[] a, short[] b) {
+        return vect_bBB(function(fn), format, a, b);
+    }
+
+    public short[] vect_bBB(int fn, int format, short[] a, short[] b) {
+        return hvect_bBB(fn, format, a, 0, 1, b, 0, 1);
+    }
+
+    public short[] vect_bffffB(String fn, int format, short[] a, float sa, float sha, float sb, float shb) {
+        return vect_bffffB(function(fn), format, a, sa, sha, sb, shb);
+    }
+
+    public short[] vect_bffffB(int fn, int format, short[] a, float sa, float sha, float sb, float shb) {
+        return hvect_bffffB(fn, format, a, 0, 1, sa, sha, sb, shb);
+    }
+
+    public short[] vect_bbffffB(String fn, int format, short[] a, short[] b, float sa, float sha, float sb, float shb) {
+        return vect_bbffffB(function(fn), format, a, b, sa, sha, sb, shb);
+    }
+
+    public short[] vect_bbffffB(int fn, int format, short[] a, short[] b, float sa, float sha, float sb, float shb) {
+        return hvect_bbffffB(fn, format, a, 0, 1, b, 0, 1, sa, sha, sb, shb);
+    }
+
+    public short[] vect_bB(String fn, int format, short[] a, int offset_a, int stride_a) {
+        return vect_bB(function(fn), format, a, offset_a, stride_a);
+    }
+
+    public short[] vect_bB(int fn, int format, short[] a, int offset_a, int stride_a) {
+        return hvect_bB(fn, format, a, offset_a, stride_a);
+    }
+
+    public short[] vect_bfB(String fn, int format, short[] a, int offset_a, int stride_a, float sa) {
+        return vect_bfB(function(fn), format, a, offset_a, stride_a, sa);
+    }
+
+    public short[] vect_bfB(int fn, int format, short[] a, int offset_a, int stride_a, float sa) {
+        return hvect_bfB(fn, format, a, offset_a, stride_a, sa);
+    }
+
+    public short[] vect_fbB(String fn, int format, float sa, short[] a, int offset_a, int stride_a) {
+        return vect_fbB(function(fn), format, sa, a, offset_a, stride_a);
+    }
+
+    public short[] vect_fbB(int fn, int format, float sa, short[] a, int offset_a, int stride_a) {
+        return hvect_fbB(fn, format, sa, a, offset_a, stride_a);
+    }
+
+    public short[] vect_bbB(String fn, int format,
+                            short[] a, int offset_a, int stride_a,
+                            short[] b, int offset_b, int stride_b) {
+        return vect_bbB(function(fn), format, a, offset_a, stride_a, b, offset_b, stride_b);
+    }
+
+    public short[] vect_bbB(int fn, int format,
+                            short[] a, int offset_a, int stride_a,
+                            short[] b, int offset_b, int stride_b) {
+        return hvect_bbB(fn, format, a, offset_a, stride_a, b, offset_b, stride_b);
+    }
+
+    public short[] vect_bBB(String fn, int format,
+                            short[] a, int offset_a, int stride_a,
+                            short[] b, int offset_b, int stride_b) {
+        return vect_bBB(function(fn), format, a, offset_a, stride_a, b, offset_b, stride_b);
+    }
+
+    public short[] vect_bBB(int fn, int format,
+                            short[] a, int offset_a, int stride_a,
+                            short[] b, int offset_b, int stride_b) {
+        return hvect_bBB(fn, format, a, offset_a, stride_a, b, offset_b, stride_b);
+    }
+
+    public short[] vect_bffffB(String fn, int format,
+                               short[] a, int offset_a, int stride_a,
+                               float sa, float sha,
+                               float sb, float shb) {
+        return vect_bffffB(function(fn), format, a, offset_a, stride_a, sa, sha, sb, shb);
+    }
+
+    public short[] vect_bffffB(int fn, int format,
+                               short[] a, int offset_a, int stride_a,
+                               float sa, float sha,
+                               float sb, float shb) {
+        return hvect_bffffB(fn, format, a, offset_a, stride_a, sa, sha, sb, shb);
+    }
+
+    public short[] vect_bbffffB(String fn, int format,
+                                short[] a, int offset_a, int stride_a,
+                                short[] b, int offset_b, int stride_b,
+                                float sa, float sha,
+                                float sb, float shb) {
+        return vect_bbffffB(function(fn), format, a, offset_a, stride_a, b, offset_b, stride_b, sa, sha, sb, shb);
+    }
+
+    public short[] vect_bbffffB(int fn, int format,
+                                short[] a, int offset_a, int stride_a,
+                                short[] b, int offset_b, int stride_b,
+                                float sa, float sha,
+                                float sb, float shb) {
+        return hvect_bbffffB(fn, format, a, offset_a, stride_a, b, offset_b, stride_b, sa, sha, sb, shb);
+    }
+
+    private native short[] hvect_bB(int fn, int format, short[] a, int offset_a, int stride_a);
+
+    private native short[] hvect_bfB(int fn, int format, short[] a, int offset_a, int stride_a, float sa);
+
+    private native short[] hvect_fbB(int fn, int format, float sa, short[] a, int offset_a, int stride_a);
+
+    private native short[] hvect_bbB(int fn, int format,
+                                     short[] a, int offset_a, int stride_a,
+                                     short[] b, int offset_b, int stride_b);
+
+    private native short[] hvect_bBB(int fn, int format,
+                                     short[] a, int offset_a, int stride_a,
+                                     short[] b, int offset_b, int stride_b);
+
+    private native short[] hvect_bffffB(int fn, int format,
+                                        short[] a, int offset_a, int stride_a,
+                                        float sa, float sha,
+                                        float sb, float shb);
+
+    private native short[] hvect_bbffffB(int fn, int format,
+                                         short[] a, int offset_a, int stride_a,
+                                         short[] b, int offset_b, int stride_b,
+                                         float sa, float sha,
+                                         float sb, float shb);
+
+    // Asynchronous versions of the vector functions. These return as soon as the call is queued,
+    // and the future completes when the engine has finished. Calls on an engine run in the order
+    // they are submitted. The arrays are copied when the call is made, so they may be reused
+    // straight away, but for vect_bBB the update to b is only visible once the future completes.
+
+    public CompletableFuture<float[]> vect_bB_async(String fn, float[] a, int offset_a, int stride_a) {
+        return vect_bB_async(function(fn), a, offset_a, stride_a);
+    }
+
+    public CompletableFuture<float[]> vect_bB_async(int fn, float[] a, int offset_a, int stride_a) {
+        CompletableFuture<float[]> future = new CompletableFuture<>();
+        vect_bB_submit(fn, a, offset_a, stride_a, future);
+        return future;
+    }
+
+    public CompletableFuture<float[]> vect_bfB_async(String fn, float[] a, int offset_a, int stride_a, float sa) {
+        return vect_bfB_async(function(fn), a, offset_a, stride_a, sa);
+    }
+
+    public CompletableFuture<float[]> vect_bfB_async(int fn, float[] a, int offset_a, int stride_a, float sa) {
+        CompletableFuture<float[]> future = new CompletableFuture<>();
+        vect_bfB_submit(fn, a, offset_a, stride_a, sa, future);
+        return future;
+    }
+
+    public CompletableFuture<float[]> vect_fbB_async(String fn, float sa, float[] a, int offset_a, int stride_a) {
+        return vect_fbB_async(function(fn), sa, a, offset_a, stride_a);
+    }
+
+    public CompletableFuture<float[]> vect_fbB_async(int fn, float sa, float[] a, int offset_a, int stride_a) {
+        CompletableFuture<float[]> future = new CompletableFuture<>();
+        vect_fbB_submit(fn, sa, a, offset_a, stride_a, future);
+        return future;
+    }
+
+    public CompletableFuture<float[]> vect_bbB_async(String fn,
+                                                     float[] a, int offset_a, int stride_a,
+                                                     float[] b, int offset_b, int stride_b) {
+        return vect_bbB_async(function(fn), a, offset_a, stride_a, b, offset_b, stride_b);
+    }
+
+    public CompletableFuture<float[]> vect_bbB_async(int fn,
+                                                     float[] a, int offset_a, int stride_a,
+                                                     float[] b, int offset_b, int stride_b) {
+        CompletableFuture<float[]> future = new CompletableFuture<>();
+        vect_bbB_submit(fn, a, offset_a, stride_a, b, offset_b, stride_b, future);
+        return future;
+    }
+
+    public CompletableFuture<float[]> vect_bBB_async(String fn,
+                                                     float[] a, int offset_a, int stride_a,
+                                                     float[] b, int offset_b, int stride_b) {
+        return vect_bBB_async(function(fn), a, offset_a, stride_a, b, offset_b, stride_b);
+    }
+
+    public CompletableFuture<float[]> vect_bBB_async(int fn,
+                                                     float[] a, int offset_a, int stride_a,
+                                                     float[] b, int offset_b, int stride_b) {
+        CompletableFuture<float[]> future = new CompletableFuture<>();
+        vect_bBB_submit(fn, a, offset_a, stride_a, b, offset_b, stride_b, future);
+        return future;
+    }
+
+    public CompletableFuture<float[]> vect_bffffB_async(String fn,
+                                                        float[] a, int offset_a, int stride_a,
+                                                        float sa, float sha,
+                                                        float sb, float shb) {
+        return vect_bffffB_async(function(fn), a, offset_a, stride_a, sa, sha, sb, shb);
+    }
+
+    public CompletableFuture<float[]> vect_bffffB_async(int fn,
+                                                        float[] a, int offset_a, int stride_a,
+                                                        float sa, float sha,
+                                                        float sb, float shb) {
+        CompletableFuture<float[]> future = new CompletableFuture<>();
+        vect_bffffB_submit(fn, a, offset_a, stride_a, sa, sha, sb, shb, future);
+        return future;
+    }
+
+    public CompletableFuture<float[]> vect_bbffffB_async(String fn,
+                                                         float[] a, int offset_a, int stride_a,
+                                                         float[] b, int offset_b, int stride_b,
+                                                         float sa, float sha,
+                                                         float sb, float shb) {
+        return vect_bbffffB_async(function(fn), a, offset_a, stride_a, b, offset_b, stride_b, sa, sha, sb, shb);
+    }
+
+    public CompletableFuture<float[]> vect_bbffffB_async(int fn,
+                                                         float[] a, int offset_a, int stride_a,
+                                                         float[] b, int offset_b, int stride_b,
+                                                         float sa, float sha,
+                                                         float sb, float shb) {
+        CompletableFuture<float[]> future = new CompletableFuture<>();
+        vect_bbffffB_submit(fn, a, offset_a, stride_a, b, offset_b, stride_b, sa, sha, sb, shb, future);
+        return future;
+    }
+
+    private native void vect_bB_submit(int fn, float[] a, int offset_a, int stride_a,
+                                       CompletableFuture<float[]> future);
+
+    private native void vect_bfB_submit(int fn, float[] a, int offset_a, int stride_a, float sa,
+                                        CompletableFuture<float[]> future);
+
+    private native void vect_fbB_submit(int fn, float sa, float[] a, int offset_a, int stride_a,
+                                        CompletableFuture<float[]> future);
+
+    private native void vect_bbB_submit(int fn,
+                                        float[] a, int offset_a, int stride_a,
+                                        float[] b, int offset_b, int stride_b,
+                                        CompletableFuture<float[]> future);
+
+    private native void vect_bBB_submit(int fn,
+                                        float[] a, int offset_a, int stride_a,
+                                        float[] b, int offset_b, int stride_b,
+                                        CompletableFuture<float[]> future);
+
+    private native void vect_bffffB_submit(int fn,
+                                           float[] a, int offset_a, int stride_a,
+                                           float sa, float sha,
+                                           float sb, float shb,
+                                           CompletableFuture<float[]> future);
+
+    private native void vect_bbffffB_submit(int fn,
+                                            float[] a, int offset_a, int stride_a,
+                                            float[] b, int offset_b, int stride_b,
+                                            float sa, float sha,
+                                            float sb, float shb,
+                                            CompletableFuture<float[]> future);
+
+    // Tensors are vectors that stay in engine memory between calls. They are referred to by handle.
+    // Functions on tensors write into a result tensor, so chained operations only copy data
+    // at the ends, with upload and download.
+
+    public native long allocate(int length);
+
+    public native void release(long tensor);
+
+    public void upload(long tensor, float[] data) {
+        upload(tensor, data, 0);
+    }
+
+    // copies data into the tensor, starting at offset
+    public native void upload(long tensor, float[] data, int offset);
+
+    public native int tensorLength(long tensor);
+
+    public float[] download(long tensor) {
+        return download(tensor, 0, tensorLength(tensor));
+    }
+
+    // copies len elements of the tensor, starting at offset
+    public native float[] download(long tensor, int offset, int len);
+
+    // Runs a chain of elementwise vector functions on tensors as a single kernel, so that each
+    // element is read and written once. Nodes 0 to inputs.length - 1 are the input tensors, and
+    // each function adds the next node. Function i reads the nodes args[2 * i] and args[2 * i + 1]
+    // (the second is ignored for functions of one vector), and takes its scalars from
+    // scalars[4 * i] onwards. The last node is written to result. For example, exp(x) * y:
+    //   tensor_fused(new String[] {"vector_exp", "vector_mul"}, new int[] {0, -1, 2, 1},
+    //                new float[8], new long[] {x, y}, result);
+    public void tensor_fused(String[] fns, int[] args, float[] scalars, long[] inputs, long result) {
+        int[] ids = new int[fns.length];
+        for (int i = 0; i < fns.length; i++) {
+            ids[i] = function(fns[i]);
+        }
+        tensor_fused(ids, args, scalars, inputs, result);
+    }
+
+    public native void tensor_fused(int[] fns, int[] args, float[] scalars, long[] inputs, long result);
+
+    // Lazy graphs record functions on tensors without running them. Evaluating the graph only
+    // runs what its outputs depend on, fuses chains of elementwise functions, and keeps the
+    // intermediate values in temporary tensors that are reused. Nodes are referred to by index.
+    // For example, result = exp(x) * y:
+    //   long g = graph();
+    //   int m = graph_apply(g, "vector_mul",
+    //                       new int[] {graph_apply(g, "vector_exp", new int[] {graph_input(g, x)}, new float[0]),
+    //                                  graph_input(g, y)},
+    //                       new float[0]);
+    //   graph_output(g, m, result);
+    //   graph_evaluate(g);
+    // A graph can be evaluated again after its input tensors are updated.
+
+    public native long graph();
+
+    public native void graph_release(long graph);
+
+    public native int graph_input(long graph, long tensor);
+
+    // args holds the nodes the function reads, and scalars the scalars it takes, in dispatch order
+    public int graph_apply(long graph, String fn, int[] args, float[] scalars) {
+        return graph_apply(graph, function(fn), args, scalars);
+    }
+
+    public native int graph_apply(long graph, int fn, int[] args, float[] scalars);
+
+    // the second result of vector_sincos or vector_modf
+    public native int graph_second(long graph, int node);
+
+    public native void graph_output(long graph, int node, long tensor);
+
+    public native void graph_evaluate(long graph);
+
+    // removes all nodes and outputs, keeping the temporary tensors
+    public native void graph_clear(long graph);
+
+    // Batches queue up tensor functions, and run them all with a single submission.
+    // Results are only written once commitBatch returns. Functions on arrays cannot be
+    // called while a batch is open. A batch belongs to the thread that began it, so other
+    // threads can keep using the engine while it is open.
+    public native void beginBatch();
+
+    public native void commitBatch();
+
+    // Reproducible sums. While this is on, vector_sum, vector_asum, vector_dot and vector_nrm2
+    // give bitwise identical results from run to run, for any number of threads and on any device.
+    // This is slower, and is off by default.
+    public native void setReproducible(boolean on);
+
+    public native boolean isReproducible();
+
+    public void tensor_bB(String fn, long a, long result) {
+        tensor_bB(function(fn), a, result);
+    }
+
+    public void tensor_bB(int fn, long a, long result) {
+        tensor_bB(fn, a, 0, 1, result, 0, 1);
+    }
+
+    public void tensor_bfB(String fn, long a, float sa, long result) {
+        tensor_bfB(function(fn), a, sa, result);
+    }
+
+    public void tensor_bfB(int fn, long a, float sa, long result) {
+        tensor_bfB(fn, a, 0, 1, sa, result, 0, 1);
+    }
+
+    public void tensor_fbB(String fn, float sa, long a, long result) {
+        tensor_fbB(function(fn), sa, a, result);
+    }
+
+    public void tensor_fbB(int fn, float sa, long a, long result) {
+        tensor_fbB(fn, sa, a, 0, 1, result, 0, 1);
+    }
+
+    public void tensor_bbB(String fn, long a, long b, long result) {
+        tensor_bbB(function(fn), a, b, result);
+    }
+
+    public void tensor_bbB(int fn, long a, long b, long result) {
+        tensor_bbB(fn, a, 0, 1, b, 0, 1, result, 0, 1);
+    }
+
+    public void tensor_bBB(String fn, long a, long b, long result) {
+        tensor_bBB(function(fn), a, b, result);
+    }
+
+    public void tensor_bBB(int fn, long a, long b, long result) {
+        tensor_bBB(fn, a, 0, 1, b, 0, 1, result, 0, 1);
+    }
+
+    public void tensor_bffffB(String fn, long a, float sa, float sha, float sb, float shb, long result) {
+        tensor_bffffB(function(fn), a, sa, sha, sb, shb, result);
+    }
+
+    public void tensor_bffffB(int fn, long a, float sa, float sha, float sb, float shb, long result) {
+        tensor_bffffB(fn, a, 0, 1, sa, sha, sb, shb, result, 0, 1);
+    }
+
+    public void tensor_bbffffB(String fn, long a, long b, float sa, float sha, float sb, float shb, long result) {
+        tensor_bbffffB(function(fn), a, b, sa, sha, sb, shb, result);
+    }
+
+    public void tensor_bbffffB(int fn, long a, long b, float sa, float sha, float sb, float shb, long result) {
+        tensor_bbffffB(fn, a, 0, 1, b, 0, 1, sa, sha, sb, shb, result, 0, 1);
+    }
+
+    public void tensor_bB(String fn, long a, int offset_a, int stride_a,
+                          long result, int offset, int stride) {
+        tensor_bB(function(fn), a, offset_a, stride_a, result, offset, stride);
+    }
+
+    public native void tensor_bB(int fn, long a, int offset_a, int stride_a,
+                                 long result, int offset, int stride);
+
+    public void tensor_bfB(String fn, long a, int offset_a, int stride_a, float sa,
+                           long result, int offset, int stride) {
+        tensor_bfB(function(fn), a, offset_a, stride_a, sa, result, offset, stride);
+    }
+
+    public native void tensor_bfB(int fn, long a, int offset_a, int stride_a, float sa,
+                                  long result, int offset, int stride);
+
+    public void tensor_fbB(String fn, float sa, long a, int offset_a, int stride_a,
+                           long result, int offset, int stride) {
+        tensor_fbB(function(fn), sa, a, offset_a, stride_a, result, offset, stride);
+    }
+
+    public native void tensor_fbB(int fn, float sa, long a, int offset_a, int stride_a,
+                                  long result, int offset, int stride);
+
+    public void tensor_bbB(String fn,
+                           long a, int offset_a, int stride_a,
+                           long b, int offset_b, int stride_b,
+                           long result, int offset, int stride) {
+        tensor_bbB(function(fn), a, offset_a, stride_a, b, offset_b, stride_b, result, offset, stride);
+    }
+
+    public native void tensor_bbB(int fn,
+                                  long a, int offset_a, int stride_a,
+                                  long b, int offset_b, int stride_b,
+                                  long result, int offset, int stride);
+
+    public void tensor_bBB(String fn,
+                           long a, int offset_a, int stride_a,
+                           long b, int offset_b, int stride_b,
+                           long result, int offset, int stride) {
+        tensor_bBB(function(fn), a, offset_a, stride_a, b, offset_b, stride_b, result, offset, stride);
+    }
+
+    public native void tensor_bBB(int fn,
+                                  long a, int offset_a, int stride_a,
+                                  long b, int offset_b, int stride_b,
+                                  long result, int offset, int stride);
+
+    public void tensor_bffffB(String fn,
+                              long a, int offset_a, int stride_a,
+                              float sa, float sha,
+                              float sb, float shb,
+                              long result, int offset, int stride) {
+        tensor_bffffB(function(fn), a, offset_a, stride_a, sa, sha, sb, shb, result, offset, stride);
+    }
+
+    public native void tensor_bffffB(int fn,
+                                     long a, int offset_a, int stride_a,
+                                     float sa, float sha,
+                                     float sb, float shb,
+                                     long result, int offset, int stride);
+
+    public void tensor_bbffffB(String fn,
+                               long a, int offset_a, int stride_a,
+                               long b, int offset_b, int stride_b,
+                               float sa, float sha,
+                               float sb, float shb,
+                               long result, int offset, int stride) {
+        tensor_bbffffB(function(fn), a, offset_a, stride_a, b, offset_b, stride_b, sa, sha, sb, shb, result, offset, stride);
+    }
+
+    public native void tensor_bbffffB(int fn,
+                                      long a, int offset_a, int stride_a,
+                                      long b, int offset_b, int stride_b,
+                                      float sa, float sha,
+                                      float sb, float shb,
+                                      long result, int offset, int stride);
+
+    // c = alpha * op(a) * op(b) + beta * c on column major matrices in tensors, where op(a) is
+    // m x k and op(b) is k x n. op transposes its matrix when transA or transB is set, and the
+    // ld arguments are the leading dimensions. c is not read when beta is zero.
+    public native void tensor_gemm(boolean transA, boolean transB, int m, int n, int k,
+                                   float alpha,
+                                   long a, int offset_a, int ld_a,
+                                   long b, int offset_b, int ld_b,
+                                   float beta,
+                                   long c, int offset_c, int ld_c);
+
+    // y = alpha * op(a) * x + beta * y, where a is an m x n column major matrix, and op transposes it
+    // when trans is set. y is not read when beta is zero.
+    public native void tensor_mv(boolean trans, int m, int n, float alpha,
+                                 long a, int offset_a, int ld_a,
+                                 long x, int offset_x, int stride_x,
+                                 float beta,
+                                 long y, int offset_y, int stride_y);
+
+    // a = alpha * x * y^T + a, where a is an m x n column major matrix
+    public native void tensor_rk(int m, int n, float alpha,
+                                 long x, int offset_x, int stride_x,
+                                 long y, int offset_y, int stride_y,
+                                 long a, int offset_a, int ld_a);
+
+    // x = op(a) * x, or the solution of op(a) * x = b that replaces x, where a is an sd x sd
+    // triangle and op transposes it when trans is set. unit is 132 for a diagonal of ones that is
+    // not read, and bottom is positive for the lower triangle and negative for the upper one.
+    public native void tensor_trmv(boolean trans, int sd, int unit, int bottom,
+                                   long a, int offset_a, int ld_a,
+                                   long x, int offset_x, int stride_x);
+
+    public native void tensor_trsv(boolean trans, int sd, int unit, int bottom,
+                                   long a, int offset_a, int ld_a,
+                                   long x, int offset_x, int stride_x);
+
+    // b = alpha * op(a) * b, or b * op(a) when left is not set, where b is m x n and a is the
+    // triangle as in tensor_trmv. tensor_trsm replaces b with the solution x of
+    // op(a) * x = alpha * b, or of x * op(a) = alpha * b.
+    public native void tensor_trmm(boolean left, boolean trans, int unit, int bottom, int m, int n, float alpha,
+                                   long a, int offset_a, int ld_a,
+                                   long b, int offset_b, int ld_b);
+
+    public native void tensor_trsm(boolean left, boolean trans, int unit, int bottom, int m, int n, float alpha,
+                                   long a, int offset_a, int ld_a,
+                                   long b, int offset_b, int ld_b);
 }
@@ -0,0 +1,445 @@
+// This file is auto-generated
+
+package ferrum;
+
+import java.util.Arrays;
+
+// The IDs of the functions, for the int versions of the FerrumEngine functions
+public final class Functions {
+
+    public static final int UNKNOWN = -1;
+    public static final int ge_abs = 0;
+    public static final int ge_acos = 1;
+    public static final int ge_acosh = 2;
+    public static final int ge_add = 3;
+    public static final int ge_asin = 4;
+    public static final int ge_asinh = 5;
+    public static final int ge_atan = 6;
+    public static final int ge_atan2 = 7;
+    public static final int ge_atanh = 8;
+    public static final int ge_cbrt = 9;
+    public static final int ge_cdf_norm = 10;
+    public static final int ge_cdf_norm_inv = 11;
+    public static final int ge_ceil = 12;
+    public static final int ge_copysign = 13;
+    public static final int ge_cos = 14;
+    public static final int ge_cosh = 15;
+    public static final int ge_div = 16;
+    public static final int ge_elu = 17;
+    public static final int ge_erf = 18;
+    public static final int ge_erf_inv = 19;
+    public static final int ge_erfc = 20;
+    public static final int ge_erfcinv = 21;
+    public static final int ge_exp = 22;
+    public static final int ge_exp10 = 23;
+    public static final int ge_exp2 = 24;
+    public static final int ge_expm1 = 25;
+    public static final int ge_floor = 26;
+    public static final int ge_fmax = 27;
+    public static final int ge_fmin = 28;
+    public static final int ge_fmod = 29;
+    public static final int ge_frac = 30;
+    public static final int ge_frem = 31;
+    public static final int ge_gamma = 32;
+    public static final int ge_gemm = 33;
+    public static final int ge_hypot = 34;
+    public static final int ge_inv = 35;
+    public static final int ge_inv_cbrt = 36;
+    public static final int ge_inv_sqrt = 37;
+    public static final int ge_lgamma = 38;
+    public static final int ge_linear_frac = 39;
+    public static final int ge_log = 40;
+    public static final int ge_log10 = 41;
+    public static final int ge_log1p = 42;
+    public static final int ge_log2 = 43;
+    public static final int ge_modf = 44;
+    public static final int ge_mul = 45;
+    public static final int ge_mv = 46;
+    public static final int ge_pow = 47;
+    public static final int ge_pow2o3 = 48;
+    public static final int ge_pow3o2 = 49;
+    public static final int ge_powx = 50;
+    public static final int ge_ramp = 51;
+    public static final int ge_relu = 52;
+    public static final int ge_rk = 53;
+    public static final int ge_round = 54;
+    public static final int ge_scale_shift = 55;
+    public static final int ge_sigmoid = 56;
+    public static final int ge_sin = 57;
+    public static final int ge_sincos = 58;
+    public static final int ge_sinh = 59;
+    public static final int ge_sqr = 60;
+    public static final int ge_sqrt = 61;
+    public static final int ge_sub = 62;
+    public static final int ge_tan = 63;
+    public static final int ge_tanh = 64;
+    public static final int ge_trunc = 65;
+    public static final int uplo_abs = 66;
+    public static final int uplo_acos = 67;
+    public static final int uplo_acosh = 68;
+    public static final int uplo_add = 69;
+    public static final int uplo_asin = 70;
+    public static final int uplo_asinh = 71;
+    public static final int uplo_atan = 72;
+    public static final int uplo_atan2 = 73;
+    public static final int uplo_atanh = 74;
+    public static final int uplo_cbrt = 75;
+    public static final int uplo_cdf_norm = 76;
+    public static final int uplo_cdf_norm_inv = 77;
+    public static final int uplo_ceil = 78;
+    public static final int uplo_copy = 79;
+    public static final int uplo_copysign = 80;
+    public static final int uplo_cos = 81;
+    public static final int uplo_cosh = 82;
+    public static final int uplo_div = 83;
+    public static final int uplo_elu = 84;
+    public static final int uplo_erf = 85;
+    public static final int uplo_erf_inv = 86;
+    public static final int uplo_erfc = 87;
+    public static final int uplo_erfc_inv = 88;
+    public static final int uplo_exp = 89;
+    public static final int uplo_exp10 = 90;
+    public static final int uplo_exp2 = 91;
+    public static final int uplo_expm1 = 92;
+    public static final int uplo_floor = 93;
+    public static final int uplo_fmax = 94;
+    public static final int uplo_fmin = 95;
+    public static final int uplo_fmod = 96;
+    public static final int uplo_frac = 97;
+    public static final int uplo_frem = 98;
+    public static final int uplo_gamma = 99;
+    public static final int uplo_hypot = 100;
+    public static final int uplo_inv = 101;
+    public static final int uplo_inv_cbrt = 102;
+    public static final int uplo_inv_sqrt = 103;
+    public static final int uplo_lgamma = 104;
+    public static final int uplo_linear_frac = 105;
+    public static final int uplo_log = 106;
+    public static final int uplo_log10 = 107;
+    public static final int uplo_log1p = 108;
+    public static final int uplo_log2 = 109;
+    public static final int uplo_modf = 110;
+    public static final int uplo_mul = 111;
+    public static final int uplo_pow = 112;
+    public static final int uplo_pow2o3 = 113;
+    public static final int uplo_pow3o2 = 114;
+    public static final int uplo_powx = 115;
+    public static final int uplo_ramp = 116;
+    public static final int uplo_relu = 117;
+    public static final int uplo_round = 118;
+    public static final int uplo_scale_shift = 119;
+    public static final int uplo_sigmoid = 120;
+    public static final int uplo_sin = 121;
+    public static final int uplo_sincos = 122;
+    public static final int uplo_sinh = 123;
+    public static final int uplo_sqr = 124;
+    public static final int uplo_sqrt = 125;
+    public static final int uplo_sub = 126;
+    public static final int uplo_tan = 127;
+    public static final int uplo_tanh = 128;
+    public static final int uplo_trmm = 129;
+    public static final int uplo_trmv = 130;
+    public static final int uplo_trsm = 131;
+    public static final int uplo_trsv = 132;
+    public static final int uplo_trunc = 133;
+    public static final int vector_abs = 134;
+    public static final int vector_acos = 135;
+    public static final int vector_acosh = 136;
+    public static final int vector_add = 137;
+    public static final int vector_amax = 138;
+    public static final int vector_asin = 139;
+    public static final int vector_asinh = 140;
+    public static final int vector_asum = 141;
+    public static final int vector_atan = 142;
+    public static final int vector_atan2 = 143;
+    public static final int vector_atanh = 144;
+    public static final int vector_cbrt = 145;
+    public static final int vector_cdf_norm = 146;
+    public static final int vector_cdf_norm_inv = 147;
+    public static final int vector_ceil = 148;
+    public static final int vector_copy = 149;
+    public static final int vector_copysign = 150;
+    public static final int vector_cos = 151;
+    public static final int vector_cosh = 152;
+    public static final int vector_div = 153;
+    public static final int vector_dot = 154;
+    public static final int vector_elu = 155;
+    public static final int vector_equals = 156;
+    public static final int vector_erf = 157;
+    public static final int vector_erf_inv = 158;
+    public static final int vector_erfc = 159;
+    public static final int vector_erfc_inv = 160;
+    public static final int vector_exp = 161;
+    public static final int vector_exp10 = 162;
+    public static final int vector_exp2 = 163;
+    public static final int vector_expm1 = 164;
+    public static final int vector_floor = 165;
+    public static final int vector_fmax = 166;
+    public static final int vector_fmin = 167;
+    public static final int vector_fmod = 168;
+    public static final int vector_frac = 169;
+    public static final int vector_frem = 170;
+    public static final int vector_gamma = 171;
+    public static final int vector_hypot = 172;
+    public static final int vector_iamax = 173;
+    public static final int vector_inv = 174;
+    public static final int vector_inv_cbrt = 175;
+    public static final int vector_inv_sqrt = 176;
+    public static final int vector_lgamma = 177;
+    public static final int vector_linear_frac = 178;
+    public static final int vector_log = 179;
+    public static final int vector_log10 = 180;
+    public static final int vector_log1p = 181;
+    public static final int vector_log2 = 182;
+    public static final int vector_max = 183;
+    public static final int vector_min = 184;
+    public static final int vector_modf = 185;
+    public static final int vector_mul = 186;
+    public static final int vector_nrm2 = 187;
+    public static final int vector_pow = 188;
+    public static final int vector_pow2o3 = 189;
+    public static final int vector_pow3o2 = 190;
+    public static final int vector_powx = 191;
+    public static final int vector_ramp = 192;
+    public static final int vector_relu = 193;
+    public static final int vector_round = 194;
+    public static final int vector_scale_shift = 195;
+    public static final int vector_set = 196;
+    public static final int vector_sigmoid = 197;
+    public static final int vector_sin = 198;
+    public static final int vector_sincos = 199;
+    public static final int vector_sinh = 200;
+    public static final int vector_sqr = 201;
+    public static final int vector_sqrt = 202;
+    public static final int vector_sub = 203;
+    public static final int vector_sum = 204;
+    public static final int vector_swap = 205;
+    public static final int vector_tan = 206;
+    public static final int vector_tanh = 207;
+    public static final int vector_trunc = 208;
+
+    // sorted, so the ID of a function is the index of its name
+    private static final String[] NAMES = {
+        "ge_abs",
+        "ge_acos",
+        "ge_acosh",
+        "ge_add",
+        "ge_asin",
+        "ge_asinh",
+        "ge_atan",
+        "ge_atan2",
+        "ge_atanh",
+        "ge_cbrt",
+        "ge_cdf_norm",
+        "ge_cdf_norm_inv",
+        "ge_ceil",
+        "ge_copysign",
+        "ge_cos",
+        "ge_cosh",
+        "ge_div",
+        "ge_elu",
+        "ge_erf",
+        "ge_erf_inv",
+        "ge_erfc",
+        "ge_erfcinv",
+        "ge_exp",
+        "ge_exp10",
+        "ge_exp2",
+        "ge_expm1",
+        "ge_floor",
+        "ge_fmax",
+        "ge_fmin",
+        "ge_fmod",
+        "ge_frac",
+        "ge_frem",
+        "ge_gamma",
+        "ge_gemm",
+        "ge_hypot",
+        "ge_inv",
+        "ge_inv_cbrt",
+        "ge_inv_sqrt",
+        "ge_lgamma",
+        "ge_linear_frac",
+        "ge_log",
+        "ge_log10",
+        "ge_log1p",
+        "ge_log2",
+        "ge_modf",
+        "ge_mul",
+        "ge_mv",
+        "ge_pow",
+        "ge_pow2o3",
+        "ge_pow3o2",
+        "ge_powx",
+        "ge_ramp",
+        "ge_relu",
+        "ge_rk",
+        "ge_round",
+        "ge_scale_shift",
+        "ge_sigmoid",
+        "ge_sin",
+        "ge_sincos",
+        "ge_sinh",
+        "ge_sqr",
+        "ge_sqrt",
+        "ge_sub",
+        "ge_tan",
+        "ge_tanh",
+        "ge_trunc",
+        "uplo_abs",
+        "uplo_acos",
+        "uplo_acosh",
+        "uplo_add",
+        "uplo_asin",
+        "uplo_asinh",
+        "uplo_atan",
+        "uplo_atan2",
+        "uplo_atanh",
+        "uplo_cbrt",
+        "uplo_cdf_norm",
+        "uplo_cdf_norm_inv",
+        "uplo_ceil",
+        "uplo_copy",
+        "uplo_copysign",
+        "uplo_cos",
+        "uplo_cosh",
+        "uplo_div",
+        "uplo_elu",
+        "uplo_erf",
+        "uplo_erf_inv",
+        "uplo_erfc",
+        "uplo_erfc_inv",
+        "uplo_exp",
+        "uplo_exp10",
+        "uplo_exp2",
+        "uplo_expm1",
+        "uplo_floor",
+        "uplo_fmax",
+        "uplo_fmin",
+        "uplo_fmod",
+        "uplo_frac",
+        "uplo_frem",
+        "uplo_gamma",
+        "uplo_hypot",
+        "uplo_inv",
+        "uplo_inv_cbrt",
+        "uplo_inv_sqrt",
+        "uplo_lgamma",
+        "uplo_linear_frac",
+        "uplo_log",
+        "uplo_log10",
+        "uplo_log1p",
+        "uplo_log2",
+        "uplo_modf",
+        "uplo_mul",
+        "uplo_pow",
+        "uplo_pow2o3",
+        "uplo_pow3o2",
+        "uplo_powx",
+        "uplo_ramp",
+        "uplo_relu",
+        "uplo_round",
+        "uplo_scale_shift",
+        "uplo_sigmoid",
+        "uplo_sin",
+        "uplo_sincos",
+        "uplo_sinh",
+        "uplo_sqr",
+        "uplo_sqrt",
+        "uplo_sub",
+        "uplo_tan",
+        "uplo_tanh",
+        "uplo_trmm",
+        "uplo_trmv",
+        "uplo_trsm",
+        "uplo_trsv",
+        "uplo_trunc",
+        "vector_abs",
+        "vector_acos",
+        "vector_acosh",
+        "vector_add",
+        "vector_amax",
+        "vector_asin",
+        "vector_asinh",
+        "vector_asum",
+        "vector_atan",
+        "vector_atan2",
+        "vector_atanh",
+        "vector_cbrt",
+        "vector_cdf_norm",
+        "vector_cdf_norm_inv",
+        "vector_ceil",
+        "vector_copy",
+        "vector_copysign",
+        "vector_cos",
+        "vector_cosh",
+        "vector_div",
+        "vector_dot",
+        "vector_elu",
+        "vector_equals",
+        "vector_erf",
+        "vector_erf_inv",
+        "vector_erfc",
+        "vector_erfc_inv",
+        "vector_exp",
+        "vector_exp10",
+        "vector_exp2",
+        "vector_expm1",
+        "vector_floor",
+        "vector_fmax",
+        "vector_fmin",
+        "vector_fmod",
+        "vector_frac",
+        "vector_frem",
+        "vector_gamma",
+        "vector_hypot",
+        "vector_iamax",
+        "vector_inv",
+        "vector_inv_cbrt",
+        "vector_inv_sqrt",
+        "vector_lgamma",
+        "vector_linear_frac",
+        "vector_log",
+        "vector_log10",
+        "vector_log1p",
+        "vector_log2",
+        "vector_max",
+        "vector_min",
+        "vector_modf",
+        "vector_mul",
+        "vector_nrm2",
+        "vector_pow",
+        "vector_pow2o3",
+        "vector_pow3o2",
+        "vector_powx",
+        "vector_ramp",
+        "vector_relu",
+        "vector_round",
+        "vector_scale_shift",
+        "vector_set",
+        "vector_sigmoid",
+        "vector_sin",
+        "vector_sincos",
+        "vector_sinh",
+        "vector_sqr",
+        "vector_sqrt",
+        "vector_sub",
+        "vector_sum",
+        "vector_swap",
+        "vector_tan",
+        "vector_tanh",
+        "vector_trunc",
+    };
+
+    private Functions() {}
+
+    // The ID of a function, or UNKNOWN
+    public static int id(String name) {
+        int index = Arrays.binarySearch(NAMES, name);
+        return index >= 0 ? index : UNKNOWN;
+    }
+
+    public static String name(int id) {
+        return NAMES[id];
+    }
+}
@@ -0,0 +1,97 @@
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include "backend.hpp"
+#include "cpu_engine.hpp"
+#include "recording_engine.hpp"
+#ifdef __APPLE__
+#include "engine.hpp"
+#endif
+
+namespace {
+
+  const char* BACKENDS[] = {"metal", "cpu", "recording"};
+
+  // Splits a spec into its backend and argument, if it starts with a known backend name.
+  // Returns false if there is no backend prefix.
+  bool splitSpec(const char* spec, std::string& backend, const char*& argument) {
+    for (const char* name : BACKENDS) {
+      size_t length = strlen(name);
+      if (strncmp(spec, name, length) == 0 && (spec[length] == ':' || spec[length] == '\0')) {
+        backend = name;
+        argument = (spec[length] == ':' && spec[length + 1] != '\0') ? spec + length + 1 : nullptr;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  Ferrum::Engine* createCpuEngine(const char* threads) {
+    int count = -1;
+    if (threads != nullptr) {
+      char* end;
+      count = static_cast<int>(strtol(threads, &end, 10));
+      if (*end != '\0') {
+        std::cerr << "Error: Invalid thread count for the CPU engine: " << threads << std::endl;
+        return nullptr;
+      }
+    }
+    DBG("Creating CPU engine");
+    return new Ferrum::CpuEngine(count);
+  }
+
+  Ferrum::Engine* createMetalEngine(const char* path, bool fallback) {
+#ifdef __APPLE__
+    DBG("Creating Metal engine");
+    Ferrum::MetalEngine* engine = new Ferrum::MetalEngine(path);
+    if (engine->ready()) {
+      return engine;
+    }
+    delete engine;
+#endif
+    if (!fallback) {
+      std::cerr << "Error: Failed to start the Metal engine" << std::endl;
+      return nullptr;
+    }
+    std::cerr << "Metal is unavailable. Using the CPU engine" << std::endl;
+    return createCpuEngine(nullptr);
+  }
+
+} // namespace
+
+
+Ferrum::Engine* Ferrum::createEngine(const char* spec) {
+  std::string backend;
+  const char* argument = spec;
+  if (spec == nullptr || !splitSpec(spec, backend, argument)) {
+    // spec is a library path, or empty
+    const char* envBackend = std::getenv(FERRUM_BACKEND);
+    if (envBackend == nullptr || *envBackend == '\0') {
+      return createMetalEngine(spec, true);
+    }
+    DBG("Backend from environment: ", envBackend);
+    if (!splitSpec(envBackend, backend, argument)) {
+      std::cerr << "Error: Unknown backend: " << envBackend << std::endl;
+      return nullptr;
+    }
+    // the library path only applies to Metal
+    if (backend == "metal" && argument == nullptr) {
+      argument = spec;
+    }
+  }
+  DBG("Selected backend: ", backend);
+
+  if (backend == "metal") {
+    return createMetalEngine(argument, false);
+  } else if (backend == "cpu") {
+    return createCpuEngine(argument);
+  }
+  // recording
+  if (argument == nullptr) {
+    return new RecordingEngine();
+  }
+  Engine* delegate = createEngine(argument);
+  return (delegate == nullptr) ? nullptr : new RecordingEngine(delegate);
+}
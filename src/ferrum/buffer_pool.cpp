@@ -0,0 +1,187 @@
+#include <cstdlib>
+#include <iostream>
+#include <unordered_map>
+
+#include "buffer_pool.hpp"
+#include "debug.hpp"
+
+namespace {
+
+  int sizeClass(size_t size) {
+    int c = 0;
+    while ((Ferrum::BufferPool::MIN_BLOCK << c) < size) {
+      c++;
+    }
+    return c;
+  }
+
+  // the allocations from newHostMemory, with their sizes in bytes
+  std::mutex hostMemoryLock;
+  std::unordered_map<const float*, size_t> hostMemory;
+
+} // namespace
+
+
+Ferrum::Block Ferrum::HostAllocator::allocate(size_t size) {
+  // page aligned, in the same way as Metal shared buffers
+  void* memory = std::aligned_alloc(4096, (size + 4095) / 4096 * 4096);
+  return Block{memory, memory, size};
+}
+
+void Ferrum::HostAllocator::release(const Block& block) {
+  std::free(block.handle);
+}
+
+
+float* Ferrum::newHostMemory(int length) {
+  size_t size = sizeof(float) * (length > 0 ? length : 0);
+  size = (size == 0) ? HOST_PAGE : (size + HOST_PAGE - 1) / HOST_PAGE * HOST_PAGE;
+  float* data = static_cast<float*>(std::aligned_alloc(HOST_PAGE, size));
+  if (data == nullptr) {
+    std::cerr << "Error: Failed to allocate " << size << " bytes of host memory" << std::endl;
+    return nullptr;
+  }
+  std::lock_guard<std::mutex> guard(hostMemoryLock);
+  hostMemory[data] = size;
+  return data;
+}
+
+void Ferrum::releaseHostMemory(float* data) {
+  if (data == nullptr) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> guard(hostMemoryLock);
+    if (hostMemory.erase(data) == 0) {
+      std::cerr << "Error: Released memory that is not host memory" << std::endl;
+      return;
+    }
+  }
+  std::free(data);
+}
+
+size_t Ferrum::hostMemorySize(const float* data) {
+  std::lock_guard<std::mutex> guard(hostMemoryLock);
+  auto it = hostMemory.find(data);
+  return (it == hostMemory.end()) ? 0 : it->second;
+}
+
+
+Ferrum::BufferPool::BufferPool(BlockAllocator* allocator, size_t limit, std::chrono::milliseconds idleTime) :
+    allocator(allocator), limit(limit), idleTime(idleTime),
+    freeTotal(0), usedTotal(0), peak(0), lastUsed(std::chrono::steady_clock::now()), stopping(false) {
+  if (idleTime.count() > 0) {
+    reaper = std::thread([this]() { reaperLoop(); });
+  }
+}
+
+Ferrum::BufferPool::~BufferPool() {
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    stopping = true;
+  }
+  reaperWake.notify_all();
+  if (reaper.joinable()) {
+    reaper.join();
+  }
+  trim();
+}
+
+size_t Ferrum::BufferPool::blockSize(size_t size) {
+  return MIN_BLOCK << sizeClass(size);
+}
+
+Ferrum::Block Ferrum::BufferPool::acquire(size_t size) {
+  int c = sizeClass(size);
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    lastUsed = std::chrono::steady_clock::now();
+    if (c < (int)freeBlocks.size() && !freeBlocks[c].empty()) {
+      Block block = freeBlocks[c].back();
+      freeBlocks[c].pop_back();
+      freeTotal -= block.size;
+      usedTotal += block.size;
+      return block;
+    }
+  }
+  // allocate outside of the lock, as this can be slow
+  Block block = allocator->allocate(MIN_BLOCK << c);
+  if (block.handle == nullptr) {
+    return block;
+  }
+  std::lock_guard<std::mutex> guard(lock);
+  usedTotal += block.size;
+  if (usedTotal + freeTotal > peak) {
+    peak = usedTotal + freeTotal;
+  }
+  return block;
+}
+
+void Ferrum::BufferPool::recycle(const Block& block) {
+  if (block.handle == nullptr) {
+    return;
+  }
+  int c = sizeClass(block.size);
+  std::unique_lock<std::mutex> guard(lock);
+  lastUsed = std::chrono::steady_clock::now();
+  usedTotal -= block.size;
+  if (freeTotal + block.size > limit) {
+    guard.unlock();
+    allocator->release(block);
+    return;
+  }
+  if (c >= (int)freeBlocks.size()) {
+    freeBlocks.resize(c + 1);
+  }
+  freeBlocks[c].push_back(block);
+  freeTotal += block.size;
+}
+
+void Ferrum::BufferPool::trim() {
+  trimTo(0);
+}
+
+void Ferrum::BufferPool::trimTo(size_t target) {
+  std::vector<Block> released;
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    for (int c = (int)freeBlocks.size() - 1; c >= 0 && freeTotal > target; c--) {
+      while (!freeBlocks[c].empty() && freeTotal > target) {
+        released.push_back(freeBlocks[c].back());
+        freeBlocks[c].pop_back();
+        freeTotal -= released.back().size;
+      }
+    }
+  }
+  DBG("Releasing ", released.size(), " free blocks");
+  for (const Block& block : released) {
+    allocator->release(block);
+  }
+}
+
+void Ferrum::BufferPool::reaperLoop() {
+  std::unique_lock<std::mutex> guard(lock);
+  while (!stopping) {
+    reaperWake.wait_for(guard, idleTime);
+    if (!stopping && freeTotal > 0 && std::chrono::steady_clock::now() - lastUsed >= idleTime) {
+      guard.unlock();
+      trim();
+      guard.lock();
+    }
+  }
+}
+
+size_t Ferrum::BufferPool::freeBytes() {
+  std::lock_guard<std::mutex> guard(lock);
+  return freeTotal;
+}
+
+size_t Ferrum::BufferPool::usedBytes() {
+  std::lock_guard<std::mutex> guard(lock);
+  return usedTotal;
+}
+
+size_t Ferrum::BufferPool::highWaterMark() {
+  std::lock_guard<std::mutex> guard(lock);
+  return peak;
+}
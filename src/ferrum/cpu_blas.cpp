@@ -0,0 +1,201 @@
+#include <algorithm>
+#include <vector>
+
+#include "cpu_blas.hpp"
+#include "cpu_gemm.hpp"
+#include "dispatch_plan.hpp"
+#include "thread_pool.hpp"
+
+namespace {
+
+  using Ferrum::CpuGemv;
+  using Ferrum::CpuTriangular;
+  using Ferrum::CpuView;
+
+  // Minimum number of matrix elements handed to a thread, as for the elementwise kernels
+  const size_t GRAIN = 1 << 14;
+
+  // y = alpha * sum + beta * y for count elements of y, starting at element first.
+  // y is not read when beta is zero.
+  void finish(const CpuGemv& g, ptrdiff_t first, ptrdiff_t count, const float* sum) {
+    float* y = g.y + first * g.incy;
+    for (ptrdiff_t i = 0; i < count; i++) {
+      float value = g.alpha * sum[i];
+      y[i * g.incy] = (g.beta == 0.0f) ? value : value + g.beta * y[i * g.incy];
+    }
+  }
+
+  // x with unit stride, copied into packed if it needs to be
+  const float* contiguous(const float* x, ptrdiff_t n, ptrdiff_t inc, std::vector<float>& packed) {
+    if (inc == 1) {
+      return x;
+    }
+    packed.resize(n);
+    for (ptrdiff_t i = 0; i < n; i++) {
+      packed[i] = x[i * inc];
+    }
+    return packed.data();
+  }
+
+  // Columns [begin, end) of b = alpha * t * b, for the first size rows of the views.
+  // Going up a lower triangle, or down an upper one, leaves the rows that are still to be read.
+  void multiplyBlock(const CpuTriangular& t, CpuView a, CpuView b, ptrdiff_t size, float alpha,
+                     ptrdiff_t begin, ptrdiff_t end) {
+    for (ptrdiff_t j = begin; j < end; j++) {
+      for (ptrdiff_t s = 0; s < size; s++) {
+        ptrdiff_t i = t.lower ? size - 1 - s : s;
+        float sum = t.unit ? b.at(i, j) : a.at(i, i) * b.at(i, j);
+        ptrdiff_t first = t.lower ? 0 : i + 1;
+        ptrdiff_t last = t.lower ? i : size;
+        for (ptrdiff_t p = first; p < last; p++) {
+          sum += a.at(i, p) * b.at(p, j);
+        }
+        b.at(i, j) = alpha * sum;
+      }
+    }
+  }
+
+  // Columns [begin, end) of the solution of t * x = alpha * b, by substitution down a lower
+  // triangle or up an upper one
+  void solveBlock(const CpuTriangular& t, CpuView a, CpuView b, ptrdiff_t size, float alpha,
+                  ptrdiff_t begin, ptrdiff_t end) {
+    for (ptrdiff_t j = begin; j < end; j++) {
+      for (ptrdiff_t s = 0; s < size; s++) {
+        ptrdiff_t i = t.lower ? s : size - 1 - s;
+        float sum = alpha * b.at(i, j);
+        ptrdiff_t first = t.lower ? 0 : i + 1;
+        ptrdiff_t last = t.lower ? i : size;
+        for (ptrdiff_t p = first; p < last; p++) {
+          sum -= a.at(i, p) * b.at(p, j);
+        }
+        b.at(i, j) = t.unit ? sum : sum / a.at(i, i);
+      }
+    }
+  }
+
+  // c = alpha * a * b + beta * c, where c is rows x cols and a is rows x depth
+  void update(Ferrum::ThreadPool& pool, const Ferrum::CpuGemmKernel& gemm, const Ferrum::CpuLevel2Kernel& level2,
+              ptrdiff_t rows, ptrdiff_t cols, ptrdiff_t depth, float alpha,
+              CpuView a, CpuView b, float beta, CpuView c) {
+    if (cols == 1) {
+      // a column has the stride ld when its view is transposed
+      ptrdiff_t incb = b.trans ? b.ld : 1;
+      ptrdiff_t incc = c.trans ? c.ld : 1;
+      CpuGemv g = a.trans ? CpuGemv{depth, rows, true, alpha, beta, a.data, a.ld, b.data, incb, c.data, incc}
+                          : CpuGemv{rows, depth, false, alpha, beta, a.data, a.ld, b.data, incb, c.data, incc};
+      Ferrum::runGemv(pool, level2, g);
+      return;
+    }
+    // a transposed c is found as c^T = b^T * a^T
+    Ferrum::CpuGemm g = c.trans ? Ferrum::CpuGemm{cols, rows, depth, !b.trans, !a.trans, alpha, beta,
+                                                  b.data, b.ld, a.data, a.ld, c.data, c.ld}
+                                : Ferrum::CpuGemm{rows, cols, depth, a.trans, b.trans, alpha, beta,
+                                                  a.data, a.ld, b.data, b.ld, c.data, c.ld};
+    Ferrum::runGemm(pool, gemm, g);
+  }
+
+} // namespace
+
+
+void Ferrum::runGemv(ThreadPool& pool, const CpuLevel2Kernel& kernel, const CpuGemv& g) {
+  ptrdiff_t count = g.trans ? g.n : g.m;
+  ptrdiff_t depth = g.trans ? g.m : g.n;
+  if (count <= 0) {
+    return;
+  }
+  if (depth <= 0 || g.alpha == 0.0f) {
+    std::vector<float> zeros(count, 0.0f);
+    finish(g, 0, count, zeros.data());
+    return;
+  }
+
+  if (!g.trans) {
+    // each block of rows of y stays in the L1 cache while every column is added to it
+    pool.parallelFor(count, columnGrain(depth, GRAIN), [&](size_t begin, size_t end) {
+      float sum[GEMV_ROWS];
+      for (size_t row = begin; row < end; row += GEMV_ROWS) {
+        ptrdiff_t rows = std::min(GEMV_ROWS, end - row);
+        std::fill(sum, sum + rows, 0.0f);
+        kernel.columns(rows, g.n, g.a + row, g.lda, g.x, g.incx, sum);
+        finish(g, row, rows, sum);
+      }
+    });
+    return;
+  }
+
+  // every column is multiplied by all of x
+  std::vector<float> packed;
+  const float* x = contiguous(g.x, g.m, g.incx, packed);
+  pool.parallelFor(count, columnGrain(depth, GRAIN), [&](size_t begin, size_t end) {
+    float sum[GEMV_COLUMNS];
+    for (size_t col = begin; col < end; col += GEMV_COLUMNS) {
+      ptrdiff_t cols = std::min(GEMV_COLUMNS, end - col);
+      kernel.dots(g.m, cols, g.a + col * g.lda, g.lda, x, sum);
+      finish(g, col, cols, sum);
+    }
+  });
+}
+
+
+void Ferrum::runRank1(ThreadPool& pool, const CpuLevel2Kernel& kernel, const CpuRank1& r) {
+  if (r.m <= 0 || r.n <= 0 || r.alpha == 0.0f) {
+    return;
+  }
+  std::vector<float> packed;
+  const float* x = contiguous(r.x, r.m, r.incx, packed);
+  pool.parallelFor(r.n, columnGrain(r.m, GRAIN), [&](size_t begin, size_t end) {
+    kernel.rank1(r.m, end - begin, r.alpha, x, r.y + begin * r.incy, r.incy, r.a + begin * r.lda, r.lda);
+  });
+}
+
+
+void Ferrum::runTriangular(ThreadPool& pool, const CpuGemmKernel& gemm, const CpuLevel2Kernel& level2,
+                           const CpuTriangular& t) {
+  if (t.sd <= 0 || t.n <= 0) {
+    return;
+  }
+  if (t.alpha == 0.0f) {
+    for (ptrdiff_t j = 0; j < t.n; j++) {
+      for (ptrdiff_t i = 0; i < t.sd; i++) {
+        t.b.at(i, j) = 0.0f;
+      }
+    }
+    return;
+  }
+  const ptrdiff_t block = TRIANGULAR_BLOCK;
+  ptrdiff_t blocks = (t.sd + block - 1) / block;
+  // solving a lower triangle, or multiplying by an upper one, works down from the first block
+  bool down = t.solve == t.lower;
+
+  for (ptrdiff_t s = 0; s < blocks; s++) {
+    ptrdiff_t k = (down ? s : blocks - 1 - s) * block;
+    ptrdiff_t size = std::min(block, t.sd - k);
+    CpuView diagonal = t.a.from(k, k);
+    CpuView rows = t.b.from(k, 0);
+    size_t grain = columnGrain(size * size / 2, GRAIN);
+
+    if (t.solve) {
+      // alpha is applied to each row the first time that it is written
+      float alpha = (s == 0) ? t.alpha : 1.0f;
+      pool.parallelFor(t.n, grain, [&](size_t begin, size_t end) {
+        solveBlock(t, diagonal, rows, size, alpha, begin, end);
+      });
+      // the rows that are still to be solved subtract this block's part of their sums
+      ptrdiff_t first = t.lower ? k + size : 0;
+      ptrdiff_t count = t.lower ? t.sd - first : k;
+      if (count > 0) {
+        update(pool, gemm, level2, count, t.n, size, -1.0f, t.a.from(first, k), rows, alpha, t.b.from(first, 0));
+      }
+    } else {
+      pool.parallelFor(t.n, grain, [&](size_t begin, size_t end) {
+        multiplyBlock(t, diagonal, rows, size, t.alpha, begin, end);
+      });
+      // add the part of the sums from the rows that have not been written yet
+      ptrdiff_t first = t.lower ? 0 : k + size;
+      ptrdiff_t count = t.lower ? k : t.sd - first;
+      if (count > 0) {
+        update(pool, gemm, level2, size, t.n, count, t.alpha, t.a.from(k, first), t.b.from(first, 0), 1.0f, rows);
+      }
+    }
+  }
+}
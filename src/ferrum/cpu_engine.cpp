@@ -0,0 +1,1895 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+
+#include "cpu_engine.hpp"
+#include "cpu_features.hpp"
+#include "cpu_math.hpp"
+#include "dispatch_plan.hpp"
+#include "fusion.hpp"
+#include "thread_pool.hpp"
+
+namespace {
+
+  using Ferrum::CpuKernel;
+  using Ferrum::CpuKernelOf;
+  using Ferrum::CpuPartial;
+  using Ferrum::CpuReducer;
+  using Ferrum::CpuReducerOf;
+  using Ferrum::CpuRun;
+  using Ferrum::CpuRunOf;
+  using Ferrum::Signature;
+  namespace CpuMath = Ferrum::CpuMath;
+
+  // Minimum number of elements handed to a thread. Below this the cost of waking
+  // a worker is larger than the work itself.
+  const size_t GRAIN = 1 << 14;
+
+  // Elements of a fused expression evaluated together. The intermediate values of a block
+  // stay in cache between kernels.
+  const ptrdiff_t FUSED_BLOCK = 256;
+
+  // Elements of a half precision run that are converted together, into float buffers on the stack
+  const ptrdiff_t HALF_BLOCK = 256;
+
+  // Elements reduced to each partial result. This is fixed, rather than split by thread,
+  // so that the result is the same for any number of threads.
+  const ptrdiff_t REDUCE_BLOCK = GRAIN;
+  const int REDUCE_LANES = 8;
+
+  // The element operations, named after the kernels in vect-math.metal and number.metal.
+  // T is float, or double for the double precision functions.
+  namespace Ops {
+    // Double precision has no shader results to match, so it uses libm where there is a function for
+    // the approximation in cpu_math.hpp
+    template <typename T> constexpr bool precise = std::is_same_v<T, double>;
+
+    template <typename T> inline T copy(T x) { return x; }
+    template <typename T> inline T sqr(T x) { return x * x; }
+    template <typename T> inline T inv(T x) { return 1 / x; }
+    template <typename T> inline T abs(T x) { return std::fabs(x); }
+    template <typename T> inline T sqrt(T x) { return std::sqrt(x); }
+    template <typename T> inline T inv_sqrt(T x) { return 1 / std::sqrt(x); }
+    template <typename T> inline T cbrt(T x) { return std::pow(x, CpuMath::REAL1o3<T>); }
+    template <typename T> inline T inv_cbrt(T x) { return 1 / std::pow(x, CpuMath::REAL1o3<T>); }
+    template <typename T> inline T pow2o3(T x) { return std::pow(x, CpuMath::REAL2o3<T>); }
+    template <typename T> inline T pow3o2(T x) { return std::pow(x, CpuMath::REAL3o2<T>); }
+    template <typename T> inline T exp(T x) { return std::exp(x); }
+    template <typename T> inline T exp2(T x) { return std::exp2(x); }
+    template <typename T> inline T exp10(T x) { return std::pow((T)10, x); }
+    template <typename T> inline T expm1(T x) { return precise<T> ? std::expm1(x) : CpuMath::expm1(x); }
+    template <typename T> inline T log(T x) { return std::log(x); }
+    template <typename T> inline T log2(T x) { return std::log2(x); }
+    template <typename T> inline T log10(T x) { return std::log10(x); }
+    template <typename T> inline T log1p(T x) { return precise<T> ? std::log1p(x) : CpuMath::log1p(x); }
+    template <typename T> inline T sin(T x) { return std::sin(x); }
+    template <typename T> inline T cos(T x) { return std::cos(x); }
+    template <typename T> inline T tan(T x) { return std::tan(x); }
+    template <typename T> inline T asin(T x) { return std::asin(x); }
+    template <typename T> inline T acos(T x) { return std::acos(x); }
+    template <typename T> inline T atan(T x) { return std::atan(x); }
+    template <typename T> inline T sinh(T x) { return std::sinh(x); }
+    template <typename T> inline T cosh(T x) { return std::cosh(x); }
+    template <typename T> inline T tanh(T x) { return std::tanh(x); }
+    template <typename T> inline T asinh(T x) { return std::asinh(x); }
+    template <typename T> inline T acosh(T x) { return std::acosh(x); }
+    template <typename T> inline T atanh(T x) { return std::atanh(x); }
+    template <typename T> inline T erf(T x) { return precise<T> ? std::erf(x) : CpuMath::erf(x); }
+    template <typename T> inline T erf_inv(T x) { return CpuMath::erfinv(x); }
+    template <typename T> inline T erfc(T x) { return precise<T> ? std::erfc(x) : CpuMath::erfc(x); }
+    template <typename T> inline T erfc_inv(T x) { return CpuMath::erfcinv(x); }
+    template <typename T> inline T cdf_norm(T x) { return precise<T> ? std::erfc(-x / std::sqrt((T)2)) / 2 : CpuMath::normcdf(x); }
+    template <typename T> inline T cdf_norm_inv(T x) { return CpuMath::normcdfinv(x); }
+    template <typename T> inline T gamma(T x) { return precise<T> ? std::tgamma(x) : CpuMath::tgamma(x); }
+    template <typename T> inline T lgamma(T x) { return precise<T> ? std::lgamma(x) : CpuMath::lgamma(x); }
+    template <typename T> inline T floor(T x) { return std::floor(x); }
+    template <typename T> inline T ceil(T x) { return std::ceil(x); }
+    template <typename T> inline T trunc(T x) { return std::trunc(x); }
+    template <typename T> inline T round(T x) { return std::round(x); }
+    template <typename T> inline T frac(T x) { return x - std::trunc(x); }
+    template <typename T> inline T sigmoid(T x) { return std::tanh((T)0.5 * x) * (T)0.5 + (T)0.5; }
+    template <typename T> inline T ramp(T x) { return std::fmax(x, (T)0); }
+
+    template <typename T> inline T mul(T x, T y) { return x * y; }
+    template <typename T> inline T div(T x, T y) { return x / y; }
+    template <typename T> inline T add(T x, T y) { return x + y; }
+    template <typename T> inline T sub(T x, T y) { return x - y; }
+    template <typename T> inline T fmod(T x, T y) { return std::fmod(x, y); }
+    template <typename T> inline T frem(T x, T y) { return CpuMath::remainder(x, y); }
+    template <typename T> inline T pow(T x, T y) { return std::pow(x, y); }
+    template <typename T> inline T hypot(T x, T y) { return precise<T> ? std::hypot(x, y) : CpuMath::hypot(x, y); }
+    template <typename T> inline T atan2(T x, T y) { return std::atan2(x, y); }
+    template <typename T> inline T fmax(T x, T y) { return std::fmax(x, y); }
+    template <typename T> inline T fmin(T x, T y) { return std::fmin(x, y); }
+    template <typename T> inline T copysign(T x, T y) { return std::copysign(x, y); }
+
+    // operations on an element and a scalar parameter
+    template <typename T> inline T powx(T x, T b) { return std::pow(x, b); }
+    template <typename T> inline T relu(T x, T alpha) { return std::fmax(x, alpha * x); }
+    template <typename T> inline T elu(T x, T alpha) { return std::fmax(x, alpha * expm1(x)); }
+    template <typename T> inline T set(T, T val) { return val; }
+
+    // operations with two results: the first goes to the in/out buffer, the second to the result
+    template <typename T> inline void sincos(T x, T& y, T& z) { y = std::sin(x); z = std::cos(x); }
+    template <typename T> inline void modf(T x, T& y, T& z) { y = std::trunc(x); z = x - y; }
+
+    // the terms of sums, from an element of each argument
+    template <typename T> inline double sumTerm(T x, T) { return x; }
+    template <typename T> inline double asumTerm(T x, T) { return std::fabs(x); }
+    template <typename T> inline double nrm2Term(T x, T) { return (double)x * x; }
+    template <typename T> inline double dotTerm(T x, T y) { return (double)x * y; }
+    template <typename T> inline double equalsTerm(T x, T y) { return (x != y) ? 1.0 : 0.0; }
+    inline double minTerm(double x, double y) { return std::fmin(x, y); }
+    inline double maxTerm(double x, double y) { return std::fmax(x, y); }
+
+    // the terms of reproducible sums, in float as in reduction.metal
+    inline float floatSumTerm(float x, float) { return x; }
+    inline float floatAsumTerm(float x, float) { return std::fabs(x); }
+    inline float floatDotTerm(float x, float y) { return x * y; }
+  }
+
+  // Loops over a run. Unit strides get their own loop so that the compiler can vectorize them.
+  // These are the reference versions, and are replaced by the kernels in cpu_simd.cpp where they exist.
+
+  template <typename T, T (*F)(T)>
+  void unaryRun(const CpuRunOf<T>& r) {
+    if (r.incx == 1 && r.incr == 1) {
+      for (ptrdiff_t i = 0; i < r.n; i++) {
+        r.r[i] = F(r.x[i]);
+      }
+    } else {
+      for (ptrdiff_t i = 0; i < r.n; i++) {
+        r.r[i * r.incr] = F(r.x[i * r.incx]);
+      }
+    }
+  }
+
+  template <typename T, T (*F)(T, T)>
+  void binaryRun(const CpuRunOf<T>& r) {
+    if (r.incx == 1 && r.incy == 1 && r.incr == 1) {
+      for (ptrdiff_t i = 0; i < r.n; i++) {
+        r.r[i] = F(r.x[i], r.y[i]);
+      }
+    } else {
+      for (ptrdiff_t i = 0; i < r.n; i++) {
+        r.r[i * r.incr] = F(r.x[i * r.incx], r.y[i * r.incy]);
+      }
+    }
+  }
+
+  template <typename T, T (*F)(T, T)>
+  void scalarRun(const CpuRunOf<T>& r) {
+    const T s = r.s[0];
+    if (r.incx == 1 && r.incr == 1) {
+      for (ptrdiff_t i = 0; i < r.n; i++) {
+        r.r[i] = F(r.x[i], s);
+      }
+    } else {
+      for (ptrdiff_t i = 0; i < r.n; i++) {
+        r.r[i * r.incr] = F(r.x[i * r.incx], s);
+      }
+    }
+  }
+
+  template <typename T, void (*F)(T, T&, T&)>
+  void pairRun(const CpuRunOf<T>& r) {
+    for (ptrdiff_t i = 0; i < r.n; i++) {
+      F(r.x[i * r.incx], r.r2[i * r.incr2], r.r[i * r.incr]);
+    }
+  }
+
+  template <typename T>
+  void scaleShiftRun(const CpuRunOf<T>& r) {
+    const T sa = r.s[0], sha = r.s[1];
+    if (r.incx == 1 && r.incr == 1) {
+      for (ptrdiff_t i = 0; i < r.n; i++) {
+        r.r[i] = sa * r.x[i] + sha;
+      }
+    } else {
+      for (ptrdiff_t i = 0; i < r.n; i++) {
+        r.r[i * r.incr] = sa * r.x[i * r.incx] + sha;
+      }
+    }
+  }
+
+  template <typename T>
+  void linearFracRun(const CpuRunOf<T>& r) {
+    const T sa = r.s[0], sha = r.s[1], sb = r.s[2], shb = r.s[3];
+    for (ptrdiff_t i = 0; i < r.n; i++) {
+      r.r[i * r.incr] = (sa * r.x[i * r.incx] + sha) / (sb * r.y[i * r.incy] + shb);
+    }
+  }
+
+  // a is read only, so the result takes the old value of b, and b takes the value of a
+  template <typename T>
+  void swapRun(const CpuRunOf<T>& r) {
+    for (ptrdiff_t i = 0; i < r.n; i++) {
+      T val = r.r2[i * r.incr2];
+      r.r2[i * r.incr2] = r.x[i * r.incx];
+      r.r[i * r.incr] = val;
+    }
+  }
+
+  // Reductions. Sums add each element to one of REDUCE_LANES running totals, by its position,
+  // so the lanes can be kept in vector registers, and the order of the additions is fixed.
+
+  template <typename T, double (*Term)(T, T)>
+  CpuPartial sumRun(const CpuRunOf<T>& r, ptrdiff_t) {
+    // single argument terms ignore y, so x is read in its place
+    const T* y = (r.y != nullptr) ? r.y : r.x;
+    ptrdiff_t incy = (r.y != nullptr) ? r.incy : r.incx;
+    double lanes[REDUCE_LANES] = {};
+    ptrdiff_t i = 0;
+    if (r.incx == 1 && incy == 1) {
+      for (; i + REDUCE_LANES <= r.n; i += REDUCE_LANES) {
+        for (int l = 0; l < REDUCE_LANES; l++) {
+          lanes[l] += Term(r.x[i + l], y[i + l]);
+        }
+      }
+    }
+    for (; i < r.n; i++) {
+      lanes[i % REDUCE_LANES] += Term(r.x[i * r.incx], y[i * incy]);
+    }
+    double sum = 0.0;
+    for (int l = 0; l < REDUCE_LANES; l++) {
+      sum += lanes[l];
+    }
+    return {sum, -1};
+  }
+
+  void sumCombine(CpuPartial& total, const CpuPartial& next) {
+    total.value += next.value;
+  }
+
+  template <typename T>
+  T valueFinish(const CpuPartial& total) {
+    return (T)total.value;
+  }
+
+  // squares are summed in double precision, so they cannot overflow for float elements
+  template <typename T>
+  T nrm2Finish(const CpuPartial& total) {
+    return (T)std::sqrt(total.value);
+  }
+
+  // the largest magnitude, and the first element that holds it
+  template <typename T>
+  CpuPartial amaxRun(const CpuRunOf<T>& r, ptrdiff_t start) {
+    CpuPartial p = {-1.0, -1};
+    for (ptrdiff_t i = 0; i < r.n; i++) {
+      double value = std::fabs(r.x[i * r.incx]);
+      if (value > p.value) {
+        p = {value, start + i};
+      }
+    }
+    return p;
+  }
+
+  // blocks are combined in order, so ties keep the earlier element
+  void amaxCombine(CpuPartial& total, const CpuPartial& next) {
+    if (next.value > total.value) {
+      total = next;
+    }
+  }
+
+  template <typename T>
+  T amaxFinish(const CpuPartial& total) {
+    return (total.index < 0) ? 0 : (T)total.value;
+  }
+
+  // the index is exact for vectors of up to 2^24 elements in float, and 2^53 in double
+  template <typename T>
+  T iamaxFinish(const CpuPartial& total) {
+    return (T)total.index;
+  }
+
+  // fmin and fmax ignore NaN, so an empty run gives NaN
+  template <typename T, double (*F)(double, double)>
+  CpuPartial extremeRun(const CpuRunOf<T>& r, ptrdiff_t) {
+    double value = NAN;
+    for (ptrdiff_t i = 0; i < r.n; i++) {
+      value = F(value, r.x[i * r.incx]);
+    }
+    return {value, -1};
+  }
+
+  template <double (*F)(double, double)>
+  void extremeCombine(CpuPartial& total, const CpuPartial& next) {
+    total.value = F(total.value, next.value);
+  }
+
+  // Reproducible sums. These repeat the float arithmetic of reduction.metal, in the same order:
+  // each lane combines every REPRODUCIBLE_LANES'th element of a block in turn, and then the lanes
+  // are combined in a tree. The lanes are kept in arrays, so the compiler can vectorize across them.
+
+  // adds b to a, and the rounding error of the addition to the error of a (Knuth's two-sum)
+  inline void twoSum(float& a, float& aError, float b, float bError) {
+    float s = a + b;
+    float bv = s - a;
+    float error = (a - (s - bv)) + (b - bv);
+    a = s;
+    aError = aError + bError + error;
+  }
+
+  // combines the lane at i with the one at i + s, for smaller and smaller s
+  template <typename Combine>
+  void laneTree(Combine combine) {
+    for (size_t s = Ferrum::REPRODUCIBLE_LANES / 2; s > 0; s /= 2) {
+      for (size_t i = 0; i < s; i++) {
+        combine(i, i + s);
+      }
+    }
+  }
+
+  template <float (*Term)(float, float)>
+  CpuPartial compensatedRun(const CpuRun& r, ptrdiff_t) {
+    const ptrdiff_t lanes = Ferrum::REPRODUCIBLE_LANES;
+    const float* y = (r.y != nullptr) ? r.y : r.x;
+    ptrdiff_t incy = (r.y != nullptr) ? r.incy : r.incx;
+    float value[lanes] = {};
+    float error[lanes] = {};
+    for (ptrdiff_t row = 0; row < r.n; row += lanes) {
+      ptrdiff_t width = std::min(lanes, r.n - row);
+      if (r.incx == 1 && incy == 1) {
+        for (ptrdiff_t l = 0; l < width; l++) {
+          twoSum(value[l], error[l], Term(r.x[row + l], y[row + l]), 0.0f);
+        }
+      } else {
+        for (ptrdiff_t l = 0; l < width; l++) {
+          twoSum(value[l], error[l], Term(r.x[(row + l) * r.incx], y[(row + l) * incy]), 0.0f);
+        }
+      }
+    }
+    laneTree([&](size_t i, size_t j) { twoSum(value[i], error[i], value[j], error[j]); });
+    return {value[0], -1, error[0]};
+  }
+
+  void compensatedCombine(CpuPartial& total, const CpuPartial& next) {
+    float value = total.value;
+    float error = total.scale;
+    twoSum(value, error, next.value, next.scale);
+    total = {value, -1, error};
+  }
+
+  float compensatedFinish(const CpuPartial& total) {
+    return (float)total.value + (float)total.scale;
+  }
+
+  // nrm2 as a sum of squares divided by the square of the largest magnitude
+  inline void scaledSquares(float& value, float& scale, float nextValue, float nextScale) {
+    bool larger = scale < nextScale;
+    float bigValue = larger ? nextValue : value;
+    float bigScale = larger ? nextScale : scale;
+    float smallValue = larger ? value : nextValue;
+    float smallScale = larger ? scale : nextScale;
+    value = bigValue;
+    scale = bigScale;
+    if (bigScale != 0.0f && !std::isinf(bigScale)) {
+      float ratio = smallScale / bigScale;
+      value = bigValue + smallValue * ratio * ratio;
+    }
+  }
+
+  CpuPartial scaledRun(const CpuRun& r, ptrdiff_t) {
+    const ptrdiff_t lanes = Ferrum::REPRODUCIBLE_LANES;
+    float value[lanes] = {};
+    float scale[lanes] = {};
+    for (ptrdiff_t row = 0; row < r.n; row += lanes) {
+      ptrdiff_t width = std::min(lanes, r.n - row);
+      for (ptrdiff_t l = 0; l < width; l++) {
+        scaledSquares(value[l], scale[l], 1.0f, std::fabs(r.x[(row + l) * r.incx]));
+      }
+    }
+    laneTree([&](size_t i, size_t j) { scaledSquares(value[i], scale[i], value[j], scale[j]); });
+    return {value[0], -1, scale[0]};
+  }
+
+  void scaledCombine(CpuPartial& total, const CpuPartial& next) {
+    float value = total.value;
+    float scale = total.scale;
+    scaledSquares(value, scale, next.value, next.scale);
+    total = {value, -1, scale};
+  }
+
+  float scaledFinish(const CpuPartial& total) {
+    return (float)total.scale * std::sqrt((float)total.value);
+  }
+
+  template <typename T>
+  const CpuReducerOf<T> sumReducer = {sumRun<T, Ops::sumTerm<T>>, sumCombine, valueFinish<T>, REDUCE_BLOCK, false};
+  template <typename T>
+  const CpuReducerOf<T> asumReducer = {sumRun<T, Ops::asumTerm<T>>, sumCombine, valueFinish<T>, REDUCE_BLOCK, false};
+  template <typename T>
+  const CpuReducerOf<T> nrm2Reducer = {sumRun<T, Ops::nrm2Term<T>>, sumCombine, nrm2Finish<T>, REDUCE_BLOCK, false};
+  template <typename T>
+  const CpuReducerOf<T> dotReducer = {sumRun<T, Ops::dotTerm<T>>, sumCombine, valueFinish<T>, REDUCE_BLOCK, false};
+  template <typename T>
+  const CpuReducerOf<T> equalsReducer = {sumRun<T, Ops::equalsTerm<T>>, sumCombine, valueFinish<T>,
+                                         REDUCE_BLOCK, false};
+  template <typename T>
+  const CpuReducerOf<T> amaxReducer = {amaxRun<T>, amaxCombine, amaxFinish<T>, REDUCE_BLOCK, false};
+  template <typename T>
+  const CpuReducerOf<T> iamaxReducer = {amaxRun<T>, amaxCombine, iamaxFinish<T>, REDUCE_BLOCK, false};
+  template <typename T>
+  const CpuReducerOf<T> minReducer = {extremeRun<T, Ops::minTerm>, extremeCombine<Ops::minTerm>, valueFinish<T>,
+                                      REDUCE_BLOCK, false};
+  template <typename T>
+  const CpuReducerOf<T> maxReducer = {extremeRun<T, Ops::maxTerm>, extremeCombine<Ops::maxTerm>, valueFinish<T>,
+                                      REDUCE_BLOCK, false};
+
+  const ptrdiff_t FIXED_BLOCK = Ferrum::REPRODUCIBLE_BLOCK;
+  const CpuReducer fixedSumReducer = {compensatedRun<Ops::floatSumTerm>, compensatedCombine, compensatedFinish,
+                                      FIXED_BLOCK, true};
+  const CpuReducer fixedAsumReducer = {compensatedRun<Ops::floatAsumTerm>, compensatedCombine, compensatedFinish,
+                                       FIXED_BLOCK, true};
+  const CpuReducer fixedDotReducer = {compensatedRun<Ops::floatDotTerm>, compensatedCombine, compensatedFinish,
+                                      FIXED_BLOCK, true};
+  const CpuReducer fixedNrm2Reducer = {scaledRun, scaledCombine, scaledFinish, FIXED_BLOCK, true};
+
+  // The reproducible sums repeat the float arithmetic of the shaders, so double precision has none
+  template <typename T>
+  const CpuReducerOf<T>* reproducible(const CpuReducer* reducer) {
+    if constexpr (std::is_same_v<T, float>) {
+      return reducer;
+    } else {
+      return nullptr;
+    }
+  }
+
+  // The kernels for elements of type T, by the name of the library function without its prefix
+  template <typename T>
+  const std::unordered_map<std::string, CpuKernelOf<T>>& kernelTable() {
+    static const std::unordered_map<std::string, CpuKernelOf<T>> table = {
+      {"copy", {Signature::bB, unaryRun<T, Ops::copy<T>>, nullptr}},
+      {"sqr", {Signature::bB, unaryRun<T, Ops::sqr<T>>, nullptr}},
+      {"inv", {Signature::bB, unaryRun<T, Ops::inv<T>>, nullptr}},
+      {"abs", {Signature::bB, unaryRun<T, Ops::abs<T>>, nullptr}},
+      {"sqrt", {Signature::bB, unaryRun<T, Ops::sqrt<T>>, nullptr}},
+      {"inv_sqrt", {Signature::bB, unaryRun<T, Ops::inv_sqrt<T>>, nullptr}},
+      {"cbrt", {Signature::bB, unaryRun<T, Ops::cbrt<T>>, nullptr}},
+      {"inv_cbrt", {Signature::bB, unaryRun<T, Ops::inv_cbrt<T>>, nullptr}},
+      {"pow2o3", {Signature::bB, unaryRun<T, Ops::pow2o3<T>>, nullptr}},
+      {"pow3o2", {Signature::bB, unaryRun<T, Ops::pow3o2<T>>, nullptr}},
+      {"exp", {Signature::bB, unaryRun<T, Ops::exp<T>>, nullptr}},
+      {"exp2", {Signature::bB, unaryRun<T, Ops::exp2<T>>, nullptr}},
+      {"exp10", {Signature::bB, unaryRun<T, Ops::exp10<T>>, nullptr}},
+      {"expm1", {Signature::bB, unaryRun<T, Ops::expm1<T>>, nullptr}},
+      {"log", {Signature::bB, unaryRun<T, Ops::log<T>>, nullptr}},
+      {"log2", {Signature::bB, unaryRun<T, Ops::log2<T>>, nullptr}},
+      {"log10", {Signature::bB, unaryRun<T, Ops::log10<T>>, nullptr}},
+      {"log1p", {Signature::bB, unaryRun<T, Ops::log1p<T>>, nullptr}},
+      {"sin", {Signature::bB, unaryRun<T, Ops::sin<T>>, nullptr}},
+      {"cos", {Signature::bB, unaryRun<T, Ops::cos<T>>, nullptr}},
+      {"tan", {Signature::bB, unaryRun<T, Ops::tan<T>>, nullptr}},
+      {"asin", {Signature::bB, unaryRun<T, Ops::asin<T>>, nullptr}},
+      {"acos", {Signature::bB, unaryRun<T, Ops::acos<T>>, nullptr}},
+      {"atan", {Signature::bB, unaryRun<T, Ops::atan<T>>, nullptr}},
+      {"sinh", {Signature::bB, unaryRun<T, Ops::sinh<T>>, nullptr}},
+      {"cosh", {Signature::bB, unaryRun<T, Ops::cosh<T>>, nullptr}},
+      {"tanh", {Signature::bB, unaryRun<T, Ops::tanh<T>>, nullptr}},
+      {"asinh", {Signature::bB, unaryRun<T, Ops::asinh<T>>, nullptr}},
+      {"acosh", {Signature::bB, unaryRun<T, Ops::acosh<T>>, nullptr}},
+      {"atanh", {Signature::bB, unaryRun<T, Ops::atanh<T>>, nullptr}},
+      {"erf", {Signature::bB, unaryRun<T, Ops::erf<T>>, nullptr}},
+      {"erf_inv", {Signature::bB, unaryRun<T, Ops::erf_inv<T>>, nullptr}},
+      {"erfc", {Signature::bB, unaryRun<T, Ops::erfc<T>>, nullptr}},
+      {"erfc_inv", {Signature::bB, unaryRun<T, Ops::erfc_inv<T>>, nullptr}},
+      {"erfcinv", {Signature::bB, unaryRun<T, Ops::erfc_inv<T>>, nullptr}},
+      {"cdf_norm", {Signature::bB, unaryRun<T, Ops::cdf_norm<T>>, nullptr}},
+      {"cdf_norm_inv", {Signature::bB, unaryRun<T, Ops::cdf_norm_inv<T>>, nullptr}},
+      {"gamma", {Signature::bB, unaryRun<T, Ops::gamma<T>>, nullptr}},
+      {"lgamma", {Signature::bB, unaryRun<T, Ops::lgamma<T>>, nullptr}},
+      {"floor", {Signature::bB, unaryRun<T, Ops::floor<T>>, nullptr}},
+      {"ceil", {Signature::bB, unaryRun<T, Ops::ceil<T>>, nullptr}},
+      {"trunc", {Signature::bB, unaryRun<T, Ops::trunc<T>>, nullptr}},
+      {"round", {Signature::bB, unaryRun<T, Ops::round<T>>, nullptr}},
+      {"frac", {Signature::bB, unaryRun<T, Ops::frac<T>>, nullptr}},
+      {"sigmoid", {Signature::bB, unaryRun<T, Ops::sigmoid<T>>, nullptr}},
+      {"ramp", {Signature::bB, unaryRun<T, Ops::ramp<T>>, nullptr}},
+
+      {"mul", {Signature::bbB, binaryRun<T, Ops::mul<T>>, nullptr}},
+      {"div", {Signature::bbB, binaryRun<T, Ops::div<T>>, nullptr}},
+      {"add", {Signature::bbB, binaryRun<T, Ops::add<T>>, nullptr}},
+      {"sub", {Signature::bbB, binaryRun<T, Ops::sub<T>>, nullptr}},
+      {"fmod", {Signature::bbB, binaryRun<T, Ops::fmod<T>>, nullptr}},
+      {"frem", {Signature::bbB, binaryRun<T, Ops::frem<T>>, nullptr}},
+      {"pow", {Signature::bbB, binaryRun<T, Ops::pow<T>>, nullptr}},
+      {"hypot", {Signature::bbB, binaryRun<T, Ops::hypot<T>>, nullptr}},
+      {"atan2", {Signature::bbB, binaryRun<T, Ops::atan2<T>>, nullptr}},
+      {"fmax", {Signature::bbB, binaryRun<T, Ops::fmax<T>>, nullptr}},
+      {"fmin", {Signature::bbB, binaryRun<T, Ops::fmin<T>>, nullptr}},
+      {"copysign", {Signature::bbB, binaryRun<T, Ops::copysign<T>>, nullptr}},
+
+      {"sum", {Signature::bB, nullptr, &sumReducer<T>, reproducible<T>(&fixedSumReducer)}},
+      {"asum", {Signature::bB, nullptr, &asumReducer<T>, reproducible<T>(&fixedAsumReducer)}},
+      {"nrm2", {Signature::bB, nullptr, &nrm2Reducer<T>, reproducible<T>(&fixedNrm2Reducer)}},
+      {"amax", {Signature::bB, nullptr, &amaxReducer<T>}},
+      {"iamax", {Signature::bB, nullptr, &iamaxReducer<T>}},
+      {"min", {Signature::bB, nullptr, &minReducer<T>}},
+      {"max", {Signature::bB, nullptr, &maxReducer<T>}},
+      {"dot", {Signature::bbB, nullptr, &dotReducer<T>, reproducible<T>(&fixedDotReducer)}},
+      {"equals", {Signature::bbB, nullptr, &equalsReducer<T>}},
+
+      {"powx", {Signature::bfB, scalarRun<T, Ops::powx<T>>, nullptr}},
+      {"relu", {Signature::fbB, scalarRun<T, Ops::relu<T>>, nullptr}},
+      {"elu", {Signature::fbB, scalarRun<T, Ops::elu<T>>, nullptr}},
+      {"set", {Signature::fbB, scalarRun<T, Ops::set<T>>, nullptr}},
+
+      {"sincos", {Signature::bBB, pairRun<T, Ops::sincos<T>>, nullptr}},
+      {"modf", {Signature::bBB, pairRun<T, Ops::modf<T>>, nullptr}},
+      {"swap", {Signature::bBB, swapRun<T>, nullptr}},
+
+      {"scale_shift", {Signature::bffffB, scaleShiftRun<T>, nullptr}},
+      {"linear_frac", {Signature::bbffffB, linearFracRun<T>, nullptr}},
+    };
+    return table;
+  }
+
+  // Finds the CPU implementation of a library function, from its name.
+  // The vectorized kernel for the instruction set is used where there is one, which is only for float.
+  template <typename T>
+  const CpuKernelOf<T>* findKernel(const std::string& name, Ferrum::CpuIsa isa) {
+    for (const char* prefix : {"vector_", "ge_", "uplo_"}) {
+      size_t length = strlen(prefix);
+      if (name.compare(0, length, prefix) == 0) {
+        if constexpr (std::is_same_v<T, float>) {
+          const CpuKernel* simd = Ferrum::simdKernel(isa, name.substr(length));
+          if (simd != nullptr) {
+            return simd;
+          }
+        }
+        auto it = kernelTable<T>().find(name.substr(length));
+        return (it == kernelTable<T>().end()) ? nullptr : &it->second;
+      }
+    }
+    return nullptr;
+  }
+
+  // Moves each buffer of a run to a given element
+  template <typename T>
+  CpuRunOf<T> advance(const CpuRunOf<T>& run, ptrdiff_t element) {
+    CpuRunOf<T> r = run;
+    r.x += element * run.incx;
+    if (r.y != nullptr) r.y += element * run.incy;
+    if (r.r2 != nullptr) r.r2 += element * run.incr2;
+    r.r += element * run.incr;
+    return r;
+  }
+
+  // Selects part of a column of a matrix run, where the increments are the leading dimensions.
+  // For uplo functions, an increment of PACKED is a packed sd x sd triangle.
+  template <typename T>
+  CpuRunOf<T> column(const CpuRunOf<T>& run, ptrdiff_t row, ptrdiff_t col, ptrdiff_t n, ptrdiff_t sd = 0,
+                     int bottom = 0) {
+    CpuRunOf<T> r = run;
+    r.n = n;
+    r.x += Ferrum::uploIndex(row, col, run.incx, sd, bottom);
+    r.incx = 1;
+    if (r.y != nullptr) {
+      r.y += Ferrum::uploIndex(row, col, run.incy, sd, bottom);
+      r.incy = 1;
+    }
+    if (r.r2 != nullptr) {
+      r.r2 += Ferrum::uploIndex(row, col, run.incr2, sd, bottom);
+      r.incr2 = 1;
+    }
+    r.r += Ferrum::uploIndex(row, col, run.incr, sd, bottom);
+    r.incr = 1;
+    return r;
+  }
+
+  // true if every matrix of an uplo run is packed
+  template <typename T>
+  bool allPacked(const CpuRunOf<T>& run) {
+    return run.incx == Ferrum::PACKED && (run.y == nullptr || run.incy == Ferrum::PACKED) &&
+           (run.r2 == nullptr || run.incr2 == Ferrum::PACKED) && run.incr == Ferrum::PACKED;
+  }
+
+  // The element type is taken from a, so the other buffers may be nullptr
+  template <typename T>
+  CpuRunOf<T> makeRun(const T* a, int offset_a, int stride_a,
+                      std::type_identity_t<const T*> b, int offset_b, int stride_b,
+                      std::type_identity_t<T*> b_out,
+                      std::type_identity_t<T*> result, int offset, int stride,
+                      std::type_identity_t<T> sa = 0, std::type_identity_t<T> sha = 0,
+                      std::type_identity_t<T> sb = 0, std::type_identity_t<T> shb = 0) {
+    CpuRunOf<T> run;
+    run.n = 0;
+    run.x = a + offset_a;
+    run.incx = stride_a;
+    run.y = (b != nullptr) ? b + offset_b : nullptr;
+    run.incy = stride_b;
+    run.r2 = (b_out != nullptr) ? b_out + offset_b : nullptr;
+    run.incr2 = stride_b;
+    run.r = result + offset;
+    run.incr = stride;
+    run.s[0] = sa;
+    run.s[1] = sha;
+    run.s[2] = sb;
+    run.s[3] = shb;
+    return run;
+  }
+
+  // Runs an elementwise kernel over a vector, the columns of a matrix, or the triangle of an uplo
+  // matrix, split across the pool. kernel is called with each part of the run.
+  template <typename T, typename Kernel>
+  void runKernel(Ferrum::ThreadPool& pool, Ferrum::CpuStep::Shape shape, Kernel kernel,
+                 const CpuRunOf<T>& run, int sd, int fd, int bottom, int diagonal) {
+    switch (shape) {
+      case Ferrum::CpuStep::vect:
+        // a run too short to split is not worth a trip through the pool
+        if (run.n <= (ptrdiff_t)GRAIN) {
+          if (run.n > 0) {
+            kernel(run);
+          }
+          break;
+        }
+        pool.parallelFor(run.n, GRAIN, [&](size_t begin, size_t end) {
+          CpuRunOf<T> part = advance(run, begin);
+          part.n = end - begin;
+          kernel(part);
+        });
+        break;
+      case Ferrum::CpuStep::ge:
+        pool.parallelFor(fd, Ferrum::columnGrain(sd, GRAIN), [&](size_t begin, size_t end) {
+          for (size_t j = begin; j < end; j++) {
+            kernel(column(run, 0, j, sd));
+          }
+        });
+        break;
+      case Ferrum::CpuStep::uplo:
+        // on average, each column holds half of the rows
+        pool.parallelFor(sd, Ferrum::columnGrain(sd, 2 * GRAIN), [&](size_t begin, size_t end) {
+          for (int j = begin; j < (int)end; j++) {
+            int first, last;
+            if (bottom > 0) {
+              first = j + 1 - diagonal;
+              last = sd;
+            } else if (bottom < 0) {
+              first = 0;
+              last = j + diagonal;
+            } else {
+              first = 0;
+              last = diagonal ? sd : 0;
+            }
+            if (first < last) {
+              kernel(column(run, first, j, last - first, sd, bottom));
+            }
+          }
+        });
+        break;
+      default:
+        break;
+    }
+  }
+
+  // Runs a float kernel over part of a half precision run, a block at a time. The in/out buffer of the
+  // bBB functions is read as well as written, as swap needs its old values.
+  void runHalf(const Ferrum::CpuKernel& k, const Ferrum::CpuHalfKernel& convert, const CpuRunOf<uint16_t>& run,
+               const float* scalars) {
+    float x[HALF_BLOCK], y[HALF_BLOCK], r[HALF_BLOCK], r2[HALF_BLOCK];
+    for (ptrdiff_t start = 0; start < run.n; start += HALF_BLOCK) {
+      CpuRun part = {std::min(HALF_BLOCK, run.n - start), x, 1, nullptr, 0, r, 1, nullptr, 0};
+      std::copy(scalars, scalars + 4, part.s);
+      convert.load(run.x + start * run.incx, run.incx, part.n, x);
+      if (run.y != nullptr) {
+        convert.load(run.y + start * run.incy, run.incy, part.n, y);
+        part.y = y;
+        part.incy = 1;
+      }
+      if (run.r2 != nullptr) {
+        convert.load(run.r2 + start * run.incr2, run.incr2, part.n, r2);
+        part.r2 = r2;
+        part.incr2 = 1;
+      }
+      k.run(part);
+      convert.store(r, part.n, run.r + start * run.incr, run.incr);
+      if (run.r2 != nullptr) {
+        convert.store(r2, part.n, run.r2 + start * run.incr2, run.incr2);
+      }
+    }
+  }
+
+  // Reduces the blocks of a run on the pool, then combines their partial results in a fixed order
+  template <typename T>
+  void reduce(Ferrum::ThreadPool& pool, const CpuReducerOf<T>& reducer, const CpuRunOf<T>& run) {
+    ptrdiff_t block = reducer.block;
+    size_t blocks = (run.n + block - 1) / block;
+    std::vector<CpuPartial> partials(blocks);
+    pool.parallelFor(blocks, 1, [&](size_t begin, size_t end) {
+      for (size_t b = begin; b < end; b++) {
+        ptrdiff_t start = b * block;
+        CpuRunOf<T> part = advance(run, start);
+        part.n = std::min(block, run.n - start);
+        partials[b] = reducer.reduce(part, start);
+      }
+    });
+    // an empty run gives the starting value
+    CpuRunOf<T> empty = run;
+    empty.n = 0;
+    CpuPartial total = reducer.reduce(empty, 0);
+    if (reducer.tree) {
+      // as in pass 1 of reduction.metal
+      std::vector<CpuPartial> lanes(Ferrum::REPRODUCIBLE_LANES, total);
+      for (size_t b = 0; b < blocks; b++) {
+        reducer.combine(lanes[b % Ferrum::REPRODUCIBLE_LANES], partials[b]);
+      }
+      laneTree([&](size_t i, size_t j) { reducer.combine(lanes[i], lanes[j]); });
+      total = lanes[0];
+    } else {
+      for (const CpuPartial& partial : partials) {
+        reducer.combine(total, partial);
+      }
+    }
+    *run.r = reducer.finish(total);
+  }
+
+} // namespace
+
+
+// A fused expression, ready to run. Each live function node has its kernel, and reads its
+// arguments straight from the inputs, or from the block of values for an earlier node.
+struct Ferrum::CpuFusion {
+  struct Step {
+    const CpuKernel* kernel;
+    int node;
+    int args[2];
+    float scalars[4];
+  };
+  std::vector<Step> steps;
+  std::vector<FusedNode> nodes;
+  std::vector<FusedInput> inputs;
+  int result;
+  float* data;
+  int offset;
+  int stride;
+
+  // Points a kernel argument at the elements of a node, from element start of the block
+  void locate(int node, ptrdiff_t start, const float* temps, const float*& x, ptrdiff_t& inc) const {
+    const FusedNode& n = nodes[node];
+    if (n.id == FunctionID::UNKNOWN) {
+      const FusedInput& in = inputs[n.input];
+      x = in.data + in.offset + start * in.stride;
+      inc = in.stride;
+    } else {
+      x = temps + node * FUSED_BLOCK;
+      inc = 1;
+    }
+  }
+
+  // Evaluates elements [begin, end), using space for a block of every node in temps
+  void run(ptrdiff_t begin, ptrdiff_t end, float* temps) const {
+    for (ptrdiff_t start = begin; start < end; start += FUSED_BLOCK) {
+      CpuRun r;
+      r.n = std::min(FUSED_BLOCK, end - start);
+      r.r2 = nullptr;
+      r.incr2 = 0;
+      for (const Step& step : steps) {
+        locate(step.args[0], start, temps, r.x, r.incx);
+        r.y = nullptr;
+        r.incy = 0;
+        if (step.args[1] >= 0) {
+          locate(step.args[1], start, temps, r.y, r.incy);
+        }
+        if (step.node == result) {
+          r.r = data + offset + start * stride;
+          r.incr = stride;
+        } else {
+          r.r = temps + step.node * FUSED_BLOCK;
+          r.incr = 1;
+        }
+        std::copy(step.scalars, step.scalars + 4, r.s);
+        step.kernel->run(r);
+      }
+    }
+  }
+};
+
+
+// constructor for Ferrum::CpuEngine
+Ferrum::CpuEngine::CpuEngine(int threads) :
+    pool(new ThreadPool(threads)), submissions(new SerialQueue()), isa(detectIsa()),
+    gemmKernel(simdGemm(isa)), level2Kernel(simdLevel2(isa)), reproducibleSums(false) {
+  DBG("Collecting CPU kernels for ", isaName(isa), "...");
+  fnCount = functionCount;
+  kernels = new const CpuKernel*[fnCount];
+  doubleKernels = new const CpuDoubleKernel*[fnCount];
+  for (int i = 0; i < fnCount; i++) {
+    kernels[i] = nullptr;
+    doubleKernels[i] = nullptr;
+  }
+  for (int i = 0; i < fnCount; i++) {
+    FunctionID id = static_cast<FunctionID>(i);
+    std::string name = functionNames[i];
+    // the BLAS functions have their own entry points
+    if (blasFunction(id)) {
+      continue;
+    }
+    const CpuKernel* kernel = findKernel<float>(name, isa);
+    if (kernel == nullptr) {
+      std::cerr << "Error: No CPU implementation for: " << name << std::endl;
+    } else {
+      kernels[static_cast<int>(id)] = kernel;
+      doubleKernels[static_cast<int>(id)] = findKernel<double>(name, isa);
+    }
+  }
+  halfKernels[static_cast<int>(HalfFormat::fp16)] = simdHalf(isa, HalfFormat::fp16);
+  halfKernels[static_cast<int>(HalfFormat::bf16)] = simdHalf(isa, HalfFormat::bf16);
+  DBG("CPU engine running on ", pool->concurrency(), " threads");
+}
+
+
+Ferrum::CpuEngine::~CpuEngine() {
+  // finish any submitted jobs first
+  delete submissions;
+  delete[] kernels;
+  delete[] doubleKernels;
+  delete pool;
+}
+
+
+std::future<float*> Ferrum::CpuEngine::submit(Job job, Completion done) {
+  return submissions->submit<float*>([this, job, done]() {
+    float* result = job(*this);
+    if (done) {
+      done(result);
+    }
+    return result;
+  });
+}
+
+
+// CPU tensors are ordinary host memory
+Ferrum::Tensor* Ferrum::CpuEngine::newTensor(int length) {
+  if (length < 0) {
+    return nullptr;
+  }
+  return new Tensor{new float[length], length};
+}
+
+
+void Ferrum::CpuEngine::releaseTensor(Tensor* tensor) {
+  if (tensor == nullptr) {
+    return;
+  }
+  // steps in this thread's batch may still use the data
+  if (CpuBatch* batch = threadBatch()) {
+    batch->released.push_back(tensor->data);
+  } else {
+    delete[] tensor->data;
+  }
+  delete tensor;
+}
+
+
+thread_local Ferrum::CpuEngine::ThreadBatch Ferrum::CpuEngine::current = {nullptr, nullptr, 0};
+thread_local std::vector<Ferrum::CpuStep> Ferrum::CpuEngine::spareSteps;
+
+Ferrum::CpuEngine::CpuBatch* Ferrum::CpuEngine::threadBatch() {
+  if (current.open == 0) {
+    return nullptr;
+  }
+  if (current.engine == this) {
+    return current.batch;
+  }
+  std::lock_guard<std::mutex> guard(batchLock);
+  auto it = batches.find(std::this_thread::get_id());
+  return (it == batches.end()) ? nullptr : &it->second;
+}
+
+
+bool Ferrum::CpuEngine::inBatch() const {
+  if (current.open == 0) {
+    return false;
+  }
+  if (current.engine == this) {
+    return true;
+  }
+  std::lock_guard<std::mutex> guard(batchLock);
+  return batches.count(std::this_thread::get_id()) > 0;
+}
+
+
+bool Ferrum::CpuEngine::beginBatch() {
+  std::lock_guard<std::mutex> guard(batchLock);
+  auto [it, added] = batches.try_emplace(std::this_thread::get_id());
+  if (!added) {
+    std::cerr << "Error: A batch is already open" << std::endl;
+    return false;
+  }
+  it->second.steps = std::move(spareSteps);
+  // the entry stays where it is until the batch is committed
+  current = {this, &it->second, current.open + 1};
+  return true;
+}
+
+
+bool Ferrum::CpuEngine::commitBatch() {
+  CpuBatch batch;
+  {
+    std::lock_guard<std::mutex> guard(batchLock);
+    auto it = batches.find(std::this_thread::get_id());
+    if (it == batches.end()) {
+      std::cerr << "Error: No batch is open" << std::endl;
+      return false;
+    }
+    batch = std::move(it->second);
+    batches.erase(it);
+  }
+  current.open--;
+  if (current.engine == this) {
+    current.engine = nullptr;
+    current.batch = nullptr;
+  }
+  // arguments were checked as each call was queued, so this is just the kernel runs
+  for (const CpuStep& step : batch.steps) {
+    runStep(step);
+  }
+  for (float* data : batch.released) {
+    delete[] data;
+  }
+  batch.steps.clear();
+  spareSteps = std::move(batch.steps);
+  return true;
+}
+
+
+Ferrum::CpuStep& Ferrum::CpuEngine::stepFor(CpuStep::Shape shape, CpuStep& local) {
+  CpuBatch* batch = threadBatch();
+  CpuStep& step = (batch != nullptr) ? batch->steps.emplace_back() : (local = CpuStep{});
+  step.shape = shape;
+  return step;
+}
+
+
+float* Ferrum::CpuEngine::schedule(const CpuStep& step, const CpuStep& local, float* result) {
+  if (&step == &local) {
+    runStep(step);
+  }
+  return result;
+}
+
+
+// Splits a step across the pool. Each step finishes before the next one starts,
+// as later steps in a batch may read the results of earlier ones.
+void Ferrum::CpuEngine::runStep(const CpuStep& step) {
+  switch (step.shape) {
+    case CpuStep::vect:
+      if (step.reduction != nullptr) {
+        reduce(*pool, *step.reduction, step.run);
+        break;
+      }
+      runKernel(*pool, step.shape, step.kernel->run, step.run, step.sd, step.fd, step.bottom, step.diagonal);
+      break;
+    case CpuStep::ge:
+    case CpuStep::uplo:
+      runKernel(*pool, step.shape, step.kernel->run, step.run, step.sd, step.fd, step.bottom, step.diagonal);
+      break;
+    case CpuStep::fused:
+      pool->parallelFor(step.run.n, GRAIN, [&](size_t begin, size_t end) {
+        std::vector<float> temps(step.fusion->nodes.size() * FUSED_BLOCK);
+        step.fusion->run(begin, end, temps.data());
+      });
+      break;
+    case CpuStep::gemm:
+      runGemm(*pool, *gemmKernel, step.product);
+      break;
+    case CpuStep::gemv:
+      runGemv(*pool, *level2Kernel, step.mv);
+      break;
+    case CpuStep::rank1:
+      runRank1(*pool, *level2Kernel, step.rk);
+      break;
+    case CpuStep::triangular:
+      runTriangular(*pool, *gemmKernel, *level2Kernel, step.tr);
+      break;
+  }
+}
+
+
+template <typename T>
+const Ferrum::CpuKernelOf<T>* Ferrum::CpuEngine::kernel(FunctionID id, Signature signature) {
+  int index = static_cast<int>(id);
+  const CpuKernelOf<T>* const* table;
+  if constexpr (std::is_same_v<T, float>) {
+    table = kernels;
+  } else {
+    table = doubleKernels;
+  }
+  const CpuKernelOf<T>* k = (index >= 0 && index < fnCount) ? table[index] : nullptr;
+  if (k == nullptr) {
+    std::cerr << "Error: Failed to find CPU kernel for '" << functionName(id) << "'" << std::endl;
+    return nullptr;
+  }
+  if (k->signature != signature) {
+    std::cerr << "Error: Wrong arguments for function '" << functionName(id) << "'" << std::endl;
+    return nullptr;
+  }
+  return k;
+}
+
+
+// Batches only hold float steps, so double precision kernels run straight away
+template <typename T>
+T* Ferrum::CpuEngine::schedule(CpuStep::Shape shape, const CpuKernelOf<T>* k, const CpuReducerOf<T>* reduction,
+                               const CpuRunOf<T>& run, int sd, int fd, int bottom, int diagonal, T* result) {
+  if constexpr (std::is_same_v<T, float>) {
+    CpuStep local;
+    CpuStep& step = stepFor(shape, local);
+    step.kernel = k;
+    step.run = run;
+    step.sd = sd;
+    step.fd = fd;
+    step.bottom = bottom;
+    step.diagonal = diagonal;
+    step.reduction = reduction;
+    return schedule(step, local, result);
+  } else {
+    if (inBatch()) {
+      std::cerr << "Error: Double precision functions cannot be used in a batch" << std::endl;
+      return nullptr;
+    }
+    if (reduction != nullptr) {
+      reduce(*pool, *reduction, run);
+    } else {
+      runKernel(*pool, shape, k->run, run, sd, fd, bottom, diagonal);
+    }
+    return result;
+  }
+}
+
+
+template <typename T>
+T* Ferrum::CpuEngine::call_vect(FunctionID id, Signature signature, const CpuRunOf<T>& run, ptrdiff_t count,
+                                T* result) {
+  const CpuKernelOf<T>* k = kernel<T>(id, signature);
+  if (k == nullptr) {
+    return nullptr;
+  }
+  // double precision has no reproducible reductions, but its usual ones do not depend on the threads
+  const CpuReducerOf<T>* reduction = (reproducibleSums && k->reproducible != nullptr) ? k->reproducible
+                                                                                       : k->reduction;
+  // a reduction only needs room for its value, while elementwise kernels stop at the end of the result
+  CpuRunOf<T> limited = run;
+  if (k->reduction == nullptr) {
+    limited.n = std::min(run.n, count);
+  } else if (count == 0) {
+    std::cerr << "Error: No room for the result of '" << functionName(id) << "'" << std::endl;
+    return nullptr;
+  }
+  return schedule(CpuStep::vect, k, reduction, limited, 0, 0, 0, 0, result);
+}
+
+
+template <typename T>
+T* Ferrum::CpuEngine::call_ge(FunctionID id, Signature signature, int sd, int fd,
+                              const CpuRunOf<T>& run, T* result) {
+  const CpuKernelOf<T>* k = kernel<T>(id, signature);
+  if (k == nullptr) {
+    return nullptr;
+  }
+  if (sd <= 0 || fd <= 0) {
+    return result;
+  }
+  return schedule<T>(CpuStep::ge, k, nullptr, run, sd, fd, 0, 0, result);
+}
+
+
+template <typename T>
+T* Ferrum::CpuEngine::call_uplo(FunctionID id, Signature signature, int sd, int unit, int bottom,
+                                const CpuRunOf<T>& run, T* result) {
+  const CpuKernelOf<T>* k = kernel<T>(id, signature);
+  if (k == nullptr) {
+    return nullptr;
+  }
+  if (sd <= 0) {
+    return result;
+  }
+  // Rows of column j that the kernels accept with:
+  //   (unit == 132) ? bottom * i > bottom * j : bottom * i >= bottom * j
+  int diagonal = (unit == 132) ? 0 : 1;
+  if (diagonal && allPacked(run)) {
+    // the whole of each packed triangle is used, so the matrices are vectors with the same layout
+    CpuRunOf<T> packed = run;
+    packed.n = packedLength(sd);
+    packed.incx = packed.incy = packed.incr2 = packed.incr = 1;
+    return schedule<T>(CpuStep::vect, k, nullptr, packed, 0, 0, 0, 0, result);
+  }
+  return schedule<T>(CpuStep::uplo, k, nullptr, run, sd, 0, bottom, diagonal, result);
+}
+
+
+uint16_t* Ferrum::CpuEngine::call_half(FunctionID id, HalfFormat format, Signature signature, CpuStep::Shape shape,
+                                       int sd, int fd, const CpuRunOf<uint16_t>& run, ptrdiff_t count,
+                                       std::initializer_list<float> scalars, uint16_t* result) {
+  if (format != HalfFormat::fp16 && format != HalfFormat::bf16) {
+    std::cerr << "Error: Unknown half precision format: " << static_cast<int>(format) << std::endl;
+    return nullptr;
+  }
+  const CpuKernel* k = kernel<float>(id, signature);
+  if (k == nullptr) {
+    return nullptr;
+  }
+  if (k->reduction != nullptr) {
+    std::cerr << "Error: Reductions have no half precision version: '" << functionName(id) << "'" << std::endl;
+    return nullptr;
+  }
+  // batches only hold float steps
+  if (inBatch()) {
+    std::cerr << "Error: Half precision functions cannot be used in a batch" << std::endl;
+    return nullptr;
+  }
+  CpuRunOf<uint16_t> limited = run;
+  if (shape == CpuStep::vect) {
+    limited.n = std::min(run.n, count);
+  } else if (sd <= 0 || fd <= 0) {
+    return result;
+  }
+  const CpuHalfKernel* convert = halfKernels[static_cast<int>(format)];
+  float s[4] = {};
+  std::copy(scalars.begin(), scalars.end(), s);
+  runKernel(*pool, shape, [&](const CpuRunOf<uint16_t>& part) { runHalf(*k, *convert, part, s); },
+            limited, sd, fd, 0, 0);
+  return result;
+}
+
+// general vector functions
+float* Ferrum::CpuEngine::vect_bB(Ferrum::FunctionID id, const float* a, int lena, int offset_a, int stride_a,
+                                  float* result, int len, int offset, int stride) {
+  CpuRun run = makeRun(a, offset_a, stride_a, nullptr, 0, 0, nullptr, result, offset, stride);
+  run.n = vectorCount(lena, offset_a, stride_a);
+  return call_vect(id, Signature::bB, run, vectorCount(len, offset, stride), result);
+}
+
+float* Ferrum::CpuEngine::vect_bfB(Ferrum::FunctionID id, const float* a, int lena, int offset_a, int stride_a,
+                                   float sa,
+                                   float* result, int len, int offset, int stride) {
+  CpuRun run = makeRun(a, offset_a, stride_a, nullptr, 0, 0, nullptr, result, offset, stride, sa);
+  run.n = vectorCount(lena, offset_a, stride_a);
+  return call_vect(id, Signature::bfB, run, vectorCount(len, offset, stride), result);
+}
+
+float* Ferrum::CpuEngine::vect_fbB(Ferrum::FunctionID id, float sa,
+                                   const float* a, int lena, int offset_a, int stride_a,
+                                   float* result, int len, int offset, int stride) {
+  CpuRun run = makeRun(a, offset_a, stride_a, nullptr, 0, 0, nullptr, result, offset, stride, sa);
+  run.n = vectorCount(lena, offset_a, stride_a);
+  return call_vect(id, Signature::fbB, run, vectorCount(len, offset, stride), result);
+}
+
+float* Ferrum::CpuEngine::vect_bbB(Ferrum::FunctionID id, const float* a, int lena, int offset_a, int stride_a,
+                                   const float* b, int lenb, int offset_b, int stride_b,
+                                   float* result, int len, int offset, int stride) {
+  CpuRun run = makeRun(a, offset_a, stride_a, b, offset_b, stride_b, nullptr, result, offset, stride);
+  run.n = std::min(vectorCount(lena, offset_a, stride_a), vectorCount(lenb, offset_b, stride_b));
+  return call_vect(id, Signature::bbB, run, vectorCount(len, offset, stride), result);
+}
+
+float* Ferrum::CpuEngine::vect_bBB(Ferrum::FunctionID id, const float* a, int lena, int offset_a, int stride_a,
+                                   float* b, int lenb, int offset_b, int stride_b,
+                                   float* result, int len, int offset, int stride) {
+  CpuRun run = makeRun(a, offset_a, stride_a, nullptr, offset_b, stride_b, b, result, offset, stride);
+  run.n = std::min(vectorCount(lena, offset_a, stride_a), vectorCount(lenb, offset_b, stride_b));
+  return call_vect(id, Signature::bBB, run, vectorCount(len, offset, stride), result);
+}
+
+float* Ferrum::CpuEngine::vect_bffffB(Ferrum::FunctionID id, const float* a, int lena, int offset_a, int stride_a,
+                                      float sa, float sha,
+                                      float sb, float shb,
+                                      float* result, int len, int offset, int stride) {
+  CpuRun run = makeRun(a, offset_a, stride_a, nullptr, 0, 0, nullptr, result, offset, stride, sa, sha, sb, shb);
+  run.n = vectorCount(lena, offset_a, stride_a);
+  return call_vect(id, Signature::bffffB, run, vectorCount(len, offset, stride), result);
+}
+
+float* Ferrum::CpuEngine::vect_bbffffB(Ferrum::FunctionID id, const float* a, int lena, int offset_a, int stride_a,
+                                       const float* b, int lenb, int offset_b, int stride_b,
+                                       float sa, float sha,
+                                       float sb, float shb,
+                                       float* result, int len, int offset, int stride) {
+  CpuRun run = makeRun(a, offset_a, stride_a, b, offset_b, stride_b, nullptr, result, offset, stride, sa, sha, sb, shb);
+  run.n = std::min(vectorCount(lena, offset_a, stride_a), vectorCount(lenb, offset_b, stride_b));
+  return call_vect(id, Signature::bbffffB, run, vectorCount(len, offset, stride), result);
+}
+
+float* Ferrum::CpuEngine::vect_fused(const FusedExpr& expr, const std::vector<FusedInput>& inputs,
+                                     float* result, int len, int offset, int stride) {
+  if (!expr.valid() || (int)inputs.size() != expr.inputCount()) {
+    std::cerr << "Error: Invalid fused expression" << std::endl;
+    return nullptr;
+  }
+  auto fusion = std::make_shared<CpuFusion>();
+  fusion->nodes = expr.nodes();
+  fusion->inputs = inputs;
+  fusion->result = expr.result();
+  fusion->data = result;
+  fusion->offset = offset;
+  fusion->stride = stride;
+  std::vector<bool> live = expr.live();
+  for (int i = 0; i < (int)fusion->nodes.size(); i++) {
+    const FusedNode& node = fusion->nodes[i];
+    if (!live[i] || node.id == FunctionID::UNKNOWN) {
+      continue;
+    }
+    const CpuKernel* k = kernel<float>(node.id, node.signature);
+    if (k == nullptr) {
+      return nullptr;
+    }
+    CpuFusion::Step step = {k, i, {node.args[0], node.args[1]}, {}};
+    std::copy(node.scalars, node.scalars + 4, step.scalars);
+    fusion->steps.push_back(step);
+  }
+  CpuStep local;
+  CpuStep& step = stepFor(CpuStep::fused, local);
+  step.fusion = fusion;
+  step.run.n = fusedCount(inputs, len, offset, stride);
+  return schedule(step, local, result);
+}
+
+// general matrix functions
+// For matrices, the stride of each buffer is its leading dimension
+
+#define CHECK_GE(name, length, offset, ld, rows, cols)                                    \
+  if (!geFits(length, offset, ld, rows, cols)) {                                          \
+    std::cerr << "Error: Matrix " << name << " does not fit in its buffer" << std::endl;  \
+    return nullptr;                                                                       \
+  }
+
+// The matrices of uplo functions may be packed, which needs a triangle
+#define CHECK_UPLO(name, length, offset, ld)                                                    \
+  if (ld == PACKED && bottom == 0) {                                                            \
+    std::cerr << "Error: Packed matrix " << name << " has no triangle for " << functionName(id) << std::endl;  \
+    return nullptr;                                                                             \
+  }                                                                                             \
+  if (!uploFits(length, offset, ld, sd)) {                                                      \
+    std::cerr << "Error: Matrix " << name << " does not fit in its buffer" << std::endl;        \
+    return nullptr;                                                                             \
+  }
+
+float* Ferrum::CpuEngine::ge_bB(Ferrum::FunctionID id, int sd, int fd,
+                                const float* a, int lena, int offset_a, int stride_a,
+                                float* result, int len, int offset, int stride) {
+  CHECK_GE("a", lena, offset_a, stride_a, sd, fd);
+  CHECK_GE("result", len, offset, stride, sd, fd);
+  return call_ge(id, Signature::bB, sd, fd,
+                 makeRun(a, offset_a, stride_a, nullptr, 0, 0, nullptr, result, offset, stride), result);
+}
+
+float* Ferrum::CpuEngine::ge_bfB(Ferrum::FunctionID id, int sd, int fd,
+                                 const float* a, int lena, int offset_a, int stride_a,
+                                 float sa,
+                                 float* result, int len, int offset, int stride) {
+  CHECK_GE("a", lena, offset_a, stride_a, sd, fd);
+  CHECK_GE("result", len, offset, stride, sd, fd);
+  return call_ge(id, Signature::bfB, sd, fd,
+                 makeRun(a, offset_a, stride_a, nullptr, 0, 0, nullptr, result, offset, stride, sa), result);
+}
+
+float* Ferrum::CpuEngine::ge_fbB(Ferrum::FunctionID id, int sd, int fd, float sa,
+                                 const float* a, int lena, int offset_a, int stride_a,
+                                 float* result, int len, int offset, int stride) {
+  CHECK_GE("a", lena, offset_a, stride_a, sd, fd);
+  CHECK_GE("result", len, offset, stride, sd, fd);
+  return call_ge(id, Signature::fbB, sd, fd,
+                 makeRun(a, offset_a, stride_a, nullptr, 0, 0, nullptr, result, offset, stride, sa), result);
+}
+
+float* Ferrum::CpuEngine::ge_bbB(Ferrum::FunctionID id, int sd, int fd,
+                                 const float* a, int lena, int offset_a, int stride_a,
+                                 const float* b, int lenb, int offset_b, int stride_b,
+                                 float* result, int len, int offset, int stride) {
+  CHECK_GE("a", lena, offset_a, stride_a, sd, fd);
+  CHECK_GE("b", lenb, offset_b, stride_b, sd, fd);
+  CHECK_GE("result", len, offset, stride, sd, fd);
+  return call_ge(id, Signature::bbB, sd, fd,
+                 makeRun(a, offset_a, stride_a, b, offset_b, stride_b, nullptr, result, offset, stride), result);
+}
+
+float* Ferrum::CpuEngine::ge_bBB(Ferrum::FunctionID id, int sd, int fd,
+                                 const float* a, int lena, int offset_a, int stride_a,
+                                 float* b, int lenb, int offset_b, int stride_b,
+                                 float* result, int len, int offset, int stride) {
+  CHECK_GE("a", lena, offset_a, stride_a, sd, fd);
+  CHECK_GE("b", lenb, offset_b, stride_b, sd, fd);
+  CHECK_GE("result", len, offset, stride, sd, fd);
+  return call_ge(id, Signature::bBB, sd, fd,
+                 makeRun(a, offset_a, stride_a, nullptr, offset_b, stride_b, b, result, offset, stride), result);
+}
+
+float* Ferrum::CpuEngine::ge_bffffB(Ferrum::FunctionID id, int sd, int fd,
+                                    const float* a, int lena, int offset_a, int stride_a,
+                                    float sa, float sha,
+                                    float sb, float shb,
+                                    float* result, int len, int offset, int stride) {
+  CHECK_GE("a", lena, offset_a, stride_a, sd, fd);
+  CHECK_GE("result", len, offset, stride, sd, fd);
+  return call_ge(id, Signature::bffffB, sd, fd,
+                 makeRun(a, offset_a, stride_a, nullptr, 0, 0, nullptr, result, offset, stride, sa, sha, sb, shb),
+                 result);
+}
+
+float* Ferrum::CpuEngine::ge_bbffffB(Ferrum::FunctionID id, int sd, int fd,
+                                     const float* a, int lena, int offset_a, int stride_a,
+                                     const float* b, int lenb, int offset_b, int stride_b,
+                                     float sa, float sha,
+                                     float sb, float shb,
+                                     float* result, int len, int offset, int stride) {
+  CHECK_GE("a", lena, offset_a, stride_a, sd, fd);
+  CHECK_GE("b", lenb, offset_b, stride_b, sd, fd);
+  CHECK_GE("result", len, offset, stride, sd, fd);
+  return call_ge(id, Signature::bbffffB, sd, fd,
+                 makeRun(a, offset_a, stride_a, b, offset_b, stride_b, nullptr, result, offset, stride, sa, sha, sb, shb),
+                 result);
+}
+
+// general uplo functions
+// These are square, so the checks use sd for both dimensions
+
+float* Ferrum::CpuEngine::uplo_bB(Ferrum::FunctionID id, int sd, int unit, int bottom,
+                                  const float* a, int lena, int offset_a, int stride_a,
+                                  float* result, int len, int offset, int stride) {
+  CHECK_UPLO("a", lena, offset_a, stride_a);
+  CHECK_UPLO("result", len, offset, stride);
+  return call_uplo(id, Signature::bB, sd, unit, bottom,
+                   makeRun(a, offset_a, stride_a, nullptr, 0, 0, nullptr, result, offset, stride), result);
+}
+
+float* Ferrum::CpuEngine::uplo_bfB(Ferrum::FunctionID id, int sd, int unit, int bottom,
+                                   const float* a, int lena, int offset_a, int stride_a,
+                                   float sa,
+                                   float* result, int len, int offset, int stride) {
+  CHECK_UPLO("a", lena, offset_a, stride_a);
+  CHECK_UPLO("result", len, offset, stride);
+  return call_uplo(id, Signature::bfB, sd, unit, bottom,
+                   makeRun(a, offset_a, stride_a, nullptr, 0, 0, nullptr, result, offset, stride, sa), result);
+}
+
+float* Ferrum::CpuEngine::uplo_fbB(Ferrum::FunctionID id, int sd, int unit, int bottom,
+                                   const float* a, int lena, int offset_a, int stride_a,
+                                   float sa,
+                                   float* result, int len, int offset, int stride) {
+  CHECK_UPLO("a", lena, offset_a, stride_a);
+  CHECK_UPLO("result", len, offset, stride);
+  return call_uplo(id, Signature::fbB, sd, unit, bottom,
+                   makeRun(a, offset_a, stride_a, nullptr, 0, 0, nullptr, result, offset, stride, sa), result);
+}
+
+float* Ferrum::CpuEngine::uplo_bbB(Ferrum::FunctionID id, int sd, int unit, int bottom,
+                                   const float* a, int lena, int offset_a, int stride_a,
+                                   const float* b, int lenb, int offset_b, int stride_b,
+                                   float* result, int len, int offset, int stride) {
+  CHECK_UPLO("a", lena, offset_a, stride_a);
+  CHECK_UPLO("b", lenb, offset_b, stride_b);
+  CHECK_UPLO("result", len, offset, stride);
+  return call_uplo(id, Signature::bbB, sd, unit, bottom,
+                   makeRun(a, offset_a, stride_a, b, offset_b, stride_b, nullptr, result, offset, stride), result);
+}
+
+float* Ferrum::CpuEngine::uplo_bBB(Ferrum::FunctionID id, int sd, int unit, int bottom,
+                                   const float* a, int lena, int offset_a, int stride_a,
+                                   float* b, int lenb, int offset_b, int stride_b,
+                                   float* result, int len, int offset, int stride) {
+  CHECK_UPLO("a", lena, offset_a, stride_a);
+  CHECK_UPLO("b", lenb, offset_b, stride_b);
+  CHECK_UPLO("result", len, offset, stride);
+  return call_uplo(id, Signature::bBB, sd, unit, bottom,
+                   makeRun(a, offset_a, stride_a, nullptr, offset_b, stride_b, b, result, offset, stride), result);
+}
+
+float* Ferrum::CpuEngine::uplo_bffffB(Ferrum::FunctionID id, int sd, int unit, int bottom,
+                                      const float* a, int lena, int offset_a, int stride_a,
+                                      float sa, float sha,
+                                      float sb, float shb,
+                                      float* result, int len, int offset, int stride) {
+  CHECK_UPLO("a", lena, offset_a, stride_a);
+  CHECK_UPLO("result", len, offset, stride);
+  return call_uplo(id, Signature::bffffB, sd, unit, bottom,
+                   makeRun(a, offset_a, stride_a, nullptr, 0, 0, nullptr, result, offset, stride, sa, sha, sb, shb),
+                   result);
+}
+
+float* Ferrum::CpuEngine::uplo_bbffffB(Ferrum::FunctionID id, int sd, int unit, int bottom,
+                                       const float* a, int lena, int offset_a, int stride_a,
+                                       const float* b, int lenb, int offset_b, int stride_b,
+                                       float sa, float sha,
+                                       float sb, float shb,
+                                       float* result, int len, int offset, int stride) {
+  CHECK_UPLO("a", lena, offset_a, stride_a);
+  CHECK_UPLO("b", lenb, offset_b, stride_b);
+  CHECK_UPLO("result", len, offset, stride);
+  return call_uplo(id, Signature::bbffffB, sd, unit, bottom,
+                   makeRun(a, offset_a, stride_a, b, offset_b, stride_b, nullptr, result, offset, stride, sa, sha, sb, shb),
+                   result);
+}
+
+
+// double precision functions, with the same checks as the float ones
+double* Ferrum::CpuEngine::dvect_bB(Ferrum::FunctionID id, const double* a, int lena, int offset_a, int stride_a,
+                                    double* result, int len, int offset, int stride) {
+  CpuRunOf<double> run = makeRun(a, offset_a, stride_a, nullptr, 0, 0, nullptr, result, offset, stride);
+  run.n = vectorCount(lena, offset_a, stride_a);
+  return call_vect(id, Signature::bB, run, vectorCount(len, offset, stride), result);
+}
+
+double* Ferrum::CpuEngine::dvect_bfB(Ferrum::FunctionID id, const double* a, int lena, int offset_a, int stride_a,
+                                     double sa,
+                                     double* result, int len, int offset, int stride) {
+  CpuRunOf<double> run = makeRun(a, offset_a, stride_a, nullptr, 0, 0, nullptr, result, offset, stride, sa);
+  run.n = vectorCount(lena, offset_a, stride_a);
+  return call_vect(id, Signature::bfB, run, vectorCount(len, offset, stride), result);
+}
+
+double* Ferrum::CpuEngine::dvect_fbB(Ferrum::FunctionID id, double sa,
+                                     const double* a, int lena, int offset_a, int stride_a,
+                                     double* result, int len, int offset, int stride) {
+  CpuRunOf<double> run = makeRun(a, offset_a, stride_a, nullptr, 0, 0, nullptr, result, offset, stride, sa);
+  run.n = vectorCount(lena, offset_a, stride_a);
+  return call_vect(id, Signature::fbB, run, vectorCount(len, offset, stride), result);
+}
+
+double* Ferrum::CpuEngine::dvect_bbB(Ferrum::FunctionID id, const double* a, int lena, int offset_a, int stride_a,
+                                     const double* b, int lenb, int offset_b, int stride_b,
+                                     double* result, int len, int offset, int stride) {
+  CpuRunOf<double> run = makeRun(a, offset_a, stride_a, b, offset_b, stride_b, nullptr, result, offset, stride);
+  run.n = std::min(vectorCount(lena, offset_a, stride_a), vectorCount(lenb, offset_b, stride_b));
+  return call_vect(id, Signature::bbB, run, vectorCount(len, offset, stride), result);
+}
+
+double* Ferrum::CpuEngine::dvect_bBB(Ferrum::FunctionID id, const double* a, int lena, int offset_a, int stride_a,
+                                     double* b, int lenb, int offset_b, int stride_b,
+                                     double* result, int len, int offset, int stride) {
+  CpuRunOf<double> run = makeRun(a, offset_a, stride_a, nullptr, offset_b, stride_b, b, result, offset, stride);
+  run.n = std::min(vectorCount(lena, offset_a, stride_a), vectorCount(lenb, offset_b, stride_b));
+  return call_vect(id, Signature::bBB, run, vectorCount(len, offset, stride), result);
+}
+
+double* Ferrum::CpuEngine::dvect_bffffB(Ferrum::FunctionID id, const double* a, int lena, int offset_a, int stride_a,
+                                        double sa, double sha,
+                                        double sb, double shb,
+                                        double* result, int len, int offset, int stride) {
+  CpuRunOf<double> run = makeRun(a, offset_a, stride_a, nullptr, 0, 0, nullptr, result, offset, stride, sa, sha, sb, shb);
+  run.n = vectorCount(lena, offset_a, stride_a);
+  return call_vect(id, Signature::bffffB, run, vectorCount(len, offset, stride), result);
+}
+
+double* Ferrum::CpuEngine::dvect_bbffffB(Ferrum::FunctionID id, const double* a, int lena, int offset_a, int stride_a,
+                                         const double* b, int lenb, int offset_b, int stride_b,
+                                         double sa, double sha,
+                                         double sb, double shb,
+                                         double* result, int len, int offset, int stride) {
+  CpuRunOf<double> run = makeRun(a, offset_a, stride_a, b, offset_b, stride_b, nullptr, result, offset, stride, sa, sha, sb, shb);
+  run.n = std::min(vectorCount(lena, offset_a, stride_a), vectorCount(lenb, offset_b, stride_b));
+  return call_vect(id, Signature::bbffffB, run, vectorCount(len, offset, stride), result);
+}
+
+double* Ferrum::CpuEngine::dge_bB(Ferrum::FunctionID id, int sd, int fd,
+                                  const double* a, int lena, int offset_a, int stride_a,
+                                  double* result, int len, int offset, int stride) {
+  CHECK_GE("a", lena, offset_a, stride_a, sd, fd);
+  CHECK_GE("result", len, offset, stride, sd, fd);
+  return call_ge(id, Signature::bB, sd, fd,
+                 makeRun(a, offset_a, stride_a, nullptr, 0, 0, nullptr, result, offset, stride), result);
+}
+
+double* Ferrum::CpuEngine::dge_bfB(Ferrum::FunctionID id, int sd, int fd,
+                                   const double* a, int lena, int offset_a, int stride_a,
+                                   double sa,
+                                   double* result, int len, int offset, int stride) {
+  CHECK_GE("a", lena, offset_a, stride_a, sd, fd);
+  CHECK_GE("result", len, offset, stride, sd, fd);
+  return call_ge(id, Signature::bfB, sd, fd,
+                 makeRun(a, offset_a, stride_a, nullptr, 0, 0, nullptr, result, offset, stride, sa), result);
+}
+
+double* Ferrum::CpuEngine::dge_fbB(Ferrum::FunctionID id, int sd, int fd, double sa,
+                                   const double* a, int lena, int offset_a, int stride_a,
+                                   double* result, int len, int offset, int stride) {
+  CHECK_GE("a", lena, offset_a, stride_a, sd, fd);
+  CHECK_GE("result", len, offset, stride, sd, fd);
+  return call_ge(id, Signature::fbB, sd, fd,
+                 makeRun(a, offset_a, stride_a, nullptr, 0, 0, nullptr, result, offset, stride, sa), result);
+}
+
+double* Ferrum::CpuEngine::dge_bbB(Ferrum::FunctionID id, int sd, int fd,
+                                   const double* a, int lena, int offset_a, int stride_a,
+                                   const double* b, int lenb, int offset_b, int stride_b,
+                                   double* result, int len, int offset, int stride) {
+  CHECK_GE("a", lena, offset_a, stride_a, sd, fd);
+  CHECK_GE("b", lenb, offset_b, stride_b, sd, fd);
+  CHECK_GE("result", len, offset, stride, sd, fd);
+  return call_ge(id, Signature::bbB, sd, fd,
+                 makeRun(a, offset_a, stride_a, b, offset_b, stride_b, nullptr, result, offset, stride), result);
+}
+
+double* Ferrum::CpuEngine::dge_bBB(Ferrum::FunctionID id, int sd, int fd,
+                                   const double* a, int lena, int offset_a, int stride_a,
+                                   double* b, int lenb, int offset_b, int stride_b,
+                                   double* result, int len, int offset, int stride) {
+  CHECK_GE("a", lena, offset_a, stride_a, sd, fd);
+  CHECK_GE("b", lenb, offset_b, stride_b, sd, fd);
+  CHECK_GE("result", len, offset, stride, sd, fd);
+  return call_ge(id, Signature::bBB, sd, fd,
+                 makeRun(a, offset_a, stride_a, nullptr, offset_b, stride_b, b, result, offset, stride), result);
+}
+
+double* Ferrum::CpuEngine::dge_bffffB(Ferrum::FunctionID id, int sd, int fd,
+                                      const double* a, int lena, int offset_a, int stride_a,
+                                      double sa, double sha,
+                                      double sb, double shb,
+                                      double* result, int len, int offset, int stride) {
+  CHECK_GE("a", lena, offset_a, stride_a, sd, fd);
+  CHECK_GE("result", len, offset, stride, sd, fd);
+  return call_ge(id, Signature::bffffB, sd, fd,
+                 makeRun(a, offset_a, stride_a, nullptr, 0, 0, nullptr, result, offset, stride, sa, sha, sb, shb),
+                 result);
+}
+
+double* Ferrum::CpuEngine::dge_bbffffB(Ferrum::FunctionID id, int sd, int fd,
+                                       const double* a, int lena, int offset_a, int stride_a,
+                                       const double* b, int lenb, int offset_b, int stride_b,
+                                       double sa, double sha,
+                                       double sb, double shb,
+                                       double* result, int len, int offset, int stride) {
+  CHECK_GE("a", lena, offset_a, stride_a, sd, fd);
+  CHECK_GE("b", lenb, offset_b, stride_b, sd, fd);
+  CHECK_GE("result", len, offset, stride, sd, fd);
+  return call_ge(id, Signature::bbffffB, sd, fd,
+                 makeRun(a, offset_a, stride_a, b, offset_b, stride_b, nullptr, result, offset, stride, sa, sha, sb, shb),
+                 result);
+}
+
+double* Ferrum::CpuEngine::duplo_bB(Ferrum::FunctionID id, int sd, int unit, int bottom,
+                                    const double* a, int lena, int offset_a, int stride_a,
+                                    double* result, int len, int offset, int stride) {
+  CHECK_UPLO("a", lena, offset_a, stride_a);
+  CHECK_UPLO("result", len, offset, stride);
+  return call_uplo(id, Signature::bB, sd, unit, bottom,
+                   makeRun(a, offset_a, stride_a, nullptr, 0, 0, nullptr, result, offset, stride), result);
+}
+
+double* Ferrum::CpuEngine::duplo_bfB(Ferrum::FunctionID id, int sd, int unit, int bottom,
+                                     const double* a, int lena, int offset_a, int stride_a,
+                                     double sa,
+                                     double* result, int len, int offset, int stride) {
+  CHECK_UPLO("a", lena, offset_a, stride_a);
+  CHECK_UPLO("result", len, offset, stride);
+  return call_uplo(id, Signature::bfB, sd, unit, bottom,
+                   makeRun(a, offset_a, stride_a, nullptr, 0, 0, nullptr, result, offset, stride, sa), result);
+}
+
+double* Ferrum::CpuEngine::duplo_fbB(Ferrum::FunctionID id, int sd, int unit, int bottom,
+                                     const double* a, int lena, int offset_a, int stride_a,
+                                     double sa,
+                                     double* result, int len, int offset, int stride) {
+  CHECK_UPLO("a", lena, offset_a, stride_a);
+  CHECK_UPLO("result", len, offset, stride);
+  return call_uplo(id, Signature::fbB, sd, unit, bottom,
+                   makeRun(a, offset_a, stride_a, nullptr, 0, 0, nullptr, result, offset, stride, sa), result);
+}
+
+double* Ferrum::CpuEngine::duplo_bbB(Ferrum::FunctionID id, int sd, int unit, int bottom,
+                                     const double* a, int lena, int offset_a, int stride_a,
+                                     const double* b, int lenb, int offset_b, int stride_b,
+                                     double* result, int len, int offset, int stride) {
+  CHECK_UPLO("a", lena, offset_a, stride_a);
+  CHECK_UPLO("b", lenb, offset_b, stride_b);
+  CHECK_UPLO("result", len, offset, stride);
+  return call_uplo(id, Signature::bbB, sd, unit, bottom,
+                   makeRun(a, offset_a, stride_a, b, offset_b, stride_b, nullptr, result, offset, stride), result);
+}
+
+double* Ferrum::CpuEngine::duplo_bBB(Ferrum::FunctionID id, int sd, int unit, int bottom,
+                                     const double* a, int lena, int offset_a, int stride_a,
+                                     double* b, int lenb, int offset_b, int stride_b,
+                                     double* result, int len, int offset, int stride) {
+  CHECK_UPLO("a", lena, offset_a, stride_a);
+  CHECK_UPLO("b", lenb, offset_b, stride_b);
+  CHECK_UPLO("result", len, offset, stride);
+  return call_uplo(id, Signature::bBB, sd, unit, bottom,
+                   makeRun(a, offset_a, stride_a, nullptr, offset_b, stride_b, b, result, offset, stride), result);
+}
+
+double* Ferrum::CpuEngine::duplo_bffffB(Ferrum::FunctionID id, int sd, int unit, int bottom,
+                                        const double* a, int lena, int offset_a, int stride_a,
+                                        double sa, double sha,
+                                        double sb, double shb,
+                                        double* result, int len, int offset, int stride) {
+  CHECK_UPLO("a", lena, offset_a, stride_a);
+  CHECK_UPLO("result", len, offset, stride);
+  return call_uplo(id, Signature::bffffB, sd, unit, bottom,
+                   makeRun(a, offset_a, stride_a, nullptr, 0, 0, nullptr, result, offset, stride, sa, sha, sb, shb),
+                   result);
+}
+
+double* Ferrum::CpuEngine::duplo_bbffffB(Ferrum::FunctionID id, int sd, int unit, int bottom,
+                                         const double* a, int lena, int offset_a, int stride_a,
+                                         const double* b, int lenb, int offset_b, int stride_b,
+                                         double sa, double sha,
+                                         double sb, double shb,
+                                         double* result, int len, int offset, int stride) {
+  CHECK_UPLO("a", lena, offset_a, stride_a);
+  CHECK_UPLO("b", lenb, offset_b, stride_b);
+  CHECK_UPLO("result", len, offset, stride);
+  return call_uplo(id, Signature::bbffffB, sd, unit, bottom,
+                   makeRun(a, offset_a, stride_a, b, offset_b, stride_b, nullptr, result, offset, stride, sa, sha, sb, shb),
+                   result);
+}
+
+
+// half precision functions, with the same checks as the float ones
+uint16_t* Ferrum::CpuEngine::hvect_bB(Ferrum::FunctionID id, HalfFormat format, const uint16_t* a, int lena, int offset_a, int stride_a,
+                                      uint16_t* result, int len, int offset, int stride) {
+  CpuRunOf<uint16_t> run = makeRun(a, offset_a, stride_a, nullptr, 0, 0, nullptr, result, offset, stride);
+  run.n = vectorCount(lena, offset_a, stride_a);
+  return call_half(id, format, Signature::bB, CpuStep::vect, 0, 0, run, vectorCount(len, offset, stride),
+                   {}, result);
+}
+
+uint16_t* Ferrum::CpuEngine::hvect_bfB(Ferrum::FunctionID id, HalfFormat format, const uint16_t* a, int lena, int offset_a, int stride_a,
+                                       float sa,
+                                       uint16_t* result, int len, int offset, int stride) {
+  CpuRunOf<uint16_t> run = makeRun(a, offset_a, stride_a, nullptr, 0, 0, nullptr, result, offset, stride);
+  run.n = vectorCount(lena, offset_a, stride_a);
+  return call_half(id, format, Signature::bfB, CpuStep::vect, 0, 0, run, vectorCount(len, offset, stride),
+                   {sa}, result);
+}
+
+uint16_t* Ferrum::CpuEngine::hvect_fbB(Ferrum::FunctionID id, HalfFormat format, float sa,
+                                       const uint16_t* a, int lena, int offset_a, int stride_a,
+                                       uint16_t* result, int len, int offset, int stride) {
+  CpuRunOf<uint16_t> run = makeRun(a, offset_a, stride_a, nullptr, 0, 0, nullptr, result, offset, stride);
+  run.n = vectorCount(lena, offset_a, stride_a);
+  return call_half(id, format, Signature::fbB, CpuStep::vect, 0, 0, run, vectorCount(len, offset, stride),
+                   {sa}, result);
+}
+
+uint16_t* Ferrum::CpuEngine::hvect_bbB(Ferrum::FunctionID id, HalfFormat format, const uint16_t* a, int lena, int offset_a, int stride_a,
+                                       const uint16_t* b, int lenb, int offset_b, int stride_b,
+                                       uint16_t* result, int len, int offset, int stride) {
+  CpuRunOf<uint16_t> run = makeRun(a, offset_a, stride_a, b, offset_b, stride_b, nullptr, result, offset, stride);
+  run.n = std::min(vectorCount(lena, offset_a, stride_a), vectorCount(lenb, offset_b, stride_b));
+  return call_half(id, format, Signature::bbB, CpuStep::vect, 0, 0, run, vectorCount(len, offset, stride),
+                   {}, result);
+}
+
+uint16_t* Ferrum::CpuEngine::hvect_bBB(Ferrum::FunctionID id, HalfFormat format, const uint16_t* a, int lena, int offset_a, int stride_a,
+                                       uint16_t* b, int lenb, int offset_b, int stride_b,
+                                       uint16_t* result, int len, int offset, int stride) {
+  CpuRunOf<uint16_t> run = makeRun(a, offset_a, stride_a, nullptr, offset_b, stride_b, b, result, offset, stride);
+  run.n = std::min(vectorCount(lena, offset_a, stride_a), vectorCount(lenb, offset_b, stride_b));
+  return call_half(id, format, Signature::bBB, CpuStep::vect, 0, 0, run, vectorCount(len, offset, stride),
+                   {}, result);
+}
+
+uint16_t* Ferrum::CpuEngine::hvect_bffffB(Ferrum::FunctionID id, HalfFormat format, const uint16_t* a, int lena, int offset_a, int stride_a,
+                                          float sa, float sha,
+                                          float sb, float shb,
+                                          uint16_t* result, int len, int offset, int stride) {
+  CpuRunOf<uint16_t> run = makeRun(a, offset_a, stride_a, nullptr, 0, 0, nullptr, result, offset, stride);
+  run.n = vectorCount(lena, offset_a, stride_a);
+  return call_half(id, format, Signature::bffffB, CpuStep::vect, 0, 0, run, vectorCount(len, offset, stride),
+                   {sa, sha, sb, shb}, result);
+}
+
+uint16_t* Ferrum::CpuEngine::hvect_bbffffB(Ferrum::FunctionID id, HalfFormat format, const uint16_t* a, int lena, int offset_a, int stride_a,
+                                           const uint16_t* b, int lenb, int offset_b, int stride_b,
+                                           float sa, float sha,
+                                           float sb, float shb,
+                                           uint16_t* result, int len, int offset, int stride) {
+  CpuRunOf<uint16_t> run = makeRun(a, offset_a, stride_a, b, offset_b, stride_b, nullptr, result, offset, stride);
+  run.n = std::min(vectorCount(lena, offset_a, stride_a), vectorCount(lenb, offset_b, stride_b));
+  return call_half(id, format, Signature::bbffffB, CpuStep::vect, 0, 0, run, vectorCount(len, offset, stride),
+                   {sa, sha, sb, shb}, result);
+}
+
+uint16_t* Ferrum::CpuEngine::hge_bB(Ferrum::FunctionID id, HalfFormat format, int sd, int fd,
+                                    const uint16_t* a, int lena, int offset_a, int stride_a,
+                                    uint16_t* result, int len, int offset, int stride) {
+  CHECK_GE("a", lena, offset_a, stride_a, sd, fd);
+  CHECK_GE("result", len, offset, stride, sd, fd);
+  return call_half(id, format, Signature::bB, CpuStep::ge, sd, fd, makeRun(a, offset_a, stride_a, nullptr, 0, 0, nullptr, result, offset, stride), 0,
+                   {}, result);
+}
+
+uint16_t* Ferrum::CpuEngine::hge_bfB(Ferrum::FunctionID id, HalfFormat format, int sd, int fd,
+                                     const uint16_t* a, int lena, int offset_a, int stride_a,
+                                     float sa,
+                                     uint16_t* result, int len, int offset, int stride) {
+  CHECK_GE("a", lena, offset_a, stride_a, sd, fd);
+  CHECK_GE("result", len, offset, stride, sd, fd);
+  return call_half(id, format, Signature::bfB, CpuStep::ge, sd, fd, makeRun(a, offset_a, stride_a, nullptr, 0, 0, nullptr, result, offset, stride), 0,
+                   {sa}, result);
+}
+
+uint16_t* Ferrum::CpuEngine::hge_fbB(Ferrum::FunctionID id, HalfFormat format, int sd, int fd, float sa,
+                                     const uint16_t* a, int lena, int offset_a, int stride_a,
+                                     uint16_t* result, int len, int offset, int stride) {
+  CHECK_GE("a", lena, offset_a, stride_a, sd, fd);
+  CHECK_GE("result", len, offset, stride, sd, fd);
+  return call_half(id, format, Signature::fbB, CpuStep::ge, sd, fd, makeRun(a, offset_a, stride_a, nullptr, 0, 0, nullptr, result, offset, stride), 0,
+                   {sa}, result);
+}
+
+uint16_t* Ferrum::CpuEngine::hge_bbB(Ferrum::FunctionID id, HalfFormat format, int sd, int fd,
+                                     const uint16_t* a, int lena, int offset_a, int stride_a,
+                                     const uint16_t* b, int lenb, int offset_b, int stride_b,
+                                     uint16_t* result, int len, int offset, int stride) {
+  CHECK_GE("a", lena, offset_a, stride_a, sd, fd);
+  CHECK_GE("b", lenb, offset_b, stride_b, sd, fd);
+  CHECK_GE("result", len, offset, stride, sd, fd);
+  return call_half(id, format, Signature::bbB, CpuStep::ge, sd, fd, makeRun(a, offset_a, stride_a, b, offset_b, stride_b, nullptr, result, offset, stride), 0,
+                   {}, result);
+}
+
+uint16_t* Ferrum::CpuEngine::hge_bBB(Ferrum::FunctionID id, HalfFormat format, int sd, int fd,
+                                     const uint16_t* a, int lena, int offset_a, int stride_a,
+                                     uint16_t* b, int lenb, int offset_b, int stride_b,
+                                     uint16_t* result, int len, int offset, int stride) {
+  CHECK_GE("a", lena, offset_a, stride_a, sd, fd);
+  CHECK_GE("b", lenb, offset_b, stride_b, sd, fd);
+  CHECK_GE("result", len, offset, stride, sd, fd);
+  return call_half(id, format, Signature::bBB, CpuStep::ge, sd, fd, makeRun(a, offset_a, stride_a, nullptr, offset_b, stride_b, b, result, offset, stride), 0,
+                   {}, result);
+}
+
+uint16_t* Ferrum::CpuEngine::hge_bffffB(Ferrum::FunctionID id, HalfFormat format, int sd, int fd,
+                                        const uint16_t* a, int lena, int offset_a, int stride_a,
+                                        float sa, float sha,
+                                        float sb, float shb,
+                                        uint16_t* result, int len, int offset, int stride) {
+  CHECK_GE("a", lena, offset_a, stride_a, sd, fd);
+  CHECK_GE("result", len, offset, stride, sd, fd);
+  return call_half(id, format, Signature::bffffB, CpuStep::ge, sd, fd, makeRun(a, offset_a, stride_a, nullptr, 0, 0, nullptr, result, offset, stride), 0,
+                   {sa, sha, sb, shb}, result);
+}
+
+uint16_t* Ferrum::CpuEngine::hge_bbffffB(Ferrum::FunctionID id, HalfFormat format, int sd, int fd,
+                                         const uint16_t* a, int lena, int offset_a, int stride_a,
+                                         const uint16_t* b, int lenb, int offset_b, int stride_b,
+                                         float sa, float sha,
+                                         float sb, float shb,
+                                         uint16_t* result, int len, int offset, int stride) {
+  CHECK_GE("a", lena, offset_a, stride_a, sd, fd);
+  CHECK_GE("b", lenb, offset_b, stride_b, sd, fd);
+  CHECK_GE("result", len, offset, stride, sd, fd);
+  return call_half(id, format, Signature::bbffffB, CpuStep::ge, sd, fd, makeRun(a, offset_a, stride_a, b, offset_b, stride_b, nullptr, result, offset, stride), 0,
+                   {sa, sha, sb, shb}, result);
+}
+
+
+// BLAS functions
+// Matrices are column major, with the stride of each buffer as its leading dimension
+
+#define CHECK_VECTOR(name, length, offset, stride, count)                                 \
+  if ((count) > 0 && vectorCount(length, offset, stride) < (count)) {                     \
+    std::cerr << "Error: Vector " << name << " does not fit in its buffer" << std::endl;  \
+    return nullptr;                                                                       \
+  }
+
+float* Ferrum::CpuEngine::ge_gemm(int trans_a, int trans_b, int m, int n, int k,
+                                  float alpha,
+                                  const float* a, int lena, int offset_a, int ld_a,
+                                  const float* b, int lenb, int offset_b, int ld_b,
+                                  float beta,
+                                  float* c, int lenc, int offset_c, int ld_c) {
+  if (m < 0 || n < 0 || k < 0) {
+    std::cerr << "Error: Negative matrix size for ge_gemm" << std::endl;
+    return nullptr;
+  }
+  // a is stored as k x m when it is transposed, and b as n x k
+  CHECK_GE("a", lena, offset_a, ld_a, trans_a ? k : m, trans_a ? m : k);
+  CHECK_GE("b", lenb, offset_b, ld_b, trans_b ? n : k, trans_b ? k : n);
+  CHECK_GE("c", lenc, offset_c, ld_c, m, n);
+  if (m == 0 || n == 0) {
+    return c;
+  }
+  CpuStep local;
+  CpuStep& step = stepFor(CpuStep::gemm, local);
+  step.product = {m, n, k, trans_a != 0, trans_b != 0, alpha, beta,
+               a + offset_a, ld_a, b + offset_b, ld_b, c + offset_c, ld_c};
+  return schedule(step, local, c);
+}
+
+float* Ferrum::CpuEngine::ge_mv(int trans, int m, int n, float alpha,
+                                const float* a, int lena, int offset_a, int ld_a,
+                                const float* x, int lenx, int offset_x, int stride_x,
+                                float beta,
+                                float* y, int leny, int offset_y, int stride_y) {
+  if (m < 0 || n < 0) {
+    std::cerr << "Error: Negative matrix size for ge_mv" << std::endl;
+    return nullptr;
+  }
+  CHECK_GE("a", lena, offset_a, ld_a, m, n);
+  CHECK_VECTOR("x", lenx, offset_x, stride_x, trans ? m : n);
+  CHECK_VECTOR("y", leny, offset_y, stride_y, trans ? n : m);
+  if ((trans ? n : m) == 0) {
+    return y;
+  }
+  CpuStep local;
+  CpuStep& step = stepFor(CpuStep::gemv, local);
+  step.mv = {m, n, trans != 0, alpha, beta, a + offset_a, ld_a,
+             x + offset_x, stride_x, y + offset_y, stride_y};
+  return schedule(step, local, y);
+}
+
+float* Ferrum::CpuEngine::ge_rk(int m, int n, float alpha,
+                                const float* x, int lenx, int offset_x, int stride_x,
+                                const float* y, int leny, int offset_y, int stride_y,
+                                float* a, int lena, int offset_a, int ld_a) {
+  if (m < 0 || n < 0) {
+    std::cerr << "Error: Negative matrix size for ge_rk" << std::endl;
+    return nullptr;
+  }
+  CHECK_VECTOR("x", lenx, offset_x, stride_x, m);
+  CHECK_VECTOR("y", leny, offset_y, stride_y, n);
+  CHECK_GE("a", lena, offset_a, ld_a, m, n);
+  if (m == 0 || n == 0) {
+    return a;
+  }
+  CpuStep local;
+  CpuStep& step = stepFor(CpuStep::rank1, local);
+  step.rk = {m, n, alpha, x + offset_x, stride_x, y + offset_y, stride_y, a + offset_a, ld_a};
+  return schedule(step, local, a);
+}
+
+float* Ferrum::CpuEngine::call_triangular(const char* name, bool solve, int left, int trans, int unit, int bottom,
+                                          int m, int n, float alpha,
+                                          const float* a, int lena, int offset_a, int ld_a,
+                                          float* b, int lenb, int offset_b, int ld_b) {
+  if (m < 0 || n < 0) {
+    std::cerr << "Error: Negative matrix size for " << name << std::endl;
+    return nullptr;
+  }
+  if (bottom == 0) {
+    std::cerr << "Error: No triangle for " << name << std::endl;
+    return nullptr;
+  }
+  int sd = left ? m : n;
+  CHECK_GE("a", lena, offset_a, ld_a, sd, sd);
+  CHECK_GE("b", lenb, offset_b, ld_b, m, n);
+  if (m == 0 || n == 0) {
+    return b;
+  }
+  // b * op(a) = (op(a)^T * b^T)^T
+  bool transposed = left ? trans != 0 : trans == 0;
+  CpuStep local;
+  CpuStep& step = stepFor(CpuStep::triangular, local);
+  step.tr = {solve, (bottom > 0) != transposed, unit == 132, sd, left ? n : m, alpha,
+             {const_cast<float*>(a) + offset_a, ld_a, transposed}, {b + offset_b, ld_b, left == 0}};
+  return schedule(step, local, b);
+}
+
+float* Ferrum::CpuEngine::uplo_trmv(int trans, int sd, int unit, int bottom,
+                                    const float* a, int lena, int offset_a, int ld_a,
+                                    float* x, int lenx, int offset_x, int stride_x) {
+  CHECK_VECTOR("x", lenx, offset_x, stride_x, sd);
+  // x is a row of b on the right, with the stride as its leading dimension: (op(a) * x)^T = x^T * op(a)^T
+  return call_triangular("uplo_trmv", false, 0, !trans, unit, bottom, 1, sd, 1.0f,
+                         a, lena, offset_a, ld_a, x, lenx, offset_x, stride_x);
+}
+
+float* Ferrum::CpuEngine::uplo_trsv(int trans, int sd, int unit, int bottom,
+                                    const float* a, int lena, int offset_a, int ld_a,
+                                    float* x, int lenx, int offset_x, int stride_x) {
+  CHECK_VECTOR("x", lenx, offset_x, stride_x, sd);
+  return call_triangular("uplo_trsv", true, 0, !trans, unit, bottom, 1, sd, 1.0f,
+                         a, lena, offset_a, ld_a, x, lenx, offset_x, stride_x);
+}
+
+float* Ferrum::CpuEngine::uplo_trmm(int left, int trans, int unit, int bottom, int m, int n, float alpha,
+                                    const float* a, int lena, int offset_a, int ld_a,
+                                    float* b, int lenb, int offset_b, int ld_b) {
+  return call_triangular("uplo_trmm", false, left, trans, unit, bottom, m, n, alpha,
+                         a, lena, offset_a, ld_a, b, lenb, offset_b, ld_b);
+}
+
+float* Ferrum::CpuEngine::uplo_trsm(int left, int trans, int unit, int bottom, int m, int n, float alpha,
+                                    const float* a, int lena, int offset_a, int ld_a,
+                                    float* b, int lenb, int offset_b, int ld_b) {
+  return call_triangular("uplo_trsm", true, left, trans, unit, bottom, m, n, alpha,
+                         a, lena, offset_a, ld_a, b, lenb, offset_b, ld_b);
+}
@@ -0,0 +1,158 @@
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "cpu_features.hpp"
+
+#if defined(__x86_64__)
+#include <cpuid.h>
+#endif
+
+namespace {
+
+  using Ferrum::CpuIsa;
+
+#if defined(__x86_64__)
+  // F16C is bit 29 of ECX for CPUID leaf 1. Every processor with AVX2 is expected to have it.
+  bool hasF16c() {
+    unsigned int eax, ebx, ecx, edx;
+    return __get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & (1u << 29)) != 0;
+  }
+#endif
+
+  // The highest instruction set that the processor supports
+  CpuIsa supportedIsa() {
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    // the avx2 and avx512 builds also use FMA, and convert half precision with F16C
+    bool avx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") && hasF16c();
+    if (avx2 && __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq")) {
+      return CpuIsa::avx512;
+    }
+    if (avx2) {
+      return CpuIsa::avx2;
+    }
+    if (__builtin_cpu_supports("sse4.2")) {
+      return CpuIsa::sse42;
+    }
+#endif
+    return CpuIsa::baseline;
+  }
+
+} // namespace
+
+
+const char* Ferrum::isaName(CpuIsa isa) {
+  switch (isa) {
+    case CpuIsa::sse42:
+      return "sse42";
+    case CpuIsa::avx2:
+      return "avx2";
+    case CpuIsa::avx512:
+      return "avx512";
+    default:
+#if defined(__aarch64__)
+      return "neon";
+#else
+      return "baseline";
+#endif
+  }
+}
+
+
+bool Ferrum::parseIsa(const std::string& name, CpuIsa& isa) {
+  for (CpuIsa i : {CpuIsa::baseline, CpuIsa::sse42, CpuIsa::avx2, CpuIsa::avx512}) {
+    if (name == isaName(i)) {
+      isa = i;
+      return true;
+    }
+  }
+  if (name == "baseline") {
+    isa = CpuIsa::baseline;
+    return true;
+  }
+  return false;
+}
+
+
+Ferrum::CpuIsa Ferrum::detectIsa() {
+  CpuIsa supported = supportedIsa();
+  const char* requested = std::getenv("FERRUM_CPU_ISA");
+  if (requested == nullptr) {
+    return supported;
+  }
+  CpuIsa isa;
+  if (!parseIsa(requested, isa)) {
+    std::cerr << "Error: Unknown instruction set: " << requested << std::endl;
+    return supported;
+  }
+  if (isa > supported) {
+    std::cerr << "Error: Instruction set not supported: " << requested << ", using " << isaName(supported) << std::endl;
+    return supported;
+  }
+  return isa;
+}
+
+
+const Ferrum::CpuKernel* Ferrum::simdKernel(CpuIsa isa, const std::string& name) {
+  switch (isa) {
+#if defined(__x86_64__)
+    case CpuIsa::sse42:
+      return simdKernel_sse42(name.c_str());
+    case CpuIsa::avx2:
+      return simdKernel_avx2(name.c_str());
+    case CpuIsa::avx512:
+      return simdKernel_avx512(name.c_str());
+#endif
+    default:
+      return simdKernel_baseline(name.c_str());
+  }
+}
+
+
+const Ferrum::CpuGemmKernel* Ferrum::simdGemm(CpuIsa isa) {
+  switch (isa) {
+#if defined(__x86_64__)
+    case CpuIsa::sse42:
+      return simdGemm_sse42();
+    case CpuIsa::avx2:
+      return simdGemm_avx2();
+    case CpuIsa::avx512:
+      return simdGemm_avx512();
+#endif
+    default:
+      return simdGemm_baseline();
+  }
+}
+
+
+const Ferrum::CpuLevel2Kernel* Ferrum::simdLevel2(CpuIsa isa) {
+  switch (isa) {
+#if defined(__x86_64__)
+    case CpuIsa::sse42:
+      return simdLevel2_sse42();
+    case CpuIsa::avx2:
+      return simdLevel2_avx2();
+    case CpuIsa::avx512:
+      return simdLevel2_avx512();
+#endif
+    default:
+      return simdLevel2_baseline();
+  }
+}
+
+
+const Ferrum::CpuHalfKernel* Ferrum::simdHalf(CpuIsa isa, HalfFormat format) {
+  switch (isa) {
+#if defined(__x86_64__)
+    case CpuIsa::sse42:
+      return simdHalf_sse42(format);
+    case CpuIsa::avx2:
+      return simdHalf_avx2(format);
+    case CpuIsa::avx512:
+      return simdHalf_avx512(format);
+#endif
+    default:
+      return simdHalf_baseline(format);
+  }
+}
@@ -0,0 +1,129 @@
+#include <algorithm>
+#include <vector>
+
+#include "cpu_gemm.hpp"
+#include "dispatch_plan.hpp"
+#include "thread_pool.hpp"
+
+// The blocking follows Goto and van de Geijn. For each slice of GEMM_NC columns of c, and each
+// GEMM_KC deep slice of the inner dimension, op(b) is packed into strips of nr columns and op(a)
+// into strips of mr rows, so that the register tile reads both panels with unit stride. The tiles
+// are then shared between threads, a block of GEMM_MC rows at a time.
+
+namespace {
+
+  using Ferrum::CpuGemm;
+
+  // Packs rows [row, row + mr) of op(a), over the inner dimension [depth, depth + kc), as kc groups
+  // of mr elements. Rows past the end of the matrix are zero.
+  void packA(const CpuGemm& g, ptrdiff_t row, ptrdiff_t depth, ptrdiff_t kc, ptrdiff_t mr, float* out) {
+    ptrdiff_t rows = std::min(mr, g.m - row);
+    std::fill(out, out + kc * mr, 0.0f);
+    if (g.transA) {
+      for (ptrdiff_t i = 0; i < rows; i++) {
+        const float* a = g.a + depth + (row + i) * g.lda;
+        for (ptrdiff_t p = 0; p < kc; p++) {
+          out[p * mr + i] = a[p];
+        }
+      }
+    } else {
+      for (ptrdiff_t p = 0; p < kc; p++) {
+        const float* a = g.a + row + (depth + p) * g.lda;
+        for (ptrdiff_t i = 0; i < rows; i++) {
+          out[p * mr + i] = a[i];
+        }
+      }
+    }
+  }
+
+  // Packs columns [col, col + nr) of op(b) in the same way, as kc groups of nr elements
+  void packB(const CpuGemm& g, ptrdiff_t col, ptrdiff_t depth, ptrdiff_t kc, ptrdiff_t nr, float* out) {
+    ptrdiff_t cols = std::min(nr, g.n - col);
+    std::fill(out, out + kc * nr, 0.0f);
+    if (g.transB) {
+      for (ptrdiff_t p = 0; p < kc; p++) {
+        const float* b = g.b + col + (depth + p) * g.ldb;
+        for (ptrdiff_t j = 0; j < cols; j++) {
+          out[p * nr + j] = b[j];
+        }
+      }
+    } else {
+      for (ptrdiff_t j = 0; j < cols; j++) {
+        const float* b = g.b + depth + (col + j) * g.ldb;
+        for (ptrdiff_t p = 0; p < kc; p++) {
+          out[p * nr + j] = b[p];
+        }
+      }
+    }
+  }
+
+  // c = beta * c, for when there is no product to add. A zero beta clears c, even if it held NaN.
+  void scaleC(const CpuGemm& g) {
+    for (ptrdiff_t j = 0; j < g.n; j++) {
+      float* c = g.c + j * g.ldc;
+      for (ptrdiff_t i = 0; i < g.m; i++) {
+        c[i] = (g.beta == 0.0f) ? 0.0f : g.beta * c[i];
+      }
+    }
+  }
+
+} // namespace
+
+
+void Ferrum::runGemm(ThreadPool& pool, const CpuGemmKernel& kernel, const CpuGemm& g) {
+  if (g.m <= 0 || g.n <= 0) {
+    return;
+  }
+  if (g.k <= 0 || g.alpha == 0.0f) {
+    scaleC(g);
+    return;
+  }
+  const ptrdiff_t mr = kernel.mr;
+  const ptrdiff_t nr = kernel.nr;
+  const ptrdiff_t kcMax = GEMM_KC;
+  const ptrdiff_t ncMax = GEMM_NC;
+  const ptrdiff_t mc = std::max<ptrdiff_t>(GEMM_MC / mr, 1) * mr;
+
+  ptrdiff_t rowStrips = (g.m + mr - 1) / mr;
+  ptrdiff_t rowBlocks = (g.m + mc - 1) / mc;
+  std::vector<float> packedA(rowStrips * mr * std::min(kcMax, g.k));
+  std::vector<float> packedB(roundUp(std::min(ncMax, g.n), nr) * std::min(kcMax, g.k));
+
+  for (ptrdiff_t jc = 0; jc < g.n; jc += ncMax) {
+    ptrdiff_t nc = std::min(ncMax, g.n - jc);
+    ptrdiff_t colStrips = (nc + nr - 1) / nr;
+    for (ptrdiff_t pc = 0; pc < g.k; pc += kcMax) {
+      ptrdiff_t kc = std::min(kcMax, g.k - pc);
+      // beta only applies the first time that a tile of c is written
+      float beta = (pc == 0) ? g.beta : 1.0f;
+
+      pool.parallelFor(colStrips, 1, [&](size_t begin, size_t end) {
+        for (size_t s = begin; s < end; s++) {
+          packB(g, jc + s * nr, pc, kc, nr, packedB.data() + s * nr * kc);
+        }
+      });
+      pool.parallelFor(rowStrips, 1, [&](size_t begin, size_t end) {
+        for (size_t s = begin; s < end; s++) {
+          packA(g, s * mr, pc, kc, mr, packedA.data() + s * mr * kc);
+        }
+      });
+
+      // Each task is a strip of columns across a block of rows. Tasks are ordered by block, so that
+      // each thread works through the strips of a block while the block stays in its cache.
+      pool.parallelFor(rowBlocks * colStrips, 1, [&](size_t begin, size_t end) {
+        for (size_t t = begin; t < end; t++) {
+          ptrdiff_t block = t / colStrips;
+          ptrdiff_t strip = t % colStrips;
+          ptrdiff_t col = jc + strip * nr;
+          ptrdiff_t cols = std::min(nr, g.n - col);
+          const float* b = packedB.data() + strip * nr * kc;
+          ptrdiff_t last = std::min(g.m, (block + 1) * mc);
+          for (ptrdiff_t row = block * mc; row < last; row += mr) {
+            kernel.run(kc, packedA.data() + row * kc, b, g.alpha, beta,
+                       g.c + row + col * g.ldc, g.ldc, std::min(mr, g.m - row), cols);
+          }
+        }
+      });
+    }
+  }
+}
@@ -0,0 +1,459 @@
+#include <cstring>
+
+#include "cpu_blas.hpp"
+#include "cpu_engine.hpp"
+#include "cpu_features.hpp"
+#include "cpu_gemm.hpp"
+#include "cpu_math.hpp"
+#include "cpu_simd.hpp"
+
+// This file is compiled once for each instruction set, with FERRUM_SIMD_ISA naming the build.
+// Inline functions and templates from other headers could be shared between the builds by
+// the linker, and run on a processor without the instructions they were compiled with.
+// So outside of cpu_simd.hpp, this only uses C functions and plain arrays.
+
+#define FERRUM_PASTE_NAME(a, b) a##b
+#define FERRUM_SIMD_KERNEL(isa) FERRUM_PASTE_NAME(simdKernel_, isa)
+#define FERRUM_SIMD_GEMM(isa) FERRUM_PASTE_NAME(simdGemm_, isa)
+#define FERRUM_SIMD_LEVEL2(isa) FERRUM_PASTE_NAME(simdLevel2_, isa)
+#define FERRUM_SIMD_HALF(isa) FERRUM_PASTE_NAME(simdHalf_, isa)
+
+namespace {
+
+  using Ferrum::CpuKernel;
+  using Ferrum::CpuRun;
+  using Ferrum::Signature;
+  using namespace Ferrum::Simd;
+  namespace Simd = Ferrum::Simd;
+
+  // The element operations of cpu_engine.cpp, on a vector of elements at a time
+  namespace Ops {
+    inline VecF copy(VecF x) { return x; }
+    inline VecF sqr(VecF x) { return x * x; }
+    inline VecF inv(VecF x) { return 1.0f / x; }
+    inline VecF abs(VecF x) { return Simd::abs(x); }
+    inline VecF sqrt(VecF x) { return Simd::sqrt(x); }
+    inline VecF inv_sqrt(VecF x) { return 1.0f / Simd::sqrt(x); }
+    inline VecF cbrt(VecF x) { return Simd::pow(x, splat(Ferrum::CpuMath::REAL1o3<float>)); }
+    inline VecF inv_cbrt(VecF x) { return 1.0f / Simd::pow(x, splat(Ferrum::CpuMath::REAL1o3<float>)); }
+    inline VecF pow2o3(VecF x) { return Simd::pow(x, splat(Ferrum::CpuMath::REAL2o3<float>)); }
+    inline VecF pow3o2(VecF x) { return Simd::pow(x, splat(Ferrum::CpuMath::REAL3o2<float>)); }
+    inline VecF exp(VecF x) { return Simd::exp(x); }
+    inline VecF exp2(VecF x) { return Simd::exp2(x); }
+    inline VecF exp10(VecF x) { return Simd::exp10(x); }
+    inline VecF expm1(VecF x) { return Simd::expm1(x); }
+    inline VecF log(VecF x) { return Simd::log(x); }
+    inline VecF log2(VecF x) { return Simd::log2(x); }
+    inline VecF log10(VecF x) { return Simd::log10(x); }
+    inline VecF log1p(VecF x) { return Simd::log1p(x); }
+    inline VecF sin(VecF x) { return Simd::sin(x); }
+    inline VecF cos(VecF x) { return Simd::cos(x); }
+    inline VecF tan(VecF x) { return Simd::tan(x); }
+    inline VecF asin(VecF x) { return Simd::asin(x); }
+    inline VecF acos(VecF x) { return Simd::acos(x); }
+    inline VecF atan(VecF x) { return Simd::atan(x); }
+    inline VecF sinh(VecF x) { return Simd::sinh(x); }
+    inline VecF cosh(VecF x) { return Simd::cosh(x); }
+    inline VecF tanh(VecF x) { return Simd::tanh(x); }
+    inline VecF asinh(VecF x) { return Simd::asinh(x); }
+    inline VecF acosh(VecF x) { return Simd::acosh(x); }
+    inline VecF atanh(VecF x) { return Simd::atanh(x); }
+    inline VecF erf(VecF x) { return Simd::erf(x); }
+    inline VecF erf_inv(VecF x) { return Simd::erfinv(x); }
+    inline VecF erfc(VecF x) { return Simd::erfc(x); }
+    inline VecF erfc_inv(VecF x) { return Simd::erfcinv(x); }
+    inline VecF cdf_norm(VecF x) { return Simd::normcdf(x); }
+    inline VecF cdf_norm_inv(VecF x) { return Simd::normcdfinv(x); }
+    inline VecF gamma(VecF x) { return Simd::tgamma(x); }
+    inline VecF lgamma(VecF x) { return Simd::lgamma(x); }
+    inline VecF floor(VecF x) { return Simd::floor(x); }
+    inline VecF ceil(VecF x) { return Simd::ceil(x); }
+    inline VecF trunc(VecF x) { return Simd::trunc(x); }
+    inline VecF round(VecF x) { return Simd::round(x); }
+    inline VecF frac(VecF x) { return x - Simd::trunc(x); }
+    inline VecF sigmoid(VecF x) { return Simd::tanh(0.5f * x) * 0.5f + 0.5f; }
+    inline VecF ramp(VecF x) { return Simd::fmax(x, splat(0.0f)); }
+
+    inline VecF mul(VecF x, VecF y) { return x * y; }
+    inline VecF div(VecF x, VecF y) { return x / y; }
+    inline VecF add(VecF x, VecF y) { return x + y; }
+    inline VecF sub(VecF x, VecF y) { return x - y; }
+    inline VecF frem(VecF x, VecF y) { return Simd::remainder(x, y); }
+    inline VecF pow(VecF x, VecF y) { return Simd::pow(x, y); }
+    inline VecF hypot(VecF x, VecF y) { return Simd::hypot(x, y); }
+    inline VecF atan2(VecF x, VecF y) { return Simd::atan2(x, y); }
+    inline VecF fmax(VecF x, VecF y) { return Simd::fmax(x, y); }
+    inline VecF fmin(VecF x, VecF y) { return Simd::fmin(x, y); }
+    inline VecF copysign(VecF x, VecF y) { return Simd::copysign(x, y); }
+
+    // operations on an element and a scalar parameter
+    inline VecF powx(VecF x, VecF b) { return Simd::pow(x, b); }
+    inline VecF relu(VecF x, VecF alpha) { return Simd::fmax(x, alpha * x); }
+    inline VecF elu(VecF x, VecF alpha) { return Simd::fmax(x, alpha * Simd::expm1(x)); }
+    inline VecF set(VecF, VecF val) { return val; }
+
+    // operations with two results: the first goes to the in/out buffer, the second to the result
+    inline void sincos(VecF x, VecF& y, VecF& z) { Simd::sincos(x, y, z); }
+    inline void modf(VecF x, VecF& y, VecF& z) { y = Simd::trunc(x); z = x - y; }
+  }
+
+  // Runs an elementwise body over a run, WIDTH elements at a time. Unit strides are loaded
+  // directly. Strided runs, and the end of a unit stride run, are gathered a lane at a time,
+  // so every element goes through the same vector code.
+  template <bool READS_Y, typename Body>
+  inline void vectors(const CpuRun& r, Body body) {
+    ptrdiff_t i = 0;
+    if (r.incx == 1 && r.incr == 1 && (!READS_Y || r.incy == 1)) {
+      for (; i + WIDTH <= r.n; i += WIDTH) {
+        VecF y = READS_Y ? load(r.y + i) : VecF{};
+        store(r.r + i, body(load(r.x + i), y));
+      }
+    }
+    for (; i < r.n; i += WIDTH) {
+      ptrdiff_t m = (r.n - i < WIDTH) ? r.n - i : WIDTH;
+      VecF x = gather(r.x + i * r.incx, r.incx, m);
+      VecF y = READS_Y ? gather(r.y + i * r.incy, r.incy, m) : VecF{};
+      scatter(r.r + i * r.incr, r.incr, m, body(x, y));
+    }
+  }
+
+  template <VecF (*F)(VecF)>
+  void unaryRun(const CpuRun& r) {
+    vectors<false>(r, [](VecF x, VecF) { return F(x); });
+  }
+
+  template <VecF (*F)(VecF, VecF)>
+  void binaryRun(const CpuRun& r) {
+    vectors<true>(r, [](VecF x, VecF y) { return F(x, y); });
+  }
+
+  template <VecF (*F)(VecF, VecF)>
+  void scalarRun(const CpuRun& r) {
+    const VecF s = splat(r.s[0]);
+    vectors<false>(r, [=](VecF x, VecF) { return F(x, s); });
+  }
+
+  template <void (*F)(VecF, VecF&, VecF&)>
+  void pairRun(const CpuRun& r) {
+    for (ptrdiff_t i = 0; i < r.n; i += WIDTH) {
+      ptrdiff_t m = (r.n - i < WIDTH) ? r.n - i : WIDTH;
+      VecF first, second;
+      F(gather(r.x + i * r.incx, r.incx, m), first, second);
+      scatter(r.r2 + i * r.incr2, r.incr2, m, first);
+      scatter(r.r + i * r.incr, r.incr, m, second);
+    }
+  }
+
+  void scaleShiftRun(const CpuRun& r) {
+    const VecF sa = splat(r.s[0]), sha = splat(r.s[1]);
+    vectors<false>(r, [=](VecF x, VecF) { return sa * x + sha; });
+  }
+
+  void linearFracRun(const CpuRun& r) {
+    const VecF sa = splat(r.s[0]), sha = splat(r.s[1]), sb = splat(r.s[2]), shb = splat(r.s[3]);
+    vectors<true>(r, [=](VecF x, VecF y) { return (sa * x + sha) / (sb * y + shb); });
+  }
+
+  // The register tile of matrix products: GEMM_VECTORS vectors down each column, and as many
+  // columns as leave registers for loading a and b
+  const int GEMM_VECTORS = 2;
+  const int GEMM_MR = GEMM_VECTORS * WIDTH;
+#if defined(__AVX512F__) || defined(__aarch64__)
+  // 32 vector registers
+  const int GEMM_NR = 12;
+#else
+  const int GEMM_NR = 6;
+#endif
+
+  void gemmTile(ptrdiff_t k, const float* a, const float* b, float alpha, float beta,
+                float* c, ptrdiff_t ldc, ptrdiff_t rows, ptrdiff_t cols) {
+    VecF acc[GEMM_NR][GEMM_VECTORS] = {};
+    for (ptrdiff_t p = 0; p < k; p++) {
+      VecF av[GEMM_VECTORS];
+#pragma GCC unroll 4
+      for (int v = 0; v < GEMM_VECTORS; v++) {
+        av[v] = load(a + p * GEMM_MR + v * WIDTH);
+      }
+#pragma GCC unroll 12
+      for (int j = 0; j < GEMM_NR; j++) {
+        VecF bj = splat(b[p * GEMM_NR + j]);
+#pragma GCC unroll 4
+        for (int v = 0; v < GEMM_VECTORS; v++) {
+          acc[j][v] = fma(av[v], bj, acc[j][v]);
+        }
+      }
+    }
+    if (rows == GEMM_MR && cols == GEMM_NR) {
+      for (int j = 0; j < GEMM_NR; j++) {
+        for (int v = 0; v < GEMM_VECTORS; v++) {
+          float* cv = c + j * ldc + v * WIDTH;
+          VecF r = acc[j][v] * alpha;
+          store(cv, (beta == 0.0f) ? r : fma(load(cv), splat(beta), r));
+        }
+      }
+      return;
+    }
+    // a tile at the edge of c
+    for (ptrdiff_t j = 0; j < cols; j++) {
+      float column[GEMM_MR];
+      for (int v = 0; v < GEMM_VECTORS; v++) {
+        store(column + v * WIDTH, acc[j][v] * alpha);
+      }
+      float* cj = c + j * ldc;
+      for (ptrdiff_t i = 0; i < rows; i++) {
+        cj[i] = (beta == 0.0f) ? column[i] : column[i] + beta * cj[i];
+      }
+    }
+  }
+
+  const Ferrum::CpuGemmKernel gemmKernel = {GEMM_MR, GEMM_NR, gemmTile};
+
+  // The sum of the lanes of a vector
+  float sumLanes(VecF v) {
+    float lanes[WIDTH];
+    store(lanes, v);
+    for (int w = WIDTH / 2; w > 0; w /= 2) {
+      for (int i = 0; i < w; i++) {
+        lanes[i] += lanes[i + w];
+      }
+    }
+    return lanes[0];
+  }
+
+  // Matrix-vector products read a column at a time, adding four columns to each load of y
+  void gemvColumns(ptrdiff_t rows, ptrdiff_t cols, const float* a, ptrdiff_t lda,
+                   const float* x, ptrdiff_t incx, float* y) {
+    ptrdiff_t j = 0;
+    for (; j + 4 <= cols; j += 4) {
+      const float* a0 = a + j * lda;
+      const float* a1 = a0 + lda;
+      const float* a2 = a1 + lda;
+      const float* a3 = a2 + lda;
+      float x0 = x[j * incx];
+      float x1 = x[(j + 1) * incx];
+      float x2 = x[(j + 2) * incx];
+      float x3 = x[(j + 3) * incx];
+      ptrdiff_t i = 0;
+      for (; i + WIDTH <= rows; i += WIDTH) {
+        VecF v = load(y + i);
+        v = fma(load(a0 + i), splat(x0), v);
+        v = fma(load(a1 + i), splat(x1), v);
+        v = fma(load(a2 + i), splat(x2), v);
+        v = fma(load(a3 + i), splat(x3), v);
+        store(y + i, v);
+      }
+      for (; i < rows; i++) {
+        y[i] += a0[i] * x0 + a1[i] * x1 + a2[i] * x2 + a3[i] * x3;
+      }
+    }
+    for (; j < cols; j++) {
+      const float* aj = a + j * lda;
+      float xj = x[j * incx];
+      ptrdiff_t i = 0;
+      for (; i + WIDTH <= rows; i += WIDTH) {
+        store(y + i, fma(load(aj + i), splat(xj), load(y + i)));
+      }
+      for (; i < rows; i++) {
+        y[i] += aj[i] * xj;
+      }
+    }
+  }
+
+  // Transposed, four columns share each load of x
+  void gemvDots(ptrdiff_t rows, ptrdiff_t cols, const float* a, ptrdiff_t lda, const float* x, float* out) {
+    ptrdiff_t j = 0;
+    for (; j + 4 <= cols; j += 4) {
+      const float* a0 = a + j * lda;
+      const float* a1 = a0 + lda;
+      const float* a2 = a1 + lda;
+      const float* a3 = a2 + lda;
+      VecF s0 = {}, s1 = {}, s2 = {}, s3 = {};
+      ptrdiff_t i = 0;
+      for (; i + WIDTH <= rows; i += WIDTH) {
+        VecF xv = load(x + i);
+        s0 = fma(load(a0 + i), xv, s0);
+        s1 = fma(load(a1 + i), xv, s1);
+        s2 = fma(load(a2 + i), xv, s2);
+        s3 = fma(load(a3 + i), xv, s3);
+      }
+      float d0 = sumLanes(s0), d1 = sumLanes(s1), d2 = sumLanes(s2), d3 = sumLanes(s3);
+      for (; i < rows; i++) {
+        d0 += a0[i] * x[i];
+        d1 += a1[i] * x[i];
+        d2 += a2[i] * x[i];
+        d3 += a3[i] * x[i];
+      }
+      out[j] = d0;
+      out[j + 1] = d1;
+      out[j + 2] = d2;
+      out[j + 3] = d3;
+    }
+    for (; j < cols; j++) {
+      const float* aj = a + j * lda;
+      VecF s = {};
+      ptrdiff_t i = 0;
+      for (; i + WIDTH <= rows; i += WIDTH) {
+        s = fma(load(aj + i), load(x + i), s);
+      }
+      float d = sumLanes(s);
+      for (; i < rows; i++) {
+        d += aj[i] * x[i];
+      }
+      out[j] = d;
+    }
+  }
+
+  void rank1Update(ptrdiff_t rows, ptrdiff_t cols, float alpha, const float* x, const float* y, ptrdiff_t incy,
+                   float* a, ptrdiff_t lda) {
+    for (ptrdiff_t j = 0; j < cols; j++) {
+      float* aj = a + j * lda;
+      float s = alpha * y[j * incy];
+      ptrdiff_t i = 0;
+      for (; i + WIDTH <= rows; i += WIDTH) {
+        store(aj + i, fma(load(x + i), splat(s), load(aj + i)));
+      }
+      for (; i < rows; i++) {
+        aj[i] += x[i] * s;
+      }
+    }
+  }
+
+  const Ferrum::CpuLevel2Kernel level2Kernel = {gemvColumns, gemvDots, rank1Update};
+
+  // Half precision conversions, a vector at a time in the same way as the elementwise kernels
+  template <VecF (*Widen)(VecH)>
+  void loadHalf(const uint16_t* src, ptrdiff_t inc, ptrdiff_t n, float* dst) {
+    ptrdiff_t i = 0;
+    if (inc == 1) {
+      for (; i + WIDTH <= n; i += WIDTH) {
+        store(dst + i, Widen(loadH(src + i)));
+      }
+    }
+    for (; i < n; i += WIDTH) {
+      ptrdiff_t m = (n - i < WIDTH) ? n - i : WIDTH;
+      scatter(dst + i, 1, m, Widen(gatherH(src + i * inc, inc, m)));
+    }
+  }
+
+  template <VecH (*Narrow)(VecF)>
+  void storeHalf(const float* src, ptrdiff_t n, uint16_t* dst, ptrdiff_t inc) {
+    ptrdiff_t i = 0;
+    if (inc == 1) {
+      for (; i + WIDTH <= n; i += WIDTH) {
+        storeH(dst + i, Narrow(load(src + i)));
+      }
+    }
+    for (; i < n; i += WIDTH) {
+      ptrdiff_t m = (n - i < WIDTH) ? n - i : WIDTH;
+      scatterH(dst + i * inc, inc, m, Narrow(gather(src + i, 1, m)));
+    }
+  }
+
+  // indexed by HalfFormat
+  const Ferrum::CpuHalfKernel halfKernels[] = {
+    {loadHalf<fromFp16>, storeHalf<toFp16>},
+    {loadHalf<fromBf16>, storeHalf<toBf16>},
+  };
+
+  struct NamedKernel {
+    const char* name;
+    CpuKernel kernel;
+  };
+
+  // fmod and swap are not here, and use the scalar kernels. Reductions are all in cpu_engine.cpp.
+  const NamedKernel simdTable[] = {
+    {"copy", {Signature::bB, unaryRun<Ops::copy>, nullptr}},
+    {"sqr", {Signature::bB, unaryRun<Ops::sqr>, nullptr}},
+    {"inv", {Signature::bB, unaryRun<Ops::inv>, nullptr}},
+    {"abs", {Signature::bB, unaryRun<Ops::abs>, nullptr}},
+    {"sqrt", {Signature::bB, unaryRun<Ops::sqrt>, nullptr}},
+    {"inv_sqrt", {Signature::bB, unaryRun<Ops::inv_sqrt>, nullptr}},
+    {"cbrt", {Signature::bB, unaryRun<Ops::cbrt>, nullptr}},
+    {"inv_cbrt", {Signature::bB, unaryRun<Ops::inv_cbrt>, nullptr}},
+    {"pow2o3", {Signature::bB, unaryRun<Ops::pow2o3>, nullptr}},
+    {"pow3o2", {Signature::bB, unaryRun<Ops::pow3o2>, nullptr}},
+    {"exp", {Signature::bB, unaryRun<Ops::exp>, nullptr}},
+    {"exp2", {Signature::bB, unaryRun<Ops::exp2>, nullptr}},
+    {"exp10", {Signature::bB, unaryRun<Ops::exp10>, nullptr}},
+    {"expm1", {Signature::bB, unaryRun<Ops::expm1>, nullptr}},
+    {"log", {Signature::bB, unaryRun<Ops::log>, nullptr}},
+    {"log2", {Signature::bB, unaryRun<Ops::log2>, nullptr}},
+    {"log10", {Signature::bB, unaryRun<Ops::log10>, nullptr}},
+    {"log1p", {Signature::bB, unaryRun<Ops::log1p>, nullptr}},
+    {"sin", {Signature::bB, unaryRun<Ops::sin>, nullptr}},
+    {"cos", {Signature::bB, unaryRun<Ops::cos>, nullptr}},
+    {"tan", {Signature::bB, unaryRun<Ops::tan>, nullptr}},
+    {"asin", {Signature::bB, unaryRun<Ops::asin>, nullptr}},
+    {"acos", {Signature::bB, unaryRun<Ops::acos>, nullptr}},
+    {"atan", {Signature::bB, unaryRun<Ops::atan>, nullptr}},
+    {"sinh", {Signature::bB, unaryRun<Ops::sinh>, nullptr}},
+    {"cosh", {Signature::bB, unaryRun<Ops::cosh>, nullptr}},
+    {"tanh", {Signature::bB, unaryRun<Ops::tanh>, nullptr}},
+    {"asinh", {Signature::bB, unaryRun<Ops::asinh>, nullptr}},
+    {"acosh", {Signature::bB, unaryRun<Ops::acosh>, nullptr}},
+    {"atanh", {Signature::bB, unaryRun<Ops::atanh>, nullptr}},
+    {"erf", {Signature::bB, unaryRun<Ops::erf>, nullptr}},
+    {"erf_inv", {Signature::bB, unaryRun<Ops::erf_inv>, nullptr}},
+    {"erfc", {Signature::bB, unaryRun<Ops::erfc>, nullptr}},
+    {"erfc_inv", {Signature::bB, unaryRun<Ops::erfc_inv>, nullptr}},
+    {"erfcinv", {Signature::bB, unaryRun<Ops::erfc_inv>, nullptr}},
+    {"cdf_norm", {Signature::bB, unaryRun<Ops::cdf_norm>, nullptr}},
+    {"cdf_norm_inv", {Signature::bB, unaryRun<Ops::cdf_norm_inv>, nullptr}},
+    {"gamma", {Signature::bB, unaryRun<Ops::gamma>, nullptr}},
+    {"lgamma", {Signature::bB, unaryRun<Ops::lgamma>, nullptr}},
+    {"floor", {Signature::bB, unaryRun<Ops::floor>, nullptr}},
+    {"ceil", {Signature::bB, unaryRun<Ops::ceil>, nullptr}},
+    {"trunc", {Signature::bB, unaryRun<Ops::trunc>, nullptr}},
+    {"round", {Signature::bB, unaryRun<Ops::round>, nullptr}},
+    {"frac", {Signature::bB, unaryRun<Ops::frac>, nullptr}},
+    {"sigmoid", {Signature::bB, unaryRun<Ops::sigmoid>, nullptr}},
+    {"ramp", {Signature::bB, unaryRun<Ops::ramp>, nullptr}},
+
+    {"mul", {Signature::bbB, binaryRun<Ops::mul>, nullptr}},
+    {"div", {Signature::bbB, binaryRun<Ops::div>, nullptr}},
+    {"add", {Signature::bbB, binaryRun<Ops::add>, nullptr}},
+    {"sub", {Signature::bbB, binaryRun<Ops::sub>, nullptr}},
+    {"frem", {Signature::bbB, binaryRun<Ops::frem>, nullptr}},
+    {"pow", {Signature::bbB, binaryRun<Ops::pow>, nullptr}},
+    {"hypot", {Signature::bbB, binaryRun<Ops::hypot>, nullptr}},
+    {"atan2", {Signature::bbB, binaryRun<Ops::atan2>, nullptr}},
+    {"fmax", {Signature::bbB, binaryRun<Ops::fmax>, nullptr}},
+    {"fmin", {Signature::bbB, binaryRun<Ops::fmin>, nullptr}},
+    {"copysign", {Signature::bbB, binaryRun<Ops::copysign>, nullptr}},
+
+    {"powx", {Signature::bfB, scalarRun<Ops::powx>, nullptr}},
+    {"relu", {Signature::fbB, scalarRun<Ops::relu>, nullptr}},
+    {"elu", {Signature::fbB, scalarRun<Ops::elu>, nullptr}},
+    {"set", {Signature::fbB, scalarRun<Ops::set>, nullptr}},
+
+    {"sincos", {Signature::bBB, pairRun<Ops::sincos>, nullptr}},
+    {"modf", {Signature::bBB, pairRun<Ops::modf>, nullptr}},
+
+    {"scale_shift", {Signature::bffffB, scaleShiftRun, nullptr}},
+    {"linear_frac", {Signature::bbffffB, linearFracRun, nullptr}},
+  };
+
+} // namespace
+
+
+const Ferrum::CpuKernel* Ferrum::FERRUM_SIMD_KERNEL(FERRUM_SIMD_ISA)(const char* name) {
+  for (const NamedKernel& entry : simdTable) {
+    if (std::strcmp(entry.name, name) == 0) {
+      return &entry.kernel;
+    }
+  }
+  return nullptr;
+}
+
+
+const Ferrum::CpuGemmKernel* Ferrum::FERRUM_SIMD_GEMM(FERRUM_SIMD_ISA)() {
+  return &gemmKernel;
+}
+
+const Ferrum::CpuLevel2Kernel* Ferrum::FERRUM_SIMD_LEVEL2(FERRUM_SIMD_ISA)() {
+  return &level2Kernel;
+}
+
+const Ferrum::CpuHalfKernel* Ferrum::FERRUM_SIMD_HALF(FERRUM_SIMD_ISA)(HalfFormat format) {
+  return &halfKernels[static_cast<int>(format)];
+}
@@ -3,32 +3,131 @@
 #define NS_PRIVATE_IMPLEMENTATION
 #define MTL_PRIVATE_IMPLEMENTATION
 
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <sstream>
 #include <string>
 #include <unordered_map>
+#include <unistd.h>
 #include <vector>
 #include <Metal/Metal.hpp>
 #include <MetalKit/MetalKit.hpp>
 #include <simd/simd.h>
 
+#include "buffer_pool.hpp"
+#include "dispatch_plan.hpp"
 #include "engine.hpp"
+#include "fusion.hpp"
+#include "pipeline_cache.hpp"
+#include "thread_pool.hpp"
 
 const char* LIB_NAME = "ferrum";
 const char* LIB_TYPE = "metallib";
 const char* FERRUM_LIB = "FERRUM_LIB";
 
 const char* str(const NS::String* s);
+NS::String* nsStr(const char* s);
 MTL::Device* getDevice();
-MTL::Library* initLibrary(MTL::Device* device, const char* path);
+MTL::Library* initLibrary(MTL::Device* device, const char* path, uint64_t& hash);
+
+// Free buffers are kept up to this size, and released after the engine is idle for this long
+const size_t POOL_LIMIT = 256 * 1024 * 1024;
+const std::chrono::milliseconds POOL_IDLE_TIME(2000);
+
+// Allocates shared Metal buffers for the buffer pool
+class MetalAllocator : public Ferrum::BlockAllocator {
+  public:
+    MetalAllocator(MTL::Device* device) : device(device) {}
+
+    Ferrum::Block allocate(size_t size) override {
+      MTL::Buffer* buffer = device->newBuffer(size, MTL::StorageModeShared);
+      return Ferrum::Block{buffer, buffer != nullptr ? buffer->contents() : nullptr, size};
+    }
+
+    void release(const Ferrum::Block& block) override {
+      static_cast<MTL::Buffer*>(block.handle)->release();
+    }
+
+  private:
+    MTL::Device* device;
+};
+
+// Compiles the kernels of the library. With an archive, pipelines that were compiled by an earlier
+// run are loaded from it, and new ones are added to it.
+class MetalCompiler : public Ferrum::PipelineCompiler {
+  public:
+    MetalCompiler(MTL::Device* device, MTL::Library* library, MTL::BinaryArchive* archive) :
+        device(device), library(library), archive(archive) {}
+
+    void* compile(Ferrum::FunctionID id, bool& cached) override {
+      const char* name = Ferrum::functionNames[id];
+      MTL::Function* fn = library->newFunction(nsStr(name));
+      if (fn == nullptr) {
+        std::cerr << "Error: Failed to create function: " << name << std::endl;
+        return nullptr;
+      }
+      MTL::ComputePipelineDescriptor* descriptor = MTL::ComputePipelineDescriptor::alloc()->init();
+      descriptor->setComputeFunction(fn);
+      NS::Error* pError = nullptr;
+      MTL::ComputePipelineState* pipelineState = nullptr;
+      if (archive != nullptr) {
+        descriptor->setBinaryArchives(NS::Array::array(archive));
+        pipelineState = device->newComputePipelineState(descriptor, MTL::PipelineOptionFailOnBinaryArchiveMiss, nullptr, &pError);
+        cached = pipelineState != nullptr;
+        if (pipelineState == nullptr) {
+          pError = nullptr;
+          if (!archive->addComputePipelineFunctions(descriptor, &pError)) {
+            DBG("Failed to add to the pipeline archive: ", name);
+          }
+        }
+      }
+      if (pipelineState == nullptr) {
+        pError = nullptr;
+        pipelineState = device->newComputePipelineState(descriptor, MTL::PipelineOptionNone, nullptr, &pError);
+      }
+      descriptor->release();
+      fn->release();
+      if (pError != nullptr) {
+        std::cerr << "Error: on function '" << name << "': " << str(pError->localizedDescription()) << std::endl;
+      } else if (pipelineState == nullptr) {
+        std::cerr << "Error: Failed to create pipeline state for: " << name << std::endl;
+      }
+      return pipelineState;
+    }
+
+    void release(void* pipeline) override {
+      static_cast<MTL::ComputePipelineState*>(pipeline)->release();
+    }
+
+  private:
+    MTL::Device* device;
+    MTL::Library* library;
+    MTL::BinaryArchive* archive;
+};
 
 
 // constructor for Ferrum::MetalEngine
 Ferrum::MetalEngine::MetalEngine(const char* path) :
-    emptyAction([](std::vector<MTL::Buffer*>&, int) {}) {
+    emptyAction([](std::vector<MTL::Buffer*>&, int) {}),
+    device(nullptr), library(nullptr), commandQueue(nullptr),
+    compiler(nullptr), pipelines(nullptr), archive(nullptr),
+    allocator(nullptr), bufferPool(nullptr), submissions(nullptr),
+    reproducibleSums(false), inFlight(0),
+    pageSize(sysconf(_SC_PAGESIZE)) {
   DBG("Getting Metal device");
   device = getDevice();
+  if (device == nullptr) {
+    return;
+  }
+  submissions = new SerialQueue();
+  allocator = new MetalAllocator(device);
+  bufferPool = new BufferPool(allocator, POOL_LIMIT, POOL_IDLE_TIME);
   DBG("Initializing library...");
-  library = initLibrary(device, path);
+  uint64_t hash = 0;
+  library = initLibrary(device, path, hash);
   if (library == nullptr) {
     std::cerr << "Error: Failed to initialize Metal library" << std::endl;
     return;
@@ -37,56 +136,70 @@ Ferrum::MetalEngine::MetalEngine(const char* path) :
 
   commandQueue = device->newCommandQueue();
 
-  DBG("Retrieving function names...");
-  NS::Array* functions = library->functionNames();
-  fnCount = functions->count();
-  if (fnCount == 0) {
-    std::cerr << "Error: No functions found in library" << std::endl;
-    return;
-  }
-  DBG("Retrieved ", fnCount, " functions");
-  DBG("Collecting function pipline states...");
-  kernelFunctions = new MTL::Function*[fnCount];
-  computePipelineStates = new MTL::ComputePipelineState*[fnCount];
-  NS::Error* pError = nullptr;
-  for (int i = 0; i < fnCount; i++) {
-    NS::String* fnName = static_cast<NS::String*>(functions->object(i));
-    kernelFunctions[i] = library->newFunction(fnName);
-    if (kernelFunctions[i] == nullptr) {
-      std::cerr << "Error: Failed to create function: " << str(fnName) << std::endl;
+  // pipelines from earlier runs with the same library
+  archivePath = pipelineCachePath(hash);
+  if (!archivePath.empty()) {
+    MTL::BinaryArchiveDescriptor* descriptor = MTL::BinaryArchiveDescriptor::alloc()->init();
+    if (std::filesystem::exists(archivePath)) {
+      DBG("Loading pipeline archive: ", archivePath);
+      descriptor->setUrl(NS::URL::fileURLWithPath(nsStr(archivePath.c_str())));
     }
-    MTL::ComputePipelineState* pipelineState = device->newComputePipelineState(kernelFunctions[i], &pError);
-    if (pError != nullptr) {
-      std::cerr << "Error: on function '" << str(fnName) << "': " << str(pError->localizedDescription()) << std::endl;
-    } else if (pipelineState == nullptr) {
-      std::cerr << "Error: Failed to create pipeline state for: " << str(fnName) << std::endl;
-    } else {
-      DBG("Created pipeline state for: ", str(fnName));
-      auto idIt = functionMap->find(str(fnName));
-      if (idIt == functionMap->end()) {
-        std::cerr << "Error: Unknown function: " << str(fnName) << std::endl;
-      } else {
-        computePipelineStates[static_cast<int>(idIt->second)] = pipelineState;
-      }
+    NS::Error* pError = nullptr;
+    archive = device->newBinaryArchive(descriptor, &pError);
+    descriptor->release();
+    if (archive == nullptr) {
+      std::cerr << "Error: Failed to open pipeline archive: " << archivePath << std::endl;
     }
   }
+  compiler = new MetalCompiler(device, library, archive);
+  pipelines = new PipelineCache(compiler);
+  pipelines->warm(warmList(std::getenv("FERRUM_WARM")));
   DBG("Initialization complete");
 }
 
 
 Ferrum::MetalEngine::~MetalEngine() {
-  if (computePipelineStates != nullptr) {
-    for (int i = 0; i < fnCount; i++) {
-      if (computePipelineStates[i] != nullptr) {
-        computePipelineStates[i]->release();
-      }
-      if (kernelFunctions[i] != nullptr) {
-        kernelFunctions[i]->release();
-      }
+  // finish any submitted jobs first, and the command buffers that they left running
+  delete submissions;
+  {
+    std::unique_lock<std::mutex> guard(inFlightLock);
+    inFlightDone.wait(guard, [this]() { return inFlight == 0; });
+  }
+  // batches that were left open, which nothing can be encoding into now
+  for (auto& [thread, batch] : batches) {
+    batch.encoder->endEncoding();
+    batch.commands->commit();
+    batch.commands->waitUntilCompleted();
+    for (MTL::Buffer* buffer : batch.scratch) {
+      recycle(buffer);
     }
-    delete[] computePipelineStates;
-    delete[] kernelFunctions;
   }
+  batches.clear();
+  // keep the new pipelines for the next run
+  if (archive != nullptr && pipelines->unsaved() > 0) {
+    std::error_code error;
+    std::filesystem::create_directories(std::filesystem::path(archivePath).parent_path(), error);
+    NS::Error* pError = nullptr;
+    if (!archive->serializeToURL(NS::URL::fileURLWithPath(nsStr(archivePath.c_str())), &pError)) {
+      std::cerr << "Error: Failed to save pipeline archive: " << archivePath << std::endl;
+    } else {
+      pipelines->markSaved();
+    }
+  }
+  delete pipelines;
+  delete compiler;
+  if (archive != nullptr) {
+    archive->release();
+  }
+  for (auto& [shape, pipelineState] : fusedPipelines) {
+    pipelineState->release();
+  }
+  // tensors that were not released
+  for (auto& [data, buffer] : tensorBuffers) {
+    buffer->release();
+  }
+  delete bufferPool;
+  delete allocator;
   if (commandQueue != nullptr) {
     commandQueue->release();
   }
@@ -97,7 +210,7 @@ Ferrum::MetalEngine::~MetalEngine() {
 
 
 // convert C string to NSString
-inline NS::String* nsStr(const char* s) {
+NS::String* nsStr(const char* s) {
   return NS::String::string(s, NS::UTF8StringEncoding);
 }
 
@@ -195,15 +308,19 @@ MTL::Device* getDevice() {
 
 extern "C" char binary_ferrum_bin_start[];
 extern "C" unsigned long long binary_ferrum_bin_size;
+// the helper functions for the kernels, as source
+extern "C" char binary_vect_math_h_start[];
+extern "C" unsigned long long binary_vect_math_h_size;
 
 
 // Loads the Metal library from the dylib
-MTL::Library* loadFromDylib(MTL::Device* device) {
+MTL::Library* loadFromDylib(MTL::Device* device, uint64_t& hash) {
   size_t size = (size_t)binary_ferrum_bin_size;
   if (size == 0) {
     std::cerr << "Error: Failed to find library" << std::endl;
     return nullptr;
   }
+  hash = Ferrum::libraryHash(binary_ferrum_bin_start, size);
   dispatch_data_t libraryData = dispatch_data_create(binary_ferrum_bin_start, size, nullptr, DISPATCH_DATA_DESTRUCTOR_DEFAULT);
 
   NS::Error* pError = nullptr;
@@ -222,7 +339,7 @@ MTL::Library* loadFromDylib(MTL::Device* device) {
 }
 
 
-MTL::Library* loadFromPath(MTL::Device* device, const char* path) {
+MTL::Library* loadFromPath(MTL::Device* device, const char* path, uint64_t& hash) {
   DBG("Getting library path...");
   const NS::String* libPath = getLibPath(path);
   if (libPath == nullptr) {
@@ -250,33 +367,327 @@ MTL::Library* loadFromPath(MTL::Device* device, const char* path) {
   }
   DBG("Successfully loaded library: ", str(libPath));
 
+  std::ifstream file(url->fileSystemRepresentation(), std::ios::binary);
+  std::stringstream contents;
+  contents << file.rdbuf();
+  std::string bytes = contents.str();
+  hash = Ferrum::libraryHash(bytes.data(), bytes.size());
+
   return library;
 }
 
 // Initializes a Metal library with a device, reading the library from a file
-MTL::Library* initLibrary(MTL::Device* device, const char* path = nullptr) {
-  MTL::Library* library;
+MTL::Library* initLibrary(MTL::Device* device, const char* path, uint64_t& hash) {
+  MTL::Library* library = nullptr;
   if (path == nullptr) {
-    library = loadFromDylib(device);
+    library = loadFromDylib(device, hash);
   }
   if (library != nullptr) {
     DBG("Loaded Metal library from dylib");
     return library;
   } else {
     DBG("Loaded Metal library from path");
-    return loadFromPath(device, path);
+    return loadFromPath(device, path, hash);
   }
 }
 
 
-template<typename CreateBuffers, typename SetBuffers, typename CopyResults>
-float* Ferrum::MetalEngine::call_metal(Ferrum::FunctionID id,
-                                       float* result, int len, int offset, int stride,
-                                       CreateBuffers createBuffers, SetBuffers setBuffers,
-                                       CopyResults copyResults) {
-  MTL::ComputePipelineState* pipelineState = computePipelineStates[static_cast<int>(id)];
+thread_local Ferrum::MetalEngine::JobContext* Ferrum::MetalEngine::runningJob = nullptr;
+
+std::future<float*> Ferrum::MetalEngine::submit(Job job, Completion done) {
+  auto context = std::make_shared<JobContext>();
+  context->engine = this;
+  context->done = std::move(done);
+  context->result = nullptr;
+  context->failed = false;
+  context->outstanding = 1;
+  std::future<float*> future = context->promise.get_future();
+  submissions->post([this, job, context]() {
+    runningJob = context.get();
+    context->result = job(*this);
+    runningJob = nullptr;
+    finishJob(context);
+  });
+  return future;
+}
+
+
+void Ferrum::MetalEngine::finishJob(const std::shared_ptr<JobContext>& job) {
+  if (--job->outstanding > 0) {
+    return;
+  }
+  for (MTL::Buffer* buffer : job->scratch) {
+    recycle(buffer);
+  }
+  float* result = job->failed ? nullptr : job->result;
+  if (job->done) {
+    job->done(result);
+  }
+  job->promise.set_value(result);
+}
+
+
+Ferrum::Tensor* Ferrum::MetalEngine::newTensor(int length) {
+  if (length < 0) {
+    return nullptr;
+  }
+  Block block = bufferPool->acquire(sizeof(float) * length);
+  if (block.handle == nullptr) {
+    std::cerr << "Error: Failed to create buffer" << std::endl;
+    return nullptr;
+  }
+  Tensor* tensor = new Tensor{static_cast<float*>(block.contents), length};
+  std::lock_guard<std::shared_mutex> guard(tensorLock);
+  tensorBuffers[tensor->data] = static_cast<MTL::Buffer*>(block.handle);
+  return tensor;
+}
+
+
+void Ferrum::MetalEngine::releaseTensor(Tensor* tensor) {
+  if (tensor == nullptr) {
+    return;
+  }
+  MTL::Buffer* buffer = nullptr;
+  {
+    std::lock_guard<std::shared_mutex> guard(tensorLock);
+    auto it = tensorBuffers.find(tensor->data);
+    if (it != tensorBuffers.end()) {
+      buffer = it->second;
+      tensorBuffers.erase(it);
+    }
+  }
+  // calls in this thread's batch may still use the buffer, so it is not handed out again until they have run
+  BatchContext* batch = threadBatch();
+  if (batch != nullptr && buffer != nullptr) {
+    batch->scratch.push_back(buffer);
+  } else {
+    recycle(buffer);
+  }
+  delete tensor;
+}
+
+
+bool Ferrum::MetalEngine::allTensors(const std::vector<MTL::Buffer*>& buffers) {
+  std::shared_lock<std::shared_mutex> guard(tensorLock);
+  for (MTL::Buffer* buffer : buffers) {
+    if (tensorBuffers.count(static_cast<const float*>(buffer->contents())) == 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+
+// Finds the buffer for the data of a tensor, or nullptr if the data is not in a tensor
+MTL::Buffer* Ferrum::MetalEngine::tensorBuffer(const float* data) {
+  std::shared_lock<std::shared_mutex> guard(tensorLock);
+  auto it = tensorBuffers.find(data);
+  return (it == tensorBuffers.end()) ? nullptr : it->second;
+}
+
+
+// Gets a buffer from the pool, holding a copy of the data.
+// Tensors are already in a buffer, so that buffer is used directly. Host memory from
+// newHostMemory, such as a direct buffer from FerrumEngine.newFloatBuffer, is wrapped without a
+// copy. Any other memory, even when it is page aligned, may end part way through its last page.
+MTL::Buffer* Ferrum::MetalEngine::newBuffer(const float* data, int length) {
+  MTL::Buffer* resident = tensorBuffer(data);
+  if (resident != nullptr) {
+    return resident;
+  }
+  size_t size = sizeof(float) * length;
+  size_t allocated = hostMemorySize(data);
+  if (size > 0 && allocated >= size && allocated % pageSize == 0 &&
+      reinterpret_cast<uintptr_t>(data) % pageSize == 0) {
+    // the buffer covers the whole allocation, which is whole pages
+    MTL::Buffer* wrapped = device->newBuffer(data, allocated, MTL::ResourceStorageModeShared, nullptr);
+    if (wrapped != nullptr) {
+      std::lock_guard<std::shared_mutex> guard(tensorLock);
+      wrappedBuffers.insert(wrapped);
+      return wrapped;
+    }
+  }
+  Block block = bufferPool->acquire(size);
+  if (block.handle == nullptr) {
+    return nullptr;
+  }
+  memcpy(block.contents, data, size);
+  return static_cast<MTL::Buffer*>(block.handle);
+}
+
+// Returns a buffer from newBuffer to the pool, unless it belongs to a tensor.
+// Buffers that wrap the caller's memory are released instead.
+void Ferrum::MetalEngine::recycle(MTL::Buffer* buffer) {
+  if (buffer == nullptr) {
+    return;
+  }
+  bool wrapped = false;
+  bool resident = false;
+  {
+    std::shared_lock<std::shared_mutex> guard(tensorLock);
+    wrapped = wrappedBuffers.count(buffer) > 0;
+    resident = tensorBuffers.count(static_cast<const float*>(buffer->contents())) > 0;
+  }
+  if (wrapped) {
+    // no other call has this buffer, so it is still there to remove
+    {
+      std::lock_guard<std::shared_mutex> guard(tensorLock);
+      wrappedBuffers.erase(buffer);
+    }
+    buffer->release();
+  } else if (!resident) {
+    bufferPool->recycle(Block{buffer, buffer->contents(), buffer->length()});
+  }
+}
+
+
+thread_local Ferrum::MetalEngine::ThreadBatch Ferrum::MetalEngine::current = {nullptr, nullptr, 0};
+
+Ferrum::MetalEngine::BatchContext* Ferrum::MetalEngine::threadBatch() {
+  if (current.open == 0) {
+    return nullptr;
+  }
+  if (current.engine == this) {
+    return current.batch;
+  }
+  std::lock_guard<std::mutex> guard(batchLock);
+  auto it = batches.find(std::this_thread::get_id());
+  return (it == batches.end()) ? nullptr : &it->second;
+}
+
+
+bool Ferrum::MetalEngine::inBatch() const {
+  if (current.open == 0) {
+    return false;
+  }
+  if (current.engine == this) {
+    return true;
+  }
+  std::lock_guard<std::mutex> guard(batchLock);
+  return batches.count(std::this_thread::get_id()) > 0;
+}
+
+
+bool Ferrum::MetalEngine::beginBatch() {
+  if (threadBatch() != nullptr) {
+    std::cerr << "Error: A batch is already open" << std::endl;
+    return false;
+  }
+  if (commandQueue == nullptr) {
+    return false;
+  }
+  MTL::CommandBuffer* commands = commandQueue->commandBuffer();
+  if (commands == nullptr) {
+    std::cerr << "Error: Failed to create command buffer" << std::endl;
+    return false;
+  }
+  // a serial encoder, so each dispatch sees the results of the ones before it
+  MTL::ComputeCommandEncoder* encoder = commands->computeCommandEncoder();
+  if (encoder == nullptr) {
+    std::cerr << "Error: Failed to create command encoder" << std::endl;
+    return false;
+  }
+  std::lock_guard<std::mutex> guard(batchLock);
+  auto it = batches.try_emplace(std::this_thread::get_id(), BatchContext{commands, encoder, {}}).first;
+  // the entry stays where it is until the batch is committed
+  current = {this, &it->second, current.open + 1};
+  return true;
+}
+
+
+bool Ferrum::MetalEngine::commitBatch() {
+  BatchContext batch;
+  {
+    std::lock_guard<std::mutex> guard(batchLock);
+    auto it = batches.find(std::this_thread::get_id());
+    if (it == batches.end()) {
+      std::cerr << "Error: No batch is open" << std::endl;
+      return false;
+    }
+    batch = std::move(it->second);
+    batches.erase(it);
+  }
+  current.open--;
+  if (current.engine == this) {
+    current.engine = nullptr;
+    current.batch = nullptr;
+  }
+  MTL::CommandBuffer* commandBuffer = batch.commands;
+  batch.encoder->endEncoding();
+  commandBuffer->commit();
+  commandBuffer->waitUntilCompleted();
+  for (MTL::Buffer* buffer : batch.scratch) {
+    recycle(buffer);
+  }
+  if (commandBuffer->status() == MTL::CommandBufferStatusError) {
+    std::cerr << "Error: Batch failed: " << str(commandBuffer->error()->localizedDescription()) << std::endl;
+    return false;
+  }
+  return true;
+}
+
+
+MTL::ComputePipelineState* Ferrum::MetalEngine::pipeline(FunctionID id) {
+  MTL::ComputePipelineState* pipelineState =
+      (pipelines != nullptr) ? static_cast<MTL::ComputePipelineState*>(pipelines->get(id)) : nullptr;
+  if (pipelineState == nullptr) {
+    std::cerr << "Error: Failed to find pipeline state for '" << functionName(id) << "'" << std::endl;
+  }
+  return pipelineState;
+}
+
+
+// Checks the arguments against those that the kernel was declared with, before any are bound
+MTL::ComputePipelineState* Ferrum::MetalEngine::pipeline(FunctionID id, Family family, Signature signature) {
+  if (id >= 0 && id < functionCount && !kernelAccepts(id, family, signature)) {
+    std::cerr << "Error: Wrong arguments for function '" << functionName(id) << "'" << std::endl;
+    return nullptr;
+  }
+  return pipeline(id);
+}
+
+
+// Compiles the kernel for an expression, the first time that its shape is seen
+MTL::ComputePipelineState* Ferrum::MetalEngine::fusedPipeline(const FusedExpr& expr) {
+  std::string shape = expr.shape();
+  std::lock_guard<std::mutex> guard(fusedLock);
+  auto it = fusedPipelines.find(shape);
+  if (it != fusedPipelines.end()) {
+    return it->second;
+  }
+  std::string source(binary_vect_math_h_start, (size_t)binary_vect_math_h_size);
+  source += fusedMetalSource(expr, "fused");
+  DBG("Compiling fused kernel: ", shape);
+
+  NS::Error* pError = nullptr;
+  MTL::CompileOptions* options = MTL::CompileOptions::alloc()->init();
+  MTL::Library* fusedLibrary = device->newLibrary(nsStr(source.c_str()), options, &pError);
+  options->release();
+  if (fusedLibrary == nullptr) {
+    std::cerr << "Error: Failed to compile fused kernel: " << str(pError != nullptr ? pError->localizedDescription() : nullptr) << std::endl;
+    return nullptr;
+  }
+  MTL::Function* fn = fusedLibrary->newFunction(nsStr("fused"));
+  MTL::ComputePipelineState* pipelineState = (fn != nullptr) ? device->newComputePipelineState(fn, &pError) : nullptr;
+  if (fn != nullptr) {
+    fn->release();
+  }
+  fusedLibrary->release();
+  if (pipelineState == nullptr) {
+    std::cerr << "Error: Failed to create pipeline state for fused kernel" << std::endl;
+    return nullptr;
+  }
+  fusedPipelines[shape] = pipelineState;
+  return pipelineState;
+}
+
+
+template<typename CreateBuffers, typename Encode, typename CopyResults>
+float* Ferrum::MetalEngine::encode_metal(MTL::ComputePipelineState* pipelineState,
+                                         float* result, int len,
+                                         CreateBuffers createBuffers, Encode encode,
+                                         CopyResults copyResults) {
   if (pipelineState == nullptr) {
-    std::cerr << "Error: Failed to find pipeline state for '" << id << "'" << std::endl;
     return nullptr;
   }
 
@@ -285,52 +696,204 @@ float* Ferrum::MetalEngine::call_metal(Ferrum::FunctionID id,
   for (auto& buffer : buffers) {
     if (buffer == nullptr) {
       std::cerr << "Error: Failed to create buffer" << std::endl;
+      for (auto& b : buffers) {
+        recycle(b);
+      }
       return nullptr;
     }
-  } 
+  }
+
+  // a batch only works on tensors, as there is nowhere to copy other results back to
+  BatchContext* batch = threadBatch();
+  bool batched = batch != nullptr;
+  bool resident = allTensors(buffers);
+  if (batched && !resident) {
+    std::cerr << "Error: Only tensors can be used in a batch" << std::endl;
+    for (auto& b : buffers) {
+      recycle(b);
+    }
+    return nullptr;
+  }
 
-  MTL::CommandBuffer* commandBuffer = commandQueue->commandBuffer();
+  MTL::CommandBuffer* commandBuffer = batched ? batch->commands : commandQueue->commandBuffer();
   if (commandBuffer == nullptr) {
     std::cerr << "Error: Failed to create command buffer" << std::endl;
+    for (auto& b : buffers) {
+      recycle(b);
+    }
     return nullptr;
   }
 
-  MTL::ComputeCommandEncoder* encoder = commandBuffer->computeCommandEncoder();
+  MTL::ComputeCommandEncoder* encoder = batched ? batch->encoder : commandBuffer->computeCommandEncoder();
   if (encoder == nullptr) {
     std::cerr << "Error: Failed to create command encoder" << std::endl;
+    for (auto& b : buffers) {
+      recycle(b);
+    }
     return nullptr;
   }
 
   encoder->setComputePipelineState(pipelineState);
 
-  setBuffers(encoder, buffers);
+  encode(encoder, buffers);
 
-  MTL::Size gridSize = MTL::Size(1, 1, 1);
-  MTL::Size threadGroupSize = MTL::Size(len, 1, 1);
-
-  encoder->dispatchThreadgroups(gridSize, threadGroupSize);
+  // everything is in a tensor, so there is nothing to copy back when the batch completes
+  if (batched) {
+    return result;
+  }
 
   encoder->endEncoding();
+
+  // A job that only uses tensors has nothing to copy back, so the submission thread moves on
+  // to the next job, and the job's future is completed along with the command buffer
+  JobContext* job = currentJob();
+  if (job != nullptr && resident) {
+    std::shared_ptr<JobContext> context = job->shared_from_this();
+    context->outstanding++;
+    {
+      std::lock_guard<std::mutex> guard(inFlightLock);
+      inFlight++;
+    }
+    commandBuffer->addCompletedHandler([this, context](MTL::CommandBuffer* commands) {
+      if (commands->status() == MTL::CommandBufferStatusError) {
+        std::cerr << "Error: Job failed: " << str(commands->error()->localizedDescription()) << std::endl;
+        context->failed = true;
+      }
+      finishJob(context);
+      std::lock_guard<std::mutex> guard(inFlightLock);
+      if (--inFlight == 0) {
+        inFlightDone.notify_all();
+      }
+    });
+    commandBuffer->commit();
+    return result;
+  }
+
   commandBuffer->commit();
   commandBuffer->waitUntilCompleted();
 
   float* bresult = reinterpret_cast<float*>(buffers.back()->contents());
-  memcpy(result, bresult, sizeof(float) * len);
+  // a tensor result was written in place
+  if (bresult != result) {
+    memcpy(result, bresult, sizeof(float) * len);
+  }
   // bring over more buffers if there is more than one result
   copyResults(buffers, len);
   for (auto& buffer : buffers) {
-    buffer->release();
+    recycle(buffer);
   }
   return result;
 }
 
+template<typename CreateBuffers, typename SetBuffers, typename CopyResults>
+float* Ferrum::MetalEngine::call_metal(MTL::ComputePipelineState* pipelineState, Grid grid,
+                                       float* result, int len,
+                                       CreateBuffers createBuffers, SetBuffers setBuffers,
+                                       CopyResults copyResults) {
+  return encode_metal(pipelineState, result, len, createBuffers,
+      [&](MTL::ComputeCommandEncoder* encoder, std::vector<MTL::Buffer*>& buffers) {
+        setBuffers(encoder, buffers);
+
+        DispatchPlan plan = planDispatch(grid, pipelineState->threadExecutionWidth(),
+                                         pipelineState->maxTotalThreadsPerThreadgroup());
+        DBG("Dispatching ", plan.threads.width * plan.threads.height, " threads");
+        MTL::Size gridSize = MTL::Size(plan.threads.width, plan.threads.height, 1);
+        MTL::Size threadGroupSize = MTL::Size(plan.threadsPerGroup.width, plan.threadsPerGroup.height, 1);
+
+        // The kernels do not all check their bounds, so the grid must be exact. This relies on
+        // non-uniform threadgroups, which all Apple GPUs support.
+        if (gridSize.width > 0 && gridSize.height > 0) {
+          encoder->dispatchThreads(gridSize, threadGroupSize);
+        }
+      },
+      copyResults);
+}
+
+
+template<typename CreateBuffers, typename SetBuffers>
+float* Ferrum::MetalEngine::call_reduction(MTL::ComputePipelineState* pipelineState, ptrdiff_t count, bool fixed,
+                                           float* result, int len,
+                                           CreateBuffers createBuffers, SetBuffers setBuffers) {
+  if (pipelineState == nullptr) {
+    return nullptr;
+  }
+  NS::UInteger maxThreads = pipelineState->maxTotalThreadsPerThreadgroup();
+  if (fixed && maxThreads < REPRODUCIBLE_LANES) {
+    std::cerr << "Error: Reproducible sums need threadgroups of " << REPRODUCIBLE_LANES << " threads" << std::endl;
+    return nullptr;
+  }
+  ReductionPlan plan = fixed ? planReproducibleReduction(count) : planReduction(count, maxThreads);
+  Block partials = bufferPool->acquire(REDUCTION_PARTIAL_SIZE * plan.groups);
+  if (partials.handle == nullptr) {
+    std::cerr << "Error: Failed to create buffer" << std::endl;
+    return nullptr;
+  }
+  MTL::Buffer* partialBuffer = static_cast<MTL::Buffer*>(partials.handle);
+  uint32_t n = count;
+  uint32_t groups = plan.groups;
+  // bit 0 is the second pass, and bit 1 is the fixed blocking
+  uint32_t pass[2] = {fixed ? 2u : 0u, fixed ? 3u : 1u};
+  MTL::Size groupSize = MTL::Size(plan.threadsPerGroup, 1, 1);
+  DBG("Reducing ", count, " elements with ", plan.groups, " groups of ", plan.threadsPerGroup, " threads");
+
+  float* reduced = encode_metal(pipelineState, result, len, createBuffers,
+      [&](MTL::ComputeCommandEncoder* encoder, std::vector<MTL::Buffer*>& buffers) {
+        // the partial results, count and pass follow the arguments of the function
+        NS::UInteger index = setBuffers(encoder, buffers);
+        encoder->setBuffer(partialBuffer, 0, index);
+        encoder->setThreadgroupMemoryLength(REDUCTION_PARTIAL_SIZE * plan.threadsPerGroup, 0);
+        encoder->setBytes(&n, sizeof(n), index + 1);
+        encoder->setBytes(&pass[0], sizeof(pass[0]), index + 2);
+        encoder->dispatchThreadgroups(MTL::Size(plan.groups, 1, 1), groupSize);
+        encoder->setBytes(&groups, sizeof(groups), index + 1);
+        encoder->setBytes(&pass[1], sizeof(pass[1]), index + 2);
+        encoder->dispatchThreadgroups(MTL::Size(1, 1, 1), groupSize);
+      },
+      emptyAction);
+
+  // a batch still needs the partial results until it is committed, and a job until it is complete
+  BatchContext* batch = threadBatch();
+  JobContext* job = currentJob();
+  if (reduced != nullptr && batch != nullptr) {
+    batch->scratch.push_back(partialBuffer);
+  } else if (reduced != nullptr && job != nullptr) {
+    job->scratch.push_back(partialBuffer);
+  } else {
+    recycle(partialBuffer);
+  }
+  return reduced;
+}
+
 // general vector functions
 float* Ferrum::MetalEngine::vect_bB(Ferrum::FunctionID id, const float* a, int lena, int offset_a, int stride_a,
                                     float* result, int len, int offset, int stride) {
-  return call_metal(id, result, len, offset, stride,
+  if (reductionFunction(id)) {
+    if (vectorCount(len, offset, stride) == 0) {
+      std::cerr << "Error: No room for the result of '" << functionName(id) << "'" << std::endl;
+      return nullptr;
+    }
+    return call_reduction(pipeline(id, Family::vector, Signature::bB), vectorCount(lena, offset_a, stride_a),
+                          reproducibleSums && reproducibleFunction(id), result, len,
+        [&]() {
+          MTL::Buffer* bufferA = newBuffer(a, lena);
+          MTL::Buffer* bufferR = newBuffer(result, len);
+          return std::vector<MTL::Buffer*>{bufferA, bufferR};
+        },
+        [&](MTL::ComputeCommandEncoder* encoder, std::vector<MTL::Buffer*>& buffers) {
+          encoder->setBuffer(buffers[0], 0, 0);
+          encoder->setBytes(&offset_a, sizeof(offset_a), 1);
+          encoder->setBytes(&stride_a, sizeof(stride_a), 2);
+          encoder->setBuffer(buffers[1], 0, 3);
+          encoder->setBytes(&offset, sizeof(offset), 4);
+          encoder->setBytes(&stride, sizeof(stride), 5);
+          return (NS::UInteger)6;
+        });
+  }
+  ptrdiff_t count = std::min(vectorCount(lena, offset_a, stride_a), vectorCount(len, offset, stride));
+  return call_metal(pipeline(id, Family::vector, Signature::bB), Grid{(size_t)count, 1}, result, len,
       [&]() {
-        MTL::Buffer* bufferA = device->newBuffer(a, sizeof(float) * lena, MTL::StorageModeShared);
-        MTL::Buffer* bufferR = device->newBuffer(sizeof(float) * len, MTL::StorageModeShared);
+        MTL::Buffer* bufferA = newBuffer(a, lena);
+        MTL::Buffer* bufferR = newBuffer(result, len);
         return std::vector<MTL::Buffer*>{bufferA, bufferR};
       },
       [&](MTL::ComputeCommandEncoder* encoder, std::vector<MTL::Buffer*>& buffers) {
@@ -347,10 +910,11 @@ float* Ferrum::MetalEngine::vect_bB(Ferrum::FunctionID id, const float* a, int l
 float* Ferrum::MetalEngine::vect_bfB(Ferrum::FunctionID id, const float* a, int lena, int offset_a, int stride_a,
                                      float sa,
                                      float* result, int len, int offset, int stride) {
-  return call_metal(id, result, len, offset, stride,
+  ptrdiff_t count = std::min(vectorCount(lena, offset_a, stride_a), vectorCount(len, offset, stride));
+  return call_metal(pipeline(id, Family::vector, Signature::bfB), Grid{(size_t)count, 1}, result, len,
       [&]() {
-        MTL::Buffer* bufferA = device->newBuffer(a, sizeof(float) * lena, MTL::StorageModeShared);
-        MTL::Buffer* bufferR = device->newBuffer(sizeof(float) * len, MTL::StorageModeShared);
+        MTL::Buffer* bufferA = newBuffer(a, lena);
+        MTL::Buffer* bufferR = newBuffer(result, len);
         return std::vector<MTL::Buffer*>{bufferA, bufferR};
       },
       [&](MTL::ComputeCommandEncoder* encoder, std::vector<MTL::Buffer*>& buffers) {
@@ -368,10 +932,11 @@ float* Ferrum::MetalEngine::vect_bfB(Ferrum::FunctionID id, const float* a, int
 float* Ferrum::MetalEngine::vect_fbB(Ferrum::FunctionID id, float sa,
                                      const float* a, int lena, int offset_a, int stride_a,
                                      float* result, int len, int offset, int stride) {
-  return call_metal(id, result, len, offset, stride,
+  ptrdiff_t count = std::min(vectorCount(lena, offset_a, stride_a), vectorCount(len, offset, stride));
+  return call_metal(pipeline(id, Family::vector, Signature::fbB), Grid{(size_t)count, 1}, result, len,
       [&]() {
-        MTL::Buffer* bufferA = device->newBuffer(a, sizeof(float) * lena, MTL::StorageModeShared);
-        MTL::Buffer* bufferR = device->newBuffer(sizeof(float) * len, MTL::StorageModeShared);
+        MTL::Buffer* bufferA = newBuffer(a, lena);
+        MTL::Buffer* bufferR = newBuffer(result, len);
         return std::vector<MTL::Buffer*>{bufferA, bufferR};
       },
       [&](MTL::ComputeCommandEncoder* encoder, std::vector<MTL::Buffer*>& buffers) {
@@ -389,11 +954,38 @@ float* Ferrum::MetalEngine::vect_fbB(Ferrum::FunctionID id, float sa,
 float* Ferrum::MetalEngine::vect_bbB(Ferrum::FunctionID id, const float* a, int lena, int offset_a, int stride_a,
                                      const float* b, int lenb, int offset_b, int stride_b,
                                      float* result, int len, int offset, int stride) {
-  return call_metal(id, result, len, offset, stride,
+  ptrdiff_t count = std::min(vectorCount(lena, offset_a, stride_a), vectorCount(lenb, offset_b, stride_b));
+  if (reductionFunction(id)) {
+    if (vectorCount(len, offset, stride) == 0) {
+      std::cerr << "Error: No room for the result of '" << functionName(id) << "'" << std::endl;
+      return nullptr;
+    }
+    return call_reduction(pipeline(id, Family::vector, Signature::bbB), count, reproducibleSums && reproducibleFunction(id), result, len,
+        [&]() {
+          MTL::Buffer* bufferA = newBuffer(a, lena);
+          MTL::Buffer* bufferB = newBuffer(b, lenb);
+          MTL::Buffer* bufferR = newBuffer(result, len);
+          return std::vector<MTL::Buffer*>{bufferA, bufferB, bufferR};
+        },
+        [&](MTL::ComputeCommandEncoder* encoder, std::vector<MTL::Buffer*>& buffers) {
+          encoder->setBuffer(buffers[0], 0, 0);
+          encoder->setBytes(&offset_a, sizeof(offset_a), 1);
+          encoder->setBytes(&stride_a, sizeof(stride_a), 2);
+          encoder->setBuffer(buffers[1], 0, 3);
+          encoder->setBytes(&offset_b, sizeof(offset_b), 4);
+          encoder->setBytes(&stride_b, sizeof(stride_b), 5);
+          encoder->setBuffer(buffers[2], 0, 6);
+          encoder->setBytes(&offset, sizeof(offset), 7);
+          encoder->setBytes(&stride, sizeof(stride), 8);
+          return (NS::UInteger)9;
+        });
+  }
+  count = std::min(count, vectorCount(len, offset, stride));
+  return call_metal(pipeline(id, Family::vector, Signature::bbB), Grid{(size_t)count, 1}, result, len,
       [&]() {
-        MTL::Buffer* bufferA = device->newBuffer(a, sizeof(float) * lena, MTL::StorageModeShared);
-        MTL::Buffer* bufferB = device->newBuffer(b, sizeof(float) * lena, MTL::StorageModeShared);
-        MTL::Buffer* bufferR = device->newBuffer(sizeof(float) * len, MTL::StorageModeShared);
+        MTL::Buffer* bufferA = newBuffer(a, lena);
+        MTL::Buffer* bufferB = newBuffer(b, lenb);
+        MTL::Buffer* bufferR = newBuffer(result, len);
         return std::vector<MTL::Buffer*>{bufferA, bufferB, bufferR};
       },
       [&](MTL::ComputeCommandEncoder* encoder, std::vector<MTL::Buffer*>& buffers) {
@@ -413,11 +1005,13 @@ float* Ferrum::MetalEngine::vect_bbB(Ferrum::FunctionID id, const float* a, int
 float* Ferrum::MetalEngine::vect_bBB(Ferrum::FunctionID id, const float* a, int lena, int offset_a, int stride_a,
                                      float* b, int lenb, int offset_b, int stride_b,
                                      float* result, int len, int offset, int stride) {
-  return call_metal(id, result, len, offset, stride,
+  ptrdiff_t count = std::min({vectorCount(lena, offset_a, stride_a), vectorCount(lenb, offset_b, stride_b),
+                               vectorCount(len, offset, stride)});
+  return call_metal(pipeline(id, Family::vector, Signature::bBB), Grid{(size_t)count, 1}, result, len,
       [&]() {
-        MTL::Buffer* bufferA = device->newBuffer(a, sizeof(float) * lena, MTL::StorageModeShared);
-        MTL::Buffer* bufferB = device->newBuffer(b, sizeof(float) * lena, MTL::StorageModeShared);
-        MTL::Buffer* bufferR = device->newBuffer(sizeof(float) * len, MTL::StorageModeShared);
+        MTL::Buffer* bufferA = newBuffer(a, lena);
+        MTL::Buffer* bufferB = newBuffer(b, lenb);
+        MTL::Buffer* bufferR = newBuffer(result, len);
         return std::vector<MTL::Buffer*>{bufferA, bufferB, bufferR};
       },
       [&](MTL::ComputeCommandEncoder* encoder, std::vector<MTL::Buffer*>& buffers) {
@@ -433,7 +1027,9 @@ float* Ferrum::MetalEngine::vect_bBB(Ferrum::FunctionID id, const float* a, int
       },
       [&](std::vector<MTL::Buffer*>& buffers, int len) {
         float* b_result = reinterpret_cast<float*>(buffers[1]->contents());
-        memcpy(b, b_result, sizeof(float) * len);
+        if (b_result != b) {
+          memcpy(b, b_result, sizeof(float) * len);
+        }
       });
 }
 
@@ -441,10 +1037,11 @@ float* Ferrum::MetalEngine::vect_bffffB(Ferrum::FunctionID id, const float* a, i
                                         float sa, float sha,
                                         float sb, float shb,
                                         float* result, int len, int offset, int stride) {
-  return call_metal(id, result, len, offset, stride,
+  ptrdiff_t count = std::min(vectorCount(lena, offset_a, stride_a), vectorCount(len, offset, stride));
+  return call_metal(pipeline(id, Family::vector, Signature::bffffB), Grid{(size_t)count, 1}, result, len,
       [&]() {
-        MTL::Buffer* bufferA = device->newBuffer(a, sizeof(float) * lena, MTL::StorageModeShared);
-        MTL::Buffer* bufferR = device->newBuffer(sizeof(float) * len, MTL::StorageModeShared);
+        MTL::Buffer* bufferA = newBuffer(a, lena);
+        MTL::Buffer* bufferR = newBuffer(result, len);
         return std::vector<MTL::Buffer*>{bufferA, bufferR};
       },
       [&](MTL::ComputeCommandEncoder* encoder, std::vector<MTL::Buffer*>& buffers) {
@@ -467,11 +1064,13 @@ float* Ferrum::MetalEngine::vect_bbffffB(Ferrum::FunctionID id, const float* a,
                                          float sa, float sha,
                                          float sb, float shb,
                                          float* result, int len, int offset, int stride) {
-  return call_metal(id, result, len, offset, stride,
+  ptrdiff_t count = std::min({vectorCount(lena, offset_a, stride_a), vectorCount(lenb, offset_b, stride_b),
+                               vectorCount(len, offset, stride)});
+  return call_metal(pipeline(id, Family::vector, Signature::bbffffB), Grid{(size_t)count, 1}, result, len,
       [&]() {
-        MTL::Buffer* bufferA = device->newBuffer(a, sizeof(float) * lena, MTL::StorageModeShared);
-        MTL::Buffer* bufferB = device->newBuffer(b, sizeof(float) * lena, MTL::StorageModeShared);
-        MTL::Buffer* bufferR = device->newBuffer(sizeof(float) * len, MTL::StorageModeShared);
+        MTL::Buffer* bufferA = newBuffer(a, lena);
+        MTL::Buffer* bufferB = newBuffer(b, lenb);
+        MTL::Buffer* bufferR = newBuffer(result, len);
         return std::vector<MTL::Buffer*>{bufferA, bufferB, bufferR};
       },
       [&](MTL::ComputeCommandEncoder* encoder, std::vector<MTL::Buffer*>& buffers) {
@@ -492,14 +1091,98 @@ float* Ferrum::MetalEngine::vect_bbffffB(Ferrum::FunctionID id, const float* a,
       emptyAction);
 }
 
+float* Ferrum::MetalEngine::vect_fused(const FusedExpr& expr, const std::vector<FusedInput>& inputs,
+                                       float* result, int len, int offset, int stride) {
+  if (!expr.valid() || (int)inputs.size() != expr.inputCount()) {
+    std::cerr << "Error: Invalid fused expression" << std::endl;
+    return nullptr;
+  }
+  int n = inputs.size();
+  std::vector<uint32_t> offsets, strides;
+  for (const FusedInput& in : inputs) {
+    offsets.push_back(in.offset);
+    strides.push_back(in.stride);
+  }
+  offsets.push_back(offset);
+  strides.push_back(stride);
+  std::vector<float> scalars;
+  for (const FusedNode& node : expr.nodes()) {
+    scalars.insert(scalars.end(), node.scalars, node.scalars + 4);
+  }
+  ptrdiff_t count = fusedCount(inputs, len, offset, stride);
+  return call_metal(fusedPipeline(expr), Grid{(size_t)count, 1}, result, len,
+      [&]() {
+        std::vector<MTL::Buffer*> buffers;
+        for (const FusedInput& in : inputs) {
+          buffers.push_back(newBuffer(in.data, in.length));
+        }
+        buffers.push_back(newBuffer(result, len));
+        return buffers;
+      },
+      [&](MTL::ComputeCommandEncoder* encoder, std::vector<MTL::Buffer*>& buffers) {
+        for (int i = 0; i <= n; i++) {
+          encoder->setBuffer(buffers[i], 0, i);
+        }
+        encoder->setBytes(offsets.data(), sizeof(uint32_t) * offsets.size(), n + 1);
+        encoder->setBytes(strides.data(), sizeof(uint32_t) * strides.size(), n + 2);
+        encoder->setBytes(scalars.data(), sizeof(float) * scalars.size(), n + 3);
+      },
+      emptyAction);
+}
+
+namespace {
+
+  // Matrices and vectors must fit in their buffers, as in the CPU engine, or the grid would run
+  // past their ends
+  bool matrixFits(const char* name, int length, int offset, int ld, int rows, int cols) {
+    if (!Ferrum::geFits(length, offset, ld, rows, cols)) {
+      std::cerr << "Error: Matrix " << name << " does not fit in its buffer" << std::endl;
+      return false;
+    }
+    return true;
+  }
+
+  bool triangleFits(const char* name, int length, int offset, int ld, int sd) {
+    if (!Ferrum::uploFits(length, offset, ld, sd)) {
+      std::cerr << "Error: Matrix " << name << " does not fit in its buffer" << std::endl;
+      return false;
+    }
+    return true;
+  }
+
+  bool vectorFits(const char* name, int length, int offset, int stride, int count) {
+    if (count > 0 && Ferrum::vectorCount(length, offset, stride) < count) {
+      std::cerr << "Error: Vector " << name << " does not fit in its buffer" << std::endl;
+      return false;
+    }
+    return true;
+  }
+
+  // A packed matrix only holds a triangle, so a function with one needs bottom to choose it
+  bool packedHasTriangle(Ferrum::FunctionID id, int bottom, std::initializer_list<int> lds) {
+    for (int ld : lds) {
+      if (ld == Ferrum::PACKED && bottom == 0) {
+        std::cerr << "Error: Packed matrix has no triangle for " << functionName(id) << std::endl;
+        return false;
+      }
+    }
+    return true;
+  }
+
+} // namespace
+
 // general matrix functions
 float* Ferrum::MetalEngine::ge_bB(Ferrum::FunctionID id, int sd, int fd,
                                   const float* a, int lena, int offset_a, int stride_a,
                                   float* result, int len, int offset, int stride) {
-  return call_metal(id, result, len, offset, stride,
+  if (!matrixFits("a", lena, offset_a, stride_a, sd, fd) ||
+      !matrixFits("result", len, offset, stride, sd, fd)) {
+    return nullptr;
+  }
+  return call_metal(pipeline(id, Family::ge, Signature::bB), Grid{(size_t)sd, (size_t)fd}, result, len,
       [&]() {
-        MTL::Buffer* bufferA = device->newBuffer(a, sizeof(float) * lena, MTL::StorageModeShared);
-        MTL::Buffer* bufferR = device->newBuffer(sizeof(float) * len, MTL::StorageModeShared);
+        MTL::Buffer* bufferA = newBuffer(a, lena);
+        MTL::Buffer* bufferR = newBuffer(result, len);
         return std::vector<MTL::Buffer*>{bufferA, bufferR};
       },
       [&](MTL::ComputeCommandEncoder* encoder, std::vector<MTL::Buffer*>& buffers) {
@@ -519,10 +1202,14 @@ float* Ferrum::MetalEngine::ge_bfB(Ferrum::FunctionID id, int sd, int fd,
                                    const float* a, int lena, int offset_a, int stride_a,
                                    float sa,
                                    float* result, int len, int offset, int stride) {
-  return call_metal(id, result, len, offset, stride,
+  if (!matrixFits("a", lena, offset_a, stride_a, sd, fd) ||
+      !matrixFits("result", len, offset, stride, sd, fd)) {
+    return nullptr;
+  }
+  return call_metal(pipeline(id, Family::ge, Signature::bfB), Grid{(size_t)sd, (size_t)fd}, result, len,
       [&]() {
-        MTL::Buffer* bufferA = device->newBuffer(a, sizeof(float) * lena, MTL::StorageModeShared);
-        MTL::Buffer* bufferR = device->newBuffer(sizeof(float) * len, MTL::StorageModeShared);
+        MTL::Buffer* bufferA = newBuffer(a, lena);
+        MTL::Buffer* bufferR = newBuffer(result, len);
         return std::vector<MTL::Buffer*>{bufferA, bufferR};
       },
       [&](MTL::ComputeCommandEncoder* encoder, std::vector<MTL::Buffer*>& buffers) {
@@ -542,10 +1229,14 @@ float* Ferrum::MetalEngine::ge_bfB(Ferrum::FunctionID id, int sd, int fd,
 float* Ferrum::MetalEngine::ge_fbB(Ferrum::FunctionID id, int sd, int fd, float sa,
                                    const float* a, int lena, int offset_a, int stride_a,
                                    float* result, int len, int offset, int stride) {
-  return call_metal(id, result, len, offset, stride,
+  if (!matrixFits("a", lena, offset_a, stride_a, sd, fd) ||
+      !matrixFits("result", len, offset, stride, sd, fd)) {
+    return nullptr;
+  }
+  return call_metal(pipeline(id, Family::ge, Signature::fbB), Grid{(size_t)sd, (size_t)fd}, result, len,
       [&]() {
-        MTL::Buffer* bufferA = device->newBuffer(a, sizeof(float) * lena, MTL::StorageModeShared);
-        MTL::Buffer* bufferR = device->newBuffer(sizeof(float) * len, MTL::StorageModeShared);
+        MTL::Buffer* bufferA = newBuffer(a, lena);
+        MTL::Buffer* bufferR = newBuffer(result, len);
         return std::vector<MTL::Buffer*>{bufferA, bufferR};
       },
       [&](MTL::ComputeCommandEncoder* encoder, std::vector<MTL::Buffer*>& buffers) {
@@ -566,11 +1257,16 @@ float* Ferrum::MetalEngine::ge_bbB(Ferrum::FunctionID id, int sd, int fd,
                                    const float* a, int lena, int offset_a, int stride_a,
                                    const float* b, int lenb, int offset_b, int stride_b,
                                    float* result, int len, int offset, int stride) {
-  return call_metal(id, result, len, offset, stride,
+  if (!matrixFits("a", lena, offset_a, stride_a, sd, fd) ||
+      !matrixFits("b", lenb, offset_b, stride_b, sd, fd) ||
+      !matrixFits("result", len, offset, stride, sd, fd)) {
+    return nullptr;
+  }
+  return call_metal(pipeline(id, Family::ge, Signature::bbB), Grid{(size_t)sd, (size_t)fd}, result, len,
       [&]() {
-        MTL::Buffer* bufferA = device->newBuffer(a, sizeof(float) * lena, MTL::StorageModeShared);
-        MTL::Buffer* bufferB = device->newBuffer(b, sizeof(float) * lena, MTL::StorageModeShared);
-        MTL::Buffer* bufferR = device->newBuffer(sizeof(float) * len, MTL::StorageModeShared);
+        MTL::Buffer* bufferA = newBuffer(a, lena);
+        MTL::Buffer* bufferB = newBuffer(b, lenb);
+        MTL::Buffer* bufferR = newBuffer(result, len);
         return std::vector<MTL::Buffer*>{bufferA, bufferB, bufferR};
       },
       [&](MTL::ComputeCommandEncoder* encoder, std::vector<MTL::Buffer*>& buffers) {
@@ -593,11 +1289,16 @@ float* Ferrum::MetalEngine::ge_bBB(Ferrum::FunctionID id, int sd, int fd,
                                    const float* a, int lena, int offset_a, int stride_a,
                                    float* b, int lenb, int offset_b, int stride_b,
                                    float* result, int len, int offset, int stride) {
-  return call_metal(id, result, len, offset, stride,
+  if (!matrixFits("a", lena, offset_a, stride_a, sd, fd) ||
+      !matrixFits("b", lenb, offset_b, stride_b, sd, fd) ||
+      !matrixFits("result", len, offset, stride, sd, fd)) {
+    return nullptr;
+  }
+  return call_metal(pipeline(id, Family::ge, Signature::bBB), Grid{(size_t)sd, (size_t)fd}, result, len,
       [&]() {
-        MTL::Buffer* bufferA = device->newBuffer(a, sizeof(float) * lena, MTL::StorageModeShared);
-        MTL::Buffer* bufferB = device->newBuffer(b, sizeof(float) * lena, MTL::StorageModeShared);
-        MTL::Buffer* bufferR = device->newBuffer(sizeof(float) * len, MTL::StorageModeShared);
+        MTL::Buffer* bufferA = newBuffer(a, lena);
+        MTL::Buffer* bufferB = newBuffer(b, lenb);
+        MTL::Buffer* bufferR = newBuffer(result, len);
         return std::vector<MTL::Buffer*>{bufferA, bufferB, bufferR};
       },
       [&](MTL::ComputeCommandEncoder* encoder, std::vector<MTL::Buffer*>& buffers) {
@@ -615,7 +1316,9 @@ float* Ferrum::MetalEngine::ge_bBB(Ferrum::FunctionID id, int sd, int fd,
       },
       [&](std::vector<MTL::Buffer*>& buffers, int len) {
         float* b_result = reinterpret_cast<float*>(buffers[1]->contents());
-        memcpy(b, b_result, sizeof(float) * len);
+        if (b_result != b) {
+          memcpy(b, b_result, sizeof(float) * len);
+        }
       });
 }
 
@@ -624,10 +1327,14 @@ float* Ferrum::MetalEngine::ge_bffffB(Ferrum::FunctionID id, int sd, int fd,
                                       float sa, float sha,
                                       float sb, float shb,
                                       float* result, int len, int offset, int stride) {
-  return call_metal(id, result, len, offset, stride,
+  if (!matrixFits("a", lena, offset_a, stride_a, sd, fd) ||
+      !matrixFits("result", len, offset, stride, sd, fd)) {
+    return nullptr;
+  }
+  return call_metal(pipeline(id, Family::ge, Signature::bffffB), Grid{(size_t)sd, (size_t)fd}, result, len,
       [&]() {
-        MTL::Buffer* bufferA = device->newBuffer(a, sizeof(float) * lena, MTL::StorageModeShared);
-        MTL::Buffer* bufferR = device->newBuffer(sizeof(float) * len, MTL::StorageModeShared);
+        MTL::Buffer* bufferA = newBuffer(a, lena);
+        MTL::Buffer* bufferR = newBuffer(result, len);
         return std::vector<MTL::Buffer*>{bufferA, bufferR};
       },
       [&](MTL::ComputeCommandEncoder* encoder, std::vector<MTL::Buffer*>& buffers) {
@@ -653,11 +1360,16 @@ float* Ferrum::MetalEngine::ge_bbffffB(Ferrum::FunctionID id, int sd, int fd,
                                        float sa, float sha,
                                        float sb, float shb,
                                        float* result, int len, int offset, int stride) {
-  return call_metal(id, result, len, offset, stride,
+  if (!matrixFits("a", lena, offset_a, stride_a, sd, fd) ||
+      !matrixFits("b", lenb, offset_b, stride_b, sd, fd) ||
+      !matrixFits("result", len, offset, stride, sd, fd)) {
+    return nullptr;
+  }
+  return call_metal(pipeline(id, Family::ge, Signature::bbffffB), Grid{(size_t)sd, (size_t)fd}, result, len,
       [&]() {
-        MTL::Buffer* bufferA = device->newBuffer(a, sizeof(float) * lena, MTL::StorageModeShared);
-        MTL::Buffer* bufferB = device->newBuffer(b, sizeof(float) * lena, MTL::StorageModeShared);
-        MTL::Buffer* bufferR = device->newBuffer(sizeof(float) * len, MTL::StorageModeShared);
+        MTL::Buffer* bufferA = newBuffer(a, lena);
+        MTL::Buffer* bufferB = newBuffer(b, lenb);
+        MTL::Buffer* bufferR = newBuffer(result, len);
         return std::vector<MTL::Buffer*>{bufferA, bufferB, bufferR};
       },
       [&](MTL::ComputeCommandEncoder* encoder, std::vector<MTL::Buffer*>& buffers) {
@@ -681,13 +1393,21 @@ float* Ferrum::MetalEngine::ge_bbffffB(Ferrum::FunctionID id, int sd, int fd,
 }
 
 // general uplo functions
+
 float* Ferrum::MetalEngine::uplo_bB(Ferrum::FunctionID id, int sd, int unit, int bottom,
                                     const float* a, int lena, int offset_a, int stride_a,
                                     float* result, int len, int offset, int stride) {
-  return call_metal(id, result, len, offset, stride,
+  if (!packedHasTriangle(id, bottom, {stride_a, stride})) {
+    return nullptr;
+  }
+  if (!triangleFits("a", lena, offset_a, stride_a, sd) ||
+      !triangleFits("result", len, offset, stride, sd)) {
+    return nullptr;
+  }
+  return call_metal(pipeline(id, Family::uplo, Signature::bB), Grid{(size_t)sd, (size_t)sd}, result, len,
       [&]() {
-        MTL::Buffer* bufferA = device->newBuffer(a, sizeof(float) * lena, MTL::StorageModeShared);
-        MTL::Buffer* bufferR = device->newBuffer(sizeof(float) * len, MTL::StorageModeShared);
+        MTL::Buffer* bufferA = newBuffer(a, lena);
+        MTL::Buffer* bufferR = newBuffer(result, len);
         return std::vector<MTL::Buffer*>{bufferA, bufferR};
       },
       [&](MTL::ComputeCommandEncoder* encoder, std::vector<MTL::Buffer*>& buffers) {
@@ -708,10 +1428,17 @@ float* Ferrum::MetalEngine::uplo_bfB(Ferrum::FunctionID id, int sd, int unit, in
                                      const float* a, int lena, int offset_a, int stride_a,
                                      float sa,
                                      float* result, int len, int offset, int stride) {
-  return call_metal(id, result, len, offset, stride,
+  if (!packedHasTriangle(id, bottom, {stride_a, stride})) {
+    return nullptr;
+  }
+  if (!triangleFits("a", lena, offset_a, stride_a, sd) ||
+      !triangleFits("result", len, offset, stride, sd)) {
+    return nullptr;
+  }
+  return call_metal(pipeline(id, Family::uplo, Signature::bfB), Grid{(size_t)sd, (size_t)sd}, result, len,
       [&]() {
-        MTL::Buffer* bufferA = device->newBuffer(a, sizeof(float) * lena, MTL::StorageModeShared);
-        MTL::Buffer* bufferR = device->newBuffer(sizeof(float) * len, MTL::StorageModeShared);
+        MTL::Buffer* bufferA = newBuffer(a, lena);
+        MTL::Buffer* bufferR = newBuffer(result, len);
         return std::vector<MTL::Buffer*>{bufferA, bufferR};
       },
       [&](MTL::ComputeCommandEncoder* encoder, std::vector<MTL::Buffer*>& buffers) {
@@ -733,10 +1460,17 @@ float* Ferrum::MetalEngine::uplo_fbB(Ferrum::FunctionID id, int sd, int unit, in
                                      const float* a, int lena, int offset_a, int stride_a,
 				     float sa,
                                      float* result, int len, int offset, int stride) {
-  return call_metal(id, result, len, offset, stride,
+  if (!packedHasTriangle(id, bottom, {stride_a, stride})) {
+    return nullptr;
+  }
+  if (!triangleFits("a", lena, offset_a, stride_a, sd) ||
+      !triangleFits("result", len, offset, stride, sd)) {
+    return nullptr;
+  }
+  return call_metal(pipeline(id, Family::uplo, Signature::fbB), Grid{(size_t)sd, (size_t)sd}, result, len,
       [&]() {
-        MTL::Buffer* bufferA = device->newBuffer(a, sizeof(float) * lena, MTL::StorageModeShared);
-        MTL::Buffer* bufferR = device->newBuffer(sizeof(float) * len, MTL::StorageModeShared);
+        MTL::Buffer* bufferA = newBuffer(a, lena);
+        MTL::Buffer* bufferR = newBuffer(result, len);
         return std::vector<MTL::Buffer*>{bufferA, bufferR};
       },
       [&](MTL::ComputeCommandEncoder* encoder, std::vector<MTL::Buffer*>& buffers) {
@@ -758,11 +1492,19 @@ float* Ferrum::MetalEngine::uplo_bbB(Ferrum::FunctionID id, int sd, int unit, in
                                      const float* a, int lena, int offset_a, int stride_a,
                                      const float* b, int lenb, int offset_b, int stride_b,
                                      float* result, int len, int offset, int stride) {
-  return call_metal(id, result, len, offset, stride,
+  if (!packedHasTriangle(id, bottom, {stride_a, stride_b, stride})) {
+    return nullptr;
+  }
+  if (!triangleFits("a", lena, offset_a, stride_a, sd) ||
+      !triangleFits("b", lenb, offset_b, stride_b, sd) ||
+      !triangleFits("result", len, offset, stride, sd)) {
+    return nullptr;
+  }
+  return call_metal(pipeline(id, Family::uplo, Signature::bbB), Grid{(size_t)sd, (size_t)sd}, result, len,
       [&]() {
-        MTL::Buffer* bufferA = device->newBuffer(a, sizeof(float) * lena, MTL::StorageModeShared);
-        MTL::Buffer* bufferB = device->newBuffer(b, sizeof(float) * lena, MTL::StorageModeShared);
-        MTL::Buffer* bufferR = device->newBuffer(sizeof(float) * len, MTL::StorageModeShared);
+        MTL::Buffer* bufferA = newBuffer(a, lena);
+        MTL::Buffer* bufferB = newBuffer(b, lenb);
+        MTL::Buffer* bufferR = newBuffer(result, len);
         return std::vector<MTL::Buffer*>{bufferA, bufferB, bufferR};
       },
       [&](MTL::ComputeCommandEncoder* encoder, std::vector<MTL::Buffer*>& buffers) {
@@ -786,11 +1528,19 @@ float* Ferrum::MetalEngine::uplo_bBB(Ferrum::FunctionID id, int sd, int unit, in
                                      const float* a, int lena, int offset_a, int stride_a,
                                      float* b, int lenb, int offset_b, int stride_b,
                                      float* result, int len, int offset, int stride) {
-  return call_metal(id, result, len, offset, stride,
+  if (!packedHasTriangle(id, bottom, {stride_a, stride_b, stride})) {
+    return nullptr;
+  }
+  if (!triangleFits("a", lena, offset_a, stride_a, sd) ||
+      !triangleFits("b", lenb, offset_b, stride_b, sd) ||
+      !triangleFits("result", len, offset, stride, sd)) {
+    return nullptr;
+  }
+  return call_metal(pipeline(id, Family::uplo, Signature::bBB), Grid{(size_t)sd, (size_t)sd}, result, len,
       [&]() {
-        MTL::Buffer* bufferA = device->newBuffer(a, sizeof(float) * lena, MTL::StorageModeShared);
-        MTL::Buffer* bufferB = device->newBuffer(b, sizeof(float) * lena, MTL::StorageModeShared);
-        MTL::Buffer* bufferR = device->newBuffer(sizeof(float) * len, MTL::StorageModeShared);
+        MTL::Buffer* bufferA = newBuffer(a, lena);
+        MTL::Buffer* bufferB = newBuffer(b, lenb);
+        MTL::Buffer* bufferR = newBuffer(result, len);
         return std::vector<MTL::Buffer*>{bufferA, bufferB, bufferR};
       },
       [&](MTL::ComputeCommandEncoder* encoder, std::vector<MTL::Buffer*>& buffers) {
@@ -809,7 +1559,9 @@ float* Ferrum::MetalEngine::uplo_bBB(Ferrum::FunctionID id, int sd, int unit, in
       },
       [&](std::vector<MTL::Buffer*>& buffers, int len) {
         float* b_result = reinterpret_cast<float*>(buffers[1]->contents());
-        memcpy(b, b_result, sizeof(float) * len);
+        if (b_result != b) {
+          memcpy(b, b_result, sizeof(float) * len);
+        }
       });
 }
 
@@ -818,10 +1570,17 @@ float* Ferrum::MetalEngine::uplo_bffffB(Ferrum::FunctionID id, int sd, int unit,
                                         float sa, float sha,
                                         float sb, float shb,
                                         float* result, int len, int offset, int stride) {
-  return call_metal(id, result, len, offset, stride,
+  if (!packedHasTriangle(id, bottom, {stride_a, stride})) {
+    return nullptr;
+  }
+  if (!triangleFits("a", lena, offset_a, stride_a, sd) ||
+      !triangleFits("result", len, offset, stride, sd)) {
+    return nullptr;
+  }
+  return call_metal(pipeline(id, Family::uplo, Signature::bffffB), Grid{(size_t)sd, (size_t)sd}, result, len,
       [&]() {
-        MTL::Buffer* bufferA = device->newBuffer(a, sizeof(float) * lena, MTL::StorageModeShared);
-        MTL::Buffer* bufferR = device->newBuffer(sizeof(float) * len, MTL::StorageModeShared);
+        MTL::Buffer* bufferA = newBuffer(a, lena);
+        MTL::Buffer* bufferR = newBuffer(result, len);
         return std::vector<MTL::Buffer*>{bufferA, bufferR};
       },
       [&](MTL::ComputeCommandEncoder* encoder, std::vector<MTL::Buffer*>& buffers) {
@@ -848,11 +1607,19 @@ float* Ferrum::MetalEngine::uplo_bbffffB(Ferrum::FunctionID id, int sd, int unit
                                          float sa, float sha,
                                          float sb, float shb,
                                          float* result, int len, int offset, int stride) {
-  return call_metal(id, result, len, offset, stride,
+  if (!packedHasTriangle(id, bottom, {stride_a, stride_b, stride})) {
+    return nullptr;
+  }
+  if (!triangleFits("a", lena, offset_a, stride_a, sd) ||
+      !triangleFits("b", lenb, offset_b, stride_b, sd) ||
+      !triangleFits("result", len, offset, stride, sd)) {
+    return nullptr;
+  }
+  return call_metal(pipeline(id, Family::uplo, Signature::bbffffB), Grid{(size_t)sd, (size_t)sd}, result, len,
       [&]() {
-        MTL::Buffer* bufferA = device->newBuffer(a, sizeof(float) * lena, MTL::StorageModeShared);
-        MTL::Buffer* bufferB = device->newBuffer(b, sizeof(float) * lena, MTL::StorageModeShared);
-        MTL::Buffer* bufferR = device->newBuffer(sizeof(float) * len, MTL::StorageModeShared);
+        MTL::Buffer* bufferA = newBuffer(a, lena);
+        MTL::Buffer* bufferB = newBuffer(b, lenb);
+        MTL::Buffer* bufferR = newBuffer(result, len);
         return std::vector<MTL::Buffer*>{bufferA, bufferB, bufferR};
       },
       [&](MTL::ComputeCommandEncoder* encoder, std::vector<MTL::Buffer*>& buffers) {
@@ -877,3 +1644,400 @@ float* Ferrum::MetalEngine::uplo_bbffffB(Ferrum::FunctionID id, int sd, int unit
 }
 
 
+// BLAS functions
+
+float* Ferrum::MetalEngine::ge_gemm(int trans_a, int trans_b, int m, int n, int k,
+                                    float alpha,
+                                    const float* a, int lena, int offset_a, int ld_a,
+                                    const float* b, int lenb, int offset_b, int ld_b,
+                                    float beta,
+                                    float* c, int lenc, int offset_c, int ld_c) {
+  if (m < 0 || n < 0 || k < 0) {
+    std::cerr << "Error: Negative matrix size for ge_gemm" << std::endl;
+    return nullptr;
+  }
+  // a is stored as k x m when it is transposed, and b as n x k
+  if (!matrixFits("a", lena, offset_a, ld_a, trans_a ? k : m, trans_a ? m : k) ||
+      !matrixFits("b", lenb, offset_b, ld_b, trans_b ? n : k, trans_b ? k : n) ||
+      !matrixFits("c", lenc, offset_c, ld_c, m, n)) {
+    return nullptr;
+  }
+  if (m == 0 || n == 0) {
+    return c;
+  }
+  MTL::ComputePipelineState* pipelineState = pipeline(FunctionID::ge_gemm);
+  if (pipelineState != nullptr && pipelineState->maxTotalThreadsPerThreadgroup() < GEMM_THREADS) {
+    std::cerr << "Error: Matrix products need threadgroups of " << GEMM_THREADS << " threads" << std::endl;
+    return nullptr;
+  }
+  Grid groups = gemmGroups(m, n);
+  DBG("Multiplying ", m, "x", k, " by ", k, "x", n, " in ", groups.width * groups.height, " tiles");
+  return encode_metal(pipelineState, c, lenc,
+      [&]() {
+        MTL::Buffer* bufferA = newBuffer(a, lena);
+        MTL::Buffer* bufferB = newBuffer(b, lenb);
+        MTL::Buffer* bufferC = newBuffer(c, lenc);
+        return std::vector<MTL::Buffer*>{bufferA, bufferB, bufferC};
+      },
+      [&](MTL::ComputeCommandEncoder* encoder, std::vector<MTL::Buffer*>& buffers) {
+        encoder->setBytes(&m, sizeof(m), 0);
+        encoder->setBytes(&n, sizeof(n), 1);
+        encoder->setBytes(&k, sizeof(k), 2);
+        encoder->setBytes(&trans_a, sizeof(trans_a), 3);
+        encoder->setBytes(&trans_b, sizeof(trans_b), 4);
+        encoder->setBytes(&alpha, sizeof(alpha), 5);
+        encoder->setBuffer(buffers[0], 0, 6);
+        encoder->setBytes(&offset_a, sizeof(offset_a), 7);
+        encoder->setBytes(&ld_a, sizeof(ld_a), 8);
+        encoder->setBuffer(buffers[1], 0, 9);
+        encoder->setBytes(&offset_b, sizeof(offset_b), 10);
+        encoder->setBytes(&ld_b, sizeof(ld_b), 11);
+        encoder->setBytes(&beta, sizeof(beta), 12);
+        encoder->setBuffer(buffers[2], 0, 13);
+        encoder->setBytes(&offset_c, sizeof(offset_c), 14);
+        encoder->setBytes(&ld_c, sizeof(ld_c), 15);
+        encoder->dispatchThreadgroups(MTL::Size(groups.width, groups.height, 1), MTL::Size(GEMM_THREADS, 1, 1));
+      },
+      emptyAction);
+}
+
+float* Ferrum::MetalEngine::ge_mv(int trans, int m, int n, float alpha,
+                                  const float* a, int lena, int offset_a, int ld_a,
+                                  const float* x, int lenx, int offset_x, int stride_x,
+                                  float beta,
+                                  float* y, int leny, int offset_y, int stride_y) {
+  if (m < 0 || n < 0) {
+    std::cerr << "Error: Negative matrix size for ge_mv" << std::endl;
+    return nullptr;
+  }
+  if (!matrixFits("a", lena, offset_a, ld_a, m, n) ||
+      !vectorFits("x", lenx, offset_x, stride_x, trans ? m : n) ||
+      !vectorFits("y", leny, offset_y, stride_y, trans ? n : m)) {
+    return nullptr;
+  }
+  if ((trans ? n : m) == 0) {
+    return y;
+  }
+  MTL::ComputePipelineState* pipelineState = pipeline(FunctionID::ge_mv);
+  if (pipelineState != nullptr && pipelineState->maxTotalThreadsPerThreadgroup() < GEMV_THREADS) {
+    std::cerr << "Error: Matrix-vector products need threadgroups of " << GEMV_THREADS << " threads" << std::endl;
+    return nullptr;
+  }
+  size_t groups = (pipelineState == nullptr) ? 0 :
+      gemvGroups(trans != 0, m, n, pipelineState->threadExecutionWidth());
+  return encode_metal(pipelineState, y, leny,
+      [&]() {
+        MTL::Buffer* bufferA = newBuffer(a, lena);
+        MTL::Buffer* bufferX = newBuffer(x, lenx);
+        MTL::Buffer* bufferY = newBuffer(y, leny);
+        return std::vector<MTL::Buffer*>{bufferA, bufferX, bufferY};
+      },
+      [&](MTL::ComputeCommandEncoder* encoder, std::vector<MTL::Buffer*>& buffers) {
+        encoder->setBytes(&trans, sizeof(trans), 0);
+        encoder->setBytes(&m, sizeof(m), 1);
+        encoder->setBytes(&n, sizeof(n), 2);
+        encoder->setBytes(&alpha, sizeof(alpha), 3);
+        encoder->setBuffer(buffers[0], 0, 4);
+        encoder->setBytes(&offset_a, sizeof(offset_a), 5);
+        encoder->setBytes(&ld_a, sizeof(ld_a), 6);
+        encoder->setBuffer(buffers[1], 0, 7);
+        encoder->setBytes(&offset_x, sizeof(offset_x), 8);
+        encoder->setBytes(&stride_x, sizeof(stride_x), 9);
+        encoder->setBytes(&beta, sizeof(beta), 10);
+        encoder->setBuffer(buffers[2], 0, 11);
+        encoder->setBytes(&offset_y, sizeof(offset_y), 12);
+        encoder->setBytes(&stride_y, sizeof(stride_y), 13);
+        encoder->dispatchThreadgroups(MTL::Size(groups, 1, 1), MTL::Size(GEMV_THREADS, 1, 1));
+      },
+      emptyAction);
+}
+
+float* Ferrum::MetalEngine::ge_rk(int m, int n, float alpha,
+                                  const float* x, int lenx, int offset_x, int stride_x,
+                                  const float* y, int leny, int offset_y, int stride_y,
+                                  float* a, int lena, int offset_a, int ld_a) {
+  if (m < 0 || n < 0) {
+    std::cerr << "Error: Negative matrix size for ge_rk" << std::endl;
+    return nullptr;
+  }
+  if (!vectorFits("x", lenx, offset_x, stride_x, m) ||
+      !vectorFits("y", leny, offset_y, stride_y, n) ||
+      !matrixFits("a", lena, offset_a, ld_a, m, n)) {
+    return nullptr;
+  }
+  return call_metal(pipeline(FunctionID::ge_rk), Grid{(size_t)m, (size_t)n}, a, lena,
+      [&]() {
+        MTL::Buffer* bufferX = newBuffer(x, lenx);
+        MTL::Buffer* bufferY = newBuffer(y, leny);
+        MTL::Buffer* bufferA = newBuffer(a, lena);
+        return std::vector<MTL::Buffer*>{bufferX, bufferY, bufferA};
+      },
+      [&](MTL::ComputeCommandEncoder* encoder, std::vector<MTL::Buffer*>& buffers) {
+        encoder->setBytes(&m, sizeof(m), 0);
+        encoder->setBytes(&n, sizeof(n), 1);
+        encoder->setBytes(&alpha, sizeof(alpha), 2);
+        encoder->setBuffer(buffers[0], 0, 3);
+        encoder->setBytes(&offset_x, sizeof(offset_x), 4);
+        encoder->setBytes(&stride_x, sizeof(stride_x), 5);
+        encoder->setBuffer(buffers[1], 0, 6);
+        encoder->setBytes(&offset_y, sizeof(offset_y), 7);
+        encoder->setBytes(&stride_y, sizeof(stride_y), 8);
+        encoder->setBuffer(buffers[2], 0, 9);
+        encoder->setBytes(&offset_a, sizeof(offset_a), 10);
+        encoder->setBytes(&ld_a, sizeof(ld_a), 11);
+      },
+      emptyAction);
+}
+
+
+// triangular functions
+
+namespace {
+
+  // A block of a matrix in a buffer, where a transposed block reads the matrix by rows
+  struct MetalView {
+    int offset;
+    int ld;
+    bool trans;
+
+    int row() const { return trans ? ld : 1; }
+    int col() const { return trans ? 1 : ld; }
+    // the part of the matrix from element (i, j)
+    MetalView from(int i, int j) const { return {offset + i * row() + j * col(), ld, trans}; }
+  };
+
+  // Encodes c = alpha * a * b + beta * c, where c is rows x cols and a is rows x depth, with ge_mv
+  // for a single column and ge_gemm otherwise
+  void encodeUpdate(MTL::ComputeCommandEncoder* encoder, MTL::ComputePipelineState* product,
+                    int rows, int cols, int depth, float alpha,
+                    MetalView a, MTL::Buffer* bufferA, MetalView b, MTL::Buffer* bufferB,
+                    float beta, MetalView c, MTL::Buffer* bufferC) {
+    encoder->setComputePipelineState(product);
+    if (cols == 1) {
+      int trans = a.trans;
+      int m = a.trans ? depth : rows;
+      int n = a.trans ? rows : depth;
+      // a column has the stride ld when its view is transposed
+      int strideB = b.row();
+      int strideC = c.row();
+      size_t groups = Ferrum::gemvGroups(a.trans, m, n, product->threadExecutionWidth());
+      encoder->setBytes(&trans, sizeof(trans), 0);
+      encoder->setBytes(&m, sizeof(m), 1);
+      encoder->setBytes(&n, sizeof(n), 2);
+      encoder->setBytes(&alpha, sizeof(alpha), 3);
+      encoder->setBuffer(bufferA, 0, 4);
+      encoder->setBytes(&a.offset, sizeof(a.offset), 5);
+      encoder->setBytes(&a.ld, sizeof(a.ld), 6);
+      encoder->setBuffer(bufferB, 0, 7);
+      encoder->setBytes(&b.offset, sizeof(b.offset), 8);
+      encoder->setBytes(&strideB, sizeof(strideB), 9);
+      encoder->setBytes(&beta, sizeof(beta), 10);
+      encoder->setBuffer(bufferC, 0, 11);
+      encoder->setBytes(&c.offset, sizeof(c.offset), 12);
+      encoder->setBytes(&strideC, sizeof(strideC), 13);
+      encoder->dispatchThreadgroups(MTL::Size(groups, 1, 1), MTL::Size(Ferrum::GEMV_THREADS, 1, 1));
+      return;
+    }
+    // a transposed c is found as c^T = b^T * a^T
+    if (c.trans) {
+      std::swap(a, b);
+      std::swap(bufferA, bufferB);
+      std::swap(rows, cols);
+      a.trans = !a.trans;
+      b.trans = !b.trans;
+    }
+    int transA = a.trans;
+    int transB = b.trans;
+    Ferrum::Grid groups = Ferrum::gemmGroups(rows, cols);
+    encoder->setBytes(&rows, sizeof(rows), 0);
+    encoder->setBytes(&cols, sizeof(cols), 1);
+    encoder->setBytes(&depth, sizeof(depth), 2);
+    encoder->setBytes(&transA, sizeof(transA), 3);
+    encoder->setBytes(&transB, sizeof(transB), 4);
+    encoder->setBytes(&alpha, sizeof(alpha), 5);
+    encoder->setBuffer(bufferA, 0, 6);
+    encoder->setBytes(&a.offset, sizeof(a.offset), 7);
+    encoder->setBytes(&a.ld, sizeof(a.ld), 8);
+    encoder->setBuffer(bufferB, 0, 9);
+    encoder->setBytes(&b.offset, sizeof(b.offset), 10);
+    encoder->setBytes(&b.ld, sizeof(b.ld), 11);
+    encoder->setBytes(&beta, sizeof(beta), 12);
+    encoder->setBuffer(bufferC, 0, 13);
+    encoder->setBytes(&c.offset, sizeof(c.offset), 14);
+    encoder->setBytes(&c.ld, sizeof(c.ld), 15);
+    encoder->dispatchThreadgroups(MTL::Size(groups.width, groups.height, 1), MTL::Size(Ferrum::GEMM_THREADS, 1, 1));
+  }
+
+} // namespace
+
+float* Ferrum::MetalEngine::call_triangular(FunctionID id, bool solve, int left, int trans, int unit, int bottom,
+                                            int m, int n, float alpha,
+                                            const float* a, int lena, int offset_a, int ld_a,
+                                            float* b, int lenb, int offset_b, int ld_b) {
+  if (m < 0 || n < 0) {
+    std::cerr << "Error: Negative matrix size for " << functionName(id) << std::endl;
+    return nullptr;
+  }
+  if (bottom == 0) {
+    std::cerr << "Error: No triangle for " << functionName(id) << std::endl;
+    return nullptr;
+  }
+  int sd = left ? m : n;
+  if (!matrixFits("a", lena, offset_a, ld_a, sd, sd) || !matrixFits("b", lenb, offset_b, ld_b, m, n)) {
+    return nullptr;
+  }
+  if (m == 0 || n == 0) {
+    return b;
+  }
+  if (alpha == 0.0f) {
+    // b is filled with zeros without reading it, so no NaN or Inf in b survives, and a is not read
+    MTL::ComputePipelineState* set = pipeline(FunctionID::vector_set);
+    if (set == nullptr) {
+      return nullptr;
+    }
+    // contiguous columns are filled as one run
+    int rows = (ld_b == m) ? m * n : m;
+    int columns = (ld_b == m) ? 1 : n;
+    return encode_metal(set, b, lenb,
+        [&]() {
+          MTL::Buffer* bufferB = newBuffer(b, lenb);
+          return std::vector<MTL::Buffer*>{bufferB};
+        },
+        [&](MTL::ComputeCommandEncoder* encoder, std::vector<MTL::Buffer*>& buffers) {
+          DispatchPlan plan = planDispatch(Grid{(size_t)rows, 1}, set->threadExecutionWidth(),
+                                           set->maxTotalThreadsPerThreadgroup());
+          float zero = 0.0f;
+          int first = 0;
+          int stride = 1;
+          for (int j = 0; j < columns; j++) {
+            int offset = offset_b + j * ld_b;
+            encoder->setBytes(&zero, sizeof(zero), 0);
+            // set does not read x
+            encoder->setBuffer(buffers[0], 0, 1);
+            encoder->setBytes(&first, sizeof(first), 2);
+            encoder->setBytes(&stride, sizeof(stride), 3);
+            encoder->setBuffer(buffers[0], 0, 4);
+            encoder->setBytes(&offset, sizeof(offset), 5);
+            encoder->setBytes(&stride, sizeof(stride), 6);
+            encoder->dispatchThreads(MTL::Size(plan.threads.width, 1, 1), MTL::Size(plan.threadsPerGroup.width, 1, 1));
+          }
+        },
+        emptyAction);
+  }
+  // b * op(a) = (op(a)^T * b^T)^T
+  bool transposed = left ? trans != 0 : trans == 0;
+  int cols = left ? n : m;
+  int lower = (bottom > 0) != transposed;
+  int isUnit = unit == 132;
+  MetalView viewA = {offset_a, ld_a, transposed};
+  MetalView viewB = {offset_b, ld_b, left == 0};
+
+  MTL::ComputePipelineState* diagonal = pipeline(id);
+  MTL::ComputePipelineState* product = pipeline((cols == 1) ? FunctionID::ge_mv : FunctionID::ge_gemm);
+  if (diagonal == nullptr || product == nullptr) {
+    return nullptr;
+  }
+  size_t productThreads = (cols == 1) ? GEMV_THREADS : GEMM_THREADS;
+  if (product->maxTotalThreadsPerThreadgroup() < productThreads) {
+    std::cerr << "Error: Triangular functions need threadgroups of " << productThreads << " threads" << std::endl;
+    return nullptr;
+  }
+  const int block = TRIANGULAR_BLOCK;
+  int blocks = (sd + block - 1) / block;
+  // solving a lower triangle, or multiplying by an upper one, works down from the first block
+  bool down = solve == (lower != 0);
+  DBG("Encoding ", id, " of ", sd, "x", cols, " in ", blocks, " blocks");
+
+  return encode_metal(diagonal, b, lenb,
+      [&]() {
+        MTL::Buffer* bufferA = newBuffer(a, lena);
+        MTL::Buffer* bufferB = newBuffer(b, lenb);
+        return std::vector<MTL::Buffer*>{bufferA, bufferB};
+      },
+      [&](MTL::ComputeCommandEncoder* encoder, std::vector<MTL::Buffer*>& buffers) {
+        DispatchPlan plan = planDispatch(Grid{(size_t)cols, 1}, diagonal->threadExecutionWidth(),
+                                         diagonal->maxTotalThreadsPerThreadgroup());
+        for (int s = 0; s < blocks; s++) {
+          int k = (down ? s : blocks - 1 - s) * block;
+          int size = std::min(block, sd - k);
+          MetalView d = viewA.from(k, k);
+          MetalView rows = viewB.from(k, 0);
+          int rowA = d.row();
+          int colA = d.col();
+          int rowB = rows.row();
+          int colB = rows.col();
+          // a solve applies alpha to each row the first time that it is written
+          float blockAlpha = (!solve || s == 0) ? alpha : 1.0f;
+
+          encoder->setComputePipelineState(diagonal);
+          encoder->setBytes(&size, sizeof(size), 0);
+          encoder->setBytes(&cols, sizeof(cols), 1);
+          encoder->setBytes(&lower, sizeof(lower), 2);
+          encoder->setBytes(&isUnit, sizeof(isUnit), 3);
+          encoder->setBytes(&blockAlpha, sizeof(blockAlpha), 4);
+          encoder->setBuffer(buffers[0], 0, 5);
+          encoder->setBytes(&d.offset, sizeof(d.offset), 6);
+          encoder->setBytes(&rowA, sizeof(rowA), 7);
+          encoder->setBytes(&colA, sizeof(colA), 8);
+          encoder->setBuffer(buffers[1], 0, 9);
+          encoder->setBytes(&rows.offset, sizeof(rows.offset), 10);
+          encoder->setBytes(&rowB, sizeof(rowB), 11);
+          encoder->setBytes(&colB, sizeof(colB), 12);
+          encoder->dispatchThreads(MTL::Size(plan.threads.width, 1, 1), MTL::Size(plan.threadsPerGroup.width, 1, 1));
+
+          if (solve) {
+            // the rows that are still to be solved subtract this block's part of their sums
+            int first = lower ? k + size : 0;
+            int count = lower ? sd - first : k;
+            if (count > 0) {
+              encodeUpdate(encoder, product, count, cols, size, -1.0f, viewA.from(first, k), buffers[0],
+                           rows, buffers[1], blockAlpha, viewB.from(first, 0), buffers[1]);
+            }
+          } else {
+            // add the part of the sums from the rows that have not been written yet
+            int first = lower ? 0 : k + size;
+            int count = lower ? k : sd - first;
+            if (count > 0) {
+              encodeUpdate(encoder, product, size, cols, count, alpha, viewA.from(k, first), buffers[0],
+                           viewB.from(first, 0), buffers[1], 1.0f, rows, buffers[1]);
+            }
+          }
+        }
+      },
+      emptyAction);
+}
+
+float* Ferrum::MetalEngine::uplo_trmv(int trans, int sd, int unit, int bottom,
+                                      const float* a, int lena, int offset_a, int ld_a,
+                                      float* x, int lenx, int offset_x, int stride_x) {
+  if (!vectorFits("x", lenx, offset_x, stride_x, sd)) {
+    return nullptr;
+  }
+  // x is a row of b on the right, with the stride as its leading dimension: (op(a) * x)^T = x^T * op(a)^T
+  return call_triangular(FunctionID::uplo_trmv, false, 0, !trans, unit, bottom, 1, sd, 1.0f,
+                         a, lena, offset_a, ld_a, x, lenx, offset_x, stride_x);
+}
+
+float* Ferrum::MetalEngine::uplo_trsv(int trans, int sd, int unit, int bottom,
+                                      const float* a, int lena, int offset_a, int ld_a,
+                                      float* x, int lenx, int offset_x, int stride_x) {
+  if (!vectorFits("x", lenx, offset_x, stride_x, sd)) {
+    return nullptr;
+  }
+  return call_triangular(FunctionID::uplo_trsv, true, 0, !trans, unit, bottom, 1, sd, 1.0f,
+                         a, lena, offset_a, ld_a, x, lenx, offset_x, stride_x);
+}
+
+float* Ferrum::MetalEngine::uplo_trmm(int left, int trans, int unit, int bottom, int m, int n, float alpha,
+                                      const float* a, int lena, int offset_a, int ld_a,
+                                      float* b, int lenb, int offset_b, int ld_b) {
+  return call_triangular(FunctionID::uplo_trmm, false, left, trans, unit, bottom, m, n, alpha,
+                         a, lena, offset_a, ld_a, b, lenb, offset_b, ld_b);
+}
+
+float* Ferrum::MetalEngine::uplo_trsm(int left, int trans, int unit, int bottom, int m, int n, float alpha,
+                                      const float* a, int lena, int offset_a, int ld_a,
+                                      float* b, int lenb, int offset_b, int ld_b) {
+  return call_triangular(FunctionID::uplo_trsm, true, left, trans, unit, bottom, m, n, alpha,
+                         a, lena, offset_a, ld_a, b, lenb, offset_b, ld_b);
+}
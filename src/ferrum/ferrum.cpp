@@ -1,13 +1,37 @@
 #include <jni.h>
 #include "ferrum_FerrumEngine.h"
 
-#include "engine.hpp"
+#include "backend.hpp"
+#include "buffer_pool.hpp"
+#include "fusion.hpp"
+#include "lazy_graph.hpp"
+#include "debug.hpp"
+#include <climits>
 #include <iostream>
+#include <memory>
+#include <type_traits>
+#include <vector>
 
 #define ILLEGAL_ARG_EX "java/lang/IllegalArgumentException"
+#define ILLEGAL_STATE_EX "java/lang/IllegalStateException"
 
+// Set once when the library is loaded, and only read after that, so that calls from any thread can use it
 static jfieldID engineFieldID;
 
+JNIEXPORT jint JNICALL JNI_OnLoad(JavaVM* vm, void* reserved) {
+  JNIEnv* env;
+  if (vm->GetEnv(reinterpret_cast<void**>(&env), JNI_VERSION_1_8) != JNI_OK) {
+    return JNI_ERR;
+  }
+  jclass cls = env->FindClass("ferrum/FerrumEngine");
+  if (cls == nullptr) {
+    return JNI_ERR;
+  }
+  engineFieldID = env->GetFieldID(cls, "engineHandle", "J");
+  env->DeleteLocalRef(cls);
+  return engineFieldID == nullptr ? JNI_ERR : JNI_VERSION_1_8;
+}
+
 JNIEXPORT jlong JNICALL Java_ferrum_FerrumEngine_init(JNIEnv* env, jclass cls, jstring path) {
   DBG("Initializing engine");
   DBG("Converting path from JVM to C++");
@@ -15,63 +39,144 @@ JNIEXPORT jlong JNICALL Java_ferrum_FerrumEngine_init(JNIEnv* env, jclass cls, j
   cpath = path ? (char*)env->GetStringUTFChars(path, NULL) : NULL;
   DBG("Converted path");
   DBG("Creating engine");
-  Ferrum::MetalEngine* engine = new Ferrum::MetalEngine(cpath);
-  DBG("Created engine");
-  env->ReleaseStringUTFChars(path, cpath);
-  // This will stay valid while the engine class is loaded. There is no harm is setting it again.
-  DBG("Getting engine field ID, and saving");
-  engineFieldID = env->GetFieldID(cls, "engineHandle", "J");
-  DBG("returning engine handle");
+  Ferrum::Engine* engine = Ferrum::createEngine(cpath);
+  if (path != NULL) {
+    env->ReleaseStringUTFChars(path, cpath);
+  }
+  if (engine == nullptr) {
+    env->ThrowNew(env->FindClass(ILLEGAL_STATE_EX), "Unable to create a compute engine");
+    return 0;
+  }
+  DBG("Created engine: ", engine->name());
   return reinterpret_cast<jlong>(engine);
 }
 
 JNIEXPORT void JNICALL Java_ferrum_FerrumEngine_close(JNIEnv* env, jclass cls, jlong engine) {
-  Ferrum::MetalEngine* e = reinterpret_cast<Ferrum::MetalEngine*>(engine);
+  Ferrum::Engine* e = reinterpret_cast<Ferrum::Engine*>(engine);
   delete e;
 }
 
+JNIEXPORT jstring JNICALL Java_ferrum_FerrumEngine_backendName(JNIEnv* env, jclass cls, jlong engine) {
+  Ferrum::Engine* e = reinterpret_cast<Ferrum::Engine*>(engine);
+  return env->NewStringUTF(e->name());
+}
+
 // vector function implementations
 
-template <typename CallWithArgs>
-JNIEXPORT jfloatArray JNICALL vect1(JNIEnv* env, jobject obj, jstring fn,
-                                    jfloatArray a,
-                                    CallWithArgs call) {
-  const char* cfn = env->GetStringUTFChars(fn, NULL);
-  Ferrum::FunctionID fnId = Ferrum::getFunctionID(cfn);
-  if (fnId == Ferrum::FunctionID::UNKNOWN) {
-    std::string msg = "Unknown function: " + std::string(cfn);
-    env->ReleaseStringUTFChars(fn, cfn);
+// The elements of float, double and short arrays, so that every precision shares vect1 and vect2.
+// Short arrays hold the bits of half precision values.
+template <typename Array> struct ArrayElements;
+
+template <> struct ArrayElements<jfloatArray> {
+  using Element = jfloat;
+  static jfloatArray create(JNIEnv* env, int length) { return env->NewFloatArray(length); }
+  static void read(JNIEnv* env, jfloatArray array, int length, jfloat* elements) {
+    env->GetFloatArrayRegion(array, 0, length, elements);
+  }
+  static void write(JNIEnv* env, jfloatArray array, int length, const jfloat* elements) {
+    env->SetFloatArrayRegion(array, 0, length, elements);
+  }
+};
+
+template <> struct ArrayElements<jdoubleArray> {
+  using Element = jdouble;
+  static jdoubleArray create(JNIEnv* env, int length) { return env->NewDoubleArray(length); }
+  static void read(JNIEnv* env, jdoubleArray array, int length, jdouble* elements) {
+    env->GetDoubleArrayRegion(array, 0, length, elements);
+  }
+  static void write(JNIEnv* env, jdoubleArray array, int length, const jdouble* elements) {
+    env->SetDoubleArrayRegion(array, 0, length, elements);
+  }
+};
+
+template <> struct ArrayElements<jshortArray> {
+  using Element = jshort;
+  static jshortArray create(JNIEnv* env, int length) { return env->NewShortArray(length); }
+  static void read(JNIEnv* env, jshortArray array, int length, jshort* elements) {
+    env->GetShortArrayRegion(array, 0, length, elements);
+  }
+  static void write(JNIEnv* env, jshortArray array, int length, const jshort* elements) {
+    env->SetShortArrayRegion(array, 0, length, elements);
+  }
+};
+
+// Checks a function ID from Java, or throws and returns UNKNOWN.
+// Java looks up the names (see Functions.java), so no strings are passed on each call.
+Ferrum::FunctionID functionID(JNIEnv* env, jint fn) {
+  if (fn < 0 || fn >= Ferrum::functionCount) {
+    std::string msg = "Unknown function ID: " + std::to_string(fn);
     env->ThrowNew(env->FindClass(ILLEGAL_ARG_EX), msg.c_str());
+    return Ferrum::FunctionID::UNKNOWN;
+  }
+  return static_cast<Ferrum::FunctionID>(fn);
+}
+
+// Finds the engine for an array function, or throws and returns nullptr if it cannot be called
+template <typename Array>
+Ferrum::Engine* arrayEngine(JNIEnv* env, jobject obj) {
+  Ferrum::Engine* engine = reinterpret_cast<Ferrum::Engine*>(env->GetLongField(obj, engineFieldID));
+  if (engine->inBatch()) {
+    env->ThrowNew(env->FindClass(ILLEGAL_STATE_EX), "Only tensors can be used in a batch");
+    return nullptr;
+  }
+  if (std::is_same_v<Array, jdoubleArray> && !engine->doublePrecision()) {
+    std::string msg = "The " + std::string(engine->name()) + " engine has no double precision";
+    env->ThrowNew(env->FindClass(ILLEGAL_STATE_EX), msg.c_str());
+    return nullptr;
+  }
+  if (std::is_same_v<Array, jshortArray> && !engine->halfStorage()) {
+    std::string msg = "The " + std::string(engine->name()) + " engine has no half precision storage";
+    env->ThrowNew(env->FindClass(ILLEGAL_STATE_EX), msg.c_str());
+    return nullptr;
+  }
+  return engine;
+}
+
+// The arguments are copied out of the Java arrays, and the result into a new one. No array is held
+// while the engine works, which could keep the garbage collector waiting for a device.
+template <typename Array, typename CallWithArgs>
+JNIEXPORT Array JNICALL vect1(JNIEnv* env, jobject obj, jint fn,
+                              Array a,
+                              CallWithArgs call) {
+  using Elements = ArrayElements<Array>;
+  Ferrum::FunctionID fnId = functionID(env, fn);
+  if (fnId == Ferrum::FunctionID::UNKNOWN) {
+    return NULL;
+  }
+  Ferrum::Engine* engine = arrayEngine<Array>(env, obj);
+  if (engine == nullptr) {
     return NULL;
   }
-  env->ReleaseStringUTFChars(fn, cfn);
-  Ferrum::MetalEngine* engine = reinterpret_cast<Ferrum::MetalEngine*>(env->GetLongField(obj, engineFieldID));
   int len = env->GetArrayLength(a);
-  jfloat *aa = env->GetFloatArrayElements(a, NULL);
-  jfloatArray jresult = env->NewFloatArray(len);
-  jfloat *res = env->GetFloatArrayElements(jresult, NULL);
-  call(engine, fnId, aa, len, res);
-  env->ReleaseFloatArrayElements(a, aa, JNI_ABORT);
-  env->ReleaseFloatArrayElements(jresult, res, 0);
+  std::vector<typename Elements::Element> aa(len);
+  std::vector<typename Elements::Element> res(len);
+  Elements::read(env, a, len, aa.data());
+  if (len > 0) {
+    call(engine, fnId, aa.data(), len, res.data());
+  }
+  Array jresult = Elements::create(env, len);
+  if (jresult == NULL) {
+    return NULL;
+  }
+  Elements::write(env, jresult, len, res.data());
   return jresult;
 }
 
 enum class ArgSelection { A, B };
 
-template <typename CallWithArgs>
-JNIEXPORT jfloatArray JNICALL vect2(JNIEnv* env, jobject obj, jstring fn,
-                                    jfloatArray a, jfloatArray b,
-                                    CallWithArgs call) {
-  const char* cfn = env->GetStringUTFChars(fn, NULL);
-  Ferrum::FunctionID fnId = Ferrum::getFunctionID(cfn);
+template <typename Array, typename CallWithArgs>
+JNIEXPORT Array JNICALL vect2(JNIEnv* env, jobject obj, jint fn,
+                              Array a, Array b,
+                              CallWithArgs call) {
+  using Elements = ArrayElements<Array>;
+  Ferrum::FunctionID fnId = functionID(env, fn);
   if (fnId == Ferrum::FunctionID::UNKNOWN) {
-    std::string msg = "Unknown function: " + std::string(cfn);
-    env->ReleaseStringUTFChars(fn, cfn);
-    env->ThrowNew(env->FindClass(ILLEGAL_ARG_EX), msg.c_str());
     return NULL;
   }
-  env->ReleaseStringUTFChars(fn, cfn);
-  Ferrum::MetalEngine* engine = reinterpret_cast<Ferrum::MetalEngine*>(env->GetLongField(obj, engineFieldID));
+  Ferrum::Engine* engine = arrayEngine<Array>(env, obj);
+  if (engine == nullptr) {
+    return NULL;
+  }
   int lena = env->GetArrayLength(a);
   int lenb = env->GetArrayLength(b);
   // take on the same shape as the shorter of the two
@@ -84,46 +189,55 @@ JNIEXPORT jfloatArray JNICALL vect2(JNIEnv* env, jobject obj, jstring fn,
     lenr = lenb;
     args = ArgSelection::B;
   }
-  int len = lena < lenb ? lena : lenb;
-  jfloat *aa = env->GetFloatArrayElements(a, NULL);
-  jfloat *bb = env->GetFloatArrayElements(b, NULL);
-  jfloatArray jresult = env->NewFloatArray(len);
-  jfloat *res = env->GetFloatArrayElements(jresult, NULL);
-  int keep = call(engine, fnId, aa, lena, bb, lenb, res, lenr, args);
-  env->ReleaseFloatArrayElements(a, aa, JNI_ABORT);
-  env->ReleaseFloatArrayElements(b, bb, keep);
-  env->ReleaseFloatArrayElements(jresult, res, 0);
+  std::vector<typename Elements::Element> aa(lena);
+  std::vector<typename Elements::Element> bb(lenb);
+  std::vector<typename Elements::Element> res(lenr);
+  Elements::read(env, a, lena, aa.data());
+  Elements::read(env, b, lenb, bb.data());
+  int keep = JNI_ABORT;
+  if (lenr > 0) {
+    keep = call(engine, fnId, aa.data(), lena, bb.data(), lenb, res.data(), lenr, args);
+  }
+  Array jresult = Elements::create(env, lenr);
+  if (jresult == NULL) {
+    return NULL;
+  }
+  Elements::write(env, jresult, lenr, res.data());
+  // functions that also write to b keep it
+  if (keep != JNI_ABORT) {
+    Elements::write(env, b, lenb, bb.data());
+  }
   return jresult;
 }
 
 JNIEXPORT jfloatArray JNICALL Java_ferrum_FerrumEngine_vect_1bB
-  (JNIEnv* env, jobject obj, jstring fn, jfloatArray a, jint offset_a, jint stride_a) {
+  (JNIEnv* env, jobject obj, jint fn, jfloatArray a, jint offset_a, jint stride_a) {
   return vect1(env, obj, fn, a,
-               [=](Ferrum::MetalEngine* engine, Ferrum::FunctionID fnId, jfloat* a, int len, jfloat* res) {
+               [=](Ferrum::Engine* engine, Ferrum::FunctionID fnId, jfloat* a, int len, jfloat* res) {
                  engine->vect_bB(fnId, a, len, offset_a, stride_a, res, len, offset_a, stride_a);
                });
 }
 
 JNIEXPORT jfloatArray JNICALL Java_ferrum_FerrumEngine_vect_1bfB
-  (JNIEnv* env, jobject obj, jstring fn, jfloatArray a, jint offset_a, jint stride_a, jfloat sa) {
+  (JNIEnv* env, jobject obj, jint fn, jfloatArray a, jint offset_a, jint stride_a, jfloat sa) {
   return vect1(env, obj, fn, a,
-               [=](Ferrum::MetalEngine* engine, Ferrum::FunctionID fnId, jfloat* a, int len, jfloat* res) {
+               [=](Ferrum::Engine* engine, Ferrum::FunctionID fnId, jfloat* a, int len, jfloat* res) {
                  engine->vect_bfB(fnId, a, len, offset_a, stride_a, sa, res, len, offset_a, stride_a);
                });
 }
 
 JNIEXPORT jfloatArray JNICALL Java_ferrum_FerrumEngine_vect_1fbB
-  (JNIEnv* env, jobject obj, jstring fn, jfloat sa, jfloatArray a, jint offset_a, jint stride_a) {
+  (JNIEnv* env, jobject obj, jint fn, jfloat sa, jfloatArray a, jint offset_a, jint stride_a) {
   return vect1(env, obj, fn, a,
-               [=](Ferrum::MetalEngine* engine, Ferrum::FunctionID fnId, jfloat* a, int len, jfloat* res) {
+               [=](Ferrum::Engine* engine, Ferrum::FunctionID fnId, jfloat* a, int len, jfloat* res) {
                  engine->vect_fbB(fnId, sa, a, len, offset_a, stride_a, res, len, offset_a, stride_a);
                });
 }
 
 JNIEXPORT jfloatArray JNICALL Java_ferrum_FerrumEngine_vect_1bbB
-  (JNIEnv* env, jobject obj, jstring fn, jfloatArray a, jint offset_a, jint stride_a, jfloatArray b, jint offset_b, jint stride_b) {
+  (JNIEnv* env, jobject obj, jint fn, jfloatArray a, jint offset_a, jint stride_a, jfloatArray b, jint offset_b, jint stride_b) {
   return vect2(env, obj, fn, a, b,
-               [=](Ferrum::MetalEngine* engine, Ferrum::FunctionID fnId, jfloat* a, int lena, jfloat* b, int lenb, jfloat* res, int lenr, ArgSelection args) {
+               [=](Ferrum::Engine* engine, Ferrum::FunctionID fnId, jfloat* a, int lena, jfloat* b, int lenb, jfloat* res, int lenr, ArgSelection args) {
                  int offset, stride;
                  if (args == ArgSelection::A) {
                    offset = offset_a;
@@ -138,9 +252,9 @@ JNIEXPORT jfloatArray JNICALL Java_ferrum_FerrumEngine_vect_1bbB
 }
 
 JNIEXPORT jfloatArray JNICALL Java_ferrum_FerrumEngine_vect_1bBB
-  (JNIEnv* env, jobject obj, jstring fn, jfloatArray a, jint offset_a, jint stride_a, jfloatArray b, jint offset_b, jint stride_b) {
+  (JNIEnv* env, jobject obj, jint fn, jfloatArray a, jint offset_a, jint stride_a, jfloatArray b, jint offset_b, jint stride_b) {
   return vect2(env, obj, fn, a, b,
-               [=](Ferrum::MetalEngine* engine, Ferrum::FunctionID fnId, jfloat* a, int lena, jfloat* b, int lenb, jfloat* res, int lenr, ArgSelection args) {
+               [=](Ferrum::Engine* engine, Ferrum::FunctionID fnId, jfloat* a, int lena, jfloat* b, int lenb, jfloat* res, int lenr, ArgSelection args) {
                  int offset, stride;
                  if (args == ArgSelection::A) {
                    offset = offset_a;
@@ -155,9 +269,9 @@ JNIEXPORT jfloatArray JNICALL Java_ferrum_FerrumEngine_vect_1bBB
 }
 
 JNIEXPORT jfloatArray JNICALL Java_ferrum_FerrumEngine_vect_1bffffB
-  (JNIEnv* env, jobject obj, jstring fn, jfloatArray a, jint offset_a, jint stride_a, jfloat sa, jfloat sha, jfloat sb, jfloat shb) {
+  (JNIEnv* env, jobject obj, jint fn, jfloatArray a, jint offset_a, jint stride_a, jfloat sa, jfloat sha, jfloat sb, jfloat shb) {
   return vect1(env, obj, fn, a,
-               [=](Ferrum::MetalEngine* engine, Ferrum::FunctionID fnId, jfloat* a, int len, jfloat* res) {
+               [=](Ferrum::Engine* engine, Ferrum::FunctionID fnId, jfloat* a, int len, jfloat* res) {
                  engine->vect_bffffB(fnId, a, len, offset_a, stride_a,
                                      sa, sha, sb, shb,
                                      res, len, offset_a, stride_a);
@@ -165,10 +279,10 @@ JNIEXPORT jfloatArray JNICALL Java_ferrum_FerrumEngine_vect_1bffffB
 }
 
 JNIEXPORT jfloatArray JNICALL Java_ferrum_FerrumEngine_vect_1bbffffB
-  (JNIEnv* env, jobject obj, jstring fn, jfloatArray a, jint offset_a, jint stride_a, jfloatArray b, jint offset_b, jint stride_b,
+  (JNIEnv* env, jobject obj, jint fn, jfloatArray a, jint offset_a, jint stride_a, jfloatArray b, jint offset_b, jint stride_b,
    jfloat sa, jfloat sha, jfloat sb, jfloat shb) {
   return vect2(env, obj, fn, a, b,
-               [=](Ferrum::MetalEngine* engine, Ferrum::FunctionID fnId, jfloat* a, int lena, jfloat* b, int lenb, jfloat* res, int lenr, ArgSelection args) {
+               [=](Ferrum::Engine* engine, Ferrum::FunctionID fnId, jfloat* a, int lena, jfloat* b, int lenb, jfloat* res, int lenr, ArgSelection args) {
                  int offset, stride;
                  if (args == ArgSelection::A) {
                    offset = offset_a;
@@ -184,3 +298,1026 @@ JNIEXPORT jfloatArray JNICALL Java_ferrum_FerrumEngine_vect_1bbffffB
                });
 }
 
+
+// vector functions on direct buffers, which the engine reads and writes in place
+
+// The memory of a direct buffer, and its capacity in elements, or throws and returns nullptr
+jfloat* directElements(JNIEnv* env, jobject buffer, int& length) {
+  void* address = env->GetDirectBufferAddress(buffer);
+  jlong capacity = env->GetDirectBufferCapacity(buffer);
+  if (address == nullptr || capacity < 0 || capacity > INT_MAX) {
+    env->ThrowNew(env->FindClass(ILLEGAL_ARG_EX), "Expected a direct buffer of no more than 2^31 - 1 elements");
+    return nullptr;
+  }
+  length = capacity;
+  return static_cast<jfloat*>(address);
+}
+
+// The memory of FerrumEngine.newFloatBuffer, which engines may use in place (see newHostMemory).
+// The Java buffer frees it with releaseHost once the buffer has been collected.
+JNIEXPORT jlong JNICALL Java_ferrum_FerrumEngine_allocateHost(JNIEnv* env, jclass cls, jint length) {
+  float* data = Ferrum::newHostMemory(length);
+  if (data == nullptr) {
+    env->ThrowNew(env->FindClass(ILLEGAL_STATE_EX), "Unable to allocate a float buffer");
+    return 0;
+  }
+  return reinterpret_cast<jlong>(data);
+}
+
+JNIEXPORT jobject JNICALL Java_ferrum_FerrumEngine_hostBuffer(JNIEnv* env, jclass cls, jlong address, jint length) {
+  jobject buffer = env->NewDirectByteBuffer(reinterpret_cast<void*>(address), (jlong)length * sizeof(jfloat));
+  if (buffer == NULL) {
+    Ferrum::releaseHostMemory(reinterpret_cast<float*>(address));
+    if (!env->ExceptionCheck()) {
+      env->ThrowNew(env->FindClass(ILLEGAL_STATE_EX), "Direct buffers are not supported");
+    }
+  }
+  return buffer;
+}
+
+JNIEXPORT void JNICALL Java_ferrum_FerrumEngine_releaseHost(JNIEnv* env, jclass cls, jlong address) {
+  Ferrum::releaseHostMemory(reinterpret_cast<float*>(address));
+}
+
+// The result is laid out like a, with the length of its own buffer
+template <typename CallWithArgs>
+jobject direct1(JNIEnv* env, jobject obj, jint fn,
+                jobject a, jobject result,
+                CallWithArgs call) {
+  Ferrum::FunctionID fnId = functionID(env, fn);
+  if (fnId == Ferrum::FunctionID::UNKNOWN) {
+    return NULL;
+  }
+  Ferrum::Engine* engine = arrayEngine<jfloatArray>(env, obj);
+  if (engine == nullptr) {
+    return NULL;
+  }
+  int lena, lenr;
+  jfloat* aa = directElements(env, a, lena);
+  jfloat* res = aa == nullptr ? nullptr : directElements(env, result, lenr);
+  if (res == nullptr) {
+    return NULL;
+  }
+  call(engine, fnId, aa, lena, res, lenr);
+  return result;
+}
+
+// The result is laid out like the shorter of a and b, with the length of its own buffer
+template <typename CallWithArgs>
+jobject direct2(JNIEnv* env, jobject obj, jint fn,
+                jobject a, jobject b, jobject result,
+                CallWithArgs call) {
+  Ferrum::FunctionID fnId = functionID(env, fn);
+  if (fnId == Ferrum::FunctionID::UNKNOWN) {
+    return NULL;
+  }
+  Ferrum::Engine* engine = arrayEngine<jfloatArray>(env, obj);
+  if (engine == nullptr) {
+    return NULL;
+  }
+  int lena, lenb, lenr;
+  jfloat* aa = directElements(env, a, lena);
+  jfloat* bb = aa == nullptr ? nullptr : directElements(env, b, lenb);
+  jfloat* res = bb == nullptr ? nullptr : directElements(env, result, lenr);
+  if (res == nullptr) {
+    return NULL;
+  }
+  call(engine, fnId, aa, lena, bb, lenb, res, lenr, lena < lenb ? ArgSelection::A : ArgSelection::B);
+  return result;
+}
+
+JNIEXPORT jobject JNICALL Java_ferrum_FerrumEngine_vect_1bB_1direct
+  (JNIEnv* env, jobject obj, jint fn, jobject a, jint offset_a, jint stride_a, jobject result) {
+  return direct1(env, obj, fn, a, result,
+                 [=](Ferrum::Engine* engine, Ferrum::FunctionID fnId, jfloat* a, int lena, jfloat* res, int lenr) {
+                   engine->vect_bB(fnId, a, lena, offset_a, stride_a, res, lenr, offset_a, stride_a);
+                 });
+}
+
+JNIEXPORT jobject JNICALL Java_ferrum_FerrumEngine_vect_1bfB_1direct
+  (JNIEnv* env, jobject obj, jint fn, jobject a, jint offset_a, jint stride_a, jfloat sa, jobject result) {
+  return direct1(env, obj, fn, a, result,
+                 [=](Ferrum::Engine* engine, Ferrum::FunctionID fnId, jfloat* a, int lena, jfloat* res, int lenr) {
+                   engine->vect_bfB(fnId, a, lena, offset_a, stride_a, sa, res, lenr, offset_a, stride_a);
+                 });
+}
+
+JNIEXPORT jobject JNICALL Java_ferrum_FerrumEngine_vect_1fbB_1direct
+  (JNIEnv* env, jobject obj, jint fn, jfloat sa, jobject a, jint offset_a, jint stride_a, jobject result) {
+  return direct1(env, obj, fn, a, result,
+                 [=](Ferrum::Engine* engine, Ferrum::FunctionID fnId, jfloat* a, int lena, jfloat* res, int lenr) {
+                   engine->vect_fbB(fnId, sa, a, lena, offset_a, stride_a, res, lenr, offset_a, stride_a);
+                 });
+}
+
+JNIEXPORT jobject JNICALL Java_ferrum_FerrumEngine_vect_1bbB_1direct
+  (JNIEnv* env, jobject obj, jint fn, jobject a, jint offset_a, jint stride_a, jobject b, jint offset_b, jint stride_b, jobject result) {
+  return direct2(env, obj, fn, a, b, result,
+                 [=](Ferrum::Engine* engine, Ferrum::FunctionID fnId, jfloat* a, int lena, jfloat* b, int lenb, jfloat* res, int lenr, ArgSelection args) {
+                   int offset, stride;
+                   if (args == ArgSelection::A) {
+                     offset = offset_a;
+                     stride = stride_a;
+                   } else {
+                     offset = offset_b;
+                     stride = stride_b;
+                   }
+                   engine->vect_bbB(fnId, a, lena, offset_a, stride_a, b, lenb, offset_b, stride_b, res, lenr, offset, stride);
+                 });
+}
+
+JNIEXPORT jobject JNICALL Java_ferrum_FerrumEngine_vect_1bBB_1direct
+  (JNIEnv* env, jobject obj, jint fn, jobject a, jint offset_a, jint stride_a, jobject b, jint offset_b, jint stride_b, jobject result) {
+  return direct2(env, obj, fn, a, b, result,
+                 [=](Ferrum::Engine* engine, Ferrum::FunctionID fnId, jfloat* a, int lena, jfloat* b, int lenb, jfloat* res, int lenr, ArgSelection args) {
+                   int offset, stride;
+                   if (args == ArgSelection::A) {
+                     offset = offset_a;
+                     stride = stride_a;
+                   } else {
+                     offset = offset_b;
+                     stride = stride_b;
+                   }
+                   engine->vect_bBB(fnId, a, lena, offset_a, stride_a, b, lenb, offset_b, stride_b, res, lenr, offset, stride);
+                 });
+}
+
+JNIEXPORT jobject JNICALL Java_ferrum_FerrumEngine_vect_1bffffB_1direct
+  (JNIEnv* env, jobject obj, jint fn, jobject a, jint offset_a, jint stride_a, jfloat sa, jfloat sha, jfloat sb, jfloat shb, jobject result) {
+  return direct1(env, obj, fn, a, result,
+                 [=](Ferrum::Engine* engine, Ferrum::FunctionID fnId, jfloat* a, int lena, jfloat* res, int lenr) {
+                   engine->vect_bffffB(fnId, a, lena, offset_a, stride_a,
+                                         sa, sha, sb, shb,
+                                         res, lenr, offset_a, stride_a);
+                 });
+}
+
+JNIEXPORT jobject JNICALL Java_ferrum_FerrumEngine_vect_1bbffffB_1direct
+  (JNIEnv* env, jobject obj, jint fn, jobject a, jint offset_a, jint stride_a, jobject b, jint offset_b, jint stride_b,
+   jfloat sa, jfloat sha, jfloat sb, jfloat shb, jobject result) {
+  return direct2(env, obj, fn, a, b, result,
+                 [=](Ferrum::Engine* engine, Ferrum::FunctionID fnId, jfloat* a, int lena, jfloat* b, int lenb, jfloat* res, int lenr, ArgSelection args) {
+                   int offset, stride;
+                   if (args == ArgSelection::A) {
+                     offset = offset_a;
+                     stride = stride_a;
+                   } else {
+                     offset = offset_b;
+                     stride = stride_b;
+                   }
+                   engine->vect_bbffffB(fnId, a, lena, offset_a, stride_a, b, lenb, offset_b, stride_b,
+                                        sa, sha, sb, shb,
+                                        res, lenr, offset, stride);
+                 });
+}
+
+// double precision vector functions, for the engines that have them
+
+JNIEXPORT jboolean JNICALL Java_ferrum_FerrumEngine_hasDoublePrecision(JNIEnv* env, jobject obj) {
+  Ferrum::Engine* engine = reinterpret_cast<Ferrum::Engine*>(env->GetLongField(obj, engineFieldID));
+  return engine->doublePrecision();
+}
+
+JNIEXPORT jdoubleArray JNICALL Java_ferrum_FerrumEngine_dvect_1bB
+  (JNIEnv* env, jobject obj, jint fn, jdoubleArray a, jint offset_a, jint stride_a) {
+  return vect1(env, obj, fn, a,
+               [=](Ferrum::Engine* engine, Ferrum::FunctionID fnId, jdouble* a, int len, jdouble* res) {
+                 engine->dvect_bB(fnId, a, len, offset_a, stride_a, res, len, offset_a, stride_a);
+               });
+}
+
+JNIEXPORT jdoubleArray JNICALL Java_ferrum_FerrumEngine_dvect_1bfB
+  (JNIEnv* env, jobject obj, jint fn, jdoubleArray a, jint offset_a, jint stride_a, jdouble sa) {
+  return vect1(env, obj, fn, a,
+               [=](Ferrum::Engine* engine, Ferrum::FunctionID fnId, jdouble* a, int len, jdouble* res) {
+                 engine->dvect_bfB(fnId, a, len, offset_a, stride_a, sa, res, len, offset_a, stride_a);
+               });
+}
+
+JNIEXPORT jdoubleArray JNICALL Java_ferrum_FerrumEngine_dvect_1fbB
+  (JNIEnv* env, jobject obj, jint fn, jdouble sa, jdoubleArray a, jint offset_a, jint stride_a) {
+  return vect1(env, obj, fn, a,
+               [=](Ferrum::Engine* engine, Ferrum::FunctionID fnId, jdouble* a, int len, jdouble* res) {
+                 engine->dvect_fbB(fnId, sa, a, len, offset_a, stride_a, res, len, offset_a, stride_a);
+               });
+}
+
+JNIEXPORT jdoubleArray JNICALL Java_ferrum_FerrumEngine_dvect_1bbB
+  (JNIEnv* env, jobject obj, jint fn, jdoubleArray a, jint offset_a, jint stride_a, jdoubleArray b, jint offset_b, jint stride_b) {
+  return vect2(env, obj, fn, a, b,
+               [=](Ferrum::Engine* engine, Ferrum::FunctionID fnId, jdouble* a, int lena, jdouble* b, int lenb, jdouble* res, int lenr, ArgSelection args) {
+                 int offset, stride;
+                 if (args == ArgSelection::A) {
+                   offset = offset_a;
+                   stride = stride_a;
+                 } else {
+                   offset = offset_b;
+                   stride = stride_b;
+                 }
+                 engine->dvect_bbB(fnId, a, lena, offset_a, stride_a, b, lenb, offset_b, stride_b, res, lenr, offset, stride);
+                 return JNI_ABORT;  // free the b array
+               });
+}
+
+JNIEXPORT jdoubleArray JNICALL Java_ferrum_FerrumEngine_dvect_1bBB
+  (JNIEnv* env, jobject obj, jint fn, jdoubleArray a, jint offset_a, jint stride_a, jdoubleArray b, jint offset_b, jint stride_b) {
+  return vect2(env, obj, fn, a, b,
+               [=](Ferrum::Engine* engine, Ferrum::FunctionID fnId, jdouble* a, int lena, jdouble* b, int lenb, jdouble* res, int lenr, ArgSelection args) {
+                 int offset, stride;
+                 if (args == ArgSelection::A) {
+                   offset = offset_a;
+                   stride = stride_a;
+                 } else {
+                   offset = offset_b;
+                   stride = stride_b;
+                 }
+                 engine->dvect_bBB(fnId, a, lena, offset_a, stride_a, b, lenb, offset_b, stride_b, res, lenr, offset, stride);
+                 return 0;  // keep the b array
+               });
+}
+
+JNIEXPORT jdoubleArray JNICALL Java_ferrum_FerrumEngine_dvect_1bffffB
+  (JNIEnv* env, jobject obj, jint fn, jdoubleArray a, jint offset_a, jint stride_a, jdouble sa, jdouble sha, jdouble sb, jdouble shb) {
+  return vect1(env, obj, fn, a,
+               [=](Ferrum::Engine* engine, Ferrum::FunctionID fnId, jdouble* a, int len, jdouble* res) {
+                 engine->dvect_bffffB(fnId, a, len, offset_a, stride_a,
+                                     sa, sha, sb, shb,
+                                     res, len, offset_a, stride_a);
+               });
+}
+
+JNIEXPORT jdoubleArray JNICALL Java_ferrum_FerrumEngine_dvect_1bbffffB
+  (JNIEnv* env, jobject obj, jint fn, jdoubleArray a, jint offset_a, jint stride_a, jdoubleArray b, jint offset_b, jint stride_b,
+   jdouble sa, jdouble sha, jdouble sb, jdouble shb) {
+  return vect2(env, obj, fn, a, b,
+               [=](Ferrum::Engine* engine, Ferrum::FunctionID fnId, jdouble* a, int lena, jdouble* b, int lenb, jdouble* res, int lenr, ArgSelection args) {
+                 int offset, stride;
+                 if (args == ArgSelection::A) {
+                   offset = offset_a;
+                   stride = stride_a;
+                 } else {
+                   offset = offset_b;
+                   stride = stride_b;
+                 }
+                 engine->dvect_bbffffB(fnId, a, lena, offset_a, stride_a, b, lenb, offset_b, stride_b,
+                                      sa, sha, sb, shb,
+                                      res, lenr, offset, stride);
+                 return JNI_ABORT;  // free the b array
+               });
+}
+
+
+// half precision vector functions, for the engines that have them
+
+JNIEXPORT jboolean JNICALL Java_ferrum_FerrumEngine_hasHalfStorage(JNIEnv* env, jobject obj) {
+  Ferrum::Engine* engine = reinterpret_cast<Ferrum::Engine*>(env->GetLongField(obj, engineFieldID));
+  return engine->halfStorage();
+}
+
+// Converts the format constant of FerrumEngine, or throws and returns false if it is not one
+bool halfFormat(JNIEnv* env, jint format, Ferrum::HalfFormat& result) {
+  if (format != (jint)Ferrum::HalfFormat::fp16 && format != (jint)Ferrum::HalfFormat::bf16) {
+    std::string msg = "Unknown half precision format: " + std::to_string(format);
+    env->ThrowNew(env->FindClass(ILLEGAL_ARG_EX), msg.c_str());
+    return false;
+  }
+  result = (Ferrum::HalfFormat)format;
+  return true;
+}
+
+inline uint16_t* halfBits(jshort* a) {
+  return reinterpret_cast<uint16_t*>(a);
+}
+
+JNIEXPORT jshortArray JNICALL Java_ferrum_FerrumEngine_hvect_1bB
+  (JNIEnv* env, jobject obj, jint fn, jint format, jshortArray a, jint offset_a, jint stride_a) {
+  Ferrum::HalfFormat hformat;
+  if (!halfFormat(env, format, hformat)) {
+    return NULL;
+  }
+  return vect1(env, obj, fn, a,
+               [=](Ferrum::Engine* engine, Ferrum::FunctionID fnId, jshort* a, int len, jshort* res) {
+                 engine->hvect_bB(fnId, hformat, halfBits(a), len, offset_a, stride_a, halfBits(res), len, offset_a, stride_a);
+               });
+}
+
+JNIEXPORT jshortArray JNICALL Java_ferrum_FerrumEngine_hvect_1bfB
+  (JNIEnv* env, jobject obj, jint fn, jint format, jshortArray a, jint offset_a, jint stride_a, jfloat sa) {
+  Ferrum::HalfFormat hformat;
+  if (!halfFormat(env, format, hformat)) {
+    return NULL;
+  }
+  return vect1(env, obj, fn, a,
+               [=](Ferrum::Engine* engine, Ferrum::FunctionID fnId, jshort* a, int len, jshort* res) {
+                 engine->hvect_bfB(fnId, hformat, halfBits(a), len, offset_a, stride_a, sa, halfBits(res), len, offset_a, stride_a);
+               });
+}
+
+JNIEXPORT jshortArray JNICALL Java_ferrum_FerrumEngine_hvect_1fbB
+  (JNIEnv* env, jobject obj, jint fn, jint format, jfloat sa, jshortArray a, jint offset_a, jint stride_a) {
+  Ferrum::HalfFormat hformat;
+  if (!halfFormat(env, format, hformat)) {
+    return NULL;
+  }
+  return vect1(env, obj, fn, a,
+               [=](Ferrum::Engine* engine, Ferrum::FunctionID fnId, jshort* a, int len, jshort* res) {
+                 engine->hvect_fbB(fnId, hformat, sa, halfBits(a), len, offset_a, stride_a, halfBits(res), len, offset_a, stride_a);
+               });
+}
+
+JNIEXPORT jshortArray JNICALL Java_ferrum_FerrumEngine_hvect_1bbB
+  (JNIEnv* env, jobject obj, jint fn, jint format, jshortArray a, jint offset_a, jint stride_a, jshortArray b, jint offset_b, jint stride_b) {
+  Ferrum::HalfFormat hformat;
+  if (!halfFormat(env, format, hformat)) {
+    return NULL;
+  }
+  return vect2(env, obj, fn, a, b,
+               [=](Ferrum::Engine* engine, Ferrum::FunctionID fnId, jshort* a, int lena, jshort* b, int lenb, jshort* res, int lenr, ArgSelection args) {
+                 int offset, stride;
+                 if (args == ArgSelection::A) {
+                   offset = offset_a;
+                   stride = stride_a;
+                 } else {
+                   offset = offset_b;
+                   stride = stride_b;
+                 }
+                 engine->hvect_bbB(fnId, hformat, halfBits(a), lena, offset_a, stride_a, halfBits(b), lenb, offset_b, stride_b,
+                                   halfBits(res), lenr, offset, stride);
+                 return JNI_ABORT;  // free the b array
+               });
+}
+
+JNIEXPORT jshortArray JNICALL Java_ferrum_FerrumEngine_hvect_1bBB
+  (JNIEnv* env, jobject obj, jint fn, jint format, jshortArray a, jint offset_a, jint stride_a, jshortArray b, jint offset_b, jint stride_b) {
+  Ferrum::HalfFormat hformat;
+  if (!halfFormat(env, format, hformat)) {
+    return NULL;
+  }
+  return vect2(env, obj, fn, a, b,
+               [=](Ferrum::Engine* engine, Ferrum::FunctionID fnId, jshort* a, int lena, jshort* b, int lenb, jshort* res, int lenr, ArgSelection args) {
+                 int offset, stride;
+                 if (args == ArgSelection::A) {
+                   offset = offset_a;
+                   stride = stride_a;
+                 } else {
+                   offset = offset_b;
+                   stride = stride_b;
+                 }
+                 engine->hvect_bBB(fnId, hformat, halfBits(a), lena, offset_a, stride_a, halfBits(b), lenb, offset_b, stride_b,
+                                   halfBits(res), lenr, offset, stride);
+                 return 0;  // keep the b array
+               });
+}
+
+JNIEXPORT jshortArray JNICALL Java_ferrum_FerrumEngine_hvect_1bffffB
+  (JNIEnv* env, jobject obj, jint fn, jint format, jshortArray a, jint offset_a, jint stride_a, jfloat sa, jfloat sha, jfloat sb, jfloat shb) {
+  Ferrum::HalfFormat hformat;
+  if (!halfFormat(env, format, hformat)) {
+    return NULL;
+  }
+  return vect1(env, obj, fn, a,
+               [=](Ferrum::Engine* engine, Ferrum::FunctionID fnId, jshort* a, int len, jshort* res) {
+                 engine->hvect_bffffB(fnId, hformat, halfBits(a), len, offset_a, stride_a,
+                                      sa, sha, sb, shb,
+                                      halfBits(res), len, offset_a, stride_a);
+               });
+}
+
+JNIEXPORT jshortArray JNICALL Java_ferrum_FerrumEngine_hvect_1bbffffB
+  (JNIEnv* env, jobject obj, jint fn, jint format, jshortArray a, jint offset_a, jint stride_a, jshortArray b, jint offset_b, jint stride_b,
+   jfloat sa, jfloat sha, jfloat sb, jfloat shb) {
+  Ferrum::HalfFormat hformat;
+  if (!halfFormat(env, format, hformat)) {
+    return NULL;
+  }
+  return vect2(env, obj, fn, a, b,
+               [=](Ferrum::Engine* engine, Ferrum::FunctionID fnId, jshort* a, int lena, jshort* b, int lenb, jshort* res, int lenr, ArgSelection args) {
+                 int offset, stride;
+                 if (args == ArgSelection::A) {
+                   offset = offset_a;
+                   stride = stride_a;
+                 } else {
+                   offset = offset_b;
+                   stride = stride_b;
+                 }
+                 engine->hvect_bbffffB(fnId, hformat, halfBits(a), lena, offset_a, stride_a, halfBits(b), lenb, offset_b, stride_b,
+                                       sa, sha, sb, shb,
+                                       halfBits(res), lenr, offset, stride);
+                 return JNI_ABORT;  // free the b array
+               });
+}
+
+
+// tensor implementations
+
+inline Ferrum::Tensor* asTensor(jlong handle) {
+  return reinterpret_cast<Ferrum::Tensor*>(handle);
+}
+
+JNIEXPORT jlong JNICALL Java_ferrum_FerrumEngine_allocate(JNIEnv* env, jobject obj, jint length) {
+  Ferrum::Engine* engine = reinterpret_cast<Ferrum::Engine*>(env->GetLongField(obj, engineFieldID));
+  Ferrum::Tensor* tensor = engine->newTensor(length);
+  if (tensor == nullptr) {
+    env->ThrowNew(env->FindClass(ILLEGAL_STATE_EX), "Unable to allocate tensor");
+    return 0;
+  }
+  return reinterpret_cast<jlong>(tensor);
+}
+
+JNIEXPORT void JNICALL Java_ferrum_FerrumEngine_release(JNIEnv* env, jobject obj, jlong tensor) {
+  Ferrum::Engine* engine = reinterpret_cast<Ferrum::Engine*>(env->GetLongField(obj, engineFieldID));
+  engine->releaseTensor(asTensor(tensor));
+}
+
+// True if len elements from offset are in the tensor. The check is written so that it cannot overflow.
+bool inTensor(const Ferrum::Tensor* t, jint offset, jint len) {
+  return t != nullptr && offset >= 0 && len >= 0 && len <= t->length - offset;
+}
+
+JNIEXPORT void JNICALL Java_ferrum_FerrumEngine_upload(JNIEnv* env, jobject obj, jlong tensor, jfloatArray data, jint offset) {
+  Ferrum::Tensor* t = asTensor(tensor);
+  int len = env->GetArrayLength(data);
+  if (!inTensor(t, offset, len)) {
+    env->ThrowNew(env->FindClass(ILLEGAL_ARG_EX), "Data does not fit in the tensor");
+    return;
+  }
+  // tensor memory is host visible, so copy straight into it
+  env->GetFloatArrayRegion(data, 0, len, t->data + offset);
+}
+
+JNIEXPORT jint JNICALL Java_ferrum_FerrumEngine_tensorLength(JNIEnv* env, jobject obj, jlong tensor) {
+  Ferrum::Tensor* t = asTensor(tensor);
+  if (t == nullptr) {
+    env->ThrowNew(env->FindClass(ILLEGAL_ARG_EX), "No tensor");
+    return 0;
+  }
+  return t->length;
+}
+
+JNIEXPORT jfloatArray JNICALL Java_ferrum_FerrumEngine_download(JNIEnv* env, jobject obj, jlong tensor, jint offset, jint len) {
+  Ferrum::Tensor* t = asTensor(tensor);
+  if (!inTensor(t, offset, len)) {
+    env->ThrowNew(env->FindClass(ILLEGAL_ARG_EX), "Range is not in the tensor");
+    return NULL;
+  }
+  jfloatArray jresult = env->NewFloatArray(len);
+  if (jresult == NULL) {
+    return NULL;
+  }
+  env->SetFloatArrayRegion(jresult, 0, len, t->data + offset);
+  return jresult;
+}
+
+// Runs a function on tensors. The call returns the result pointer from the engine, or nullptr on failure.
+template <typename CallWithArgs>
+void tensorOp(JNIEnv* env, jobject obj, jint fn, std::initializer_list<jlong> tensors, CallWithArgs call) {
+  Ferrum::FunctionID fnId = functionID(env, fn);
+  if (fnId == Ferrum::FunctionID::UNKNOWN) {
+    return;
+  }
+  for (jlong tensor : tensors) {
+    if (tensor == 0) {
+      env->ThrowNew(env->FindClass(ILLEGAL_ARG_EX), "No tensor");
+      return;
+    }
+  }
+  Ferrum::Engine* engine = reinterpret_cast<Ferrum::Engine*>(env->GetLongField(obj, engineFieldID));
+  if (call(engine, fnId) == nullptr) {
+    env->ThrowNew(env->FindClass(ILLEGAL_STATE_EX), ("Failed to run: " + std::string(Ferrum::functionNames[fnId])).c_str());
+  }
+}
+
+JNIEXPORT void JNICALL Java_ferrum_FerrumEngine_tensor_1bB
+  (JNIEnv* env, jobject obj, jint fn, jlong a, jint offset_a, jint stride_a, jlong result, jint offset, jint stride) {
+  tensorOp(env, obj, fn, {a, result},
+           [=](Ferrum::Engine* engine, Ferrum::FunctionID fnId) {
+             Ferrum::Tensor* ta = asTensor(a);
+             Ferrum::Tensor* tr = asTensor(result);
+             return engine->vect_bB(fnId, ta->data, ta->length, offset_a, stride_a,
+                                    tr->data, tr->length, offset, stride);
+           });
+}
+
+JNIEXPORT void JNICALL Java_ferrum_FerrumEngine_tensor_1bfB
+  (JNIEnv* env, jobject obj, jint fn, jlong a, jint offset_a, jint stride_a, jfloat sa,
+   jlong result, jint offset, jint stride) {
+  tensorOp(env, obj, fn, {a, result},
+           [=](Ferrum::Engine* engine, Ferrum::FunctionID fnId) {
+             Ferrum::Tensor* ta = asTensor(a);
+             Ferrum::Tensor* tr = asTensor(result);
+             return engine->vect_bfB(fnId, ta->data, ta->length, offset_a, stride_a, sa,
+                                     tr->data, tr->length, offset, stride);
+           });
+}
+
+JNIEXPORT void JNICALL Java_ferrum_FerrumEngine_tensor_1fbB
+  (JNIEnv* env, jobject obj, jint fn, jfloat sa, jlong a, jint offset_a, jint stride_a,
+   jlong result, jint offset, jint stride) {
+  tensorOp(env, obj, fn, {a, result},
+           [=](Ferrum::Engine* engine, Ferrum::FunctionID fnId) {
+             Ferrum::Tensor* ta = asTensor(a);
+             Ferrum::Tensor* tr = asTensor(result);
+             return engine->vect_fbB(fnId, sa, ta->data, ta->length, offset_a, stride_a,
+                                     tr->data, tr->length, offset, stride);
+           });
+}
+
+JNIEXPORT void JNICALL Java_ferrum_FerrumEngine_tensor_1bbB
+  (JNIEnv* env, jobject obj, jint fn, jlong a, jint offset_a, jint stride_a, jlong b, jint offset_b, jint stride_b,
+   jlong result, jint offset, jint stride) {
+  tensorOp(env, obj, fn, {a, b, result},
+           [=](Ferrum::Engine* engine, Ferrum::FunctionID fnId) {
+             Ferrum::Tensor* ta = asTensor(a);
+             Ferrum::Tensor* tb = asTensor(b);
+             Ferrum::Tensor* tr = asTensor(result);
+             return engine->vect_bbB(fnId, ta->data, ta->length, offset_a, stride_a,
+                                     tb->data, tb->length, offset_b, stride_b,
+                                     tr->data, tr->length, offset, stride);
+           });
+}
+
+JNIEXPORT void JNICALL Java_ferrum_FerrumEngine_tensor_1bBB
+  (JNIEnv* env, jobject obj, jint fn, jlong a, jint offset_a, jint stride_a, jlong b, jint offset_b, jint stride_b,
+   jlong result, jint offset, jint stride) {
+  tensorOp(env, obj, fn, {a, b, result},
+           [=](Ferrum::Engine* engine, Ferrum::FunctionID fnId) {
+             Ferrum::Tensor* ta = asTensor(a);
+             Ferrum::Tensor* tb = asTensor(b);
+             Ferrum::Tensor* tr = asTensor(result);
+             return engine->vect_bBB(fnId, ta->data, ta->length, offset_a, stride_a,
+                                     tb->data, tb->length, offset_b, stride_b,
+                                     tr->data, tr->length, offset, stride);
+           });
+}
+
+JNIEXPORT void JNICALL Java_ferrum_FerrumEngine_tensor_1bffffB
+  (JNIEnv* env, jobject obj, jint fn, jlong a, jint offset_a, jint stride_a,
+   jfloat sa, jfloat sha, jfloat sb, jfloat shb, jlong result, jint offset, jint stride) {
+  tensorOp(env, obj, fn, {a, result},
+           [=](Ferrum::Engine* engine, Ferrum::FunctionID fnId) {
+             Ferrum::Tensor* ta = asTensor(a);
+             Ferrum::Tensor* tr = asTensor(result);
+             return engine->vect_bffffB(fnId, ta->data, ta->length, offset_a, stride_a,
+                                        sa, sha, sb, shb,
+                                        tr->data, tr->length, offset, stride);
+           });
+}
+
+JNIEXPORT void JNICALL Java_ferrum_FerrumEngine_tensor_1bbffffB
+  (JNIEnv* env, jobject obj, jint fn, jlong a, jint offset_a, jint stride_a, jlong b, jint offset_b, jint stride_b,
+   jfloat sa, jfloat sha, jfloat sb, jfloat shb, jlong result, jint offset, jint stride) {
+  tensorOp(env, obj, fn, {a, b, result},
+           [=](Ferrum::Engine* engine, Ferrum::FunctionID fnId) {
+             Ferrum::Tensor* ta = asTensor(a);
+             Ferrum::Tensor* tb = asTensor(b);
+             Ferrum::Tensor* tr = asTensor(result);
+             return engine->vect_bbffffB(fnId, ta->data, ta->length, offset_a, stride_a,
+                                         tb->data, tb->length, offset_b, stride_b,
+                                         sa, sha, sb, shb,
+                                         tr->data, tr->length, offset, stride);
+           });
+}
+
+JNIEXPORT void JNICALL Java_ferrum_FerrumEngine_tensor_1fused
+  (JNIEnv* env, jobject obj, jintArray fns, jintArray args, jfloatArray scalars, jlongArray inputs, jlong result) {
+  int fnCount = env->GetArrayLength(fns);
+  int inputCount = env->GetArrayLength(inputs);
+  if (env->GetArrayLength(args) < 2 * fnCount || env->GetArrayLength(scalars) < 4 * fnCount) {
+    env->ThrowNew(env->FindClass(ILLEGAL_ARG_EX), "Missing arguments for fused functions");
+    return;
+  }
+  std::vector<jint> fnIds(fnCount);
+  env->GetIntArrayRegion(fns, 0, fnCount, fnIds.data());
+  std::vector<jint> fnArgs(2 * fnCount);
+  env->GetIntArrayRegion(args, 0, 2 * fnCount, fnArgs.data());
+  std::vector<jfloat> fnScalars(4 * fnCount);
+  env->GetFloatArrayRegion(scalars, 0, 4 * fnCount, fnScalars.data());
+  std::vector<jlong> handles(inputCount);
+  env->GetLongArrayRegion(inputs, 0, inputCount, handles.data());
+
+  Ferrum::FusedExpr expr;
+  std::vector<Ferrum::FusedInput> fusedInputs;
+  for (jlong handle : handles) {
+    if (handle == 0) {
+      env->ThrowNew(env->FindClass(ILLEGAL_ARG_EX), "No tensor");
+      return;
+    }
+    Ferrum::Tensor* t = asTensor(handle);
+    expr.input();
+    fusedInputs.push_back(Ferrum::FusedInput{t->data, t->length, 0, 1});
+  }
+  for (int i = 0; i < fnCount; i++) {
+    Ferrum::FunctionID fnId = functionID(env, fnIds[i]);
+    if (fnId == Ferrum::FunctionID::UNKNOWN) {
+      return;
+    }
+    std::string fnName = Ferrum::functionNames[fnId];
+    Ferrum::Signature signature;
+    if (!Ferrum::fusedSignature(fnId, signature)) {
+      env->ThrowNew(env->FindClass(ILLEGAL_ARG_EX), ("Cannot fuse function: " + fnName).c_str());
+      return;
+    }
+    std::vector<int> nodeArgs(fnArgs.begin() + 2 * i, fnArgs.begin() + 2 * i + Ferrum::signatureArgs(signature));
+    std::vector<float> nodeScalars(fnScalars.begin() + 4 * i,
+                                   fnScalars.begin() + 4 * i + Ferrum::signatureScalars(signature));
+    if (expr.apply(fnId, nodeArgs, nodeScalars) < 0) {
+      env->ThrowNew(env->FindClass(ILLEGAL_ARG_EX), ("Bad arguments for function: " + fnName).c_str());
+      return;
+    }
+  }
+  if (result == 0 || !expr.valid()) {
+    env->ThrowNew(env->FindClass(ILLEGAL_ARG_EX), "Nothing to evaluate");
+    return;
+  }
+  Ferrum::Engine* engine = reinterpret_cast<Ferrum::Engine*>(env->GetLongField(obj, engineFieldID));
+  Ferrum::Tensor* tr = asTensor(result);
+  if (engine->vect_fused(expr, fusedInputs, tr->data, tr->length, 0, 1) == nullptr) {
+    env->ThrowNew(env->FindClass(ILLEGAL_STATE_EX), "Failed to run fused functions");
+  }
+}
+
+JNIEXPORT void JNICALL Java_ferrum_FerrumEngine_tensor_1gemm
+  (JNIEnv* env, jobject obj, jboolean transA, jboolean transB, jint m, jint n, jint k, jfloat alpha,
+   jlong a, jint offset_a, jint ld_a, jlong b, jint offset_b, jint ld_b, jfloat beta,
+   jlong c, jint offset_c, jint ld_c) {
+  if (a == 0 || b == 0 || c == 0) {
+    env->ThrowNew(env->FindClass(ILLEGAL_ARG_EX), "No tensor");
+    return;
+  }
+  Ferrum::Engine* engine = reinterpret_cast<Ferrum::Engine*>(env->GetLongField(obj, engineFieldID));
+  Ferrum::Tensor* ta = asTensor(a);
+  Ferrum::Tensor* tb = asTensor(b);
+  Ferrum::Tensor* tc = asTensor(c);
+  if (engine->ge_gemm(transA == JNI_TRUE, transB == JNI_TRUE, m, n, k, alpha,
+                      ta->data, ta->length, offset_a, ld_a,
+                      tb->data, tb->length, offset_b, ld_b,
+                      beta, tc->data, tc->length, offset_c, ld_c) == nullptr) {
+    env->ThrowNew(env->FindClass(ILLEGAL_STATE_EX), "Failed to run: ge_gemm");
+  }
+}
+
+JNIEXPORT void JNICALL Java_ferrum_FerrumEngine_tensor_1mv
+  (JNIEnv* env, jobject obj, jboolean trans, jint m, jint n, jfloat alpha, jlong a, jint offset_a, jint ld_a,
+   jlong x, jint offset_x, jint stride_x, jfloat beta, jlong y, jint offset_y, jint stride_y) {
+  if (a == 0 || x == 0 || y == 0) {
+    env->ThrowNew(env->FindClass(ILLEGAL_ARG_EX), "No tensor");
+    return;
+  }
+  Ferrum::Engine* engine = reinterpret_cast<Ferrum::Engine*>(env->GetLongField(obj, engineFieldID));
+  Ferrum::Tensor* ta = asTensor(a);
+  Ferrum::Tensor* tx = asTensor(x);
+  Ferrum::Tensor* ty = asTensor(y);
+  if (engine->ge_mv(trans == JNI_TRUE, m, n, alpha, ta->data, ta->length, offset_a, ld_a,
+                    tx->data, tx->length, offset_x, stride_x,
+                    beta, ty->data, ty->length, offset_y, stride_y) == nullptr) {
+    env->ThrowNew(env->FindClass(ILLEGAL_STATE_EX), "Failed to run: ge_mv");
+  }
+}
+
+JNIEXPORT void JNICALL Java_ferrum_FerrumEngine_tensor_1rk
+  (JNIEnv* env, jobject obj, jint m, jint n, jfloat alpha, jlong x, jint offset_x, jint stride_x,
+   jlong y, jint offset_y, jint stride_y, jlong a, jint offset_a, jint ld_a) {
+  if (a == 0 || x == 0 || y == 0) {
+    env->ThrowNew(env->FindClass(ILLEGAL_ARG_EX), "No tensor");
+    return;
+  }
+  Ferrum::Engine* engine = reinterpret_cast<Ferrum::Engine*>(env->GetLongField(obj, engineFieldID));
+  Ferrum::Tensor* tx = asTensor(x);
+  Ferrum::Tensor* ty = asTensor(y);
+  Ferrum::Tensor* ta = asTensor(a);
+  if (engine->ge_rk(m, n, alpha, tx->data, tx->length, offset_x, stride_x,
+                    ty->data, ty->length, offset_y, stride_y,
+                    ta->data, ta->length, offset_a, ld_a) == nullptr) {
+    env->ThrowNew(env->FindClass(ILLEGAL_STATE_EX), "Failed to run: ge_rk");
+  }
+}
+
+JNIEXPORT void JNICALL Java_ferrum_FerrumEngine_tensor_1trmv
+  (JNIEnv* env, jobject obj, jboolean trans, jint sd, jint unit, jint bottom, jlong a, jint offset_a, jint ld_a,
+   jlong x, jint offset_x, jint stride_x) {
+  if (a == 0 || x == 0) {
+    env->ThrowNew(env->FindClass(ILLEGAL_ARG_EX), "No tensor");
+    return;
+  }
+  Ferrum::Engine* engine = reinterpret_cast<Ferrum::Engine*>(env->GetLongField(obj, engineFieldID));
+  Ferrum::Tensor* ta = asTensor(a);
+  Ferrum::Tensor* tx = asTensor(x);
+  if (engine->uplo_trmv(trans == JNI_TRUE, sd, unit, bottom, ta->data, ta->length, offset_a, ld_a,
+                        tx->data, tx->length, offset_x, stride_x) == nullptr) {
+    env->ThrowNew(env->FindClass(ILLEGAL_STATE_EX), "Failed to run: uplo_trmv");
+  }
+}
+
+JNIEXPORT void JNICALL Java_ferrum_FerrumEngine_tensor_1trsv
+  (JNIEnv* env, jobject obj, jboolean trans, jint sd, jint unit, jint bottom, jlong a, jint offset_a, jint ld_a,
+   jlong x, jint offset_x, jint stride_x) {
+  if (a == 0 || x == 0) {
+    env->ThrowNew(env->FindClass(ILLEGAL_ARG_EX), "No tensor");
+    return;
+  }
+  Ferrum::Engine* engine = reinterpret_cast<Ferrum::Engine*>(env->GetLongField(obj, engineFieldID));
+  Ferrum::Tensor* ta = asTensor(a);
+  Ferrum::Tensor* tx = asTensor(x);
+  if (engine->uplo_trsv(trans == JNI_TRUE, sd, unit, bottom, ta->data, ta->length, offset_a, ld_a,
+                        tx->data, tx->length, offset_x, stride_x) == nullptr) {
+    env->ThrowNew(env->FindClass(ILLEGAL_STATE_EX), "Failed to run: uplo_trsv");
+  }
+}
+
+JNIEXPORT void JNICALL Java_ferrum_FerrumEngine_tensor_1trmm
+  (JNIEnv* env, jobject obj, jboolean left, jboolean trans, jint unit, jint bottom, jint m, jint n, jfloat alpha,
+   jlong a, jint offset_a, jint ld_a, jlong b, jint offset_b, jint ld_b) {
+  if (a == 0 || b == 0) {
+    env->ThrowNew(env->FindClass(ILLEGAL_ARG_EX), "No tensor");
+    return;
+  }
+  Ferrum::Engine* engine = reinterpret_cast<Ferrum::Engine*>(env->GetLongField(obj, engineFieldID));
+  Ferrum::Tensor* ta = asTensor(a);
+  Ferrum::Tensor* tb = asTensor(b);
+  if (engine->uplo_trmm(left == JNI_TRUE, trans == JNI_TRUE, unit, bottom, m, n, alpha,
+                        ta->data, ta->length, offset_a, ld_a, tb->data, tb->length, offset_b, ld_b) == nullptr) {
+    env->ThrowNew(env->FindClass(ILLEGAL_STATE_EX), "Failed to run: uplo_trmm");
+  }
+}
+
+JNIEXPORT void JNICALL Java_ferrum_FerrumEngine_tensor_1trsm
+  (JNIEnv* env, jobject obj, jboolean left, jboolean trans, jint unit, jint bottom, jint m, jint n, jfloat alpha,
+   jlong a, jint offset_a, jint ld_a, jlong b, jint offset_b, jint ld_b) {
+  if (a == 0 || b == 0) {
+    env->ThrowNew(env->FindClass(ILLEGAL_ARG_EX), "No tensor");
+    return;
+  }
+  Ferrum::Engine* engine = reinterpret_cast<Ferrum::Engine*>(env->GetLongField(obj, engineFieldID));
+  Ferrum::Tensor* ta = asTensor(a);
+  Ferrum::Tensor* tb = asTensor(b);
+  if (engine->uplo_trsm(left == JNI_TRUE, trans == JNI_TRUE, unit, bottom, m, n, alpha,
+                        ta->data, ta->length, offset_a, ld_a, tb->data, tb->length, offset_b, ld_b) == nullptr) {
+    env->ThrowNew(env->FindClass(ILLEGAL_STATE_EX), "Failed to run: uplo_trsm");
+  }
+}
+
+// lazy graph implementations
+
+inline Ferrum::LazyGraph* asGraph(jlong handle) {
+  return reinterpret_cast<Ferrum::LazyGraph*>(handle);
+}
+
+JNIEXPORT jlong JNICALL Java_ferrum_FerrumEngine_graph(JNIEnv* env, jobject obj) {
+  Ferrum::Engine* engine = reinterpret_cast<Ferrum::Engine*>(env->GetLongField(obj, engineFieldID));
+  return reinterpret_cast<jlong>(new Ferrum::LazyGraph(engine));
+}
+
+JNIEXPORT void JNICALL Java_ferrum_FerrumEngine_graph_1release(JNIEnv* env, jobject obj, jlong graph) {
+  delete asGraph(graph);
+}
+
+JNIEXPORT jint JNICALL Java_ferrum_FerrumEngine_graph_1input(JNIEnv* env, jobject obj, jlong graph, jlong tensor) {
+  if (graph == 0 || tensor == 0) {
+    env->ThrowNew(env->FindClass(ILLEGAL_ARG_EX), "No graph or tensor");
+    return -1;
+  }
+  return asGraph(graph)->input(asTensor(tensor));
+}
+
+JNIEXPORT jint JNICALL Java_ferrum_FerrumEngine_graph_1apply
+  (JNIEnv* env, jobject obj, jlong graph, jint fn, jintArray args, jfloatArray scalars) {
+  Ferrum::FunctionID fnId = functionID(env, fn);
+  if (fnId == Ferrum::FunctionID::UNKNOWN) {
+    return -1;
+  }
+  if (graph == 0) {
+    env->ThrowNew(env->FindClass(ILLEGAL_ARG_EX), "No graph");
+    return -1;
+  }
+  std::string fnName = Ferrum::functionNames[fnId];
+  std::vector<jint> jargs(env->GetArrayLength(args));
+  env->GetIntArrayRegion(args, 0, jargs.size(), jargs.data());
+  std::vector<int> nodeArgs(jargs.begin(), jargs.end());
+  std::vector<float> nodeScalars(env->GetArrayLength(scalars));
+  env->GetFloatArrayRegion(scalars, 0, nodeScalars.size(), nodeScalars.data());
+  int node = asGraph(graph)->apply(fnId, nodeArgs, nodeScalars);
+  if (node < 0) {
+    env->ThrowNew(env->FindClass(ILLEGAL_ARG_EX), ("Cannot apply function: " + fnName).c_str());
+  }
+  return node;
+}
+
+JNIEXPORT jint JNICALL Java_ferrum_FerrumEngine_graph_1second(JNIEnv* env, jobject obj, jlong graph, jint node) {
+  int second = (graph == 0) ? -1 : asGraph(graph)->second(node);
+  if (second < 0) {
+    env->ThrowNew(env->FindClass(ILLEGAL_ARG_EX), "Node does not have a second result");
+  }
+  return second;
+}
+
+JNIEXPORT void JNICALL Java_ferrum_FerrumEngine_graph_1output(JNIEnv* env, jobject obj, jlong graph, jint node, jlong tensor) {
+  if (graph == 0 || !asGraph(graph)->output(node, asTensor(tensor))) {
+    env->ThrowNew(env->FindClass(ILLEGAL_ARG_EX), "Invalid graph output");
+  }
+}
+
+JNIEXPORT void JNICALL Java_ferrum_FerrumEngine_graph_1evaluate(JNIEnv* env, jobject obj, jlong graph) {
+  if (graph == 0 || !asGraph(graph)->evaluate()) {
+    env->ThrowNew(env->FindClass(ILLEGAL_STATE_EX), "Failed to evaluate graph");
+  }
+}
+
+JNIEXPORT void JNICALL Java_ferrum_FerrumEngine_graph_1clear(JNIEnv* env, jobject obj, jlong graph) {
+  if (graph != 0) {
+    asGraph(graph)->clear();
+  }
+}
+
+JNIEXPORT void JNICALL Java_ferrum_FerrumEngine_beginBatch(JNIEnv* env, jobject obj) {
+  Ferrum::Engine* engine = reinterpret_cast<Ferrum::Engine*>(env->GetLongField(obj, engineFieldID));
+  if (!engine->beginBatch()) {
+    env->ThrowNew(env->FindClass(ILLEGAL_STATE_EX), "Unable to start a batch");
+  }
+}
+
+JNIEXPORT void JNICALL Java_ferrum_FerrumEngine_commitBatch(JNIEnv* env, jobject obj) {
+  Ferrum::Engine* engine = reinterpret_cast<Ferrum::Engine*>(env->GetLongField(obj, engineFieldID));
+  if (!engine->commitBatch()) {
+    env->ThrowNew(env->FindClass(ILLEGAL_STATE_EX), "Batch failed");
+  }
+}
+
+JNIEXPORT void JNICALL Java_ferrum_FerrumEngine_setReproducible(JNIEnv* env, jobject obj, jboolean on) {
+  Ferrum::Engine* engine = reinterpret_cast<Ferrum::Engine*>(env->GetLongField(obj, engineFieldID));
+  engine->setReproducible(on == JNI_TRUE);
+}
+
+JNIEXPORT jboolean JNICALL Java_ferrum_FerrumEngine_isReproducible(JNIEnv* env, jobject obj) {
+  Ferrum::Engine* engine = reinterpret_cast<Ferrum::Engine*>(env->GetLongField(obj, engineFieldID));
+  return engine->reproducible() ? JNI_TRUE : JNI_FALSE;
+}
+
+// asynchronous vector function implementations
+
+// Copies of the Java arguments for a call that completes after the native method returns.
+// The JVM may move arrays once the native method returns, so the data is copied in and out.
+struct AsyncCall {
+  JavaVM* jvm;
+  jobject future;
+  // a global reference to b, if it is written back at the end of the call
+  jfloatArray inout;
+  std::vector<float> a;
+  std::vector<float> b;
+  std::vector<float> result;
+  ArgSelection args;
+};
+
+// Completes the CompletableFuture for a call, from the engine's submission thread or a completion handler
+void completeFuture(AsyncCall& call, bool success) {
+  JNIEnv* env;
+  bool attached = false;
+  if (call.jvm->GetEnv(reinterpret_cast<void**>(&env), JNI_VERSION_1_6) == JNI_EDETACHED) {
+    call.jvm->AttachCurrentThread(reinterpret_cast<void**>(&env), NULL);
+    attached = true;
+  }
+  jclass futureClass = env->GetObjectClass(call.future);
+  if (success) {
+    jfloatArray jresult = env->NewFloatArray(call.result.size());
+    env->SetFloatArrayRegion(jresult, 0, call.result.size(), call.result.data());
+    if (call.inout != NULL) {
+      env->SetFloatArrayRegion(call.inout, 0, call.b.size(), call.b.data());
+    }
+    jmethodID complete = env->GetMethodID(futureClass, "complete", "(Ljava/lang/Object;)Z");
+    env->CallBooleanMethod(call.future, complete, jresult);
+  } else {
+    jclass exClass = env->FindClass(ILLEGAL_STATE_EX);
+    jmethodID init = env->GetMethodID(exClass, "<init>", "(Ljava/lang/String;)V");
+    jobject ex = env->NewObject(exClass, init, env->NewStringUTF("Function failed"));
+    jmethodID fail = env->GetMethodID(futureClass, "completeExceptionally", "(Ljava/lang/Throwable;)Z");
+    env->CallBooleanMethod(call.future, fail, ex);
+  }
+  env->DeleteGlobalRef(call.future);
+  if (call.inout != NULL) {
+    env->DeleteGlobalRef(call.inout);
+  }
+  if (attached) {
+    call.jvm->DetachCurrentThread();
+  }
+}
+
+// Submits a vector function to run after this method returns. b may be NULL for single argument functions.
+// Arguments are shaped in the same way as vect1 and vect2.
+template <typename CallWithArgs>
+void submitVect(JNIEnv* env, jobject obj, jint fn, jfloatArray a, jfloatArray b, bool writeBack,
+                jobject future, CallWithArgs call) {
+  Ferrum::FunctionID fnId = functionID(env, fn);
+  if (fnId == Ferrum::FunctionID::UNKNOWN) {
+    return;
+  }
+  Ferrum::Engine* engine = reinterpret_cast<Ferrum::Engine*>(env->GetLongField(obj, engineFieldID));
+  if (engine->inBatch()) {
+    env->ThrowNew(env->FindClass(ILLEGAL_STATE_EX), "Only tensors can be used in a batch");
+    return;
+  }
+
+  auto args = std::make_shared<AsyncCall>();
+  env->GetJavaVM(&args->jvm);
+  args->future = env->NewGlobalRef(future);
+  args->inout = NULL;
+  int lena = env->GetArrayLength(a);
+  args->a.resize(lena);
+  env->GetFloatArrayRegion(a, 0, lena, args->a.data());
+  int lenr = lena;
+  args->args = ArgSelection::A;
+  if (b != NULL) {
+    int lenb = env->GetArrayLength(b);
+    args->b.resize(lenb);
+    env->GetFloatArrayRegion(b, 0, lenb, args->b.data());
+    if (writeBack) {
+      args->inout = static_cast<jfloatArray>(env->NewGlobalRef(b));
+    }
+    // take on the same shape as the shorter of the two
+    if (lenb <= lena) {
+      lenr = lenb;
+      args->args = ArgSelection::B;
+    }
+  }
+  args->result.resize(lenr);
+
+  // the future is completed once the engine has finished the call, which may be after the job returns
+  engine->submit([args, fnId, call](Ferrum::Engine& engine) { return call(engine, fnId, *args); },
+                 [args](float* result) { completeFuture(*args, result != nullptr); });
+}
+
+JNIEXPORT void JNICALL Java_ferrum_FerrumEngine_vect_1bB_1submit
+  (JNIEnv* env, jobject obj, jint fn, jfloatArray a, jint offset_a, jint stride_a, jobject future) {
+  submitVect(env, obj, fn, a, NULL, false, future,
+             [=](Ferrum::Engine& engine, Ferrum::FunctionID fnId, AsyncCall& c) {
+               int len = c.a.size();
+               return engine.vect_bB(fnId, c.a.data(), len, offset_a, stride_a, c.result.data(), len, offset_a, stride_a);
+             });
+}
+
+JNIEXPORT void JNICALL Java_ferrum_FerrumEngine_vect_1bfB_1submit
+  (JNIEnv* env, jobject obj, jint fn, jfloatArray a, jint offset_a, jint stride_a, jfloat sa, jobject future) {
+  submitVect(env, obj, fn, a, NULL, false, future,
+             [=](Ferrum::Engine& engine, Ferrum::FunctionID fnId, AsyncCall& c) {
+               int len = c.a.size();
+               return engine.vect_bfB(fnId, c.a.data(), len, offset_a, stride_a, sa,
+                                      c.result.data(), len, offset_a, stride_a);
+             });
+}
+
+JNIEXPORT void JNICALL Java_ferrum_FerrumEngine_vect_1fbB_1submit
+  (JNIEnv* env, jobject obj, jint fn, jfloat sa, jfloatArray a, jint offset_a, jint stride_a, jobject future) {
+  submitVect(env, obj, fn, a, NULL, false, future,
+             [=](Ferrum::Engine& engine, Ferrum::FunctionID fnId, AsyncCall& c) {
+               int len = c.a.size();
+               return engine.vect_fbB(fnId, sa, c.a.data(), len, offset_a, stride_a,
+                                      c.result.data(), len, offset_a, stride_a);
+             });
+}
+
+JNIEXPORT void JNICALL Java_ferrum_FerrumEngine_vect_1bbB_1submit
+  (JNIEnv* env, jobject obj, jint fn, jfloatArray a, jint offset_a, jint stride_a, jfloatArray b, jint offset_b, jint stride_b,
+   jobject future) {
+  submitVect(env, obj, fn, a, b, false, future,
+             [=](Ferrum::Engine& engine, Ferrum::FunctionID fnId, AsyncCall& c) {
+               int offset = (c.args == ArgSelection::A) ? offset_a : offset_b;
+               int stride = (c.args == ArgSelection::A) ? stride_a : stride_b;
+               return engine.vect_bbB(fnId, c.a.data(), c.a.size(), offset_a, stride_a, c.b.data(), c.b.size(), offset_b, stride_b,
+                                      c.result.data(), c.result.size(), offset, stride);
+             });
+}
+
+JNIEXPORT void JNICALL Java_ferrum_FerrumEngine_vect_1bBB_1submit
+  (JNIEnv* env, jobject obj, jint fn, jfloatArray a, jint offset_a, jint stride_a, jfloatArray b, jint offset_b, jint stride_b,
+   jobject future) {
+  submitVect(env, obj, fn, a, b, true, future,
+             [=](Ferrum::Engine& engine, Ferrum::FunctionID fnId, AsyncCall& c) {
+               int offset = (c.args == ArgSelection::A) ? offset_a : offset_b;
+               int stride = (c.args == ArgSelection::A) ? stride_a : stride_b;
+               return engine.vect_bBB(fnId, c.a.data(), c.a.size(), offset_a, stride_a, c.b.data(), c.b.size(), offset_b, stride_b,
+                                      c.result.data(), c.result.size(), offset, stride);
+             });
+}
+
+JNIEXPORT void JNICALL Java_ferrum_FerrumEngine_vect_1bffffB_1submit
+  (JNIEnv* env, jobject obj, jint fn, jfloatArray a, jint offset_a, jint stride_a, jfloat sa, jfloat sha, jfloat sb, jfloat shb,
+   jobject future) {
+  submitVect(env, obj, fn, a, NULL, false, future,
+             [=](Ferrum::Engine& engine, Ferrum::FunctionID fnId, AsyncCall& c) {
+               int len = c.a.size();
+               return engine.vect_bffffB(fnId, c.a.data(), len, offset_a, stride_a,
+                                         sa, sha, sb, shb,
+                                         c.result.data(), len, offset_a, stride_a);
+             });
+}
+
+JNIEXPORT void JNICALL Java_ferrum_FerrumEngine_vect_1bbffffB_1submit
+  (JNIEnv* env, jobject obj, jint fn, jfloatArray a, jint offset_a, jint stride_a, jfloatArray b, jint offset_b, jint stride_b,
+   jfloat sa, jfloat sha, jfloat sb, jfloat shb, jobject future) {
+  submitVect(env, obj, fn, a, b, false, future,
+             [=](Ferrum::Engine& engine, Ferrum::FunctionID fnId, AsyncCall& c) {
+               int offset = (c.args == ArgSelection::A) ? offset_a : offset_b;
+               int stride = (c.args == ArgSelection::A) ? stride_a : stride_b;
+               return engine.vect_bbffffB(fnId, c.a.data(), c.a.size(), offset_a, stride_a, c.b.data(), c.b.size(), offset_b, stride_b,
+                                          sa, sha, sb, shb,
+                                          c.result.data(), c.result.size(), offset, stride);
+             });
+}
@@ -0,0 +1,270 @@
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "dispatch_plan.hpp"
+#include "fusion.hpp"
+
+namespace {
+
+  using Ferrum::FunctionID;
+  using Ferrum::Signature;
+
+  // A vector function that can be fused.
+  // expr is the body of its kernel in Metal, where {x} and {y} are the arguments, and
+  // {s0} to {s3} are the scalars.
+  struct FusedOp {
+    Signature signature;
+    const char* expr;
+  };
+
+  // The elementwise kernels in vect-math.metal and number.metal, by name without "vector_"
+  const std::unordered_map<std::string, FusedOp> fusedOps = {
+    {"copy", {Signature::bB, "{x}"}},
+    {"sqr", {Signature::bB, "{x} * {x}"}},
+    {"inv", {Signature::bB, "(REAL)1.0 / {x}"}},
+    {"abs", {Signature::bB, "abs({x})"}},
+    {"sqrt", {Signature::bB, "sqrt({x})"}},
+    {"inv_sqrt", {Signature::bB, "rsqrt({x})"}},
+    {"cbrt", {Signature::bB, "pow({x}, REAL1o3)"}},
+    {"inv_cbrt", {Signature::bB, "(REAL)1.0 / pow({x}, REAL1o3)"}},
+    {"pow2o3", {Signature::bB, "pow({x}, REAL2o3)"}},
+    {"pow3o2", {Signature::bB, "pow({x}, REAL3o2)"}},
+    {"exp", {Signature::bB, "exp({x})"}},
+    {"exp2", {Signature::bB, "exp2({x})"}},
+    {"exp10", {Signature::bB, "pow((REAL)10.0, {x})"}},
+    {"expm1", {Signature::bB, "expm1({x})"}},
+    {"log", {Signature::bB, "log({x})"}},
+    {"log2", {Signature::bB, "log2({x})"}},
+    {"log10", {Signature::bB, "log10({x})"}},
+    {"log1p", {Signature::bB, "log1p({x})"}},
+    {"sin", {Signature::bB, "sin({x})"}},
+    {"cos", {Signature::bB, "cos({x})"}},
+    {"tan", {Signature::bB, "tan({x})"}},
+    {"asin", {Signature::bB, "asin({x})"}},
+    {"acos", {Signature::bB, "acos({x})"}},
+    {"atan", {Signature::bB, "atan({x})"}},
+    {"sinh", {Signature::bB, "sinh({x})"}},
+    {"cosh", {Signature::bB, "cosh({x})"}},
+    {"tanh", {Signature::bB, "tanh({x})"}},
+    {"asinh", {Signature::bB, "asinh({x})"}},
+    {"acosh", {Signature::bB, "acosh({x})"}},
+    {"atanh", {Signature::bB, "atanh({x})"}},
+    {"erf", {Signature::bB, "erf({x})"}},
+    {"erf_inv", {Signature::bB, "erfinv({x})"}},
+    {"erfc", {Signature::bB, "erfc({x})"}},
+    {"erfc_inv", {Signature::bB, "erfcinv({x})"}},
+    {"cdf_norm", {Signature::bB, "normcdf({x})"}},
+    {"cdf_norm_inv", {Signature::bB, "normcdfinv({x})"}},
+    {"gamma", {Signature::bB, "tgamma({x})"}},
+    {"lgamma", {Signature::bB, "lgamma({x})"}},
+    {"floor", {Signature::bB, "floor({x})"}},
+    {"ceil", {Signature::bB, "ceil({x})"}},
+    {"trunc", {Signature::bB, "trunc({x})"}},
+    {"round", {Signature::bB, "round({x})"}},
+    {"frac", {Signature::bB, "{x} - (REAL)((long){x})"}},
+    {"sigmoid", {Signature::bB, "tanh(REAL1o2 * {x}) * REAL1o2 + REAL1o2"}},
+    {"ramp", {Signature::bB, "fmax({x}, (REAL)0.0)"}},
+
+    {"mul", {Signature::bbB, "{x} * {y}"}},
+    {"div", {Signature::bbB, "{x} / {y}"}},
+    {"add", {Signature::bbB, "{x} + {y}"}},
+    {"sub", {Signature::bbB, "{x} - {y}"}},
+    {"fmod", {Signature::bbB, "fmod({x}, {y})"}},
+    {"frem", {Signature::bbB, "remainder({x}, {y})"}},
+    {"pow", {Signature::bbB, "pow({x}, {y})"}},
+    {"hypot", {Signature::bbB, "hypot({x}, {y})"}},
+    {"atan2", {Signature::bbB, "atan2({x}, {y})"}},
+    {"fmax", {Signature::bbB, "fmax({x}, {y})"}},
+    {"fmin", {Signature::bbB, "fmin({x}, {y})"}},
+    {"copysign", {Signature::bbB, "copysign({x}, {y})"}},
+
+    {"powx", {Signature::bfB, "pow({x}, {s0})"}},
+    {"relu", {Signature::fbB, "fmax({x}, {s0} * {x})"}},
+    {"elu", {Signature::fbB, "fmax({x}, {s0} * expm1({x}))"}},
+    {"set", {Signature::fbB, "{s0}"}},
+
+    {"scale_shift", {Signature::bffffB, "{s0} * {x} + {s1}"}},
+    {"linear_frac", {Signature::bbffffB, "({s0} * {x} + {s1}) / ({s2} * {y} + {s3})"}},
+  };
+
+  // The fusable functions, indexed by FunctionID
+  const std::vector<const FusedOp*>& opsById() {
+    static const std::vector<const FusedOp*> ops = []() {
+      std::vector<const FusedOp*> byId(Ferrum::functionCount, nullptr);
+      for (int id = 0; id < Ferrum::functionCount; id++) {
+        std::string name = Ferrum::functionNames[id];
+        if (name.compare(0, 7, "vector_") == 0) {
+          auto it = fusedOps.find(name.substr(7));
+          if (it != fusedOps.end()) {
+            byId[id] = &it->second;
+          }
+        }
+      }
+      return byId;
+    }();
+    return ops;
+  }
+
+  const FusedOp* findOp(FunctionID id) {
+    const std::vector<const FusedOp*>& ops = opsById();
+    int index = static_cast<int>(id);
+    return (index >= 0 && index < (int)ops.size()) ? ops[index] : nullptr;
+  }
+
+  void replaceAll(std::string& text, const std::string& from, const std::string& to) {
+    for (size_t pos = text.find(from); pos != std::string::npos; pos = text.find(from, pos + to.size())) {
+      text.replace(pos, from.size(), to);
+    }
+  }
+
+} // namespace
+
+
+bool Ferrum::fusedSignature(FunctionID id, Signature& signature) {
+  const FusedOp* op = findOp(id);
+  if (op == nullptr) {
+    return false;
+  }
+  signature = op->signature;
+  return true;
+}
+
+
+int Ferrum::FusedExpr::input() {
+  FusedNode node = {FunctionID::UNKNOWN, Signature::bB, inputs++, {-1, -1}, {0.0f, 0.0f, 0.0f, 0.0f}};
+  exprNodes.push_back(node);
+  return exprNodes.size() - 1;
+}
+
+
+int Ferrum::FusedExpr::apply(FunctionID id, const std::vector<int>& args, const std::vector<float>& scalars) {
+  const FusedOp* op = findOp(id);
+  if (op == nullptr) {
+    std::cerr << "Error: Function cannot be fused: '" << functionName(id) << "'" << std::endl;
+    rejected = true;
+    return -1;
+  }
+  if ((int)args.size() != signatureArgs(op->signature) || (int)scalars.size() != signatureScalars(op->signature)) {
+    std::cerr << "Error: Wrong arguments for function '" << functionName(id) << "'" << std::endl;
+    rejected = true;
+    return -1;
+  }
+  FusedNode node = {id, op->signature, -1, {-1, -1}, {0.0f, 0.0f, 0.0f, 0.0f}};
+  int i = 0;
+  for (int arg : args) {
+    if (arg < 0 || arg >= (int)exprNodes.size()) {
+      std::cerr << "Error: Unknown argument node: " << arg << std::endl;
+      rejected = true;
+      return -1;
+    }
+    node.args[i++] = arg;
+  }
+  std::copy(scalars.begin(), scalars.end(), node.scalars);
+  exprNodes.push_back(node);
+  resultNode = -1;
+  return exprNodes.size() - 1;
+}
+
+
+int Ferrum::FusedExpr::result() const {
+  return (resultNode >= 0) ? resultNode : (int)exprNodes.size() - 1;
+}
+
+
+void Ferrum::FusedExpr::setResult(int node) {
+  resultNode = node;
+}
+
+
+bool Ferrum::FusedExpr::valid() const {
+  int r = result();
+  return !rejected && r >= 0 && r < (int)exprNodes.size() && exprNodes[r].id != FunctionID::UNKNOWN;
+}
+
+
+std::vector<bool> Ferrum::FusedExpr::live() const {
+  std::vector<bool> marks(exprNodes.size(), false);
+  if (!valid()) {
+    return marks;
+  }
+  marks[result()] = true;
+  // arguments always come before the nodes that use them
+  for (int i = result(); i >= 0; i--) {
+    if (marks[i]) {
+      for (int arg : exprNodes[i].args) {
+        if (arg >= 0) {
+          marks[arg] = true;
+        }
+      }
+    }
+  }
+  return marks;
+}
+
+
+std::string Ferrum::FusedExpr::shape() const {
+  std::string text = std::to_string(inputs) + ":";
+  for (const FusedNode& node : exprNodes) {
+    text += std::to_string(static_cast<int>(node.id)) + "(" + std::to_string(node.args[0]) + "," +
+            std::to_string(node.args[1]) + ")";
+  }
+  return text + "->" + std::to_string(result());
+}
+
+
+std::string Ferrum::fusedMetalSource(const FusedExpr& expr, const char* kernelName) {
+  if (!expr.valid()) {
+    return "";
+  }
+  const std::vector<FusedNode>& nodes = expr.nodes();
+  std::vector<bool> live = expr.live();
+  int n = expr.inputCount();
+  std::string in = std::to_string(n);
+
+  std::string source = "\nkernel void " + std::string(kernelName) + " (\n";
+  for (int i = 0; i < n; i++) {
+    source += "    const device REAL* in" + std::to_string(i) + " [[buffer(" + std::to_string(i) + ")]],\n";
+  }
+  source += "    device REAL* result [[buffer(" + in + ")]],\n";
+  source += "    constant uint* offsets [[buffer(" + std::to_string(n + 1) + ")]],\n";
+  source += "    constant uint* strides [[buffer(" + std::to_string(n + 2) + ")]],\n";
+  source += "    constant REAL* s [[buffer(" + std::to_string(n + 3) + ")]],\n";
+  source += "    uint id [[thread_position_in_grid]]) {\n";
+
+  for (int i = 0; i < (int)nodes.size(); i++) {
+    if (!live[i]) {
+      continue;
+    }
+    const FusedNode& node = nodes[i];
+    std::string t = "t" + std::to_string(i);
+    if (node.id == FunctionID::UNKNOWN) {
+      std::string k = std::to_string(node.input);
+      source += "    const REAL " + t + " = in" + k + "[offsets[" + k + "] + id * strides[" + k + "]];\n";
+      continue;
+    }
+    std::string body = findOp(node.id)->expr;
+    replaceAll(body, "{x}", "t" + std::to_string(node.args[0]));
+    if (node.args[1] >= 0) {
+      replaceAll(body, "{y}", "t" + std::to_string(node.args[1]));
+    }
+    for (int j = 0; j < 4; j++) {
+      replaceAll(body, "{s" + std::to_string(j) + "}", "s[" + std::to_string(4 * i + j) + "]");
+    }
+    source += "    const REAL " + t + " = " + body + ";\n";
+  }
+  source += "    result[offsets[" + in + "] + id * strides[" + in + "]] = t" + std::to_string(expr.result()) + ";\n";
+  source += "}\n";
+  return source;
+}
+
+
+ptrdiff_t Ferrum::fusedCount(const std::vector<FusedInput>& inputs, int len, int offset, int stride) {
+  ptrdiff_t count = vectorCount(len, offset, stride);
+  for (const FusedInput& in : inputs) {
+    count = std::min(count, vectorCount(in.length, in.offset, in.stride));
+  }
+  return count;
+}
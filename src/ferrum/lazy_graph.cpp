@@ -0,0 +1,375 @@
+#include <algorithm>
+#include <climits>
+#include <functional>
+#include <iostream>
+#include <vector>
+
+#include "fusion.hpp"
+#include "lazy_graph.hpp"
+
+namespace {
+
+  // The functions with two results that a graph can hold. vector_swap also has two results,
+  // but in a graph it would only exchange two nodes.
+  static_assert(Ferrum::kernelAccepts(Ferrum::FunctionID::vector_sincos, Ferrum::Family::vector, Ferrum::Signature::bBB) &&
+                Ferrum::kernelAccepts(Ferrum::FunctionID::vector_modf, Ferrum::Family::vector, Ferrum::Signature::bBB),
+                "the pair functions run as bBB");
+  bool pairFunction(Ferrum::FunctionID id) {
+    return id == Ferrum::FunctionID::vector_sincos || id == Ferrum::FunctionID::vector_modf;
+  }
+
+  void addOnce(std::vector<int>& nodes, int node) {
+    if (std::find(nodes.begin(), nodes.end(), node) == nodes.end()) {
+      nodes.push_back(node);
+    }
+  }
+
+} // namespace
+
+
+Ferrum::LazyGraph::LazyGraph(Engine* engine): engine(engine) {
+}
+
+
+Ferrum::LazyGraph::~LazyGraph() {
+  for (Tensor* tensor : spare) {
+    engine->releaseTensor(tensor);
+  }
+}
+
+
+int Ferrum::LazyGraph::input(Tensor* tensor) {
+  if (tensor == nullptr) {
+    std::cerr << "Error: No tensor for graph input" << std::endl;
+    return -1;
+  }
+  LazyNode node = {FunctionID::UNKNOWN, Signature::bB, {-1, -1}, {0.0f, 0.0f, 0.0f, 0.0f}, tensor->length, tensor, -1};
+  graphNodes.push_back(node);
+  return graphNodes.size() - 1;
+}
+
+
+int Ferrum::LazyGraph::apply(FunctionID id, const std::vector<int>& args, const std::vector<float>& scalars) {
+  Signature signature = Signature::bBB;
+  bool pair = pairFunction(id);
+  if (!pair && !fusedSignature(id, signature)) {
+    std::cerr << "Error: Function cannot be evaluated lazily: '" << functionName(id) << "'" << std::endl;
+    return -1;
+  }
+  // the in/out buffer of a function with two results is its second result, not an argument
+  int argCount = pair ? 1 : signatureArgs(signature);
+  if ((int)args.size() != argCount || (int)scalars.size() != signatureScalars(signature)) {
+    std::cerr << "Error: Wrong arguments for function '" << functionName(id) << "'" << std::endl;
+    return -1;
+  }
+  LazyNode node = {id, signature, {-1, -1}, {0.0f, 0.0f, 0.0f, 0.0f}, INT_MAX, nullptr, -1};
+  for (int i = 0; i < argCount; i++) {
+    if (args[i] < 0 || args[i] >= (int)graphNodes.size()) {
+      std::cerr << "Error: Unknown argument node: " << args[i] << std::endl;
+      return -1;
+    }
+    node.args[i] = args[i];
+    node.length = std::min(node.length, graphNodes[args[i]].length);
+  }
+  std::copy(scalars.begin(), scalars.end(), node.scalars);
+  graphNodes.push_back(node);
+  int index = graphNodes.size() - 1;
+  if (pair) {
+    LazyNode secondNode = {FunctionID::UNKNOWN, signature, {-1, -1}, {0.0f, 0.0f, 0.0f, 0.0f}, node.length, nullptr, index};
+    graphNodes.push_back(secondNode);
+  }
+  return index;
+}
+
+
+int Ferrum::LazyGraph::second(int node) const {
+  int next = node + 1;
+  return (node >= 0 && next < (int)graphNodes.size() && graphNodes[next].first == node) ? next : -1;
+}
+
+
+bool Ferrum::LazyGraph::output(int node, Tensor* tensor) {
+  if (node < 0 || node >= (int)graphNodes.size() || tensor == nullptr) {
+    std::cerr << "Error: Invalid graph output: " << node << std::endl;
+    return false;
+  }
+  for (auto& out : outputs) {
+    if (out.first == node) {
+      out.second = tensor;
+      return true;
+    }
+  }
+  outputs.push_back({node, tensor});
+  return true;
+}
+
+
+void Ferrum::LazyGraph::clear() {
+  graphNodes.clear();
+  outputs.clear();
+}
+
+
+Ferrum::Tensor* Ferrum::LazyGraph::acquire(int length) {
+  for (auto it = spare.begin(); it != spare.end(); ++it) {
+    if ((*it)->length == length) {
+      Tensor* tensor = *it;
+      spare.erase(it);
+      return tensor;
+    }
+  }
+  Tensor* tensor = engine->newTensor(length);
+  if (tensor != nullptr) {
+    allocated++;
+  }
+  return tensor;
+}
+
+
+// Finds the functions that are evaluated in registers as part of node, in order of evaluation,
+// and the stored nodes that they read
+void Ferrum::LazyGraph::collect(int node, const std::vector<bool>& stored,
+                                std::vector<int>& inlined, std::vector<int>& sources) const {
+  for (int arg : graphNodes[node].args) {
+    if (arg < 0) {
+      continue;
+    }
+    if (stored[arg]) {
+      addOnce(sources, arg);
+    } else {
+      collect(arg, stored, inlined, sources);
+      addOnce(inlined, arg);
+    }
+  }
+}
+
+
+bool Ferrum::LazyGraph::evaluate() {
+  lastDispatches = 0;
+  if (engine->inBatch()) {
+    std::cerr << "Error: A graph cannot be evaluated inside a batch" << std::endl;
+    return false;
+  }
+  if (outputs.empty()) {
+    std::cerr << "Error: The graph has no outputs" << std::endl;
+    return false;
+  }
+  int n = graphNodes.size();
+
+  // only the nodes that an output depends on are run
+  std::vector<bool> live(n, false);
+  std::vector<Tensor*> bound(n, nullptr);
+  for (const auto& [node, tensor] : outputs) {
+    live[node] = true;
+    bound[node] = tensor;
+  }
+  for (int i = n - 1; i >= 0; i--) {
+    if (live[i]) {
+      const LazyNode& node = graphNodes[i];
+      if (node.first >= 0) {
+        live[node.first] = true;
+      }
+      for (int arg : node.args) {
+        if (arg >= 0) {
+          live[arg] = true;
+        }
+      }
+    }
+  }
+
+  // the number of live functions that read each node, and the last of them
+  std::vector<int> readers(n, 0);
+  std::vector<int> reader(n, -1);
+  for (int i = 0; i < n; i++) {
+    const LazyNode& node = graphNodes[i];
+    if (live[i] && node.id != FunctionID::UNKNOWN) {
+      for (int j = 0; j < 2; j++) {
+        int arg = node.args[j];
+        if (arg >= 0 && !(j == 1 && arg == node.args[0])) {
+          readers[arg]++;
+          reader[arg] = i;
+        }
+      }
+    }
+  }
+
+  // A function with one reader is kept in registers, and fused into that reader.
+  // Everything else that is live needs a buffer.
+  std::vector<bool> stored(n, false);
+  for (int i = 0; i < n; i++) {
+    const LazyNode& node = graphNodes[i];
+    stored[i] = live[i] && (node.id == FunctionID::UNKNOWN || node.signature == Signature::bBB ||
+                            bound[i] != nullptr || readers[i] != 1 || graphNodes[reader[i]].signature == Signature::bBB);
+  }
+
+  // Each stored function runs after the functions it reads. Following the outputs depth first,
+  // rather than running nodes in the order they were added, finishes with each temporary sooner.
+  std::vector<int> order;
+  std::vector<bool> visited(n, false);
+  std::vector<std::vector<int>> inlined(n);
+  std::vector<std::vector<int>> sources(n);
+  std::function<void(int)> visit = [&](int i) {
+    if (graphNodes[i].first >= 0) {
+      i = graphNodes[i].first;
+    }
+    if (visited[i] || graphNodes[i].tensor != nullptr) {
+      return;
+    }
+    visited[i] = true;
+    collect(i, stored, inlined[i], sources[i]);
+    for (int source : sources[i]) {
+      visit(source);
+    }
+    order.push_back(i);
+  };
+  for (const auto& out : outputs) {
+    visit(out.first);
+  }
+
+  std::vector<int> pending(n, 0);
+  for (int i : order) {
+    for (int source : sources[i]) {
+      pending[source]++;
+    }
+  }
+
+  // Outputs are written directly, except when the tensor is also an input. Those are
+  // written to a temporary, and copied once everything else has run.
+  std::vector<Tensor*> buffers(n, nullptr);
+  std::vector<bool> temporary(n, false);
+  std::vector<int> copies;
+  for (int i = 0; i < n; i++) {
+    buffers[i] = graphNodes[i].tensor;
+  }
+  for (int i = 0; i < n; i++) {
+    if (bound[i] == nullptr) {
+      continue;
+    }
+    bool isInput = std::any_of(graphNodes.begin(), graphNodes.end(),
+                               [&](const LazyNode& node) { return node.tensor == bound[i]; });
+    if (graphNodes[i].tensor != nullptr) {
+      if (graphNodes[i].tensor != bound[i]) {
+        copies.push_back(i);
+      }
+    } else if (isInput) {
+      copies.push_back(i);
+    } else {
+      buffers[i] = bound[i];
+    }
+  }
+  auto place = [&](int i) {
+    if (buffers[i] == nullptr) {
+      buffers[i] = acquire(graphNodes[i].length);
+      temporary[i] = true;
+    }
+    return buffers[i] != nullptr;
+  };
+  // temporaries go back to the spares once nothing else reads them, unless they are to be copied out
+  auto finish = [&](int i) {
+    if (pending[i] == 0 && temporary[i] && bound[i] == nullptr) {
+      spare.push_back(buffers[i]);
+      temporary[i] = false;
+    }
+  };
+
+  if (!engine->beginBatch()) {
+    return false;
+  }
+  bool success = true;
+  for (int i : order) {
+    int pairNode = second(i);
+    if (!place(i) || (pairNode >= 0 && !place(pairNode))) {
+      std::cerr << "Error: Unable to allocate a temporary for the graph" << std::endl;
+      success = false;
+      break;
+    }
+    float* result = inlined[i].empty() ? dispatch(i, buffers) : dispatchFused(i, inlined[i], sources[i], buffers);
+    lastDispatches++;
+    if (result == nullptr) {
+      success = false;
+      break;
+    }
+    for (int source : sources[i]) {
+      pending[source]--;
+      finish(source);
+    }
+    finish(i);
+    if (pairNode >= 0) {
+      finish(pairNode);
+    }
+  }
+  for (int i : copies) {
+    if (!success) {
+      break;
+    }
+    Tensor* from = buffers[i];
+    success = engine->vect_bB(FunctionID::vector_copy, from->data, from->length, 0, 1,
+                              bound[i]->data, bound[i]->length, 0, 1) != nullptr;
+    lastDispatches++;
+  }
+  success = engine->commitBatch() && success;
+
+  for (int i = 0; i < n; i++) {
+    if (temporary[i]) {
+      spare.push_back(buffers[i]);
+    }
+  }
+  return success;
+}
+
+
+// Runs a single function with the dispatch function for its signature
+float* Ferrum::LazyGraph::dispatch(int i, const std::vector<Tensor*>& buffers) {
+  const LazyNode& node = graphNodes[i];
+  const float* a = buffers[node.args[0]]->data;
+  int lena = buffers[node.args[0]]->length;
+  const float* b = (node.args[1] >= 0) ? buffers[node.args[1]]->data : nullptr;
+  int lenb = (node.args[1] >= 0) ? buffers[node.args[1]]->length : 0;
+  float* r = buffers[i]->data;
+  int len = node.length;
+  const float* s = node.scalars;
+  switch (node.signature) {
+    case Signature::bB:
+      return engine->vect_bB(node.id, a, lena, 0, 1, r, len, 0, 1);
+    case Signature::bfB:
+      return engine->vect_bfB(node.id, a, lena, 0, 1, s[0], r, len, 0, 1);
+    case Signature::fbB:
+      return engine->vect_fbB(node.id, s[0], a, lena, 0, 1, r, len, 0, 1);
+    case Signature::bbB:
+      return engine->vect_bbB(node.id, a, lena, 0, 1, b, lenb, 0, 1, r, len, 0, 1);
+    case Signature::bBB:
+      return engine->vect_bBB(node.id, a, lena, 0, 1, buffers[i + 1]->data, len, 0, 1, r, len, 0, 1);
+    case Signature::bffffB:
+      return engine->vect_bffffB(node.id, a, lena, 0, 1, s[0], s[1], s[2], s[3], r, len, 0, 1);
+    case Signature::bbffffB:
+      return engine->vect_bbffffB(node.id, a, lena, 0, 1, b, lenb, 0, 1, s[0], s[1], s[2], s[3], r, len, 0, 1);
+    case Signature::none:
+      break;
+  }
+  return nullptr;
+}
+
+
+// Runs a function along with the functions inlined into it, as one fused kernel
+float* Ferrum::LazyGraph::dispatchFused(int root, const std::vector<int>& inlined, const std::vector<int>& sources,
+                                        const std::vector<Tensor*>& buffers) {
+  FusedExpr expr;
+  std::vector<FusedInput> inputs;
+  std::vector<int> exprNode(graphNodes.size(), -1);
+  for (int source : sources) {
+    exprNode[source] = expr.input();
+    inputs.push_back(FusedInput{buffers[source]->data, graphNodes[source].length, 0, 1});
+  }
+  std::vector<int> functions(inlined);
+  functions.push_back(root);
+  for (int i : functions) {
+    const LazyNode& node = graphNodes[i];
+    std::vector<int> args;
+    for (int j = 0; j < signatureArgs(node.signature); j++) {
+      args.push_back(exprNode[node.args[j]]);
+    }
+    std::vector<float> scalars(node.scalars, node.scalars + signatureScalars(node.signature));
+    exprNode[i] = expr.apply(node.id, args, scalars);
+  }
+  return engine->vect_fused(expr, inputs, buffers[root]->data, graphNodes[root].length, 0, 1);
+}
@@ -0,0 +1,129 @@
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+
+#include "debug.hpp"
+#include "pipeline_cache.hpp"
+
+namespace {
+
+  std::string cacheDirectory() {
+    const char* dir = std::getenv("FERRUM_CACHE");
+    if (dir != nullptr) {
+      return dir;
+    }
+    const char* home = std::getenv("HOME");
+    if (home == nullptr || *home == '\0') {
+      return "";
+    }
+#ifdef __APPLE__
+    return std::string(home) + "/Library/Caches/ferrum";
+#else
+    const char* xdg = std::getenv("XDG_CACHE_HOME");
+    return (xdg != nullptr && *xdg != '\0') ? std::string(xdg) + "/ferrum" : std::string(home) + "/.cache/ferrum";
+#endif
+  }
+
+} // namespace
+
+
+Ferrum::PipelineCache::PipelineCache(PipelineCompiler* compiler) :
+    compiler(compiler), once(new std::once_flag[functionCount]),
+    pipelines(new std::atomic<void*>[functionCount]), done(new std::atomic<bool>[functionCount]), unsavedCount(0) {
+  for (int i = 0; i < functionCount; i++) {
+    pipelines[i] = nullptr;
+    done[i] = false;
+  }
+}
+
+Ferrum::PipelineCache::~PipelineCache() {
+  for (int i = 0; i < functionCount; i++) {
+    if (pipelines[i] != nullptr) {
+      compiler->release(pipelines[i]);
+    }
+  }
+}
+
+void* Ferrum::PipelineCache::get(FunctionID id) {
+  int index = static_cast<int>(id);
+  if (index < 0 || index >= functionCount) {
+    return nullptr;
+  }
+  // after the first call, this is a load and a flag check
+  std::call_once(once[index], [&]() {
+    DBG("Compiling pipeline for: ", functionNames[index]);
+    bool cached = false;
+    void* pipeline = compiler->compile(id, cached);
+    pipelines[index] = pipeline;
+    if (pipeline != nullptr && !cached) {
+      unsavedCount++;
+    }
+    done[index] = true;
+  });
+  return pipelines[index];
+}
+
+void Ferrum::PipelineCache::warm(const std::vector<FunctionID>& ids) {
+  for (FunctionID id : ids) {
+    get(id);
+  }
+}
+
+bool Ferrum::PipelineCache::compiled(FunctionID id) const {
+  int index = static_cast<int>(id);
+  return index >= 0 && index < functionCount && done[index];
+}
+
+int Ferrum::PipelineCache::compiledCount() const {
+  int count = 0;
+  for (int i = 0; i < functionCount; i++) {
+    count += done[i] ? 1 : 0;
+  }
+  return count;
+}
+
+
+uint64_t Ferrum::libraryHash(const void* data, size_t size) {
+  const unsigned char* bytes = static_cast<const unsigned char*>(data);
+  uint64_t hash = 14695981039346656037ull;
+  for (size_t i = 0; i < size; i++) {
+    hash = (hash ^ bytes[i]) * 1099511628211ull;
+  }
+  return hash;
+}
+
+std::string Ferrum::pipelineCachePath(uint64_t hash, const char* dir) {
+  std::string directory = (dir != nullptr) ? dir : cacheDirectory();
+  if (directory.empty()) {
+    return "";
+  }
+  char name[32];
+  std::snprintf(name, sizeof(name), "ferrum-%016llx.bin", (unsigned long long)hash);
+  return directory + "/" + name;
+}
+
+std::vector<Ferrum::FunctionID> Ferrum::warmList(const char* names) {
+  std::vector<FunctionID> ids;
+  if (names == nullptr) {
+    return ids;
+  }
+  std::string list(names);
+  size_t start = 0;
+  while (start < list.size()) {
+    size_t end = list.find_first_of(", \t\n", start);
+    if (end == std::string::npos) {
+      end = list.size();
+    }
+    if (end > start) {
+      std::string name = list.substr(start, end - start);
+      FunctionID id = getFunctionID(name);
+      if (id == FunctionID::UNKNOWN) {
+        std::cerr << "Error: Unknown function to warm: " << name << std::endl;
+      } else {
+        ids.push_back(id);
+      }
+    }
+    start = end + 1;
+  }
+  return ids;
+}
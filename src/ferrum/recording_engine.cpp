@@ -0,0 +1,842 @@
+#include "fusion.hpp"
+#include "recording_engine.hpp"
+
+
+Ferrum::RecordingEngine::RecordingEngine(Engine* delegate) :
+    delegate(delegate), reproducibleSums(false) {
+}
+
+
+Ferrum::RecordingEngine::~RecordingEngine() {
+  delete delegate;
+}
+
+
+std::vector<Ferrum::RecordedCall> Ferrum::RecordingEngine::calls() {
+  std::lock_guard<std::mutex> guard(lock);
+  return recorded;
+}
+
+
+void Ferrum::RecordingEngine::clear() {
+  std::lock_guard<std::mutex> guard(lock);
+  recorded.clear();
+}
+
+
+std::future<float*> Ferrum::RecordingEngine::submit(Job job, Completion done) {
+  if (delegate != nullptr) {
+    // run the job against this engine, so that its calls are recorded before being forwarded
+    return delegate->submit([this, job](Engine&) { return job(*this); }, done);
+  }
+  float* result = job(*this);
+  if (done) {
+    done(result);
+  }
+  std::promise<float*> ready;
+  ready.set_value(result);
+  return ready.get_future();
+}
+
+
+Ferrum::Tensor* Ferrum::RecordingEngine::newTensor(int length) {
+  record("newTensor", FunctionID::UNKNOWN, {length}, {}, {});
+  if (delegate != nullptr) {
+    return delegate->newTensor(length);
+  }
+  return (length < 0) ? nullptr : new Tensor{new float[length], length};
+}
+
+
+void Ferrum::RecordingEngine::releaseTensor(Tensor* tensor) {
+  record("releaseTensor", FunctionID::UNKNOWN, {}, {}, {});
+  if (delegate != nullptr) {
+    delegate->releaseTensor(tensor);
+  } else if (tensor != nullptr) {
+    delete[] tensor->data;
+    delete tensor;
+  }
+}
+
+
+bool Ferrum::RecordingEngine::beginBatch() {
+  record("beginBatch", FunctionID::UNKNOWN, {}, {}, {});
+  if (inBatch() || (delegate != nullptr && !delegate->beginBatch())) {
+    return false;
+  }
+  std::lock_guard<std::mutex> guard(lock);
+  batchThreads.insert(std::this_thread::get_id());
+  return true;
+}
+
+
+bool Ferrum::RecordingEngine::commitBatch() {
+  record("commitBatch", FunctionID::UNKNOWN, {}, {}, {});
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    if (batchThreads.erase(std::this_thread::get_id()) == 0) {
+      return false;
+    }
+  }
+  return delegate == nullptr || delegate->commitBatch();
+}
+
+
+bool Ferrum::RecordingEngine::inBatch() const {
+  std::lock_guard<std::mutex> guard(lock);
+  return batchThreads.count(std::this_thread::get_id()) > 0;
+}
+
+
+void Ferrum::RecordingEngine::setReproducible(bool on) {
+  reproducibleSums = on;
+  if (delegate != nullptr) {
+    delegate->setReproducible(on);
+  }
+}
+
+
+bool Ferrum::RecordingEngine::reproducible() const {
+  return (delegate != nullptr) ? delegate->reproducible() : reproducibleSums.load();
+}
+
+
+void Ferrum::RecordingEngine::record(const char* dispatch, FunctionID id, std::vector<int> dims,
+                                     std::vector<double> scalars, std::vector<int> buffers) {
+  std::lock_guard<std::mutex> guard(lock);
+  recorded.push_back(RecordedCall{dispatch, id, std::move(dims), std::move(scalars), std::move(buffers)});
+}
+
+
+// general vector functions
+float* Ferrum::RecordingEngine::vect_bB(Ferrum::FunctionID id, const float* a, int lena, int offset_a, int stride_a,
+                                        float* result, int len, int offset, int stride) {
+  record("vect_bB", id, {}, {}, {lena, offset_a, stride_a, len, offset, stride});
+  if (delegate == nullptr) {
+    return result;
+  }
+  return delegate->vect_bB(id, a, lena, offset_a, stride_a, result, len, offset, stride);
+}
+
+float* Ferrum::RecordingEngine::vect_bfB(Ferrum::FunctionID id, const float* a, int lena, int offset_a, int stride_a,
+                                         float sa,
+                                         float* result, int len, int offset, int stride) {
+  record("vect_bfB", id, {}, {sa}, {lena, offset_a, stride_a, len, offset, stride});
+  if (delegate == nullptr) {
+    return result;
+  }
+  return delegate->vect_bfB(id, a, lena, offset_a, stride_a, sa, result, len, offset, stride);
+}
+
+float* Ferrum::RecordingEngine::vect_fbB(Ferrum::FunctionID id, float sa,
+                                         const float* a, int lena, int offset_a, int stride_a,
+                                         float* result, int len, int offset, int stride) {
+  record("vect_fbB", id, {}, {sa}, {lena, offset_a, stride_a, len, offset, stride});
+  if (delegate == nullptr) {
+    return result;
+  }
+  return delegate->vect_fbB(id, sa, a, lena, offset_a, stride_a, result, len, offset, stride);
+}
+
+float* Ferrum::RecordingEngine::vect_bbB(Ferrum::FunctionID id, const float* a, int lena, int offset_a, int stride_a,
+                                         const float* b, int lenb, int offset_b, int stride_b,
+                                         float* result, int len, int offset, int stride) {
+  record("vect_bbB", id, {}, {}, {lena, offset_a, stride_a, lenb, offset_b, stride_b, len, offset, stride});
+  if (delegate == nullptr) {
+    return result;
+  }
+  return delegate->vect_bbB(id, a, lena, offset_a, stride_a, b, lenb, offset_b, stride_b, result, len, offset, stride);
+}
+
+float* Ferrum::RecordingEngine::vect_bBB(Ferrum::FunctionID id, const float* a, int lena, int offset_a, int stride_a,
+                                         float* b, int lenb, int offset_b, int stride_b,
+                                         float* result, int len, int offset, int stride) {
+  record("vect_bBB", id, {}, {}, {lena, offset_a, stride_a, lenb, offset_b, stride_b, len, offset, stride});
+  if (delegate == nullptr) {
+    return result;
+  }
+  return delegate->vect_bBB(id, a, lena, offset_a, stride_a, b, lenb, offset_b, stride_b, result, len, offset, stride);
+}
+
+float* Ferrum::RecordingEngine::vect_bffffB(Ferrum::FunctionID id, const float* a, int lena, int offset_a, int stride_a,
+                                            float sa, float sha,
+                                            float sb, float shb,
+                                            float* result, int len, int offset, int stride) {
+  record("vect_bffffB", id, {}, {sa, sha, sb, shb}, {lena, offset_a, stride_a, len, offset, stride});
+  if (delegate == nullptr) {
+    return result;
+  }
+  return delegate->vect_bffffB(id, a, lena, offset_a, stride_a, sa, sha, sb, shb, result, len, offset, stride);
+}
+
+float* Ferrum::RecordingEngine::vect_bbffffB(Ferrum::FunctionID id, const float* a, int lena, int offset_a, int stride_a,
+                                             const float* b, int lenb, int offset_b, int stride_b,
+                                             float sa, float sha,
+                                             float sb, float shb,
+                                             float* result, int len, int offset, int stride) {
+  record("vect_bbffffB", id, {}, {sa, sha, sb, shb}, {lena, offset_a, stride_a, lenb, offset_b, stride_b, len, offset, stride});
+  if (delegate == nullptr) {
+    return result;
+  }
+  return delegate->vect_bbffffB(id, a, lena, offset_a, stride_a, b, lenb, offset_b, stride_b, sa, sha, sb, shb, result, len, offset, stride);
+}
+
+
+float* Ferrum::RecordingEngine::vect_fused(const FusedExpr& expr, const std::vector<FusedInput>& inputs,
+                                           float* result, int len, int offset, int stride) {
+  std::vector<int> functions;
+  std::vector<double> scalars;
+  for (const FusedNode& node : expr.nodes()) {
+    functions.push_back(static_cast<int>(node.id));
+    scalars.insert(scalars.end(), node.scalars, node.scalars + 4);
+  }
+  std::vector<int> buffers;
+  for (const FusedInput& in : inputs) {
+    buffers.insert(buffers.end(), {in.length, in.offset, in.stride});
+  }
+  buffers.insert(buffers.end(), {len, offset, stride});
+  record("vect_fused", FunctionID::UNKNOWN, std::move(functions), std::move(scalars), std::move(buffers));
+  if (delegate == nullptr) {
+    return result;
+  }
+  return delegate->vect_fused(expr, inputs, result, len, offset, stride);
+}
+
+
+// general matrix functions
+float* Ferrum::RecordingEngine::ge_bB(Ferrum::FunctionID id, int sd, int fd,
+                                      const float* a, int lena, int offset_a, int stride_a,
+                                      float* result, int len, int offset, int stride) {
+  record("ge_bB", id, {sd, fd}, {}, {lena, offset_a, stride_a, len, offset, stride});
+  if (delegate == nullptr) {
+    return result;
+  }
+  return delegate->ge_bB(id, sd, fd, a, lena, offset_a, stride_a, result, len, offset, stride);
+}
+
+float* Ferrum::RecordingEngine::ge_bfB(Ferrum::FunctionID id, int sd, int fd,
+                                       const float* a, int lena, int offset_a, int stride_a,
+                                       float sa,
+                                       float* result, int len, int offset, int stride) {
+  record("ge_bfB", id, {sd, fd}, {sa}, {lena, offset_a, stride_a, len, offset, stride});
+  if (delegate == nullptr) {
+    return result;
+  }
+  return delegate->ge_bfB(id, sd, fd, a, lena, offset_a, stride_a, sa, result, len, offset, stride);
+}
+
+float* Ferrum::RecordingEngine::ge_fbB(Ferrum::FunctionID id, int sd, int fd, float sa,
+                                       const float* a, int lena, int offset_a, int stride_a,
+                                       float* result, int len, int offset, int stride) {
+  record("ge_fbB", id, {sd, fd}, {sa}, {lena, offset_a, stride_a, len, offset, stride});
+  if (delegate == nullptr) {
+    return result;
+  }
+  return delegate->ge_fbB(id, sd, fd, sa, a, lena, offset_a, stride_a, result, len, offset, stride);
+}
+
+float* Ferrum::RecordingEngine::ge_bbB(Ferrum::FunctionID id, int sd, int fd,
+                                       const float* a, int lena, int offset_a, int stride_a,
+                                       const float* b, int lenb, int offset_b, int stride_b,
+                                       float* result, int len, int offset, int stride) {
+  record("ge_bbB", id, {sd, fd}, {}, {lena, offset_a, stride_a, lenb, offset_b, stride_b, len, offset, stride});
+  if (delegate == nullptr) {
+    return result;
+  }
+  return delegate->ge_bbB(id, sd, fd, a, lena, offset_a, stride_a, b, lenb, offset_b, stride_b, result, len, offset, stride);
+}
+
+float* Ferrum::RecordingEngine::ge_bBB(Ferrum::FunctionID id, int sd, int fd,
+                                       const float* a, int lena, int offset_a, int stride_a,
+                                       float* b, int lenb, int offset_b, int stride_b,
+                                       float* result, int len, int offset, int stride) {
+  record("ge_bBB", id, {sd, fd}, {}, {lena, offset_a, stride_a, lenb, offset_b, stride_b, len, offset, stride});
+  if (delegate == nullptr) {
+    return result;
+  }
+  return delegate->ge_bBB(id, sd, fd, a, lena, offset_a, stride_a, b, lenb, offset_b, stride_b, result, len, offset, stride);
+}
+
+float* Ferrum::RecordingEngine::ge_bffffB(Ferrum::FunctionID id, int sd, int fd,
+                                          const float* a, int lena, int offset_a, int stride_a,
+                                          float sa, float sha,
+                                          float sb, float shb,
+                                          float* result, int len, int offset, int stride) {
+  record("ge_bffffB", id, {sd, fd}, {sa, sha, sb, shb}, {lena, offset_a, stride_a, len, offset, stride});
+  if (delegate == nullptr) {
+    return result;
+  }
+  return delegate->ge_bffffB(id, sd, fd, a, lena, offset_a, stride_a, sa, sha, sb, shb, result, len, offset, stride);
+}
+
+float* Ferrum::RecordingEngine::ge_bbffffB(Ferrum::FunctionID id, int sd, int fd,
+                                           const float* a, int lena, int offset_a, int stride_a,
+                                           const float* b, int lenb, int offset_b, int stride_b,
+                                           float sa, float sha,
+                                           float sb, float shb,
+                                           float* result, int len, int offset, int stride) {
+  record("ge_bbffffB", id, {sd, fd}, {sa, sha, sb, shb}, {lena, offset_a, stride_a, lenb, offset_b, stride_b, len, offset, stride});
+  if (delegate == nullptr) {
+    return result;
+  }
+  return delegate->ge_bbffffB(id, sd, fd, a, lena, offset_a, stride_a, b, lenb, offset_b, stride_b, sa, sha, sb, shb, result, len, offset, stride);
+}
+
+
+// general uplo functions
+float* Ferrum::RecordingEngine::uplo_bB(Ferrum::FunctionID id, int sd, int unit, int bottom,
+                                        const float* a, int lena, int offset_a, int stride_a,
+                                        float* result, int len, int offset, int stride) {
+  record("uplo_bB", id, {sd, unit, bottom}, {}, {lena, offset_a, stride_a, len, offset, stride});
+  if (delegate == nullptr) {
+    return result;
+  }
+  return delegate->uplo_bB(id, sd, unit, bottom, a, lena, offset_a, stride_a, result, len, offset, stride);
+}
+
+float* Ferrum::RecordingEngine::uplo_bfB(Ferrum::FunctionID id, int sd, int unit, int bottom,
+                                         const float* a, int lena, int offset_a, int stride_a,
+                                         float sa,
+                                         float* result, int len, int offset, int stride) {
+  record("uplo_bfB", id, {sd, unit, bottom}, {sa}, {lena, offset_a, stride_a, len, offset, stride});
+  if (delegate == nullptr) {
+    return result;
+  }
+  return delegate->uplo_bfB(id, sd, unit, bottom, a, lena, offset_a, stride_a, sa, result, len, offset, stride);
+}
+
+float* Ferrum::RecordingEngine::uplo_fbB(Ferrum::FunctionID id, int sd, int unit, int bottom,
+                                         const float* a, int lena, int offset_a, int stride_a,
+                                         float sa,
+                                         float* result, int len, int offset, int stride) {
+  record("uplo_fbB", id, {sd, unit, bottom}, {sa}, {lena, offset_a, stride_a, len, offset, stride});
+  if (delegate == nullptr) {
+    return result;
+  }
+  return delegate->uplo_fbB(id, sd, unit, bottom, a, lena, offset_a, stride_a, sa, result, len, offset, stride);
+}
+
+float* Ferrum::RecordingEngine::uplo_bbB(Ferrum::FunctionID id, int sd, int unit, int bottom,
+                                         const float* a, int lena, int offset_a, int stride_a,
+                                         const float* b, int lenb, int offset_b, int stride_b,
+                                         float* result, int len, int offset, int stride) {
+  record("uplo_bbB", id, {sd, unit, bottom}, {}, {lena, offset_a, stride_a, lenb, offset_b, stride_b, len, offset, stride});
+  if (delegate == nullptr) {
+    return result;
+  }
+  return delegate->uplo_bbB(id, sd, unit, bottom, a, lena, offset_a, stride_a, b, lenb, offset_b, stride_b, result, len, offset, stride);
+}
+
+float* Ferrum::RecordingEngine::uplo_bBB(Ferrum::FunctionID id, int sd, int unit, int bottom,
+                                         const float* a, int lena, int offset_a, int stride_a,
+                                         float* b, int lenb, int offset_b, int stride_b,
+                                         float* result, int len, int offset, int stride) {
+  record("uplo_bBB", id, {sd, unit, bottom}, {}, {lena, offset_a, stride_a, lenb, offset_b, stride_b, len, offset, stride});
+  if (delegate == nullptr) {
+    return result;
+  }
+  return delegate->uplo_bBB(id, sd, unit, bottom, a, lena, offset_a, stride_a, b, lenb, offset_b, stride_b, result, len, offset, stride);
+}
+
+float* Ferrum::RecordingEngine::uplo_bffffB(Ferrum::FunctionID id, int sd, int unit, int bottom,
+                                            const float* a, int lena, int offset_a, int stride_a,
+                                            float sa, float sha,
+                                            float sb, float shb,
+                                            float* result, int len, int offset, int stride) {
+  record("uplo_bffffB", id, {sd, unit, bottom}, {sa, sha, sb, shb}, {lena, offset_a, stride_a, len, offset, stride});
+  if (delegate == nullptr) {
+    return result;
+  }
+  return delegate->uplo_bffffB(id, sd, unit, bottom, a, lena, offset_a, stride_a, sa, sha, sb, shb, result, len, offset, stride);
+}
+
+float* Ferrum::RecordingEngine::uplo_bbffffB(Ferrum::FunctionID id, int sd, int unit, int bottom,
+                                             const float* a, int lena, int offset_a, int stride_a,
+                                             const float* b, int lenb, int offset_b, int stride_b,
+                                             float sa, float sha,
+                                             float sb, float shb,
+                                             float* result, int len, int offset, int stride) {
+  record("uplo_bbffffB", id, {sd, unit, bottom}, {sa, sha, sb, shb}, {lena, offset_a, stride_a, lenb, offset_b, stride_b, len, offset, stride});
+  if (delegate == nullptr) {
+    return result;
+  }
+  return delegate->uplo_bbffffB(id, sd, unit, bottom, a, lena, offset_a, stride_a, b, lenb, offset_b, stride_b, sa, sha, sb, shb, result, len, offset, stride);
+}
+
+
+// matrix products
+float* Ferrum::RecordingEngine::ge_gemm(int trans_a, int trans_b, int m, int n, int k, float alpha,
+                                        const float* a, int lena, int offset_a, int ld_a,
+                                        const float* b, int lenb, int offset_b, int ld_b,
+                                        float beta,
+                                        float* c, int lenc, int offset_c, int ld_c) {
+  record("ge_gemm", FunctionID::ge_gemm, {trans_a, trans_b, m, n, k}, {alpha, beta},
+         {lena, offset_a, ld_a, lenb, offset_b, ld_b, lenc, offset_c, ld_c});
+  if (delegate == nullptr) {
+    return c;
+  }
+  return delegate->ge_gemm(trans_a, trans_b, m, n, k, alpha, a, lena, offset_a, ld_a, b, lenb, offset_b, ld_b,
+                           beta, c, lenc, offset_c, ld_c);
+}
+
+float* Ferrum::RecordingEngine::ge_mv(int trans, int m, int n, float alpha,
+                                      const float* a, int lena, int offset_a, int ld_a,
+                                      const float* x, int lenx, int offset_x, int stride_x,
+                                      float beta,
+                                      float* y, int leny, int offset_y, int stride_y) {
+  record("ge_mv", FunctionID::ge_mv, {trans, m, n}, {alpha, beta},
+         {lena, offset_a, ld_a, lenx, offset_x, stride_x, leny, offset_y, stride_y});
+  if (delegate == nullptr) {
+    return y;
+  }
+  return delegate->ge_mv(trans, m, n, alpha, a, lena, offset_a, ld_a, x, lenx, offset_x, stride_x,
+                         beta, y, leny, offset_y, stride_y);
+}
+
+float* Ferrum::RecordingEngine::ge_rk(int m, int n, float alpha,
+                                      const float* x, int lenx, int offset_x, int stride_x,
+                                      const float* y, int leny, int offset_y, int stride_y,
+                                      float* a, int lena, int offset_a, int ld_a) {
+  record("ge_rk", FunctionID::ge_rk, {m, n}, {alpha},
+         {lenx, offset_x, stride_x, leny, offset_y, stride_y, lena, offset_a, ld_a});
+  if (delegate == nullptr) {
+    return a;
+  }
+  return delegate->ge_rk(m, n, alpha, x, lenx, offset_x, stride_x, y, leny, offset_y, stride_y,
+                         a, lena, offset_a, ld_a);
+}
+
+float* Ferrum::RecordingEngine::uplo_trmv(int trans, int sd, int unit, int bottom,
+                                          const float* a, int lena, int offset_a, int ld_a,
+                                          float* x, int lenx, int offset_x, int stride_x) {
+  record("uplo_trmv", FunctionID::uplo_trmv, {trans, sd, unit, bottom}, {},
+         {lena, offset_a, ld_a, lenx, offset_x, stride_x});
+  if (delegate == nullptr) {
+    return x;
+  }
+  return delegate->uplo_trmv(trans, sd, unit, bottom, a, lena, offset_a, ld_a, x, lenx, offset_x, stride_x);
+}
+
+float* Ferrum::RecordingEngine::uplo_trsv(int trans, int sd, int unit, int bottom,
+                                          const float* a, int lena, int offset_a, int ld_a,
+                                          float* x, int lenx, int offset_x, int stride_x) {
+  record("uplo_trsv", FunctionID::uplo_trsv, {trans, sd, unit, bottom}, {},
+         {lena, offset_a, ld_a, lenx, offset_x, stride_x});
+  if (delegate == nullptr) {
+    return x;
+  }
+  return delegate->uplo_trsv(trans, sd, unit, bottom, a, lena, offset_a, ld_a, x, lenx, offset_x, stride_x);
+}
+
+float* Ferrum::RecordingEngine::uplo_trmm(int left, int trans, int unit, int bottom, int m, int n, float alpha,
+                                          const float* a, int lena, int offset_a, int ld_a,
+                                          float* b, int lenb, int offset_b, int ld_b) {
+  record("uplo_trmm", FunctionID::uplo_trmm, {left, trans, unit, bottom, m, n}, {alpha},
+         {lena, offset_a, ld_a, lenb, offset_b, ld_b});
+  if (delegate == nullptr) {
+    return b;
+  }
+  return delegate->uplo_trmm(left, trans, unit, bottom, m, n, alpha, a, lena, offset_a, ld_a, b, lenb, offset_b, ld_b);
+}
+
+float* Ferrum::RecordingEngine::uplo_trsm(int left, int trans, int unit, int bottom, int m, int n, float alpha,
+                                          const float* a, int lena, int offset_a, int ld_a,
+                                          float* b, int lenb, int offset_b, int ld_b) {
+  record("uplo_trsm", FunctionID::uplo_trsm, {left, trans, unit, bottom, m, n}, {alpha},
+         {lena, offset_a, ld_a, lenb, offset_b, ld_b});
+  if (delegate == nullptr) {
+    return b;
+  }
+  return delegate->uplo_trsm(left, trans, unit, bottom, m, n, alpha, a, lena, offset_a, ld_a, b, lenb, offset_b, ld_b);
+}
+
+
+bool Ferrum::RecordingEngine::doublePrecision() const {
+  return delegate == nullptr || delegate->doublePrecision();
+}
+
+// double precision functions
+double* Ferrum::RecordingEngine::dvect_bB(Ferrum::FunctionID id, const double* a, int lena, int offset_a, int stride_a,
+                                          double* result, int len, int offset, int stride) {
+  record("dvect_bB", id, {}, {}, {lena, offset_a, stride_a, len, offset, stride});
+  if (delegate == nullptr) {
+    return result;
+  }
+  return delegate->dvect_bB(id, a, lena, offset_a, stride_a, result, len, offset, stride);
+}
+
+double* Ferrum::RecordingEngine::dvect_bfB(Ferrum::FunctionID id, const double* a, int lena, int offset_a, int stride_a,
+                                           double sa,
+                                           double* result, int len, int offset, int stride) {
+  record("dvect_bfB", id, {}, {sa}, {lena, offset_a, stride_a, len, offset, stride});
+  if (delegate == nullptr) {
+    return result;
+  }
+  return delegate->dvect_bfB(id, a, lena, offset_a, stride_a, sa, result, len, offset, stride);
+}
+
+double* Ferrum::RecordingEngine::dvect_fbB(Ferrum::FunctionID id, double sa,
+                                           const double* a, int lena, int offset_a, int stride_a,
+                                           double* result, int len, int offset, int stride) {
+  record("dvect_fbB", id, {}, {sa}, {lena, offset_a, stride_a, len, offset, stride});
+  if (delegate == nullptr) {
+    return result;
+  }
+  return delegate->dvect_fbB(id, sa, a, lena, offset_a, stride_a, result, len, offset, stride);
+}
+
+double* Ferrum::RecordingEngine::dvect_bbB(Ferrum::FunctionID id, const double* a, int lena, int offset_a, int stride_a,
+                                           const double* b, int lenb, int offset_b, int stride_b,
+                                           double* result, int len, int offset, int stride) {
+  record("dvect_bbB", id, {}, {}, {lena, offset_a, stride_a, lenb, offset_b, stride_b, len, offset, stride});
+  if (delegate == nullptr) {
+    return result;
+  }
+  return delegate->dvect_bbB(id, a, lena, offset_a, stride_a, b, lenb, offset_b, stride_b, result, len, offset, stride);
+}
+
+double* Ferrum::RecordingEngine::dvect_bBB(Ferrum::FunctionID id, const double* a, int lena, int offset_a, int stride_a,
+                                           double* b, int lenb, int offset_b, int stride_b,
+                                           double* result, int len, int offset, int stride) {
+  record("dvect_bBB", id, {}, {}, {lena, offset_a, stride_a, lenb, offset_b, stride_b, len, offset, stride});
+  if (delegate == nullptr) {
+    return result;
+  }
+  return delegate->dvect_bBB(id, a, lena, offset_a, stride_a, b, lenb, offset_b, stride_b, result, len, offset, stride);
+}
+
+double* Ferrum::RecordingEngine::dvect_bffffB(Ferrum::FunctionID id, const double* a, int lena, int offset_a, int stride_a,
+                                              double sa, double sha,
+                                              double sb, double shb,
+                                              double* result, int len, int offset, int stride) {
+  record("dvect_bffffB", id, {}, {sa, sha, sb, shb}, {lena, offset_a, stride_a, len, offset, stride});
+  if (delegate == nullptr) {
+    return result;
+  }
+  return delegate->dvect_bffffB(id, a, lena, offset_a, stride_a, sa, sha, sb, shb, result, len, offset, stride);
+}
+
+double* Ferrum::RecordingEngine::dvect_bbffffB(Ferrum::FunctionID id, const double* a, int lena, int offset_a, int stride_a,
+                                               const double* b, int lenb, int offset_b, int stride_b,
+                                               double sa, double sha,
+                                               double sb, double shb,
+                                               double* result, int len, int offset, int stride) {
+  record("dvect_bbffffB", id, {}, {sa, sha, sb, shb}, {lena, offset_a, stride_a, lenb, offset_b, stride_b, len, offset, stride});
+  if (delegate == nullptr) {
+    return result;
+  }
+  return delegate->dvect_bbffffB(id, a, lena, offset_a, stride_a, b, lenb, offset_b, stride_b, sa, sha, sb, shb, result, len, offset, stride);
+}
+
+double* Ferrum::RecordingEngine::dge_bB(Ferrum::FunctionID id, int sd, int fd,
+                                        const double* a, int lena, int offset_a, int stride_a,
+                                        double* result, int len, int offset, int stride) {
+  record("dge_bB", id, {sd, fd}, {}, {lena, offset_a, stride_a, len, offset, stride});
+  if (delegate == nullptr) {
+    return result;
+  }
+  return delegate->dge_bB(id, sd, fd, a, lena, offset_a, stride_a, result, len, offset, stride);
+}
+
+double* Ferrum::RecordingEngine::dge_bfB(Ferrum::FunctionID id, int sd, int fd,
+                                         const double* a, int lena, int offset_a, int stride_a,
+                                         double sa,
+                                         double* result, int len, int offset, int stride) {
+  record("dge_bfB", id, {sd, fd}, {sa}, {lena, offset_a, stride_a, len, offset, stride});
+  if (delegate == nullptr) {
+    return result;
+  }
+  return delegate->dge_bfB(id, sd, fd, a, lena, offset_a, stride_a, sa, result, len, offset, stride);
+}
+
+double* Ferrum::RecordingEngine::dge_fbB(Ferrum::FunctionID id, int sd, int fd, double sa,
+                                         const double* a, int lena, int offset_a, int stride_a,
+                                         double* result, int len, int offset, int stride) {
+  record("dge_fbB", id, {sd, fd}, {sa}, {lena, offset_a, stride_a, len, offset, stride});
+  if (delegate == nullptr) {
+    return result;
+  }
+  return delegate->dge_fbB(id, sd, fd, sa, a, lena, offset_a, stride_a, result, len, offset, stride);
+}
+
+double* Ferrum::RecordingEngine::dge_bbB(Ferrum::FunctionID id, int sd, int fd,
+                                         const double* a, int lena, int offset_a, int stride_a,
+                                         const double* b, int lenb, int offset_b, int stride_b,
+                                         double* result, int len, int offset, int stride) {
+  record("dge_bbB", id, {sd, fd}, {}, {lena, offset_a, stride_a, lenb, offset_b, stride_b, len, offset, stride});
+  if (delegate == nullptr) {
+    return result;
+  }
+  return delegate->dge_bbB(id, sd, fd, a, lena, offset_a, stride_a, b, lenb, offset_b, stride_b, result, len, offset, stride);
+}
+
+double* Ferrum::RecordingEngine::dge_bBB(Ferrum::FunctionID id, int sd, int fd,
+                                         const double* a, int lena, int offset_a, int stride_a,
+                                         double* b, int lenb, int offset_b, int stride_b,
+                                         double* result, int len, int offset, int stride) {
+  record("dge_bBB", id, {sd, fd}, {}, {lena, offset_a, stride_a, lenb, offset_b, stride_b, len, offset, stride});
+  if (delegate == nullptr) {
+    return result;
+  }
+  return delegate->dge_bBB(id, sd, fd, a, lena, offset_a, stride_a, b, lenb, offset_b, stride_b, result, len, offset, stride);
+}
+
+double* Ferrum::RecordingEngine::dge_bffffB(Ferrum::FunctionID id, int sd, int fd,
+                                            const double* a, int lena, int offset_a, int stride_a,
+                                            double sa, double sha,
+                                            double sb, double shb,
+                                            double* result, int len, int offset, int stride) {
+  record("dge_bffffB", id, {sd, fd}, {sa, sha, sb, shb}, {lena, offset_a, stride_a, len, offset, stride});
+  if (delegate == nullptr) {
+    return result;
+  }
+  return delegate->dge_bffffB(id, sd, fd, a, lena, offset_a, stride_a, sa, sha, sb, shb, result, len, offset, stride);
+}
+
+double* Ferrum::RecordingEngine::dge_bbffffB(Ferrum::FunctionID id, int sd, int fd,
+                                             const double* a, int lena, int offset_a, int stride_a,
+                                             const double* b, int lenb, int offset_b, int stride_b,
+                                             double sa, double sha,
+                                             double sb, double shb,
+                                             double* result, int len, int offset, int stride) {
+  record("dge_bbffffB", id, {sd, fd}, {sa, sha, sb, shb}, {lena, offset_a, stride_a, lenb, offset_b, stride_b, len, offset, stride});
+  if (delegate == nullptr) {
+    return result;
+  }
+  return delegate->dge_bbffffB(id, sd, fd, a, lena, offset_a, stride_a, b, lenb, offset_b, stride_b, sa, sha, sb, shb, result, len, offset, stride);
+}
+
+double* Ferrum::RecordingEngine::duplo_bB(Ferrum::FunctionID id, int sd, int unit, int bottom,
+                                          const double* a, int lena, int offset_a, int stride_a,
+                                          double* result, int len, int offset, int stride) {
+  record("duplo_bB", id, {sd, unit, bottom}, {}, {lena, offset_a, stride_a, len, offset, stride});
+  if (delegate == nullptr) {
+    return result;
+  }
+  return delegate->duplo_bB(id, sd, unit, bottom, a, lena, offset_a, stride_a, result, len, offset, stride);
+}
+
+double* Ferrum::RecordingEngine::duplo_bfB(Ferrum::FunctionID id, int sd, int unit, int bottom,
+                                           const double* a, int lena, int offset_a, int stride_a,
+                                           double sa,
+                                           double* result, int len, int offset, int stride) {
+  record("duplo_bfB", id, {sd, unit, bottom}, {sa}, {lena, offset_a, stride_a, len, offset, stride});
+  if (delegate == nullptr) {
+    return result;
+  }
+  return delegate->duplo_bfB(id, sd, unit, bottom, a, lena, offset_a, stride_a, sa, result, len, offset, stride);
+}
+
+double* Ferrum::RecordingEngine::duplo_fbB(Ferrum::FunctionID id, int sd, int unit, int bottom,
+                                           const double* a, int lena, int offset_a, int stride_a,
+                                           double sa,
+                                           double* result, int len, int offset, int stride) {
+  record("duplo_fbB", id, {sd, unit, bottom}, {sa}, {lena, offset_a, stride_a, len, offset, stride});
+  if (delegate == nullptr) {
+    return result;
+  }
+  return delegate->duplo_fbB(id, sd, unit, bottom, a, lena, offset_a, stride_a, sa, result, len, offset, stride);
+}
+
+double* Ferrum::RecordingEngine::duplo_bbB(Ferrum::FunctionID id, int sd, int unit, int bottom,
+                                           const double* a, int lena, int offset_a, int stride_a,
+                                           const double* b, int lenb, int offset_b, int stride_b,
+                                           double* result, int len, int offset, int stride) {
+  record("duplo_bbB", id, {sd, unit, bottom}, {}, {lena, offset_a, stride_a, lenb, offset_b, stride_b, len, offset, stride});
+  if (delegate == nullptr) {
+    return result;
+  }
+  return delegate->duplo_bbB(id, sd, unit, bottom, a, lena, offset_a, stride_a, b, lenb, offset_b, stride_b, result, len, offset, stride);
+}
+
+double* Ferrum::RecordingEngine::duplo_bBB(Ferrum::FunctionID id, int sd, int unit, int bottom,
+                                           const double* a, int lena, int offset_a, int stride_a,
+                                           double* b, int lenb, int offset_b, int stride_b,
+                                           double* result, int len, int offset, int stride) {
+  record("duplo_bBB", id, {sd, unit, bottom}, {}, {lena, offset_a, stride_a, lenb, offset_b, stride_b, len, offset, stride});
+  if (delegate == nullptr) {
+    return result;
+  }
+  return delegate->duplo_bBB(id, sd, unit, bottom, a, lena, offset_a, stride_a, b, lenb, offset_b, stride_b, result, len, offset, stride);
+}
+
+double* Ferrum::RecordingEngine::duplo_bffffB(Ferrum::FunctionID id, int sd, int unit, int bottom,
+                                              const double* a, int lena, int offset_a, int stride_a,
+                                              double sa, double sha,
+                                              double sb, double shb,
+                                              double* result, int len, int offset, int stride) {
+  record("duplo_bffffB", id, {sd, unit, bottom}, {sa, sha, sb, shb}, {lena, offset_a, stride_a, len, offset, stride});
+  if (delegate == nullptr) {
+    return result;
+  }
+  return delegate->duplo_bffffB(id, sd, unit, bottom, a, lena, offset_a, stride_a, sa, sha, sb, shb, result, len, offset, stride);
+}
+
+double* Ferrum::RecordingEngine::duplo_bbffffB(Ferrum::FunctionID id, int sd, int unit, int bottom,
+                                               const double* a, int lena, int offset_a, int stride_a,
+                                               const double* b, int lenb, int offset_b, int stride_b,
+                                               double sa, double sha,
+                                               double sb, double shb,
+                                               double* result, int len, int offset, int stride) {
+  record("duplo_bbffffB", id, {sd, unit, bottom}, {sa, sha, sb, shb}, {lena, offset_a, stride_a, lenb, offset_b, stride_b, len, offset, stride});
+  if (delegate == nullptr) {
+    return result;
+  }
+  return delegate->duplo_bbffffB(id, sd, unit, bottom, a, lena, offset_a, stride_a, b, lenb, offset_b, stride_b, sa, sha, sb, shb, result, len, offset, stride);
+}
+
+
+bool Ferrum::RecordingEngine::halfStorage() const {
+  return delegate == nullptr || delegate->halfStorage();
+}
+
+// half precision functions
+uint16_t* Ferrum::RecordingEngine::hvect_bB(Ferrum::FunctionID id, HalfFormat format, const uint16_t* a, int lena, int offset_a, int stride_a,
+                                            uint16_t* result, int len, int offset, int stride) {
+  record("hvect_bB", id, {static_cast<int>(format)}, {}, {lena, offset_a, stride_a, len, offset, stride});
+  if (delegate == nullptr) {
+    return result;
+  }
+  return delegate->hvect_bB(id, format, a, lena, offset_a, stride_a, result, len, offset, stride);
+}
+
+uint16_t* Ferrum::RecordingEngine::hvect_bfB(Ferrum::FunctionID id, HalfFormat format, const uint16_t* a, int lena, int offset_a, int stride_a,
+                                             float sa,
+                                             uint16_t* result, int len, int offset, int stride) {
+  record("hvect_bfB", id, {static_cast<int>(format)}, {sa}, {lena, offset_a, stride_a, len, offset, stride});
+  if (delegate == nullptr) {
+    return result;
+  }
+  return delegate->hvect_bfB(id, format, a, lena, offset_a, stride_a, sa, result, len, offset, stride);
+}
+
+uint16_t* Ferrum::RecordingEngine::hvect_fbB(Ferrum::FunctionID id, HalfFormat format, float sa,
+                                             const uint16_t* a, int lena, int offset_a, int stride_a,
+                                             uint16_t* result, int len, int offset, int stride) {
+  record("hvect_fbB", id, {static_cast<int>(format)}, {sa}, {lena, offset_a, stride_a, len, offset, stride});
+  if (delegate == nullptr) {
+    return result;
+  }
+  return delegate->hvect_fbB(id, format, sa, a, lena, offset_a, stride_a, result, len, offset, stride);
+}
+
+uint16_t* Ferrum::RecordingEngine::hvect_bbB(Ferrum::FunctionID id, HalfFormat format, const uint16_t* a, int lena, int offset_a, int stride_a,
+                                             const uint16_t* b, int lenb, int offset_b, int stride_b,
+                                             uint16_t* result, int len, int offset, int stride) {
+  record("hvect_bbB", id, {static_cast<int>(format)}, {}, {lena, offset_a, stride_a, lenb, offset_b, stride_b, len, offset, stride});
+  if (delegate == nullptr) {
+    return result;
+  }
+  return delegate->hvect_bbB(id, format, a, lena, offset_a, stride_a, b, lenb, offset_b, stride_b, result, len, offset, stride);
+}
+
+uint16_t* Ferrum::RecordingEngine::hvect_bBB(Ferrum::FunctionID id, HalfFormat format, const uint16_t* a, int lena, int offset_a, int stride_a,
+                                             uint16_t* b, int lenb, int offset_b, int stride_b,
+                                             uint16_t* result, int len, int offset, int stride) {
+  record("hvect_bBB", id, {static_cast<int>(format)}, {}, {lena, offset_a, stride_a, lenb, offset_b, stride_b, len, offset, stride});
+  if (delegate == nullptr) {
+    return result;
+  }
+  return delegate->hvect_bBB(id, format, a, lena, offset_a, stride_a, b, lenb, offset_b, stride_b, result, len, offset, stride);
+}
+
+uint16_t* Ferrum::RecordingEngine::hvect_bffffB(Ferrum::FunctionID id, HalfFormat format, const uint16_t* a, int lena, int offset_a, int stride_a,
+                                                float sa, float sha,
+                                                float sb, float shb,
+                                                uint16_t* result, int len, int offset, int stride) {
+  record("hvect_bffffB", id, {static_cast<int>(format)}, {sa, sha, sb, shb}, {lena, offset_a, stride_a, len, offset, stride});
+  if (delegate == nullptr) {
+    return result;
+  }
+  return delegate->hvect_bffffB(id, format, a, lena, offset_a, stride_a, sa, sha, sb, shb, result, len, offset, stride);
+}
+
+uint16_t* Ferrum::RecordingEngine::hvect_bbffffB(Ferrum::FunctionID id, HalfFormat format, const uint16_t* a, int lena, int offset_a, int stride_a,
+                                                 const uint16_t* b, int lenb, int offset_b, int stride_b,
+                                                 float sa, float sha,
+                                                 float sb, float shb,
+                                                 uint16_t* result, int len, int offset, int stride) {
+  record("hvect_bbffffB", id, {static_cast<int>(format)}, {sa, sha, sb, shb}, {lena, offset_a, stride_a, lenb, offset_b, stride_b, len, offset, stride});
+  if (delegate == nullptr) {
+    return result;
+  }
+  return delegate->hvect_bbffffB(id, format, a, lena, offset_a, stride_a, b, lenb, offset_b, stride_b, sa, sha, sb, shb, result, len, offset, stride);
+}
+
+uint16_t* Ferrum::RecordingEngine::hge_bB(Ferrum::FunctionID id, HalfFormat format, int sd, int fd,
+                                          const uint16_t* a, int lena, int offset_a, int stride_a,
+                                          uint16_t* result, int len, int offset, int stride) {
+  record("hge_bB", id, {static_cast<int>(format), sd, fd}, {}, {lena, offset_a, stride_a, len, offset, stride});
+  if (delegate == nullptr) {
+    return result;
+  }
+  return delegate->hge_bB(id, format, sd, fd, a, lena, offset_a, stride_a, result, len, offset, stride);
+}
+
+uint16_t* Ferrum::RecordingEngine::hge_bfB(Ferrum::FunctionID id, HalfFormat format, int sd, int fd,
+                                           const uint16_t* a, int lena, int offset_a, int stride_a,
+                                           float sa,
+                                           uint16_t* result, int len, int offset, int stride) {
+  record("hge_bfB", id, {static_cast<int>(format), sd, fd}, {sa}, {lena, offset_a, stride_a, len, offset, stride});
+  if (delegate == nullptr) {
+    return result;
+  }
+  return delegate->hge_bfB(id, format, sd, fd, a, lena, offset_a, stride_a, sa, result, len, offset, stride);
+}
+
+uint16_t* Ferrum::RecordingEngine::hge_fbB(Ferrum::FunctionID id, HalfFormat format, int sd, int fd, float sa,
+                                           const uint16_t* a, int lena, int offset_a, int stride_a,
+                                           uint16_t* result, int len, int offset, int stride) {
+  record("hge_fbB", id, {static_cast<int>(format), sd, fd}, {sa}, {lena, offset_a, stride_a, len, offset, stride});
+  if (delegate == nullptr) {
+    return result;
+  }
+  return delegate->hge_fbB(id, format, sd, fd, sa, a, lena, offset_a, stride_a, result, len, offset, stride);
+}
+
+uint16_t* Ferrum::RecordingEngine::hge_bbB(Ferrum::FunctionID id, HalfFormat format, int sd, int fd,
+                                           const uint16_t* a, int lena, int offset_a, int stride_a,
+                                           const uint16_t* b, int lenb, int offset_b, int stride_b,
+                                           uint16_t* result, int len, int offset, int stride) {
+  record("hge_bbB", id, {static_cast<int>(format), sd, fd}, {}, {lena, offset_a, stride_a, lenb, offset_b, stride_b, len, offset, stride});
+  if (delegate == nullptr) {
+    return result;
+  }
+  return delegate->hge_bbB(id, format, sd, fd, a, lena, offset_a, stride_a, b, lenb, offset_b, stride_b, result, len, offset, stride);
+}
+
+uint16_t* Ferrum::RecordingEngine::hge_bBB(Ferrum::FunctionID id, HalfFormat format, int sd, int fd,
+                                           const uint16_t* a, int lena, int offset_a, int stride_a,
+                                           uint16_t* b, int lenb, int offset_b, int stride_b,
+                                           uint16_t* result, int len, int offset, int stride) {
+  record("hge_bBB", id, {static_cast<int>(format), sd, fd}, {}, {lena, offset_a, stride_a, lenb, offset_b, stride_b, len, offset, stride});
+  if (delegate == nullptr) {
+    return result;
+  }
+  return delegate->hge_bBB(id, format, sd, fd, a, lena, offset_a, stride_a, b, lenb, offset_b, stride_b, result, len, offset, stride);
+}
+
+uint16_t* Ferrum::RecordingEngine::hge_bffffB(Ferrum::FunctionID id, HalfFormat format, int sd, int fd,
+                                              const uint16_t* a, int lena, int offset_a, int stride_a,
+                                              float sa, float sha,
+                                              float sb, float shb,
+                                              uint16_t* result, int len, int offset, int stride) {
+  record("hge_bffffB", id, {static_cast<int>(format), sd, fd}, {sa, sha, sb, shb}, {lena, offset_a, stride_a, len, offset, stride});
+  if (delegate == nullptr) {
+    return result;
+  }
+  return delegate->hge_bffffB(id, format, sd, fd, a, lena, offset_a, stride_a, sa, sha, sb, shb, result, len, offset, stride);
+}
+
+uint16_t* Ferrum::RecordingEngine::hge_bbffffB(Ferrum::FunctionID id, HalfFormat format, int sd, int fd,
+                                               const uint16_t* a, int lena, int offset_a, int stride_a,
+                                               const uint16_t* b, int lenb, int offset_b, int stride_b,
+                                               float sa, float sha,
+                                               float sb, float shb,
+                                               uint16_t* result, int len, int offset, int stride) {
+  record("hge_bbffffB", id, {static_cast<int>(format), sd, fd}, {sa, sha, sb, shb}, {lena, offset_a, stride_a, lenb, offset_b, stride_b, len, offset, stride});
+  if (delegate == nullptr) {
+    return result;
+  }
+  return delegate->hge_bbffffB(id, format, sd, fd, a, lena, offset_a, stride_a, b, lenb, offset_b, stride_b, sa, sha, sb, shb, result, len, offset, stride);
+}
@@ -0,0 +1,158 @@
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+#include "dispatch_plan.hpp"
+#include "thread_pool.hpp"
+
+Ferrum::ThreadPool::ThreadPool(int threads) : stopping(false) {
+  if (threads < 0) {
+    int hardware = static_cast<int>(std::thread::hardware_concurrency());
+    threads = hardware > 1 ? hardware - 1 : 0;
+  }
+  workers.reserve(threads);
+  for (int i = 0; i < threads; i++) {
+    workers.emplace_back([this]() { workerLoop(); });
+  }
+}
+
+Ferrum::ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    stopping = true;
+  }
+  available.notify_all();
+  for (auto& worker : workers) {
+    worker.join();
+  }
+}
+
+void Ferrum::ThreadPool::workerLoop() {
+  while (true) {
+    Task task;
+    {
+      std::unique_lock<std::mutex> guard(lock);
+      available.wait(guard, [this]() { return stopping || !tasks.empty(); });
+      if (tasks.empty()) {
+        return;
+      }
+      task = std::move(tasks.front());
+      tasks.pop_front();
+    }
+    task();
+  }
+}
+
+bool Ferrum::ThreadPool::runPending() {
+  Task task;
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    if (tasks.empty()) {
+      return false;
+    }
+    task = std::move(tasks.front());
+    tasks.pop_front();
+  }
+  task();
+  return true;
+}
+
+void Ferrum::ThreadPool::parallelTasks(size_t count, const std::function<void(size_t)>& body) {
+  if (count == 0) {
+    return;
+  }
+  if (count == 1 || workers.empty()) {
+    for (size_t i = 0; i < count; i++) {
+      body(i);
+    }
+    return;
+  }
+
+  // completion state shared with the queued tasks
+  struct Latch {
+    std::atomic<size_t> remaining;
+    std::mutex lock;
+    std::condition_variable done;
+  };
+  auto latch = std::make_shared<Latch>();
+  latch->remaining = count - 1;
+
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    for (size_t i = 1; i < count; i++) {
+      tasks.emplace_back([latch, &body, i]() {
+        body(i);
+        if (--latch->remaining == 0) {
+          std::lock_guard<std::mutex> guard(latch->lock);
+          latch->done.notify_all();
+        }
+      });
+    }
+  }
+  available.notify_all();
+
+  body(0);
+
+  // Help with queued work rather than blocking. This also lets a task start a nested loop
+  // without every worker ending up asleep waiting on each other.
+  while (latch->remaining > 0) {
+    if (!runPending()) {
+      std::unique_lock<std::mutex> guard(latch->lock);
+      latch->done.wait(guard, [&latch]() { return latch->remaining == 0; });
+    }
+  }
+}
+
+void Ferrum::ThreadPool::parallelFor(size_t count, size_t grain, const RangeBody& body) {
+  ChunkPlan plan = planChunks(count, grain, concurrency());
+  if (plan.chunks == 0) {
+    return;
+  }
+  if (plan.chunks == 1) {
+    body(0, count);
+    return;
+  }
+  parallelTasks(plan.chunks, [&](size_t chunk) {
+    size_t begin = chunk * plan.chunkSize;
+    body(begin, std::min(begin + plan.chunkSize, count));
+  });
+}
+
+
+Ferrum::SerialQueue::SerialQueue() : stopping(false) {
+  worker = std::thread([this]() { workerLoop(); });
+}
+
+Ferrum::SerialQueue::~SerialQueue() {
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    stopping = true;
+  }
+  available.notify_all();
+  worker.join();
+}
+
+void Ferrum::SerialQueue::post(std::function<void()> task) {
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    tasks.push_back(std::move(task));
+  }
+  available.notify_one();
+}
+
+void Ferrum::SerialQueue::workerLoop() {
+  while (true) {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> guard(lock);
+      available.wait(guard, [this]() { return stopping || !tasks.empty(); });
+      // finish the queue before stopping
+      if (tasks.empty()) {
+        return;
+      }
+      task = std::move(tasks.front());
+      tasks.pop_front();
+    }
+    task();
+  }
+}
@@ -1,199 +1,500 @@
-// Self-contained C++ program to generate C++ source code enumerating
-// the function names from a Metal library
+// Self-contained C++ program to generate a C++ header enumerating
+// the kernel functions in the Metal sources, along with the shape of their arguments.
+// This parses the sources rather than loading a compiled library, so that it runs without Metal.
 
-#define NS_PRIVATE_IMPLEMENTATION
-#define MTL_PRIVATE_IMPLEMENTATION
-
-// include the std namespace so we can use the std::cout and std::getenv
-#include <iostream>
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <filesystem>
 #include <fstream>
-
-#include <Metal/Metal.hpp>
-#include <MetalKit/MetalKit.hpp>
-#include <simd/simd.h>
-
-#include "FoundationEx.hpp"
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
 
 const char* INCLUDE_DIR = "include";
 const char* SRC_DIR = "Sources/ferrum";
+const char* METAL_DIR = "Metal/ferrum";
 const char* HEADER_FILE = "functions.hpp";
-const char* SRC_FILE = "functions.cpp";
+const char* JAVA_FILE = "Functions.java";
+
+// The signatures of the dispatch functions, as in include/signature.hpp
+const std::vector<std::string> SIGNATURES = {"bB", "bfB", "fbB", "bbB", "bBB", "bffffB", "bbffffB"};
 
-const char* LIB_NAME = "ferrum";
-const char* LIB_TYPE = "metallib";
-const char* FERRUM_LIB = "FERRUM_LIB";
+// A kernel function, and the shape of its arguments
+struct Kernel {
+  std::string name;
+  std::string family;
+  std::string signature;
+};
 
-inline NS::String* nsStr(const char* str) {
-  return NS::String::string(str, NS::UTF8StringEncoding);
+bool identChar(char c) {
+  return std::isalnum((unsigned char)c) || c == '_';
 }
 
-const char* str(const NS::String* s) {
-  return (s != nullptr) ? s->utf8String() : "<null>";
+std::string trim(const std::string& s) {
+  size_t start = s.find_first_not_of(" \t\n");
+  size_t end = s.find_last_not_of(" \t\n");
+  return start == std::string::npos ? "" : s.substr(start, end - start + 1);
 }
 
-NS::String* metalExt = nsStr(LIB_TYPE);
-NS::String* ferrumName = nsStr(LIB_NAME);
+// Removes comments, and joins the lines of macros
+std::string stripSource(const std::string& source) {
+  std::string out;
+  for (size_t i = 0; i < source.size(); i++) {
+    if (source.compare(i, 2, "//") == 0) {
+      while (i < source.size() && source[i] != '\n') i++;
+      out += '\n';
+    } else if (source.compare(i, 2, "/*") == 0) {
+      size_t end = source.find("*/", i + 2);
+      i = (end == std::string::npos) ? source.size() : end + 1;
+      out += ' ';
+    } else if (source[i] == '\\' && i + 1 < source.size() && source[i + 1] == '\n') {
+      i++;
+      out += ' ';
+    } else {
+      out += source[i];
+    }
+  }
+  return out;
+}
+
+// Splits on the commas that are not inside brackets
+std::vector<std::string> splitArgs(const std::string& args) {
+  std::vector<std::string> parts;
+  int depth = 0;
+  std::string part;
+  for (char c : args) {
+    if (c == '(' || c == '[' || c == '<') depth++;
+    if (c == ')' || c == ']' || c == '>') depth--;
+    if (c == ',' && depth == 0) {
+      parts.push_back(trim(part));
+      part.clear();
+    } else {
+      part += c;
+    }
+  }
+  if (!trim(part).empty()) {
+    parts.push_back(trim(part));
+  }
+  return parts;
+}
 
-NS::String* getEnv(const char* name) {
-  const char* value = std::getenv(name);
-  return value != nullptr ? nsStr(value) : nullptr;
+// The index of the bracket that closes the one at open
+size_t closing(const std::string& text, size_t open) {
+  int depth = 0;
+  for (size_t i = open; i < text.size(); i++) {
+    if (text[i] == '(') depth++;
+    if (text[i] == ')' && --depth == 0) return i;
+  }
+  return std::string::npos;
 }
 
-const NS::String* getLibPath(const char* path) {
-  NS::String* resource = (path == nullptr) ? ferrumName : nsStr(path);
-  // check in the bundle
-  NS::BundleEx* mainBundle = NS::BundleEx::mainBundle();
-  if (mainBundle != nullptr && mainBundle->bundlePath() != nullptr) {
-    const NS::String* resource_path = mainBundle->pathForResource(resource, metalExt);
-    if (resource_path != nullptr) {
-      return resource_path;
+std::vector<std::string> words(const std::string& s) {
+  std::vector<std::string> result;
+  std::string word;
+  for (char c : s) {
+    if (identChar(c)) {
+      word += c;
+    } else {
+      if (!word.empty()) result.push_back(word);
+      word.clear();
+      if (c == '*' || c == '&') result.push_back(std::string(1, c));
     }
   }
+  if (!word.empty()) result.push_back(word);
+  return result;
+}
 
-  // not in the bundle, so check if the path points to the file
-  bool isDir = false;
-  NS::FileManager* fileManager = NS::FileManager::defaultManager();
+// Expands the function-like macros that declare kernels, such as REDUCE_B in reduction.metal.
+// Other preprocessor lines are dropped.
+std::string expandMacros(const std::string& source) {
+  struct Macro {
+    std::vector<std::string> params;
+    std::string body;
+  };
+  std::map<std::string, Macro> macros;
+  std::string text;
+  std::istringstream lines(source);
+  std::string line;
+  while (std::getline(lines, line)) {
+    std::string t = trim(line);
+    if (t.empty() || t[0] != '#') {
+      text += line + '\n';
+      continue;
+    }
+    if (t.compare(0, 7, "#define") != 0) continue;
+    size_t nameStart = t.find_first_not_of(" \t", 7);
+    size_t nameEnd = nameStart;
+    while (nameEnd < t.size() && identChar(t[nameEnd])) nameEnd++;
+    if (nameEnd < t.size() && t[nameEnd] == '(') {
+      size_t close = t.find(')', nameEnd);
+      std::string body = t.substr(close + 1);
+      if (body.find("kernel") != std::string::npos) {
+        macros[t.substr(nameStart, nameEnd - nameStart)] = {splitArgs(t.substr(nameEnd + 1, close - nameEnd - 1)), body};
+      }
+    }
+  }
 
-  if (path != nullptr) {
-    if (fileManager != nullptr && fileManager->fileExistsAtPath(resource, &isDir)) {
-      // if it's not a directory, then it's the file
-      if (!isDir) {
-        return resource;
+  std::string out;
+  size_t i = 0;
+  while (i < text.size()) {
+    if (!identChar(text[i])) {
+      out += text[i++];
+      continue;
+    }
+    size_t end = i;
+    while (end < text.size() && identChar(text[end])) end++;
+    std::string word = text.substr(i, end - i);
+    size_t open = text.find_first_not_of(" \t\n", end);
+    auto macro = macros.find(word);
+    if (macro == macros.end() || open == std::string::npos || text[open] != '(') {
+      out += word;
+      i = end;
+      continue;
+    }
+    size_t close = closing(text, open);
+    std::vector<std::string> args = splitArgs(text.substr(open + 1, close - open - 1));
+    const std::string& body = macro->second.body;
+    for (size_t j = 0; j < body.size();) {
+      if (!identChar(body[j])) {
+        out += body[j++];
+        continue;
       }
-      // it's a directory, so check if the file is in that directory
-      const NS::String* lib_path = NS::StringEx::asStringEx(resource)
-                                       ->stringByAppendingPathComponent(ferrumName)
-                                       ->stringByAppendingPathExtension(metalExt);
-      if (fileManager->fileExistsAtPath(lib_path, &isDir)) {
-        if (!isDir) {
-          return lib_path;
-        }
+      size_t k = j;
+      while (k < body.size() && identChar(body[k])) k++;
+      std::string token = body.substr(j, k - j);
+      auto param = std::find(macro->second.params.begin(), macro->second.params.end(), token);
+      if (param != macro->second.params.end() && (size_t)(param - macro->second.params.begin()) < args.size()) {
+        out += args[param - macro->second.params.begin()];
+      } else {
+        out += token;
       }
+      j = k;
     }
-    return nullptr;
+    out += '\n';
+    i = close + 1;
   }
+  return out;
+}
 
-  NS::StringEx* resource_path = NS::StringEx::asStringEx(getEnv(FERRUM_LIB));
-  if (resource_path != nullptr) {
-    resource_path = NS::StringEx::asStringEx(resource_path)
-                        ->stringByAppendingPathComponent(ferrumName)
-                        ->stringByAppendingPathExtension(metalExt);
-  } else {
-    resource_path = NS::StringEx::asStringEx(nsStr("./lib"))
-                        ->stringByAppendingPathComponent(ferrumName)
-                        ->stringByAppendingPathExtension(metalExt);
-  }
-  if (fileManager != nullptr && fileManager->fileExistsAtPath(resource_path, &isDir)) {
-    if (!isDir) {
-      return resource_path;
+// Reads the buffers and scalars of a kernel: b for an input buffer, B for an in/out buffer,
+// and f for a scalar. The integer arguments before the first buffer give the family.
+Kernel shape(const std::string& name, const std::string& params) {
+  std::string letters;
+  std::vector<std::string> leading;
+  for (const std::string& param : splitArgs(params)) {
+    // attributes, such as [[buffer(0)]] and [[thread_position_in_grid]]
+    std::string declaration = param;
+    size_t attribute;
+    while ((attribute = declaration.find("[[")) != std::string::npos) {
+      declaration.erase(attribute, declaration.find("]]", attribute) + 2 - attribute);
+    }
+    std::vector<std::string> w = words(declaration);
+    bool isConst = std::find(w.begin(), w.end(), "const") != w.end();
+    bool pointer = std::find(w.begin(), w.end(), "*") != w.end();
+    bool reference = std::find(w.begin(), w.end(), "&") != w.end();
+    bool real = std::find(w.begin(), w.end(), "REAL") != w.end();
+    if (std::find(w.begin(), w.end(), "device") != w.end() && pointer) {
+      // scratch buffers, such as the partial results of reductions, are not passed by the caller
+      if (real) {
+        letters += isConst ? 'b' : 'B';
+      }
+    } else if (std::find(w.begin(), w.end(), "constant") != w.end() && reference) {
+      if (real) {
+        letters += 'f';
+      } else if (letters.empty()) {
+        leading.push_back(w.back());
+      }
     }
   }
-  return nullptr;
-}
 
-MTL::Library* loadLibrary(const char* path) {
-  NS::Array* devices = MTL::CopyAllDevices();
-  int length = devices != nullptr ? devices->count() : 0;
-  if (length == 0) {
-    std::cerr << "Metal is not supported on this device" << std::endl;
-    return nullptr;
+  std::string family = "other";
+  if (leading.empty()) {
+    family = "vector";
+  } else if (leading == std::vector<std::string>{"sd", "fd"}) {
+    family = "ge";
+  } else if (leading == std::vector<std::string>{"sd", "unit", "bottom"}) {
+    family = "uplo";
+  }
+  // swap works on its two buffers in place, and is called with the bBB functions
+  if (letters == "BB") {
+    letters = "bBB";
+  }
+  std::string signature = "none";
+  if (family != "other" && std::find(SIGNATURES.begin(), SIGNATURES.end(), letters) != SIGNATURES.end()) {
+    signature = letters;
   }
-  MTL::Device* device = devices->object<MTL::Device>(0);
-  std::cout << "Running on device: " << device->name()->utf8String() << std::endl;
+  return {name, family, signature};
+}
 
-  MTL::CommandQueue* commandQueue = device->newCommandQueue();
+// Finds the kernels in a source file. Templates are only kernels where they are instantiated
+// with a host_name.
+void parseKernels(const std::string& source, std::vector<Kernel>& kernels) {
+  std::string text = expandMacros(stripSource(source));
+  size_t pos = 0;
+  while ((pos = text.find("kernel", pos)) != std::string::npos) {
+    size_t end = pos + 6;
+    if ((pos > 0 && identChar(text[pos - 1])) || (end < text.size() && identChar(text[end]))) {
+      pos = end;
+      continue;
+    }
+    size_t declStart = text.find_last_of(";}", pos);
+    declStart = (declStart == std::string::npos) ? 0 : declStart + 1;
+    std::string prefix = text.substr(declStart, pos - declStart);
 
-  const NS::String* libPath = getLibPath(path);
-  if (libPath == nullptr) {
-    std::cerr << "Error: Failed to find library" << std::endl;
-    return nullptr;
+    size_t open = text.find('(', end);
+    std::vector<std::string> w = words(text.substr(end, open - end));
+    if (open == std::string::npos || w.size() < 2 || w[0] != "void") {
+      pos = end;
+      continue;
+    }
+    size_t close = closing(text, open);
+    std::string params = text.substr(open + 1, close - open - 1);
+    pos = close;
+
+    size_t hostName = prefix.find("host_name");
+    if (hostName != std::string::npos) {
+      size_t quote = prefix.find('"', hostName);
+      kernels.push_back(shape(prefix.substr(quote + 1, prefix.find('"', quote + 1) - quote - 1), params));
+    } else if (prefix.find("template") == std::string::npos) {
+      kernels.push_back(shape(w[1], params));
+    }
+  }
+}
+
+bool readKernels(const char* dir, std::vector<Kernel>& kernels) {
+  std::vector<std::filesystem::path> paths;
+  std::error_code error;
+  for (const auto& entry : std::filesystem::directory_iterator(dir, error)) {
+    if (entry.path().extension() == ".metal") {
+      paths.push_back(entry.path());
+    }
   }
-  NS::URL* url = NS::URL::fileURLWithPath(libPath);
-  if (url == nullptr) {
-    std::cerr << "Error: Failed to create URL for: " << str(libPath) << std::endl;
-    return nullptr;
+  if (error) {
+    std::cerr << "Error: Failed to read directory: " << dir << std::endl;
+    return false;
   }
+  std::sort(paths.begin(), paths.end());
+  for (const auto& path : paths) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+      std::cerr << "Error: Failed to open file: " << path.string() << std::endl;
+      return false;
+    }
+    std::stringstream source;
+    source << file.rdbuf();
+    parseKernels(source.str(), kernels);
+  }
+  std::sort(kernels.begin(), kernels.end(), [](const Kernel& a, const Kernel& b) { return a.name < b.name; });
+  for (size_t i = 1; i < kernels.size(); i++) {
+    if (kernels[i].name == kernels[i - 1].name) {
+      std::cerr << "Error: Kernel declared twice: " << kernels[i].name << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
 
-  NS::Error* pError = nullptr;
-  MTL::Library* library = device->newLibrary(url, &pError);
+// Must match functionHash in the generated header
+unsigned functionHash(const std::string& name, unsigned seed) {
+  unsigned hash = 2166136261u ^ seed;
+  for (char c : name) {
+    hash = (hash ^ (unsigned char)c) * 16777619u;
+  }
+  return hash ^ (hash >> 15);
+}
 
-  if (pError != nullptr) {
-    std::cerr << "Error: Loading library: " << str(pError->localizedDescription()) << std::endl;
-    std::cerr << "     : Library file: " << url->fileSystemRepresentation() << std::endl;
-    return nullptr;
-  } else if (library == nullptr) {
-    std::cerr << "Error: Failed to create library from: " << url->fileSystemRepresentation() << std::endl;
-    return nullptr;
+// Builds a perfect hash of the names. Each name falls into a bucket by its hash with seed 0,
+// and a seed is found for each bucket that puts all of its names in free slots.
+// The largest buckets are placed first, while most of the slots are free.
+bool perfectHash(const std::vector<Kernel>& kernels, std::vector<unsigned>& seeds, std::vector<int>& slots) {
+  std::vector<std::vector<int>> buckets(seeds.size());
+  for (size_t i = 0; i < kernels.size(); i++) {
+    buckets[functionHash(kernels[i].name, 0) % seeds.size()].push_back(i);
+  }
+  std::vector<int> order(buckets.size());
+  for (size_t b = 0; b < order.size(); b++) {
+    order[b] = b;
   }
+  std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return buckets[a].size() > buckets[b].size(); });
 
-  return library;
+  std::fill(slots.begin(), slots.end(), -1);
+  for (int b : order) {
+    if (buckets[b].empty()) {
+      break;
+    }
+    bool placed = false;
+    for (unsigned seed = 1; seed <= 0xffff && !placed; seed++) {
+      std::vector<size_t> taken;
+      for (int i : buckets[b]) {
+        size_t slot = functionHash(kernels[i].name, seed) % slots.size();
+        if (slots[slot] >= 0 || std::find(taken.begin(), taken.end(), slot) != taken.end()) {
+          break;
+        }
+        taken.push_back(slot);
+      }
+      if (taken.size() == buckets[b].size()) {
+        for (size_t j = 0; j < taken.size(); j++) {
+          slots[taken[j]] = buckets[b][j];
+        }
+        seeds[b] = seed;
+        placed = true;
+      }
+    }
+    if (!placed) {
+      return false;
+    }
+  }
+  return true;
 }
 
-void printCode(std::vector<std::string>& names, const char* header, const char* cpp) {
+bool printCode(std::vector<Kernel>& kernels, const char* header) {
+  // a bucket for every 4 names, and a slot for every name with some to spare
+  std::vector<unsigned> seeds((kernels.size() + 3) / 4, 0);
+  size_t slotCount = 1;
+  while (slotCount < kernels.size() + kernels.size() / 8) {
+    slotCount *= 2;
+  }
+  std::vector<int> slots(slotCount);
+  if (!perfectHash(kernels, seeds, slots)) {
+    std::cerr << "Error: Failed to find a perfect hash of the function names" << std::endl;
+    return false;
+  }
+
   std::ofstream headerFile(header);
   if (!headerFile.is_open()) {
     std::cerr << "Error: Failed to open file: " << header << std::endl;
-    return;
+    return false;
   }
 
   headerFile << "// This file is auto-generated\n" << std::endl;
   headerFile << "#pragma once\n" << std::endl;
   headerFile << "#ifndef _FUNCTIONS_HPP" << std::endl;
   headerFile << "#define _FUNCTIONS_HPP\n" << std::endl;
-  headerFile << "#include <string>" << std::endl;
-  headerFile << "#include <unordered_map>\n" << std::endl;
+  headerFile << "#include <string_view>" << std::endl;
+  headerFile << "#include \"signature.hpp\"\n" << std::endl;
   headerFile << "namespace Ferrum {\n" << std::endl;
   headerFile << "  enum FunctionID {" << std::endl;
   headerFile << "    UNKNOWN = -1," << std::endl;
-  int index = 0;
-  for (const std::string& fn : names) {
-    headerFile << "    " << fn << " = " << index;
-    if (++index < names.size()) {
+  size_t index = 0;
+  for (const Kernel& kernel : kernels) {
+    headerFile << "    " << kernel.name << " = " << index;
+    if (++index < kernels.size()) {
       headerFile << ",";
     }
     headerFile << std::endl;
   }
   headerFile << "  };\n" << std::endl;
-  headerFile << "  extern std::unordered_map<std::string, FunctionID>* functionMap;\n" << std::endl;
+  headerFile << "  // the number of functions, and their names by FunctionID" << std::endl;
+  headerFile << "  const int functionCount = " << kernels.size() << ";" << std::endl;
+  headerFile << "  inline constexpr const char* functionNames[] = {" << std::endl;
+  for (const Kernel& kernel : kernels) {
+    headerFile << "    \"" << kernel.name << "\"," << std::endl;
+  }
+  headerFile << "  };\n" << std::endl;
+  headerFile << "  // the arguments of each kernel, by FunctionID, as declared in the Metal source" << std::endl;
+  headerFile << "  inline constexpr KernelShape functionShapes[] = {" << std::endl;
+  for (const Kernel& kernel : kernels) {
+    headerFile << "    {Family::" << kernel.family << ", Signature::" << kernel.signature << "}, // "
+               << kernel.name << std::endl;
+  }
+  headerFile << "  };\n" << std::endl;
+  headerFile << "  // A perfect hash of the names. The seed of the bucket of a name gives its slot," << std::endl;
+  headerFile << "  // and no two names share a slot." << std::endl;
+  headerFile << "  constexpr unsigned functionHash(std::string_view name, unsigned seed) {" << std::endl;
+  headerFile << "    unsigned hash = 2166136261u ^ seed;" << std::endl;
+  headerFile << "    for (char c : name) {" << std::endl;
+  headerFile << "      hash = (hash ^ (unsigned char)c) * 16777619u;" << std::endl;
+  headerFile << "    }" << std::endl;
+  headerFile << "    return hash ^ (hash >> 15);" << std::endl;
+  headerFile << "  }\n" << std::endl;
+  headerFile << "  inline constexpr unsigned short functionSeeds[] = {";
+  for (size_t b = 0; b < seeds.size(); b++) {
+    headerFile << ((b % 16 == 0) ? "\n    " : " ") << seeds[b] << ",";
+  }
+  headerFile << "\n  };\n" << std::endl;
+  headerFile << "  // the FunctionID in each slot, or -1" << std::endl;
+  headerFile << "  inline constexpr short functionSlots[] = {";
+  for (size_t i = 0; i < slots.size(); i++) {
+    headerFile << ((i % 16 == 0) ? "\n    " : " ") << slots[i] << ",";
+  }
+  headerFile << "\n  };\n" << std::endl;
+  headerFile << "  // The ID of a function, or UNKNOWN. This is a constant expression, and does not allocate." << std::endl;
+  headerFile << "  constexpr FunctionID getFunctionID(std::string_view name) {" << std::endl;
+  headerFile << "    unsigned seed = functionSeeds[functionHash(name, 0) % " << seeds.size() << "];" << std::endl;
+  headerFile << "    int id = functionSlots[functionHash(name, seed) % " << slots.size() << "];" << std::endl;
+  headerFile << "    return (id >= 0 && name == functionNames[id]) ? static_cast<FunctionID>(id) : UNKNOWN;" << std::endl;
+  headerFile << "  }\n" << std::endl;
   headerFile << "} // namespace Ferrum\n" << std::endl;
   headerFile << "#endif // _FUNCTIONS_HPP\n" << std::endl;
   headerFile.close();
+  if (headerFile.fail()) {
+    std::cerr << "Error: Failed to write file: " << header << std::endl;
+    return false;
+  }
+  return true;
+}
 
-  std::ofstream sourceFile(cpp);
-  if (!sourceFile.is_open()) {
-    std::cerr << "Error: Failed to open file: " << cpp << std::endl;
-    return;
-  }
-  std::string headerName = std::string(header);
-  headerName = headerName.substr(headerName.find_last_of('/') + 1);
-  sourceFile << "// This file is auto-generated\n" << std::endl;
-  sourceFile << "#include \"" << headerName << "\"\n" << std::endl;
-  sourceFile << "#include <unordered_map>\n" << std::endl;
-  sourceFile << "namespace Ferrum {" << std::endl;
-  sourceFile << "  std::unordered_map<std::string, FunctionID>* functionMap;\n" << std::endl;
-  sourceFile << "  __attribute__((constructor)) void initFunctionMap() {" << std::endl;
-  sourceFile << "    functionMap = new std::unordered_map<std::string, FunctionID>();" << std::endl;
-  sourceFile << "    std::unordered_map<std::string, FunctionID>& fnMap = *functionMap;" << std::endl;
+// Java constants for the function IDs, so that calls from Java can skip looking up names
+bool printJava(std::vector<std::string>& names, const char* java) {
+  std::ofstream javaFile(java);
+  if (!javaFile.is_open()) {
+    std::cerr << "Error: Failed to open file: " << java << std::endl;
+    return false;
+  }
+  javaFile << "// This file is auto-generated\n" << std::endl;
+  javaFile << "package ferrum;\n" << std::endl;
+  javaFile << "import java.util.Arrays;\n" << std::endl;
+  javaFile << "// The IDs of the functions, for the int versions of the FerrumEngine functions" << std::endl;
+  javaFile << "public final class Functions {\n" << std::endl;
+  javaFile << "    public static final int UNKNOWN = -1;" << std::endl;
+  int index = 0;
+  for (const std::string& fn : names) {
+    javaFile << "    public static final int " << fn << " = " << index++ << ";" << std::endl;
+  }
+  javaFile << "\n    // sorted, so the ID of a function is the index of its name" << std::endl;
+  javaFile << "    private static final String[] NAMES = {" << std::endl;
   for (const std::string& fn : names) {
-    sourceFile << "    fnMap[\"" << fn << "\"] = " << fn << ";" << std::endl;
-  }
-  sourceFile << "  }\n" << std::endl;
-  sourceFile << "  __attribute__((destructor)) void cleanupFunctionMap() {" << std::endl;
-  sourceFile << "    delete functionMap;" << std::endl;
-  sourceFile << "    functionMap = nullptr;" << std::endl;
-  sourceFile << "  }\n\n} // namespace Ferrum\n" << std::endl;
-  sourceFile.close();
+    javaFile << "        \"" << fn << "\"," << std::endl;
+  }
+  javaFile << "    };\n" << std::endl;
+  javaFile << "    private Functions() {}\n" << std::endl;
+  javaFile << "    // The ID of a function, or UNKNOWN" << std::endl;
+  javaFile << "    public static int id(String name) {" << std::endl;
+  javaFile << "        int index = Arrays.binarySearch(NAMES, name);" << std::endl;
+  javaFile << "        return index >= 0 ? index : UNKNOWN;" << std::endl;
+  javaFile << "    }\n" << std::endl;
+  javaFile << "    public static String name(int id) {" << std::endl;
+  javaFile << "        return NAMES[id];" << std::endl;
+  javaFile << "    }" << std::endl;
+  javaFile << "}" << std::endl;
+  javaFile.close();
+  if (javaFile.fail()) {
+    std::cerr << "Error: Failed to write file: " << java << std::endl;
+    return false;
+  }
+  return true;
 }
 
 int main(int argc, char** argv) {
   std::string headerFile = std::string(INCLUDE_DIR) + "/" + HEADER_FILE;
-  std::string srcFile = std::string(SRC_DIR) + "/" + SRC_FILE;
+  std::string javaFile = std::string(SRC_DIR) + "/" + JAVA_FILE;
+  std::string metalDir = METAL_DIR;
   
   if (argc > 1) {
     for (int i = 1; i < argc; i++) {
       if (strcmp(argv[i], "-h") == 0) {
-        std::cout << "Usage: generateNames [-h] [-oh <header>] [-os <source>]" << std::endl;
+        std::cout << "Usage: generateNames [-h] [-m <metal dir>] [-oh <header>] [-oj <java>]" << std::endl;
         return 0;
+      } else if (strcmp(argv[i], "-m") == 0) {
+        if (i + 1 < argc) {
+          metalDir = argv[++i];
+        } else {
+          std::cerr << "Error: Missing argument for -m" << std::endl;
+          return -1;
+        }
       } else if (strcmp(argv[i], "-oh") == 0) {
         if (i + 1 < argc) {
           headerFile = argv[++i];
@@ -201,38 +502,35 @@ int main(int argc, char** argv) {
           std::cerr << "Error: Missing argument for -oh" << std::endl;
           return -1;
         }
-      } else if (strcmp(argv[i], "-os") == 0) {
+      } else if (strcmp(argv[i], "-oj") == 0) {
         if (i + 1 < argc) {
-          srcFile = argv[++i];
+          javaFile = argv[++i];
         } else {
-          std::cerr << "Error: Missing argument for -sh" << std::endl;
+          std::cerr << "Error: Missing argument for -oj" << std::endl;
           return -1;
         }
       }
     }
   }
 
-  MTL::Library* library = loadLibrary(nullptr);
-  if (library == nullptr) {
-    std::cerr << "Error: Failed to load library" << std::endl;
+  std::vector<Kernel> kernels;
+  if (!readKernels(metalDir.c_str(), kernels)) {
     return -1;
   }
-  std::cout << "Successfully loaded library" << std::endl;
-
-  NS::Array* functions = library->functionNames();
-  int length = functions != nullptr ? functions->count() : 0;
-  if (length == 0) {
-    std::cerr << "Error: No functions found in library" << std::endl;
+  if (kernels.empty()) {
+    std::cerr << "Error: No kernels found in: " << metalDir << std::endl;
     return -1;
   }
   std::vector<std::string> names;
-  for (int i = 0; i < length; i++) {
-    NS::String* name = static_cast<NS::String*>(functions->object(i));
-    names.push_back(name->utf8String());
+  for (const Kernel& kernel : kernels) {
+    names.push_back(kernel.name);
   }
-  std::sort(names.begin(), names.end());
-  printCode(names, headerFile.c_str(), srcFile.c_str());
-  std::cout << "Generated code for " << length << " function names" << std::endl;
+  if (!printCode(kernels, headerFile.c_str())) {
+    return -1;
+  }
+  if (!printJava(names, javaFile.c_str())) {
+    return -1;
+  }
+  std::cout << "Generated code for " << kernels.size() << " functions" << std::endl;
   return 0;
 }
-